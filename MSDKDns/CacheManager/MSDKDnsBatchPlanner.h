@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+#import "msdkdns_local_ip_stack.h"
+
+/**
+ * 批次发出时的回调，调用方以 timeOut 为超时发起一次解析请求，请求结束后调用 done 通知批次内所有调用方
+ * timeOut 为批次内调用方剩余时间的最小值，单位秒
+ */
+typedef void (^MSDKDnsBatchFlushHandler)(NSArray * domains,
+                                         msdkdns::MSDKDNS_TLocalIPStack netStack,
+                                         NSString * routeIp,
+                                         NSString * origin,
+                                         float timeOut,
+                                         void (^done)(void));
+
+/**
+ * 解析请求合批，合批逻辑见 msdkdns_batch_planner.h
+ * 同一网络栈、同一 routeIp、同一来源的未命中域名在一个短时间窗口内合并为一次 HTTPDNS 请求（dn 参数以逗号拼接），
+ * 来源用于上报的事件名，不同来源的调用不合并；
+ * 窗口到期、域名数达到上限或拼接后的查询串超过长度上限时立即发出
+ * 所有方法需在 msdkdns_queue 中调用
+ */
+@interface MSDKDnsBatchPlanner : NSObject
+
+// 合批窗口，单位ms，为0时不合批
+@property (assign, nonatomic) NSUInteger windowMs;
+// 单个批次最多合并的域名数，单个调用本身的域名不会被拆分
+@property (assign, nonatomic) NSUInteger maxDomains;
+// 单个批次拼接后的域名串最大长度，防止请求URL过长
+@property (assign, nonatomic) NSUInteger maxQueryLength;
+
+// 已发出的批次数
+@property (assign, nonatomic, readonly) NSUInteger flushedBatchCount;
+// 与其他调用合并发出、未单独发起请求的调用数
+@property (assign, nonatomic, readonly) NSUInteger mergedCallCount;
+
+- (instancetype)initWithQueue:(dispatch_queue_t)queue flushHandler:(MSDKDnsBatchFlushHandler)flushHandler;
+
+/**
+ * 加入待发批次，timeOut 为本次调用的超时（秒），所在批次的请求结束后回调 completion
+ */
+- (void)addDomains:(NSArray *)domains
+          netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+           routeIp:(NSString *)routeIp
+              from:(NSString *)origin
+           timeOut:(float)timeOut
+        completion:(void (^)(void))completion;
+
+@end
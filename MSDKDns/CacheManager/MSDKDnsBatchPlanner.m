@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsBatchPlanner.h"
+#import "MSDKDnsLog.h"
+#import "msdkdns_batch_planner.h"
+#import "msdkdns_timer_wheel.h"
+
+// 批次发出时调用方已超时的情况下，仍给请求留出的最短时间，单位秒
+static const float kMSDKDnsBatchMinTimeOut = 0.1;
+
+@interface MSDKDnsBatchPlanner () {
+    msdkdns::BatchPlanner * _planner;
+}
+
+@property (strong, nonatomic) dispatch_queue_t queue;
+@property (copy, nonatomic) MSDKDnsBatchFlushHandler flushHandler;
+// 调用ID -> completion
+@property (strong, nonatomic) NSMutableDictionary * completions;
+// 合批键 -> @[netStack, routeIp, origin]，键的种类很少，不做清理
+@property (strong, nonatomic) NSMutableDictionary * batchParams;
+
+@end
+
+@implementation MSDKDnsBatchPlanner
+
+- (instancetype)initWithQueue:(dispatch_queue_t)queue flushHandler:(MSDKDnsBatchFlushHandler)flushHandler {
+    if (self = [super init]) {
+        _queue = queue;
+        _flushHandler = [flushHandler copy];
+        _completions = [[NSMutableDictionary alloc] init];
+        _batchParams = [[NSMutableDictionary alloc] init];
+        _planner = new msdkdns::BatchPlanner();
+        _windowMs = 0;
+        _maxDomains = 0;
+        _maxQueryLength = 0;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    delete _planner;
+    _planner = NULL;
+}
+
+- (NSUInteger)flushedBatchCount {
+    msdkdns::msdkdns_batch_stats stats;
+    _planner->Stats(&stats);
+    return (NSUInteger)stats.flushed;
+}
+
+- (NSUInteger)mergedCallCount {
+    msdkdns::msdkdns_batch_stats stats;
+    _planner->Stats(&stats);
+    return (NSUInteger)stats.merged;
+}
+
+- (void)addDomains:(NSArray *)domains
+          netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+           routeIp:(NSString *)routeIp
+              from:(NSString *)origin
+           timeOut:(float)timeOut
+        completion:(void (^)(void))completion {
+    if (!domains || domains.count == 0) {
+        if (completion) {
+            completion();
+        }
+        return;
+    }
+    _planner->SetLimits((int64_t)self.windowMs, self.maxDomains, self.maxQueryLength);
+    // 来源用于上报的事件名，不同来源的调用不合并
+    NSString * key = [NSString stringWithFormat:@"%d|%@|%@", (int)netStack, routeIp ?: @"", origin ?: @""];
+    self.batchParams[key] = @[@(netStack), routeIp ?: @"", origin ?: @""];
+    std::vector<std::string> names;
+    names.reserve(domains.count);
+    for (NSString * domain in domains) {
+        names.push_back(std::string(domain.UTF8String ?: ""));
+    }
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    std::vector<msdkdns::msdkdns_batch> ready;
+    int64_t flushMs = -1;
+    uint64_t call = _planner->Add(std::string(key.UTF8String), names, now, now + (int64_t)(timeOut * 1000), &ready,
+                                  &flushMs);
+    if (completion) {
+        self.completions[@(call)] = [completion copy];
+    }
+    if (flushMs >= 0) {
+        [self scheduleExpireAt:flushMs];
+    }
+    [self flushBatches:ready];
+}
+
+- (void)scheduleExpireAt:(int64_t)flushMs {
+    int64_t delay = flushMs - msdkdns::msdkdns_monotonic_ms();
+    __weak __typeof__(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MAX(delay, 0) * NSEC_PER_MSEC)), self.queue, ^{
+        [weakSelf expireBatchesDueAt:flushMs];
+    });
+}
+
+- (void)expireBatchesDueAt:(int64_t)flushMs {
+    std::vector<msdkdns::msdkdns_batch> ready;
+    _planner->Expire(msdkdns::msdkdns_monotonic_ms(), &ready);
+    // 定时器可能略早于单调时钟触发，该时间点应发出的批次仍未发出时重新调度，之后的批次有各自的定时器
+    int64_t next = _planner->NextFlush();
+    if (next >= 0 && next <= flushMs) {
+        [self scheduleExpireAt:next];
+    }
+    [self flushBatches:ready];
+}
+
+- (void)flushBatches:(const std::vector<msdkdns::msdkdns_batch> &)batches {
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    for (size_t i = 0; i < batches.size(); i++) {
+        const msdkdns::msdkdns_batch & batch = batches[i];
+        NSMutableArray * domains = [NSMutableArray arrayWithCapacity:batch.domains.size()];
+        for (size_t k = 0; k < batch.domains.size(); k++) {
+            [domains addObject:[NSString stringWithUTF8String:batch.domains[k].c_str()]];
+        }
+        NSMutableArray * completions = [NSMutableArray arrayWithCapacity:batch.calls.size()];
+        for (size_t k = 0; k < batch.calls.size(); k++) {
+            void (^completion)(void) = self.completions[@(batch.calls[k])];
+            if (completion) {
+                [completions addObject:completion];
+                [self.completions removeObjectForKey:@(batch.calls[k])];
+            }
+        }
+        NSArray * params = self.batchParams[[NSString stringWithUTF8String:batch.key.c_str()]];
+        msdkdns::MSDKDNS_TLocalIPStack netStack = (msdkdns::MSDKDNS_TLocalIPStack)[params[0] intValue];
+        NSString * routeIp = params[1];
+        NSString * origin = params[2];
+        float timeOut = MAX((batch.deadline_ms - now) / 1000.0f, kMSDKDnsBatchMinTimeOut);
+        if (completions.count > 1) {
+            MSDKDNSLOG(@"Batch flush %@ for %lu callers after %lldms, timeout %.2fs", domains,
+                       (unsigned long)completions.count, (long long)(now - batch.created_ms), timeOut);
+        }
+        void (^done)(void) = ^{
+            for (void (^completion)(void) in completions) {
+                completion();
+            }
+        };
+        if (self.flushHandler) {
+            self.flushHandler(domains, netStack, routeIp, origin, timeOut, done);
+        } else {
+            done();
+        }
+    }
+}
+
+@end
@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class MSDKDnsDomainCache;
+
+/**
+ * 按网络划分的域名缓存分区
+ * 网络切换时原网络的缓存整体保留，切回该网络时直接恢复，无需重新解析全部域名
+ * 最多保留 capacity 个非当前网络的分区，超出时淘汰最久未使用的分区
+ * 非线程安全，需在 msdkdns_queue 中调用
+ */
+@interface MSDKDnsCachePartitions : NSObject
+
+// 恢复已保留分区的次数
+@property (assign, nonatomic, readonly) NSUInteger restoredCount;
+// 切换到没有保留分区的网络的次数
+@property (assign, nonatomic, readonly) NSUInteger missedCount;
+@property (assign, nonatomic, readonly) NSUInteger evictedCount;
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+/**
+ * 保存 network 的缓存 cache，取出 target 的分区，target 没有保留的分区时返回 nil
+ * cache 为空时不保留，取出的分区不再由此处持有
+ */
+- (MSDKDnsDomainCache *)storeCache:(MSDKDnsDomainCache *)cache
+                        forNetwork:(NSString *)network
+                takeCacheOfNetwork:(NSString *)target;
+
+- (void)removeAllPartitions;
+// 当前保留的分区数，不含当前网络
+- (NSUInteger)count;
+
+@end
@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsCachePartitions.h"
+#import "MSDKDnsDomainCache.h"
+#import "MSDKDnsLog.h"
+#include "msdkdns_cache_partitions.h"
+#include <string>
+#include <vector>
+
+@interface MSDKDnsCachePartitions () {
+    // 保留顺序和淘汰
+    msdkdns::PartitionIndex * _index;
+}
+
+// network -> MSDKDnsDomainCache
+@property (strong, nonatomic) NSMutableDictionary * partitions;
+
+@end
+
+@implementation MSDKDnsCachePartitions
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        _index = new msdkdns::PartitionIndex(capacity);
+        _partitions = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    delete _index;
+}
+
+- (MSDKDnsDomainCache *)storeCache:(MSDKDnsDomainCache *)cache
+                        forNetwork:(NSString *)network
+                takeCacheOfNetwork:(NSString *)target {
+    MSDKDnsDomainCache * restored = nil;
+    if (target && _index->Take([target UTF8String] ?: "")) {
+        restored = self.partitions[target];
+        [self.partitions removeObjectForKey:target];
+    }
+    if (network && cache && [cache count] > 0) {
+        std::vector<std::string> evicted;
+        _index->Store([network UTF8String] ?: "", &evicted);
+        self.partitions[network] = cache;
+        for (size_t i = 0; i < evicted.size(); i++) {
+            NSString * oldest = [NSString stringWithUTF8String:evicted[i].c_str()];
+            MSDKDNSLOG(@"Evict cache partition of network %@", oldest);
+            [self.partitions removeObjectForKey:oldest];
+        }
+    }
+    return restored;
+}
+
+- (void)removeAllPartitions {
+    [self.partitions removeAllObjects];
+    _index->Clear();
+}
+
+- (NSUInteger)count {
+    return self.partitions.count;
+}
+
+- (NSUInteger)restoredCount {
+    return _index->restored();
+}
+
+- (NSUInteger)missedCount {
+    return _index->missed();
+}
+
+- (NSUInteger)evictedCount {
+    return _index->evicted();
+}
+
+@end
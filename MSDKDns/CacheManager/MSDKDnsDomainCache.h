@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class MSDKDnsSnapshot;
+
+/**
+ * 域名解析结果缓存
+ * 域名规范化后驻留为编号（msdkdns_domain_interner.h），以编号为键并按预先计算的哈希分片；
+ * 无法驻留的域名（不合法或驻留表已满）以小写字符串为键存入每个实例独立的有界溢出表，超出上限时淘汰最早写入的
+ * 条目以紧凑的二进制形式存放在所有实例共用的 msdkdns::DomainCache（msdkdns_domain_cache.h）中，每个分片独立读写锁，
+ * 查询无需拷贝整个缓存，也无需切换到 msdkdns_queue；总内存不超过预算，超出时按 CLOCK 淘汰
+ * 读取时解码为新的 NSDictionary，读到的对象可在锁外安全使用
+ */
+@interface MSDKDnsDomainCache : NSObject
+
+// 所有缓存实例共用的内存预算，默认4MB，最小64KB，缩小时立即淘汰
++ (void)setMemoryBudget:(NSUInteger)bytes;
+// cacheHits / cacheMisses / cacheEvictions / cacheRejected / cacheEntries / cacheBytesUsed / cacheBytesReserved / cacheBudget
++ (NSDictionary *)statistics;
+
+- (NSDictionary *)objectForKey:(NSString *)domain;
+- (NSDictionary *)objectForKeyedSubscript:(NSString *)domain;
+- (void)setObject:(NSDictionary *)domainInfo forKey:(NSString *)domain;
+/**
+ * 查询域名缓存状态，返回 MSDKDnsDomainCacheHit / MSDKDnsDomainCacheExpired / MSDKDnsDomainCacheEmpty
+ * TTL 在写入时已解析为单调时钟截止时间，查询时只与当前单调时间比较，不再解析字符串；休眠、挂起期间到期的条目在恢复后同样判为过期
+ */
+- (NSString *)cacheStatusForKey:(NSString *)domain;
+// 距离 TTL 过期的秒数，无缓存或已过期时小于等于0
+- (NSTimeInterval)timeToExpireForKey:(NSString *)domain;
+- (void)removeObjectForKey:(NSString *)domain;
+- (void)removeAllObjects;
+- (NSUInteger)count;
+
+/**
+ * 挂载持久化缓存快照，未命中内存时从快照中按需读取单个域名并写入内存
+ * 内存中已有或已删除的域名以内存为准，removeAllObjects 时卸载快照
+ */
+- (void)attachSnapshot:(MSDKDnsSnapshot *)snapshot;
+
+/**
+ * 返回当前缓存的拷贝，仅用于上报、持久化等低频场景
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
@@ -0,0 +1,776 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsDomainCache.h"
+#import "MSDKDnsPrivate.h"
+#import "MSDKDnsLog.h"
+#import "MSDKDnsSnapshot.h"
+#import "msdkdns_domain_cache.h"
+#import "msdkdns_domain_interner.h"
+#import "msdkdns_ip.h"
+#import "msdkdns_timer_wheel.h"
+#import <pthread.h>
+#import <sys/socket.h>
+
+#define MSDKDNS_DOMAIN_CACHE_MIN_BUDGET (64 * 1024)
+// 每个实例的溢出表上限，存放无法驻留（不合法或驻留表已满）的域名，超出时淘汰最早写入的
+#define MSDKDNS_DOMAIN_CACHE_OVERFLOW_CAPACITY 256
+
+/**
+ * 条目 payload 编码
+ * 紧凑格式：[格式][子字典数] 子字典为 [键编号][字段数] 字段为 [键编号][类型][值]，
+ * 十进制数字字符串存为 uint32，IP 列表存为二进制地址，其余字符串放入字符串池只存编号
+ * 出现未知的键、值类型或无法原样还原的值时，整条以二进制 plist 存储
+ */
+enum {
+    kMSDKDnsCacheFormatCompact = 0,
+    kMSDKDnsCacheFormatPlist = 1,
+};
+
+enum {
+    kMSDKDnsCacheValueDecimal = 1,  // 十进制数字字符串，uint32
+    kMSDKDnsCacheValueAtom = 2,     // 其他字符串，字符串池下标
+    kMSDKDnsCacheValueInteger = 3,  // NSNumber 整数，int32
+    kMSDKDnsCacheValueIPs = 4,      // IP 列表，[个数]，每项 [类型 0/4/6][地址]，0 为占位的 @"0"
+};
+
+static NSString * const kMSDKDnsCacheSectionKeys[] = {
+    kMSDKHttpDnsCache_A,
+    kMSDKHttpDnsCache_4A,
+    kMSDKLocalDnsCache,
+    kMSDKHttpDnsInfo_A,
+    kMSDKHttpDnsInfo_4A,
+    kMSDKHttpDnsInfo_BOTH,
+};
+
+static NSString * const kMSDKDnsCacheFieldKeys[] = {
+    kIP,
+    kClientIP,
+    kTTL,
+    kTTLExpired,
+    kDnsTimeConsuming,
+    kChannel,
+    kDnsErrCode,
+    kDnsErrMsg,
+    kDnsRetry,
+};
+
+static NSInteger MSDKDnsCacheKeyIndex(NSString * const *keys, size_t count, id key) {
+    if (![key isKindOfClass:[NSString class]]) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if ([keys[i] isEqualToString:key]) {
+            return (NSInteger)i;
+        }
+    }
+    return -1;
+}
+
+static void MSDKDnsCacheAppendUInt32(std::string *payload, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        payload->push_back((char)((value >> (8 * i)) & 0xFF));
+    }
+}
+
+// 仅接受可原样还原的十进制数字：无符号、无前导0、不超过 uint32
+static BOOL MSDKDnsCacheParseDecimal(NSString *text, uint32_t *value) {
+    NSUInteger length = text.length;
+    if (length == 0 || length > 10) {
+        return NO;
+    }
+    uint64_t result = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar c = [text characterAtIndex:i];
+        if (c < '0' || c > '9' || (c == '0' && i == 0 && length > 1)) {
+            return NO;
+        }
+        result = result * 10 + (c - '0');
+    }
+    if (result > 0xFFFFFFFFULL) {
+        return NO;
+    }
+    *value = (uint32_t)result;
+    return YES;
+}
+
+static BOOL MSDKDnsCacheEncodeIPs(NSArray *ips, std::string *payload) {
+    if (ips.count > 0xFF) {
+        return NO;
+    }
+    payload->push_back((char)ips.count);
+    for (id ip in ips) {
+        if (![ip isKindOfClass:[NSString class]]) {
+            return NO;
+        }
+        if ([ip isEqualToString:@"0"]) {
+            payload->push_back(0);
+            continue;
+        }
+        const char * text = [ip UTF8String];
+        size_t length = text ? strlen(text) : 0;
+        uint8_t address[16];
+        char formatted[msdkdns::kMSDKDnsIPTextSize];
+        int family = msdkdns::msdkdns_parse_ip(text, length, address);
+        // 非规范写法（如大写、未压缩）无法原样还原
+        if (!family || msdkdns::msdkdns_format_ip(family, address, formatted) != length ||
+            memcmp(formatted, text, length) != 0) {
+            return NO;
+        }
+        payload->push_back(family == AF_INET6 ? 6 : 4);
+        payload->append((const char *)address, family == AF_INET6 ? 16 : 4);
+    }
+    return YES;
+}
+
+static BOOL MSDKDnsCacheEncodeValue(id value, std::vector<std::string> *atoms, std::string *payload) {
+    if ([value isKindOfClass:[NSString class]]) {
+        uint32_t number = 0;
+        if (MSDKDnsCacheParseDecimal(value, &number)) {
+            payload->push_back(kMSDKDnsCacheValueDecimal);
+            MSDKDnsCacheAppendUInt32(payload, number);
+            return YES;
+        }
+        NSData * data = [value dataUsingEncoding:NSUTF8StringEncoding];
+        if (!data) {
+            return NO;
+        }
+        std::string text((const char *)data.bytes, data.length);
+        size_t atom = 0;
+        while (atom < atoms->size() && (*atoms)[atom] != text) {
+            atom++;
+        }
+        if (atom == atoms->size()) {
+            if (atom >= 0xFF) {
+                return NO;
+            }
+            atoms->push_back(text);
+        }
+        payload->push_back(kMSDKDnsCacheValueAtom);
+        payload->push_back((char)atom);
+        return YES;
+    }
+    if ([value isKindOfClass:[NSNumber class]]) {
+        if (value == (id)kCFBooleanTrue || value == (id)kCFBooleanFalse || CFNumberIsFloatType((CFNumberRef)value)) {
+            return NO;
+        }
+        long long number = [value longLongValue];
+        if (number < -0x7FFFFFFFLL - 1 || number > 0x7FFFFFFFLL) {
+            return NO;
+        }
+        payload->push_back(kMSDKDnsCacheValueInteger);
+        MSDKDnsCacheAppendUInt32(payload, (uint32_t)(int32_t)number);
+        return YES;
+    }
+    if ([value isKindOfClass:[NSArray class]]) {
+        payload->push_back(kMSDKDnsCacheValueIPs);
+        return MSDKDnsCacheEncodeIPs(value, payload);
+    }
+    return NO;
+}
+
+static BOOL MSDKDnsCacheEncodeCompact(NSDictionary *info, std::vector<std::string> *atoms, std::string *payload) {
+    size_t sectionKeyCount = sizeof(kMSDKDnsCacheSectionKeys) / sizeof(kMSDKDnsCacheSectionKeys[0]);
+    size_t fieldKeyCount = sizeof(kMSDKDnsCacheFieldKeys) / sizeof(kMSDKDnsCacheFieldKeys[0]);
+    payload->push_back(kMSDKDnsCacheFormatCompact);
+    payload->push_back((char)info.count);
+    for (id sectionKey in info) {
+        NSInteger sectionIndex = MSDKDnsCacheKeyIndex(kMSDKDnsCacheSectionKeys, sectionKeyCount, sectionKey);
+        NSDictionary * section = info[sectionKey];
+        if (sectionIndex < 0 || ![section isKindOfClass:[NSDictionary class]]) {
+            return NO;
+        }
+        payload->push_back((char)sectionIndex);
+        payload->push_back((char)section.count);
+        for (id fieldKey in section) {
+            NSInteger fieldIndex = MSDKDnsCacheKeyIndex(kMSDKDnsCacheFieldKeys, fieldKeyCount, fieldKey);
+            if (fieldIndex < 0) {
+                return NO;
+            }
+            payload->push_back((char)fieldIndex);
+            if (!MSDKDnsCacheEncodeValue(section[fieldKey], atoms, payload)) {
+                return NO;
+            }
+        }
+    }
+    return YES;
+}
+
+static BOOL MSDKDnsCacheEncode(NSDictionary *info, std::vector<std::string> *atoms, std::string *payload) {
+    if (info.count <= sizeof(kMSDKDnsCacheSectionKeys) / sizeof(kMSDKDnsCacheSectionKeys[0]) &&
+        MSDKDnsCacheEncodeCompact(info, atoms, payload)) {
+        return YES;
+    }
+    atoms->clear();
+    payload->clear();
+    NSError * error = nil;
+    NSData * data = [NSPropertyListSerialization dataWithPropertyList:info
+                                                               format:NSPropertyListBinaryFormat_v1_0
+                                                              options:0
+                                                                error:&error];
+    if (!data) {
+        MSDKDNSLOG(@"Domain cache encode failed: %@", error);
+        return NO;
+    }
+    payload->push_back(kMSDKDnsCacheFormatPlist);
+    payload->append((const char *)data.bytes, data.length);
+    return YES;
+}
+
+typedef struct MSDKDnsCacheReader {
+    const uint8_t *data;
+    size_t length;
+    size_t offset;
+} MSDKDnsCacheReader;
+
+static BOOL MSDKDnsCacheReadBytes(MSDKDnsCacheReader *reader, size_t size, const uint8_t **bytes) {
+    if (reader->length - reader->offset < size) {
+        return NO;
+    }
+    *bytes = reader->data + reader->offset;
+    reader->offset += size;
+    return YES;
+}
+
+static BOOL MSDKDnsCacheReadByte(MSDKDnsCacheReader *reader, uint8_t *value) {
+    const uint8_t * bytes = NULL;
+    if (!MSDKDnsCacheReadBytes(reader, 1, &bytes)) {
+        return NO;
+    }
+    *value = bytes[0];
+    return YES;
+}
+
+static BOOL MSDKDnsCacheReadUInt32(MSDKDnsCacheReader *reader, uint32_t *value) {
+    const uint8_t * bytes = NULL;
+    if (!MSDKDnsCacheReadBytes(reader, 4, &bytes)) {
+        return NO;
+    }
+    *value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return YES;
+}
+
+static NSArray *MSDKDnsCacheDecodeIPs(MSDKDnsCacheReader *reader) {
+    uint8_t count = 0;
+    if (!MSDKDnsCacheReadByte(reader, &count)) {
+        return nil;
+    }
+    NSMutableArray * ips = [NSMutableArray arrayWithCapacity:count];
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t type = 0;
+        if (!MSDKDnsCacheReadByte(reader, &type)) {
+            return nil;
+        }
+        if (type == 0) {
+            [ips addObject:@"0"];
+            continue;
+        }
+        int family = type == 6 ? AF_INET6 : AF_INET;
+        const uint8_t * address = NULL;
+        char text[msdkdns::kMSDKDnsIPTextSize];
+        if (!MSDKDnsCacheReadBytes(reader, type == 6 ? 16 : 4, &address) ||
+            !msdkdns::msdkdns_format_ip(family, address, text)) {
+            return nil;
+        }
+        [ips addObject:[NSString stringWithUTF8String:text]];
+    }
+    return ips;
+}
+
+static id MSDKDnsCacheDecodeValue(MSDKDnsCacheReader *reader, const msdkdns::EntryStore *store,
+                                  const msdkdns::msdkdns_entry_view &view) {
+    uint8_t type = 0;
+    if (!MSDKDnsCacheReadByte(reader, &type)) {
+        return nil;
+    }
+    switch (type) {
+        case kMSDKDnsCacheValueDecimal: {
+            uint32_t number = 0;
+            return MSDKDnsCacheReadUInt32(reader, &number) ? [NSString stringWithFormat:@"%u", number] : nil;
+        }
+        case kMSDKDnsCacheValueAtom: {
+            uint8_t atom = 0;
+            if (!MSDKDnsCacheReadByte(reader, &atom) || atom >= view.atom_count) {
+                return nil;
+            }
+            size_t length = 0;
+            const char * text = store->AtomText(view.atoms[atom], &length);
+            return text ? [[NSString alloc] initWithBytes:text length:length encoding:NSUTF8StringEncoding] : nil;
+        }
+        case kMSDKDnsCacheValueInteger: {
+            uint32_t number = 0;
+            return MSDKDnsCacheReadUInt32(reader, &number) ? @((int32_t)number) : nil;
+        }
+        case kMSDKDnsCacheValueIPs:
+            return MSDKDnsCacheDecodeIPs(reader);
+        default:
+            return nil;
+    }
+}
+
+// 需在分片锁内调用
+static NSDictionary *MSDKDnsCacheDecode(const msdkdns::EntryStore *store, const msdkdns::msdkdns_entry_view &view) {
+    MSDKDnsCacheReader reader = {view.payload, view.payload_length, 0};
+    uint8_t format = 0;
+    if (!MSDKDnsCacheReadByte(&reader, &format)) {
+        return nil;
+    }
+    if (format == kMSDKDnsCacheFormatPlist) {
+        NSData * data = [NSData dataWithBytes:view.payload + 1 length:view.payload_length - 1];
+        id info = [NSPropertyListSerialization propertyListWithData:data
+                                                            options:NSPropertyListImmutable
+                                                             format:NULL
+                                                              error:NULL];
+        return [info isKindOfClass:[NSDictionary class]] ? info : nil;
+    }
+    size_t sectionKeyCount = sizeof(kMSDKDnsCacheSectionKeys) / sizeof(kMSDKDnsCacheSectionKeys[0]);
+    size_t fieldKeyCount = sizeof(kMSDKDnsCacheFieldKeys) / sizeof(kMSDKDnsCacheFieldKeys[0]);
+    uint8_t sectionCount = 0;
+    if (format != kMSDKDnsCacheFormatCompact || !MSDKDnsCacheReadByte(&reader, &sectionCount)) {
+        return nil;
+    }
+    NSMutableDictionary * info = [NSMutableDictionary dictionaryWithCapacity:sectionCount];
+    for (uint8_t i = 0; i < sectionCount; i++) {
+        uint8_t sectionIndex = 0;
+        uint8_t fieldCount = 0;
+        if (!MSDKDnsCacheReadByte(&reader, &sectionIndex) || sectionIndex >= sectionKeyCount ||
+            !MSDKDnsCacheReadByte(&reader, &fieldCount)) {
+            return nil;
+        }
+        NSMutableDictionary * section = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+        for (uint8_t j = 0; j < fieldCount; j++) {
+            uint8_t fieldIndex = 0;
+            if (!MSDKDnsCacheReadByte(&reader, &fieldIndex) || fieldIndex >= fieldKeyCount) {
+                return nil;
+            }
+            id value = MSDKDnsCacheDecodeValue(&reader, store, view);
+            if (!value) {
+                return nil;
+            }
+            section[kMSDKDnsCacheFieldKeys[fieldIndex]] = value;
+        }
+        info[kMSDKDnsCacheSectionKeys[sectionIndex]] = section;
+    }
+    return info;
+}
+
+typedef struct MSDKDnsDomainCacheMeta {
+    uint8_t flags;
+    int64_t beginTime;    // 写入时间，单调时钟，单位ms
+    int64_t expiredTime;  // 单调时钟，单位ms
+} MSDKDnsDomainCacheMeta;
+
+// 写入时将 kTTLExpired 字符串解析为单调时钟截止时间，查询时由缓存与当前时间比较
+static MSDKDnsDomainCacheMeta MSDKDnsDomainCacheMetaFromInfo(NSDictionary *info) {
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    MSDKDnsDomainCacheMeta meta = {0, now, 0};
+    NSDictionary * cacheDict = info[kMSDKHttpDnsCache_A];
+    if (!cacheDict || ![cacheDict isKindOfClass:[NSDictionary class]]) {
+        cacheDict = info[kMSDKHttpDnsCache_4A];
+    }
+    if (cacheDict && [cacheDict isKindOfClass:[NSDictionary class]]) {
+        meta.flags = msdkdns::MSDKDNS_EEntryFlag_HttpDns;
+        // kTTLExpired 为墙上时间，换算为单调时钟，避免系统时间修改影响
+        double ttlExpired = [cacheDict[kTTLExpired] doubleValue];
+        double remain = ttlExpired - [[NSDate date] timeIntervalSince1970];
+        meta.expiredTime = now + (int64_t)(remain * 1000);
+        if (meta.expiredTime <= now) {
+            meta.flags |= msdkdns::MSDKDNS_EEntryFlag_Expired;
+        }
+    }
+    return meta;
+}
+
+typedef struct MSDKDnsDomainCacheFound {
+    MSDKDnsDomainCacheMeta *meta;
+    BOOL decode;
+    NSDictionary *info;
+} MSDKDnsDomainCacheFound;
+
+static void MSDKDnsDomainCacheVisitFound(const msdkdns::EntryStore *store, const msdkdns::msdkdns_entry_view &view,
+                                         void *context) {
+    MSDKDnsDomainCacheFound * found = (MSDKDnsDomainCacheFound *)context;
+    found->meta->flags = view.flags;
+    found->meta->beginTime = view.begin_ms;
+    found->meta->expiredTime = view.expired_ms;
+    if (found->decode && !(view.flags & msdkdns::MSDKDNS_EEntryFlag_Removed)) {
+        found->info = MSDKDnsCacheDecode(store, view);
+    }
+}
+
+static void MSDKDnsDomainCacheVisitEntry(const msdkdns::EntryStore *store, const msdkdns::msdkdns_entry_view &view,
+                                         void *context) {
+    if (view.flags & msdkdns::MSDKDNS_EEntryFlag_Removed) {
+        return;
+    }
+    NSMutableDictionary * result = (__bridge NSMutableDictionary *)context;
+    size_t length = 0;
+    const char * text = msdkdns::msdkdns_domain_interner()->Text(view.domain, &length);
+    NSString * domain = text ? [[NSString alloc] initWithBytes:text length:length encoding:NSUTF8StringEncoding] : nil;
+    NSDictionary * info = MSDKDnsCacheDecode(store, view);
+    if (domain && info) {
+        result[domain] = info;
+    }
+}
+
+typedef struct MSDKDnsDomainCacheAttach {
+    __unsafe_unretained MSDKDnsDomainCache *cache;
+    __unsafe_unretained MSDKDnsSnapshot *snapshot;
+    BOOL attached;
+} MSDKDnsDomainCacheAttach;
+
+// 溢出表条目，info 为写入时的拷贝
+@interface MSDKDnsDomainCacheOverflowEntry : NSObject {
+@public
+    MSDKDnsDomainCacheMeta meta;
+}
+@property (strong, nonatomic) NSDictionary * info;
+@end
+
+@implementation MSDKDnsDomainCacheOverflowEntry
+@end
+
+@interface MSDKDnsDomainCache () {
+    // 溢出表以小写域名字符串为键，_overflow 和 _overflowOrder 在 _overflowLock 内访问
+    pthread_mutex_t _overflowLock;
+    NSMutableDictionary * _overflow;
+    NSMutableArray * _overflowOrder;
+    // 溢出表条目数，无锁读取，为0时跳过溢出表
+    uint32_t _overflowCount;
+}
+
+// 在共用存储中区分各缓存实例（如不同网络的分区）的条目
+@property (assign, nonatomic) uint32_t partition;
+@property (strong, atomic) MSDKDnsSnapshot * snapshot;
+
+@end
+
+// 在写锁内确认快照仍挂载，与 removeAllObjects 先卸载快照再清空分片配合，不会在清空后写回旧结果
+static bool MSDKDnsDomainCacheAdmitSnapshot(void *context) {
+    MSDKDnsDomainCacheAttach * attach = (MSDKDnsDomainCacheAttach *)context;
+    attach->attached = attach->snapshot == attach->cache.snapshot;
+    return attach->attached;
+}
+
+@implementation MSDKDnsDomainCache
+
++ (void)setMemoryBudget:(NSUInteger)bytes {
+    msdkdns::msdkdns_domain_cache()->SetBudget(MAX(bytes, (NSUInteger)MSDKDNS_DOMAIN_CACHE_MIN_BUDGET));
+}
+
++ (NSDictionary *)statistics {
+    msdkdns::msdkdns_entry_stats total;
+    msdkdns::msdkdns_domain_cache()->Stats(&total);
+    return @{
+        @"cacheHits": @(total.hits),
+        @"cacheMisses": @(total.misses),
+        @"cacheEvictions": @(total.evictions),
+        @"cacheRejected": @(total.rejected),
+        @"cacheEntries": @(total.entries),
+        @"cacheBytesUsed": @(total.bytes_used),
+        @"cacheBytesReserved": @(total.bytes_reserved),
+        @"cacheBudget": @(total.budget),
+    };
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _partition = msdkdns::msdkdns_domain_cache()->NewPartition();
+        pthread_mutex_init(&_overflowLock, NULL);
+        _overflow = [NSMutableDictionary dictionary];
+        _overflowOrder = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    msdkdns::msdkdns_domain_cache()->RemovePartition(_partition);
+    pthread_mutex_destroy(&_overflowLock);
+}
+
+// 写入时加入驻留表，读取时只查找；未驻留过的域名只可能在溢出表中
+- (BOOL)domainKey:(msdkdns::msdkdns_domain_key *)key forDomain:(NSString *)domain intern:(BOOL)intern {
+    const char * text = [domain UTF8String];
+    if (!text) {
+        return NO;
+    }
+    msdkdns::DomainInterner * interner = msdkdns::msdkdns_domain_interner();
+    return intern ? interner->Intern(text, strlen(text), key) : interner->Find(text, strlen(text), key);
+}
+
+#pragma mark 溢出表
+
+- (BOOL)findOverflowDomain:(NSString *)domain meta:(MSDKDnsDomainCacheMeta *)meta info:(NSDictionary **)info {
+    if (__atomic_load_n(&_overflowCount, __ATOMIC_ACQUIRE) == 0) {
+        return NO;
+    }
+    NSString * name = [domain lowercaseString];
+    pthread_mutex_lock(&_overflowLock);
+    MSDKDnsDomainCacheOverflowEntry * entry = _overflow[name];
+    if (entry) {
+        *meta = entry->meta;
+        if (info) {
+            *info = entry.info;
+        }
+    }
+    pthread_mutex_unlock(&_overflowLock);
+    if (!entry) {
+        return NO;
+    }
+    // 与缓存相同，读取时比较截止时间
+    if ((meta->flags & msdkdns::MSDKDNS_EEntryFlag_HttpDns) && meta->expiredTime <= msdkdns::msdkdns_monotonic_ms()) {
+        meta->flags |= msdkdns::MSDKDNS_EEntryFlag_Expired;
+    }
+    return YES;
+}
+
+// snapshot 不为 nil 时只在域名不存在且快照仍挂载时写入，返回快照是否仍挂载
+- (BOOL)putOverflowDomain:(NSString *)domain
+                     meta:(MSDKDnsDomainCacheMeta)meta
+                     info:(NSDictionary *)info
+                 snapshot:(MSDKDnsSnapshot *)snapshot {
+    NSString * name = [domain lowercaseString];
+    MSDKDnsDomainCacheOverflowEntry * entry = [[MSDKDnsDomainCacheOverflowEntry alloc] init];
+    entry->meta = meta;
+    entry.info = [info copy];
+    BOOL attached = YES;
+    pthread_mutex_lock(&_overflowLock);
+    BOOL exists = _overflow[name] != nil;
+    if (snapshot) {
+        attached = snapshot == self.snapshot;
+    }
+    if (!exists && attached) {
+        if (_overflowOrder.count >= MSDKDNS_DOMAIN_CACHE_OVERFLOW_CAPACITY) {
+            [_overflow removeObjectForKey:_overflowOrder[0]];
+            [_overflowOrder removeObjectAtIndex:0];
+        }
+        [_overflowOrder addObject:name];
+    }
+    if (attached && (!exists || !snapshot)) {
+        _overflow[name] = entry;
+    }
+    __atomic_store_n(&_overflowCount, (uint32_t)_overflow.count, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&_overflowLock);
+    return attached;
+}
+
+- (void)removeOverflowDomain:(NSString *)domain {
+    if (__atomic_load_n(&_overflowCount, __ATOMIC_ACQUIRE) == 0) {
+        return;
+    }
+    NSString * name = [domain lowercaseString];
+    pthread_mutex_lock(&_overflowLock);
+    if (_overflow[name]) {
+        [_overflow removeObjectForKey:name];
+        [_overflowOrder removeObject:name];
+    }
+    __atomic_store_n(&_overflowCount, (uint32_t)_overflow.count, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&_overflowLock);
+}
+
+- (void)removeAllOverflowDomains {
+    pthread_mutex_lock(&_overflowLock);
+    [_overflow removeAllObjects];
+    [_overflowOrder removeAllObjects];
+    __atomic_store_n(&_overflowCount, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&_overflowLock);
+}
+
+#pragma mark 查询
+
+// 只查询内存，info 不为 NULL 时解码为字典
+- (BOOL)findDomain:(NSString *)domain meta:(MSDKDnsDomainCacheMeta *)meta info:(NSDictionary **)info {
+    msdkdns::msdkdns_domain_key key;
+    if (![self domainKey:&key forDomain:domain intern:NO]) {
+        return [self findOverflowDomain:domain meta:meta info:info];
+    }
+    MSDKDnsDomainCacheFound found = {meta, info != NULL, nil};
+    if (!msdkdns::msdkdns_domain_cache()->Find(_partition, key, MSDKDnsDomainCacheVisitFound, &found)) {
+        return NO;
+    }
+    if (info) {
+        *info = found.info;
+    }
+    return YES;
+}
+
+// 未命中内存时从快照中读取并写入内存，返回是否有未删除的缓存
+- (BOOL)lookupDomain:(NSString *)domain meta:(MSDKDnsDomainCacheMeta *)meta info:(NSDictionary **)info {
+    if ([self findDomain:domain meta:meta info:info]) {
+        return !(meta->flags & msdkdns::MSDKDNS_EEntryFlag_Removed);
+    }
+    MSDKDnsSnapshot * snapshot = self.snapshot;
+    NSDictionary * snapshotInfo = [snapshot domainInfoForDomain:domain];
+    if (!snapshotInfo) {
+        return NO;
+    }
+    MSDKDnsDomainCacheMeta snapshotMeta = MSDKDnsDomainCacheMetaFromInfo(snapshotInfo);
+    msdkdns::msdkdns_domain_key key;
+    if (![self domainKey:&key forDomain:domain intern:YES]) {
+        // 无法驻留的域名写入溢出表，已有的以溢出表为准
+        if (![self putOverflowDomain:domain meta:snapshotMeta info:snapshotInfo snapshot:snapshot]) {
+            return NO;
+        }
+        return [self findOverflowDomain:domain meta:meta info:info] &&
+               !(meta->flags & msdkdns::MSDKDNS_EEntryFlag_Removed);
+    }
+    std::vector<std::string> atoms;
+    std::string payload;
+    BOOL encoded = MSDKDnsCacheEncode(snapshotInfo, &atoms, &payload);
+    // 读快照期间可能已写入新结果或被删除、清空，以内存为准
+    MSDKDnsDomainCacheAttach attach = {self, snapshot, NO};
+    BOOL current = NO;
+    if (encoded) {
+        current = msdkdns::msdkdns_domain_cache()->PutIfAbsent(_partition, key, snapshotMeta.beginTime,
+                                                              snapshotMeta.expiredTime, snapshotMeta.flags, atoms,
+                                                              (const uint8_t *)payload.data(), payload.size(),
+                                                              MSDKDnsDomainCacheAdmitSnapshot, &attach);
+    } else {
+        current = [self findDomain:domain meta:meta info:NULL];
+        attach.attached = snapshot == self.snapshot;
+    }
+    if (current) {
+        return [self lookupDomain:domain meta:meta info:info];
+    }
+    if (!attach.attached) {
+        return NO;
+    }
+    // 超过预算未能写入内存时直接使用快照中的结果
+    *meta = snapshotMeta;
+    if (info) {
+        *info = snapshotInfo;
+    }
+    return YES;
+}
+
+- (NSDictionary *)objectForKey:(NSString *)domain {
+    if (!domain || ![domain isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    MSDKDnsDomainCacheMeta meta;
+    NSDictionary * info = nil;
+    return [self lookupDomain:domain meta:&meta info:&info] ? info : nil;
+}
+
+- (NSDictionary *)objectForKeyedSubscript:(NSString *)domain {
+    return [self objectForKey:domain];
+}
+
+- (void)setObject:(NSDictionary *)domainInfo forKey:(NSString *)domain {
+    if (!domain || !domainInfo) {
+        return;
+    }
+    MSDKDnsDomainCacheMeta meta = MSDKDnsDomainCacheMetaFromInfo(domainInfo);
+    msdkdns::msdkdns_domain_key key;
+    if (![self domainKey:&key forDomain:domain intern:YES]) {
+        [self putOverflowDomain:domain meta:meta info:domainInfo snapshot:nil];
+        return;
+    }
+    // 在锁外编码，写锁内只拷贝到 arena
+    std::vector<std::string> atoms;
+    std::string payload;
+    BOOL encoded = MSDKDnsCacheEncode(domainInfo, &atoms, &payload);
+    if (encoded) {
+        msdkdns::msdkdns_domain_cache()->Put(_partition, key, meta.beginTime, meta.expiredTime, meta.flags,
+                                             atoms, (const uint8_t *)payload.data(), payload.size());
+    } else {
+        msdkdns::msdkdns_domain_cache()->Remove(_partition, key);
+    }
+}
+
+- (NSString *)cacheStatusForKey:(NSString *)domain {
+    if (!domain || ![domain isKindOfClass:[NSString class]]) {
+        return MSDKDnsDomainCacheEmpty;
+    }
+    MSDKDnsDomainCacheMeta meta;
+    if (![self lookupDomain:domain meta:&meta info:NULL] || !(meta.flags & msdkdns::MSDKDNS_EEntryFlag_HttpDns)) {
+        return MSDKDnsDomainCacheEmpty;
+    }
+    return (meta.flags & msdkdns::MSDKDNS_EEntryFlag_Expired) ? MSDKDnsDomainCacheExpired : MSDKDnsDomainCacheHit;
+}
+
+- (NSTimeInterval)timeToExpireForKey:(NSString *)domain {
+    if (!domain || ![domain isKindOfClass:[NSString class]]) {
+        return 0;
+    }
+    MSDKDnsDomainCacheMeta meta;
+    if (![self lookupDomain:domain meta:&meta info:NULL] || !(meta.flags & msdkdns::MSDKDNS_EEntryFlag_HttpDns)) {
+        return 0;
+    }
+    return (meta.expiredTime - msdkdns::msdkdns_monotonic_ms()) / 1000.0;
+}
+
+- (void)removeObjectForKey:(NSString *)domain {
+    if (!domain) {
+        return;
+    }
+    // 有快照时需写入占位条目，必须驻留；否则未驻留过的域名只可能在溢出表中
+    msdkdns::msdkdns_domain_key key;
+    if (![self domainKey:&key forDomain:domain intern:self.snapshot != nil]) {
+        if (self.snapshot) {
+            MSDKDnsDomainCacheMeta meta = {msdkdns::MSDKDNS_EEntryFlag_Removed, 0, 0};
+            [self putOverflowDomain:domain meta:meta info:nil snapshot:nil];
+        } else {
+            [self removeOverflowDomain:domain];
+        }
+        return;
+    }
+    if (self.snapshot) {
+        // 留下占位条目，避免之后又从快照中读出
+        msdkdns::msdkdns_domain_cache()->Put(_partition, key, 0, 0, msdkdns::MSDKDNS_EEntryFlag_Removed,
+                                             std::vector<std::string>(), NULL, 0);
+    } else {
+        msdkdns::msdkdns_domain_cache()->Remove(_partition, key);
+    }
+}
+
+- (void)removeAllObjects {
+    self.snapshot = nil;
+    msdkdns::msdkdns_domain_cache()->RemovePartition(_partition);
+    [self removeAllOverflowDomains];
+}
+
+- (NSUInteger)count {
+    if (self.snapshot) {
+        return [self dictionaryRepresentation].count;
+    }
+    NSUInteger count = msdkdns::msdkdns_domain_cache()->Count(_partition);
+    if (__atomic_load_n(&_overflowCount, __ATOMIC_ACQUIRE) > 0) {
+        pthread_mutex_lock(&_overflowLock);
+        for (NSString * name in _overflow) {
+            MSDKDnsDomainCacheOverflowEntry * entry = _overflow[name];
+            count += (entry->meta.flags & msdkdns::MSDKDNS_EEntryFlag_Removed) ? 0 : 1;
+        }
+        pthread_mutex_unlock(&_overflowLock);
+    }
+    return count;
+}
+
+- (void)attachSnapshot:(MSDKDnsSnapshot *)snapshot {
+    self.snapshot = snapshot;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    NSMutableDictionary * result = [NSMutableDictionary dictionary];
+    // 先读出快照中尚未加载的域名，超过预算未能写入内存的直接取快照中的结果
+    for (NSString * domain in [self.snapshot allDomains]) {
+        MSDKDnsDomainCacheMeta meta;
+        NSDictionary * info = nil;
+        if ([self lookupDomain:domain meta:&meta info:&info] && info) {
+            result[domain] = info;
+        }
+    }
+    msdkdns::msdkdns_domain_cache()->Entries(_partition, MSDKDnsDomainCacheVisitEntry, (__bridge void *)result);
+    pthread_mutex_lock(&_overflowLock);
+    for (NSString * name in _overflow) {
+        MSDKDnsDomainCacheOverflowEntry * entry = _overflow[name];
+        if (!(entry->meta.flags & msdkdns::MSDKDNS_EEntryFlag_Removed) && entry.info) {
+            result[name] = entry.info;
+        }
+    }
+    pthread_mutex_unlock(&_overflowLock);
+    return result;
+}
+
+@end
@@ -6,8 +6,10 @@
 #import <Foundation/Foundation.h>
 #import "MSDKDnsPrivate.h"
 #import "MSDKDns.h"
+#import "msdkdns_local_ip_stack.h"
 
 @class MSDKDnsService;
+@class MSDKDnsDomainCache;
 
 typedef enum {
     net_undetected = 0,
@@ -17,7 +19,8 @@ typedef enum {
 
 @interface MSDKDnsManager : NSObject
 
-@property (strong, nonatomic, readonly) NSMutableDictionary * domainDict;
+// 当前网络的缓存分区，网络切换时整体替换
+@property (strong, atomic, readonly) MSDKDnsDomainCache * domainDict;
 @property (assign, nonatomic, readonly) HttpDnsSdkStatus sdkStatus;
 
 + (instancetype)shareInstance;
@@ -32,19 +35,45 @@ typedef enum {
 - (void)clearCacheForDomain:(NSString *)domain;
 - (void)clearCacheForDomains:(NSArray<NSString *> *)domains;
 - (void)clearAllCache;
+/**
+ * 网络变化时切换到 network 对应的缓存分区，当前缓存按原网络保留，切回时恢复并批量重新解析其中的热点域名
+ * network 为 nil（无网络）时不切换；开启使用过期IP时各网络共用一份缓存，只记录网络标识
+ */
+- (void)switchCachePartitionToNetwork:(NSString *)network;
 - (BOOL)isOpenOptimismCache;
 - (NSDictionary *)getDnsDetail:(NSString *)domain;
 
+// 当前最优的服务IP，用于上报
 - (NSString *)currentDnsServer;
+// 为解析请求选择服务IP，可能是冷却结束后的探测请求
+- (NSString *)selectDnsServer;
+// 对冲请求使用的服务IP，没有其他可用服务IP时返回 nil
+- (NSString *)hedgeDnsServerExcluding:(NSString *)server;
 - (void)switchDnsServer;
 
-// 添加domain进入延迟记录字典里面
-- (void)msdkDnsAddDomainOpenDelayDispatch: (NSString *)domain;
+// 域名未开启延迟解析请求时记录标志并在 afterTime 秒后刷新，已开启则忽略；标志在域名所在的 lane 中读写
+- (void)msdkDnsOpenDelayDispatchForDomain:(NSString *)domain afterTime:(double)afterTime;
 - (void)msdkDnsClearDomainOpenDelayDispatch:(NSString *)domain;
 // 批量删除
 - (void)msdkDnsClearDomainsOpenDelayDispatch:(NSArray *)domains;
-- (NSMutableDictionary *)msdkDnsGetDomainISOpenDelayDispatch;
+// 通过时间轮调度域名缓存刷新，afterTime 单位秒
+- (void)msdkDnsScheduleRefreshForDomain:(NSString *)domain afterTime:(double)afterTime;
+// 是否为近期查询较多的热点域名，热点域名解析完成后与保活域名一样调度刷新
+- (BOOL)isHotDomain:(NSString *)domain;
 - (void)loadIPsFromPersistCacheAsync;
+// 请求合并统计：started 为实际发起解析的域名数，coalesced 为合并到在途请求上的域名数，
+// batches 为发出的合批请求数，batchedCalls 为与其他调用合批发出的调用数，
+// refreshAhead / refreshAheadSkipped 为自动刷新及超出预算未刷新的热点域名数
+// negativeFailures / negativeBlocked / negativeRecovered / negativeEntries 为负缓存记录的失败次数、
+// 退避期内直接返回的查询数、失败后恢复的次数和当前记录数，partition 开头的为按网络划分的缓存分区计数，
+// http 开头的为长连接池的计数，cache 开头的为域名缓存的命中、淘汰及内存占用
+- (NSDictionary *)msdkDnsGetRequestStatistics;
+// 按HTTPDNS解析结果更新负缓存，answered 为有解析结果的域名，需在 msdkdns_queue 中调用
+- (void)msdkDnsRecordResolveResultOfDomains:(NSArray *)domains
+                                   answered:(NSArray *)answered
+                                  errorCode:(NSString *)errorCode
+                                   netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack;
+- (void)clearNegativeCacheForDomains:(NSArray *)domains;
 /*
  * 获取底层配置
  */
@@ -56,4 +85,6 @@ typedef enum {
 - (int)getAddressType;
 
 - (void)enterBackgroundReportCacheData;
+// 立即推进刷新时间轮，用于回到前台：挂起期间计时器不触发，到期的刷新在此补上
+- (void)advanceRefreshTimer;
 @end
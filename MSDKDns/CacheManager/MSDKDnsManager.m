@@ -3,39 +3,84 @@
  */
 
 #import "MSDKDnsManager.h"
+#import "MSDKDnsDomainCache.h"
+#import "MSDKDnsCachePartitions.h"
+#import "MSDKDnsSingleFlight.h"
+#import "MSDKDnsBatchPlanner.h"
 #import "MSDKDnsService.h"
 #import "MSDKDnsLog.h"
 #import "MSDKDnsDB.h"
 #import "MSDKDnsInfoTool.h"
 #import "MSDKDnsParamsManager.h"
 #import "MSDKDnsNetworkManager.h"
+#import "MSDKDnsServerMonitor.h"
+#import "MSDKDnsHttpClient.h"
 #import "msdkdns_local_ip_stack.h"
+#import "msdkdns_timer_wheel.h"
+#import "msdkdns_domain_cache.h"
+#import "msdkdns_popularity.h"
+#import "msdkdns_negative_cache.h"
+#import "msdkdns_domain_interner.h"
+#import "msdkdns_ip.h"
 #import "AttaReport.h"
 #import <arpa/inet.h>
+#import <pthread.h>
 #if defined(__has_include)
     #if __has_include("httpdnsIps.h")
         #include "httpdnsIps.h"
     #endif
 #endif
 
-@interface MSDKDnsManager ()
+// 时间轮计时器的允许误差，单位ms
+static const int64_t kMSDKDnsRefreshTimerLeewayMs = 200;
+// 刷新时间随机提前的最大比例，避免大量域名同时刷新
+static const double kMSDKDnsRefreshJitterRatio = 0.1;
+// 刷新时间向前对齐到该粒度，相近时间到期的域名在同一tick触发，合并为一次请求，节省刷新预算
+static const int64_t kMSDKDnsRefreshAlignMs = 10 * 1000;
+// 访问频率统计的计数器宽度和衰减周期，估计值约为最近5~10分钟的查询次数
+static const size_t kMSDKDnsPopularityWidth = 4096;
+static const int64_t kMSDKDnsPopularityDecayMs = 5 * 60 * 1000;
+// 估计查询次数达到该值的域名视为热点域名，在TTL过期前自动刷新
+static const uint32_t kMSDKDnsHotDomainThreshold = 4;
+// 负缓存最多记录的域名和查询类型组合数
+static const size_t kMSDKDnsNegativeCacheMaxEntries = 1024;
+// 合批后逗号拼接的域名串最大长度，加密后约为两倍，避免请求URL过长
+static const NSUInteger kMSDKDnsBatchMaxQueryLength = 1024;
+// 最多保留的非当前网络的缓存分区数
+static const NSUInteger kMSDKDnsCachePartitionCapacity = 4;
+
+@interface MSDKDnsManager () {
+    msdkdns::PopularitySketch * _popularity; // 查询路径上可能并发访问，由 _popularityLock 保护
+    msdkdns::RefreshBudget * _refreshBudget; // 仅在 msdkdns_queue 中访问
+    pthread_mutex_t _popularityLock;
+    msdkdns::NegativeCache * _negativeCache; // 仅在 msdkdns_queue 中访问
+    pthread_mutex_t _reportLock; // 上报在各域名的 lane 中并发执行，保护 cacheDomainCountDict
+}
 
 @property (strong, nonatomic, readwrite) NSMutableArray * serviceArray;
-@property (strong, nonatomic, readwrite) NSMutableDictionary * domainDict;
-@property (nonatomic, assign, readwrite) int serverIndex;
+@property (strong, atomic, readwrite) MSDKDnsDomainCache * domainDict;
+@property (strong, nonatomic) MSDKDnsCachePartitions * cachePartitions; // 仅在 msdkdns_queue 中访问
+@property (copy, nonatomic) NSString * networkIdentity; // 当前缓存分区所属的网络，仅在 msdkdns_queue 中访问
+@property (strong, nonatomic) MSDKDnsSingleFlight * singleFlight; // 合并相同域名的在途请求
+@property (strong, nonatomic) MSDKDnsBatchPlanner * batchPlanner; // 合并不同调用的未命中域名为一次请求
 @property (nonatomic, assign, readwrite) int startServerIndex;
 @property (nonatomic, assign, readwrite) BOOL waitToSwitch; // 防止连续多次切换
 @property (strong, nonatomic) dispatch_source_t retryTimer; //防止生成多个延时任务
+@property (strong, nonatomic) dispatch_source_t refreshTimer; // 驱动缓存的时间轮，仅在 msdkdns_queue 中访问
 @property (nonatomic, assign, readwrite) BOOL waitToSwitchStartServer; // 防止连续多次切换启动服务ip
 @property (nonatomic, assign, readwrite) int fetchConfigFailCount;
 
-// 延迟记录字典，记录哪些域名已经开启了延迟解析请求
-@property (strong, nonatomic, readwrite) NSMutableDictionary* domainISOpenDelayDispatch;
+// 已开启延迟解析请求的域名，下标为域名所在的 lane，每个集合只在所属 lane 中访问
+@property (strong, nonatomic) NSArray * delayDispatchLanes;
 @property (nonatomic, assign, readwrite) HttpDnsSdkStatus sdkStatus;
 @property (nonatomic, strong, readwrite) NSArray * dnsServers;
 @property (nonatomic, strong, readwrite) NSArray * dnsStartServers;
 @property (strong, nonatomic) NSMutableURLRequest *request;
 @property (strong, nonatomic, readwrite) NSMutableDictionary * cacheDomainCountDict;
+@property (assign, nonatomic) NSUInteger refreshAheadCount; // 自动刷新的热点域名数，仅在 msdkdns_queue 中访问
+@property (assign, nonatomic) NSUInteger refreshAheadSkippedCount; // 超出预算未刷新的热点域名数，仅在 msdkdns_queue 中访问
+
+- (void)armRefreshTimerAt:(int64_t)deadline;
 
 @end
 
@@ -44,7 +89,6 @@
 - (void)dealloc {
     if (_domainDict) {
         [self.domainDict removeAllObjects];
-        [self setDomainDict:nil];
     }
     if (_serviceArray) {
         [self.serviceArray removeAllObjects];
@@ -54,11 +98,29 @@
         [self.cacheDomainCountDict removeAllObjects];
         [self setCacheDomainCountDict:nil];
     }
+    if (_refreshTimer) {
+        dispatch_source_cancel(_refreshTimer);
+    }
+    delete _popularity;
+    _popularity = NULL;
+    delete _refreshBudget;
+    _refreshBudget = NULL;
+    pthread_mutex_destroy(&_popularityLock);
+    pthread_mutex_destroy(&_reportLock);
+    delete _negativeCache;
+    _negativeCache = NULL;
 }
 
 #pragma mark - init
 
 static MSDKDnsManager * gSharedInstance = nil;
+
+static void MSDKDnsRefreshWakeup(int64_t deadline, void *context) {
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        [[MSDKDnsManager shareInstance] armRefreshTimerAt:deadline];
+    });
+}
+
 + (instancetype)shareInstance {
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
@@ -69,14 +131,34 @@ static MSDKDnsManager * gSharedInstance = nil;
 
 - (instancetype) init {
     if (self = [super init]) {
-        _serverIndex = 0;
         _waitToSwitch = NO;
         _serviceArray = [[NSMutableArray alloc] init];
+        _domainDict = [[MSDKDnsDomainCache alloc] init];
+        _cachePartitions = [[MSDKDnsCachePartitions alloc] initWithCapacity:kMSDKDnsCachePartitionCapacity];
+        _singleFlight = [[MSDKDnsSingleFlight alloc] init];
+        NSMutableArray * delayDispatchLanes = [NSMutableArray array];
+        for (NSUInteger i = 0; i < [MSDKDnsInfoTool msdkdns_lane_count]; i++) {
+            [delayDispatchLanes addObject:[NSMutableSet set]];
+        }
+        _delayDispatchLanes = delayDispatchLanes;
+        __weak __typeof__(self) weakSelf = self;
+        _batchPlanner = [[MSDKDnsBatchPlanner alloc] initWithQueue:[MSDKDnsInfoTool msdkdns_queue]
+                                                      flushHandler:^(NSArray *domains, msdkdns::MSDKDNS_TLocalIPStack netStack, NSString *routeIp, NSString *origin, float timeOut, void (^done)(void)) {
+            [weakSelf startServiceWithDomains:domains netStack:netStack from:origin timeOut:timeOut completion:done];
+        }];
         _sdkStatus = net_undetected;
-        _dnsServers = [self defaultServers];
+        self.dnsServers = [self defaultServers];
         _dnsStartServers = [self defaultStartServers];
         _fetchConfigFailCount = 0;
         _cacheDomainCountDict = [[NSMutableDictionary alloc] init];
+        int64_t now = msdkdns::msdkdns_monotonic_ms();
+        _popularity = new msdkdns::PopularitySketch(kMSDKDnsPopularityWidth, kMSDKDnsPopularityDecayMs, now);
+        _refreshBudget = new msdkdns::RefreshBudget((uint32_t)[[MSDKDnsParamsManager shareInstance] msdkDnsGetRefreshAheadBudget], now);
+        pthread_mutex_init(&_popularityLock, NULL);
+        pthread_mutex_init(&_reportLock, NULL);
+        _negativeCache = new msdkdns::NegativeCache(kMSDKDnsNegativeCacheMaxEntries, arc4random());
+        // 提前刷新由缓存的时间轮驱动，有更早的到期时间时重新设置计时器；过期在查询时判断，不依赖计时器
+        msdkdns::msdkdns_domain_cache()->SetWakeup(MSDKDnsRefreshWakeup, NULL);
         
         MSDKDNSLOG("开始读取现有存储的ipList");
         
@@ -137,14 +219,9 @@ static MSDKDnsManager * gSharedInstance = nil;
 - (NSDictionary *)getHostsByNames:(NSArray *)domains verbose:(BOOL)verbose {
     // 获取当前ipv4/ipv6/双栈网络环境
     msdkdns::MSDKDNS_TLocalIPStack netStack = [self detectAddressType];
-    __block float timeOut = 2.0;
-    __block NSDictionary * cacheDomainDict = nil;
-    dispatch_sync([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (domains && [domains count] > 0 && _domainDict) {
-            cacheDomainDict = [[NSDictionary alloc] initWithDictionary:_domainDict];
-        }
-        timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
-    });
+    float timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
+    // 缓存支持并发读，直接查询，无需拷贝
+    MSDKDnsDomainCache * cacheDomainDict = self.domainDict;
     // 待查询数组
     NSArray *toCheckDomains = [self getCheckDomains:domains dict:cacheDomainDict netStack:netStack];
     // 全部有缓存时，直接返回
@@ -157,33 +234,20 @@ static MSDKDnsManager * gSharedInstance = nil;
     }
     dispatch_semaphore_t sema = dispatch_semaphore_create(0);
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
-        int dnsId = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsId];
-        NSString * dnsKey = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsKey];
-        if (!self.serviceArray) {
-            self.serviceArray = [[NSMutableArray alloc] init];
-        }
-        HttpDnsEncryptType encryptType = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEncryptType];
-        MSDKDnsService * dnsService = [[MSDKDnsService alloc] init];
-        [self.serviceArray addObject:dnsService];
         __weak __typeof__(self) weakSelf = self;
-        [dnsService getHostsByNames:toCheckDomains timeOut:timeOut dnsId:dnsId dnsKey:dnsKey netStack:netStack encryptType:encryptType returnIps:^() {
+        [self resolveDomains:toCheckDomains timeOut:timeOut netStack:netStack from:MSDKDnsEventHttpDnsNormal completion:^{
             __strong __typeof(self) strongSelf = weakSelf;
             if (strongSelf) {
                 [toCheckDomains enumerateObjectsUsingBlock:^(id _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
-                    [strongSelf uploadReport:NO domain:obj netStack:netStack];
+                    [MSDKDnsInfoTool msdkdns_async:obj block:^{
+                        [strongSelf uploadReport:NO domain:obj netStack:netStack];
+                    }];
                 }];
-                [strongSelf dnsHasDone:dnsService];
             }
             dispatch_semaphore_signal(sema);
         }];
     });
     dispatch_semaphore_wait(sema, dispatch_time(DISPATCH_TIME_NOW, timeOut * NSEC_PER_SEC));
-    cacheDomainDict = nil;
-    dispatch_sync([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (domains && [domains count] > 0 && _domainDict) {
-            cacheDomainDict = [[NSDictionary alloc] initWithDictionary:_domainDict];
-        }
-    });
     NSDictionary * result = verbose?
     [self fullResultDictionary:domains fromCache:cacheDomainDict] :
     [self resultDictionary:domains fromCache:cacheDomainDict];
@@ -194,14 +258,9 @@ static MSDKDnsManager * gSharedInstance = nil;
 - (NSDictionary *)getHostsByNamesEnableExpired:(NSArray *)domains verbose:(BOOL)verbose {
     // 获取当前ipv4/ipv6/双栈网络环境
     msdkdns::MSDKDNS_TLocalIPStack netStack = [self detectAddressType];
-    __block float timeOut = 2.0;
-    __block NSDictionary * cacheDomainDict = nil;
-    dispatch_sync([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (domains && [domains count] > 0 && _domainDict) {
-            cacheDomainDict = [[NSDictionary alloc] initWithDictionary:_domainDict];
-        }
-        timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
-    });
+    float timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
+    // 缓存支持并发读，直接查询，无需拷贝
+    MSDKDnsDomainCache * cacheDomainDict = self.domainDict;
     // 待查询数组
     NSMutableArray *toCheckDomains = [NSMutableArray array];
     // 需要排除结果的域名数组
@@ -217,31 +276,24 @@ static MSDKDnsManager * gSharedInstance = nil;
             [toEmptyDomains addObject:domain];
         } else {
             MSDKDNSLOG(@"%@ TTL has not expiried,return result from cache directly!", domain);
-            dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+            [MSDKDnsInfoTool msdkdns_async:domain block:^{
                 [self uploadReport:YES domain:domain netStack:netStack];
-            });
+            }];
         }
     }
     // 当待查询数组中存在数据的时候，就开启异步线程执行解析操作，并且更新缓存
     if (toCheckDomains && [toCheckDomains count] != 0) {
         dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
-            if (!self.serviceArray) {
-                self.serviceArray = [[NSMutableArray alloc] init];
-            }
-            int dnsId = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsId];
-            NSString * dnsKey = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsKey];
-            HttpDnsEncryptType encryptType = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEncryptType];
-            MSDKDnsService * dnsService = [[MSDKDnsService alloc] init];
-            [self.serviceArray addObject:dnsService];
             __weak __typeof__(self) weakSelf = self;
             //进行httpdns请求
-            [dnsService getHostsByNames:toCheckDomains timeOut:timeOut dnsId:dnsId dnsKey:dnsKey netStack:netStack encryptType:encryptType from:MSDKDnsEventHttpDnsExpiredAsync returnIps:^{
+            [self resolveDomains:toCheckDomains timeOut:timeOut netStack:netStack from:MSDKDnsEventHttpDnsExpiredAsync completion:^{
                 __strong __typeof(self) strongSelf = weakSelf;
                 if (strongSelf) {
                     [toCheckDomains enumerateObjectsUsingBlock:^(id _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
-                        [strongSelf uploadReport:NO domain:obj netStack:netStack];
+                        [MSDKDnsInfoTool msdkdns_async:obj block:^{
+                            [strongSelf uploadReport:NO domain:obj netStack:netStack];
+                        }];
                     }];
-                    [strongSelf dnsHasDone:dnsService];
                 }
             }];
         });
@@ -315,14 +367,9 @@ static MSDKDnsManager * gSharedInstance = nil;
               returnIps:(void (^)(NSDictionary * ipsDict))handler {
     // 获取当前ipv4/ipv6/双栈网络环境
     msdkdns::MSDKDNS_TLocalIPStack netStack = [self detectAddressType];
-    __block float timeOut = 2.0;
-    __block NSDictionary * cacheDomainDict = nil;
-    dispatch_sync([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (domains && [domains count] > 0 && _domainDict) {
-            cacheDomainDict = [[NSDictionary alloc] initWithDictionary:_domainDict];
-        }
-        timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
-    });
+    float timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
+    // 缓存支持并发读，直接查询，无需拷贝
+    MSDKDnsDomainCache * cacheDomainDict = self.domainDict;
     // 待查询数组
     NSArray *toCheckDomains = [self getCheckDomains:domains dict:cacheDomainDict netStack:netStack];
     // 全部有缓存时，直接返回
@@ -336,23 +383,16 @@ static MSDKDnsManager * gSharedInstance = nil;
         return;
     }
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (!self.serviceArray) {
-            self.serviceArray = [[NSMutableArray alloc] init];
-        }
-        int dnsId = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsId];
-        NSString * dnsKey = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsKey];
-        //进行httpdns请求
-        MSDKDnsService * dnsService = [[MSDKDnsService alloc] init];
-        [self.serviceArray addObject:dnsService];
         __weak __typeof__(self) weakSelf = self;
-        HttpDnsEncryptType encryptType = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEncryptType];
-        [dnsService getHostsByNames:toCheckDomains timeOut:timeOut dnsId:dnsId dnsKey:dnsKey netStack:netStack encryptType:encryptType from:origin returnIps:^() {
+        //进行httpdns请求
+        [self resolveDomains:toCheckDomains timeOut:timeOut netStack:netStack from:origin completion:^{
             __strong __typeof(self) strongSelf = weakSelf;
             if (strongSelf) {
                 [toCheckDomains enumerateObjectsUsingBlock:^(id _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
-                    [strongSelf uploadReport:NO domain:obj netStack:netStack];
+                    [MSDKDnsInfoTool msdkdns_async:obj block:^{
+                        [strongSelf uploadReport:NO domain:obj netStack:netStack];
+                    }];
                 }];
-                [strongSelf dnsHasDone:dnsService];
                 NSDictionary * result = verbose ?
                 [strongSelf fullResultDictionary:domains fromCache:self.domainDict] :
                 [strongSelf resultDictionary:domains fromCache:self.domainDict];
@@ -365,7 +405,7 @@ static MSDKDnsManager * gSharedInstance = nil;
     
 }
 
-- (NSArray *)getCheckDomains:(NSArray *)domains dict:(NSDictionary *)cacheDomainDict netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack {
+- (NSArray *)getCheckDomains:(NSArray *)domains dict:(MSDKDnsDomainCache *)cacheDomainDict netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack {
     // 待查询数组
     NSMutableArray *toCheckDomains = [NSMutableArray array];
     // 查找缓存，缓存中有HttpDns数据且ttl未超时则直接返回结果,不存在或者ttl超时则放入待查询数组
@@ -375,9 +415,9 @@ static MSDKDnsManager * gSharedInstance = nil;
             [toCheckDomains addObject:domain];
         } else {
             MSDKDNSLOG(@"%@ TTL has not expiried,return result from cache directly!", domain);
-            dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+            [MSDKDnsInfoTool msdkdns_async:domain block:^{
                 [self uploadReport:YES domain:domain netStack:netStack];
-            });
+            }];
         }
     }
     return toCheckDomains;
@@ -390,21 +430,185 @@ static MSDKDnsManager * gSharedInstance = nil;
     msdkdns::MSDKDNS_TLocalIPStack netStack = [self detectAddressType];
     __block float timeOut = 2.0;
     timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
-    //进行httpdns请求
+    //进行httpdns请求，已有在途请求的域名不再重复刷新
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        [self resolveDomains:domains timeOut:timeOut netStack:netStack from:MSDKDnsEventHttpDnsAutoRefresh completion:^{
+            if(needClear){
+                // 当请求结束了需要将该域名开启的标志清除，方便下次继续开启延迟解析请求
+                // NSLog(@"延时更新请求结束!请求域名为%@",domains);
+                [self msdkDnsClearDomainsOpenDelayDispatch:domains];
+            }
+        }];
+    });
+}
+
+#pragma mark 合并在途请求
+
+// 需在 msdkdns_queue 中调用。已有在途请求的域名挂到该请求上，其余域名进入合批，全部结束后在 msdkdns_queue 回调
+- (void)resolveDomains:(NSArray *)domains
+               timeOut:(float)timeOut
+              netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+                  from:(NSString *)origin
+            completion:(void (^)(void))handler {
+    // routeIp 需与结束时使用的保持一致，否则等待方无法被唤醒
+    NSString * routeIp = [[MSDKDnsParamsManager shareInstance] msdkDnsGetRouteIp] ?: @"";
+    dispatch_group_t group = dispatch_group_create();
+    // 退避期内的失败域名直接按无结果返回，不再发出请求
+    NSArray * candidates = [self domainsOutOfNegativeCache:domains netStack:netStack];
+    // 在途请求表在各域名的 lane 中登记，登记完后回到 msdkdns_queue 合批
+    dispatch_group_enter(group);
+    __weak __typeof__(self) weakSelf = self;
+    [self.singleFlight joinDomains:candidates netStack:netStack routeIp:routeIp group:group completion:^(NSArray *startDomains) {
+        __strong __typeof__(weakSelf) strongSelf = weakSelf;
+        if (strongSelf && startDomains.count > 0) {
+            dispatch_group_enter(group);
+            MSDKDnsParamsManager * params = [MSDKDnsParamsManager shareInstance];
+            strongSelf.batchPlanner.windowMs = [params msdkDnsGetBatchWindow];
+            strongSelf.batchPlanner.maxDomains = [params msdkDnsGetBatchMaxDomains];
+            strongSelf.batchPlanner.maxQueryLength = kMSDKDnsBatchMaxQueryLength;
+            [strongSelf.batchPlanner addDomains:startDomains netStack:netStack routeIp:routeIp from:origin timeOut:timeOut completion:^{
+                [weakSelf.singleFlight completeDomains:startDomains netStack:netStack routeIp:routeIp];
+                dispatch_group_leave(group);
+            }];
+        }
+        dispatch_group_leave(group);
+    }];
+    dispatch_group_notify(group, [MSDKDnsInfoTool msdkdns_queue], ^{
+        if (handler) {
+            handler();
+        }
+    });
+}
+
+// 合批发出时调用，在 msdkdns_queue 中执行，timeOut 为批次内调用方剩余时间的最小值
+- (void)startServiceWithDomains:(NSArray *)domains
+                       netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+                           from:(NSString *)origin
+                        timeOut:(float)timeOut
+                     completion:(void (^)(void))handler {
+    if (!self.serviceArray) {
+        self.serviceArray = [[NSMutableArray alloc] init];
+    }
     int dnsId = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsId];
     NSString * dnsKey = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsKey];
     HttpDnsEncryptType encryptType = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEncryptType];
-    
     MSDKDnsService * dnsService = [[MSDKDnsService alloc] init];
-    [dnsService getHostsByNames:domains timeOut:timeOut dnsId:dnsId dnsKey:dnsKey netStack:netStack encryptType:encryptType from:MSDKDnsEventHttpDnsAutoRefresh returnIps:^{
-        if(needClear){
-            // 当请求结束了需要将该域名开启的标志清除，方便下次继续开启延迟解析请求
-            // NSLog(@"延时更新请求结束!请求域名为%@",domains);
-            [self msdkDnsClearDomainsOpenDelayDispatch:domains];
+    [self.serviceArray addObject:dnsService];
+    __weak __typeof__(self) weakSelf = self;
+    [dnsService getHostsByNames:domains timeOut:timeOut dnsId:dnsId dnsKey:dnsKey netStack:netStack encryptType:encryptType from:origin returnIps:^{
+        [weakSelf dnsHasDone:dnsService];
+        if (handler) {
+            handler();
         }
     }];
 }
 
+- (NSDictionary *)msdkDnsGetRequestStatistics {
+    // 负缓存、合并请求、分区和自动刷新的计数都只在 msdkdns_queue 中修改，在其中一次取出，各项互相一致
+    __block NSMutableDictionary *statistics = nil;
+    [MSDKDnsInfoTool msdkdns_queue_sync:^{
+        msdkdns::msdkdns_negative_stats negativeStats;
+        self->_negativeCache->Stats(&negativeStats);
+        statistics = [NSMutableDictionary dictionaryWithDictionary:@{
+            @"started": @(self.singleFlight.startedCount),
+            @"coalesced": @(self.singleFlight.coalescedCount),
+            @"batches": @(self.batchPlanner.flushedBatchCount),
+            @"batchedCalls": @(self.batchPlanner.mergedCallCount),
+            @"refreshAhead": @(self.refreshAheadCount),
+            @"refreshAheadSkipped": @(self.refreshAheadSkippedCount),
+            @"negativeFailures": @(negativeStats.failures),
+            @"negativeBlocked": @(negativeStats.blocked),
+            @"negativeRecovered": @(negativeStats.recovered),
+            @"negativeEntries": @(negativeStats.entries),
+            @"partitionRestored": @(self.cachePartitions.restoredCount),
+            @"partitionMissed": @(self.cachePartitions.missedCount),
+            @"partitionEvicted": @(self.cachePartitions.evictedCount),
+        }];
+    }];
+    // 以下两项内部加锁，不需要在 msdkdns_queue 中读取
+    [statistics addEntriesFromDictionary:[[MSDKDnsHttpClient shareInstance] summary]];
+    [statistics addEntriesFromDictionary:[MSDKDnsDomainCache statistics]];
+    return statistics;
+}
+
+#pragma mark 负缓存
+
+// intern 为 NO 时只查找，域名不合法或未驻留过时返回 NO
+static BOOL MSDKDnsFindDomainKey(NSString * domain, BOOL intern, msdkdns::msdkdns_domain_key * key) {
+    const char * text = [domain isKindOfClass:[NSString class]] ? [domain UTF8String] : NULL;
+    if (!text) {
+        return NO;
+    }
+    msdkdns::DomainInterner * interner = msdkdns::msdkdns_domain_interner();
+    return intern ? interner->Intern(text, strlen(text), key) : interner->Find(text, strlen(text), key);
+}
+
+// 无法驻留的域名（不合法或驻留表已满）在负缓存中以字符串为键，domains 已由 arrayTransLowercase 转为小写
+static std::string MSDKDnsNegativeName(NSString * domain) {
+    const char * text = [domain isKindOfClass:[NSString class]] ? [domain UTF8String] : NULL;
+    return text ? std::string(text) : std::string();
+}
+
+// 需在 msdkdns_queue 中调用
+- (NSArray *)domainsOutOfNegativeCache:(NSArray *)domains netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack {
+    NSMutableArray * result = [NSMutableArray arrayWithCapacity:domains.count];
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    for (NSString * domain in domains) {
+        msdkdns::msdkdns_domain_key key;
+        int64_t remaining = 0;
+        BOOL blocked = MSDKDnsFindDomainKey(domain, NO, &key)
+            ? _negativeCache->Blocked(key.id, netStack, now, &remaining)
+            : _negativeCache->Blocked(MSDKDnsNegativeName(domain), netStack, now, &remaining);
+        if (blocked) {
+            MSDKDNSLOG(@"%@ failed recently, skip request for %lld ms", domain, (long long)remaining);
+            continue;
+        }
+        [result addObject:domain];
+    }
+    return result;
+}
+
+- (void)msdkDnsRecordResolveResultOfDomains:(NSArray *)domains
+                                   answered:(NSArray *)answered
+                                  errorCode:(NSString *)errorCode
+                                   netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack {
+    BOOL success = [errorCode isEqualToString:MSDKDns_Success];
+    // 请求失败和超时按临时故障较快重试，其余（无数据、结果格式不正确等）按域名本身没有结果处理
+    msdkdns::MSDKDNS_TNegativeKind kind = msdkdns::MSDKDNS_ENegativeKind_NoData;
+    if ([errorCode isEqualToString:MSDKDns_UnResolve] || [errorCode isEqualToString:MSDKDns_Timeout]) {
+        kind = msdkdns::MSDKDNS_ENegativeKind_Unresolved;
+    }
+    NSSet * answeredSet = answered ? [NSSet setWithArray:answered] : nil;
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    for (NSString * domain in domains) {
+        msdkdns::msdkdns_domain_key key;
+        if (success && [answeredSet containsObject:domain]) {
+            if (MSDKDnsFindDomainKey(domain, NO, &key)) {
+                _negativeCache->RecordSuccess(key.id, netStack);
+            } else {
+                _negativeCache->RecordSuccess(MSDKDnsNegativeName(domain), netStack);
+            }
+        } else if (MSDKDnsFindDomainKey(domain, YES, &key)) {
+            _negativeCache->RecordFailure(key.id, netStack, kind, now);
+        } else {
+            _negativeCache->RecordFailure(MSDKDnsNegativeName(domain), netStack, kind, now);
+        }
+    }
+}
+
+- (void)clearNegativeCacheForDomains:(NSArray *)domains {
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        for (NSString * domain in domains) {
+            msdkdns::msdkdns_domain_key key;
+            if (MSDKDnsFindDomainKey(domain, NO, &key)) {
+                self->_negativeCache->Remove(key.id);
+            } else {
+                self->_negativeCache->Remove(MSDKDnsNegativeName(domain));
+            }
+        }
+    });
+}
+
 - (void)preResolveDomains {
     __block NSArray * domains = nil;
     dispatch_sync([MSDKDnsInfoTool msdkdns_queue], ^{
@@ -424,7 +628,7 @@ static MSDKDnsManager * gSharedInstance = nil;
 
 #pragma mark - dns resolve
 
-- (NSArray *)resultArray: (NSString *)domain fromCache:(NSDictionary *)domainDict {
+- (NSArray *)resultArray: (NSString *)domain fromCache:(MSDKDnsDomainCache *)domainDict {
     NSMutableArray * ipResult = [@[@"0", @"0"] mutableCopy];
     BOOL httpOnly = [[MSDKDnsParamsManager shareInstance] msdkDnsGetHttpOnly];
     if (domainDict) {
@@ -457,7 +661,7 @@ static MSDKDnsManager * gSharedInstance = nil;
     return ipResult;
 }
 
-- (NSDictionary *)resultDictionary: (NSArray *)domains fromCache:(NSDictionary *)domainDict {
+- (NSDictionary *)resultDictionary: (NSArray *)domains fromCache:(MSDKDnsDomainCache *)domainDict {
     NSMutableDictionary *resultDict = [NSMutableDictionary dictionary];
     for (int i = 0; i < [domains count]; i++) {
         NSString *domain = [domains objectAtIndex:i];
@@ -467,7 +671,7 @@ static MSDKDnsManager * gSharedInstance = nil;
     return resultDict;
 }
 
-- (NSDictionary *)fullResultDictionary: (NSArray *)domains fromCache:(NSDictionary *)domainDict {
+- (NSDictionary *)fullResultDictionary: (NSArray *)domains fromCache:(MSDKDnsDomainCache *)domainDict {
     BOOL httpOnly = [[MSDKDnsParamsManager shareInstance] msdkDnsGetHttpOnly];
     NSMutableDictionary *resultDict = [NSMutableDictionary dictionary];
     for (int i = 0; i < [domains count]; i++) {
@@ -507,7 +711,7 @@ static MSDKDnsManager * gSharedInstance = nil;
     return resultDict;
 }
 
-- (NSDictionary *)resultDictionaryEnableExpired: (NSArray *)domains fromCache:(NSDictionary *)domainDict toEmpty:(NSArray *)emptyDomains {
+- (NSDictionary *)resultDictionaryEnableExpired: (NSArray *)domains fromCache:(MSDKDnsDomainCache *)domainDict toEmpty:(NSArray *)emptyDomains {
     NSMutableDictionary *resultDict = [NSMutableDictionary dictionary];
     BOOL expiredIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetExpiredIPEnabled];
     for (int i = 0; i < [domains count]; i++) {
@@ -524,7 +728,7 @@ static MSDKDnsManager * gSharedInstance = nil;
     return resultDict;
 }
 
-- (NSDictionary *)fullResultDictionaryEnableExpired: (NSArray *)domains fromCache:(NSDictionary *)domainDict toEmpty:(NSArray *)emptyDomains {
+- (NSDictionary *)fullResultDictionaryEnableExpired: (NSArray *)domains fromCache:(MSDKDnsDomainCache *)domainDict toEmpty:(NSArray *)emptyDomains {
     NSMutableDictionary *resultDict = [NSMutableDictionary dictionary];
     BOOL expiredIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetExpiredIPEnabled];
     BOOL httpOnly = [[MSDKDnsParamsManager shareInstance] msdkDnsGetHttpOnly];
@@ -579,20 +783,14 @@ static MSDKDnsManager * gSharedInstance = nil;
 }
 
 - (NSDictionary *) getDnsDetail:(NSString *) domain {
-    __block NSDictionary * cacheDomainDict = nil;
-    dispatch_sync([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (domain && _domainDict) {
-            cacheDomainDict = [[NSDictionary alloc] initWithDictionary:_domainDict];
-        }
-    });
     NSMutableDictionary * detailDict = [@{@"v4_ips": @"",
                                           @"v6_ips": @"",
                                           @"v4_ttl": @"",
                                           @"v6_ttl": @"",
                                           @"v4_client_ip": @"",
                                           @"v6_client_ip": @""} mutableCopy];
-    if (cacheDomainDict) {
-        NSDictionary * domainInfo = cacheDomainDict[domain];
+    if (domain) {
+        NSDictionary * domainInfo = self.domainDict[domain];
         if (domainInfo && [domainInfo isKindOfClass:[NSDictionary class]]) {
             NSDictionary * cacheDict_A = domainInfo[kMSDKHttpDnsCache_A];
             if (cacheDict_A && [cacheDict_A isKindOfClass:[NSDictionary class]]) {
@@ -617,9 +815,6 @@ static MSDKDnsManager * gSharedInstance = nil;
     if (domain && domain.length > 0 && domainInfo && domainInfo.count > 0) {
         MSDKDNSLOG(@"Cache domain:%@ %@", domain, domainInfo);
         //结果存缓存
-        if (!self.domainDict) {
-            self.domainDict = [[NSMutableDictionary alloc] init];
-        }
         [self.domainDict setObject:domainInfo forKey:domain];
     }
 }
@@ -627,9 +822,7 @@ static MSDKDnsManager * gSharedInstance = nil;
 - (void)clearCacheForDomain:(NSString *)domain {
     if (domain && domain.length > 0) {
         MSDKDNSLOG(@"Clear cache for domain:%@",domain);
-        if (self.domainDict) {
-            [self.domainDict removeObjectForKey:domain];
-        }
+        [self.domainDict removeObjectForKey:domain];
     }
 }
 
@@ -658,10 +851,10 @@ static MSDKDnsManager * gSharedInstance = nil;
 - (void)clearAllCache {
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
         MSDKDNSLOG(@"MSDKDns cleared all caches!");
-        if (self.domainDict) {
-            [self.domainDict removeAllObjects];
-            self.domainDict = nil;
-        }
+        [self.domainDict removeAllObjects];
+        [self.cachePartitions removeAllPartitions];
+        // 网络变化等场景下此前的失败不再适用
+        self->_negativeCache->Clear();
         BOOL persistCacheIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetPersistCacheIPEnabled];
         // 当持久化缓存开启的情况下，清除持久化缓存中的数据
         if (persistCacheIPEnabled) {
@@ -671,6 +864,70 @@ static MSDKDnsManager * gSharedInstance = nil;
     });
 }
 
+- (void)switchCachePartitionToNetwork:(NSString *)network {
+    if (!network) {
+        return;
+    }
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        NSString * previous = self.networkIdentity;
+        if ([network isEqualToString:previous]) {
+            return;
+        }
+        self.networkIdentity = network;
+        // 首次获取网络标识时，当前缓存即属于该网络
+        if (!previous || [[MSDKDnsParamsManager shareInstance] msdkDnsGetExpiredIPEnabled]) {
+            return;
+        }
+        MSDKDnsDomainCache * restored = [self.cachePartitions storeCache:self.domainDict
+                                                              forNetwork:previous
+                                                      takeCacheOfNetwork:network];
+        MSDKDNSLOG(@"Network changed from %@ to %@, %@ cache partition", previous, network, restored ? @"restore" : @"create");
+        self.domainDict = restored ?: [[MSDKDnsDomainCache alloc] init];
+        // 其他网络上的失败不再适用
+        self->_negativeCache->Clear();
+        BOOL persistCacheIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetPersistCacheIPEnabled];
+        NSDictionary * domainInfos = [restored dictionaryRepresentation];
+        // 持久化缓存只保存当前网络的分区，落盘时只写入与表中不同的域名
+        if (persistCacheIPEnabled) {
+            [[MSDKDnsDB shareInstance] replaceAllDomainInfos:domainInfos];
+        }
+        if (domainInfos.count == 0) {
+            return;
+        }
+        [self revalidateHotDomains:[domainInfos allKeys]];
+    });
+}
+
+// 在 msdkdns_queue 中调用。恢复的分区可能已在其他网络期间过期或变化，按查询次数取最热的一批域名合为一次请求重新解析，
+// 保活域名由网络变化时的保活请求负责
+- (void)revalidateHotDomains:(NSArray *)domains {
+    NSArray * keepAliveDomains = [[MSDKDnsParamsManager shareInstance] msdkDnsGetKeepAliveDomains];
+    NSMutableArray * hotDomains = [NSMutableArray array];
+    NSMutableDictionary * counts = [NSMutableDictionary dictionary];
+    for (NSString * domain in domains) {
+        if (keepAliveDomains && [keepAliveDomains containsObject:domain]) {
+            continue;
+        }
+        uint32_t count = [self popularityOfDomain:domain];
+        if (count >= kMSDKDnsHotDomainThreshold) {
+            counts[domain] = @(count);
+            [hotDomains addObject:domain];
+        }
+    }
+    if (hotDomains.count == 0) {
+        return;
+    }
+    [hotDomains sortUsingComparator:^NSComparisonResult(NSString * a, NSString * b) {
+        return [counts[b] compare:counts[a]];
+    }];
+    NSUInteger maxDomains = MAX([[MSDKDnsParamsManager shareInstance] msdkDnsGetBatchMaxDomains], (NSUInteger)1);
+    NSArray * revalidateDomains = [hotDomains subarrayWithRange:NSMakeRange(0, MIN(maxDomains, hotDomains.count))];
+    MSDKDNSLOG(@"Revalidate hot domains of restored cache partition: %@", revalidateDomains);
+    msdkdns::MSDKDNS_TLocalIPStack netStack = [self detectAddressType];
+    float timeOut = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMTimeOut];
+    [self resolveDomains:revalidateDomains timeOut:timeOut netStack:netStack from:MSDKDnsEventHttpDnsAutoRefresh completion:nil];
+}
+
 - (BOOL)isOpenOptimismCache {
     BOOL persistCacheIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetPersistCacheIPEnabled];
     BOOL expiredIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetExpiredIPEnabled];
@@ -684,6 +941,8 @@ static MSDKDnsManager * gSharedInstance = nil;
 - (void)hitCacheAttaUploadReport:(NSString *)domain {
     // 检查控制台解析监控上报开关是否开启
     if ([[MSDKDnsParamsManager shareInstance] msdkDnsGetEnableReport]) {
+        BOOL shouldReport = NO;
+        pthread_mutex_lock(&_reportLock);
         if (self.cacheDomainCountDict) {
             NSNumber *num = self.cacheDomainCountDict[domain];
             if (num) {
@@ -692,21 +951,27 @@ static MSDKDnsManager * gSharedInstance = nil;
             } else {
                 [self.cacheDomainCountDict setValue:[NSNumber numberWithInt:1] forKey:domain];
             }
-            
-            if ([[AttaReport sharedInstance] shoulReportDnsSpend]) {
-                [self cacheDomainReportAtta];
-            }
+            shouldReport = [[AttaReport sharedInstance] shoulReportDnsSpend];
+        }
+        pthread_mutex_unlock(&_reportLock);
+        if (shouldReport) {
+            [self cacheDomainReportAtta];
         }
     }
 }
 
 - (void)cacheDomainReportAtta {
-    if (self.cacheDomainCountDict) {
-        NSArray *dictKey = [self.cacheDomainCountDict allKeys];
+    // 在锁内取出计数，上报在锁外进行
+    pthread_mutex_lock(&_reportLock);
+    NSDictionary *counts = [self.cacheDomainCountDict copy];
+    [self.cacheDomainCountDict removeAllObjects];
+    pthread_mutex_unlock(&_reportLock);
+    if (counts) {
+        NSArray *dictKey = [counts allKeys];
         NSInteger length = [dictKey count];
         for (int i = 0; i < length; i++) {
             id domainKey = [dictKey objectAtIndex:i];
-            NSNumber *cacheCount = [self.cacheDomainCountDict objectForKey:domainKey];
+            NSNumber *cacheCount = [counts objectForKey:domainKey];
             [[AttaReport sharedInstance] reportEvent:@{
                 MSDKDns_ErrorCode: MSDKDns_Success,
                 @"eventName": MSDKDnsEventHttpDnsCached,
@@ -723,7 +988,6 @@ static MSDKDnsManager * gSharedInstance = nil;
                 @"isCache": @1,
             }];
         }
-        [self.cacheDomainCountDict removeAllObjects];
     }
 }
 
@@ -772,7 +1036,7 @@ static MSDKDnsManager * gSharedInstance = nil;
     NSString * localDnsTimeConsuming = @"";
     NSString * channel = @"";
     
-    NSDictionary * cacheDict = [self domainDict];
+    MSDKDnsDomainCache * cacheDict = [self domainDict];
     if (cacheDict && domain) {
         NSDictionary * cacheInfo = cacheDict[domain];
         if (cacheInfo) {
@@ -946,31 +1210,22 @@ static MSDKDnsManager * gSharedInstance = nil;
 # pragma mark - check caches
 
 // 检查缓存状态
-- (NSString *) domainCache:(NSDictionary *)cache check:(NSString *)domain {
-    NSDictionary * domainInfo = cache[domain];
-    if (domainInfo && [domainInfo isKindOfClass:[NSDictionary class]]) {
-        NSDictionary * cacheDict = domainInfo[kMSDKHttpDnsCache_A];
-        if (!cacheDict || ![cacheDict isKindOfClass:[NSDictionary class]]) {
-            cacheDict = domainInfo[kMSDKHttpDnsCache_4A];
-        }
-        if (cacheDict && [cacheDict isKindOfClass:[NSDictionary class]]) {
-            NSString *ttlExpried = cacheDict[kTTLExpired];
-            NSString *ttl = cacheDict[kTTL];
-            // 开始时间预留5ms的过渡时间，以防api连续调用当前时间小于开始时间
-            NSString *beginTime = [NSString stringWithFormat:@"%0.0f", (ttlExpried.doubleValue - (ttl.doubleValue * 0.75) - 5)];
-            double timeInterval = [[NSDate date] timeIntervalSince1970];
-            if (timeInterval <= ttlExpried.doubleValue && timeInterval >= beginTime.doubleValue) {
-                return MSDKDnsDomainCacheHit;
-            } else {
-                return MSDKDnsDomainCacheExpired;
-            }
-        }
-    }
-    return MSDKDnsDomainCacheEmpty;
+- (NSString *) domainCache:(MSDKDnsDomainCache *)cache check:(NSString *)domain {
+    NSString *status = [cache cacheStatusForKey:domain];
+    [self recordAccessOfDomain:domain status:status cache:cache];
+    return status;
 }
 
 - (void)loadIPsFromPersistCacheAsync {
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        // 优先挂载快照，查询时按需读取单个域名，不再在启动时逐条加载全部缓存
+        MSDKDnsSnapshot *snapshot = [[MSDKDnsDB shareInstance] loadSnapshot];
+        if (snapshot) {
+            MSDKDNSLOG(@"Attach persist cache snapshot, domain count = %lu", (unsigned long)snapshot.count);
+            [self.domainDict attachSnapshot:snapshot];
+            [self deleteExpiredDomainsInSnapshot:snapshot];
+            return;
+        }
         NSDictionary *result = [[MSDKDnsDB shareInstance] getDataFromDB];
         MSDKDNSLOG(@"loadDB domainInfo = %@",result);
         NSMutableArray *expiredDomains = [[NSMutableArray alloc] init];
@@ -988,6 +1243,22 @@ static MSDKDnsManager * gSharedInstance = nil;
     });
 }
 
+// 删除本地持久化缓存中过期缓存，需读出全部域名，放到后台执行
+- (void)deleteExpiredDomainsInSnapshot:(MSDKDnsSnapshot *)snapshot {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        NSMutableArray *expiredDomains = [[NSMutableArray alloc] init];
+        for (NSString *domain in [snapshot allDomains]) {
+            NSDictionary *domainInfo = [snapshot domainInfoForDomain:domain];
+            if (domainInfo && [self isDomainCacheExpired:domainInfo]) {
+                [expiredDomains addObject:domain];
+            }
+        }
+        if (expiredDomains.count > 0) {
+            [[MSDKDnsDB shareInstance] deleteDBData:expiredDomains];
+        }
+    });
+}
+
 - (BOOL)isDomainCacheExpired: (NSDictionary *)domainInfo {
     NSDictionary *httpDnsIPV4Info = [domainInfo valueForKey:kMSDKHttpDnsCache_A];
     NSDictionary *httpDnsIPV6Info = [domainInfo valueForKey:kMSDKHttpDnsCache_4A];
@@ -1025,7 +1296,8 @@ static MSDKDnsManager * gSharedInstance = nil;
             netStack = msdkdns::MSDKDNS_ELocalIPStack_Dual;
             break;
         default:
-            netStack = msdkdns::msdkdns_detect_local_ip_stack();
+            // 每次解析都会走到这里，使用缓存结果，网络变化时由 MSDKDnsNetworkManager 失效
+            netStack = msdkdns::msdkdns_cached_local_ip_stack();
             break;
     }
     return netStack;
@@ -1136,10 +1408,8 @@ static MSDKDnsManager * gSharedInstance = nil;
             if (ipSting) {
                 // 判断是否为正确的ipv4地址
                 const char *utf8 = [ipSting UTF8String];
-                int success = 0;
-                struct in_addr dst;
-                success = inet_pton(AF_INET, utf8, &dst);
-                if (success == 1) {
+                uint8_t address[4];
+                if (utf8 && msdkdns::msdkdns_parse_ipv4(utf8, strlen(utf8), address)) {
                     // 当是ipv4地址，即添加到数组中并替换了后续的服务ip列表
                     [filteredArray addObject:ipSting];
                 }
@@ -1341,7 +1611,9 @@ static MSDKDnsManager * gSharedInstance = nil;
                                          returnIps:^{
                 __strong __typeof(self) strongSelf = weakSelf;
                 if (strongSelf) {
-                    [strongSelf uploadReport:NO domain:domain netStack:netStack];
+                    [MSDKDnsInfoTool msdkdns_async:domain block:^{
+                        [strongSelf uploadReport:NO domain:domain netStack:netStack];
+                    }];
                     NSDictionary * result = [strongSelf fullResultDictionary:domains fromCache:self.domainDict];
                     NSDictionary *ips = [result objectForKey:domain];
                     MSDKDNSLOG(@"ips === %@", ips);
@@ -1364,12 +1636,23 @@ static MSDKDnsManager * gSharedInstance = nil;
     });
 }
 
+- (void)setDnsServers:(NSArray *)dnsServers {
+    _dnsServers = dnsServers;
+    [[MSDKDnsServerMonitor shareInstance] setServers:dnsServers];
+}
+
 - (NSString *)currentDnsServer {
-    int index = self.serverIndex;
-    if (self.dnsServers != nil && [self.dnsServers count] > 0 && index >= 0 && index < [self.dnsServers count]) {
-        return self.dnsServers[index];
-    }
-    return  [[self defaultServers] firstObject];
+    NSString *server = [[MSDKDnsServerMonitor shareInstance] preferredServer];
+    return server ?: [[self defaultServers] firstObject];
+}
+
+- (NSString *)selectDnsServer {
+    NSString *server = [[MSDKDnsServerMonitor shareInstance] selectServer];
+    return server ?: [[self defaultServers] firstObject];
+}
+
+- (NSString *)hedgeDnsServerExcluding:(NSString *)server {
+    return [[MSDKDnsServerMonitor shareInstance] alternateServerExcluding:server];
 }
 
 - (void)switchDnsServer {
@@ -1378,11 +1661,8 @@ static MSDKDnsManager * gSharedInstance = nil;
     }
     self.waitToSwitch = YES;
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (self.serverIndex < [self.dnsServers count] - 1) {
-            self.serverIndex += 1;
-                    } else {
-            self.serverIndex = 0;
-            // 当服务ip都失败，切回主ip的时候，使用启动ip下发拉取服务ip列表的请求
+        // 服务IP的选择由 MSDKDnsServerMonitor 按耗时和失败率完成，这里只在服务IP都已熔断时使用启动ip重新拉取服务ip列表
+        if ([[MSDKDnsServerMonitor shareInstance] allServersUnavailable]) {
             HttpDnsEncryptType encryptType = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEncryptType];
             int dnsId = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsId];
             NSString *dnsKey = [[MSDKDnsParamsManager shareInstance] msdkDnsGetMDnsKey];
@@ -1395,18 +1675,16 @@ static MSDKDnsManager * gSharedInstance = nil;
 }
 
 - (void)resetDnsServers:(NSArray *)servers {
+    // 解析请求通过 MSDKDnsServerMonitor 选择服务IP，替换列表由其内部加锁保护，无需用 barrier 暂停 msdkdns_resolver_queue 上的请求
     self.waitToSwitch = YES;
-    dispatch_barrier_async([MSDKDnsInfoTool msdkdns_resolver_queue], ^{
-        NSMutableArray *array = [[NSMutableArray alloc] init];
-        if (servers && [servers count] > 0) {
-            [array addObjectsFromArray: servers];
-        } else {
-            [array addObjectsFromArray:[self defaultServers]];
-        }
-        self.serverIndex = 0;
-        self.dnsServers = array;
-        self.waitToSwitch = NO;
-    });
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    if (servers && [servers count] > 0) {
+        [array addObjectsFromArray: servers];
+    } else {
+        [array addObjectsFromArray:[self defaultServers]];
+    }
+    self.dnsServers = array;
+    self.waitToSwitch = NO;
 }
 
 - (NSArray *)defaultServers {
@@ -1475,26 +1753,32 @@ static MSDKDnsManager * gSharedInstance = nil;
 
 # pragma mark - operate delay tag
 
-- (void)msdkDnsAddDomainOpenDelayDispatch: (NSString *)domain {
-    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
-        if (domain && domain.length > 0) {
-            MSDKDNSLOG(@"domainISOpenDelayDispatch add domain:%@", domain);
-            if (!self.domainISOpenDelayDispatch) {
-                self.domainISOpenDelayDispatch = [[NSMutableDictionary alloc] init];
-            }
-            [self.domainISOpenDelayDispatch setObject:@YES forKey:domain];
+- (void)msdkDnsOpenDelayDispatchForDomain:(NSString *)domain afterTime:(double)afterTime {
+    if (!domain || domain.length == 0 || afterTime <= 0) {
+        return;
+    }
+    uint32_t lane = [MSDKDnsInfoTool msdkdns_lane:domain];
+    [MSDKDnsInfoTool msdkdns_lane_async:lane block:^{
+        NSMutableSet * opened = self.delayDispatchLanes[lane];
+        if ([opened containsObject:domain]) {
+            return;
         }
-    });
+        MSDKDNSLOG(@"domainISOpenDelayDispatch add domain:%@", domain);
+        [opened addObject:domain];
+        MSDKDNSLOG(@"Start the delayed execution task, it is expected to start requesting the domain name %@ after %f seconds", domain, afterTime);
+        [self msdkDnsScheduleRefreshForDomain:domain afterTime:afterTime];
+    }];
 }
 
 - (void)msdkDnsClearDomainOpenDelayDispatch:(NSString *)domain {
     if (domain && domain.length > 0) {
-        //  NSLog(@"请求结束，清除标志.请求域名为%@",domain);
-        MSDKDNSLOG(@"The cache update request end! request domain:%@",domain);
-        MSDKDNSLOG(@"domainISOpenDelayDispatch remove domain:%@", domain);
-        if (self.domainISOpenDelayDispatch) {
-            [self.domainISOpenDelayDispatch removeObjectForKey:domain];
-        }
+        uint32_t lane = [MSDKDnsInfoTool msdkdns_lane:domain];
+        [MSDKDnsInfoTool msdkdns_lane_async:lane block:^{
+            //  NSLog(@"请求结束，清除标志.请求域名为%@",domain);
+            MSDKDNSLOG(@"The cache update request end! request domain:%@",domain);
+            MSDKDNSLOG(@"domainISOpenDelayDispatch remove domain:%@", domain);
+            [self.delayDispatchLanes[lane] removeObject:domain];
+        }];
     }
 }
 
@@ -1505,8 +1789,184 @@ static MSDKDnsManager * gSharedInstance = nil;
     }
 }
 
-- (NSMutableDictionary *)msdkDnsGetDomainISOpenDelayDispatch {
-    return _domainISOpenDelayDispatch;
+# pragma mark - refresh timer wheel
+
+- (void)msdkDnsScheduleRefreshForDomain:(NSString *)domain afterTime:(double)afterTime {
+    if (!domain || domain.length == 0 || afterTime <= 0) {
+        return;
+    }
+    // 随机提前一段时间，打散同一批解析结果的刷新时间点
+    double jitter = afterTime * kMSDKDnsRefreshJitterRatio * arc4random_uniform(1001) / 1000.0;
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    int64_t deadline = now + (int64_t)((afterTime - jitter) * 1000);
+    deadline = MAX(deadline - deadline % kMSDKDnsRefreshAlignMs, now);
+    msdkdns::msdkdns_domain_key key;
+    if (!MSDKDnsFindDomainKey(domain, YES, &key)) {
+        // 无法驻留的域名（不合法或驻留表已满）不进时间轮，单独定时
+        __weak __typeof__(self) weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (deadline - now) * NSEC_PER_MSEC), [MSDKDnsInfoTool msdkdns_queue], ^{
+            [weakSelf refreshFiredDomains:@[domain]];
+        });
+        return;
+    }
+    msdkdns::msdkdns_domain_cache()->ScheduleRefresh(key, deadline);
+}
+
+// 在 msdkdns_queue 中调用，计时器只在下一个到期时间触发一次，空闲时不唤醒
+- (void)armRefreshTimerAt:(int64_t)deadline {
+    if (!self.refreshTimer) {
+        dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, [MSDKDnsInfoTool msdkdns_queue]);
+        __weak __typeof__(self) weakSelf = self;
+        dispatch_source_set_event_handler(timer, ^{
+            [weakSelf onRefreshTimerTick];
+        });
+        self.refreshTimer = timer;
+        dispatch_source_set_timer(timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_resume(timer);
+    }
+    if (deadline < 0) {
+        dispatch_source_set_timer(self.refreshTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+    int64_t delay = MAX(deadline - msdkdns::msdkdns_monotonic_ms(), (int64_t)0);
+    // dispatch_time 基于 mach_absolute_time，设备休眠时停止计时；walltime 在休眠期间继续计时，唤醒后按时触发
+    dispatch_source_set_timer(self.refreshTimer, dispatch_walltime(NULL, delay * NSEC_PER_MSEC),
+                              DISPATCH_TIME_FOREVER, kMSDKDnsRefreshTimerLeewayMs * NSEC_PER_MSEC);
+}
+
+- (void)advanceRefreshTimer {
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        [self onRefreshTimerTick];
+    });
+}
+
+- (void)onRefreshTimerTick {
+    // 到期的刷新域名返回
+    std::vector<uint32_t> fired;
+    int64_t next = msdkdns::msdkdns_domain_cache()->Advance(&fired);
+    [self armRefreshTimerAt:next];
+    if (fired.empty()) {
+        return;
+    }
+    NSMutableArray * domains = [NSMutableArray arrayWithCapacity:fired.size()];
+    for (size_t i = 0; i < fired.size(); i++) {
+        size_t length = 0;
+        const char * text = msdkdns::msdkdns_domain_interner()->Text(fired[i], &length);
+        NSString * domain = text ? [[NSString alloc] initWithBytes:text length:length encoding:NSUTF8StringEncoding] : nil;
+        if (domain) {
+            [domains addObject:domain];
+        }
+    }
+    [self refreshFiredDomains:domains];
+}
+
+// 在 msdkdns_queue 中调用
+- (void)refreshFiredDomains:(NSArray *)domains {
+    BOOL enableKeepDomainsAlive = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEnableKeepDomainsAlive];
+    if (!enableKeepDomainsAlive) {
+        [self msdkDnsClearDomainsOpenDelayDispatch:domains];
+        return;
+    }
+    NSArray * refreshDomains = [self refreshDomainsWithinBudget:domains];
+    if (refreshDomains.count > 0) {
+        MSDKDNSLOG(@"The cache update request start! request domains:%@", refreshDomains);
+        // 同一tick到期的域名合并为一次请求
+        [self refreshCacheDelay:refreshDomains clearDispatchTag:YES];
+    }
+}
+
+# pragma mark - refresh ahead
+
+- (void)recordAccessOfDomain:(NSString *)domain status:(NSString *)status cache:(MSDKDnsDomainCache *)cache {
+    const char * key = [domain isKindOfClass:[NSString class]] ? [domain UTF8String] : NULL;
+    if (!key) {
+        return;
+    }
+    pthread_mutex_lock(&_popularityLock);
+    uint32_t count = _popularity->Touch(key, strlen(key), msdkdns::msdkdns_monotonic_ms());
+    pthread_mutex_unlock(&_popularityLock);
+    if (count != kMSDKDnsHotDomainThreshold || ![status isEqualToString:MSDKDnsDomainCacheHit]) {
+        return;
+    }
+    // 刚成为热点的域名按当前缓存的剩余TTL加入刷新，之后每次解析完成时按新的TTL调度
+    [MSDKDnsInfoTool msdkdns_async:domain block:^{
+        if (![[MSDKDnsParamsManager shareInstance] msdkDnsGetEnableKeepDomainsAlive] ||
+            [[MSDKDnsParamsManager shareInstance] msdkDnsGetRefreshAheadBudget] == 0) {
+            return;
+        }
+        NSTimeInterval remain = [cache timeToExpireForKey:domain];
+        if (remain <= 0) {
+            return;
+        }
+        // 已开启的域名在 lane 中跳过
+        [self msdkDnsOpenDelayDispatchForDomain:domain afterTime:remain * 0.75];
+    }];
+}
+
+- (BOOL)isHotDomain:(NSString *)domain {
+    if ([[MSDKDnsParamsManager shareInstance] msdkDnsGetRefreshAheadBudget] == 0) {
+        return NO;
+    }
+    return [self popularityOfDomain:domain] >= kMSDKDnsHotDomainThreshold;
+}
+
+- (uint32_t)popularityOfDomain:(NSString *)domain {
+    const char * key = [domain isKindOfClass:[NSString class]] ? [domain UTF8String] : NULL;
+    if (!key) {
+        return 0;
+    }
+    pthread_mutex_lock(&_popularityLock);
+    uint32_t count = _popularity->Estimate(key, strlen(key), msdkdns::msdkdns_monotonic_ms());
+    pthread_mutex_unlock(&_popularityLock);
+    return count;
+}
+
+// 在 msdkdns_queue 中调用。保活域名总是刷新；热点域名按每个请求的最大域名数分组，
+// 每组消耗一次请求预算，查询次数多的优先；不再热门或超出预算的清除标志，待下次查询时按需解析
+- (NSArray *)refreshDomainsWithinBudget:(NSArray *)domains {
+    NSArray * keepAliveDomains = [[MSDKDnsParamsManager shareInstance] msdkDnsGetKeepAliveDomains];
+    NSUInteger budget = [[MSDKDnsParamsManager shareInstance] msdkDnsGetRefreshAheadBudget];
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    if (_refreshBudget->Rate() != budget) {
+        _refreshBudget->SetRate((uint32_t)budget, now);
+    }
+    NSMutableArray * refreshDomains = [NSMutableArray array];
+    NSMutableArray * hotDomains = [NSMutableArray array];
+    NSMutableArray * dropDomains = [NSMutableArray array];
+    NSMutableDictionary * counts = [NSMutableDictionary dictionary];
+    for (NSString * domain in domains) {
+        if (keepAliveDomains && [keepAliveDomains containsObject:domain]) {
+            [refreshDomains addObject:domain];
+            continue;
+        }
+        uint32_t count = budget > 0 ? [self popularityOfDomain:domain] : 0;
+        if (count >= kMSDKDnsHotDomainThreshold) {
+            counts[domain] = @(count);
+            [hotDomains addObject:domain];
+        } else {
+            [dropDomains addObject:domain];
+        }
+    }
+    [hotDomains sortUsingComparator:^NSComparisonResult(NSString * a, NSString * b) {
+        return [counts[b] compare:counts[a]];
+    }];
+    NSUInteger groupSize = MAX([[MSDKDnsParamsManager shareInstance] msdkDnsGetBatchMaxDomains], (NSUInteger)1);
+    NSUInteger refreshed = 0;
+    for (NSUInteger i = 0; i < hotDomains.count; i += groupSize) {
+        if (!_refreshBudget->TryAcquire(now)) {
+            break;
+        }
+        refreshed = MIN(i + groupSize, hotDomains.count);
+    }
+    [refreshDomains addObjectsFromArray:[hotDomains subarrayWithRange:NSMakeRange(0, refreshed)]];
+    [dropDomains addObjectsFromArray:[hotDomains subarrayWithRange:NSMakeRange(refreshed, hotDomains.count - refreshed)]];
+    self.refreshAheadCount += refreshed;
+    self.refreshAheadSkippedCount += hotDomains.count - refreshed;
+    if (hotDomains.count > refreshed) {
+        MSDKDNSLOG(@"Refresh ahead budget exhausted, skip %lu hot domains", (unsigned long)(hotDomains.count - refreshed));
+    }
+    [self msdkDnsClearDomainsOpenDelayDispatch:dropDomains];
+    return refreshDomains;
 }
 
 @end
@@ -10,6 +10,10 @@
 @property (assign, nonatomic, readonly) BOOL networkAvailable;
 @property (assign, nonatomic, readonly) MSDKDnsNetworkStatus networkStatus;
 @property (strong, nonatomic, readonly) NSString *networkType;
+// 当前网络的标识，用于划分缓存：接入方式、WiFi 子网或承载蜂窝数据的 SIM 卡、本地协议栈及 routeIp，无网络时为 nil
+@property (strong, nonatomic, readonly) NSString *networkIdentity;
+// 承载蜂窝数据的 SIM 卡的 MCC+MNC，无 SIM 卡或系统只返回占位值（iOS 16.4 起）时为 nil
+@property (strong, nonatomic, readonly) NSString *cellularOperatorCode;
 
 + (instancetype)shareInstance;
 + (void)start;
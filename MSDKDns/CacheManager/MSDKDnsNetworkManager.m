@@ -7,6 +7,10 @@
 #import "MSDKDnsInfoTool.h"
 #import "MSDKDnsManager.h"
 #import "MSDKDnsParamsManager.h"
+#import "MSDKDnsDB.h"
+#import "MSDKDnsServerMonitor.h"
+#import "MSDKDnsHttpClient.h"
+#import "msdkdns_local_ip_stack.h"
 #import <UIKit/UIKit.h>
 #import <CoreTelephony/CTTelephonyNetworkInfo.h>
 #import <CoreTelephony/CTCarrier.h>
@@ -69,12 +73,13 @@ static MSDKDnsNetworkManager *gManager = nil;
                                                              queue:nil
                                                         usingBlock:^(NSNotification *note)
              {
-                BOOL expiredIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetExpiredIPEnabled];
-                if (!expiredIPEnabled) {
-                    MSDKDNSLOG(@"Network did changed,clear MSDKDns cache");
-                    //网络状态发生变化时清除缓存
-                    [[MSDKDnsManager shareInstance] clearAllCache];
-                }
+                //网络变化后重新探测本地协议栈，解析服务的耗时统计也不再适用
+                msdkdns::msdkdns_invalidate_local_ip_stack();
+                [[MSDKDnsServerMonitor shareInstance] reset];
+                //原有连接绑定在旧的网络上，全部关闭，在途请求重新发出
+                [[MSDKDnsHttpClient shareInstance] reset];
+                //网络状态发生变化时切换到新网络的缓存分区，原网络的缓存保留，切回时恢复
+                [[MSDKDnsManager shareInstance] switchCachePartitionToNetwork:[self networkIdentity]];
                 //对保活域名发送解析请求
                 [self getHostsByKeepAliveDomains];
                 
@@ -93,13 +98,9 @@ static MSDKDnsNetworkManager *gManager = nil;
                                                         usingBlock:^(NSNotification *note)
              {
                 [[MSDKDnsManager shareInstance] enterBackgroundReportCacheData];
-                BOOL expiredIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetExpiredIPEnabled];
-                BOOL persistCacheIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetPersistCacheIPEnabled];
-                if (!expiredIPEnabled && !persistCacheIPEnabled) {
-                    MSDKDNSLOG(@"Application did enter background,clear MSDKDns cache");
-                    //进入后台时清除缓存，排除开启了持久化缓存或者开启了使用过期缓存IP的情况
-                    [[MSDKDnsManager shareInstance] clearAllCache];
-                }
+                //进入后台时，落盘未写入的持久化缓存
+                [self flushPendingWritesInBackgroundTask];
+                //进入后台时不再清除缓存，回到前台时按当前网络切换缓存分区，过期的域名查询时正常重新解析
                 //进入后台时，暂停网络监测
                 [self.reachability stopNotifier];
             }];
@@ -109,8 +110,12 @@ static MSDKDnsNetworkManager *gManager = nil;
                                                              queue:nil
                                                         usingBlock:^(NSNotification *note)
              {
-                //进入前台时，开启网络监测
+                //进入前台时，开启网络监测，后台期间的网络变化没有通知，需重新探测本地协议栈
+                msdkdns::msdkdns_invalidate_local_ip_stack();
                 [self.reachability startNotifier];
+                [[MSDKDnsManager shareInstance] switchCachePartitionToNetwork:[self networkIdentity]];
+                //挂起期间刷新计时器不触发，补上已到期的提前刷新
+                [[MSDKDnsManager shareInstance] advanceRefreshTimer];
                 //对保活域名发送解析请求
                 [self getHostsByKeepAliveDomains];
                 
@@ -123,6 +128,10 @@ static MSDKDnsNetworkManager *gManager = nil;
             
             _reachability = [MSDKDnsReachability reachabilityForInternetConnection];
             [_reachability startNotifier];
+            //记录启动时的网络，此前的缓存属于该网络
+            dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+                [[MSDKDnsManager shareInstance] switchCachePartitionToNetwork:[self networkIdentity]];
+            });
         }
         
         return self;
@@ -223,6 +232,98 @@ static SCNetworkConnectionFlags gConnectionFlags;
 #endif
 }
 
+- (NSString *)networkIdentity {
+    NSString *link = nil;
+    MSDKDnsNetworkStatus status = self.networkStatus;
+    if (status == MSDKDnsReachableViaWiFi) {
+        //获取 SSID/BSSID 需要额外的权限，以 WiFi 网卡所在子网区分不同的 WiFi
+        link = [NSString stringWithFormat:@"wifi/%@", [self localWiFiSubnet] ?: @""];
+    } else if (status == MSDKDnsReachableViaWWAN) {
+        //蜂窝网络的本机IP经常变化，以承载数据的 SIM 卡区分，不依赖 iOS 16 起只返回占位值的 CTCarrier
+        link = [NSString stringWithFormat:@"wwan/%@", [self cellularDataServiceIdentifier] ?: @""];
+    } else {
+        return nil;
+    }
+    NSString *routeIp = [[MSDKDnsParamsManager shareInstance] msdkDnsGetRouteIp] ?: @"";
+    return [NSString stringWithFormat:@"%@|%d|%@", link, (int)msdkdns::msdkdns_cached_local_ip_stack(), routeIp];
+}
+
+//当前承载蜂窝数据的 SIM 卡的服务标识，iOS 12 没有 dataServiceIdentifier，只有一张卡时取其标识，iOS 11 返回 nil
+- (NSString *)cellularDataServiceIdentifier {
+    CTTelephonyNetworkInfo *telephonyInfo = [[CTTelephonyNetworkInfo alloc] init];
+    if (@available(iOS 13.0, *)) {
+        return telephonyInfo.dataServiceIdentifier;
+    }
+    if (@available(iOS 12.0, *)) {
+        NSArray<NSString *> *services = [telephonyInfo.serviceCurrentRadioAccessTechnology allKeys];
+        return services.count == 1 ? services[0] : nil;
+    }
+    return nil;
+}
+
+- (NSString *)cellularOperatorCode {
+    // iOS 16.4 起 CTCarrier 的字段固定返回占位值，不再上报
+    if (@available(iOS 16.4, *)) {
+        return nil;
+    }
+    CTTelephonyNetworkInfo *telephonyInfo = [[CTTelephonyNetworkInfo alloc] init];
+    CTCarrier *carrier = nil;
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+    if (@available(iOS 12.0, *)) {
+        NSDictionary<NSString *, CTCarrier *> *carriers = telephonyInfo.serviceSubscriberCellularProviders;
+        NSString *service = [self cellularDataServiceIdentifier];
+        carrier = service ? carriers[service] : [[carriers allValues] firstObject];
+    } else {
+        carrier = [telephonyInfo subscriberCellularProvider];
+    }
+    NSString *countryCode = [carrier mobileCountryCode];
+    NSString *networkCode = [carrier mobileNetworkCode];
+#pragma clang diagnostic pop
+    if (countryCode.length == 0 && networkCode.length == 0) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@%@", countryCode ?: @"", networkCode ?: @""];
+}
+
+//WiFi网卡的IPv4子网，没有IPv4地址时取IPv6全局地址的/64前缀
+-(NSString*) localWiFiSubnet {
+    struct ifaddrs * addrs;
+    if (getifaddrs(&addrs) != 0) {
+        return nil;
+    }
+    NSString * subnet4 = nil;
+    NSString * subnet6 = nil;
+    for (const struct ifaddrs * cursor = addrs; cursor != NULL; cursor = cursor->ifa_next) {
+        if (!cursor->ifa_addr || !cursor->ifa_netmask || strcmp(cursor->ifa_name, "en0") != 0) {
+            continue;
+        }
+        if (cursor->ifa_addr->sa_family == AF_INET && !subnet4) {
+            const struct sockaddr_in * ipv4 = (const struct sockaddr_in *)cursor->ifa_addr;
+            const struct sockaddr_in * mask = (const struct sockaddr_in *)cursor->ifa_netmask;
+            struct in_addr network;
+            network.s_addr = ipv4->sin_addr.s_addr & mask->sin_addr.s_addr;
+            char addrNamev4[INET_ADDRSTRLEN];
+            if (inet_ntop(AF_INET, &network, addrNamev4, INET_ADDRSTRLEN)) {
+                subnet4 = [NSString stringWithFormat:@"%s/%u", addrNamev4, (unsigned)__builtin_popcount(ntohl(mask->sin_addr.s_addr))];
+            }
+        } else if (cursor->ifa_addr->sa_family == AF_INET6 && !subnet6) {
+            const struct sockaddr_in6 * ipv6 = (const struct sockaddr_in6 *)cursor->ifa_addr;
+            if (IN6_IS_ADDR_LINKLOCAL(&ipv6->sin6_addr)) {
+                continue;
+            }
+            struct in6_addr network = ipv6->sin6_addr;
+            memset(network.s6_addr + 8, 0, 8);
+            char addrNamev6[INET6_ADDRSTRLEN];
+            if (inet_ntop(AF_INET6, &network, addrNamev6, INET6_ADDRSTRLEN)) {
+                subnet6 = [NSString stringWithFormat:@"%s/64", addrNamev6];
+            }
+        }
+    }
+    freeifaddrs(addrs);
+    return subnet4 ?: subnet6;
+}
+
 - (BOOL)is3gNetWork:(NSString *)networkModel {
     return [networkModel isEqualToString:CTRadioAccessTechnologyWCDMA] ||
     [networkModel isEqualToString:CTRadioAccessTechnologyEdge] ||
@@ -316,4 +417,22 @@ static SCNetworkConnectionFlags gConnectionFlags;
     });
 }
 
+// 进入后台后在后台任务中同步落盘，避免写入完成前应用被挂起；需在主线程调用
+- (void)flushPendingWritesInBackgroundTask {
+    UIApplication *application = [UIApplication sharedApplication];
+    __block UIBackgroundTaskIdentifier task = UIBackgroundTaskInvalid;
+    // 落盘完成和后台时间耗尽都会结束任务，统一在主线程执行，只结束一次
+    void (^endTask)(void) = ^{
+        if (task != UIBackgroundTaskInvalid) {
+            [application endBackgroundTask:task];
+            task = UIBackgroundTaskInvalid;
+        }
+    };
+    task = [application beginBackgroundTaskWithName:@"MSDKDnsFlushPendingWrites" expirationHandler:endTask];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+        [[MSDKDnsDB shareInstance] flushPendingWrites];
+        dispatch_async(dispatch_get_main_queue(), endTask);
+    });
+}
+
 @end
@@ -5,6 +5,16 @@
 #import <Foundation/Foundation.h>
 #import "MSDKDns.h"
 
+/**
+ * 由拦截 / 不拦截列表编译的匹配器，持有 msdkdns::DomainMatcher（msdkdns_domain_matcher.h），释放时一并删除
+ * 创建后不可变，可在任意线程使用
+ */
+@interface MSDKDnsDomainMatcher : NSObject
+
+- (BOOL)matchHost:(const char *)host length:(size_t)length;
+
+@end
+
 @interface MSDKDnsParamsManager : NSObject
 
 @property (nonatomic, strong, readwrite)NSArray * hijackDomainArray;
@@ -33,6 +43,11 @@
 - (void)msdkDnsSetExpiredIPEnabled: (BOOL)enable;
 - (void)msdkDnsSetPersistCacheIPEnabled: (BOOL)enable;
 - (void)msdkDnsSetOffsetWithBaseTime:(NSInteger)time;
+- (void)msdkDnsSetBatchWindow:(NSUInteger)windowMs maxDomains:(NSUInteger)maxDomains;
+- (void)msdkDnsSetDetectIPStackByInterfaces:(BOOL)enable;
+- (void)msdkDnsSetHedgedRequestEnabled:(BOOL)enable;
+- (void)msdkDnsSetRefreshAheadBudget:(NSUInteger)requestsPerMinute;
+- (void)msdkDnsSetCacheMemoryBudget:(NSUInteger)bytes;
 
 - (NSString *) msdkDnsGetMDnsIp;
 - (NSString *) msdkDnsGetMOpenId;
@@ -51,6 +66,9 @@
 - (NSArray *)msdkDnsGetPreResolvedDomains;
 - (NSArray *)msdkDnsGetHijackDomainArray;
 - (NSArray *)msdkDnsGetNoHijackDomainArray;
+// 由拦截 / 不拦截列表编译的匹配器，列表为空时返回 nil；可在任意线程调用，列表被替换后返回的对象仍可继续使用
+- (MSDKDnsDomainMatcher *)msdkDnsGetHijackDomainMatcher;
+- (MSDKDnsDomainMatcher *)msdkDnsGetNoHijackDomainMatcher;
 - (HttpDnsAddressType)msdkDnsGetAddressType;
 - (NSArray *)msdkDnsGetKeepAliveDomains;
 - (NSDictionary *)msdkDnsGetIPRankData;
@@ -58,5 +76,9 @@
 - (BOOL)msdkDnsGetExpiredIPEnabled;
 - (BOOL)msdkDnsGetPersistCacheIPEnabled;
 - (NSInteger)msdkDnsGetOffsetWithBaseTime;
+- (NSUInteger)msdkDnsGetBatchWindow;
+- (NSUInteger)msdkDnsGetBatchMaxDomains;
+- (BOOL)msdkDnsGetHedgedRequestEnabled;
+- (NSUInteger)msdkDnsGetRefreshAheadBudget;
 
 @end
@@ -6,6 +6,9 @@
 #import "MSDKDnsInfoTool.h"
 #import "MSDKDnsPrivate.h"
 #import "MSDKDnsLog.h"
+#import "MSDKDnsDomainCache.h"
+#import "msdkdns_local_ip_stack.h"
+#import "msdkdns_domain_matcher.h"
 #if defined(__has_include)
     #if __has_include("httpdnsIps.h")
         #include "httpdnsIps.h"
@@ -38,6 +41,51 @@
 @property (assign, nonatomic, readwrite) BOOL persistCacheIPEnabled;
 @property (assign, nonatomic, readwrite) BOOL enableDetectHostServer;
 @property (assign, nonatomic, readwrite) NSInteger timeOffsetInSeconds;
+@property (assign, nonatomic, readwrite) NSUInteger batchWindowMs;
+@property (assign, nonatomic, readwrite) NSUInteger batchMaxDomains;
+@property (assign, nonatomic, readwrite) BOOL hedgedRequestEnabled;
+@property (assign, nonatomic, readwrite) NSUInteger refreshAheadBudget;
+/*
+ * 拦截 / 不拦截规则在 msdkdns_queue 中编译后整体替换，canInitWithRequest: 通过 atomic getter 取得强引用，
+ * 替换后旧匹配器在最后一个使用者释放时删除
+ */
+@property (strong, atomic, readwrite) MSDKDnsDomainMatcher * hijackDomainMatcher;
+@property (strong, atomic, readwrite) MSDKDnsDomainMatcher * noHijackDomainMatcher;
+
+@end
+
+@implementation MSDKDnsDomainMatcher {
+    msdkdns::DomainMatcher * _matcher;
+}
+
+// 列表为空时返回 nil，与原先 count > 0 的判断一致
++ (instancetype)matcherWithDomains:(NSArray *)domains {
+    if (domains.count == 0) {
+        return nil;
+    }
+    std::vector<std::string> rules;
+    rules.reserve(domains.count);
+    for (NSString * domain in domains) {
+        const char * text = [domain isKindOfClass:[NSString class]] ? [domain UTF8String] : NULL;
+        if (text) {
+            rules.push_back(text);
+        }
+    }
+    MSDKDnsDomainMatcher * matcher = [[MSDKDnsDomainMatcher alloc] init];
+    matcher->_matcher = new msdkdns::DomainMatcher(rules);
+    if (matcher->_matcher->RuleCount() < rules.size()) {
+        MSDKDNSLOG(@"%lu invalid hijack domain rules ignored", (unsigned long)(rules.size() - matcher->_matcher->RuleCount()));
+    }
+    return matcher;
+}
+
+- (void)dealloc {
+    delete _matcher;
+}
+
+- (BOOL)matchHost:(const char *)host length:(size_t)length {
+    return host && _matcher->Match(host, length);
+}
 
 @end
 
@@ -65,6 +113,11 @@ static MSDKDnsParamsManager * gSharedInstance = nil;
         _expiredIPEnabled = NO;
         _persistCacheIPEnabled = NO;
         _enableDetectHostServer = NO;
+        _batchWindowMs = 5;
+        _batchMaxDomains = 8;
+        _hedgedRequestEnabled = YES;
+        // 热点域名自动刷新会增加请求量，默认关闭，由业务按需开启
+        _refreshAheadBudget = 0;
     }
     return self;
 }
@@ -142,12 +195,14 @@ static MSDKDnsParamsManager * gSharedInstance = nil;
 - (void)msdkDnsSetHijackDomainArray: (NSArray *)domains {
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
         self.hijackDomainArray = [domains copy];
+        self.hijackDomainMatcher = [MSDKDnsDomainMatcher matcherWithDomains:self.hijackDomainArray];
     });
 }
 
 - (void)msdkDnsSetNoHijackDomainArray: (NSArray *)domains {
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
         self.noHijackDomainArray = [domains copy];
+        self.noHijackDomainMatcher = [MSDKDnsDomainMatcher matcherWithDomains:self.noHijackDomainArray];
     });
 }
 
@@ -193,6 +248,34 @@ static MSDKDnsParamsManager * gSharedInstance = nil;
     });
 }
 
+- (void)msdkDnsSetBatchWindow:(NSUInteger)windowMs maxDomains:(NSUInteger)maxDomains {
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        self.batchWindowMs = windowMs;
+        self.batchMaxDomains = maxDomains;
+    });
+}
+
+- (void)msdkDnsSetDetectIPStackByInterfaces:(BOOL)enable {
+    msdkdns::msdkdns_set_local_ip_stack_detector(enable ? msdkdns::MSDKDNS_ELocalIPStackDetector_Ifaddrs
+                                                        : msdkdns::MSDKDNS_ELocalIPStackDetector_Connect);
+}
+
+- (void)msdkDnsSetHedgedRequestEnabled:(BOOL)enable {
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        self.hedgedRequestEnabled = enable;
+    });
+}
+
+- (void)msdkDnsSetRefreshAheadBudget:(NSUInteger)requestsPerMinute {
+    dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
+        self.refreshAheadBudget = requestsPerMinute;
+    });
+}
+
+- (void)msdkDnsSetCacheMemoryBudget:(NSUInteger)bytes {
+    [MSDKDnsDomainCache setMemoryBudget:bytes];
+}
+
 #pragma mark - getter
 
 - (BOOL)msdkDnsGetHttpOnly {
@@ -270,6 +353,14 @@ static MSDKDnsParamsManager * gSharedInstance = nil;
     return _noHijackDomainArray;
 }
 
+- (MSDKDnsDomainMatcher *)msdkDnsGetHijackDomainMatcher {
+    return self.hijackDomainMatcher;
+}
+
+- (MSDKDnsDomainMatcher *)msdkDnsGetNoHijackDomainMatcher {
+    return self.noHijackDomainMatcher;
+}
+
 - (HttpDnsAddressType)msdkDnsGetAddressType {
     return _msdkAddressType;
 }
@@ -297,5 +388,21 @@ static MSDKDnsParamsManager * gSharedInstance = nil;
 - (NSInteger)msdkDnsGetOffsetWithBaseTime {
     return _timeOffsetInSeconds;
 }
+
+- (NSUInteger)msdkDnsGetBatchWindow {
+    return _batchWindowMs;
+}
+
+- (NSUInteger)msdkDnsGetBatchMaxDomains {
+    return _batchMaxDomains;
+}
+
+- (BOOL)msdkDnsGetHedgedRequestEnabled {
+    return _hedgedRequestEnabled;
+}
+
+- (NSUInteger)msdkDnsGetRefreshAheadBudget {
+    return _refreshAheadBudget;
+}
  
 @end
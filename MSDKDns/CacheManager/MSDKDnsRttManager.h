@@ -0,0 +1,30 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * IP 建连RTT历史
+ * 记录测速结果和业务上报的真实建连结果，开启持久化缓存时与解析缓存一起保存在本地数据库，
+ * IP优选时优先按历史排序，仅在无历史、数据过期或抖动较大时才重新测速
+ */
+@interface MSDKDnsRttManager : NSObject
+
++ (instancetype)shareInstance;
+
+/**
+ * 按历史RTT和失败率排序，needProbe 返回是否需要重新测速
+ */
+- (NSArray<NSString *> *)rankIPs:(NSArray<NSString *> *)ips port:(uint16_t)port needProbe:(BOOL *)needProbe;
+
+/**
+ * 对 ips 发起了测速，因连通数已够被取消、没有结果的IP短时间内不再触发测速
+ */
+- (void)markProbedIPs:(NSArray<NSString *> *)ips port:(uint16_t)port;
+
+- (void)recordIP:(NSString *)ip port:(uint16_t)port rtt:(double)rttMs;
+
+- (void)recordFailureOfIP:(NSString *)ip port:(uint16_t)port;
+
+@end
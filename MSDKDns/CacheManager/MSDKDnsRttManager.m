@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsRttManager.h"
+#import "MSDKDnsParamsManager.h"
+#import "MSDKDnsInfoTool.h"
+#import "MSDKDnsPrivate.h"
+#import "MSDKDnsLog.h"
+#import "MSDKDnsDB.h"
+#include "msdkdns_rtt_store.h"
+
+// 最多记录的 IP:port 个数
+static const size_t kMSDKDnsRttCapacity = 512;
+// 历史超过该时间视为过期，需要重新测速，单位ms
+static const int64_t kMSDKDnsRttStaleMs = 10 * 60 * 1000;
+// 有更新后延迟写回数据库，合并短时间内的多次更新，单位s
+static const int64_t kMSDKDnsRttFlushDelay = 5;
+
+@interface MSDKDnsRttManager () {
+    msdkdns::RttStore * _store;
+}
+
+@property (assign, nonatomic) BOOL loaded;
+@property (assign, nonatomic) BOOL flushScheduled;
+
+@end
+
+@implementation MSDKDnsRttManager
+
+static MSDKDnsRttManager * gSharedInstance = nil;
+
++ (instancetype)shareInstance {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        gSharedInstance = [[MSDKDnsRttManager alloc] init];
+    });
+    return gSharedInstance;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _store = new msdkdns::RttStore(kMSDKDnsRttCapacity, kMSDKDnsRttStaleMs);
+        _loaded = NO;
+        _flushScheduled = NO;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    delete _store;
+    _store = NULL;
+}
+
+- (int64_t)nowMs {
+    return (int64_t)([[NSDate date] timeIntervalSince1970] * 1000);
+}
+
+- (std::string)keyOfIP:(NSString *)ip port:(uint16_t)port {
+    const char *ipChar = [ip isKindOfClass:[NSString class]] ? [ip UTF8String] : NULL;
+    return msdkdns::RttStore::Key(std::string(ipChar ? ipChar : ""), port);
+}
+
+// 需持有锁调用，首次访问时在后台从数据库恢复，恢复完成前按已有记录排序
+- (void)loadIfNeeded {
+    if (self.loaded) {
+        return;
+    }
+    self.loaded = YES;
+    if (![[MSDKDnsParamsManager shareInstance] msdkDnsGetPersistCacheIPEnabled]) {
+        return;
+    }
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [self loadFromDB];
+    });
+}
+
+- (void)loadFromDB {
+    NSDictionary *records = [[MSDKDnsDB shareInstance] getIPRttRecordsFromDB];
+    NSUInteger dropped = 0;
+    @synchronized(self) {
+        for (NSString *key in records) {
+            NSDictionary *record = records[key];
+            msdkdns::msdkdns_rtt_stats stats;
+            stats.srtt_ms = [record[kMSDKDnsRttSRTT] doubleValue];
+            stats.rttvar_ms = [record[kMSDKDnsRttVar] doubleValue];
+            stats.fail_rate = [record[kMSDKDnsRttFailRate] doubleValue];
+            stats.samples = (uint32_t)[record[kMSDKDnsRttSamples] unsignedIntValue];
+            stats.updated_ms = [record[kMSDKDnsRttUpdated] longLongValue];
+            stats.probed_ms = 0;
+            if (!_store->Restore(std::string([key UTF8String]), stats)) {
+                dropped++;
+            }
+        }
+    }
+    MSDKDNSLOG(@"Load %lu rtt records from database, %lu dropped", (unsigned long)records.count, (unsigned long)dropped);
+    if (dropped > 0) {
+        // 删除超出容量的旧记录
+        [self scheduleFlush];
+    }
+}
+
+- (NSArray<NSString *> *)rankIPs:(NSArray<NSString *> *)ips port:(uint16_t)port needProbe:(BOOL *)needProbe {
+    std::vector<std::string> keys;
+    keys.reserve(ips.count);
+    for (NSString *ip in ips) {
+        keys.push_back([self keyOfIP:ip port:port]);
+    }
+    std::vector<size_t> order;
+    bool probe = true;
+    @synchronized(self) {
+        [self loadIfNeeded];
+        probe = _store->Rank(keys, [self nowMs], &order);
+    }
+    if (needProbe) {
+        *needProbe = probe;
+    }
+    NSMutableArray<NSString *> *ranked = [NSMutableArray arrayWithCapacity:ips.count];
+    for (size_t i = 0; i < order.size(); i++) {
+        [ranked addObject:ips[order[i]]];
+    }
+    return ranked;
+}
+
+- (void)markProbedIPs:(NSArray<NSString *> *)ips port:(uint16_t)port {
+    std::vector<std::string> keys;
+    keys.reserve(ips.count);
+    for (NSString *ip in ips) {
+        keys.push_back([self keyOfIP:ip port:port]);
+    }
+    @synchronized(self) {
+        [self loadIfNeeded];
+        _store->MarkProbed(keys, [self nowMs]);
+    }
+}
+
+- (void)recordIP:(NSString *)ip port:(uint16_t)port rtt:(double)rttMs {
+    if (!ip) {
+        return;
+    }
+    @synchronized(self) {
+        [self loadIfNeeded];
+        _store->RecordSuccess([self keyOfIP:ip port:port], rttMs, [self nowMs]);
+    }
+    [self scheduleFlush];
+}
+
+- (void)recordFailureOfIP:(NSString *)ip port:(uint16_t)port {
+    if (!ip) {
+        return;
+    }
+    @synchronized(self) {
+        [self loadIfNeeded];
+        _store->RecordFailure([self keyOfIP:ip port:port], [self nowMs]);
+    }
+    [self scheduleFlush];
+}
+
+- (void)scheduleFlush {
+    if (![[MSDKDnsParamsManager shareInstance] msdkDnsGetPersistCacheIPEnabled]) {
+        return;
+    }
+    @synchronized(self) {
+        if (self.flushScheduled) {
+            return;
+        }
+        self.flushScheduled = YES;
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kMSDKDnsRttFlushDelay * NSEC_PER_SEC), [MSDKDnsInfoTool msdkdns_queue], ^{
+        [self flush];
+    });
+}
+
+- (void)flush {
+    std::vector<std::pair<std::string, msdkdns::msdkdns_rtt_stats> > dirty;
+    std::vector<std::string> evicted;
+    @synchronized(self) {
+        self.flushScheduled = NO;
+        _store->TakeDirty(&dirty);
+        _store->TakeEvicted(&evicted);
+    }
+    if (!evicted.empty()) {
+        NSMutableArray *keys = [NSMutableArray arrayWithCapacity:evicted.size()];
+        for (size_t i = 0; i < evicted.size(); i++) {
+            NSString *key = [NSString stringWithUTF8String:evicted[i].c_str()];
+            if (key) {
+                [keys addObject:key];
+            }
+        }
+        [[MSDKDnsDB shareInstance] deleteIPRttRecords:keys];
+    }
+    if (dirty.empty()) {
+        return;
+    }
+    NSMutableDictionary *records = [NSMutableDictionary dictionaryWithCapacity:dirty.size()];
+    for (size_t i = 0; i < dirty.size(); i++) {
+        const msdkdns::msdkdns_rtt_stats &stats = dirty[i].second;
+        NSString *key = [NSString stringWithUTF8String:dirty[i].first.c_str()];
+        if (!key) {
+            continue;
+        }
+        records[key] = @{
+            kMSDKDnsRttSRTT: @(stats.srtt_ms),
+            kMSDKDnsRttVar: @(stats.rttvar_ms),
+            kMSDKDnsRttFailRate: @(stats.fail_rate),
+            kMSDKDnsRttSamples: @(stats.samples),
+            kMSDKDnsRttUpdated: @(stats.updated_ms),
+        };
+    }
+    [[MSDKDnsDB shareInstance] insertOrReplaceIPRttRecords:records];
+}
+
+@end
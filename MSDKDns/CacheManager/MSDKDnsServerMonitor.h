@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * 解析服务IP的选择和请求耗时统计
+ * 按 EWMA 耗时和失败率选择当前最优的服务IP，失败较多的服务IP熔断一段时间，冷却结束后放行探测请求；
+ * 按最近的请求耗时分位数计算对冲请求的等待时间和单次请求超时，网络切换时清空
+ */
+@interface MSDKDnsServerMonitor : NSObject
+
++ (instancetype)shareInstance;
+
+// 服务IP列表变化时调用，保留仍在列表中的服务IP的统计
+- (void)setServers:(NSArray<NSString *> *)servers;
+
+// 为解析请求选择服务IP，列表为空时返回 nil
+- (NSString *)selectServer;
+
+// 当前最优的服务IP，不改变熔断状态，用于上报等
+- (NSString *)preferredServer;
+
+// 对冲请求使用的服务IP，无其他可用服务IP时返回 nil
+- (NSString *)alternateServerExcluding:(NSString *)server;
+
+// 是否所有服务IP都已熔断
+- (BOOL)allServersUnavailable;
+
+- (void)recordLatency:(double)latencyMs ofServer:(NSString *)server;
+
+- (void)recordTimeout:(double)timeoutMs ofServer:(NSString *)server;
+
+// 超时以外的请求失败，如连接失败
+- (void)recordFailureOfServer:(NSString *)server;
+
+// 本地无网络等客户端原因导致的失败，不计入服务IP的统计
+- (void)recordClientErrorOfServer:(NSString *)server;
+
+// 单位均为ms，timeOut 为整个解析请求的超时
+- (double)hedgeDelayOfServer:(NSString *)server timeOut:(double)timeOutMs;
+
+- (double)attemptTimeoutOfServer:(NSString *)server timeOut:(double)timeOutMs;
+
+/**
+ * 各服务IP的统计，每项包含 server、state（closed/open/half-open）、latency（ms）、errorRate、
+ * successes、failures、selected 以及熔断时的 retryAfter（ms）
+ */
+- (NSArray<NSDictionary *> *)statistics;
+
+- (void)reset;
+
+@end
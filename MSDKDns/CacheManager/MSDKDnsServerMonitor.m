@@ -0,0 +1,191 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsServerMonitor.h"
+#import "MSDKDnsLog.h"
+#include "msdkdns_latency_tracker.h"
+#include "msdkdns_server_pool.h"
+#include "msdkdns_timer_wheel.h"
+
+// 每个服务IP保留的耗时样本数
+static const size_t kMSDKDnsServerLatencyWindow = 64;
+
+@interface MSDKDnsServerMonitor () {
+    msdkdns::LatencyTracker * _tracker;
+    msdkdns::ServerPool * _pool;
+}
+
+@property (strong, nonatomic) NSArray<NSString *> * servers;
+
+@end
+
+@implementation MSDKDnsServerMonitor
+
+static MSDKDnsServerMonitor * gSharedInstance = nil;
+
++ (instancetype)shareInstance {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        gSharedInstance = [[MSDKDnsServerMonitor alloc] init];
+    });
+    return gSharedInstance;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _tracker = new msdkdns::LatencyTracker(kMSDKDnsServerLatencyWindow);
+        _pool = new msdkdns::ServerPool();
+    }
+    return self;
+}
+
+- (void)dealloc {
+    delete _tracker;
+    _tracker = NULL;
+    delete _pool;
+    _pool = NULL;
+}
+
+- (std::string)keyOfServer:(NSString *)server {
+    const char *serverChar = [server isKindOfClass:[NSString class]] ? [server UTF8String] : NULL;
+    return std::string(serverChar ? serverChar : "");
+}
+
+- (NSString *)serverOfKey:(const std::string &)key {
+    return [NSString stringWithUTF8String:key.c_str()];
+}
+
+- (void)setServers:(NSArray<NSString *> *)servers {
+    std::vector<std::string> keys;
+    for (NSString *server in servers) {
+        keys.push_back([self keyOfServer:server]);
+    }
+    @synchronized(self) {
+        _servers = [servers copy];
+        _pool->SetServers(keys);
+    }
+}
+
+- (NSString *)selectServer {
+    std::string server;
+    @synchronized(self) {
+        if (!_pool->Select(msdkdns::msdkdns_monotonic_ms(), &server)) {
+            return nil;
+        }
+    }
+    return [self serverOfKey:server];
+}
+
+- (NSString *)preferredServer {
+    std::string server;
+    @synchronized(self) {
+        if (!_pool->Preferred(msdkdns::msdkdns_monotonic_ms(), &server)) {
+            return nil;
+        }
+    }
+    return [self serverOfKey:server];
+}
+
+- (NSString *)alternateServerExcluding:(NSString *)server {
+    std::string alternate;
+    @synchronized(self) {
+        if (!_pool->Alternate([self keyOfServer:server], msdkdns::msdkdns_monotonic_ms(), &alternate)) {
+            return nil;
+        }
+    }
+    return [self serverOfKey:alternate];
+}
+
+- (BOOL)allServersUnavailable {
+    @synchronized(self) {
+        return _pool->AllOpen();
+    }
+}
+
+- (void)recordLatency:(double)latencyMs ofServer:(NSString *)server {
+    std::string key = [self keyOfServer:server];
+    @synchronized(self) {
+        _tracker->Record(key, latencyMs);
+        _pool->RecordSuccess(key, latencyMs, msdkdns::msdkdns_monotonic_ms());
+    }
+}
+
+- (void)recordTimeout:(double)timeoutMs ofServer:(NSString *)server {
+    std::string key = [self keyOfServer:server];
+    @synchronized(self) {
+        _tracker->RecordTimeout(key, timeoutMs);
+        _pool->RecordFailure(key, msdkdns::msdkdns_monotonic_ms());
+    }
+}
+
+- (void)recordFailureOfServer:(NSString *)server {
+    @synchronized(self) {
+        _pool->RecordFailure([self keyOfServer:server], msdkdns::msdkdns_monotonic_ms());
+    }
+}
+
+- (void)recordClientErrorOfServer:(NSString *)server {
+    @synchronized(self) {
+        _pool->RecordClientError([self keyOfServer:server], msdkdns::msdkdns_monotonic_ms());
+    }
+}
+
+- (double)hedgeDelayOfServer:(NSString *)server timeOut:(double)timeOutMs {
+    @synchronized(self) {
+        return _tracker->HedgeDelayMs([self keyOfServer:server], timeOutMs);
+    }
+}
+
+- (double)attemptTimeoutOfServer:(NSString *)server timeOut:(double)timeOutMs {
+    @synchronized(self) {
+        return _tracker->AttemptTimeoutMs([self keyOfServer:server], timeOutMs);
+    }
+}
+
+- (NSArray<NSDictionary *> *)statistics {
+    std::vector<msdkdns::msdkdns_server_stats> stats;
+    int64_t now = msdkdns::msdkdns_monotonic_ms();
+    @synchronized(self) {
+        _pool->Stats(&stats);
+    }
+    NSMutableArray<NSDictionary *> *result = [NSMutableArray arrayWithCapacity:stats.size()];
+    for (size_t i = 0; i < stats.size(); i++) {
+        const msdkdns::msdkdns_server_stats &item = stats[i];
+        NSString *state = @"closed";
+        if (item.state == msdkdns::MSDKDNS_EBreakerState_Open) {
+            state = @"open";
+        } else if (item.state == msdkdns::MSDKDNS_EBreakerState_HalfOpen) {
+            state = @"half-open";
+        }
+        int64_t retryAfter = item.state == msdkdns::MSDKDNS_EBreakerState_Open && item.retry_at_ms > now ? item.retry_at_ms - now : 0;
+        [result addObject:@{
+            @"server": [self serverOfKey:item.server] ?: @"",
+            @"state": state,
+            @"latency": @(item.latency_ms),
+            @"errorRate": @(item.error_rate),
+            @"successes": @(item.successes),
+            @"failures": @(item.failures),
+            @"selected": @(item.selected),
+            @"retryAfter": @(retryAfter),
+        }];
+    }
+    return result;
+}
+
+// 网络切换后历史数据不再适用，服务IP列表保留
+- (void)reset {
+    @synchronized(self) {
+        _tracker->Clear();
+        std::vector<std::string> keys;
+        for (NSString *server in _servers) {
+            keys.push_back([self keyOfServer:server]);
+        }
+        delete _pool;
+        _pool = new msdkdns::ServerPool();
+        _pool->SetServers(keys);
+    }
+    MSDKDNSLOG(@"Reset HttpDns server statistics");
+}
+
+@end
@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+#import "msdkdns_local_ip_stack.h"
+
+/**
+ * 在途解析请求表（single-flight）
+ * 以 (域名, 网络栈, routeIp) 为键，同一个键在请求结束前只发起一次解析，后来的调用挂到在途请求上，
+ * 等该请求结束后与发起方读取同一份缓存结果
+ * 表按域名所在的 lane 分片（见 MSDKDnsInfoTool msdkdns_lane:），每片为一个 msdkdns::SingleFlight，只在所属 lane 的任务中访问，不加锁；
+ * 一批域名按 lane 分组后各自登记，全部登记完后再回到 msdkdns_queue
+ */
+@interface MSDKDnsSingleFlight : NSObject
+
+// 实际发起解析的域名数
+@property (assign, readonly) NSUInteger startedCount;
+// 合并到在途请求上、未重复发起解析的域名数
+@property (assign, readonly) NSUInteger coalescedCount;
+
+/**
+ * 登记一批待解析域名，登记完后在 msdkdns_queue 中以需要调用方发起请求的域名（保持传入顺序）回调，
+ * 调用方请求结束后必须调用 completeDomains
+ * 已在途的域名不会返回，group 会在回调前 enter，在对应的在途请求结束时 leave
+ * 重复传入的域名只登记一次，不会挂到自己发起的请求上
+ */
+- (void)joinDomains:(NSArray *)domains
+           netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+            routeIp:(NSString *)routeIp
+              group:(dispatch_group_t)group
+         completion:(void (^)(NSArray * startDomains))completion;
+
+/**
+ * 调用方发起的请求结束，唤醒挂在这些域名上的调用，参数需与 joinDomains 时一致
+ */
+- (void)completeDomains:(NSArray *)domains
+               netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+                routeIp:(NSString *)routeIp;
+
+@end
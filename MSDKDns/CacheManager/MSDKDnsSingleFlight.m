@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsSingleFlight.h"
+#import "MSDKDnsInfoTool.h"
+#import "MSDKDnsLog.h"
+#include "msdkdns_single_flight.h"
+
+@interface MSDKDnsSingleFlight () {
+    NSUInteger _startedCount;
+    NSUInteger _coalescedCount;
+    // 下标为 lane，waiter 为 CFBridgingRetain 过的 dispatch_group_t
+    msdkdns::SingleFlight * _tables;
+}
+
+@end
+
+@implementation MSDKDnsSingleFlight
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _tables = new msdkdns::SingleFlight[[MSDKDnsInfoTool msdkdns_lane_count]];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    delete[] _tables;
+}
+
+- (NSUInteger)startedCount {
+    return __atomic_load_n(&_startedCount, __ATOMIC_RELAXED);
+}
+
+- (NSUInteger)coalescedCount {
+    return __atomic_load_n(&_coalescedCount, __ATOMIC_RELAXED);
+}
+
+- (std::vector<std::string>)keysForDomains:(NSArray *)domains
+                                  netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+                                   routeIp:(NSString *)routeIp {
+    std::vector<std::string> keys;
+    keys.reserve(domains.count);
+    for (NSString * domain in domains) {
+        NSString * key = [NSString stringWithFormat:@"%@|%d|%@", domain, (int)netStack, routeIp ?: @""];
+        keys.push_back(key.UTF8String ?: "");
+    }
+    return keys;
+}
+
+// lane -> 该 lane 上的域名
+- (NSDictionary *)domainsByLane:(NSArray *)domains {
+    NSMutableDictionary * result = [NSMutableDictionary dictionary];
+    for (NSString * domain in domains) {
+        NSNumber * lane = @([MSDKDnsInfoTool msdkdns_lane:domain]);
+        NSMutableArray * laneDomains = result[lane];
+        if (!laneDomains) {
+            laneDomains = [NSMutableArray array];
+            result[lane] = laneDomains;
+        }
+        [laneDomains addObject:domain];
+    }
+    return result;
+}
+
+- (void)joinDomains:(NSArray *)domains
+           netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+            routeIp:(NSString *)routeIp
+              group:(dispatch_group_t)group
+         completion:(void (^)(NSArray * startDomains))completion {
+    dispatch_group_t joined = dispatch_group_create();
+    // 重复传入的域名只登记一次，否则会先成为发起方再挂到自己的请求上（表中同一批重复的键也会跳过）
+    NSArray * uniqueDomains = [[NSOrderedSet orderedSetWithArray:domains ?: @[]] array];
+    // 各 lane 只写自己的结果数组，dispatch_group_notify 之后才读取
+    NSMutableArray * laneStarts = [NSMutableArray array];
+    NSMutableArray * laneCoalesced = [NSMutableArray array];
+    NSDictionary * byLane = [self domainsByLane:uniqueDomains];
+    for (NSNumber * lane in byLane) {
+        NSArray * laneDomains = byLane[lane];
+        NSMutableArray * starts = [NSMutableArray array];
+        NSMutableArray * coalesced = [NSMutableArray array];
+        [laneStarts addObject:starts];
+        [laneCoalesced addObject:coalesced];
+        dispatch_group_enter(joined);
+        [MSDKDnsInfoTool msdkdns_lane_async:lane.unsignedIntValue block:^{
+            std::vector<size_t> startIndexes, coalescedIndexes;
+            self->_tables[lane.unsignedIntegerValue].Join([self keysForDomains:laneDomains netStack:netStack routeIp:routeIp],
+                                                          (__bridge void *)group, &startIndexes, &coalescedIndexes);
+            for (size_t i = 0; i < startIndexes.size(); i++) {
+                [starts addObject:laneDomains[startIndexes[i]]];
+            }
+            for (size_t i = 0; i < coalescedIndexes.size(); i++) {
+                [coalesced addObject:laneDomains[coalescedIndexes[i]]];
+                // 每挂一次 enter 一次并持有一次，completeDomains 中对应 leave 和释放
+                if (group) {
+                    dispatch_group_enter(group);
+                    CFBridgingRetain(group);
+                }
+            }
+            __atomic_add_fetch(&self->_startedCount, starts.count, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&self->_coalescedCount, coalesced.count, __ATOMIC_RELAXED);
+            dispatch_group_leave(joined);
+        }];
+    }
+    dispatch_group_notify(joined, [MSDKDnsInfoTool msdkdns_queue], ^{
+        NSMutableSet * startSet = [NSMutableSet set];
+        NSMutableArray * coalescedDomains = [NSMutableArray array];
+        for (NSUInteger i = 0; i < laneStarts.count; i++) {
+            [startSet addObjectsFromArray:laneStarts[i]];
+            [coalescedDomains addObjectsFromArray:laneCoalesced[i]];
+        }
+        if (coalescedDomains.count > 0) {
+            MSDKDNSLOG(@"%@ already in flight, wait for the pending request. coalesced:%lu started:%lu",
+                       coalescedDomains, (unsigned long)self.coalescedCount, (unsigned long)self.startedCount);
+        }
+        NSMutableArray * startDomains = [NSMutableArray arrayWithCapacity:startSet.count];
+        for (NSString * domain in uniqueDomains) {
+            if ([startSet containsObject:domain]) {
+                [startDomains addObject:domain];
+            }
+        }
+        if (completion) {
+            completion(startDomains);
+        }
+    });
+}
+
+- (void)completeDomains:(NSArray *)domains
+               netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack
+                routeIp:(NSString *)routeIp {
+    NSDictionary * byLane = [self domainsByLane:domains];
+    for (NSNumber * lane in byLane) {
+        NSArray * laneDomains = byLane[lane];
+        [MSDKDnsInfoTool msdkdns_lane_async:lane.unsignedIntValue block:^{
+            std::vector<void *> waiters;
+            self->_tables[lane.unsignedIntegerValue].Complete([self keysForDomains:laneDomains netStack:netStack routeIp:routeIp],
+                                                              &waiters);
+            // 请求失败时同样唤醒，等待方读取缓存得到与发起方相同的失败结果
+            // dispatch_group_leave 不会同步执行等待方的回调，可在 lane 中直接唤醒
+            for (size_t i = 0; i < waiters.size(); i++) {
+                dispatch_group_t group = (__bridge_transfer dispatch_group_t)waiters[i];
+                dispatch_group_leave(group);
+            }
+        }];
+    }
+}
+
+@end
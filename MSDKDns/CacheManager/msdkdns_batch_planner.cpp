@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_batch_planner.h"
+
+namespace msdkdns {
+
+    static size_t msdkdns_query_length(const std::vector<std::string> &domains) {
+        size_t length = 0;
+        for (size_t i = 0; i < domains.size(); i++) {
+            length += domains[i].size() + 1;
+        }
+        return length > 0 ? length - 1 : 0;
+    }
+
+    BatchPlanner::BatchPlanner() : window_ms_(0), max_domains_(0), max_query_length_(0), next_call_(0) {
+        stats_.flushed = 0;
+        stats_.merged = 0;
+    }
+
+    void BatchPlanner::SetLimits(int64_t window_ms, size_t max_domains, size_t max_query_length) {
+        window_ms_ = window_ms > 0 ? window_ms : 0;
+        max_domains_ = max_domains;
+        max_query_length_ = max_query_length;
+    }
+
+    uint64_t BatchPlanner::Add(const std::string &key, const std::vector<std::string> &domains, int64_t now_ms,
+                               int64_t deadline_ms, std::vector<msdkdns_batch> *ready, int64_t *flush_ms) {
+        *flush_ms = -1;
+        uint64_t call = ++next_call_;
+        size_t query_length = msdkdns_query_length(domains);
+        std::map<std::string, msdkdns_batch>::iterator it = pending_.find(key);
+        if (it != pending_.end()) {
+            // 超出上限时先发出已有批次，当前调用另起一个批次
+            msdkdns_batch &batch = it->second;
+            bool over_count = max_domains_ > 0 && batch.domains.size() + domains.size() > max_domains_;
+            bool over_length = max_query_length_ > 0 && batch.query_length + 1 + query_length > max_query_length_;
+            if (over_count || over_length) {
+                Flush(it, ready);
+                it = pending_.end();
+            } else {
+                stats_.merged++;
+            }
+        }
+        bool created = (it == pending_.end());
+        if (created) {
+            msdkdns_batch batch;
+            batch.key = key;
+            batch.query_length = 0;
+            batch.created_ms = now_ms;
+            batch.flush_ms = now_ms + window_ms_;
+            batch.deadline_ms = deadline_ms;
+            it = pending_.insert(std::make_pair(key, batch)).first;
+        } else {
+            it->second.query_length += 1;
+        }
+        msdkdns_batch &batch = it->second;
+        batch.domains.insert(batch.domains.end(), domains.begin(), domains.end());
+        batch.calls.push_back(call);
+        batch.query_length += query_length;
+        if (deadline_ms < batch.deadline_ms) {
+            batch.deadline_ms = deadline_ms;
+        }
+
+        bool full = max_domains_ > 0 && batch.domains.size() >= max_domains_;
+        if (window_ms_ == 0 || full) {
+            Flush(it, ready);
+            return call;
+        }
+        // 窗口不能超过调用方的剩余时间
+        if (batch.deadline_ms < batch.flush_ms) {
+            batch.flush_ms = batch.deadline_ms > now_ms ? batch.deadline_ms : now_ms;
+            *flush_ms = batch.flush_ms;
+        } else if (created) {
+            *flush_ms = batch.flush_ms;
+        }
+        return call;
+    }
+
+    void BatchPlanner::Expire(int64_t now_ms, std::vector<msdkdns_batch> *ready) {
+        std::map<std::string, msdkdns_batch>::iterator it = pending_.begin();
+        while (it != pending_.end()) {
+            std::map<std::string, msdkdns_batch>::iterator current = it++;
+            if (current->second.flush_ms <= now_ms) {
+                Flush(current, ready);
+            }
+        }
+    }
+
+    int64_t BatchPlanner::NextFlush() const {
+        int64_t next = -1;
+        for (std::map<std::string, msdkdns_batch>::const_iterator it = pending_.begin(); it != pending_.end(); ++it) {
+            if (next < 0 || it->second.flush_ms < next) {
+                next = it->second.flush_ms;
+            }
+        }
+        return next;
+    }
+
+    void BatchPlanner::Flush(std::map<std::string, msdkdns_batch>::iterator it, std::vector<msdkdns_batch> *ready) {
+        stats_.flushed++;
+        ready->push_back(msdkdns_batch());
+        ready->back().key.swap(it->second.key);
+        ready->back().domains.swap(it->second.domains);
+        ready->back().calls.swap(it->second.calls);
+        ready->back().query_length = it->second.query_length;
+        ready->back().created_ms = it->second.created_ms;
+        ready->back().flush_ms = it->second.flush_ms;
+        ready->back().deadline_ms = it->second.deadline_ms;
+        pending_.erase(it);
+    }
+}  // namespace msdkdns
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_BATCH_PLANNER_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_BATCH_PLANNER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    typedef struct msdkdns_batch {
+        std::string key;
+        std::vector<std::string> domains;
+        std::vector<uint64_t> calls;  // 批次内各调用的ID，按加入顺序
+        size_t query_length;          // 逗号拼接后的长度
+        int64_t created_ms;
+        int64_t flush_ms;             // 窗口到期时间
+        int64_t deadline_ms;          // 批次内调用方最早的截止时间
+    } msdkdns_batch;
+
+    typedef struct msdkdns_batch_stats {
+        uint64_t flushed;  // 已发出的批次数
+        uint64_t merged;   // 并入已有批次、未单独发起请求的调用数
+    } msdkdns_batch_stats;
+
+    /*
+     * 解析请求合批
+     * 合批键相同（由调用方拼接网络栈、routeIp、来源等）的未命中域名在一个短时间窗口内合并为一次请求，
+     * 窗口到期、域名数达到上限或拼接后的查询串超过长度上限时立即发出；单次调用的域名不拆分
+     * 批次的截止时间取各调用方截止时间的最小值，窗口到期时间不晚于截止时间，发出请求时据此计算剩余超时
+     * 只维护状态，不持有定时器：Add 返回需要调度的到期时间，调用方到时调用 Expire
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class BatchPlanner {
+    public:
+        BatchPlanner();
+
+        // window_ms 为0时不合批；max_domains、max_query_length 为0时不限制
+        void SetLimits(int64_t window_ms, size_t max_domains, size_t max_query_length);
+
+        /*
+         * 加入一次调用，返回调用ID
+         * 需要立即发出的批次（因超出上限被先行发出的已有批次，以及已满或不合批时的当前批次）追加到 ready
+         * 当前批次仍在等待且到期时间为新设或提前时，*flush_ms 为该时间，否则为 -1
+         */
+        uint64_t Add(const std::string &key, const std::vector<std::string> &domains, int64_t now_ms,
+                     int64_t deadline_ms, std::vector<msdkdns_batch> *ready, int64_t *flush_ms);
+        // 发出到期时间不晚于 now_ms 的批次
+        void Expire(int64_t now_ms, std::vector<msdkdns_batch> *ready);
+        // 最早的到期时间，没有等待中的批次时返回 -1
+        int64_t NextFlush() const;
+        size_t PendingCount() const { return pending_.size(); }
+        void Stats(msdkdns_batch_stats *stats) const { *stats = stats_; }
+
+    private:
+        void Flush(std::map<std::string, msdkdns_batch>::iterator it, std::vector<msdkdns_batch> *ready);
+
+        std::map<std::string, msdkdns_batch> pending_;
+        int64_t window_ms_;
+        size_t max_domains_;
+        size_t max_query_length_;
+        uint64_t next_call_;
+        msdkdns_batch_stats stats_;
+
+        BatchPlanner(const BatchPlanner &);
+        BatchPlanner &operator=(const BatchPlanner &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_BATCH_PLANNER_H_
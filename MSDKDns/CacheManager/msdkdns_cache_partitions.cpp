@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_cache_partitions.h"
+
+namespace msdkdns {
+
+    PartitionIndex::PartitionIndex(size_t capacity)
+        : capacity_(capacity), restored_(0), missed_(0), evicted_(0) {
+    }
+
+    bool PartitionIndex::Remove(const std::string &network) {
+        for (std::list<std::string>::iterator it = order_.begin(); it != order_.end(); ++it) {
+            if (*it == network) {
+                order_.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool PartitionIndex::Take(const std::string &network) {
+        if (Remove(network)) {
+            restored_++;
+            return true;
+        }
+        missed_++;
+        return false;
+    }
+
+    void PartitionIndex::Store(const std::string &network, std::vector<std::string> *evicted) {
+        if (capacity_ == 0) {
+            evicted->push_back(network);
+            return;
+        }
+        Remove(network);
+        order_.push_back(network);
+        while (order_.size() > capacity_) {
+            evicted->push_back(order_.front());
+            order_.pop_front();
+            evicted_++;
+        }
+    }
+
+    void PartitionIndex::Clear() {
+        order_.clear();
+    }
+}  // namespace msdkdns
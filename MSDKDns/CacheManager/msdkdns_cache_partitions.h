@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_CACHE_PARTITIONS_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_CACHE_PARTITIONS_H_
+
+#include <stddef.h>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    /*
+     * 按网络划分的缓存分区的保留顺序，只记录网络标识，分区本身由调用方按网络标识保存
+     * 最多保留 capacity 个非当前网络的分区，超出时淘汰最久未使用的
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class PartitionIndex {
+    public:
+        explicit PartitionIndex(size_t capacity);
+
+        // 取出 network 的分区，返回是否有保留的分区，取出后不再计入保留的分区
+        bool Take(const std::string &network);
+        // 保留 network 的分区，已保留时移到最近使用；因超出容量被淘汰的网络追加到 evicted
+        // capacity 为 0 时不保留，network 本身写入 evicted
+        void Store(const std::string &network, std::vector<std::string> *evicted);
+        void Clear();
+        size_t Count() const { return order_.size(); }
+
+        size_t restored() const { return restored_; }
+        // 取出时没有保留的分区的次数
+        size_t missed() const { return missed_; }
+        size_t evicted() const { return evicted_; }
+
+    private:
+        bool Remove(const std::string &network);
+
+        size_t capacity_;
+        // 最久未使用的在前，分区数很少，线性查找即可
+        std::list<std::string> order_;
+        size_t restored_;
+        size_t missed_;
+        size_t evicted_;
+
+        PartitionIndex(const PartitionIndex &);
+        PartitionIndex &operator=(const PartitionIndex &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_CACHE_PARTITIONS_H_
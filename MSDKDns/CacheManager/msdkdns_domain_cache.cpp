@@ -0,0 +1,274 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_domain_cache.h"
+
+namespace msdkdns {
+
+    static const size_t kSharedShards = 16;
+    static const size_t kSharedBudget = 4 * 1024 * 1024;
+    static const int64_t kWheelTickMs = 1000;
+    static const uintptr_t kCacheLine = 64;
+
+    DomainCache::DomainCache(size_t shards, size_t budget, msdkdns_clock_function clock)
+        : next_partition_(0), clock_(clock), wheel_(kWheelTickMs, clock()), armed_ms_(-1), wakeup_(NULL),
+          wakeup_context_(NULL) {
+        pthread_mutex_init(&wheel_mutex_, NULL);
+        // 分片数取2的幂，用哈希的低位选择分片
+        size_t count = 1;
+        while (count < shards) {
+            count *= 2;
+        }
+        for (size_t i = 0; i < count; i++) {
+            Shard *shard = new Shard;
+            // 多申请一个缓存行，按缓存行对齐起始地址；Stripe 的大小为缓存行的整数倍
+            shard->memory = new char[sizeof(Stripe) * kReaderStripes + kCacheLine];
+            uintptr_t address = reinterpret_cast<uintptr_t>(shard->memory);
+            shard->stripes = reinterpret_cast<Stripe *>((address + kCacheLine - 1) & ~(kCacheLine - 1));
+            for (int j = 0; j < kReaderStripes; j++) {
+                pthread_mutex_init(&shard->stripes[j].lock, NULL);
+                shard->stripes[j].hits = 0;
+                shard->stripes[j].misses = 0;
+            }
+            shard->store = new EntryStore(budget / count);
+            shards_.push_back(shard);
+        }
+    }
+
+    DomainCache::~DomainCache() {
+        for (size_t i = 0; i < shards_.size(); i++) {
+            delete shards_[i]->store;
+            for (int j = 0; j < kReaderStripes; j++) {
+                pthread_mutex_destroy(&shards_[i]->stripes[j].lock);
+            }
+            delete[] shards_[i]->memory;
+            delete shards_[i];
+        }
+        pthread_mutex_destroy(&wheel_mutex_);
+    }
+
+    DomainCache::Shard *DomainCache::ShardOf(const msdkdns_domain_key &domain) const {
+        return shards_[domain.hash & (shards_.size() - 1)];
+    }
+
+    DomainCache::Stripe *DomainCache::ReadLock(Shard *shard) {
+        // 按线程选择一条，同一线程始终相同；pthread_t 为线程控制块地址，乘法散列后取高位
+        uint64_t thread = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pthread_self()));
+        Stripe *stripe = &shard->stripes[(thread * 0x9E3779B97F4A7C15ULL) >> (64 - kReaderStripeBits)];
+        pthread_mutex_lock(&stripe->lock);
+        return stripe;
+    }
+
+    // 按固定顺序锁住全部，写者之间不会死锁
+    void DomainCache::WriteLock(Shard *shard) {
+        for (int i = 0; i < kReaderStripes; i++) {
+            pthread_mutex_lock(&shard->stripes[i].lock);
+        }
+    }
+
+    void DomainCache::WriteUnlock(Shard *shard) {
+        for (int i = kReaderStripes - 1; i >= 0; i--) {
+            pthread_mutex_unlock(&shard->stripes[i].lock);
+        }
+    }
+
+    void DomainCache::SetBudget(size_t budget) {
+        for (size_t i = 0; i < shards_.size(); i++) {
+            WriteLock(shards_[i]);
+            shards_[i]->store->SetBudget(budget / shards_.size());
+            WriteUnlock(shards_[i]);
+        }
+    }
+
+    uint32_t DomainCache::NewPartition() {
+        return __atomic_add_fetch(&next_partition_, 1, __ATOMIC_RELAXED);
+    }
+
+    void DomainCache::SetWakeup(msdkdns_wakeup_function wakeup, void *context) {
+        int64_t deadline = -1;
+        pthread_mutex_lock(&wheel_mutex_);
+        wakeup_ = wakeup;
+        wakeup_context_ = context;
+        if (!wheel_.NextDeadline(&deadline)) {
+            deadline = -1;
+        }
+        armed_ms_ = wakeup ? deadline : -1;
+        pthread_mutex_unlock(&wheel_mutex_);
+        if (wakeup && deadline >= 0) {
+            wakeup(deadline, context);
+        }
+    }
+
+    // 需持有 wheel_mutex_，比已通知的时间更早时由 wakeup_ms 带出，解锁后通知
+    void DomainCache::ScheduleLocked(uint32_t key, int64_t deadline_ms, int64_t *wakeup_ms) {
+        if (!wheel_.Schedule(key, deadline_ms)) {
+            return;
+        }
+        // 时间轮按格向上取整
+        int64_t due = (deadline_ms + kWheelTickMs - 1) / kWheelTickMs * kWheelTickMs;
+        if (armed_ms_ < 0 || due < armed_ms_) {
+            armed_ms_ = due;
+            *wakeup_ms = due;
+        }
+    }
+
+    void DomainCache::MarkExpired(msdkdns_entry_view *view, int64_t now_ms) {
+        if ((view->flags & MSDKDNS_EEntryFlag_HttpDns) && view->expired_ms <= now_ms) {
+            view->flags |= MSDKDNS_EEntryFlag_Expired;
+        }
+    }
+
+    bool DomainCache::Put(uint32_t partition, const msdkdns_domain_key &domain, int64_t begin_ms, int64_t expired_ms,
+                          uint8_t flags, const std::vector<std::string> &atoms, const uint8_t *payload,
+                          size_t payload_length) {
+        Shard *shard = ShardOf(domain);
+        WriteLock(shard);
+        bool stored = shard->store->Put(partition, domain, begin_ms, expired_ms, flags, atoms, payload, payload_length);
+        WriteUnlock(shard);
+        return stored;
+    }
+
+    bool DomainCache::PutIfAbsent(uint32_t partition, const msdkdns_domain_key &domain, int64_t begin_ms,
+                                  int64_t expired_ms, uint8_t flags, const std::vector<std::string> &atoms,
+                                  const uint8_t *payload, size_t payload_length, msdkdns_entry_admit admit,
+                                  void *context) {
+        Shard *shard = ShardOf(domain);
+        WriteLock(shard);
+        bool present = shard->store->Contains(partition, domain);
+        if (!present && (!admit || admit(context))) {
+            shard->store->Put(partition, domain, begin_ms, expired_ms, flags, atoms, payload, payload_length);
+        }
+        WriteUnlock(shard);
+        return present;
+    }
+
+    bool DomainCache::Find(uint32_t partition, const msdkdns_domain_key &domain, msdkdns_entry_visitor visitor,
+                           void *context) const {
+        Shard *shard = ShardOf(domain);
+        msdkdns_entry_view view;
+        Stripe *stripe = ReadLock(shard);
+        bool found = shard->store->Peek(partition, domain, &view);
+        if (found) {
+            stripe->hits++;
+        } else {
+            stripe->misses++;
+        }
+        if (found && visitor) {
+            // 每次查询比较时间，休眠或挂起后超过TTL的条目不会当作有效结果返回
+            MarkExpired(&view, clock_());
+            visitor(shard->store, view, context);
+        }
+        pthread_mutex_unlock(&stripe->lock);
+        return found;
+    }
+
+    bool DomainCache::Remove(uint32_t partition, const msdkdns_domain_key &domain) {
+        Shard *shard = ShardOf(domain);
+        WriteLock(shard);
+        bool removed = shard->store->Remove(partition, domain);
+        WriteUnlock(shard);
+        return removed;
+    }
+
+    void DomainCache::RemovePartition(uint32_t partition) {
+        for (size_t i = 0; i < shards_.size(); i++) {
+            WriteLock(shards_[i]);
+            shards_[i]->store->RemovePartition(partition);
+            WriteUnlock(shards_[i]);
+        }
+    }
+
+    size_t DomainCache::Count(uint32_t partition) const {
+        size_t count = 0;
+        for (size_t i = 0; i < shards_.size(); i++) {
+            Stripe *stripe = ReadLock(shards_[i]);
+            count += shards_[i]->store->Count(partition);
+            pthread_mutex_unlock(&stripe->lock);
+        }
+        return count;
+    }
+
+    void DomainCache::Entries(uint32_t partition, msdkdns_entry_visitor visitor, void *context) const {
+        std::vector<msdkdns_entry_view> views;
+        int64_t now = clock_();
+        for (size_t i = 0; i < shards_.size(); i++) {
+            views.clear();
+            Stripe *stripe = ReadLock(shards_[i]);
+            shards_[i]->store->Entries(partition, &views);
+            for (size_t j = 0; j < views.size(); j++) {
+                MarkExpired(&views[j], now);
+                visitor(shards_[i]->store, views[j], context);
+            }
+            pthread_mutex_unlock(&stripe->lock);
+        }
+    }
+
+    void DomainCache::Stats(msdkdns_entry_stats *stats) const {
+        msdkdns_entry_stats total = {0, 0, 0, 0, 0, 0, 0, 0};
+        for (size_t i = 0; i < shards_.size(); i++) {
+            msdkdns_entry_stats shard;
+            // 各条的计数只在持有该条的锁时修改，统计时锁住全部
+            WriteLock(shards_[i]);
+            shards_[i]->store->Stats(&shard);
+            for (int j = 0; j < kReaderStripes; j++) {
+                shard.hits += shards_[i]->stripes[j].hits;
+                shard.misses += shards_[i]->stripes[j].misses;
+            }
+            WriteUnlock(shards_[i]);
+            total.hits += shard.hits;
+            total.misses += shard.misses;
+            total.evictions += shard.evictions;
+            total.rejected += shard.rejected;
+            total.entries += shard.entries;
+            total.bytes_used += shard.bytes_used;
+            total.bytes_reserved += shard.bytes_reserved;
+            total.budget += shard.budget;
+        }
+        *stats = total;
+    }
+
+    void DomainCache::ScheduleRefresh(const msdkdns_domain_key &domain, int64_t deadline_ms) {
+        int64_t wakeup_ms = -1;
+        pthread_mutex_lock(&wheel_mutex_);
+        ScheduleLocked(domain.id, deadline_ms > 0 ? deadline_ms : 0, &wakeup_ms);
+        msdkdns_wakeup_function wakeup = wakeup_;
+        void *context = wakeup_context_;
+        pthread_mutex_unlock(&wheel_mutex_);
+        if (wakeup && wakeup_ms >= 0) {
+            wakeup(wakeup_ms, context);
+        }
+    }
+
+    void DomainCache::CancelRefresh(const msdkdns_domain_key &domain) {
+        pthread_mutex_lock(&wheel_mutex_);
+        wheel_.Cancel(domain.id);
+        pthread_mutex_unlock(&wheel_mutex_);
+    }
+
+    int64_t DomainCache::Advance(std::vector<uint32_t> *refresh) {
+        int64_t now = clock_();
+        pthread_mutex_lock(&wheel_mutex_);
+        // 时间轮的键即域名驻留编号
+        wheel_.Advance(now, refresh);
+        int64_t next = -1;
+        if (!wheel_.NextDeadline(&next)) {
+            next = -1;
+        }
+        armed_ms_ = next;
+        pthread_mutex_unlock(&wheel_mutex_);
+        return next;
+    }
+
+    static DomainCache *gSharedDomainCache = NULL;
+    static pthread_once_t gSharedDomainCacheOnce = PTHREAD_ONCE_INIT;
+
+    static void msdkdns_create_domain_cache() {
+        gSharedDomainCache = new DomainCache(kSharedShards, kSharedBudget);
+    }
+
+    DomainCache *msdkdns_domain_cache() {
+        pthread_once(&gSharedDomainCacheOnce, msdkdns_create_domain_cache);
+        return gSharedDomainCache;
+    }
+}  // namespace msdkdns
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_DOMAIN_CACHE_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_DOMAIN_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "msdkdns_domain_interner.h"
+#include "msdkdns_entry_store.h"
+#include "msdkdns_timer_wheel.h"
+
+namespace msdkdns {
+
+    // 在分片的读锁内调用，view 及 store 只在回调期间有效，回调中不能再访问同一个缓存
+    typedef void (*msdkdns_entry_visitor)(const EntryStore *store, const msdkdns_entry_view &view, void *context);
+    // 在分片的写锁内调用，返回 false 时放弃写入
+    typedef bool (*msdkdns_entry_admit)(void *context);
+    // 单调时钟，单位ms，测试时可替换为虚拟时钟
+    typedef int64_t (*msdkdns_clock_function)();
+    // 时间轮中出现了比上次通知的更早的到期时间，调用方需在 deadline_ms 时调用 Advance，不在任何锁内调用
+    typedef void (*msdkdns_wakeup_function)(int64_t deadline_ms, void *context);
+
+    /*
+     * 并发的域名缓存
+     * 按域名驻留时预先计算的哈希分到各分片，每个分片为一个 EntryStore 加一组按线程分条的读锁：
+     * 读者只锁本线程对应的一条（各占独立的缓存行，命中统计也记在其中），写者依次锁住全部，
+     * 查询做一次哈希查找，不同线程读同一个热点域名时不写共享的缓存行，无需拷贝整个缓存，也无需切换队列
+     * 总内存预算平均分给各分片，分片内按 CLOCK 淘汰
+     * 以 partition 区分不同的缓存实例（如不同网络的分区），所有方法可在任意线程调用
+     *
+     * 过期在查询时判断：有 HTTPDNS 结果且 expired_ms 不晚于当前时间的条目，交给 visitor 的 view 带
+     * MSDKDNS_EEntryFlag_Expired，不依赖定时器按时触发（设备休眠、应用挂起期间定时器不触发）
+     * 提前刷新（TTL 的75%处及保活）由一个分层时间轮驱动，到期的域名由 Advance 返回，时间轮以1s为一格
+     * 时间轮不自行计时，由调用方在 wakeup 通知的时间或 Advance 返回的时间调用 Advance
+     */
+    class DomainCache {
+    public:
+        DomainCache(size_t shards, size_t budget, msdkdns_clock_function clock = msdkdns_monotonic_ms);
+        ~DomainCache();
+
+        // 缩小时立即淘汰到预算以内
+        void SetBudget(size_t budget);
+        uint32_t NewPartition();
+        void SetWakeup(msdkdns_wakeup_function wakeup, void *context);
+
+        // 条目超过预算而无法写入时返回 false，该键原有的条目一并删除
+        bool Put(uint32_t partition, const msdkdns_domain_key &domain, int64_t begin_ms, int64_t expired_ms,
+                 uint8_t flags, const std::vector<std::string> &atoms, const uint8_t *payload, size_t payload_length);
+        /*
+         * 仅在没有该键的条目（含删除占位）时写入，admit 不为 NULL 时在写锁内再确认一次
+         * 返回写入前是否已有条目
+         */
+        bool PutIfAbsent(uint32_t partition, const msdkdns_domain_key &domain, int64_t begin_ms, int64_t expired_ms,
+                         uint8_t flags, const std::vector<std::string> &atoms, const uint8_t *payload,
+                         size_t payload_length, msdkdns_entry_admit admit, void *context);
+        // 命中时在读锁内调用 visitor，已过期的条目 view.flags 带 Expired
+        bool Find(uint32_t partition, const msdkdns_domain_key &domain, msdkdns_entry_visitor visitor,
+                  void *context) const;
+        bool Remove(uint32_t partition, const msdkdns_domain_key &domain);
+        void RemovePartition(uint32_t partition);
+
+        size_t Count(uint32_t partition) const;
+        // 逐个分片在读锁内遍历，不置引用位，不计入命中统计，过期标记与 Find 相同
+        void Entries(uint32_t partition, msdkdns_entry_visitor visitor, void *context) const;
+        // 各分片的合计
+        void Stats(msdkdns_entry_stats *stats) const;
+
+        // 调度域名的提前刷新，同一域名覆盖之前的时间
+        void ScheduleRefresh(const msdkdns_domain_key &domain, int64_t deadline_ms);
+        void CancelRefresh(const msdkdns_domain_key &domain);
+        /*
+         * 推进时间轮到当前时间，到期的刷新域名编号追加到 refresh
+         * 返回下一次需要调用的时间，时间轮为空时返回 -1
+         */
+        int64_t Advance(std::vector<uint32_t> *refresh);
+
+    private:
+        enum {
+            kReaderStripeBits = 3,
+            kReaderStripes = 1 << kReaderStripeBits,
+        };
+
+        // 读锁的一条，独占缓存行；hits / misses 只在持有该条的锁时修改
+        struct Stripe {
+            pthread_mutex_t lock;
+            uint64_t hits;
+            uint64_t misses;
+        } __attribute__((aligned(64)));
+
+        struct Shard {
+            char *memory;
+            Stripe *stripes;  // kReaderStripes 条，位于 memory 中按缓存行对齐的位置
+            EntryStore *store;
+        };
+
+        Shard *ShardOf(const msdkdns_domain_key &domain) const;
+        // 读者锁本线程对应的一条，返回该条
+        static Stripe *ReadLock(Shard *shard);
+        static void WriteLock(Shard *shard);
+        static void WriteUnlock(Shard *shard);
+        static void MarkExpired(msdkdns_entry_view *view, int64_t now_ms);
+        void ScheduleLocked(uint32_t key, int64_t deadline_ms, int64_t *wakeup_ms);
+
+        std::vector<Shard *> shards_;
+        uint32_t next_partition_;
+        msdkdns_clock_function clock_;
+        pthread_mutex_t wheel_mutex_;
+        TimerWheel wheel_;
+        int64_t armed_ms_;  // 已通知调用方的下一次 Advance 时间，-1 表示没有
+        msdkdns_wakeup_function wakeup_;
+        void *wakeup_context_;
+
+        DomainCache(const DomainCache &);
+        DomainCache &operator=(const DomainCache &);
+    };
+
+    // 进程内共用的缓存，16个分片，默认预算4MB
+    DomainCache *msdkdns_domain_cache();
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_DOMAIN_CACHE_H_
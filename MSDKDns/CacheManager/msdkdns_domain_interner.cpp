@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_domain_interner.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace msdkdns {
+
+    static const size_t kChunkShift = 10;
+    static const size_t kChunkSize = 1 << kChunkShift;
+    static const size_t kInitialIndexCapacity = 256;
+    static const size_t kTextBlockSize = 16 * 1024;
+    // 进程内共用驻留表的域名上限，约占用 3MB
+    static const size_t kSharedMaxDomains = 64 * 1024;
+
+    bool msdkdns_canonicalize_domain(const char *domain, size_t length, char *out, size_t *out_length) {
+        if (!domain) {
+            return false;
+        }
+        if (length > 0 && domain[length - 1] == '.') {
+            length--;
+        }
+        if (length == 0 || length > kMSDKDnsMaxDomainLength) {
+            return false;
+        }
+        size_t label = 0;
+        for (size_t i = 0; i < length; i++) {
+            uint8_t c = static_cast<uint8_t>(domain[i]);
+            if (c <= 0x20 || c >= 0x7F) {
+                return false;
+            }
+            if (c == '.') {
+                if (label == 0) {
+                    return false;
+                }
+                label = 0;
+            } else if (++label > 63) {
+                return false;
+            }
+            // 只有 A-Z 减去 'A' 后小于26
+            out[i] = static_cast<char>(static_cast<unsigned>(c - 'A') < 26 ? c | 0x20 : c);
+        }
+        // 去掉一个点后仍以点结尾
+        if (label == 0) {
+            return false;
+        }
+        *out_length = length;
+        return true;
+    }
+
+    DomainInterner::DomainInterner(size_t max_domains)
+        : max_domains_(max_domains), chunks_(NULL), count_(0), index_(NULL), block_used_(kTextBlockSize) {
+        pthread_mutex_init(&mutex_, NULL);
+        chunks_ = static_cast<Entry **>(calloc((max_domains + kChunkSize - 1) / kChunkSize + 1, sizeof(Entry *)));
+        index_ = new Index;
+        index_->capacity = kInitialIndexCapacity;
+        index_->slots = static_cast<uint32_t *>(calloc(kInitialIndexCapacity, sizeof(uint32_t)));
+    }
+
+    DomainInterner::~DomainInterner() {
+        for (size_t i = 0; chunks_ && chunks_[i]; i++) {
+            free(chunks_[i]);
+        }
+        free(chunks_);
+        retired_.push_back(index_);
+        for (size_t i = 0; i < retired_.size(); i++) {
+            free(retired_[i]->slots);
+            delete retired_[i];
+        }
+        for (size_t i = 0; i < blocks_.size(); i++) {
+            free(blocks_[i]);
+        }
+        pthread_mutex_destroy(&mutex_);
+    }
+
+    uint32_t msdkdns_domain_hash(const char *domain, size_t length) {
+        char text[kMSDKDnsMaxDomainLength];
+        size_t text_length = 0;
+        if (!msdkdns_canonicalize_domain(domain, length, text, &text_length)) {
+            return domain ? DomainInterner::Hash(domain, length) : 0;
+        }
+        return DomainInterner::Hash(text, text_length);
+    }
+
+    uint32_t DomainInterner::Hash(const char *text, size_t length) {
+        // FNV-1a，末尾再混合一次使低位分布均匀
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<uint8_t>(text[i]);
+            hash *= 16777619u;
+        }
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        return hash;
+    }
+
+    const DomainInterner::Entry *DomainInterner::EntryAt(uint32_t id) const {
+        return &chunks_[(id - 1) >> kChunkShift][(id - 1) & (kChunkSize - 1)];
+    }
+
+    uint32_t DomainInterner::Lookup(const Index *index, uint32_t hash, const char *text, size_t length) const {
+        size_t mask = index->capacity - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint32_t id = __atomic_load_n(&index->slots[i], __ATOMIC_ACQUIRE);
+            if (id == 0) {
+                return 0;
+            }
+            const Entry *entry = EntryAt(id);
+            if (entry->hash == hash && entry->length == length && memcmp(entry->text, text, length) == 0) {
+                return id;
+            }
+        }
+    }
+
+    // 在新索引中重建后整体发布，旧索引留给仍在读取的线程
+    bool DomainInterner::GrowIndex() {
+        Index *index = new Index;
+        index->capacity = index_->capacity * 2;
+        index->slots = static_cast<uint32_t *>(calloc(index->capacity, sizeof(uint32_t)));
+        if (!index->slots) {
+            delete index;
+            return false;
+        }
+        size_t mask = index->capacity - 1;
+        for (uint32_t id = 1; id <= count_; id++) {
+            size_t i = EntryAt(id)->hash & mask;
+            while (index->slots[i]) {
+                i = (i + 1) & mask;
+            }
+            index->slots[i] = id;
+        }
+        retired_.push_back(index_);
+        __atomic_store_n(&index_, index, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    const char *DomainInterner::CopyText(const char *text, size_t length) {
+        if (block_used_ + length > kTextBlockSize) {
+            char *block = static_cast<char *>(malloc(kTextBlockSize));
+            if (!block) {
+                return NULL;
+            }
+            blocks_.push_back(block);
+            block_used_ = 0;
+        }
+        char *copy = blocks_.back() + block_used_;
+        memcpy(copy, text, length);
+        block_used_ += length;
+        return copy;
+    }
+
+    bool DomainInterner::Intern(const char *domain, size_t length, msdkdns_domain_key *key) {
+        char text[kMSDKDnsMaxDomainLength];
+        size_t text_length = 0;
+        if (!msdkdns_canonicalize_domain(domain, length, text, &text_length)) {
+            return false;
+        }
+        uint32_t hash = Hash(text, text_length);
+        pthread_mutex_lock(&mutex_);
+        uint32_t id = Lookup(index_, hash, text, text_length);
+        if (id == 0 && count_ < max_domains_) {
+            // 负载超过1/2时扩容，保证探测链较短
+            size_t chunk = count_ >> kChunkShift;
+            if ((count_ + 1) * 2 > index_->capacity && !GrowIndex()) {
+                pthread_mutex_unlock(&mutex_);
+                return false;
+            }
+            if (!chunks_[chunk]) {
+                chunks_[chunk] = static_cast<Entry *>(malloc(kChunkSize * sizeof(Entry)));
+            }
+            const char *copy = chunks_[chunk] ? CopyText(text, text_length) : NULL;
+            if (copy) {
+                id = count_ + 1;
+                Entry *entry = &chunks_[chunk][count_ & (kChunkSize - 1)];
+                entry->hash = hash;
+                entry->length = static_cast<uint32_t>(text_length);
+                entry->text = copy;
+                __atomic_store_n(&count_, id, __ATOMIC_RELEASE);
+                size_t mask = index_->capacity - 1;
+                size_t i = hash & mask;
+                while (index_->slots[i]) {
+                    i = (i + 1) & mask;
+                }
+                __atomic_store_n(&index_->slots[i], id, __ATOMIC_RELEASE);
+            }
+        }
+        pthread_mutex_unlock(&mutex_);
+        if (id == 0) {
+            return false;
+        }
+        key->id = id;
+        key->hash = hash;
+        return true;
+    }
+
+    bool DomainInterner::Find(const char *domain, size_t length, msdkdns_domain_key *key) const {
+        char text[kMSDKDnsMaxDomainLength];
+        size_t text_length = 0;
+        if (!msdkdns_canonicalize_domain(domain, length, text, &text_length)) {
+            return false;
+        }
+        uint32_t hash = Hash(text, text_length);
+        uint32_t id = Lookup(__atomic_load_n(&index_, __ATOMIC_ACQUIRE), hash, text, text_length);
+        if (id == 0) {
+            return false;
+        }
+        key->id = id;
+        key->hash = hash;
+        return true;
+    }
+
+    const char *DomainInterner::Text(uint32_t id, size_t *length) const {
+        if (id == 0 || id > __atomic_load_n(&count_, __ATOMIC_ACQUIRE)) {
+            *length = 0;
+            return NULL;
+        }
+        const Entry *entry = EntryAt(id);
+        *length = entry->length;
+        return entry->text;
+    }
+
+    size_t DomainInterner::Count() const {
+        return __atomic_load_n(&count_, __ATOMIC_ACQUIRE);
+    }
+
+    static DomainInterner *gSharedDomainInterner = NULL;
+    static pthread_once_t gSharedDomainInternerOnce = PTHREAD_ONCE_INIT;
+
+    static void msdkdns_create_domain_interner() {
+        gSharedDomainInterner = new DomainInterner(kSharedMaxDomains);
+    }
+
+    DomainInterner *msdkdns_domain_interner() {
+        pthread_once(&gSharedDomainInternerOnce, msdkdns_create_domain_interner);
+        return gSharedDomainInterner;
+    }
+}  // namespace msdkdns
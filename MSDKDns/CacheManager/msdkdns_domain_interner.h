@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_DOMAIN_INTERNER_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_DOMAIN_INTERNER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <vector>
+
+namespace msdkdns {
+
+    // 规范化后域名的最大长度，不含结尾的点
+    static const size_t kMSDKDnsMaxDomainLength = 253;
+
+    typedef struct msdkdns_domain_key {
+        uint32_t id;    // 从1开始，进程内不变
+        uint32_t hash;  // 规范化文本的哈希，各个表直接使用，不再重新计算
+    } msdkdns_domain_key;
+
+    /*
+     * 域名规范化：ASCII 字母转小写，去掉结尾的一个点
+     * 只接受可见 ASCII 字符，每个标签1-63字节，总长不超过253字节，否则返回 false
+     * out 需预留 kMSDKDnsMaxDomainLength 字节，不追加\0
+     */
+    bool msdkdns_canonicalize_domain(const char *domain, size_t length, char *out, size_t *out_length);
+
+    // 规范化文本的哈希，与驻留后 msdkdns_domain_key 的 hash 相同，但不加入驻留表；不合法的域名按原文计算
+    uint32_t msdkdns_domain_hash(const char *domain, size_t length);
+
+    /*
+     * 域名驻留表，规范化后的域名对应一个固定的编号及预先计算的哈希，缓存、负缓存等表以编号为键
+     * 域名一经加入不再删除，编号及 Text 返回的指针在进程内一直有效；达到 max_domains 后不再加入新域名，
+     * 调用方对无法驻留的域名（不合法、非 ASCII 或已满）退回以字符串为键，见 MSDKDnsDomainCache 的溢出表和 NegativeCache
+     * Find / Text 无锁，可与 Intern 并发调用：条目及文本写入后才以 release 发布到索引，读者以 acquire 读取；
+     * 索引扩容时旧索引保留到析构，正在读旧索引的线程不受影响
+     */
+    class DomainInterner {
+    public:
+        explicit DomainInterner(size_t max_domains);
+        ~DomainInterner();
+
+        // 规范化并加入，已存在时返回原有的编号；域名不合法或已满时返回 false
+        bool Intern(const char *domain, size_t length, msdkdns_domain_key *key);
+        // 只查找不加入，未加入过时返回 false
+        bool Find(const char *domain, size_t length, msdkdns_domain_key *key) const;
+        // 规范化后的文本，不以\0结尾；编号无效时返回 NULL
+        const char *Text(uint32_t id, size_t *length) const;
+        size_t Count() const;
+
+    private:
+        struct Entry {
+            uint32_t hash;
+            uint32_t length;
+            const char *text;
+        };
+        struct Index {
+            size_t capacity;
+            uint32_t *slots;  // 条目编号，0 表示空槽
+        };
+
+        static uint32_t Hash(const char *text, size_t length);
+        friend uint32_t msdkdns_domain_hash(const char *domain, size_t length);
+        const Entry *EntryAt(uint32_t id) const;
+        uint32_t Lookup(const Index *index, uint32_t hash, const char *text, size_t length) const;
+        bool GrowIndex();
+        const char *CopyText(const char *text, size_t length);
+
+        size_t max_domains_;
+        pthread_mutex_t mutex_;
+        Entry **chunks_;             // 每块 kChunkSize 个条目，分配后不移动
+        uint32_t count_;
+        Index *index_;
+        std::vector<Index *> retired_;
+        std::vector<char *> blocks_;  // 域名文本
+        size_t block_used_;
+
+        DomainInterner(const DomainInterner &);
+        DomainInterner &operator=(const DomainInterner &);
+    };
+
+    // 进程内共用的驻留表
+    DomainInterner *msdkdns_domain_interner();
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_DOMAIN_INTERNER_H_
@@ -0,0 +1,450 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_entry_store.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace msdkdns {
+
+    static const size_t kInitialArenaSize = 4 * 1024;
+    static const size_t kMaxArenaSize = 0xFFFFFFF0u;
+    static const size_t kInitialCapacity = 64;
+    // 条目按8字节对齐
+    static const size_t kAlignment = 8;
+    // 字符串池中每个字符串除文本外的估算开销
+    static const size_t kAtomOverhead = 48;
+    // 已删除、等待整理的条目，不对外暴露
+    static const uint8_t kDeadFlag = 0x80;
+
+    struct EntryStore::Record {
+        uint32_t hash;
+        uint32_t partition;
+        uint32_t domain;
+        uint32_t size;  // 含头部及对齐的总字节数
+        int64_t begin_ms;
+        int64_t expired_ms;
+        uint32_t payload_length;
+        uint8_t flags;
+        uint8_t atom_count;
+        uint8_t referenced;  // CLOCK 引用位，读锁下并发置位
+
+        uint32_t *Atoms() { return reinterpret_cast<uint32_t *>(this + 1); }
+        const uint32_t *Atoms() const { return reinterpret_cast<const uint32_t *>(this + 1); }
+        uint8_t *Payload() { return reinterpret_cast<uint8_t *>(Atoms() + atom_count); }
+        const uint8_t *Payload() const { return reinterpret_cast<const uint8_t *>(Atoms() + atom_count); }
+    };
+
+    EntryStore::EntryStore(size_t budget)
+        : budget_(budget), arena_(NULL), arena_capacity_(0), arena_tail_(0), live_bytes_(0), slots_(NULL),
+          capacity_(kInitialCapacity), count_(0), hand_(0), atom_bytes_(0), hits_(0), misses_(0), evictions_(0),
+          rejected_(0) {
+        slots_ = static_cast<uint32_t *>(calloc(capacity_, sizeof(uint32_t)));
+    }
+
+    EntryStore::~EntryStore() {
+        free(arena_);
+        free(slots_);
+    }
+
+    void EntryStore::SetBudget(size_t budget) {
+        budget_ = budget;
+        Reserve(0, 0);
+    }
+
+    uint32_t EntryStore::Hash(uint32_t partition, const msdkdns_domain_key &domain) {
+        uint32_t hash = domain.hash ^ (partition * 0x9E3779B1u);
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        return hash;
+    }
+
+    EntryStore::Record *EntryStore::At(uint32_t slot) const {
+        return reinterpret_cast<Record *>(arena_ + slot - 1);
+    }
+
+    // 返回条目所在的槽，不存在时返回应插入的空槽；域名编号相同即文本相同，无需比较文本
+    size_t EntryStore::Probe(uint32_t hash, uint32_t partition, uint32_t domain) const {
+        size_t mask = capacity_ - 1;
+        size_t index = hash & mask;
+        while (slots_[index]) {
+            const Record *record = At(slots_[index]);
+            if (record->hash == hash && record->domain == domain && record->partition == partition) {
+                break;
+            }
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    bool EntryStore::GrowIndex() {
+        size_t capacity = capacity_ * 2;
+        uint32_t *slots = static_cast<uint32_t *>(calloc(capacity, sizeof(uint32_t)));
+        if (!slots) {
+            return false;
+        }
+        size_t mask = capacity - 1;
+        for (size_t i = 0; i < capacity_; i++) {
+            if (!slots_[i]) {
+                continue;
+            }
+            size_t index = At(slots_[i])->hash & mask;
+            while (slots[index]) {
+                index = (index + 1) & mask;
+            }
+            slots[index] = slots_[i];
+        }
+        free(slots_);
+        slots_ = slots;
+        capacity_ = capacity;
+        hand_ = 0;
+        return true;
+    }
+
+    // 线性探测的删除：将后续同一探测链上的条目前移，不留墓碑
+    void EntryStore::EraseSlot(size_t index) {
+        size_t mask = capacity_ - 1;
+        slots_[index] = 0;
+        count_--;
+        size_t next = (index + 1) & mask;
+        while (slots_[next]) {
+            size_t home = At(slots_[next])->hash & mask;
+            // home 不在 (index, next] 区间内时，该条目可以移到空出的 index
+            bool movable = index <= next ? (home <= index || home > next) : (home <= index && home > next);
+            if (movable) {
+                slots_[index] = slots_[next];
+                slots_[next] = 0;
+                index = next;
+            }
+            next = (next + 1) & mask;
+        }
+    }
+
+    bool EntryStore::EvictOne(uint32_t keep) {
+        if (count_ == 0) {
+            return false;
+        }
+        // 最多扫两圈：第一圈清除引用位，第二圈必然找到可淘汰的条目，除非全部为占位条目
+        for (size_t scanned = 0; scanned < 2 * capacity_; scanned++) {
+            size_t index = hand_;
+            hand_ = (hand_ + 1) & (capacity_ - 1);
+            if (!slots_[index] || slots_[index] == keep) {
+                continue;
+            }
+            Record *record = At(slots_[index]);
+            if (record->flags & MSDKDNS_EEntryFlag_Removed) {
+                continue;
+            }
+            if (__atomic_load_n(&record->referenced, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&record->referenced, 0, __ATOMIC_RELAXED);
+                continue;
+            }
+            EraseSlot(index);
+            FreeRecord(record);
+            evictions_++;
+            return true;
+        }
+        return false;
+    }
+
+    void EntryStore::FreeRecord(Record *record) {
+        for (uint8_t i = 0; i < record->atom_count; i++) {
+            Release(record->Atoms()[i]);
+        }
+        record->flags |= kDeadFlag;
+        live_bytes_ -= record->size;
+        // 位于末尾时直接回收，其余留待整理
+        if (reinterpret_cast<uint8_t *>(record) + record->size == arena_ + arena_tail_) {
+            arena_tail_ -= record->size;
+        }
+    }
+
+    void EntryStore::View(const Record *record, msdkdns_entry_view *view) const {
+        view->domain = record->domain;
+        view->begin_ms = record->begin_ms;
+        view->expired_ms = record->expired_ms;
+        view->flags = record->flags;
+        view->atoms = record->Atoms();
+        view->atom_count = record->atom_count;
+        view->payload = record->Payload();
+        view->payload_length = record->payload_length;
+    }
+
+    // 预算扣除索引及字符串池后留给 arena 的字节数
+    size_t EntryStore::ArenaLimit() const {
+        size_t fixed = capacity_ * sizeof(uint32_t) + atom_bytes_;
+        if (budget_ <= fixed) {
+            return 0;
+        }
+        return budget_ - fixed < kMaxArenaSize ? budget_ - fixed : kMaxArenaSize;
+    }
+
+    bool EntryStore::ResizeArena(size_t capacity) {
+        if (capacity == 0) {
+            free(arena_);
+            arena_ = NULL;
+            arena_capacity_ = 0;
+            return true;
+        }
+        uint8_t *arena = static_cast<uint8_t *>(realloc(arena_, capacity));
+        if (!arena) {
+            return false;
+        }
+        arena_ = arena;
+        arena_capacity_ = capacity;
+        return true;
+    }
+
+    // 按地址顺序前移有效条目，去掉已删除条目留下的空洞，索引中的偏移随之更新
+    void EntryStore::Compact() {
+        size_t mask = capacity_ - 1;
+        size_t read = 0;
+        size_t write = 0;
+        while (read < arena_tail_) {
+            Record *record = reinterpret_cast<Record *>(arena_ + read);
+            size_t size = record->size;
+            if (!(record->flags & kDeadFlag)) {
+                if (write != read) {
+                    size_t index = record->hash & mask;
+                    while (slots_[index] != read + 1) {
+                        index = (index + 1) & mask;
+                    }
+                    memmove(arena_ + write, arena_ + read, size);
+                    slots_[index] = static_cast<uint32_t>(write + 1);
+                }
+                write += size;
+            }
+            read += size;
+        }
+        arena_tail_ = write;
+    }
+
+    // 通过淘汰、整理或扩大 arena，使末尾有 size 字节的空间且 arena 不超过预算，keep 为不可淘汰的条目
+    bool EntryStore::Reserve(size_t size, uint32_t keep) {
+        bool evicting = false;
+        for (;;) {
+            size_t limit = ArenaLimit();
+            // 需要淘汰时多腾出1/8的空间，避免之后每次写入都要淘汰并整理整个 arena
+            if (live_bytes_ + size > limit || (evicting && live_bytes_ + size + limit / 8 > limit)) {
+                if (EvictOne(keep)) {
+                    evicting = true;
+                    continue;
+                }
+                evicting = false;
+                if (live_bytes_ + size > limit) {
+                    // 剩余的都是占位条目，arena 收缩到只容纳它们
+                    Compact();
+                    if (arena_capacity_ > arena_tail_) {
+                        ResizeArena(arena_tail_);
+                    }
+                    return false;
+                }
+            }
+            if (arena_capacity_ <= limit && arena_tail_ + size <= arena_capacity_) {
+                return true;
+            }
+            size_t holes = arena_tail_ - live_bytes_;
+            if (arena_capacity_ > limit ||
+                (live_bytes_ + size <= arena_capacity_ && (holes >= arena_capacity_ / 4 || arena_capacity_ == limit))) {
+                Compact();
+                if (arena_capacity_ > limit && !ResizeArena(limit)) {
+                    return false;
+                }
+                continue;
+            }
+            size_t capacity = arena_capacity_ > 0 ? arena_capacity_ * 2 : kInitialArenaSize;
+            while (capacity < live_bytes_ + size) {
+                capacity *= 2;
+            }
+            if (!ResizeArena(capacity < limit ? capacity : limit)) {
+                return false;
+            }
+        }
+    }
+
+    bool EntryStore::Put(uint32_t partition, const msdkdns_domain_key &domain, int64_t begin_ms, int64_t expired_ms,
+                         uint8_t flags, const std::vector<std::string> &atoms, const uint8_t *payload, size_t payload_length) {
+        if (domain.id == 0 || atoms.size() > 0xFF || payload_length > kMaxArenaSize) {
+            return false;
+        }
+        // 原有条目无论写入是否成功都不再保留
+        Remove(partition, domain);
+        size_t size = sizeof(Record) + atoms.size() * sizeof(uint32_t) + payload_length;
+        size = (size + kAlignment - 1) & ~(kAlignment - 1);
+        std::vector<uint32_t> ids(atoms.size());
+        for (size_t i = 0; i < atoms.size(); i++) {
+            ids[i] = Intern(atoms[i]);
+        }
+        if (count_ + 1 > capacity_ * 3 / 4 && !GrowIndex()) {
+            for (size_t i = 0; i < ids.size(); i++) {
+                Release(ids[i]);
+            }
+            rejected_++;
+            return false;
+        }
+        if (!Reserve(size, 0)) {
+            for (size_t i = 0; i < ids.size(); i++) {
+                Release(ids[i]);
+            }
+            rejected_++;
+            return false;
+        }
+        uint32_t offset = static_cast<uint32_t>(arena_tail_);
+        Record *record = reinterpret_cast<Record *>(arena_ + offset);
+        arena_tail_ += size;
+        live_bytes_ += size;
+        record->hash = Hash(partition, domain);
+        record->partition = partition;
+        record->domain = domain.id;
+        record->size = static_cast<uint32_t>(size);
+        record->begin_ms = begin_ms;
+        record->expired_ms = expired_ms;
+        record->payload_length = static_cast<uint32_t>(payload_length);
+        record->flags = flags & ~kDeadFlag;
+        record->atom_count = static_cast<uint8_t>(ids.size());
+        record->referenced = 1;
+        for (size_t i = 0; i < ids.size(); i++) {
+            record->Atoms()[i] = ids[i];
+        }
+        if (payload_length > 0) {
+            memcpy(record->Payload(), payload, payload_length);
+        }
+        slots_[Probe(record->hash, partition, domain.id)] = offset + 1;
+        count_++;
+        return true;
+    }
+
+    bool EntryStore::Find(uint32_t partition, const msdkdns_domain_key &domain, msdkdns_entry_view *view) const {
+        bool found = Peek(partition, domain, view);
+        __atomic_add_fetch(found ? &hits_ : &misses_, 1, __ATOMIC_RELAXED);
+        return found;
+    }
+
+    bool EntryStore::Peek(uint32_t partition, const msdkdns_domain_key &domain, msdkdns_entry_view *view) const {
+        uint32_t slot = domain.id ? slots_[Probe(Hash(partition, domain), partition, domain.id)] : 0;
+        if (!slot) {
+            return false;
+        }
+        Record *record = At(slot);
+        if (!__atomic_load_n(&record->referenced, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&record->referenced, 1, __ATOMIC_RELAXED);
+        }
+        if (view) {
+            View(record, view);
+        }
+        return true;
+    }
+
+    bool EntryStore::Contains(uint32_t partition, const msdkdns_domain_key &domain) const {
+        return domain.id && slots_[Probe(Hash(partition, domain), partition, domain.id)] != 0;
+    }
+
+    bool EntryStore::Remove(uint32_t partition, const msdkdns_domain_key &domain) {
+        if (domain.id == 0) {
+            return false;
+        }
+        size_t index = Probe(Hash(partition, domain), partition, domain.id);
+        if (!slots_[index]) {
+            return false;
+        }
+        Record *record = At(slots_[index]);
+        EraseSlot(index);
+        FreeRecord(record);
+        return true;
+    }
+
+    size_t EntryStore::RemovePartition(uint32_t partition) {
+        size_t removed = 0;
+        size_t index = 0;
+        while (index < capacity_) {
+            Record *record = slots_[index] ? At(slots_[index]) : NULL;
+            if (record && record->partition == partition) {
+                // 删除后后续条目可能前移到当前槽，不前进
+                EraseSlot(index);
+                FreeRecord(record);
+                removed++;
+            } else {
+                index++;
+            }
+        }
+        return removed;
+    }
+
+    size_t EntryStore::Count(uint32_t partition) const {
+        size_t count = 0;
+        for (size_t i = 0; i < capacity_; i++) {
+            const Record *record = slots_[i] ? At(slots_[i]) : NULL;
+            if (record && record->partition == partition && !(record->flags & MSDKDNS_EEntryFlag_Removed)) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    void EntryStore::Entries(uint32_t partition, std::vector<msdkdns_entry_view> *views) const {
+        for (size_t i = 0; i < capacity_; i++) {
+            const Record *record = slots_[i] ? At(slots_[i]) : NULL;
+            if (record && record->partition == partition) {
+                msdkdns_entry_view view;
+                View(record, &view);
+                views->push_back(view);
+            }
+        }
+    }
+
+    void EntryStore::Stats(msdkdns_entry_stats *stats) const {
+        size_t fixed = capacity_ * sizeof(uint32_t) + atom_bytes_;
+        stats->hits = __atomic_load_n(&hits_, __ATOMIC_RELAXED);
+        stats->misses = __atomic_load_n(&misses_, __ATOMIC_RELAXED);
+        stats->evictions = evictions_;
+        stats->rejected = rejected_;
+        stats->entries = count_;
+        stats->bytes_used = live_bytes_ + fixed;
+        stats->bytes_reserved = arena_capacity_ + fixed;
+        stats->budget = budget_;
+    }
+
+    const char *EntryStore::AtomText(uint32_t atom, size_t *length) const {
+        if (atom == 0 || atom > atoms_.size()) {
+            *length = 0;
+            return "";
+        }
+        const std::string &text = atoms_[atom - 1].text;
+        *length = text.size();
+        return text.data();
+    }
+
+    uint32_t EntryStore::Intern(const std::string &text) {
+        std::map<std::string, uint32_t>::iterator it = atom_ids_.find(text);
+        if (it != atom_ids_.end()) {
+            atoms_[it->second - 1].refs++;
+            return it->second;
+        }
+        uint32_t atom;
+        if (!free_atoms_.empty()) {
+            atom = free_atoms_.back();
+            free_atoms_.pop_back();
+        } else {
+            atoms_.push_back(Atom());
+            atom = static_cast<uint32_t>(atoms_.size());
+        }
+        atoms_[atom - 1].text = text;
+        atoms_[atom - 1].refs = 1;
+        atom_ids_[text] = atom;
+        atom_bytes_ += text.size() + kAtomOverhead;
+        return atom;
+    }
+
+    void EntryStore::Release(uint32_t atom) {
+        Atom &entry = atoms_[atom - 1];
+        if (--entry.refs > 0) {
+            return;
+        }
+        atom_bytes_ -= entry.text.size() + kAtomOverhead;
+        atom_ids_.erase(entry.text);
+        std::string().swap(entry.text);
+        free_atoms_.push_back(atom);
+    }
+}  // namespace msdkdns
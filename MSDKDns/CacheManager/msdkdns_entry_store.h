@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_ENTRY_STORE_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_ENTRY_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "msdkdns_domain_interner.h"
+
+namespace msdkdns {
+
+    enum MSDKDNS_TEntryFlag {
+        MSDKDNS_EEntryFlag_HttpDns = 1,  // 有 HTTPDNS 结果，begin_ms / expired_ms 有效
+        MSDKDNS_EEntryFlag_Removed = 2,  // 已删除的占位条目，不参与淘汰
+        MSDKDNS_EEntryFlag_Expired = 4,  // 已过 expired_ms，写入时已过期或由 DomainCache 查询时按当前时间标记
+    };
+
+    typedef struct msdkdns_entry_view {
+        uint32_t domain;     // 驻留表中的编号，通过 DomainInterner::Text 取得文本
+        int64_t begin_ms;    // 单调时钟
+        int64_t expired_ms;  // 单调时钟
+        uint8_t flags;
+        const uint32_t *atoms;  // payload 中按下标引用，通过 AtomText 取得文本
+        size_t atom_count;
+        const uint8_t *payload;
+        size_t payload_length;
+    } msdkdns_entry_view;
+
+    typedef struct msdkdns_entry_stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t rejected;      // 单个条目超过预算未写入的次数
+        size_t entries;
+        size_t bytes_used;      // 有效条目、索引及字符串池占用的字节数
+        size_t bytes_reserved;  // 实际申请的字节数，含 arena 中未整理的空洞及未使用的部分，不超过 budget
+        size_t budget;
+    } msdkdns_entry_stats;
+
+    /*
+     * 域名缓存条目存储，以 (partition, 域名驻留编号) 为键，直接使用驻留时计算的哈希
+     * 条目为 arena 中一段连续内存：固定头部、字符串池引用及调用方编码的 payload，索引中只存偏移
+     * 渠道、客户端IP等重复出现的字符串放入带引用计数的字符串池，条目中只存编号
+     * arena 按需倍增，与索引、字符串池合计不超过 budget；空间不足时先整理删除留下的空洞，
+     * 仍不足时按 CLOCK 淘汰：查询命中置引用位，指针扫过时有引用位的清除后跳过，没有的淘汰
+     * 非线程安全，Find / Entries / AtomText / Count 可在读锁下并发调用，其余需加写锁
+     */
+    class EntryStore {
+    public:
+        explicit EntryStore(size_t budget);
+        ~EntryStore();
+
+        // 预算缩小时立即淘汰到预算以内
+        void SetBudget(size_t budget);
+
+        /*
+         * 写入或替换条目，atoms 中的字符串放入字符串池，payload 中按下标引用
+         * 条目超过预算而无法写入时返回 false，该键原有的条目一并删除，不会读到旧的结果
+         */
+        bool Put(uint32_t partition, const msdkdns_domain_key &domain, int64_t begin_ms, int64_t expired_ms,
+                 uint8_t flags, const std::vector<std::string> &atoms, const uint8_t *payload, size_t payload_length);
+        // 命中时置引用位，view 在下一次修改前有效
+        bool Find(uint32_t partition, const msdkdns_domain_key &domain, msdkdns_entry_view *view) const;
+        // 同 Find，不计入命中统计，由调用方自行计数（避免并发读者都写同一个计数器）
+        bool Peek(uint32_t partition, const msdkdns_domain_key &domain, msdkdns_entry_view *view) const;
+        // 不置引用位，不计入命中统计
+        bool Contains(uint32_t partition, const msdkdns_domain_key &domain) const;
+        bool Remove(uint32_t partition, const msdkdns_domain_key &domain);
+        size_t RemovePartition(uint32_t partition);
+        const char *AtomText(uint32_t atom, size_t *length) const;
+
+        size_t Count(uint32_t partition) const;
+        // 不置引用位，不计入命中统计
+        void Entries(uint32_t partition, std::vector<msdkdns_entry_view> *views) const;
+        void Stats(msdkdns_entry_stats *stats) const;
+
+    private:
+        struct Record;
+        struct Atom {
+            std::string text;
+            uint32_t refs;
+        };
+
+        static uint32_t Hash(uint32_t partition, const msdkdns_domain_key &domain);
+        Record *At(uint32_t slot) const;
+        size_t Probe(uint32_t hash, uint32_t partition, uint32_t domain) const;
+        bool GrowIndex();
+        void EraseSlot(size_t index);
+        bool EvictOne(uint32_t keep);
+        void FreeRecord(Record *record);
+        void View(const Record *record, msdkdns_entry_view *view) const;
+
+        size_t ArenaLimit() const;
+        bool ResizeArena(size_t capacity);
+        void Compact();
+        bool Reserve(size_t size, uint32_t keep);
+
+        uint32_t Intern(const std::string &text);
+        void Release(uint32_t atom);
+
+        size_t budget_;
+        uint8_t *arena_;
+        size_t arena_capacity_;
+        size_t arena_tail_;  // 之后为未使用的空间
+        size_t live_bytes_;  // arena 中有效条目的字节数
+        uint32_t *slots_;    // 条目偏移加1，0 表示空槽
+        size_t capacity_;
+        size_t count_;
+        size_t hand_;
+        size_t atom_bytes_;
+        std::map<std::string, uint32_t> atom_ids_;
+        std::vector<Atom> atoms_;  // 下标为编号减1
+        std::vector<uint32_t> free_atoms_;
+        mutable uint64_t hits_;
+        mutable uint64_t misses_;
+        uint64_t evictions_;
+        uint64_t rejected_;
+
+        EntryStore(const EntryStore &);
+        EntryStore &operator=(const EntryStore &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_ENTRY_STORE_H_
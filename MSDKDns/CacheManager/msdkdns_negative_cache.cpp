@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_negative_cache.h"
+#include <limits.h>
+
+namespace msdkdns {
+
+    // 没有结果的域名通常短时间内不会变化，退避时间较长；请求失败多为网络或服务端的临时问题，退避时间较短
+    static const int64_t kNoDataBaseMs = 5 * 1000;
+    static const int64_t kNoDataMaxMs = 5 * 60 * 1000;
+    static const int64_t kUnresolvedBaseMs = 1000;
+    static const int64_t kUnresolvedMaxMs = 30 * 1000;
+    // 退避时间随机缩短的最大比例
+    static const double kJitterRatio = 0.2;
+    // 距上次失败超过该时间后，再次失败时重新从 base 开始退避
+    static const int64_t kForgetMs = 10 * 60 * 1000;
+
+    NegativeCache::NegativeCache(size_t max_entries, uint32_t seed)
+        : max_entries_(max_entries > 0 ? max_entries : 1), random_(seed ? seed : 0x9E3779B9u) {
+        stats_.failures = 0;
+        stats_.blocked = 0;
+        stats_.recovered = 0;
+        stats_.entries = 0;
+    }
+
+    double NegativeCache::NextRandom() {
+        // xorshift32，仅用于抖动
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        return (random_ >> 8) / 16777216.0;
+    }
+
+    void NegativeCache::RecordFailure(uint32_t domain, int type, MSDKDNS_TNegativeKind kind, int64_t now_ms) {
+        if (domain == 0) {
+            return;
+        }
+        Failure(Key(domain, std::string(), type), kind, now_ms);
+    }
+
+    void NegativeCache::RecordFailure(const std::string &name, int type, MSDKDNS_TNegativeKind kind, int64_t now_ms) {
+        if (name.empty()) {
+            return;
+        }
+        Failure(Key(0, name, type), kind, now_ms);
+    }
+
+    void NegativeCache::RecordSuccess(uint32_t domain, int type) {
+        Success(Key(domain, std::string(), type));
+    }
+
+    void NegativeCache::RecordSuccess(const std::string &name, int type) {
+        Success(Key(0, name, type));
+    }
+
+    bool NegativeCache::Blocked(uint32_t domain, int type, int64_t now_ms, int64_t *remaining_ms) {
+        return IsBlocked(Key(domain, std::string(), type), now_ms, remaining_ms);
+    }
+
+    bool NegativeCache::Blocked(const std::string &name, int type, int64_t now_ms, int64_t *remaining_ms) {
+        return IsBlocked(Key(0, name, type), now_ms, remaining_ms);
+    }
+
+    void NegativeCache::Remove(uint32_t domain) {
+        RemoveAll(domain, std::string());
+    }
+
+    void NegativeCache::Remove(const std::string &name) {
+        RemoveAll(0, name);
+    }
+
+    void NegativeCache::Failure(const Key &key, MSDKDNS_TNegativeKind kind, int64_t now_ms) {
+        stats_.failures++;
+        std::map<Key, Entry>::iterator it = entries_.find(key);
+        if (it == entries_.end()) {
+            if (entries_.size() >= max_entries_) {
+                Evict(now_ms);
+            }
+            Entry entry;
+            entry.failures = 0;
+            entry.failed_at_ms = now_ms;
+            entry.retry_at_ms = now_ms;
+            it = entries_.insert(std::make_pair(key, entry)).first;
+        }
+        Entry &entry = it->second;
+        if (now_ms - entry.failed_at_ms > kForgetMs) {
+            entry.failures = 0;
+        }
+        entry.failures++;
+        entry.failed_at_ms = now_ms;
+        int64_t base = kind == MSDKDNS_ENegativeKind_NoData ? kNoDataBaseMs : kUnresolvedBaseMs;
+        int64_t max = kind == MSDKDNS_ENegativeKind_NoData ? kNoDataMaxMs : kUnresolvedMaxMs;
+        int64_t backoff = base;
+        for (uint32_t i = 1; i < entry.failures && backoff < max; i++) {
+            backoff *= 2;
+        }
+        if (backoff > max) {
+            backoff = max;
+        }
+        backoff -= static_cast<int64_t>(backoff * kJitterRatio * NextRandom());
+        entry.retry_at_ms = now_ms + backoff;
+        stats_.entries = entries_.size();
+    }
+
+    void NegativeCache::Success(const Key &key) {
+        std::map<Key, Entry>::iterator it = entries_.find(key);
+        if (it == entries_.end()) {
+            return;
+        }
+        entries_.erase(it);
+        stats_.recovered++;
+        stats_.entries = entries_.size();
+    }
+
+    bool NegativeCache::IsBlocked(const Key &key, int64_t now_ms, int64_t *remaining_ms) {
+        std::map<Key, Entry>::const_iterator it = entries_.find(key);
+        if (it == entries_.end() || now_ms >= it->second.retry_at_ms) {
+            return false;
+        }
+        stats_.blocked++;
+        if (remaining_ms) {
+            *remaining_ms = it->second.retry_at_ms - now_ms;
+        }
+        return true;
+    }
+
+    void NegativeCache::RemoveAll(uint32_t domain, const std::string &name) {
+        // 同一域名的各查询类型相邻
+        std::map<Key, Entry>::iterator it = entries_.lower_bound(Key(domain, name, INT_MIN));
+        while (it != entries_.end() && it->first.domain == domain && it->first.name == name) {
+            entries_.erase(it++);
+        }
+        stats_.entries = entries_.size();
+    }
+
+    void NegativeCache::Clear() {
+        entries_.clear();
+        stats_.entries = 0;
+    }
+
+    void NegativeCache::Evict(int64_t now_ms) {
+        // 先清除已过期且长时间没有失败的记录，仍超出上限时淘汰最早可以重试的记录
+        std::map<Key, Entry>::iterator earliest = entries_.end();
+        for (std::map<Key, Entry>::iterator it = entries_.begin(); it != entries_.end();) {
+            if (now_ms >= it->second.retry_at_ms && now_ms - it->second.failed_at_ms > kForgetMs) {
+                entries_.erase(it++);
+                continue;
+            }
+            if (earliest == entries_.end() || it->second.retry_at_ms < earliest->second.retry_at_ms) {
+                earliest = it;
+            }
+            ++it;
+        }
+        if (entries_.size() >= max_entries_ && earliest != entries_.end()) {
+            entries_.erase(earliest);
+        }
+    }
+
+    void NegativeCache::Stats(msdkdns_negative_stats *stats) const {
+        *stats = stats_;
+    }
+}  // namespace msdkdns
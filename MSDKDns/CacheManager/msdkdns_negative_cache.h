@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_NEGATIVE_CACHE_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_NEGATIVE_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+
+namespace msdkdns {
+
+    enum MSDKDNS_TNegativeKind {
+        MSDKDNS_ENegativeKind_NoData = 0,      // 解析成功但没有结果，或结果格式不正确
+        MSDKDNS_ENegativeKind_Unresolved = 1,  // 请求重试后仍失败
+    };
+
+    typedef struct msdkdns_negative_stats {
+        uint64_t failures;   // 记录的失败次数
+        uint64_t blocked;    // 退避期内直接返回失败的查询次数
+        uint64_t recovered;  // 失败后又解析成功的次数
+        size_t entries;
+    } msdkdns_negative_stats;
+
+    /*
+     * 解析失败域名的负缓存
+     * 按域名编号（见 msdkdns_domain_interner.h）和查询类型（A、AAAA、双栈，由调用方传入的整数区分）分别记录连续失败次数，
+     * 无法驻留的域名（不合法或驻留表已满）以规范化前的字符串为键，与编号共用上限和淘汰
+     * 每次失败后退避 base * 2^(n-1)，不超过上限，并随机缩短至多 kJitterRatio，避免同一批失败的域名同时重试
+     * 退避期内查询直接返回失败，不再发出请求；解析成功后清除记录；长时间没有再失败的记录重新从 base 开始退避
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class NegativeCache {
+    public:
+        NegativeCache(size_t max_entries, uint32_t seed);
+
+        void RecordFailure(uint32_t domain, int type, MSDKDNS_TNegativeKind kind, int64_t now_ms);
+        void RecordSuccess(uint32_t domain, int type);
+        // 在退避期内时返回 true 并计入 blocked，remaining_ms 可为 NULL
+        bool Blocked(uint32_t domain, int type, int64_t now_ms, int64_t *remaining_ms);
+        // 清除域名所有查询类型的记录
+        void Remove(uint32_t domain);
+        // 以下为无法驻留的域名使用的字符串键版本，空字符串不记录
+        void RecordFailure(const std::string &name, int type, MSDKDNS_TNegativeKind kind, int64_t now_ms);
+        void RecordSuccess(const std::string &name, int type);
+        bool Blocked(const std::string &name, int type, int64_t now_ms, int64_t *remaining_ms);
+        void Remove(const std::string &name);
+        void Clear();
+        void Stats(msdkdns_negative_stats *stats) const;
+
+    private:
+        // 编号为0时以 name 为键
+        struct Key {
+            uint32_t domain;
+            std::string name;
+            int type;
+
+            Key(uint32_t d, const std::string &n, int t) : domain(d), name(n), type(t) {}
+            bool operator<(const Key &other) const {
+                if (domain != other.domain) {
+                    return domain < other.domain;
+                }
+                int order = name.compare(other.name);
+                return order != 0 ? order < 0 : type < other.type;
+            }
+        };
+
+        struct Entry {
+            uint32_t failures;
+            int64_t failed_at_ms;
+            int64_t retry_at_ms;
+        };
+
+        double NextRandom();
+        void Evict(int64_t now_ms);
+        void Failure(const Key &key, MSDKDNS_TNegativeKind kind, int64_t now_ms);
+        void Success(const Key &key);
+        bool IsBlocked(const Key &key, int64_t now_ms, int64_t *remaining_ms);
+        void RemoveAll(uint32_t domain, const std::string &name);
+
+        std::map<Key, Entry> entries_;
+        size_t max_entries_;
+        uint32_t random_;
+        msdkdns_negative_stats stats_;
+
+        NegativeCache(const NegativeCache &);
+        NegativeCache &operator=(const NegativeCache &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_NEGATIVE_CACHE_H_
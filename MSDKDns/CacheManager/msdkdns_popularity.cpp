@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_popularity.h"
+
+namespace msdkdns {
+
+    // 计数上限，减半衰减下不会长期停留在上限
+    static const uint8_t kMaxCount = 255;
+    // 长时间未访问时最多减半的次数，超过后计数均已归零
+    static const int kMaxHalvings = 8;
+    static const int64_t kMsPerMinute = 60 * 1000;
+
+    PopularitySketch::PopularitySketch(size_t width, int64_t decay_ms, int64_t now_ms)
+        : mask_(0), decay_ms_(decay_ms > 0 ? decay_ms : 1), decayed_at_ms_(now_ms), touches_(0) {
+        size_t size = 1;
+        while (size < width) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        counters_.assign(size * kDepth, 0);
+    }
+
+    void PopularitySketch::Indexes(const char *key, size_t length, size_t *indexes) const {
+        // FNV-1a 64位，高低32位组合出 kDepth 个独立的下标
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<uint8_t>(key[i]);
+            hash *= 1099511628211ULL;
+        }
+        uint32_t h1 = static_cast<uint32_t>(hash);
+        uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+        for (int i = 0; i < kDepth; i++) {
+            indexes[i] = i * (mask_ + 1) + ((h1 + i * h2) & mask_);
+        }
+    }
+
+    void PopularitySketch::Halve(int times) {
+        if (times >= kMaxHalvings) {
+            Clear();
+            return;
+        }
+        for (size_t i = 0; i < counters_.size(); i++) {
+            counters_[i] = static_cast<uint8_t>(counters_[i] >> times);
+        }
+        touches_ >>= times;
+    }
+
+    void PopularitySketch::DecayTo(int64_t now_ms) {
+        if (now_ms - decayed_at_ms_ < decay_ms_) {
+            return;
+        }
+        int64_t periods = (now_ms - decayed_at_ms_) / decay_ms_;
+        decayed_at_ms_ += periods * decay_ms_;
+        Halve(periods > kMaxHalvings ? kMaxHalvings : static_cast<int>(periods));
+    }
+
+    uint32_t PopularitySketch::Touch(const char *key, size_t length, int64_t now_ms) {
+        DecayTo(now_ms);
+        size_t indexes[kDepth];
+        Indexes(key, length, indexes);
+        uint8_t min = kMaxCount;
+        for (int i = 0; i < kDepth; i++) {
+            if (counters_[indexes[i]] < min) {
+                min = counters_[indexes[i]];
+            }
+        }
+        // 只增加最小的计数（conservative update），减小哈希冲突带来的高估
+        if (min < kMaxCount) {
+            min++;
+            for (int i = 0; i < kDepth; i++) {
+                if (counters_[indexes[i]] < min) {
+                    counters_[indexes[i]] = min;
+                }
+            }
+        }
+        if (++touches_ >= mask_ + 1) {
+            Halve(1);
+        }
+        return min;
+    }
+
+    uint32_t PopularitySketch::Estimate(const char *key, size_t length, int64_t now_ms) {
+        DecayTo(now_ms);
+        size_t indexes[kDepth];
+        Indexes(key, length, indexes);
+        uint8_t min = kMaxCount;
+        for (int i = 0; i < kDepth; i++) {
+            if (counters_[indexes[i]] < min) {
+                min = counters_[indexes[i]];
+            }
+        }
+        return min;
+    }
+
+    void PopularitySketch::Clear() {
+        counters_.assign(counters_.size(), 0);
+        touches_ = 0;
+    }
+
+    RefreshBudget::RefreshBudget(uint32_t per_minute, int64_t now_ms)
+        : per_minute_(per_minute), tokens_(per_minute), refilled_at_ms_(now_ms) {
+    }
+
+    void RefreshBudget::SetRate(uint32_t per_minute, int64_t now_ms) {
+        Refill(now_ms);
+        per_minute_ = per_minute;
+        if (tokens_ > per_minute_) {
+            tokens_ = per_minute_;
+        }
+    }
+
+    uint32_t RefreshBudget::Rate() const {
+        return per_minute_;
+    }
+
+    void RefreshBudget::Refill(int64_t now_ms) {
+        if (now_ms > refilled_at_ms_) {
+            tokens_ += static_cast<double>(now_ms - refilled_at_ms_) * per_minute_ / kMsPerMinute;
+            if (tokens_ > per_minute_) {
+                tokens_ = per_minute_;
+            }
+        }
+        refilled_at_ms_ = now_ms;
+    }
+
+    bool RefreshBudget::TryAcquire(int64_t now_ms) {
+        Refill(now_ms);
+        if (tokens_ < 1) {
+            return false;
+        }
+        tokens_ -= 1;
+        return true;
+    }
+}  // namespace msdkdns
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_POPULARITY_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_POPULARITY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace msdkdns {
+
+    /*
+     * 域名访问频率统计，count-min sketch 实现，内存固定，与域名数量无关
+     * 每 decay_ms 或累计 width 次访问后所有计数减半，估计值反映最近一段时间的访问次数
+     * 估计值只会偏大不会偏小，误差随 width 增大而减小
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class PopularitySketch {
+    public:
+        // width 向上取整为2的幂
+        PopularitySketch(size_t width, int64_t decay_ms, int64_t now_ms);
+
+        // 记录一次访问，返回记录后的估计次数
+        uint32_t Touch(const char *key, size_t length, int64_t now_ms);
+        uint32_t Estimate(const char *key, size_t length, int64_t now_ms);
+        void Clear();
+
+    private:
+        enum {
+            kDepth = 4,
+        };
+
+        void Indexes(const char *key, size_t length, size_t *indexes) const;
+        void DecayTo(int64_t now_ms);
+        void Halve(int times);
+
+        std::vector<uint8_t> counters_;
+        size_t mask_;
+        int64_t decay_ms_;
+        int64_t decayed_at_ms_;
+        uint32_t touches_;
+
+        PopularitySketch(const PopularitySketch &);
+        PopularitySketch &operator=(const PopularitySketch &);
+    };
+
+    /*
+     * 令牌桶，限制后台刷新请求的频率，桶容量为每分钟的请求数，允许短时突发
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class RefreshBudget {
+    public:
+        RefreshBudget(uint32_t per_minute, int64_t now_ms);
+
+        // per_minute 为 0 时不再放行任何请求
+        void SetRate(uint32_t per_minute, int64_t now_ms);
+        uint32_t Rate() const;
+        // 有可用令牌时消耗一个并返回 true
+        bool TryAcquire(int64_t now_ms);
+
+    private:
+        void Refill(int64_t now_ms);
+
+        uint32_t per_minute_;
+        double tokens_;
+        int64_t refilled_at_ms_;
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_POPULARITY_H_
@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_single_flight.h"
+#include <set>
+
+namespace msdkdns {
+
+    void SingleFlight::Join(const std::vector<std::string> &keys, void *waiter, std::vector<size_t> *starts,
+                            std::vector<size_t> *coalesced) {
+        std::set<std::string> seen;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!seen.insert(keys[i]).second) {
+                continue;
+            }
+            std::map<std::string, std::vector<void *> >::iterator it = inflight_.find(keys[i]);
+            if (it == inflight_.end()) {
+                inflight_[keys[i]];
+                starts->push_back(i);
+                continue;
+            }
+            if (waiter) {
+                it->second.push_back(waiter);
+            }
+            coalesced->push_back(i);
+        }
+    }
+
+    void SingleFlight::Complete(const std::vector<std::string> &keys, std::vector<void *> *waiters) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            std::map<std::string, std::vector<void *> >::iterator it = inflight_.find(keys[i]);
+            if (it == inflight_.end()) {
+                continue;
+            }
+            waiters->insert(waiters->end(), it->second.begin(), it->second.end());
+            inflight_.erase(it);
+        }
+    }
+
+    bool SingleFlight::InFlight(const std::string &key) const {
+        return inflight_.count(key) > 0;
+    }
+
+    size_t SingleFlight::Size() const {
+        return inflight_.size();
+    }
+}  // namespace msdkdns
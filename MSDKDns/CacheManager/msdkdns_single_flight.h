@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_SINGLE_FLIGHT_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_SINGLE_FLIGHT_H_
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    /*
+     * 在途解析请求表（single-flight）
+     * 同一个键在请求结束前只有一个发起方，之后登记的调用挂到在途请求上等待，键由调用方拼接（SDK 中为 域名|网络栈|routeIp）
+     * 请求结束时无论成功失败都由发起方调用 Complete，挂在上面的 waiter 全部返回；失败不留记录，下次登记重新发起
+     * waiter 为调用方的不透明指针（SDK 中为 dispatch_group_t），挂上几次就返回几次
+     * 非线程安全，需由调用方保证串行访问（SDK 中每个 lane 一张表，只在该 lane 的任务中访问）
+     */
+    class SingleFlight {
+    public:
+        SingleFlight() {}
+
+        // 登记一批键，下标按传入顺序写入：未在途的登记为在途，写入 starts，由调用方发起请求；
+        // 已在途的挂上 waiter（为 NULL 时不挂），写入 coalesced
+        // 同一批中重复的键只按第一次处理，不会挂到本批自己发起的请求上
+        void Join(const std::vector<std::string> &keys, void *waiter, std::vector<size_t> *starts,
+                  std::vector<size_t> *coalesced);
+        // 发起方的请求结束，移除这些键，挂在上面的 waiter 按挂上的顺序追加到 waiters；不在途的键忽略
+        void Complete(const std::vector<std::string> &keys, std::vector<void *> *waiters);
+        bool InFlight(const std::string &key) const;
+        size_t Size() const;
+
+    private:
+        std::map<std::string, std::vector<void *> > inflight_;
+
+        SingleFlight(const SingleFlight &);
+        SingleFlight &operator=(const SingleFlight &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_SINGLE_FLIGHT_H_
@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_timer_wheel.h"
+#include <time.h>
+
+namespace msdkdns {
+
+    int64_t msdkdns_monotonic_ms() {
+        // CLOCK_MONOTONIC 在 Darwin 上包含设备休眠时间，与TTL语义一致
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    TimerWheel::TimerWheel(int64_t tick_ms, int64_t now_ms)
+        : tick_ms_(tick_ms > 0 ? tick_ms : 1)
+        , current_tick_(now_ms / (tick_ms > 0 ? tick_ms : 1))
+        , size_(0) {
+        for (int level = 0; level < kLevels; level++) {
+            for (int slot = 0; slot < kSlots; slot++) {
+                slots_[level][slot] = 0;
+            }
+        }
+    }
+
+    bool TimerWheel::Schedule(uint32_t key, int64_t deadline_ms) {
+        if (key == 0 || deadline_ms < 0) {
+            return false;
+        }
+        if (key >= nodes_.size()) {
+            Node empty = {0, 0, 0, 0, 0, false};
+            nodes_.resize(key + 1, empty);
+        }
+        Node &node = nodes_[key];
+        if (node.scheduled) {
+            Unlink(key);
+        } else {
+            node.scheduled = true;
+            size_++;
+        }
+        // 向上取整，保证任务不会早于 deadline 触发
+        node.deadline_tick = (deadline_ms + tick_ms_ - 1) / tick_ms_;
+        Place(key, current_tick_ + 1);
+        return true;
+    }
+
+    bool TimerWheel::Cancel(uint32_t key) {
+        if (!Contains(key)) {
+            return false;
+        }
+        Unlink(key);
+        nodes_[key].scheduled = false;
+        size_--;
+        return true;
+    }
+
+    bool TimerWheel::Contains(uint32_t key) const {
+        return key < nodes_.size() && nodes_[key].scheduled;
+    }
+
+    void TimerWheel::Advance(int64_t now_ms, std::vector<uint32_t> *fired) {
+        int64_t target_tick = now_ms / tick_ms_;
+        while (current_tick_ < target_tick && size_ > 0) {
+            current_tick_++;
+            int index = (int)(current_tick_ & kSlotMask);
+            if (index == 0) {
+                // 低层转完一圈，将上层对应槽的任务下放
+                for (int level = 1; level < kLevels; level++) {
+                    int level_index = (int)((current_tick_ >> (kSlotBits * level)) & kSlotMask);
+                    Cascade(level, level_index);
+                    if (level_index != 0) {
+                        break;
+                    }
+                }
+            }
+            uint32_t key = slots_[0][index];
+            slots_[0][index] = 0;
+            while (key) {
+                Node &node = nodes_[key];
+                uint32_t next = node.next;
+                node.prev = 0;
+                node.next = 0;
+                if (node.deadline_tick <= current_tick_) {
+                    if (fired) {
+                        fired->push_back(key);
+                    }
+                    node.scheduled = false;
+                    size_--;
+                } else {
+                    // 超出时间轮范围被截断的任务，重新放置
+                    Place(key, current_tick_ + 1);
+                }
+                key = next;
+            }
+        }
+        if (current_tick_ < target_tick) {
+            current_tick_ = target_tick;
+        }
+    }
+
+    bool TimerWheel::NextDeadline(int64_t *deadline_ms) const {
+        if (size_ == 0) {
+            return false;
+        }
+        // 每层按时间顺序找第一个非空槽，取各层中最早的时间；上层的槽从下一格找起，多找一格覆盖被截断回绕的任务
+        int64_t next_tick = -1;
+        for (int level = 0; level < kLevels; level++) {
+            int shift = kSlotBits * level;
+            for (int64_t step = 1; step <= kSlots; step++) {
+                int64_t tick = ((current_tick_ >> shift) + step) << shift;
+                if (next_tick >= 0 && tick >= next_tick) {
+                    break;
+                }
+                if (slots_[level][(tick >> shift) & kSlotMask]) {
+                    next_tick = tick;
+                    break;
+                }
+            }
+        }
+        if (next_tick < 0) {
+            next_tick = current_tick_ + 1;
+        }
+        *deadline_ms = next_tick * tick_ms_;
+        return true;
+    }
+
+    size_t TimerWheel::Size() const {
+        return size_;
+    }
+
+    bool TimerWheel::Empty() const {
+        return size_ == 0;
+    }
+
+    void TimerWheel::Place(uint32_t key, int64_t min_tick) {
+        Node &node = nodes_[key];
+        int64_t expires = node.deadline_tick;
+        // 已过期的任务在 min_tick 触发
+        if (expires < min_tick) {
+            expires = min_tick;
+        }
+        int64_t delta = expires - current_tick_;
+        int level = 0;
+        while (level < kLevels - 1 && delta >= ((int64_t)1 << (kSlotBits * (level + 1)))) {
+            level++;
+        }
+        int64_t max_delta = ((int64_t)1 << (kSlotBits * kLevels)) - 1;
+        if (delta > max_delta) {
+            expires = current_tick_ + max_delta;
+        }
+        int slot = (int)((expires >> (kSlotBits * level)) & kSlotMask);
+        node.level = (uint8_t)level;
+        node.slot = (uint8_t)slot;
+        node.prev = 0;
+        node.next = slots_[level][slot];
+        if (node.next) {
+            nodes_[node.next].prev = key;
+        }
+        slots_[level][slot] = key;
+    }
+
+    void TimerWheel::Unlink(uint32_t key) {
+        Node &node = nodes_[key];
+        if (node.prev) {
+            nodes_[node.prev].next = node.next;
+        } else if (slots_[node.level][node.slot] == key) {
+            slots_[node.level][node.slot] = node.next;
+        }
+        if (node.next) {
+            nodes_[node.next].prev = node.prev;
+        }
+        node.prev = 0;
+        node.next = 0;
+    }
+
+    void TimerWheel::Cascade(int level, int index) {
+        uint32_t key = slots_[level][index];
+        slots_[level][index] = 0;
+        while (key) {
+            uint32_t next = nodes_[key].next;
+            // 下放时当前tick尚未处理，到期的任务可在本tick触发
+            Place(key, current_tick_);
+            key = next;
+        }
+    }
+}  // namespace msdkdns
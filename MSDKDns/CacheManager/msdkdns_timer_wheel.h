@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_TIMER_WHEEL_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace msdkdns {
+
+    // 单调时钟，单位ms，不受系统时间修改影响
+    int64_t msdkdns_monotonic_ms();
+
+    /*
+     * 分层时间轮，用于TTL刷新、保活等延时任务调度
+     * 共4层，每层64个槽，tick为1s时可覆盖约194天，超出范围的任务放在最高层最后一个槽
+     * key 为从1开始的较小整数（如域名驻留编号），节点按 key 直接下标存放，槽内以下标串成链表，
+     * Schedule / Cancel 为 O(1)，除节点表随最大 key 增长外不分配内存
+     * 时间轮本身不读取时钟，由调用方通过 Advance 传入当前时间，便于使用虚拟时钟测试
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class TimerWheel {
+    public:
+        TimerWheel(int64_t tick_ms, int64_t now_ms);
+
+        // 按 key 调度任务，key 已存在时覆盖原有任务，返回 false 表示参数非法（key 为0或 deadline 为负）
+        bool Schedule(uint32_t key, int64_t deadline_ms);
+        // 取消任务，返回 key 是否存在
+        bool Cancel(uint32_t key);
+        bool Contains(uint32_t key) const;
+        // 推进时间轮到 now_ms，已到期的任务 key 按到期顺序追加到 fired
+        void Advance(int64_t now_ms, std::vector<uint32_t> *fired);
+        /*
+         * 下一次需要调用 Advance 的时间，不晚于最早的任务，没有任务时返回 false
+         * 最早的任务在上层时返回其下放的时间，调用方到时 Advance 后再取一次
+         */
+        bool NextDeadline(int64_t *deadline_ms) const;
+        size_t Size() const;
+        bool Empty() const;
+
+    private:
+        enum {
+            kLevels = 4,
+            kSlotBits = 6,
+            kSlots = 1 << kSlotBits,
+            kSlotMask = kSlots - 1,
+        };
+
+        // 下标为 key，prev / next 为同一槽中相邻节点的 key，0 表示没有
+        struct Node {
+            int64_t deadline_tick;
+            uint32_t prev;
+            uint32_t next;
+            uint8_t level;
+            uint8_t slot;
+            bool scheduled;
+        };
+
+        void Place(uint32_t key, int64_t min_tick);
+        void Unlink(uint32_t key);
+        void Cascade(int level, int index);
+
+        int64_t tick_ms_;
+        int64_t current_tick_;
+        uint32_t slots_[kLevels][kSlots];  // 槽中第一个节点的 key
+        std::vector<Node> nodes_;
+        size_t size_;
+
+        TimerWheel(const TimerWheel &);
+        TimerWheel &operator=(const TimerWheel &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_CACHEMANAGER_MSDKDNS_TIMER_WHEEL_H_
@@ -3,6 +3,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "MSDKDnsSnapshot.h"
 
 @interface MSDKDnsDB : NSObject
 
@@ -10,13 +11,31 @@
 
 + (instancetype)shareInstance;
 
+// 写入和删除先合并在内存中，延迟或积压到一定数量后在一个事务内批量落盘
 - (void)insertOrReplaceDomainInfo:(NSDictionary *)domainInfo domain:(NSString *)domain;
 
+// 表中的数据整体替换为 domainInfos，如切换缓存分区时；推迟到进入后台等显式落盘时写入，只写入和删除与表中不同的域名
+- (void)replaceAllDomainInfos:(NSDictionary *)domainInfos;
+
 - (NSDictionary *)getDataFromDB;
 
 - (void)deleteDBData: (NSArray *)domains;
 
 - (void)deleteAllData;
 
+// 立即落盘未写入的数据，如进入后台时；同步执行，会阻塞到写入完成，不要在主线程调用
+- (void)flushPendingWrites;
+
+// 打开持久化缓存的快照，不存在或损坏时从数据库重新生成，失败返回 nil
+- (MSDKDnsSnapshot *)loadSnapshot;
+
+// IP RTT历史，key 为 "ip|port"，value 为 kMSDKDnsRttSRTT 等字段组成的字典
+- (void)insertOrReplaceIPRttRecords:(NSDictionary *)records;
+
+// 删除被淘汰的 IP RTT历史
+- (void)deleteIPRttRecords:(NSArray *)keys;
+
+- (NSDictionary *)getIPRttRecordsFromDB;
+
 @end
 
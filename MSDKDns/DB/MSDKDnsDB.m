@@ -7,13 +7,44 @@
 #import "MSDKDnsInfoTool.h"
 #import "MSDKDnsPrivate.h"
 #import <sqlite3.h>
+#import <unistd.h>
+#include "msdkdns_db_writer.h"
+#include "msdkdns_snapshot.h"
 
+// 有写入后延迟落盘的时间，合并短时间内的多次写入，单位s
+static const int64_t kMSDKDnsDBFlushDelay = 2;
+// 待写入域名数达到该值时立即落盘
+static const size_t kMSDKDnsDBFlushThreshold = 32;
+// 落盘持续失败时内存中最多积压的待写入域名数，超过后丢弃并在恢复后清空表
+static const size_t kMSDKDnsDBMaxPending = 1024;
+// 落盘失败后重试的最长间隔，从 kMSDKDnsDBFlushDelay 开始逐次翻倍，单位s
+static const int64_t kMSDKDnsDBMaxRetryDelay = 60;
+// 落盘改变了表中内容后重新生成快照的延迟，期间的多次落盘合并为一次重写，单位s
+static const int64_t kMSDKDnsDBSnapshotDelay = 30;
 
-@interface MSDKDnsDB ()
+static const void * const kMSDKDnsDBQueueKey = &kMSDKDnsDBQueueKey;
+
+@interface MSDKDnsDB () {
+    msdkdns::DBWriter * _writer;
+}
 
 @property (nonatomic,assign) sqlite3 *db;
 @property char *error;
-
+// 数据库的所有读写都在该串行队列中执行
+@property (nonatomic, strong) dispatch_queue_t dbQueue;
+@property (nonatomic, assign) BOOL flushScheduled;
+// 上次落盘失败后的重试间隔，0 表示上次落盘成功
+@property (nonatomic, assign) int64_t retryDelay;
+// HttpDNSTable 的二进制快照，只在启动时读取
+// 落盘时不再整体重写：首次落盘使快照与数据库不一致时删除快照，kMSDKDnsDBSnapshotDelay 后重新生成，
+// 进入后台和关闭时也立即生成；删除后、重新生成前异常退出则在下次启动时从数据库重新生成
+@property (nonatomic, copy) NSString *snapshotPath;
+// 快照已删除、待重新生成
+@property (nonatomic, assign) BOOL snapshotStale;
+@property (nonatomic, assign) BOOL snapshotScheduled;
+// 切换缓存分区后的整表替换尚未落盘，期间只在进入后台、关闭等显式落盘时写入，
+// 前台来回切换网络时合并为一次与表中内容比较后的写入
+@property (nonatomic, assign) BOOL replacePending;
 
 @end
 
@@ -33,15 +64,25 @@ static MSDKDnsDB * gSharedInstance = nil;
 
 - (instancetype) init {
     if (self = [super init]) {
+        _dbQueue = dispatch_queue_create("com.tencent.msdkdns.db_queue", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(_dbQueue, kMSDKDnsDBQueueKey, (void *)kMSDKDnsDBQueueKey, NULL);
+        _flushScheduled = NO;
+        _retryDelay = 0;
+        _snapshotStale = NO;
+        _snapshotScheduled = NO;
         @try {
             NSArray *documentPaths = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory,NSUserDomainMask,YES);
             NSString *baseDirectory = [documentPaths objectAtIndex:0];
             
             // 设置数据库文件路径
             NSString *fileName = [baseDirectory stringByAppendingPathComponent:@"httpdns.sqlite"];
+            _snapshotPath = [baseDirectory stringByAppendingPathComponent:@"httpdns.snapshot"];
             //打开数据库文件（如果数据库文件不存在，那么该函数会自动创建数据库文件）
             int result = sqlite3_open([fileName UTF8String], &_db);
             if (result == SQLITE_OK) {//打开成功
+                // WAL 模式下写入不阻塞读取，synchronous=NORMAL 时只在 checkpoint 时 fsync
+                sqlite3_exec(_db, "PRAGMA journal_mode=WAL", NULL, NULL, NULL);
+                sqlite3_exec(_db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
                 NSString *createSql = @"create table if not exists HttpDNSTable(id integer primary key autoincrement, domain text UNIQUE, httpDnsIPV4Channel text, httpDnsIPV4ClientIP text, httpDnsIPV4IPs text, httpDnsIPV4TimeConsuming text, httpDnsIPV4TTL text, httpDnsIPV4TTLExpried text, httpDnsIPV6Channel text, httpDnsIPV6ClientIP text, httpDnsIPV6IPs text, httpDnsIPV6TimeConsuming text, httpDnsIPV6TTL text, httpDnsIPV6TTLExpried text)";
                 
                 if (sqlite3_exec(_db, [createSql UTF8String], NULL, NULL, &_error) == SQLITE_OK) {
@@ -52,6 +93,12 @@ static MSDKDnsDB * gSharedInstance = nil;
                     // 每次使用完毕清空 error 字符串，提供给下一次使用
                     sqlite3_free(_error);
                 }
+                NSString *createRttSql = @"create table if not exists IPRttTable(key text primary key, srtt real, rttvar real, failRate real, samples integer, updated integer)";
+                if (sqlite3_exec(_db, [createRttSql UTF8String], NULL, NULL, &_error) != SQLITE_OK) {
+                    MSDKDNSLOG(@"Failed to create rtt table into database, error: %s", _error);
+                    sqlite3_free(_error);
+                }
+                _writer = new msdkdns::DBWriter(_db, kMSDKDnsDBMaxPending);
             }else{
                 MSDKDNSLOG(@"Failed to open Database");
             }
@@ -63,89 +110,128 @@ static MSDKDnsDB * gSharedInstance = nil;
 }
 
 - (void)insertOrReplaceDomainInfo:(NSDictionary *)domainInfo domain:(NSString *)domain {
-    
     @try {
-        NSDictionary * hresultDict_A = domainInfo[kMSDKHttpDnsCache_A];
-        NSDictionary * hresultDict_4A = domainInfo[kMSDKHttpDnsCache_4A];
-        
-        NSString *hresultDict_A_kChannel = @"";
-        NSString *hresultDict_A_kClientIP = @"";
-        NSString *hresultDict_A_kIP = @"";
-        NSString *hresultDict_A_kDnsTimeConsuming = @"";
-        NSString *hresultDict_A_kTTL = @"";
-        NSString *hresultDict_A_kTTLExpired = @"";
-        NSString *hresultDict_4A_kChannel = @"";
-        NSString *hresultDict_4A_kClientIP = @"";
-        NSString *hresultDict_4A_kIP = @"";
-        NSString *hresultDict_4A_kDnsTimeConsuming = @"";
-        NSString *hresultDict_4A_kTTL = @"";
-        NSString *hresultDict_4A_kTTLExpired = @"";
-        
-        if(hresultDict_A){
-            if(hresultDict_A[kChannel]){
-                hresultDict_A_kChannel = hresultDict_A[kChannel];
-            }
-            if(hresultDict_A[kClientIP]){
-                hresultDict_A_kClientIP = hresultDict_A[kClientIP];
-            }
-            if(hresultDict_A[kIP]){
-                hresultDict_A_kIP = [hresultDict_A[kIP] componentsJoinedByString:@","];
-            }
-            if(hresultDict_A[kDnsTimeConsuming]){
-                hresultDict_A_kDnsTimeConsuming = hresultDict_A[kDnsTimeConsuming];
-            }
-            if(hresultDict_A[kTTL]){
-                hresultDict_A_kTTL = hresultDict_A[kTTL];
-            }
-            if(hresultDict_A[kTTLExpired]){
-                hresultDict_A_kTTLExpired = hresultDict_A[kTTLExpired];
+        msdkdns::msdkdns_db_row row = [self rowOfDomainInfo:domainInfo domain:domain];
+        // 只写入内存，由 flush 合并后批量落盘
+        dispatch_async(self.dbQueue, ^{
+            if (!self->_writer) {
+                return;
             }
+            self->_writer->Put(row);
+            [self flushIfNeeded];
+        });
+    } @catch (NSException *exception) {
+        MSDKDNSLOG(@"Failed to insert data into database, error: %@", exception);
+    }
+}
+
+- (void)replaceAllDomainInfos:(NSDictionary *)domainInfos {
+    @try {
+        std::vector<msdkdns::msdkdns_db_row> rows;
+        for (NSString *domain in domainInfos) {
+            rows.push_back([self rowOfDomainInfo:domainInfos[domain] domain:domain]);
         }
-        
-        if(hresultDict_4A){
-            if(hresultDict_4A[kChannel]){
-                hresultDict_4A_kChannel = hresultDict_4A[kChannel];
-            }
-            if(hresultDict_4A[kClientIP]){
-                hresultDict_4A_kClientIP = hresultDict_4A[kClientIP];
+        dispatch_async(self.dbQueue, ^{
+            if (!self->_writer) {
+                return;
             }
-            if(hresultDict_4A[kIP]){
-                hresultDict_4A_kIP = [hresultDict_4A[kIP] componentsJoinedByString:@","];
-            }
-            if(hresultDict_4A[kDnsTimeConsuming]){
-                hresultDict_4A_kDnsTimeConsuming = hresultDict_4A[kDnsTimeConsuming];
-            }
-            if(hresultDict_4A[kTTL]){
-                hresultDict_4A_kTTL = hresultDict_4A[kTTL];
-            }
-            if(hresultDict_4A[kTTLExpired]){
-                hresultDict_4A_kTTLExpired = hresultDict_4A[kTTLExpired];
+            // 落盘时与表中已有的行比较，只写入有变化的域名
+            self->_writer->RemoveAll();
+            for (size_t i = 0; i < rows.size(); i++) {
+                self->_writer->Put(rows[i]);
             }
+            self.replacePending = YES;
+        });
+    } @catch (NSException *exception) {
+        MSDKDNSLOG(@"Failed to replace data in database, error: %@", exception);
+    }
+}
+
+// 与 HttpDNSTable 的列对应，缺少的字段为空字符串
+- (msdkdns::msdkdns_db_row)rowOfDomainInfo:(NSDictionary *)domainInfo domain:(NSString *)domain {
+    NSDictionary * hresultDict_A = domainInfo[kMSDKHttpDnsCache_A];
+    NSDictionary * hresultDict_4A = domainInfo[kMSDKHttpDnsCache_4A];
+    
+    NSString *hresultDict_A_kChannel = @"";
+    NSString *hresultDict_A_kClientIP = @"";
+    NSString *hresultDict_A_kIP = @"";
+    NSString *hresultDict_A_kDnsTimeConsuming = @"";
+    NSString *hresultDict_A_kTTL = @"";
+    NSString *hresultDict_A_kTTLExpired = @"";
+    NSString *hresultDict_4A_kChannel = @"";
+    NSString *hresultDict_4A_kClientIP = @"";
+    NSString *hresultDict_4A_kIP = @"";
+    NSString *hresultDict_4A_kDnsTimeConsuming = @"";
+    NSString *hresultDict_4A_kTTL = @"";
+    NSString *hresultDict_4A_kTTLExpired = @"";
+    
+    if(hresultDict_A){
+        if(hresultDict_A[kChannel]){
+            hresultDict_A_kChannel = hresultDict_A[kChannel];
         }
-        NSString *sql = @"INSERT OR REPLACE into HttpDNSTable ";
-        NSString *param = @"(domain, httpDnsIPV4Channel, httpDnsIPV4ClientIP, httpDnsIPV4IPs, httpDnsIPV4TimeConsuming, httpDnsIPV4TTL, httpDnsIPV4TTLExpried, httpDnsIPV6ClientIP, httpDnsIPV6IPs, httpDnsIPV6TimeConsuming, httpDnsIPV6TTL, httpDnsIPV6TTLExpried)";
-        NSString *data = [NSString stringWithFormat:@" values('%@','%@','%@','%@','%@','%@','%@','%@','%@','%@','%@','%@')",
-                          [domain copy],hresultDict_A_kChannel,hresultDict_A_kClientIP,hresultDict_A_kIP,
-                          hresultDict_A_kDnsTimeConsuming,hresultDict_A_kTTL,hresultDict_A_kTTLExpired,hresultDict_4A_kClientIP,
-                          hresultDict_4A_kIP,hresultDict_4A_kDnsTimeConsuming,hresultDict_4A_kTTL,hresultDict_4A_kTTLExpired];
-        NSString *insertSql = [NSString stringWithFormat:@"%@%@%@",sql, param, data];
-        
-        if (sqlite3_exec(_db, [insertSql UTF8String], NULL, NULL, &_error) == SQLITE_OK) {
-            MSDKDNSLOG(@"Successfully insert data into database, domain = %@, domainInfo = %@", domain, domainInfo);
-        } else {
-            MSDKDNSLOG(@"Failed to insert data into database, error: %s", _error);
-            
-            // 每次使用完毕清空 error 字符串，提供给下一次使用
-            sqlite3_free(_error);
+        if(hresultDict_A[kClientIP]){
+            hresultDict_A_kClientIP = hresultDict_A[kClientIP];
+        }
+        if(hresultDict_A[kIP]){
+            hresultDict_A_kIP = [hresultDict_A[kIP] componentsJoinedByString:@","];
+        }
+        if(hresultDict_A[kDnsTimeConsuming]){
+            hresultDict_A_kDnsTimeConsuming = hresultDict_A[kDnsTimeConsuming];
+        }
+        if(hresultDict_A[kTTL]){
+            hresultDict_A_kTTL = hresultDict_A[kTTL];
+        }
+        if(hresultDict_A[kTTLExpired]){
+            hresultDict_A_kTTLExpired = hresultDict_A[kTTLExpired];
         }
-    } @catch (NSException *exception) {
-        MSDKDNSLOG(@"Failed to insert data into database, error: %@", exception);
     }
+    
+    if(hresultDict_4A){
+        if(hresultDict_4A[kChannel]){
+            hresultDict_4A_kChannel = hresultDict_4A[kChannel];
+        }
+        if(hresultDict_4A[kClientIP]){
+            hresultDict_4A_kClientIP = hresultDict_4A[kClientIP];
+        }
+        if(hresultDict_4A[kIP]){
+            hresultDict_4A_kIP = [hresultDict_4A[kIP] componentsJoinedByString:@","];
+        }
+        if(hresultDict_4A[kDnsTimeConsuming]){
+            hresultDict_4A_kDnsTimeConsuming = hresultDict_4A[kDnsTimeConsuming];
+        }
+        if(hresultDict_4A[kTTL]){
+            hresultDict_4A_kTTL = hresultDict_4A[kTTL];
+        }
+        if(hresultDict_4A[kTTLExpired]){
+            hresultDict_4A_kTTLExpired = hresultDict_4A[kTTLExpired];
+        }
+    }
+    msdkdns::msdkdns_db_row row;
+    row.domain = [domain UTF8String] ?: "";
+    NSArray *columns = @[hresultDict_A_kChannel, hresultDict_A_kClientIP, hresultDict_A_kIP,
+                         hresultDict_A_kDnsTimeConsuming, hresultDict_A_kTTL, hresultDict_A_kTTLExpired,
+                         hresultDict_4A_kChannel, hresultDict_4A_kClientIP, hresultDict_4A_kIP,
+                         hresultDict_4A_kDnsTimeConsuming, hresultDict_4A_kTTL, hresultDict_4A_kTTLExpired];
+    for (NSUInteger i = 0; i < columns.count && i < msdkdns::MSDKDNS_EDBColumn_Count; i++) {
+        NSString *value = [columns[i] isKindOfClass:[NSString class]] ? columns[i] : [columns[i] description];
+        row.columns[i] = [value UTF8String] ?: "";
+    }
+    return row;
 }
 
 - (NSDictionary *)getDataFromDB {
+    __block NSDictionary *result = nil;
+    dispatch_sync(self.dbQueue, ^{
+        // 先落盘未写入的数据，保证读到最新结果
+        [self flush];
+        result = [self selectDomainInfoFromDB];
+    });
+    return result;
+}
+
+- (NSDictionary *)selectDomainInfoFromDB {
     NSMutableDictionary *newResult = [[NSMutableDictionary alloc] init];
-    sqlite3_stmt *statement;
+    sqlite3_stmt *statement = NULL;
     NSString *selectSql = @"select domain, httpDnsIPV4Channel, httpDnsIPV4ClientIP, httpDnsIPV4IPs, httpDnsIPV4TimeConsuming, httpDnsIPV4TTL, httpDnsIPV4TTLExpried, httpDnsIPV6Channel, httpDnsIPV6ClientIP, httpDnsIPV6IPs, httpDnsIPV6TimeConsuming, httpDnsIPV6TTL, httpDnsIPV6TTLExpried from HttpDNSTable";
     
     @try {
@@ -227,39 +313,308 @@ static MSDKDnsDB * gSharedInstance = nil;
 }
 
 - (void)deleteDBData: (NSArray *)domains {
+    if (!domains || domains.count == 0) {
+        return;
+    }
+    NSArray *toDeleteDomains = [domains copy];
+    dispatch_async(self.dbQueue, ^{
+        if (!self->_writer) {
+            return;
+        }
+        for (NSString *domain in toDeleteDomains) {
+            if ([domain isKindOfClass:[NSString class]]) {
+                self->_writer->Remove([domain UTF8String] ?: "");
+            }
+        }
+        MSDKDNSLOG(@"Delete data from database later. domains = %@", toDeleteDomains);
+        [self flushIfNeeded];
+    });
+}
+
+- (void)deleteAllData {
+    dispatch_async(self.dbQueue, ^{
+        if (!self->_writer) {
+            return;
+        }
+        self->_writer->RemoveAll();
+        self.replacePending = NO;
+        [self flushIfNeeded];
+    });
+}
+
+#pragma mark - write behind
+
+- (void)flushPendingWrites {
+    [self runOnDBQueue:^{
+        [self flush];
+        [self rewriteSnapshotIfStale];
+    }];
+}
+
+// 已在 dbQueue 中时直接执行，否则同步派发到 dbQueue
+- (void)runOnDBQueue:(dispatch_block_t)block {
+    if (dispatch_get_specific(kMSDKDnsDBQueueKey) == kMSDKDnsDBQueueKey) {
+        block();
+    } else {
+        dispatch_sync(self.dbQueue, block);
+    }
+}
+
+// 需在 dbQueue 中调用
+- (void)flushIfNeeded {
+    if (self.replacePending) {
+        return;
+    }
+    // 落盘失败后按重试间隔等待，不因积压立即重试
+    if (self.retryDelay == 0 && _writer->Pending() >= kMSDKDnsDBFlushThreshold) {
+        [self flush];
+        return;
+    }
+    [self scheduleFlushAfter:self.retryDelay > 0 ? self.retryDelay : kMSDKDnsDBFlushDelay];
+}
+
+// 需在 dbQueue 中调用，已有待执行的落盘时不重复调度
+- (void)scheduleFlushAfter:(int64_t)delay {
+    if (self.flushScheduled) {
+        return;
+    }
+    self.flushScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, delay * NSEC_PER_SEC), self.dbQueue, ^{
+        self.flushScheduled = NO;
+        if (!self.replacePending) {
+            [self flush];
+        }
+    });
+}
+
+// 需在 dbQueue 中调用
+- (void)flush {
+    if (!_writer) {
+        return;
+    }
+    size_t pending = _writer->Pending();
+    if (pending == 0) {
+        return;
+    }
+    if (_writer->Flush()) {
+        self.replacePending = NO;
+        MSDKDNSLOG(@"Successfully flush %zu domains into database, %zu rows changed.", pending, _writer->LastChanges());
+        self.retryDelay = 0;
+        // 内容都与表中相同时快照仍然有效
+        if (_writer->LastChanges() > 0) {
+            [self invalidateSnapshot];
+            [self scheduleSnapshotRewrite];
+        }
+        return;
+    }
+    self.retryDelay = self.retryDelay > 0 ? MIN(self.retryDelay * 2, kMSDKDnsDBMaxRetryDelay) : kMSDKDnsDBFlushDelay;
+    MSDKDNSLOG(@"Failed to flush data into database, retry in %llds, %zu dropped so far, error: %s",
+               (long long)self.retryDelay, _writer->Dropped(), sqlite3_errmsg(_db));
+    [self scheduleFlushAfter:self.retryDelay];
+}
+
+#pragma mark - snapshot
+
+- (MSDKDnsSnapshot *)loadSnapshot {
+    __block MSDKDnsSnapshot *snapshot = nil;
+    dispatch_sync(self.dbQueue, ^{
+        if (!self.snapshotPath) {
+            return;
+        }
+        [self flush];
+        [self rewriteSnapshotIfStale];
+        snapshot = [MSDKDnsSnapshot snapshotWithPath:self.snapshotPath];
+        if (!snapshot && [self writeSnapshot]) {
+            // 首次升级、快照损坏或上次运行中异常退出时从数据库转换
+            snapshot = [MSDKDnsSnapshot snapshotWithPath:self.snapshotPath];
+        }
+    });
+    return snapshot;
+}
+
+// 需在 dbQueue 中调用，已挂载的快照在删除后映射仍然有效
+- (void)invalidateSnapshot {
+    if (self.snapshotStale || !self.snapshotPath) {
+        return;
+    }
+    self.snapshotStale = YES;
+    unlink([self.snapshotPath UTF8String]);
+}
+
+// 需在 dbQueue 中调用，已有待执行的重写时不重复调度，前台长时间运行时快照至多落后 kMSDKDnsDBSnapshotDelay
+- (void)scheduleSnapshotRewrite {
+    if (self.snapshotScheduled || !self.snapshotPath) {
+        return;
+    }
+    self.snapshotScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kMSDKDnsDBSnapshotDelay * NSEC_PER_SEC), self.dbQueue, ^{
+        self.snapshotScheduled = NO;
+        // 数据库已关闭
+        if (!self->_writer) {
+            return;
+        }
+        [self rewriteSnapshotIfStale];
+    });
+}
+
+// 需在 dbQueue 中调用
+- (void)rewriteSnapshotIfStale {
+    if (self.snapshotStale && [self writeSnapshot]) {
+        self.snapshotStale = NO;
+    }
+}
+
+// 需在 dbQueue 中调用
+- (BOOL)writeSnapshot {
+    if (!_db || !self.snapshotPath) {
+        return NO;
+    }
+    std::string path = [self.snapshotPath UTF8String];
+    if (msdkdns::msdkdns_snapshot_write_from_db(_db, path)) {
+        return YES;
+    }
+    // 生成失败时删除旧快照，避免下次启动读到与数据库不一致的数据
+    unlink(path.c_str());
+    MSDKDNSLOG(@"Failed to write snapshot, error: %s", sqlite3_errmsg(_db));
+    return NO;
+}
+
+- (void)insertOrReplaceIPRttRecords:(NSDictionary *)records {
+    if (records.count == 0) {
+        return;
+    }
+    NSDictionary *toWriteRecords = [records copy];
+    dispatch_async(self.dbQueue, ^{
+        [self writeIPRttRecords:toWriteRecords];
+    });
+}
+
+- (void)deleteIPRttRecords:(NSArray *)keys {
+    if (keys.count == 0) {
+        return;
+    }
+    NSArray *toDeleteKeys = [keys copy];
+    dispatch_async(self.dbQueue, ^{
+        [self removeIPRttRecords:toDeleteKeys];
+    });
+}
+
+- (NSDictionary *)getIPRttRecordsFromDB {
+    __block NSDictionary *result = nil;
+    dispatch_sync(self.dbQueue, ^{
+        result = [self selectIPRttRecords];
+    });
+    return result;
+}
+
+// 需在 dbQueue 中调用
+- (void)writeIPRttRecords:(NSDictionary *)records {
+    if (!_db) {
+        return;
+    }
+    sqlite3_stmt *statement = NULL;
+    NSString *insertSql = @"INSERT OR REPLACE into IPRttTable (key, srtt, rttvar, failRate, samples, updated) values(?, ?, ?, ?, ?, ?)";
     @try {
-        NSString *sql = [NSString stringWithFormat:@"DELETE FROM HttpDNSTable WHERE domain IN ('%@')", [domains componentsJoinedByString:@"','"]];
-        if (sqlite3_exec(_db, [sql UTF8String], NULL, NULL, &_error) == SQLITE_OK) {
-            MSDKDNSLOG(@"Successfully delete data into database. domains = %@", domains);
+        // 同一事务内写入，避免逐条提交
+        sqlite3_exec(_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+        if (sqlite3_prepare_v2(_db, [insertSql UTF8String], -1, &statement, nil) == SQLITE_OK) {
+            for (NSString *key in records) {
+                NSDictionary *record = records[key];
+                sqlite3_bind_text(statement, 1, [key UTF8String], -1, SQLITE_TRANSIENT);
+                sqlite3_bind_double(statement, 2, [record[kMSDKDnsRttSRTT] doubleValue]);
+                sqlite3_bind_double(statement, 3, [record[kMSDKDnsRttVar] doubleValue]);
+                sqlite3_bind_double(statement, 4, [record[kMSDKDnsRttFailRate] doubleValue]);
+                sqlite3_bind_int64(statement, 5, [record[kMSDKDnsRttSamples] longLongValue]);
+                sqlite3_bind_int64(statement, 6, [record[kMSDKDnsRttUpdated] longLongValue]);
+                if (sqlite3_step(statement) != SQLITE_DONE) {
+                    MSDKDNSLOG(@"Failed to insert rtt into database, error: %s", sqlite3_errmsg(_db));
+                }
+                sqlite3_reset(statement);
+            }
         } else {
-            MSDKDNSLOG(@"Failed to delete data into database. error:%s", _error);
-            // 每次使用完毕清空 error 字符串，提供给下一次使用
-            sqlite3_free(_error);
+            MSDKDNSLOG(@"Failed to prepare rtt insert, error: %s", sqlite3_errmsg(_db));
         }
+        sqlite3_exec(_db, "COMMIT TRANSACTION", NULL, NULL, NULL);
     } @catch (NSException *exception) {
-        MSDKDNSLOG(@"Failed to delete data into database");
+        MSDKDNSLOG(@"Failed to insert rtt into database, error: %@", exception);
     }
+    sqlite3_finalize(statement);
 }
 
-- (void)deleteAllData {
+// 需在 dbQueue 中调用
+- (void)removeIPRttRecords:(NSArray *)keys {
+    if (!_db) {
+        return;
+    }
+    sqlite3_stmt *statement = NULL;
+    sqlite3_exec(_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    if (sqlite3_prepare_v2(_db, "DELETE FROM IPRttTable WHERE key = ?", -1, &statement, nil) == SQLITE_OK) {
+        for (NSString *key in keys) {
+            sqlite3_bind_text(statement, 1, [key UTF8String], -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(statement) != SQLITE_DONE) {
+                MSDKDNSLOG(@"Failed to delete rtt from database, error: %s", sqlite3_errmsg(_db));
+            }
+            sqlite3_reset(statement);
+        }
+    } else {
+        MSDKDNSLOG(@"Failed to prepare rtt delete, error: %s", sqlite3_errmsg(_db));
+    }
+    sqlite3_exec(_db, "COMMIT TRANSACTION", NULL, NULL, NULL);
+    sqlite3_finalize(statement);
+}
+
+// 需在 dbQueue 中调用
+- (NSDictionary *)selectIPRttRecords {
+    NSMutableDictionary *result = [[NSMutableDictionary alloc] init];
+    if (!_db) {
+        return result;
+    }
+    sqlite3_stmt *statement = NULL;
+    NSString *selectSql = @"select key, srtt, rttvar, failRate, samples, updated from IPRttTable";
     @try {
-        NSString *sql = @"DELETE FROM HttpDNSTable";
-        if (sqlite3_exec(_db, [sql UTF8String], NULL, NULL, &_error) == SQLITE_OK) {
-            MSDKDNSLOG(@"Successfully delete all data into database.");
+        if (sqlite3_prepare_v2(_db, [selectSql UTF8String], -1, &statement, nil) == SQLITE_OK) {
+            while (sqlite3_step(statement) == SQLITE_ROW) {
+                const char *key = (const char *)sqlite3_column_text(statement, 0);
+                if (!key) {
+                    continue;
+                }
+                [result setObject:@{
+                    kMSDKDnsRttSRTT: @(sqlite3_column_double(statement, 1)),
+                    kMSDKDnsRttVar: @(sqlite3_column_double(statement, 2)),
+                    kMSDKDnsRttFailRate: @(sqlite3_column_double(statement, 3)),
+                    kMSDKDnsRttSamples: @(sqlite3_column_int64(statement, 4)),
+                    kMSDKDnsRttUpdated: @(sqlite3_column_int64(statement, 5)),
+                } forKey:[NSString stringWithUTF8String:key]];
+            }
         } else {
-            MSDKDNSLOG(@"Failed to delete all data into database. error:%s", _error);
-            // 每次使用完毕清空 error 字符串，提供给下一次使用
-            sqlite3_free(_error);
+            MSDKDNSLOG(@"Failed to select rtt from database, error: %s", sqlite3_errmsg(_db));
         }
     } @catch (NSException *exception) {
-        MSDKDNSLOG(@"Failed to delete data into database");
+        MSDKDNSLOG(@"Failed to select rtt from database, error: %@", exception);
     }
+    sqlite3_finalize(statement);
+    return result;
 }
 
 // 关闭数据库
 - (BOOL)close {
+    [self runOnDBQueue:^{
+        [self closeOnDBQueue];
+    }];
+    return YES;
+}
+
+// 需在 dbQueue 中调用
+- (void)closeOnDBQueue {
     if (!_db) {
-        return YES;
+        return;
+    }
+    if (_writer) {
+        [self flush];
+        [self rewriteSnapshotIfStale];
+        // 预编译语句需在关闭连接前释放
+        delete _writer;
+        _writer = NULL;
     }
     int  rc;
     BOOL retry;
@@ -284,7 +639,6 @@ static MSDKDnsDB * gSharedInstance = nil;
     }
     while (retry);
     _db = nil;
-    return YES;
 }
 
 - (void)dealloc {
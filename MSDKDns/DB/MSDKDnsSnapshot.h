@@ -0,0 +1,23 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * 持久化缓存的只读快照
+ * 文件 mmap 后按需查询，命中时才将单个域名解析为与 MSDKDnsDB getDataFromDB 相同格式的字典，
+ * 启动耗时与缓存域名数无关；可多线程并发查询
+ */
+@interface MSDKDnsSnapshot : NSObject
+
+// 文件不存在或校验失败时返回 nil
++ (instancetype)snapshotWithPath:(NSString *)path;
+
+- (NSDictionary *)domainInfoForDomain:(NSString *)domain;
+
+- (NSArray<NSString *> *)allDomains;
+
+- (NSUInteger)count;
+
+@end
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsSnapshot.h"
+#import "MSDKDnsPrivate.h"
+#import "MSDKDnsInfoTool.h"
+#include "msdkdns_snapshot.h"
+
+@interface MSDKDnsSnapshot () {
+    msdkdns::SnapshotReader * _reader;
+}
+
+@end
+
+@implementation MSDKDnsSnapshot
+
++ (instancetype)snapshotWithPath:(NSString *)path {
+    if (!path) {
+        return nil;
+    }
+    MSDKDnsSnapshot * snapshot = [[MSDKDnsSnapshot alloc] init];
+    if (!snapshot->_reader->Open(std::string([path UTF8String]))) {
+        return nil;
+    }
+    return snapshot;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _reader = new msdkdns::SnapshotReader();
+    }
+    return self;
+}
+
+- (void)dealloc {
+    delete _reader;
+    _reader = NULL;
+}
+
+// 与 MSDKDnsDB 中 fillHttpDnsIPV4Info 一致，空字段不写入
+- (NSDictionary *)cacheInfoWithRow:(const msdkdns::msdkdns_db_row &)row from:(int)first {
+    NSArray * keys = @[kChannel, kClientIP, kIP, kDnsTimeConsuming, kTTL, kTTLExpired];
+    NSMutableDictionary * cacheInfo = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+    for (int i = 0; i < keys.count; i++) {
+        NSString * value = [NSString stringWithUTF8String:row.columns[first + i].c_str()];
+        if (![MSDKDnsInfoTool isExist:value]) {
+            continue;
+        }
+        if ([keys[i] isEqualToString:kIP]) {
+            cacheInfo[keys[i]] = [value componentsSeparatedByString:@","];
+        } else {
+            cacheInfo[keys[i]] = value;
+        }
+    }
+    return cacheInfo;
+}
+
+- (NSDictionary *)domainInfoForDomain:(NSString *)domain {
+    const char * domainChar = [domain isKindOfClass:[NSString class]] ? [domain UTF8String] : NULL;
+    msdkdns::msdkdns_db_row row;
+    if (!domainChar || !_reader->Lookup(domainChar, strlen(domainChar), &row)) {
+        return nil;
+    }
+    return @{
+        kMSDKHttpDnsCache_A: [self cacheInfoWithRow:row from:msdkdns::MSDKDNS_EDBColumn_IPV4Channel],
+        kMSDKHttpDnsCache_4A: [self cacheInfoWithRow:row from:msdkdns::MSDKDNS_EDBColumn_IPV6Channel],
+    };
+}
+
+- (NSArray<NSString *> *)allDomains {
+    std::vector<std::string> domains;
+    _reader->Domains(&domains);
+    NSMutableArray<NSString *> * result = [NSMutableArray arrayWithCapacity:domains.size()];
+    for (size_t i = 0; i < domains.size(); i++) {
+        NSString * domain = [NSString stringWithUTF8String:domains[i].c_str()];
+        if (domain) {
+            [result addObject:domain];
+        }
+    }
+    return result;
+}
+
+- (NSUInteger)count {
+    return _reader->Count();
+}
+
+@end
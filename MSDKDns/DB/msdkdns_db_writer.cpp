@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_db_writer.h"
+
+namespace msdkdns {
+
+    static const char kUpsertSql[] =
+        "INSERT OR REPLACE into HttpDNSTable (domain, httpDnsIPV4Channel, httpDnsIPV4ClientIP, httpDnsIPV4IPs, "
+        "httpDnsIPV4TimeConsuming, httpDnsIPV4TTL, httpDnsIPV4TTLExpried, httpDnsIPV6Channel, httpDnsIPV6ClientIP, "
+        "httpDnsIPV6IPs, httpDnsIPV6TimeConsuming, httpDnsIPV6TTL, httpDnsIPV6TTLExpried) "
+        "values(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    static const char kDeleteSql[] = "DELETE FROM HttpDNSTable WHERE domain = ?";
+    static const char kSelectSql[] =
+        "SELECT domain, httpDnsIPV4Channel, httpDnsIPV4ClientIP, httpDnsIPV4IPs, httpDnsIPV4TimeConsuming, "
+        "httpDnsIPV4TTL, httpDnsIPV4TTLExpried, httpDnsIPV6Channel, httpDnsIPV6ClientIP, httpDnsIPV6IPs, "
+        "httpDnsIPV6TimeConsuming, httpDnsIPV6TTL, httpDnsIPV6TTLExpried FROM HttpDNSTable";
+
+    DBWriter::DBWriter(sqlite3 *db, size_t max_pending)
+        : db_(db), upsert_(NULL), delete_(NULL), clear_all_(false), max_pending_(max_pending > 0 ? max_pending : 1),
+          dropped_(0), last_changes_(0) {
+    }
+
+    DBWriter::~DBWriter() {
+        sqlite3_finalize(upsert_);
+        sqlite3_finalize(delete_);
+    }
+
+    DBWriter::PendingOp &DBWriter::Op(const std::string &domain) {
+        if (pending_.size() >= max_pending_ && pending_.find(domain) == pending_.end()) {
+            dropped_ += pending_.size();
+            RemoveAll();
+        }
+        return pending_[domain];
+    }
+
+    void DBWriter::Put(const msdkdns_db_row &row) {
+        PendingOp &op = Op(row.domain);
+        op.remove = false;
+        op.row = row;
+    }
+
+    void DBWriter::Remove(const std::string &domain) {
+        PendingOp &op = Op(domain);
+        op.remove = true;
+        op.row = msdkdns_db_row();
+        op.row.domain = domain;
+    }
+
+    void DBWriter::RemoveAll() {
+        pending_.clear();
+        clear_all_ = true;
+    }
+
+    size_t DBWriter::Pending() const {
+        return pending_.size() + (clear_all_ ? 1 : 0);
+    }
+
+    bool DBWriter::Prepare() {
+        if (!db_) {
+            return false;
+        }
+        if (!upsert_ && sqlite3_prepare_v2(db_, kUpsertSql, -1, &upsert_, NULL) != SQLITE_OK) {
+            upsert_ = NULL;
+            return false;
+        }
+        if (!delete_ && sqlite3_prepare_v2(db_, kDeleteSql, -1, &delete_, NULL) != SQLITE_OK) {
+            delete_ = NULL;
+            return false;
+        }
+        return true;
+    }
+
+    bool DBWriter::Exec(const char *sql) {
+        return sqlite3_exec(db_, sql, NULL, NULL, NULL) == SQLITE_OK;
+    }
+
+    // 列与 kUpsertSql 中的顺序一致，NULL 按空字符串比较
+    static bool SameColumns(sqlite3_stmt *stmt, const msdkdns_db_row &row) {
+        for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+            const char *value = reinterpret_cast<const char *>(sqlite3_column_text(stmt, i + 1));
+            size_t length = static_cast<size_t>(sqlite3_column_bytes(stmt, i + 1));
+            if (row.columns[i].size() != length || (length > 0 && row.columns[i].compare(0, length, value, length) != 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool DBWriter::Compare(std::set<std::string> *unchanged, std::vector<std::string> *removed) {
+        sqlite3_stmt *stmt = NULL;
+        if (sqlite3_prepare_v2(db_, kSelectSql, -1, &stmt, NULL) != SQLITE_OK) {
+            return false;
+        }
+        int result = SQLITE_ROW;
+        while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+            const char *text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+            std::string domain(text ? text : "", static_cast<size_t>(sqlite3_column_bytes(stmt, 0)));
+            std::map<std::string, PendingOp>::const_iterator it = pending_.find(domain);
+            if (it == pending_.end()) {
+                removed->push_back(domain);
+            } else if (!it->second.remove && SameColumns(stmt, it->second.row)) {
+                unchanged->insert(domain);
+            }
+        }
+        sqlite3_finalize(stmt);
+        return result == SQLITE_DONE;
+    }
+
+    bool DBWriter::Step(sqlite3_stmt *stmt, const PendingOp &op) {
+        // 绑定参数，不再拼接SQL，值中的引号等字符无需转义
+        sqlite3_bind_text(stmt, 1, op.row.domain.c_str(), static_cast<int>(op.row.domain.size()), SQLITE_STATIC);
+        if (stmt == upsert_) {
+            for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+                const std::string &value = op.row.columns[i];
+                sqlite3_bind_text(stmt, i + 2, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
+            }
+        }
+        bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        return ok;
+    }
+
+    bool DBWriter::Flush() {
+        if (Pending() == 0) {
+            last_changes_ = 0;
+            return true;
+        }
+        if (!Prepare() || !Exec("BEGIN IMMEDIATE TRANSACTION")) {
+            return false;
+        }
+        int changes = sqlite3_total_changes(db_);
+        bool ok = true;
+        std::set<std::string> unchanged;
+        if (clear_all_) {
+            std::vector<std::string> removed;
+            ok = Compare(&unchanged, &removed);
+            if (ok && removed.size() < unchanged.size()) {
+                // 逐行删除的行数少于可以跳过重写的行数
+                PendingOp op;
+                op.remove = true;
+                for (size_t i = 0; ok && i < removed.size(); i++) {
+                    op.row.domain = removed[i];
+                    ok = Step(delete_, op);
+                }
+            } else if (ok) {
+                unchanged.clear();
+                ok = Exec("DELETE FROM HttpDNSTable");
+            }
+        }
+        for (std::map<std::string, PendingOp>::const_iterator it = pending_.begin(); ok && it != pending_.end(); ++it) {
+            if (!unchanged.count(it->first)) {
+                ok = Step(it->second.remove ? delete_ : upsert_, it->second);
+            }
+        }
+        if (ok && Exec("COMMIT TRANSACTION")) {
+            last_changes_ = static_cast<size_t>(sqlite3_total_changes(db_) - changes);
+            pending_.clear();
+            clear_all_ = false;
+            return true;
+        }
+        Exec("ROLLBACK TRANSACTION");
+        return false;
+    }
+}  // namespace msdkdns
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_DB_MSDKDNS_DB_WRITER_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_DB_MSDKDNS_DB_WRITER_H_
+
+#include <stddef.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+namespace msdkdns {
+
+    // HttpDNSTable 中除 domain 外的列，顺序与建表语句一致
+    enum MSDKDNS_TDBColumn {
+        MSDKDNS_EDBColumn_IPV4Channel = 0,
+        MSDKDNS_EDBColumn_IPV4ClientIP,
+        MSDKDNS_EDBColumn_IPV4IPs,
+        MSDKDNS_EDBColumn_IPV4TimeConsuming,
+        MSDKDNS_EDBColumn_IPV4TTL,
+        MSDKDNS_EDBColumn_IPV4TTLExpried,
+        MSDKDNS_EDBColumn_IPV6Channel,
+        MSDKDNS_EDBColumn_IPV6ClientIP,
+        MSDKDNS_EDBColumn_IPV6IPs,
+        MSDKDNS_EDBColumn_IPV6TimeConsuming,
+        MSDKDNS_EDBColumn_IPV6TTL,
+        MSDKDNS_EDBColumn_IPV6TTLExpried,
+        MSDKDNS_EDBColumn_Count,
+    };
+
+    typedef struct msdkdns_db_row {
+        std::string domain;
+        std::string columns[MSDKDNS_EDBColumn_Count];
+    } msdkdns_db_row;
+
+    /*
+     * HttpDNSTable 的延迟批量写入
+     * 写入和删除先在内存中按域名合并，Flush 时在一个事务内通过复用的预编译语句一次写入
+     * 待写入的域名数超过 max_pending（通常因为落盘持续失败）时丢弃未写入的数据，
+     * 并在下次 Flush 时清空整张表，避免数据库中留下与内存不一致的旧数据
+     * 清空整张表后重写（如切换缓存分区）时，Flush 先与表中已有的行比较，内容相同的行不重写，
+     * 只删除之后没有写入的域名；相同的行少于要删除的行时仍整表删除
+     * 不持有数据库连接，非线程安全，需由调用方保证串行访问
+     */
+    class DBWriter {
+    public:
+        DBWriter(sqlite3 *db, size_t max_pending);
+        ~DBWriter();
+
+        void Put(const msdkdns_db_row &row);
+        void Remove(const std::string &domain);
+        // 丢弃所有未写入的数据，下次 Flush 后表中只保留之后写入的域名
+        void RemoveAll();
+        // 待写入的域名数，待清空整张表时额外计1
+        size_t Pending() const;
+        // 因积压超过上限被丢弃的域名数
+        size_t Dropped() const { return dropped_; }
+        // 失败时回滚，未写入的数据保留到下次 Flush
+        bool Flush();
+        // 上次成功的 Flush 实际写入和删除的行数，内容相同未重写的行不计入
+        size_t LastChanges() const { return last_changes_; }
+
+    private:
+        struct PendingOp {
+            bool remove;
+            msdkdns_db_row row;
+        };
+
+        bool Prepare();
+        bool Exec(const char *sql);
+        // 清空整张表前与表中已有的行比较，内容相同的待写入域名写入 unchanged，表中有而之后没有写入的写入 removed
+        bool Compare(std::set<std::string> *unchanged, std::vector<std::string> *removed);
+        bool Step(sqlite3_stmt *stmt, const PendingOp &op);
+        PendingOp &Op(const std::string &domain);
+
+        sqlite3 *db_;
+        sqlite3_stmt *upsert_;
+        sqlite3_stmt *delete_;
+        std::map<std::string, PendingOp> pending_;
+        bool clear_all_;
+        size_t max_pending_;
+        size_t dropped_;
+        size_t last_changes_;
+
+        DBWriter(const DBWriter &);
+        DBWriter &operator=(const DBWriter &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_DB_MSDKDNS_DB_WRITER_H_
@@ -0,0 +1,350 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_snapshot.h"
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace msdkdns {
+
+    static const char kSnapshotMagic[8] = {'M', 'S', 'D', 'K', 'S', 'N', 'A', 'P'};
+    static const uint32_t kSnapshotVersion = 1;
+    static const uint32_t kHeaderSize = 32;
+    // crc + hash + domain_len + column_len[]
+    static const uint32_t kRecordHeaderSize = 4 + 4 + 2 + 2 * MSDKDNS_EDBColumn_Count;
+    static const uint32_t kMinBuckets = 16;
+
+    namespace {
+        struct Crc32Table {
+            uint32_t values[256];
+
+            Crc32Table() {
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; k++) {
+                        c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+                    }
+                    values[i] = c;
+                }
+            }
+        };
+
+        const Crc32Table kCrc32Table;
+    }
+
+    static uint32_t msdkdns_crc32(const uint8_t *data, size_t length) {
+        uint32_t crc = 0xFFFFFFFFU;
+        for (size_t i = 0; i < length; i++) {
+            crc = kCrc32Table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFU;
+    }
+
+    // FNV-1a
+    static uint32_t msdkdns_snapshot_hash(const char *data, size_t length) {
+        uint32_t hash = 2166136261U;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    static void msdkdns_put_u16(std::vector<uint8_t> *out, size_t pos, uint16_t value) {
+        (*out)[pos] = static_cast<uint8_t>(value);
+        (*out)[pos + 1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    static void msdkdns_put_u32(std::vector<uint8_t> *out, size_t pos, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            (*out)[pos + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    static uint16_t msdkdns_get_u16(const uint8_t *p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    static uint32_t msdkdns_get_u32(const uint8_t *p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    static bool msdkdns_write_all(int fd, const uint8_t *data, size_t length) {
+        while (length > 0) {
+            ssize_t n = write(fd, data, length);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool msdkdns_snapshot_write(const std::string &path, const std::vector<msdkdns_db_row> &rows) {
+        uint32_t bucket_count = kMinBuckets;
+        while (bucket_count < rows.size() * 2) {
+            bucket_count <<= 1;
+        }
+        uint32_t records_offset = kHeaderSize + 4 * bucket_count;
+        std::vector<uint8_t> out(records_offset, 0);
+        uint32_t entry_count = 0;
+
+        for (size_t r = 0; r < rows.size(); r++) {
+            const msdkdns_db_row &row = rows[r];
+            if (row.domain.empty() || row.domain.size() > 0xFFFF) {
+                continue;
+            }
+            bool too_long = false;
+            size_t record_size = kRecordHeaderSize + row.domain.size();
+            for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+                too_long = too_long || row.columns[i].size() > 0xFFFF;
+                record_size += row.columns[i].size();
+            }
+            if (too_long || out.size() + record_size > 0xFFFFFFFFU) {
+                continue;
+            }
+            uint32_t hash = msdkdns_snapshot_hash(row.domain.data(), row.domain.size());
+            // 线性探测找空槽，同名域名后写入的覆盖先写入的
+            uint32_t mask = bucket_count - 1;
+            uint32_t slot = hash & mask;
+            bool replaced = false;
+            while (true) {
+                uint32_t existing = msdkdns_get_u32(&out[kHeaderSize + 4 * slot]);
+                if (existing == 0) {
+                    break;
+                }
+                uint16_t existing_len = msdkdns_get_u16(&out[existing + 8]);
+                if (msdkdns_get_u32(&out[existing + 4]) == hash && existing_len == row.domain.size() &&
+                    memcmp(&out[existing + kRecordHeaderSize], row.domain.data(), existing_len) == 0) {
+                    replaced = true;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+
+            size_t offset = out.size();
+            out.resize(offset + record_size);
+            msdkdns_put_u32(&out, offset + 4, hash);
+            msdkdns_put_u16(&out, offset + 8, static_cast<uint16_t>(row.domain.size()));
+            size_t pos = offset + kRecordHeaderSize;
+            memcpy(&out[pos], row.domain.data(), row.domain.size());
+            pos += row.domain.size();
+            for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+                const std::string &value = row.columns[i];
+                msdkdns_put_u16(&out, offset + 10 + 2 * i, static_cast<uint16_t>(value.size()));
+                if (!value.empty()) {
+                    memcpy(&out[pos], value.data(), value.size());
+                }
+                pos += value.size();
+            }
+            msdkdns_put_u32(&out, offset, msdkdns_crc32(&out[offset + 4], record_size - 4));
+            msdkdns_put_u32(&out, kHeaderSize + 4 * slot, static_cast<uint32_t>(offset));
+            if (!replaced) {
+                entry_count++;
+            }
+        }
+
+        memcpy(&out[0], kSnapshotMagic, sizeof(kSnapshotMagic));
+        msdkdns_put_u32(&out, 8, kSnapshotVersion);
+        msdkdns_put_u32(&out, 12, entry_count);
+        msdkdns_put_u32(&out, 16, bucket_count);
+        msdkdns_put_u32(&out, 20, records_offset);
+        msdkdns_put_u32(&out, 24, static_cast<uint32_t>(out.size()));
+        msdkdns_put_u32(&out, 28, msdkdns_crc32(&out[0], 28));
+
+        std::string tmp_path = path + ".tmp";
+        int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = msdkdns_write_all(fd, &out[0], out.size()) && fsync(fd) == 0;
+        ok = close(fd) == 0 && ok;
+        if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+            unlink(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool msdkdns_snapshot_write_from_db(sqlite3 *db, const std::string &path) {
+        if (!db) {
+            return false;
+        }
+        static const char kSelectSql[] =
+            "select domain, httpDnsIPV4Channel, httpDnsIPV4ClientIP, httpDnsIPV4IPs, httpDnsIPV4TimeConsuming, "
+            "httpDnsIPV4TTL, httpDnsIPV4TTLExpried, httpDnsIPV6Channel, httpDnsIPV6ClientIP, httpDnsIPV6IPs, "
+            "httpDnsIPV6TimeConsuming, httpDnsIPV6TTL, httpDnsIPV6TTLExpried from HttpDNSTable";
+        sqlite3_stmt *stmt = NULL;
+        if (sqlite3_prepare_v2(db, kSelectSql, -1, &stmt, NULL) != SQLITE_OK) {
+            return false;
+        }
+        std::vector<msdkdns_db_row> rows;
+        int rc = SQLITE_OK;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            const char *domain = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+            if (!domain) {
+                continue;
+            }
+            rows.push_back(msdkdns_db_row());
+            msdkdns_db_row &row = rows.back();
+            row.domain = domain;
+            for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+                const char *value = reinterpret_cast<const char *>(sqlite3_column_text(stmt, i + 1));
+                if (value) {
+                    row.columns[i] = value;
+                }
+            }
+        }
+        sqlite3_finalize(stmt);
+        return rc == SQLITE_DONE && msdkdns_snapshot_write(path, rows);
+    }
+
+    SnapshotReader::SnapshotReader()
+        : base_(NULL), size_(0), entry_count_(0), bucket_count_(0) {
+    }
+
+    SnapshotReader::~SnapshotReader() {
+        Close();
+    }
+
+    bool SnapshotReader::Open(const std::string &path) {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kHeaderSize)) {
+            close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        const uint8_t *base = static_cast<const uint8_t *>(mapped);
+        uint32_t bucket_count = msdkdns_get_u32(base + 16);
+        bool valid = memcmp(base, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0 &&
+                     msdkdns_get_u32(base + 8) == kSnapshotVersion &&
+                     msdkdns_get_u32(base + 28) == msdkdns_crc32(base, 28) &&
+                     msdkdns_get_u32(base + 24) == size &&
+                     bucket_count >= kMinBuckets && (bucket_count & (bucket_count - 1)) == 0 &&
+                     msdkdns_get_u32(base + 20) == kHeaderSize + 4 * bucket_count &&
+                     kHeaderSize + 4 * static_cast<size_t>(bucket_count) <= size;
+        if (!valid) {
+            munmap(mapped, size);
+            return false;
+        }
+        // 查询按哈希随机访问，不需要预读
+        madvise(mapped, size, MADV_RANDOM);
+        base_ = base;
+        size_ = size;
+        entry_count_ = msdkdns_get_u32(base + 12);
+        bucket_count_ = bucket_count;
+        return true;
+    }
+
+    void SnapshotReader::Close() {
+        if (base_) {
+            munmap(const_cast<uint8_t *>(base_), size_);
+        }
+        base_ = NULL;
+        size_ = 0;
+        entry_count_ = 0;
+        bucket_count_ = 0;
+    }
+
+    bool SnapshotReader::IsOpen() const {
+        return base_ != NULL;
+    }
+
+    size_t SnapshotReader::Count() const {
+        return entry_count_;
+    }
+
+    const uint8_t *SnapshotReader::Record(uint32_t offset, uint32_t *record_size) const {
+        uint32_t records_offset = kHeaderSize + 4 * bucket_count_;
+        if (offset < records_offset || offset > size_ || size_ - offset < kRecordHeaderSize) {
+            return NULL;
+        }
+        const uint8_t *record = base_ + offset;
+        size_t length = kRecordHeaderSize + msdkdns_get_u16(record + 8);
+        for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+            length += msdkdns_get_u16(record + 10 + 2 * i);
+        }
+        if (length > size_ - offset) {
+            return NULL;
+        }
+        *record_size = static_cast<uint32_t>(length);
+        return record;
+    }
+
+    bool SnapshotReader::Lookup(const char *domain, size_t length, msdkdns_db_row *row) const {
+        if (!base_ || !domain || length == 0) {
+            return false;
+        }
+        uint32_t hash = msdkdns_snapshot_hash(domain, length);
+        uint32_t mask = bucket_count_ - 1;
+        uint32_t slot = hash & mask;
+        for (uint32_t probe = 0; probe < bucket_count_; probe++, slot = (slot + 1) & mask) {
+            uint32_t offset = msdkdns_get_u32(base_ + kHeaderSize + 4 * slot);
+            if (offset == 0) {
+                return false;
+            }
+            uint32_t record_size = 0;
+            const uint8_t *record = Record(offset, &record_size);
+            if (!record) {
+                return false;
+            }
+            if (msdkdns_get_u32(record + 4) != hash || msdkdns_get_u16(record + 8) != length ||
+                memcmp(record + kRecordHeaderSize, domain, length) != 0) {
+                continue;
+            }
+            if (msdkdns_get_u32(record) != msdkdns_crc32(record + 4, record_size - 4)) {
+                return false;
+            }
+            if (row) {
+                const char *pos = reinterpret_cast<const char *>(record + kRecordHeaderSize);
+                row->domain.assign(pos, length);
+                pos += length;
+                for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+                    uint16_t column_length = msdkdns_get_u16(record + 10 + 2 * i);
+                    row->columns[i].assign(pos, column_length);
+                    pos += column_length;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void SnapshotReader::Domains(std::vector<std::string> *domains) const {
+        domains->clear();
+        if (!base_) {
+            return;
+        }
+        domains->reserve(entry_count_);
+        for (uint32_t slot = 0; slot < bucket_count_; slot++) {
+            uint32_t offset = msdkdns_get_u32(base_ + kHeaderSize + 4 * slot);
+            uint32_t record_size = 0;
+            const uint8_t *record = offset ? Record(offset, &record_size) : NULL;
+            if (record) {
+                domains->push_back(std::string(reinterpret_cast<const char *>(record + kRecordHeaderSize),
+                                               msdkdns_get_u16(record + 8)));
+            }
+        }
+    }
+}  // namespace msdkdns
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_DB_MSDKDNS_SNAPSHOT_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_DB_MSDKDNS_SNAPSHOT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "msdkdns_db_writer.h"
+
+namespace msdkdns {
+
+    /*
+     * 持久化缓存的二进制快照，启动时 mmap 后直接在映射内存上查询
+     * 文件布局（小端）：
+     *   header  : magic[8] "MSDKSNAP", version, entry_count, bucket_count, records_offset, file_size, header_crc
+     *   buckets : uint32 * bucket_count，记录在文件中的偏移，0 表示空槽，按域名哈希线性探测
+     *   records : crc, hash, domain_len, column_len[MSDKDNS_EDBColumn_Count], domain, columns...
+     * 打开时只校验 header，记录的 crc 在查询命中时才校验，打开耗时与缓存大小无关
+     * 写入时先写临时文件再 rename，整体替换，不会读到写了一半的快照
+     */
+    bool msdkdns_snapshot_write(const std::string &path, const std::vector<msdkdns_db_row> &rows);
+    // 读取 HttpDNSTable 全表生成快照，用于从数据库转换及进入后台、关闭时重新生成
+    bool msdkdns_snapshot_write_from_db(sqlite3 *db, const std::string &path);
+
+    class SnapshotReader {
+    public:
+        SnapshotReader();
+        ~SnapshotReader();
+
+        // 文件不存在、版本不符或 header 校验失败时返回 false
+        bool Open(const std::string &path);
+        void Close();
+        bool IsOpen() const;
+
+        size_t Count() const;
+        // 记录校验失败时视为不存在；只读，可多线程并发调用
+        bool Lookup(const char *domain, size_t length, msdkdns_db_row *row) const;
+        void Domains(std::vector<std::string> *domains) const;
+
+    private:
+        const uint8_t *Record(uint32_t offset, uint32_t *record_size) const;
+
+        const uint8_t *base_;
+        size_t size_;
+        uint32_t entry_count_;
+        uint32_t bucket_count_;
+
+        SnapshotReader(const SnapshotReader &);
+        SnapshotReader &operator=(const SnapshotReader &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_DB_MSDKDNS_SNAPSHOT_H_
@@ -77,6 +77,7 @@ typedef struct DnsConfigStruct {
 
 /**
  * 设置保活的域名，设置的域名会定时更新缓存，数量不能大于8个
+ * 开启 WGSetRefreshAheadBudget: 后，近期频繁查询的域名会自动在TTL过期前刷新，无需加入保活列表
  */
 - (void) WGSetKeepAliveDomains:(NSArray *)domains;
 
@@ -100,6 +101,53 @@ typedef struct DnsConfigStruct {
  */
 - (void) WGSetPersistCacheIPEnabled:(BOOL)enable;
 
+/**
+ * 设置解析请求合批，短时间内多次调用的未命中域名合并为一次请求
+ *
+ * @param windowMs 合批等待窗口，单位ms，默认5ms，设置为0时关闭合批
+ * @param maxDomains 单次请求最多合并的域名数，默认8，达到后立即发出
+ */
+- (void) WGSetBatchWindow:(NSUInteger)windowMs maxDomains:(NSUInteger)maxDomains;
+
+/**
+ * 上报业务使用解析结果IP建连的结果，用于IP优选，减少重复测速
+ *
+ * @param ip 建连使用的IP
+ * @param port 建连端口，需与 WGSetIPRankData 中配置的端口一致才会用于该域名的排序
+ * @param rtt 建连耗时，单位ms，失败时忽略
+ * @param success 是否建连成功
+ */
+- (void) WGReportConnectResultWithIP:(NSString *)ip port:(int)port rtt:(float)rtt success:(BOOL)success;
+
+/**
+ * 设置通过网卡地址判断本地网络栈，默认关闭
+ * 默认通过UDP connect判断是否有IPv4/IPv6路由；开启后改为检查网卡上是否配置了全局单播地址，不创建socket
+ * 仅在初始化配置的 addressType 为 HttpDnsAddressTypeAuto 时生效，探测结果会缓存到网络变化为止
+ */
+- (void) WGSetDetectIPStackByInterfaces:(BOOL)enable;
+
+/**
+ * 设置是否开启对冲请求，默认开启
+ * 开启后向当前解析服务IP发出的请求在一段时间内无结果时，会向另一个可用的服务IP发出相同请求，先返回的有效结果生效，另一个请求被取消
+ * 等待时间和单次请求超时按该服务IP最近的请求耗时分位数计算，不超过初始化配置的超时时间
+ */
+- (void) WGSetHedgedRequestEnabled:(BOOL)enable;
+
+/**
+ * 设置热点域名自动刷新每分钟最多发出的请求数，默认0即关闭，建议值20
+ * SDK统计域名的查询频率，近几分钟内查询较多的域名在TTL过期前合批刷新，使其查询始终命中缓存
+ * 开启后即使业务不再查询，热点域名也会在热度衰减前持续刷新，HTTPDNS请求量最多增加设置的值，请结合计费评估
+ * 每个请求最多包含 WGSetBatchWindow:maxDomains: 设置的域名数，超出预算时优先刷新查询最多的域名
+ * 受 WGSetEnableKeepDomainsAlive: 开关控制
+ */
+- (void) WGSetRefreshAheadBudget:(NSUInteger)requestsPerMinute;
+
+/**
+ * 设置域名缓存占用内存的上限，单位字节，默认4MB，最小64KB
+ * 包括当前网络及保留的其他网络的缓存，超出时淘汰最近未查询的域名，被淘汰的域名下次查询时重新解析
+ */
+- (void) WGSetCacheMemoryBudget:(NSUInteger)bytes;
+
 #pragma mark - 域名解析接口，按需调用
 /**
  域名同步解析（通用接口）
@@ -157,6 +205,8 @@ typedef struct DnsConfigStruct {
  SNI场景下设置需要拦截的域名列表
  建议使用该接口设置，仅拦截SNI场景下的域名，避免拦截其它场景下的域名
 
+ 支持精确域名及 *.example.com 形式的通配规则，通配规则匹配任意层级的子域名，不含 example.com 本身；不区分大小写
+
  @param hijackDomainArray 需要拦截的域名列表
  */
 - (void) WGSetHijackDomainArray:(NSArray *)hijackDomainArray;
@@ -164,6 +214,8 @@ typedef struct DnsConfigStruct {
 /**
  SNI场景下设置不需要拦截的域名列表
 
+ 规则格式与 WGSetHijackDomainArray 相同
+
  @param noHijackDomainArray 不需要拦截的域名列表
  */
 - (void) WGSetNoHijackDomainArray:(NSArray *)noHijackDomainArray;
@@ -187,6 +239,80 @@ typedef struct DnsConfigStruct {
 */
 - (NSDictionary *) WGGetDnsDetail:(NSString *) domain;
 
+/**
+解析服务IP的统计，SDK按耗时和失败率选择服务IP，失败较多的服务IP暂停使用一段时间后再探测恢复
+
+@return 每个服务IP一项
+ 格式示例：
+ [{
+ "server":"1.1.1.1",
+ "state":"closed",      // closed: 可用, open: 暂停使用, half-open: 探测中
+ "latency":35.2,        // 平均耗时，ms
+ "errorRate":0.05,
+ "successes":120,
+ "failures":3,
+ "selected":118,
+ "retryAfter":0         // 暂停使用时距离下次探测的时间，ms
+ }]
+*/
+- (NSArray<NSDictionary *> *) WGGetDnsServerStatistics;
+
+/**
+解析请求的统计计数，用于监控，均为SDK启动以来的累计值
+
+@return 格式示例：
+ {
+ "started":120,             // 实际发起解析的域名数
+ "coalesced":30,            // 合并到在途请求上的域名数
+ "batches":40,              // 发出的合批请求数
+ "batchedCalls":15,         // 与其他调用合批发出的调用数
+ "refreshAhead":60,         // 自动刷新的热点域名数
+ "refreshAheadSkipped":0,   // 超出刷新预算未刷新的热点域名数
+ "negativeFailures":5,      // 解析失败或无结果的次数
+ "negativeBlocked":300,     // 失败后退避期内直接返回无结果、未发出请求的查询数
+ "negativeRecovered":1,     // 失败后又解析成功的次数
+ "negativeEntries":2,       // 当前处于失败状态的域名数（按A、AAAA、双栈分别计）
+ "partitionRestored":3,     // 网络切换时恢复原有缓存分区的次数
+ "partitionMissed":1,       // 切换到没有保留缓存分区的网络的次数
+ "partitionEvicted":0,      // 超出保留数量被淘汰的缓存分区数
+ "cacheHits":500,           // 内存缓存命中次数
+ "cacheMisses":40,
+ "cacheEvictions":0,        // 超出内存预算被淘汰的缓存条目数
+ "cacheRejected":0,         // 单条超过预算未能缓存的次数
+ "cacheEntries":80,         // 当前缓存条目数，含保留的其他网络分区
+ "cacheBytesUsed":12000,    // 缓存条目及索引占用的字节数
+ "cacheBytesReserved":40960, // 实际申请的字节数，不超过 cacheBudget
+ "cacheBudget":4194304,     // 缓存内存预算，见 WGSetCacheMemoryBudget:
+ "httpRequests":100,        // 通过长连接发出的HTTPDNS请求数（https 不经过长连接池）
+ "httpConnects":4,          // 建立的连接数
+ "httpConnectFailures":0,
+ "httpReused":96,           // 发出时连接已建立、无需等待握手的请求数
+ "httpPipelined":10,        // 与其他请求在同一连接上管线化发出的请求数
+ "httpRetried":1,           // 连接被服务端关闭后重新发出的请求数
+ "httpProactiveReconnects":2 // 空闲到期前主动重建的连接数
+ }
+*/
+- (NSDictionary *) WGGetRequestStatistics;
+
+/**
+HTTPDNS 长连接池中当前连接的复用情况
+
+@return 每个连接一项
+ 格式示例：
+ [{
+ "id":3,
+ "server":"1.1.1.1:80",
+ "requests":25,      // 已完成的请求数
+ "reused":24,        // 无需等待握手的请求数
+ "pipelined":3,      // 管线化发出的请求数
+ "inflight":0,       // 未完成的请求数
+ "age":60000,        // 连接建立至今的时间，ms
+ "idle":1200,        // 空闲时间，ms
+ "expireIn":12800    // 距离空闲到期主动关闭的时间，ms
+ }]
+*/
+- (NSArray<NSDictionary *> *) WGGetHttpConnectionStatistics;
+
 #pragma mark-清除缓存
 /**
  清理本地所有缓存，除非业务明确需要，不要调用该方法
@@ -9,6 +9,9 @@
 #import "MSDKDnsNetworkManager.h"
 #import "MSDKDnsInfoTool.h"
 #import "MSDKDnsParamsManager.h"
+#import "MSDKDnsRttManager.h"
+#import "MSDKDnsServerMonitor.h"
+#import "MSDKDnsHttpClient.h"
 #if defined(__has_include)
     #if __has_include("httpdnsIps.h")
         #include "httpdnsIps.h"
@@ -168,6 +171,37 @@ static BOOL isInitialized = NO;
     [[MSDKDnsManager shareInstance] loadIPsFromPersistCacheAsync];
 }
 
+- (void) WGSetBatchWindow:(NSUInteger)windowMs maxDomains:(NSUInteger)maxDomains {
+    [[MSDKDnsParamsManager shareInstance] msdkDnsSetBatchWindow:windowMs maxDomains:maxDomains];
+}
+
+- (void) WGReportConnectResultWithIP:(NSString *)ip port:(int)port rtt:(float)rtt success:(BOOL)success {
+    if (!ip || ip.length == 0 || port <= 0 || port > 65535) {
+        return;
+    }
+    if (success) {
+        [[MSDKDnsRttManager shareInstance] recordIP:ip port:(uint16_t)port rtt:rtt];
+    } else {
+        [[MSDKDnsRttManager shareInstance] recordFailureOfIP:ip port:(uint16_t)port];
+    }
+}
+
+- (void) WGSetDetectIPStackByInterfaces:(BOOL)enable {
+    [[MSDKDnsParamsManager shareInstance] msdkDnsSetDetectIPStackByInterfaces:enable];
+}
+
+- (void) WGSetHedgedRequestEnabled:(BOOL)enable {
+    [[MSDKDnsParamsManager shareInstance] msdkDnsSetHedgedRequestEnabled:enable];
+}
+
+- (void) WGSetRefreshAheadBudget:(NSUInteger)requestsPerMinute {
+    [[MSDKDnsParamsManager shareInstance] msdkDnsSetRefreshAheadBudget:requestsPerMinute];
+}
+
+- (void) WGSetCacheMemoryBudget:(NSUInteger)bytes {
+    [[MSDKDnsParamsManager shareInstance] msdkDnsSetCacheMemoryBudget:bytes];
+}
+
 - (void)WGSetAuthTimeBaseByCurrentTime:(NSTimeInterval)baseTime {
     NSTimeInterval currentTime = [[NSDate date] timeIntervalSince1970];
     NSInteger offset = baseTime-currentTime;
@@ -444,6 +478,18 @@ static BOOL isInitialized = NO;
     return [[MSDKDnsManager shareInstance] getDnsDetail:domain];
 }
 
+- (NSArray<NSDictionary *> *) WGGetDnsServerStatistics {
+    return [[MSDKDnsServerMonitor shareInstance] statistics];
+}
+
+- (NSDictionary *) WGGetRequestStatistics {
+    return [[MSDKDnsManager shareInstance] msdkDnsGetRequestStatistics];
+}
+
+- (NSArray<NSDictionary *> *) WGGetHttpConnectionStatistics {
+    return [[MSDKDnsHttpClient shareInstance] statistics];
+}
+
 - (int) WGGetNetworkStack {
     return [[MSDKDnsManager shareInstance] getAddressType];
 }
@@ -459,6 +505,7 @@ static BOOL isInitialized = NO;
         [[MSDKDnsManager shareInstance] clearAllCache];
     }else if ([hostArray isKindOfClass:[NSArray class]] && hostArray.count > 0){
         [[MSDKDnsManager shareInstance] clearCacheForDomains:hostArray];
+        [[MSDKDnsManager shareInstance] clearNegativeCacheForDomains:hostArray];
     }
 }
 
@@ -7,7 +7,7 @@
 #import "MSDKDnsLog.h"
 #import "MSDKDnsParamsManager.h"
 #import "MSDKDnsManager.h"
-#import <arpa/inet.h>
+#import "msdkdns_ip.h"
 #import <objc/runtime.h>
 #import "MSDKDns.h"
 
@@ -45,21 +45,21 @@ static NSString *const kAnchorAlreadyAdded = @"AnchorAlreadyAdded";
     NSURL *URL = request.URL;
     NSString * originHost = [request.allHTTPHeaderFields objectForKey:@"host"];
     NSString * domain = request.URL.host;
-        
-    NSArray * hijackDomainArray = [[[MSDKDnsParamsManager shareInstance] msdkDnsGetHijackDomainArray] copy];
-    NSArray * noHijackDomainArray = [[[MSDKDnsParamsManager shareInstance] msdkDnsGetNoHijackDomainArray] copy];
+    const char * host = [domain UTF8String];
+    size_t hostLength = host ? strlen(host) : 0;
     
-    if (hijackDomainArray && (hijackDomainArray.count > 0)) {
-        if ([url hasPrefix:@"https"] && [hijackDomainArray containsObject:domain]) {
+    // 每个请求都会调用，使用设置时编译好的匹配器，不再拷贝和遍历域名列表
+    MSDKDnsDomainMatcher * hijackMatcher = [[MSDKDnsParamsManager shareInstance] msdkDnsGetHijackDomainMatcher];
+    if (hijackMatcher) {
+        if ([url hasPrefix:@"https"] && [hijackMatcher matchHost:host length:hostLength]) {
             return YES;
         } else {
             return NO;
         }
     }
-    if (noHijackDomainArray && (noHijackDomainArray.count > 0)) {
-        if ([noHijackDomainArray containsObject:domain]) {
-            return NO;
-        }
+    MSDKDnsDomainMatcher * noHijackMatcher = [[MSDKDnsParamsManager shareInstance] msdkDnsGetNoHijackDomainMatcher];
+    if ([noHijackMatcher matchHost:host length:hostLength]) {
+        return NO;
     }
     // 如果为ip，则不拦截处理
     if ([self isIPV4:domain]){
@@ -72,37 +72,21 @@ static NSString *const kAnchorAlreadyAdded = @"AnchorAlreadyAdded";
 }
 
 + (BOOL)isIPV4:(NSString *)ipSting {
-    BOOL isIPV4 = YES;
-    
-    if (ipSting) {
-        const char *utf8 = [ipSting UTF8String];
-        int success = 0;
-        struct in_addr dst;
-        success = inet_pton(AF_INET, utf8, &dst);
-        if (success != 1) {
-            isIPV4 = NO;
-        }
-    } else {
-        isIPV4 = NO;
+    if (!ipSting) {
+        return NO;
     }
-    return isIPV4;
+    const char *utf8 = [ipSting UTF8String];
+    uint8_t address[4];
+    return utf8 && msdkdns::msdkdns_parse_ipv4(utf8, strlen(utf8), address);
 }
 
 + (BOOL)isIPV6:(NSString *)ipSting {
-    BOOL isIPV6 = YES;
-    
-    if (ipSting) {
-        const char *utf8 = [ipSting UTF8String];
-        int success = 0;
-        struct in6_addr dst6;
-        success = inet_pton(AF_INET6, utf8, &dst6);
-        if (success != 1) {
-            isIPV6 = NO;
-        }
-    } else {
-        isIPV6 = NO;
+    if (!ipSting) {
+        return NO;
     }
-    return isIPV6;
+    const char *utf8 = [ipSting UTF8String];
+    uint8_t address[16];
+    return utf8 && msdkdns::msdkdns_parse_ipv6(utf8, strlen(utf8), address);
 }
 
 /**
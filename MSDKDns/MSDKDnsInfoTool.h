@@ -8,8 +8,20 @@
 @interface MSDKDnsInfoTool : NSObject
 
 + (dispatch_queue_t) msdkdns_queue;
+// 在 msdkdns_queue 中同步执行，已在其中时直接执行
++ (void) msdkdns_queue_sync:(dispatch_block_t)block;
 + (dispatch_queue_t) msdkdns_resolver_queue;
 + (dispatch_queue_t) msdkdns_local_queue;
+// 按域名分 lane 异步执行：同一域名的任务按提交顺序串行，每个 lane 为一个 GCD 串行队列，不同域名的任务并行，
+// 用于只涉及单个域名的工作（上报格式化、在途请求表、延迟刷新标志等），避免都排在 msdkdns_queue 上；任务中不能同步等待其他 lane
++ (void) msdkdns_async:(NSString *)domain block:(dispatch_block_t)block;
+// 域名所在的 lane，取值小于 msdkdns_lane_count，同一域名始终相同
+// 按域名保存的状态可按 lane 分片，只在 msdkdns_lane_async 提交到该 lane 的任务中访问，无需加锁
++ (uint32_t) msdkdns_lane:(NSString *)domain;
++ (NSUInteger) msdkdns_lane_count;
++ (void) msdkdns_lane_async:(uint32_t)lane block:(dispatch_block_t)block;
+// 当前是否在该 lane 的任务中执行
++ (BOOL) msdkdns_on_lane:(uint32_t)lane;
 + (NSString *) wifiSSID;
 
 + (NSString *) encryptUseDES:(NSString *)plainText key:(NSString *)key;
@@ -20,6 +32,9 @@
 + (NSString *)decryptUseAES:(NSString *)cipherString key:(NSString *)key;
 + (NSURL *) httpsUrlWithDomain:(NSString *)domain dnsId:(int)dnsId dnsKey:(NSString *)dnsKey ipType:(HttpDnsIPType)ipType
                                                     encryptType:(NSInteger)encryptType; //encryptType: 0 des,1 aes
+// 指定解析服务IP，serviceIp 为 nil 时使用当前服务IP
++ (NSURL *) httpsUrlWithDomain:(NSString *)domain dnsId:(int)dnsId dnsKey:(NSString *)dnsKey ipType:(HttpDnsIPType)ipType
+                                                    encryptType:(NSInteger)encryptType serviceIp:(NSString *)serviceIp;
 + (NSString *)generateSessionID;
 + (NSArray *)arrayTransLowercase:(NSArray *)data;
 + (NSString *)getIPsStringFromIPsArray:(NSArray *)ipsArray;
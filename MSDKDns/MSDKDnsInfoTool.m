@@ -14,6 +14,8 @@
 #import <netdb.h>
 #import <err.h>
 #import "aes.h"
+#import "msdkdns_hex.h"
+#import "msdkdns_domain_interner.h"
 #import "MSDKDns.h"
 #if defined(__has_include)
     #if __has_include("httpdnsIps.h")
@@ -21,6 +23,10 @@
     #endif
 #endif
 
+static const void * const kMSDKDnsQueueKey = &kMSDKDnsQueueKey;
+static const void * const kMSDKDnsLaneKey = &kMSDKDnsLaneKey;
+static const NSUInteger kMSDKDnsLaneCount = 64;
+
 @implementation MSDKDnsInfoTool
 
 + (dispatch_queue_t) msdkdns_queue {
@@ -28,10 +34,20 @@
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
         msdkdns_queue = dispatch_queue_create("com.tencent.msdkdns", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(msdkdns_queue, kMSDKDnsQueueKey, (void *)kMSDKDnsQueueKey, NULL);
     });
     return msdkdns_queue;
 }
 
++ (void) msdkdns_queue_sync:(dispatch_block_t)block {
+    dispatch_queue_t queue = [self msdkdns_queue];
+    if (dispatch_get_specific(kMSDKDnsQueueKey) == kMSDKDnsQueueKey) {
+        block();
+    } else {
+        dispatch_sync(queue, block);
+    }
+}
+
 + (dispatch_queue_t) msdkdns_resolver_queue {
     static dispatch_queue_t msdkdns_resolver_queue;
     static dispatch_once_t onceToken;
@@ -50,6 +66,51 @@
     return msdkdns_local_queue;
 }
 
++ (void) msdkdns_async:(NSString *)domain block:(dispatch_block_t)block {
+    [self msdkdns_lane_async:[self msdkdns_lane:domain] block:block];
+}
+
++ (uint32_t) msdkdns_lane:(NSString *)domain {
+    // 同一域名须始终落在同一 lane；只计算规范化后的哈希，不写入驻留表
+    uint32_t hash = (uint32_t)[domain hash];
+    const char * text = [domain isKindOfClass:[NSString class]] ? [domain UTF8String] : NULL;
+    if (text) {
+        hash = msdkdns::msdkdns_domain_hash(text, strlen(text));
+    }
+    return hash % kMSDKDnsLaneCount;
+}
+
++ (NSUInteger) msdkdns_lane_count {
+    return kMSDKDnsLaneCount;
+}
+
+// 每个 lane 一个串行队列，队列上的 specific 为 lane + 1
++ (NSArray *) msdkdns_lanes {
+    static NSArray * lanes;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray * queues = [NSMutableArray arrayWithCapacity:kMSDKDnsLaneCount];
+        for (uintptr_t i = 0; i < kMSDKDnsLaneCount; i++) {
+            dispatch_queue_t queue = dispatch_queue_create("com.tencent.msdkdns.lane", DISPATCH_QUEUE_SERIAL);
+            dispatch_queue_set_specific(queue, kMSDKDnsLaneKey, (void *)(i + 1), NULL);
+            [queues addObject:queue];
+        }
+        lanes = [queues copy];
+    });
+    return lanes;
+}
+
++ (void) msdkdns_lane_async:(uint32_t)lane block:(dispatch_block_t)block {
+    if (!block) {
+        return;
+    }
+    dispatch_async([self msdkdns_lanes][lane % kMSDKDnsLaneCount], block);
+}
+
++ (BOOL) msdkdns_on_lane:(uint32_t)lane {
+    return dispatch_get_specific(kMSDKDnsLaneKey) == (void *)((uintptr_t)(lane % kMSDKDnsLaneCount) + 1);
+}
+
 + (NSString *) getIPv6: (const char *)mHost {
     if (NULL == mHost)
         return nil;
@@ -105,68 +166,28 @@
     return NewStr;
 }
 
-char MSDKDnsByteToHexByte(char byte) {
-    if (byte < 10) {
-        return byte + '0';
-    }
-    return byte - 10 + 'a';
-}
-
-void MSDKDnsByteToHexChar(char byte, char *hex) {
-    hex[0] = MSDKDnsByteToHexByte((byte >> 4) & 0x0F);
-    hex[1] = MSDKDnsByteToHexByte(byte & 0x0F);
-}
-
 NSString * MSDKDnsDataToHexString(NSData *data) {
     if (!data) {
         return nil;
     }
     char hex[data.length * 2 + 1];
-    const char *bytes = (const char *)data.bytes;
-    for (NSUInteger i = 0; i < data.length; ++i) {
-        MSDKDnsByteToHexChar(bytes[i], &hex[i * 2]);
-    }
+    msdkdns::msdkdns_hex_encode((const uint8_t *)data.bytes, data.length, hex);
     hex[data.length * 2] = 0;
     return [NSString stringWithUTF8String:hex];
 }
 
+// 严格解码，长度为奇数或包含非十六进制字符时返回nil
 NSData * MSDKDNSHexStringToData(NSString *string) {
-    if (!string) {
+    const char *hex = [string UTF8String];
+    if (!hex) {
         return nil;
     }
-    const char *tempBytes = [string UTF8String];
-    NSUInteger tempLength = [string length];
-    NSUInteger dataLength = tempLength / 2;
-    char textBytes[dataLength];
-    if (tempLength > 0) {
-        for (int i  = 0; i < tempLength - 1; i = i + 2)
-        {
-            char high = tempBytes[i];
-            char low = tempBytes[i + 1];
-            char hex = MSDKDnsHexCharToChar(high, low);
-            textBytes[i / 2] = hex;
-        }
-    }
-    return [NSData dataWithBytes:textBytes length:dataLength];
-}
-
-char MSDKDnsHexByteToChar(char hex) {
-    if (hex >= '0' && hex <= '9') {
-        return hex - '0';
-    }
-    if (hex >= 'a' && hex <= 'f') {
-        return hex - 'a' + 10;
-    }
-    if (hex >= 'A' && hex <= 'F') {
-        return hex - 'A' + 10;
+    size_t hexLength = strlen(hex);
+    NSMutableData *data = [NSMutableData dataWithLength:hexLength / 2];
+    if (!msdkdns::msdkdns_hex_decode(hex, hexLength, (uint8_t *)data.mutableBytes)) {
+        return nil;
     }
-    return 0;
-}
-
-char MSDKDnsHexCharToChar(char high, char low) {
-    high = MSDKDnsHexByteToChar(high);
-    low = MSDKDnsHexByteToChar(low);
-    return (high << 4) | low;
+    return data;
 }
 
 + (NSString *) encryptUseDES:(NSString *)plainText key:(NSString *)key {
@@ -199,26 +220,12 @@ char MSDKDnsHexCharToChar(char high, char low) {
 
 + (NSString *) decryptUseDES:(NSString *)cipherString key:(NSString *)key {
     if (cipherString && key) {
-        const char *tempBytes = [cipherString UTF8String];
-        NSUInteger tempLength = [cipherString length];
-        if (tempLength > 0) {
-            NSUInteger dataLength = tempLength / 2;
-            char *textBytes = (char *)malloc(dataLength);
-            if (!textBytes) {
-                return nil;
-            }
-            
-            for (NSUInteger i = 0; i < tempLength - 1; i += 2) {
-                char high = tempBytes[i];
-                char low = tempBytes[i + 1];
-                char hex = MSDKDnsHexCharToChar(high, low);
-                textBytes[i / 2] = hex;
-            }
-            
+        NSData *textData = MSDKDNSHexStringToData(cipherString);
+        if (textData.length > 0) {
+            NSUInteger dataLength = textData.length;
             size_t dataOutAvailable = (dataLength + kCCBlockSizeDES) & ~(kCCBlockSizeDES - 1);
             unsigned char *dataOut = (unsigned char *)malloc(dataOutAvailable);
             if (!dataOut) {
-                free(textBytes);
                 return nil;
             }
             memset(dataOut, 0, dataOutAvailable);
@@ -232,7 +239,7 @@ char MSDKDnsHexCharToChar(char high, char low) {
                                                decryptKey,
                                                kCCKeySizeDES,
                                                NULL,
-                                               textBytes,
+                                               textData.bytes,
                                                dataLength,
                                                dataOut,
                                                dataOutAvailable,
@@ -247,7 +254,6 @@ char MSDKDnsHexCharToChar(char high, char low) {
             } else {
                 free(dataOut);
             }
-            free(textBytes);
             return plainText;
         }
     }
@@ -266,14 +272,23 @@ char MSDKDnsHexCharToChar(char high, char low) {
 //    Byte bytes[] = {0xd3,0xdd,0xee,0x42,0xc7,0xe6,0xf0,0x8a,0x10,0x77,0xab,0xc4,0xf7,0xa5,0x9d,0x6c};
 //    MSDKDNSLOG(@"bytes 的16进制数为:%@",[self hexStringFromBytes:bytes length:16]);
     NSData *ivByte = [self bytesFromHexString:ivStr length:16];
-    if (!ivStr) {
+    if (!ivByte) {
+        return nil;
+    }
+    NSData *context = [self aesContextWithKey:key];
+    int srcLen = (int)plainText.length;
+    // iv 与密文的十六进制直接写入同一个Buffer，不再生成中间的 NSData/NSString
+    NSMutableData *hexData = [NSMutableData dataWithLength:32 + 2 * self_dns::AesGetOutLen(srcLen, AES_ENCRYPT)];
+    char *hex = (char *)hexData.mutableBytes;
+    memcpy(hex, ivStr.UTF8String, 32);
+    size_t encryHexLen = 0;
+    if (!self_dns::AesCbcEncryptPkcs7Hex((const self_dns::AesCbcContext *)context.bytes, (const unsigned char *)plainText.UTF8String, srcLen,
+                                         (const unsigned char *)ivByte.bytes, hex + 32, &encryHexLen)) {
         return nil;
     }
-    NSData *encryData = [self aesCryptWithKey:AES_ENCRYPT src:(unsigned char *)plainText.UTF8String srcLen:(int)plainText.length key:(unsigned char *)key.UTF8String aesIv:(unsigned char *)[ivByte bytes]];//(unsigned char *)temphead.bytes];
-    NSString *encryString = MSDKDnsDataToHexString(encryData);
     
 //    MSDKDNSLOG(@"加密 ||| realText:%@ encryString：%@，iv：%@",plainText,encryString,ivStr);
-    return [ivStr stringByAppendingString:encryString];
+    return [[NSString alloc] initWithBytes:hex length:32 + encryHexLen encoding:NSASCIIStringEncoding];
 }
 
 // AES解密
@@ -283,46 +298,50 @@ char MSDKDnsHexCharToChar(char high, char low) {
         return nil;
     }
     
-    NSString *ivStr = [cipherString substringWithRange:NSMakeRange(0, 32)];
-    NSData *ivByte = [self bytesFromHexString:ivStr length:16];
-
-    NSString *realContent = [cipherString substringWithRange:NSMakeRange(32, cipherString.length - 32)];
-    NSData *encryData = MSDKDNSHexStringToData(realContent);
-    if (!encryData) {
+    // 前32个字符为iv，其后为密文，直接在UTF8字节上解码，不再截取子串
+    const char *hex = cipherString.UTF8String;
+    size_t hexLen = hex ? strlen(hex) : 0;
+    unsigned char iv[AES_BLOCK_SIZE];
+    if (hexLen <= 32 || !msdkdns::msdkdns_hex_decode(hex, 32, iv)) {
         return nil;
     }
-    NSData *dencryData = [self aesCryptWithKey:AES_DECRYPT src:(unsigned char *)[encryData bytes] srcLen:(int)encryData.length key:(unsigned char *)key.UTF8String aesIv:(unsigned char *)[ivByte bytes]];
-    if (!dencryData) {
+    // 密文逐块解码并原地解密到同一个Buffer，密钥扩展结果按 key 缓存
+    NSMutableData *dencryData = [NSMutableData dataWithLength:(hexLen - 32) / 2];
+    NSData *context = [self aesContextWithKey:key];
+    size_t dencryLen = 0;
+    if (!self_dns::AesCbcDecryptHex((const self_dns::AesCbcContext *)context.bytes, hex + 32, hexLen - 32, iv,
+                                    (unsigned char *)dencryData.mutableBytes, &dencryLen)) {
+        MSDKDNSLOG(@"AES decrypt failed, invalid hex, length or padding");
         return nil;
     }
-    NSString *dencryString = [[NSString alloc] initWithData:dencryData encoding:NSUTF8StringEncoding];
+    NSString *dencryString = [[NSString alloc] initWithBytes:dencryData.bytes length:dencryLen encoding:NSUTF8StringEncoding];
     
 //    MSDKDNSLOG(@"解密 === realContent：%@，iv：%@   dencryString:%@",realContent,ivStr,dencryString);
 
     return dencryString;
 }
 
-+ (NSData *)aesCryptWithKey:(int)mode
-                        src:(unsigned char *)src
-                     srcLen:(int)src_len
-                        key:(unsigned char *)aes_key
-                      aesIv:(unsigned char *)AES_IV
+// dnsKey 在 initConfig 之后不会变化，缓存其加解密密钥扩展结果，避免每次请求重复计算
++ (NSData *)aesContextWithKey:(NSString *)key
 {
-    int res_len = self_dns::AesGetOutLen(src_len, mode);
-    unsigned char *res_buf = nullptr;
-    // 注意这里是非字符串，二进制形式，不需要额外加一，留给\0
-    if (res_len > 0) {
-        res_buf = (unsigned char *)calloc(res_len, sizeof(unsigned char));
-        // 注意: 解密后的长度可能会比output的长度要短，因为要预留padding长度
-        if (res_buf != nullptr) { // 进行空指针判断
-            int decodedLen = self_dns::AesCryptWithKey(src, src_len, res_buf, mode, aes_key, AES_IV);
-            res_len = decodedLen < res_len ? decodedLen : res_len;
-            NSData *ret = [NSData dataWithBytes:res_buf length:res_len];
-            free(res_buf); // 在返回值之前释放res_buf
-            return ret;
+    static NSString *cachedKey = nil;
+    static NSData *cachedContext = nil;
+    @synchronized(self) {
+        if (cachedContext && [cachedKey isEqualToString:key]) {
+            return cachedContext;
         }
     }
-    return nil; // 如果分配内存失败，则返回nil
+    unsigned char keyBytes[AES_KEY_SIZE / 8] = {0};
+    strncpy((char *)keyBytes, key.UTF8String, sizeof(keyBytes));
+    self_dns::AesCbcContext context;
+    self_dns::AesCbcInit(&context, keyBytes, AES_KEY_SIZE);
+    // context 只读，以 NSData 持有，可在锁外并发使用
+    NSData *contextData = [NSData dataWithBytes:&context length:sizeof(context)];
+    @synchronized(self) {
+        cachedKey = [key copy];
+        cachedContext = contextData;
+    }
+    return contextData;
 }
 
 // 获取16个字节的随机串
@@ -332,12 +351,7 @@ char MSDKDnsHexCharToChar(char high, char low) {
     uint8_t randomBytes[size];
     int result = SecRandomCopyBytes(kSecRandomDefault, size, randomBytes);
     if (result == errSecSuccess) {
-        NSMutableString *randomString = [[NSMutableString alloc] initWithCapacity:size * 2];
-        for (int i = 0; i < size; i++) {
-            [randomString appendFormat:@"%02x", randomBytes[i]];
-        }
-
-        return randomString;
+        return [self hexStringFromBytes:randomBytes length:size];
     } else {
         return nil;
     }
@@ -346,55 +360,26 @@ char MSDKDnsHexCharToChar(char high, char low) {
 // bytes -> hexstring
 + (NSString *)hexStringFromBytes:(Byte *)bytes length:(int)strLen
 {
-    NSMutableString *hexStr = [NSMutableString string];
-    for(int i=0; i < strLen; i++)
-    {
-        NSString *newHexStr = [NSString stringWithFormat:@"%x",bytes[i]&0xff];///16进制数
-        if([newHexStr length]==1)
-        {
-            [hexStr appendFormat:@"0%@",newHexStr];
-        } else {
-            [hexStr appendFormat:@"%@",newHexStr];
-        }
+    if (!bytes || strLen <= 0) {
+        return @"";
     }
-    return [hexStr copy];
+    char hex[strLen * 2];
+    msdkdns::msdkdns_hex_encode(bytes, strLen, hex);
+    return [[NSString alloc] initWithBytes:hex length:strLen * 2 encoding:NSASCIIStringEncoding];
 }
 
-// hexstring -> bytes
+// hexstring -> bytes，长度不符或包含非十六进制字符时返回nil
 + (NSData *)bytesFromHexString:(NSString *)hexString length:(int)len
 {
-    int j=0;
-    Byte bytes[len];
-    for(int i=0;i<[hexString length];i++)
-    {
-        int int_ch;  /// 两位16进制数转化后的10进制数
-
-        unichar hex_char1 = [hexString characterAtIndex:i]; ////两位16进制数中的第一位(高位*16)
-        int int_ch1;
-        if(hex_char1 >= '0' && hex_char1 <='9')
-        int_ch1 = (hex_char1-48)*16;   //// 0 的Ascll - 48
-        else if(hex_char1 >= 'A' && hex_char1 <='F')
-        int_ch1 = (hex_char1-55)*16; //// A 的Ascll - 65
-        else
-        int_ch1 = (hex_char1-87)*16; //// a 的Ascll - 97
-        i++;
-
-        unichar hex_char2 = [hexString characterAtIndex:i]; ///两位16进制数中的第二位(低位)
-        int int_ch2;
-        if(hex_char2 >= '0' && hex_char2 <='9')
-        int_ch2 = (hex_char2-48); //// 0 的Ascll - 48
-        else if(hex_char1 >= 'A' && hex_char1 <='F')
-        int_ch2 = hex_char2-55; //// A 的Ascll - 65
-        else
-        int_ch2 = hex_char2-87; //// a 的Ascll - 97
-
-        int_ch = int_ch1+int_ch2;
-        bytes[j] = int_ch;  ///将转化后的数放入Byte数组里
-        j++;
-    }
-    NSData *newData = [[NSData alloc] initWithBytes:bytes length:len];
-//    MSDKDNSLOG(@"newData=%@",newData);
-    return newData;
+    const char *hex = hexString.UTF8String;
+    if (!hex || len < 0 || strlen(hex) != (size_t)len * 2) {
+        return nil;
+    }
+    NSMutableData *data = [NSMutableData dataWithLength:len];
+    if (!msdkdns::msdkdns_hex_decode(hex, len * 2, (uint8_t *)data.mutableBytes)) {
+        return nil;
+    }
+    return data;
 }
 
 + (NSURL *) httpsUrlWithDomain:(NSString *)domain dnsId:(int)dnsId dnsKey:(NSString *)dnsKey ipType:(HttpDnsIPType)ipType
@@ -403,6 +388,10 @@ char MSDKDnsHexCharToChar(char high, char low) {
 }
 
 + (NSURL *)httpsUrlWithDomain:(NSString *)domain dnsId:(int)dnsId dnsKey:(NSString *)dnsKey ipType:(HttpDnsIPType)ipType encryptType:(NSInteger)encryptType {
+    return [self httpsUrlWithDomain:domain dnsId:dnsId dnsKey:dnsKey ipType:ipType encryptType:encryptType serviceIp:nil];
+}
+
++ (NSURL *)httpsUrlWithDomain:(NSString *)domain dnsId:(int)dnsId dnsKey:(NSString *)dnsKey ipType:(HttpDnsIPType)ipType encryptType:(NSInteger)encryptType serviceIp:(NSString *)serviceIp {
     if (![self validateParams:domain dnsId:dnsId dnsKey:dnsKey encryptType:encryptType]) {
         return nil;
     }
@@ -412,7 +401,7 @@ char MSDKDnsHexCharToChar(char high, char low) {
         MSDKDNSLOG(@"HttpDns domain Crypt Error!");
         return nil;
     }
-    NSString *urlStr = [self buildUrlStringWithDomain:domainEncrypStr domain:domain dnsId:dnsId ipType:ipType encryptType:encryptType];
+    NSString *urlStr = [self buildUrlStringWithDomain:domainEncrypStr domain:domain dnsId:dnsId ipType:ipType encryptType:encryptType serviceIp:serviceIp];
     NSURL *url = [NSURL URLWithString:urlStr];
     MSDKDNSLOG(@"httpdns service url: %@",url);
     return url;
@@ -451,9 +440,11 @@ char MSDKDnsHexCharToChar(char high, char low) {
     return domainEncrypStr;
 }
 
-+ (NSString *)buildUrlStringWithDomain:(NSString *)domainEncrypStr domain:(NSString *)domain dnsId:(int)dnsId ipType:(HttpDnsIPType)ipType encryptType:(NSInteger)encryptType {
++ (NSString *)buildUrlStringWithDomain:(NSString *)domainEncrypStr domain:(NSString *)domain dnsId:(int)dnsId ipType:(HttpDnsIPType)ipType encryptType:(NSInteger)encryptType serviceIp:(NSString *)serviceIp {
     // 构建 URL 字符串的代码
-    NSString *serviceIp = [[MSDKDnsManager shareInstance] currentDnsServer];
+    if (!serviceIp) {
+        serviceIp = [[MSDKDnsManager shareInstance] currentDnsServer];
+    }
     NSString *routeIp = [[MSDKDnsParamsManager shareInstance] msdkDnsGetRouteIp];
     NSString *protocol = encryptType == HttpDnsEncryptTypeHTTPS ? @"https" : @"http";
     NSString *sdkVersion = @"2_x.x.x";
@@ -564,7 +555,15 @@ char MSDKDnsHexCharToChar(char high, char low) {
     for(int i = 0; i < [data count]; i++) {
         NSString *d = [data objectAtIndex:i];
         if (d && d.length > 0) {
-            [lowerCaseArray addObject:[d lowercaseString]];
+            // 与缓存等各表的键保持一致：转小写并去掉结尾的点；不合法的域名只转小写，由解析流程返回失败
+            const char *text = [d UTF8String];
+            char canonical[msdkdns::kMSDKDnsMaxDomainLength];
+            size_t length = 0;
+            NSString *key = nil;
+            if (text && msdkdns::msdkdns_canonicalize_domain(text, strlen(text), canonical, &length)) {
+                key = [[NSString alloc] initWithBytes:canonical length:length encoding:NSUTF8StringEncoding];
+            }
+            [lowerCaseArray addObject:key ?: [d lowercaseString]];
         }
     }
     return lowerCaseArray;
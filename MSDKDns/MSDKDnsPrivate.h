@@ -24,6 +24,13 @@
 #define kMSDKHttpDnsInfo_BOTH @"httpDnsInfo_BOTH"
 #define kMSDKLocalDnsCache @"localDnsCache"
 
+// IP RTT历史
+#define kMSDKDnsRttSRTT @"srtt"
+#define kMSDKDnsRttVar @"rttvar"
+#define kMSDKDnsRttFailRate @"failRate"
+#define kMSDKDnsRttSamples @"samples"
+#define kMSDKDnsRttUpdated @"updated"
+
 // HttpDns解析结果数据上报相关
 #define MSDKDnsEventName @"HDNSGetHostByName"
 
@@ -9,6 +9,7 @@
 #import "MSDKDnsLog.h"
 #import "MSDKDnsPrivate.h"
 #import "MSDKDnsManager.h"
+#import "MSDKDnsDomainCache.h"
 #import "MSDKDnsDB.h"
 #import "MSDKDnsNetworkManager.h"
 #import "MSDKDnsParamsManager.h"
@@ -102,7 +103,7 @@
     // 当过期缓存expiredIPEnabled未开启的情况下，才清除缓存
     if (!expiredIPEnabled) {
         //查询前清除缓存
-        [[MSDKDnsManager shareInstance] clearCacheForDomains:self.toCheckDomains];
+        [self clearUnusableCacheBeforeCheck];
     }
     
     //无网络直接返回
@@ -163,7 +164,7 @@
     // 当过期缓存expiredIPEnabled未开启的情况下，才清除缓存
     if (!expiredIPEnabled) {
         //查询前清除缓存
-        [[MSDKDnsManager shareInstance] clearCacheForDomains:self.toCheckDomains];
+        [self clearUnusableCacheBeforeCheck];
     }
     
     //无网络直接返回
@@ -211,6 +212,20 @@
     });
 }
 
+// 只清除已过期或不存在的缓存，刷新请求进行中和失败时，未过期的缓存仍可使用
+- (void)clearUnusableCacheBeforeCheck {
+    MSDKDnsDomainCache * cache = [[MSDKDnsManager shareInstance] domainDict];
+    NSMutableArray * domains = [NSMutableArray arrayWithCapacity:self.toCheckDomains.count];
+    for (NSString * domain in self.toCheckDomains) {
+        if (![[cache cacheStatusForKey:domain] isEqualToString:MSDKDnsDomainCacheHit]) {
+            [domains addObject:domain];
+        }
+    }
+    if (domains.count > 0) {
+        [[MSDKDnsManager shareInstance] clearCacheForDomains:domains];
+    }
+}
+
 //进行httpdns ipv4和ipv6合并请求
 - (void)startHttpDnsBoth:(float)timeOut dnsId:(int)dnsId dnsKey:(NSString *)dnsKey encryptType:(NSInteger)encryptType
 {
@@ -262,55 +277,38 @@
         if (resolver == self.httpDnsResolver_A || resolver == self.httpDnsResolver_4A || resolver == self.httpDnsResolver_BOTH) {
             NSArray *keepAliveDomains = [[MSDKDnsParamsManager shareInstance] msdkDnsGetKeepAliveDomains];
             BOOL enableKeepDomainsAlive = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEnableKeepDomainsAlive];
-            // 获取延迟记录字典
-            NSMutableDictionary *domainISOpenDelayDispatch = [[MSDKDnsManager shareInstance] msdkDnsGetDomainISOpenDelayDispatch];
             [domainInfo enumerateKeysAndObjectsUsingBlock:^(id  _Nonnull domain, id  _Nonnull obj, BOOL * _Nonnull stop) {
                 // NSLog(@"domain = %@", domain);
                 // NSLog(@"domainInfo = %@", domainInfo);
                 // 判断此次请求的域名中有多少属于保活域名，是则开启延时解析请求，自动刷新缓存
-                if (enableKeepDomainsAlive && keepAliveDomains && domain && [keepAliveDomains containsObject:domain]) {
-                    NSMutableString * afterTime = [[NSMutableString alloc] init];
+                // 近期查询较多的热点域名同样开启，是否实际刷新在到期时按请求预算决定
+                if (enableKeepDomainsAlive && domain && ((keepAliveDomains && [keepAliveDomains containsObject:domain]) || [[MSDKDnsManager shareInstance] isHotDomain:domain])) {
+                    double afterTime = 0;
                     if(resolver == self.httpDnsResolver_BOTH){
                         NSDictionary *domainResult = domainInfo[domain];
                         if (domainResult) {
                             NSDictionary *ipv4Value = [domainResult objectForKey:@"ipv4"];
                             NSDictionary *ipv6Value = [domainResult objectForKey:@"ipv6"];
                             if (ipv6Value) {
-                                NSString *ttl = [ipv6Value objectForKey:kTTL];
-                                afterTime = [[NSMutableString alloc]initWithString:ttl];
+                                afterTime = [[ipv6Value objectForKey:kTTL] doubleValue];
                             }
                             if (ipv4Value) {
-                                NSString *ttl = [ipv4Value objectForKey:kTTL];
-                                afterTime = [[NSMutableString alloc]initWithString:ttl];
+                                afterTime = [[ipv4Value objectForKey:kTTL] doubleValue];
                             }
                         }
                     }else{
                         NSDictionary *domainResult = domainInfo[domain];
                         if (domainResult) {
-                            NSString *ttl = [domainResult objectForKey:kTTL];
-                            afterTime = [[NSMutableString alloc]initWithString:ttl];
+                            afterTime = [[domainResult objectForKey:kTTL] doubleValue];
                         }
                     }
-                    //  NSLog(@"4444444延时更新请求等待，预计在%f秒后开始!请求域名为%@",afterTime.floatValue,domain);
-                    if (!domainISOpenDelayDispatch[domain] && afterTime.floatValue > 0) {
-                        // NSLog(@"获取缓存延时更新after，初始值为%f秒。", afterTime.floatValue);
-                        afterTime = [NSMutableString stringWithFormat:@"%f", afterTime.floatValue * 0.75];
-                        if (afterTime.floatValue < 60) {
-                            afterTime = [[NSMutableString alloc]initWithString:@"60"];
+                    if (afterTime > 0) {
+                        afterTime = afterTime * 0.75;
+                        if (afterTime < 60) {
+                            afterTime = 60;
                         }
-                        // 使用静态字典来记录该域名是否开启了一个延迟解析请求，如果已经开启则忽略，没有则立马开启一个
-                        [[MSDKDnsManager shareInstance] msdkDnsAddDomainOpenDelayDispatch:domain];
-                        MSDKDNSLOG(@"Start the delayed execution task, it is expected to start requesting the domain name %@ after %f seconds", domain, afterTime.floatValue);
-                        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, afterTime.floatValue * NSEC_PER_SEC), [MSDKDnsInfoTool msdkdns_queue], ^{
-                            // NSLog(@"缓存延时更新请求开始!请求域名为%@", domain);
-                            BOOL enableKeepDomainsAlive = [[MSDKDnsParamsManager shareInstance] msdkDnsGetEnableKeepDomainsAlive];
-                            if (enableKeepDomainsAlive) {
-                                MSDKDNSLOG(@"The cache update request start! request domain:%@",domain);
-                                [[MSDKDnsManager shareInstance] refreshCacheDelay:@[domain] clearDispatchTag:YES];
-                            }else {
-                                [[MSDKDnsManager shareInstance] msdkDnsClearDomainsOpenDelayDispatch:@[domain]];
-                            }
-                        });
+                        // 该域名是否已开启延迟解析请求在其 lane 中判断，已开启则忽略，没有则交给时间轮调度
+                        [[MSDKDnsManager shareInstance] msdkDnsOpenDelayDispatchForDomain:domain afterTime:afterTime];
                     }
                 }
             }];
@@ -321,7 +319,7 @@
 }
 
 - (void)excuteIPRank:(MSDKDnsResolver *)resolver didGetDomainInfo:(NSDictionary *)domainInfo {
-    if (resolver == self.httpDnsResolver_A || resolver == self.httpDnsResolver_BOTH) {
+    if (resolver == self.httpDnsResolver_A || resolver == self.httpDnsResolver_4A || resolver == self.httpDnsResolver_BOTH) {
         NSDictionary *IPRankData = [[MSDKDnsParamsManager shareInstance] msdkDnsGetIPRankData];
         if (IPRankData) {
             [domainInfo enumerateKeysAndObjectsUsingBlock:^(id  _Nonnull domain, id  _Nonnull obj, BOOL * _Nonnull stop) {
@@ -344,7 +342,14 @@
                             if (ipv4Value) {
                                 NSArray *ips = [ipv4Value objectForKey:kIP];
                                 if(ips){
-                                    [self aysncUpdateIPRankingWithResult:ips forHost:domain];
+                                    [self aysncUpdateIPRankingWithResult:ips forHost:domain cacheKey:kMSDKHttpDnsCache_A];
+                                }
+                            }
+                            NSDictionary *ipv6Value = [domainResult objectForKey:@"ipv6"];
+                            if (ipv6Value) {
+                                NSArray *ips = [ipv6Value objectForKey:kIP];
+                                if(ips){
+                                    [self aysncUpdateIPRankingWithResult:ips forHost:domain cacheKey:kMSDKHttpDnsCache_4A];
                                 }
                             }
                         }
@@ -353,7 +358,8 @@
                         if (domainResult) {
                             NSArray *ips = [domainResult objectForKey:kIP];
                             if(ips){
-                                [self aysncUpdateIPRankingWithResult:ips forHost:domain];
+                                NSString *cacheKey = resolver == self.httpDnsResolver_4A ? kMSDKHttpDnsCache_4A : kMSDKHttpDnsCache_A;
+                                [self aysncUpdateIPRankingWithResult:ips forHost:domain cacheKey:cacheKey];
                             }
                         }
                     }
@@ -364,7 +370,7 @@
 }
 
 - (NSDictionary *)getDomainsDNSFromCache:(NSArray *)domains {
-    NSDictionary * cacheDict = [[MSDKDnsManager shareInstance] domainDict];
+    MSDKDnsDomainCache * cacheDict = [[MSDKDnsManager shareInstance] domainDict];
     NSString * localDnsIPs = @"";
     NSString * httpDnsIP_A = @"";
     NSString * httpDnsIP_4A = @"";
@@ -416,21 +422,23 @@
     };
 }
 
-- (void)aysncUpdateIPRankingWithResult:(NSArray *)IPStrings forHost:(NSString *)host {
+- (void)aysncUpdateIPRankingWithResult:(NSArray *)IPStrings forHost:(NSString *)host cacheKey:(NSString *)cacheKey {
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(void) {
-        [self syncUpdateIPRankingWithResult:IPStrings forHost:host];
+        [self syncUpdateIPRankingWithResult:IPStrings forHost:host cacheKey:cacheKey];
     });
 }
 
-- (void)syncUpdateIPRankingWithResult:(NSArray *)IPStrings forHost:(NSString *)host {
+- (void)syncUpdateIPRankingWithResult:(NSArray *)IPStrings forHost:(NSString *)host cacheKey:(NSString *)cacheKey {
     NSArray *sortedIps = [[MSDKDnsTCPSpeedTester new] ipRankingWithIPs:IPStrings host:host];
-    [self updateHostManagerDictWithIPs:sortedIps host:host];
+    [self updateHostManagerDictWithIPs:sortedIps host:host cacheKey:cacheKey];
 }
 
-- (void)updateHostManagerDictWithIPs:(NSArray *)ips host:(NSString *)host {
+// cacheKey 为 kMSDKHttpDnsCache_A 或 kMSDKHttpDnsCache_4A，只更新对应协议栈的IP顺序
+- (void)updateHostManagerDictWithIPs:(NSArray *)ips host:(NSString *)host cacheKey:(NSString *)cacheKey {
     if(!ips){
         return;
     }
+    BOOL isIPv6 = [cacheKey isEqualToString:kMSDKHttpDnsCache_4A];
     dispatch_async([MSDKDnsInfoTool msdkdns_queue], ^{
         NSDictionary * tempDict = [[[MSDKDnsManager shareInstance] domainDict] objectForKey:host];
         NSMutableDictionary *cacheDict;
@@ -438,26 +446,22 @@
         if (tempDict) {
             cacheDict = [NSMutableDictionary dictionaryWithDictionary:tempDict];
             
-            if (self.httpDnsResolver_A && self.httpDnsResolver_A.domainInfo) {
-                
-                NSDictionary *cacheValue = [self.httpDnsResolver_A.domainInfo objectForKey:host];
-                if (cacheValue) {
-                    NSMutableDictionary *newCacheValue = [NSMutableDictionary dictionaryWithDictionary:cacheValue];
-                    [newCacheValue setValue:ips forKey:kIP];
-                    [cacheDict setObject:newCacheValue forKey:kMSDKHttpDnsCache_A];
-                }
-                
+            NSDictionary *familyCacheValue = nil;
+            if (!isIPv6 && self.httpDnsResolver_A && self.httpDnsResolver_A.domainInfo) {
+                familyCacheValue = [self.httpDnsResolver_A.domainInfo objectForKey:host];
+            } else if (isIPv6 && self.httpDnsResolver_4A && self.httpDnsResolver_4A.domainInfo) {
+                familyCacheValue = [self.httpDnsResolver_4A.domainInfo objectForKey:host];
             } else if (self.httpDnsResolver_BOTH && self.httpDnsResolver_BOTH.domainInfo) {
                 NSDictionary *cacheValue = [self.httpDnsResolver_BOTH.domainInfo objectForKey:host];
                 if (cacheValue) {
-                    NSDictionary *ipv4CacheValue = [cacheValue objectForKey:@"ipv4"];
-                    if (ipv4CacheValue) {
-                        NSMutableDictionary *newCacheValue = [NSMutableDictionary dictionaryWithDictionary:ipv4CacheValue];
-                        [newCacheValue setValue:ips forKey:kIP];
-                        [cacheDict setObject:newCacheValue forKey:kMSDKHttpDnsCache_A];
-                    }
+                    familyCacheValue = [cacheValue objectForKey:isIPv6 ? @"ipv6" : @"ipv4"];
                 }
             }
+            if (familyCacheValue) {
+                NSMutableDictionary *newCacheValue = [NSMutableDictionary dictionaryWithDictionary:familyCacheValue];
+                [newCacheValue setValue:ips forKey:kIP];
+                [cacheDict setObject:newCacheValue forKey:cacheKey];
+            }
             
             if (cacheDict && host) {
                 [[MSDKDnsManager shareInstance] cacheDomainInfo:cacheDict domain:host];
@@ -619,6 +623,7 @@
             [self reportDataTransform];
         }
     }
+    [self recordNegativeCacheWithResolver:resolver Info:info];
     if (self.isCallBack) {
         return;
     }
@@ -648,6 +653,25 @@
     [self excuteReport];
 }
 
+// 按HTTPDNS的解析结果更新负缓存，LocalDNS的结果不参与
+- (void)recordNegativeCacheWithResolver:(MSDKDnsResolver *)resolver Info:(NSDictionary *)info {
+    msdkdns::MSDKDNS_TLocalIPStack netStack = msdkdns::MSDKDNS_ELocalIPStack_None;
+    if (resolver && resolver == self.httpDnsResolver_A) {
+        netStack = msdkdns::MSDKDNS_ELocalIPStack_IPv4;
+    } else if (resolver && resolver == self.httpDnsResolver_4A) {
+        netStack = msdkdns::MSDKDNS_ELocalIPStack_IPv6;
+    } else if (resolver && resolver == self.httpDnsResolver_BOTH) {
+        netStack = msdkdns::MSDKDNS_ELocalIPStack_Dual;
+    } else {
+        return;
+    }
+    NSArray * answered = [resolver.domainInfo allKeys];
+    [[MSDKDnsManager shareInstance] msdkDnsRecordResolveResultOfDomains:self.toCheckDomains
+                                                               answered:answered
+                                                              errorCode:info[kDnsErrCode]
+                                                               netStack:netStack];
+}
+
 - (void)excuteCallNotify {
     BOOL httpOnly = [[MSDKDnsParamsManager shareInstance] msdkDnsGetHttpOnly];
     BOOL expiredIPEnabled = [[MSDKDnsParamsManager shareInstance] msdkDnsGetExpiredIPEnabled];
@@ -683,7 +707,7 @@
 
 - (void)reportDataTransform {
     BOOL httpOnly = [[MSDKDnsParamsManager shareInstance] msdkDnsGetHttpOnly];
-    NSDictionary *tempDict = [[MSDKDnsManager shareInstance] domainDict];
+    MSDKDnsDomainCache *tempDict = [[MSDKDnsManager shareInstance] domainDict];
     
     // 当开启上报服务时
     if ([[MSDKDnsParamsManager shareInstance] msdkDnsGetEnableReport]) {
@@ -693,7 +717,7 @@
     }
 }
 
-- (NSDictionary *)getReportParamsWithRouteIP:(NSString *)routeip andTempDict:(NSDictionary *)tempDict andHttpOnly:(BOOL)httpOnly {
+- (NSDictionary *)getReportParamsWithRouteIP:(NSString *)routeip andTempDict:(MSDKDnsDomainCache *)tempDict andHttpOnly:(BOOL)httpOnly {
     NSString *req_type = @"a";
     NSString *serviceIp = @"";
     NSNumber *status = @0;
@@ -4,29 +4,28 @@
 
 #import "MSDKDnsTCPSpeedTester.h"
 #import "MSDKDnsParamsManager.h"
+#import "MSDKDnsRttManager.h"
 #import "MSDKDnsLog.h"
-#import <sys/socket.h>
-#import <netinet/in.h>
-#import <fcntl.h>
-#import <arpa/inet.h>
-#import <netdb.h>
-#include <sys/time.h>
+#include "msdkdns_tcp_prober.h"
 
-static NSString *const testSpeedKey = @"testSpeed";
-static NSString *const ipKey = @"ip";
+// 参与测速的IP个数上限，超出部分保持原有顺序排在最后
+static const NSUInteger kMSDKDnsSpeedTestMaxIPs = 32;
+// 建连成功的IP数达到该值即停止等待，其余IP保持原有顺序排在其后
+static const size_t kMSDKDnsSpeedTestQuorum = 3;
 
 @implementation MSDKDnsTCPSpeedTester
 
 /**
  *
- - IP池在2个到9个范围内，才进行测速逻辑。
- -
+ - IP池至少2个才进行测速逻辑。
+ - 所有IP并发建连，按建连完成先后排序，整体耗时不超过 MSDKDNS_SOCKET_CONNECT_TIMEOUT。
+ - 历史RTT足够新且稳定时直接按历史排序，不再测速。
  */
 - (NSArray<NSString *> *)ipRankingWithIPs:(NSArray<NSString *> *)ips host:(NSString *)host {
     if (!ips || !host) {
         return nil;
     }
-    if (ips.count < 2 || ips.count > 9) {
+    if (ips.count < 2) {
         return nil;
     }
     
@@ -45,30 +44,49 @@ static NSString *const ipKey = @"ip";
         port = [port_ integerValue];
     } @catch (NSException *exception) {}
     
-    NSMutableArray<NSDictionary *> *ipSpeeds = [NSMutableArray arrayWithCapacity:ips.count];
-    for (NSString *ip in ips) {
-        float testSpeed =  [self testSpeedOf:ip port:port];
-        MSDKDNSLOG(@"%@:%hd speed is %f",ip,port,testSpeed);
-        if (testSpeed == 0) {
-            testSpeed = MSDKDNS_SOCKET_CONNECT_TIMEOUT_RTT;
-        }
-        NSMutableDictionary *ipSpeed = [NSMutableDictionary dictionaryWithCapacity:2];
-        [ipSpeed setObject:@(testSpeed) forKey:testSpeedKey];
-        [ipSpeed setObject:ip forKey:ipKey];
-        [ipSpeeds addObject:ipSpeed];
+    MSDKDnsRttManager *rttManager = [MSDKDnsRttManager shareInstance];
+    BOOL needProbe = YES;
+    NSArray<NSString *> *historyIPs = [rttManager rankIPs:ips port:(uint16_t)port needProbe:&needProbe];
+    if (!needProbe && historyIPs.count == ips.count) {
+        MSDKDNSLOG(@"%@:%hd ranked by rtt history, skip probing", host, port);
+        return historyIPs;
+    }
+    
+    NSUInteger testCount = MIN(ips.count, kMSDKDnsSpeedTestMaxIPs);
+    std::vector<std::string> testIPs;
+    testIPs.reserve(testCount);
+    for (NSUInteger i = 0; i < testCount; i++) {
+        NSString *ip = ips[i];
+        testIPs.push_back([ip isKindOfClass:[NSString class]] ? std::string([ip UTF8String]) : std::string());
     }
     
-    NSArray *sortedIPSpeedsArray = [ipSpeeds sortedArrayUsingComparator:^NSComparisonResult(id obj1, id obj2) {
-        NSNumber *data1 = [NSNumber numberWithFloat:[[obj1 valueForKey:testSpeedKey] floatValue]];
-        NSNumber *data2 = [NSNumber numberWithFloat:[[obj2 valueForKey:testSpeedKey] floatValue]];
-        return [data1 compare:data2];
-    }];
+    // 本轮之后短时间内不再因为被取消或超出测速个数、没有结果的IP重新测速
+    [rttManager markProbedIPs:ips port:(uint16_t)port];
+    std::vector<msdkdns::msdkdns_probe_result> results;
+    size_t connected = msdkdns::msdkdns_tcp_probe(testIPs, (uint16_t)port, MSDKDNS_SOCKET_CONNECT_TIMEOUT * 1000,
+                                                  kMSDKDnsSpeedTestQuorum, &results);
+    MSDKDNSLOG(@"%@:%hd ranking done, %zu of %lu connected", host, port, connected, (unsigned long)testCount);
     
-    NSMutableArray<NSString *> *sortedArrayIPs = [NSMutableArray arrayWithCapacity:ips.count];
-    for (NSDictionary *dict in sortedIPSpeedsArray) {
-       NSString *ip = [dict objectForKey:ipKey];
-        [sortedArrayIPs addObject:ip];
+    for (size_t i = 0; i < results.size(); i++) {
+        const msdkdns::msdkdns_probe_result &result = results[i];
+        NSString *ip = ips[result.index];
+        switch (result.state) {
+            case msdkdns::MSDKDNS_EProbeState_Connected:
+                MSDKDNSLOG(@"%@:%hd speed is %f", ip, port, result.rtt_ms);
+                [rttManager recordIP:ip port:(uint16_t)port rtt:result.rtt_ms];
+                break;
+            case msdkdns::MSDKDNS_EProbeState_Failed:
+            case msdkdns::MSDKDNS_EProbeState_Timeout:
+                [rttManager recordFailureOfIP:ip port:(uint16_t)port];
+                break;
+            default:
+                // 被取消的IP没有结论，只记录了测速时间
+                break;
+        }
     }
+    
+    // 结合本次测速与历史重新排序
+    NSArray<NSString *> *sortedArrayIPs = [rttManager rankIPs:ips port:(uint16_t)port needProbe:NULL];
     //保证数量一致，
     if (sortedArrayIPs.count == ips.count) {
         return [sortedArrayIPs copy];
@@ -77,81 +95,29 @@ static NSString *const ipKey = @"ip";
 }
 
 /**
- *  @return 测速结果，单位时毫秒，MSDKDNS_SOCKET_CONNECT_TIMEOUT_RTT 代表超时。
+ *  @return 测速结果，单位时毫秒，MSDKDNS_SOCKET_CONNECT_TIMEOUT_RTT 代表超时，0 代表失败。
  */
 - (float)testSpeedOf:(NSString *)ip port:(int16_t)port {
-    NSString *oldIp = ip;
-    //request time out
-    float rtt = 0.0;
-    //sock：将要被设置或者获取选项的套接字。
-    int s = 0;
-    struct sockaddr_in saddr;
-    saddr.sin_family = AF_INET;
-    saddr.sin_port = htons(port);
-    saddr.sin_addr.s_addr = inet_addr([ip UTF8String]);
-    if( (s=socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        MSDKDNSLOG(@"ERROR:%s:%d, create socket failed.",__FUNCTION__,__LINE__);
+    if (!ip) {
         return 0;
     }
-    NSDate *startTime = [NSDate date];
-    NSDate *endTime;
-    //为了设置connect超时 把socket设置称为非阻塞
-    int flags = fcntl(s, F_GETFL,0);
-    fcntl(s,F_SETFL, flags | O_NONBLOCK);
-    int i = connect(s,(struct sockaddr*)&saddr, sizeof(saddr));
-    if(i == 0) {
-        //建立连接成功，返回rtt时间。 因为connect是非阻塞，所以这个时间就是一个函数执行的时间，毫秒级，没必要再测速了。
-        close(s);
-        return 1;
-    }
-    struct timeval tv;
-    int valopt;
-    socklen_t lon;
-    tv.tv_sec = MSDKDNS_SOCKET_CONNECT_TIMEOUT;
-    tv.tv_usec = 0;
-    
-    fd_set myset;
-    FD_ZERO(&myset);
-    FD_SET(s, &myset);
-    
-    // MARK: - 使用select函数，对套接字的IO操作设置超时。
-    /**
-     select函数
-     select是一种IO多路复用机制，它允许进程指示内核等待多个事件的任何一个发生，并且在有一个或者多个事件发生或者经历一段指定的时间后才唤醒它。
-     connect本身并不具有设置超时功能，如果想对套接字的IO操作设置超时，可使用select函数。
-     **/
-    int maxfdp = s+1;
-    int j = select(maxfdp, NULL, &myset, NULL, &tv);
-    
-    if (j == 0) {
-        MSDKDNSLOG(@"INFO:%s:%d, test rtt of (%@) timeout.",__FUNCTION__,__LINE__, oldIp);
-        rtt = MSDKDNS_SOCKET_CONNECT_TIMEOUT_RTT;
-        close(s);
-        return rtt;
-    }
-    
-    if (j < 0) {
-        MSDKDNSLOG(@"ERROR:%s:%d, select function error.",__FUNCTION__,__LINE__);
-        rtt = 0;
-        close(s);
-        return rtt;
+    std::vector<std::string> testIPs(1, std::string([ip UTF8String]));
+    std::vector<msdkdns::msdkdns_probe_result> results;
+    msdkdns::msdkdns_tcp_probe(testIPs, (uint16_t)port, MSDKDNS_SOCKET_CONNECT_TIMEOUT * 1000, 1, &results);
+    if (results.empty()) {
+        return 0;
     }
-    /**
-     对于select和非阻塞connect，注意两点：
-     [1] 当连接成功建立时，描述符变成可写； [2] 当连接建立遇到错误时，描述符变为即可读，也可写，遇到这种情况，可调用getsockopt函数。
-     **/
-    lon = sizeof(int);
-    //valopt 表示错误信息。
-    getsockopt(s, SOL_SOCKET, SO_ERROR, (void*)(&valopt), &lon);
-    if (valopt) {
-        MSDKDNSLOG(@"ERROR:%s:%d, select function error.",__FUNCTION__,__LINE__);
-        rtt = 0;
-    } else {
-        endTime = [NSDate date];
-        rtt = [endTime timeIntervalSinceDate:startTime] * 1000;
+    switch (results[0].state) {
+        case msdkdns::MSDKDNS_EProbeState_Connected:
+            // 与原有语义一致，立即连通时至少返回1ms
+            return MAX((float)results[0].rtt_ms, 1.0f);
+        case msdkdns::MSDKDNS_EProbeState_Timeout:
+            MSDKDNSLOG(@"INFO:%s:%d, test rtt of (%@) timeout.",__FUNCTION__,__LINE__, ip);
+            return MSDKDNS_SOCKET_CONNECT_TIMEOUT_RTT;
+        default:
+            MSDKDNSLOG(@"ERROR:%s:%d, connect to (%@) failed.",__FUNCTION__,__LINE__, ip);
+            return 0;
     }
-    close(s);
-    return rtt;
 }
 
 @end
@@ -0,0 +1,32 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+typedef void (^MSDKDnsHttpCompletionHandler)(NSData *data, NSURLResponse *response, NSError *error);
+
+/**
+ * HTTPDNS 查询使用的 HTTP/1.1 长连接池
+ * 按服务IP保持 keep-alive 连接，并发请求管线化发出，空闲到期前主动重建连接；仅支持 http，https 仍走 NSURLSession
+ */
+@interface MSDKDnsHttpClient : NSObject
+
++ (instancetype)shareInstance;
+
+// 发出 GET 请求，回调参数与 NSURLSession 的 dataTask 一致；URL 不支持时返回 nil，不会回调
+- (NSNumber *)getWithURL:(NSURL *)url timeout:(NSTimeInterval)timeout completionHandler:(MSDKDnsHttpCompletionHandler)completionHandler;
+
+// 以 NSURLErrorCancelled 回调
+- (void)cancelTask:(NSNumber *)task;
+
+// 网络切换后关闭所有连接
+- (void)reset;
+
+// 当前每个连接的复用情况
+- (NSArray<NSDictionary *> *)statistics;
+
+// 累计计数，合并到解析请求统计中
+- (NSDictionary *)summary;
+
+@end
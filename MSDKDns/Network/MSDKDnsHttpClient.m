@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#import "MSDKDnsHttpClient.h"
+#import "MSDKDnsInfoTool.h"
+#import "MSDKDnsLog.h"
+#include "msdkdns_http_pool.h"
+
+// 每个服务IP的连接数及每个连接同时管线化的请求数
+static const size_t kMSDKDnsHttpMaxConnections = 2;
+static const size_t kMSDKDnsHttpMaxPipeline = 4;
+
+@interface MSDKDnsHttpTask : NSObject
+
+@property (strong, nonatomic) NSURL * url;
+@property (copy, nonatomic) MSDKDnsHttpCompletionHandler completionHandler;
+
+@end
+
+@implementation MSDKDnsHttpTask
+@end
+
+static void MSDKDnsHttpClientCallback(void *context, const msdkdns::msdkdns_http_response *response) {
+    MSDKDnsHttpTask *task = (__bridge_transfer MSDKDnsHttpTask *)context;
+    NSData *data = nil;
+    NSHTTPURLResponse *httpResponse = nil;
+    NSError *error = nil;
+    if (response->result == msdkdns::MSDKDNS_EHttpResult_Ok) {
+        data = [NSData dataWithBytes:response->body length:response->body_length];
+        httpResponse = [[NSHTTPURLResponse alloc] initWithURL:task.url statusCode:response->status HTTPVersion:@"HTTP/1.1" headerFields:nil];
+    } else {
+        NSInteger code = NSURLErrorNetworkConnectionLost;
+        NSString *description = @"The network connection was lost.";
+        if (response->result == msdkdns::MSDKDNS_EHttpResult_Timeout) {
+            code = NSURLErrorTimedOut;
+            description = @"The request timed out.";
+        } else if (response->result == msdkdns::MSDKDNS_EHttpResult_ConnectFail) {
+            code = NSURLErrorCannotConnectToHost;
+            description = @"Could not connect to the server.";
+        } else if (response->result == msdkdns::MSDKDNS_EHttpResult_NetworkDown) {
+            code = NSURLErrorNotConnectedToInternet;
+            description = @"The Internet connection appears to be offline.";
+        } else if (response->result == msdkdns::MSDKDNS_EHttpResult_BadResponse) {
+            code = NSURLErrorBadServerResponse;
+            description = @"The server returned a bad response.";
+        } else if (response->result == msdkdns::MSDKDNS_EHttpResult_Cancelled) {
+            code = NSURLErrorCancelled;
+            description = @"cancelled";
+        }
+        error = [NSError errorWithDomain:NSURLErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: description}];
+    }
+    // 回调在连接池线程上，解析、解密等处理放到解析队列，不阻塞其他连接的读写
+    dispatch_async([MSDKDnsInfoTool msdkdns_resolver_queue], ^{
+        task.completionHandler(data, httpResponse, error);
+    });
+}
+
+@interface MSDKDnsHttpClient () {
+    msdkdns::HttpPool * _pool;
+}
+
+@end
+
+@implementation MSDKDnsHttpClient
+
+static MSDKDnsHttpClient * gSharedInstance = nil;
+
++ (instancetype)shareInstance {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        gSharedInstance = [[MSDKDnsHttpClient alloc] init];
+    });
+    return gSharedInstance;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _pool = new msdkdns::HttpPool(kMSDKDnsHttpMaxConnections, kMSDKDnsHttpMaxPipeline);
+        if (!_pool->Start()) {
+            MSDKDNSLOG(@"HttpDns connection pool start failed");
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    delete _pool;
+    _pool = NULL;
+}
+
+- (NSNumber *)getWithURL:(NSURL *)url timeout:(NSTimeInterval)timeout completionHandler:(MSDKDnsHttpCompletionHandler)completionHandler {
+    if (!completionHandler || ![[url.scheme lowercaseString] isEqualToString:@"http"] || !url.host) {
+        return nil;
+    }
+    NSURLComponents *components = [NSURLComponents componentsWithURL:url resolvingAgainstBaseURL:NO];
+    NSString *path = components.percentEncodedPath.length > 0 ? components.percentEncodedPath : @"/";
+    NSString *target = components.percentEncodedQuery ? [NSString stringWithFormat:@"%@?%@", path, components.percentEncodedQuery] : path;
+    // IPv6 服务IP在 URL 中带有方括号
+    NSString *host = [[url.host stringByReplacingOccurrencesOfString:@"[" withString:@""] stringByReplacingOccurrencesOfString:@"]" withString:@""];
+    uint16_t port = url.port ? [url.port unsignedShortValue] : 80;
+
+    MSDKDnsHttpTask *task = [[MSDKDnsHttpTask alloc] init];
+    task.url = url;
+    task.completionHandler = completionHandler;
+    void *context = (__bridge_retained void *)task;
+    uint32_t requestId = _pool->Get([host UTF8String], port, std::string([target UTF8String]), (int)(timeout * 1000),
+                                    MSDKDnsHttpClientCallback, context);
+    if (requestId == 0) {
+        // 地址不是 IP 等情况，由调用方改用 NSURLSession
+        CFBridgingRelease(context);
+        return nil;
+    }
+    return @(requestId);
+}
+
+- (void)cancelTask:(NSNumber *)task {
+    _pool->Cancel([task unsignedIntValue]);
+}
+
+- (void)reset {
+    _pool->Reset();
+    MSDKDNSLOG(@"Reset HttpDns connections");
+}
+
+- (NSArray<NSDictionary *> *)statistics {
+    std::vector<msdkdns::msdkdns_http_connection_stats> connections;
+    _pool->Stats(NULL, &connections);
+    NSMutableArray<NSDictionary *> *result = [NSMutableArray arrayWithCapacity:connections.size()];
+    for (size_t i = 0; i < connections.size(); i++) {
+        const msdkdns::msdkdns_http_connection_stats &item = connections[i];
+        [result addObject:@{
+            @"id": @(item.id),
+            @"server": [NSString stringWithUTF8String:item.server.c_str()] ?: @"",
+            @"requests": @(item.requests),
+            @"reused": @(item.reused),
+            @"pipelined": @(item.pipelined),
+            @"inflight": @(item.inflight),
+            @"age": @(item.age_ms),
+            @"idle": @(item.idle_ms),
+            @"expireIn": @(item.expire_ms),
+        }];
+    }
+    return result;
+}
+
+- (NSDictionary *)summary {
+    msdkdns::msdkdns_http_pool_stats stats;
+    _pool->Stats(&stats, NULL);
+    return @{
+        @"httpRequests": @(stats.requests),
+        @"httpConnects": @(stats.connects),
+        @"httpConnectFailures": @(stats.connect_failures),
+        @"httpReused": @(stats.reused),
+        @"httpPipelined": @(stats.pipelined),
+        @"httpRetried": @(stats.retried),
+        @"httpProactiveReconnects": @(stats.proactive_reconnects),
+    };
+}
+
+@end
@@ -0,0 +1,841 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_http_pool.h"
+#include "msdkdns_timer_wheel.h"
+#include "msdkdns_ip.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+namespace msdkdns {
+
+    // 服务端未返回 Keep-Alive: timeout 时假定的空闲超时
+    static const int64_t kDefaultIdleMs = 15000;
+    // 在服务端空闲超时前提前关闭的余量，避免请求与服务端关闭连接同时发生
+    static const int64_t kIdleMarginMs = 1000;
+    static const int64_t kMinIdleMs = 1000;
+    static const int64_t kMaxIdleMs = 60000;
+    // 最近一次请求后多长时间内，连接到期时主动重建；空闲超时过短的服务器不做预热，避免频繁建连
+    static const int64_t kWarmMs = 60000;
+    static const int64_t kMinWarmIdleMs = 5000;
+    // 没有请求的预热连接的建连超时
+    static const int64_t kConnectTimeoutMs = 5000;
+    static const int64_t kMaxPollMs = 60000;
+    static const int kMaxRetries = 1;
+    static const size_t kMaxHeaderSize = 16 * 1024;
+    static const size_t kMaxBodySize = 1024 * 1024;
+
+    struct HttpPool::Request {
+        uint32_t id;
+        Server *server;
+        std::string wire;
+        int64_t deadline;
+        msdkdns_http_callback callback;  // 已回调（取消）后置为 NULL，仍留在连接上等待丢弃响应
+        void *context;
+        Connection *connection;
+        bool reused;
+        int retries;
+    };
+
+    struct HttpPool::Connection {
+        uint32_t id;
+        Server *server;
+        int fd;
+        bool connected;
+        bool closing;  // 服务端要求关闭，不再分配新请求
+        bool verified; // 完成过一次 keep-alive 响应后才管线化
+        std::deque<Request *> inflight;
+        std::string output;
+        size_t output_offset;
+        std::string input;
+        int64_t created;
+        int64_t last_active;
+        int64_t expire;
+        uint32_t assigned;
+        uint32_t completed;
+        uint32_t reused;
+        uint32_t pipelined;
+        uint32_t remaining;  // Keep-Alive: max
+    };
+
+    struct HttpPool::Server {
+        std::string key;
+        std::string host;
+        struct sockaddr_storage address;
+        socklen_t address_length;
+        std::deque<Request *> queue;
+        std::vector<Connection *> connections;
+        int64_t last_used;
+        int64_t idle_ms;
+        int64_t idle_cap_ms;  // 服务端实际关闭空闲连接的时间，早于其声明的超时时以此为准
+    };
+
+    typedef struct msdkdns_http_parsed {
+        int status;
+        bool keep_alive;
+        int keep_alive_timeout;
+        int keep_alive_max;
+        std::string body;
+    } msdkdns_http_parsed;
+
+    static bool StartsWithIgnoreCase(const char *begin, const char *end, const char *prefix) {
+        for (; *prefix; prefix++, begin++) {
+            if (begin >= end || tolower((unsigned char)*begin) != *prefix) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static std::string Lower(const char *begin, const char *end) {
+        std::string value(begin, end);
+        for (size_t i = 0; i < value.size(); i++) {
+            value[i] = (char)tolower((unsigned char)value[i]);
+        }
+        return value;
+    }
+
+    static int KeepAliveParam(const std::string &value, const char *name) {
+        size_t pos = value.find(name);
+        return pos == std::string::npos ? 0 : atoi(value.c_str() + pos + strlen(name));
+    }
+
+    /*
+     * 从 input 头部解析一个完整的响应，支持 Content-Length、chunked 及读到连接关闭为止三种长度
+     * 返回1解析成功，0数据不足，-1格式错误
+     */
+    static int ParseResponse(const std::string &input, bool eof, msdkdns_http_parsed *out, size_t *consumed) {
+        size_t start = 0;
+        while (true) {
+            size_t header_end = input.find("\r\n\r\n", start);
+            if (header_end == std::string::npos) {
+                return input.size() - start > kMaxHeaderSize ? -1 : 0;
+            }
+            const char *base = input.data();
+            const char *line = base + start;
+            const char *line_end = base + input.find("\r\n", start);
+            if (line_end - line < 12 || strncmp(line, "HTTP/1.", 7) != 0 ||
+                line[9] < '1' || line[9] > '5' || line[10] < '0' || line[10] > '9' || line[11] < '0' || line[11] > '9') {
+                return -1;
+            }
+            bool http10 = line[7] == '0';
+            int status = (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0');
+            long content_length = -1;
+            bool chunked = false;
+            bool close = false;
+            bool keep_alive = false;
+            out->keep_alive_timeout = 0;
+            out->keep_alive_max = 0;
+            const char *header_stop = base + header_end;
+            for (const char *p = line_end + 2; p < header_stop;) {
+                const char *end = std::search(p, header_stop + 2, "\r\n", "\r\n" + 2);
+                const char *colon = std::find(p, end, ':');
+                if (colon < end) {
+                    const char *value = colon + 1;
+                    while (value < end && (*value == ' ' || *value == '\t')) {
+                        value++;
+                    }
+                    if (StartsWithIgnoreCase(p, colon, "content-length") && colon - p == 14) {
+                        char *stop = NULL;
+                        content_length = strtol(value, &stop, 10);
+                        if (stop == value || content_length < 0) {
+                            return -1;
+                        }
+                    } else if (StartsWithIgnoreCase(p, colon, "transfer-encoding") && colon - p == 17) {
+                        chunked = Lower(value, end).find("chunked") != std::string::npos;
+                    } else if (StartsWithIgnoreCase(p, colon, "connection") && colon - p == 10) {
+                        std::string token = Lower(value, end);
+                        close = token.find("close") != std::string::npos;
+                        keep_alive = token.find("keep-alive") != std::string::npos;
+                    } else if (StartsWithIgnoreCase(p, colon, "keep-alive") && colon - p == 10) {
+                        std::string params = Lower(value, end);
+                        out->keep_alive_timeout = KeepAliveParam(params, "timeout=");
+                        out->keep_alive_max = KeepAliveParam(params, "max=");
+                    }
+                }
+                p = end + 2;
+            }
+            size_t body_start = header_end + 4;
+            if (status / 100 == 1) {
+                // 跳过 100 Continue 等中间响应
+                start = body_start;
+                continue;
+            }
+            out->status = status;
+            out->keep_alive = http10 ? (keep_alive && !close) : !close;
+            out->body.clear();
+            if (status == 204 || status == 304) {
+                *consumed = body_start;
+            } else if (chunked) {
+                size_t pos = body_start;
+                while (true) {
+                    size_t size_end = input.find("\r\n", pos);
+                    if (size_end == std::string::npos) {
+                        return input.size() - pos > kMaxHeaderSize ? -1 : 0;
+                    }
+                    char *stop = NULL;
+                    unsigned long size = strtoul(input.c_str() + pos, &stop, 16);
+                    if (stop == input.c_str() + pos || out->body.size() + size > kMaxBodySize) {
+                        return -1;
+                    }
+                    pos = size_end + 2;
+                    if (size == 0) {
+                        // 跳过 trailer，以空行结束
+                        if (input.compare(pos, 2, "\r\n") == 0) {
+                            *consumed = pos + 2;
+                        } else {
+                            size_t trailer_end = input.find("\r\n\r\n", pos);
+                            if (trailer_end == std::string::npos) {
+                                return 0;
+                            }
+                            *consumed = trailer_end + 4;
+                        }
+                        break;
+                    }
+                    if (input.size() < pos + size + 2) {
+                        return 0;
+                    }
+                    if (input.compare(pos + size, 2, "\r\n") != 0) {
+                        return -1;
+                    }
+                    out->body.append(input, pos, size);
+                    pos += size + 2;
+                }
+            } else if (content_length >= 0) {
+                if ((size_t)content_length > kMaxBodySize) {
+                    return -1;
+                }
+                if (input.size() < body_start + (size_t)content_length) {
+                    return 0;
+                }
+                out->body.assign(input, body_start, (size_t)content_length);
+                *consumed = body_start + (size_t)content_length;
+            } else {
+                // 没有长度信息，读到连接关闭为止
+                if (input.size() - body_start > kMaxBodySize) {
+                    return -1;
+                }
+                if (!eof) {
+                    return 0;
+                }
+                out->body.assign(input, body_start, std::string::npos);
+                out->keep_alive = false;
+                *consumed = input.size();
+            }
+            return 1;
+        }
+    }
+
+    // 本机没有网络或到目标网段的路由时不是服务器的问题，单独返回，由上层决定是否计入服务器失败
+    static MSDKDNS_THttpResult ConnectResult(int error) {
+        return error == ENETUNREACH || error == ENETDOWN ? MSDKDNS_EHttpResult_NetworkDown : MSDKDNS_EHttpResult_ConnectFail;
+    }
+
+    HttpPool::HttpPool(size_t max_connections, size_t max_pipeline)
+        : max_connections_(max_connections > 0 ? max_connections : 1)
+        , max_pipeline_(max_pipeline > 0 ? max_pipeline : 1)
+        , running_(false)
+        , reset_(false)
+        , next_request_id_(0)
+        , next_connection_id_(0) {
+        pthread_mutex_init(&mutex_, NULL);
+        wake_[0] = -1;
+        wake_[1] = -1;
+        memset(&stats_, 0, sizeof(stats_));
+    }
+
+    HttpPool::~HttpPool() {
+        Stop();
+        for (std::map<std::string, Server *>::iterator it = servers_.begin(); it != servers_.end(); ++it) {
+            delete it->second;
+        }
+        pthread_mutex_destroy(&mutex_);
+    }
+
+    bool HttpPool::Start() {
+        pthread_mutex_lock(&mutex_);
+        bool ok = running_;
+        if (!ok && pipe(wake_) == 0) {
+            fcntl(wake_[0], F_SETFL, O_NONBLOCK);
+            fcntl(wake_[1], F_SETFL, O_NONBLOCK);
+            running_ = true;
+            ok = pthread_create(&thread_, NULL, ThreadMain, this) == 0;
+            if (!ok) {
+                running_ = false;
+                close(wake_[0]);
+                close(wake_[1]);
+                wake_[0] = -1;
+                wake_[1] = -1;
+            }
+        }
+        pthread_mutex_unlock(&mutex_);
+        return ok;
+    }
+
+    void HttpPool::Stop() {
+        pthread_mutex_lock(&mutex_);
+        if (!running_) {
+            pthread_mutex_unlock(&mutex_);
+            return;
+        }
+        running_ = false;
+        Wake();
+        pthread_mutex_unlock(&mutex_);
+        pthread_join(thread_, NULL);
+
+        pthread_mutex_lock(&mutex_);
+        int64_t now = msdkdns_monotonic_ms();
+        for (std::map<std::string, Server *>::iterator it = servers_.begin(); it != servers_.end(); ++it) {
+            Server *server = it->second;
+            while (!server->connections.empty()) {
+                Close(server->connections.back(), now, false);
+            }
+            FailServer(server, MSDKDNS_EHttpResult_Cancelled);
+        }
+        close(wake_[0]);
+        close(wake_[1]);
+        wake_[0] = -1;
+        wake_[1] = -1;
+        std::vector<Completion> completions;
+        completions.swap(completions_);
+        pthread_mutex_unlock(&mutex_);
+        Deliver(&completions);
+    }
+
+    void HttpPool::Wake() {
+        if (wake_[1] >= 0) {
+            char c = 0;
+            ssize_t n = write(wake_[1], &c, 1);
+            (void)n;
+        }
+    }
+
+    uint32_t HttpPool::Get(const char *ip, uint16_t port, const std::string &target, int timeout_ms,
+                           msdkdns_http_callback callback, void *context) {
+        struct sockaddr_storage address;
+        memset(&address, 0, sizeof(address));
+        socklen_t address_length = 0;
+        struct sockaddr_in *sin = (struct sockaddr_in *)&address;
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&address;
+        size_t ip_length = ip ? strlen(ip) : 0;
+        if (ip && msdkdns_parse_ipv4(ip, ip_length, (uint8_t *)&sin->sin_addr)) {
+            sin->sin_family = AF_INET;
+            sin->sin_port = htons(port);
+            address_length = sizeof(struct sockaddr_in);
+        } else if (ip && msdkdns_parse_ipv6(ip, ip_length, (uint8_t *)&sin6->sin6_addr)) {
+            sin6->sin6_family = AF_INET6;
+            sin6->sin6_port = htons(port);
+            address_length = sizeof(struct sockaddr_in6);
+        } else {
+            return 0;
+        }
+        char key[INET6_ADDRSTRLEN + 16];
+        snprintf(key, sizeof(key), address.ss_family == AF_INET6 ? "[%s]:%u" : "%s:%u", ip, (unsigned)port);
+
+        pthread_mutex_lock(&mutex_);
+        if (!running_) {
+            pthread_mutex_unlock(&mutex_);
+            return 0;
+        }
+        Server *&server = servers_[key];
+        if (!server) {
+            server = new Server();
+            server->key = key;
+            // 默认端口时 Host 不带端口，与 NSURLSession 一致
+            server->host = key;
+            if (port == 80) {
+                server->host.erase(server->host.rfind(':'));
+            }
+            server->address = address;
+            server->address_length = address_length;
+            server->last_used = 0;
+            server->idle_ms = kDefaultIdleMs - kIdleMarginMs;
+            server->idle_cap_ms = kMaxIdleMs;
+        }
+        Request *request = new Request();
+        request->id = ++next_request_id_ ? next_request_id_ : ++next_request_id_;
+        request->server = server;
+        request->wire = "GET " + target + " HTTP/1.1\r\nHost: " + server->host +
+                        "\r\nConnection: keep-alive\r\nAccept: */*\r\n\r\n";
+        request->deadline = msdkdns_monotonic_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+        request->callback = callback;
+        request->context = context;
+        request->connection = NULL;
+        request->reused = false;
+        request->retries = 0;
+        requests_[request->id] = request;
+        server->queue.push_back(request);
+        stats_.requests++;
+        uint32_t request_id = request->id;
+        Wake();
+        pthread_mutex_unlock(&mutex_);
+        return request_id;
+    }
+
+    void HttpPool::Cancel(uint32_t request_id) {
+        pthread_mutex_lock(&mutex_);
+        std::map<uint32_t, Request *>::iterator it = requests_.find(request_id);
+        if (it != requests_.end()) {
+            Request *request = it->second;
+            Finish(request, MSDKDNS_EHttpResult_Cancelled, 0, std::string());
+            if (!request->connection) {
+                std::deque<Request *> &queue = request->server->queue;
+                queue.erase(std::find(queue.begin(), queue.end(), request));
+                delete request;
+            }
+            Wake();
+        }
+        pthread_mutex_unlock(&mutex_);
+    }
+
+    void HttpPool::Reset() {
+        pthread_mutex_lock(&mutex_);
+        reset_ = true;
+        Wake();
+        pthread_mutex_unlock(&mutex_);
+    }
+
+    void HttpPool::Stats(msdkdns_http_pool_stats *stats, std::vector<msdkdns_http_connection_stats> *connections) const {
+        pthread_mutex_lock(&mutex_);
+        int64_t now = msdkdns_monotonic_ms();
+        if (stats) {
+            *stats = stats_;
+        }
+        if (connections) {
+            connections->clear();
+            for (std::map<std::string, Server *>::const_iterator it = servers_.begin(); it != servers_.end(); ++it) {
+                for (size_t i = 0; i < it->second->connections.size(); i++) {
+                    const Connection *connection = it->second->connections[i];
+                    msdkdns_http_connection_stats item;
+                    item.id = connection->id;
+                    item.server = it->first;
+                    item.requests = connection->completed;
+                    item.reused = connection->reused;
+                    item.pipelined = connection->pipelined;
+                    item.inflight = (uint32_t)connection->inflight.size();
+                    item.age_ms = now - connection->created;
+                    item.idle_ms = connection->inflight.empty() ? now - connection->last_active : 0;
+                    item.expire_ms = connection->expire > now ? connection->expire - now : 0;
+                    connections->push_back(item);
+                }
+            }
+        }
+        pthread_mutex_unlock(&mutex_);
+    }
+
+    // 回调结果并置空回调，不释放请求；仍在连接上的请求等响应到达或连接关闭时再释放
+    void HttpPool::Finish(Request *request, MSDKDNS_THttpResult result, int status, const std::string &body) {
+        if (request->callback) {
+            Completion completion;
+            completion.callback = request->callback;
+            completion.context = request->context;
+            completion.response.result = result;
+            completion.response.status = status;
+            completion.response.body = NULL;
+            completion.response.body_length = 0;
+            completion.response.connection = request->connection ? request->connection->id : 0;
+            completion.response.reused = request->reused;
+            completion.body = body;
+            completions_.push_back(completion);
+            request->callback = NULL;
+            request->context = NULL;
+            requests_.erase(request->id);
+        }
+        if (result == MSDKDNS_EHttpResult_Timeout) {
+            stats_.timeouts++;
+        }
+    }
+
+    void HttpPool::FailServer(Server *server, MSDKDNS_THttpResult result) {
+        while (!server->queue.empty()) {
+            Request *request = server->queue.front();
+            server->queue.pop_front();
+            Finish(request, result, 0, std::string());
+            delete request;
+        }
+    }
+
+    HttpPool::Connection *HttpPool::Open(Server *server, int64_t now) {
+        int fd = socket(server->address.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return NULL;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        stats_.connects++;
+        if (connect(fd, (const struct sockaddr *)&server->address, server->address_length) < 0 && errno != EINPROGRESS) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            stats_.connect_failures++;
+            return NULL;
+        }
+        Connection *connection = new Connection();
+        connection->id = ++next_connection_id_;
+        connection->server = server;
+        connection->fd = fd;
+        connection->connected = false;
+        connection->closing = false;
+        connection->verified = false;
+        connection->output_offset = 0;
+        connection->created = now;
+        connection->last_active = now;
+        connection->expire = now + kConnectTimeoutMs;
+        connection->assigned = 0;
+        connection->completed = 0;
+        connection->reused = 0;
+        connection->pipelined = 0;
+        connection->remaining = 0xFFFFFFFFu;
+        server->connections.push_back(connection);
+        return connection;
+    }
+
+    // 关闭连接，未完成的请求重新排队；keep_warm 时对近期仍有请求的服务器重建一个连接
+    // 连接没有完成过请求且未到空闲到期就被关闭时不重建，避免服务端或中间设备立即关闭新连接时反复建连
+    void HttpPool::Close(Connection *connection, int64_t now, bool keep_warm) {
+        Server *server = connection->server;
+        keep_warm = keep_warm && (connection->completed > 0 || connection->expire <= now);
+        close(connection->fd);
+        for (std::deque<Request *>::reverse_iterator it = connection->inflight.rbegin(); it != connection->inflight.rend(); ++it) {
+            Request *request = *it;
+            if (!request->callback) {
+                delete request;
+            } else if (request->retries < kMaxRetries) {
+                request->retries++;
+                request->connection = NULL;
+                stats_.retried++;
+                server->queue.push_front(request);
+            } else {
+                Finish(request, MSDKDNS_EHttpResult_Broken, 0, std::string());
+                delete request;
+            }
+        }
+        connection->inflight.clear();
+        server->connections.erase(std::find(server->connections.begin(), server->connections.end(), connection));
+        delete connection;
+        if (keep_warm && server->connections.empty() && server->queue.empty() &&
+            now - server->last_used < kWarmMs && server->idle_ms >= kMinWarmIdleMs) {
+            if (Open(server, now)) {
+                stats_.proactive_reconnects++;
+            }
+        }
+    }
+
+    void HttpPool::Maintain(Server *server, int64_t now) {
+        for (std::deque<Request *>::iterator it = server->queue.begin(); it != server->queue.end();) {
+            Request *request = *it;
+            if (request->deadline <= now) {
+                it = server->queue.erase(it);
+                Finish(request, MSDKDNS_EHttpResult_Timeout, 0, std::string());
+                delete request;
+            } else {
+                ++it;
+            }
+        }
+        for (size_t i = 0; i < server->connections.size();) {
+            Connection *connection = server->connections[i];
+            bool expired = false;
+            for (size_t j = 0; j < connection->inflight.size(); j++) {
+                Request *request = connection->inflight[j];
+                if (request->callback && request->deadline <= now) {
+                    Finish(request, MSDKDNS_EHttpResult_Timeout, 0, std::string());
+                    expired = true;
+                }
+            }
+            if (expired) {
+                // 超时的请求之后的响应都会被阻塞，关闭连接，其余请求重新排队
+                Close(connection, now, false);
+                continue;
+            }
+            if (connection->inflight.empty() && (connection->closing || connection->remaining == 0 || connection->expire <= now)) {
+                if (connection->connected && !connection->closing && connection->remaining > 0) {
+                    stats_.idle_closes++;
+                }
+                Close(connection, now, connection->connected);
+                continue;
+            }
+            i++;
+        }
+    }
+
+    // 已取消的请求仍在连接上时，其后的响应要等它返回，如对冲请求取消的慢请求
+    // 新请求不再管线化到这样的连接上；连接数已满时关闭只剩已取消请求的连接，腾出位置新建
+    void HttpPool::Assign(Server *server, int64_t now) {
+        while (!server->queue.empty()) {
+            Connection *best = NULL;
+            Connection *abandoned = NULL;
+            for (size_t i = 0; i < server->connections.size(); i++) {
+                Connection *connection = server->connections[i];
+                size_t depth = connection->verified ? max_pipeline_ : 1;
+                size_t cancelled = 0;
+                for (size_t j = 0; j < connection->inflight.size(); j++) {
+                    cancelled += connection->inflight[j]->callback ? 0 : 1;
+                }
+                if (cancelled > 0 && cancelled == connection->inflight.size()) {
+                    abandoned = connection;
+                }
+                if (connection->closing || connection->remaining == 0 || connection->inflight.size() >= depth ||
+                    cancelled > 0) {
+                    continue;
+                }
+                if (!best || connection->inflight.size() < best->inflight.size()) {
+                    best = connection;
+                }
+            }
+            if (!best) {
+                if (server->connections.size() >= max_connections_ && abandoned) {
+                    Close(abandoned, now, false);
+                }
+                if (server->connections.size() >= max_connections_) {
+                    return;
+                }
+                best = Open(server, now);
+                if (!best) {
+                    FailServer(server, ConnectResult(errno));
+                    return;
+                }
+            }
+            Request *request = server->queue.front();
+            server->queue.pop_front();
+            request->connection = best;
+            // 连接已建立时请求不需要等待握手
+            request->reused = best->connected;
+            if (request->reused) {
+                best->reused++;
+                stats_.reused++;
+            }
+            if (!best->inflight.empty()) {
+                best->pipelined++;
+                stats_.pipelined++;
+            }
+            best->assigned++;
+            best->remaining--;
+            best->output.append(request->wire);
+            best->inflight.push_back(request);
+            server->last_used = now;
+        }
+    }
+
+    bool HttpPool::HandleConnect(Connection *connection, int64_t now) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(connection->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            // 服务器不可达，排队中的请求一并失败，由上层切换服务器
+            Server *server = connection->server;
+            MSDKDNS_THttpResult result = ConnectResult(error);
+            stats_.connect_failures++;
+            for (size_t i = 0; i < connection->inflight.size(); i++) {
+                Finish(connection->inflight[i], result, 0, std::string());
+            }
+            Close(connection, now, false);
+            FailServer(server, result);
+            return false;
+        }
+        connection->connected = true;
+        connection->last_active = now;
+        connection->expire = now + connection->server->idle_ms;
+        return true;
+    }
+
+    bool HttpPool::HandleWrite(Connection *connection, int64_t now) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        while (connection->output_offset < connection->output.size()) {
+            ssize_t n = send(connection->fd, connection->output.data() + connection->output_offset,
+                             connection->output.size() - connection->output_offset, flags);
+            if (n < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    Close(connection, now, false);
+                    return false;
+                }
+                return true;
+            }
+            connection->output_offset += (size_t)n;
+        }
+        connection->output.clear();
+        connection->output_offset = 0;
+        return true;
+    }
+
+    void HttpPool::HandleRead(Connection *connection, int64_t now) {
+        bool eof = false;
+        char buffer[4096];
+        while (true) {
+            ssize_t n = recv(connection->fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                connection->input.append(buffer, (size_t)n);
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                eof = true;
+            }
+            break;
+        }
+        Server *server = connection->server;
+        while (!connection->inflight.empty()) {
+            msdkdns_http_parsed parsed;
+            size_t consumed = 0;
+            int ret = ParseResponse(connection->input, eof, &parsed, &consumed);
+            if (ret == 0) {
+                break;
+            }
+            Request *request = connection->inflight.front();
+            connection->inflight.pop_front();
+            if (ret < 0) {
+                Finish(request, MSDKDNS_EHttpResult_BadResponse, 0, std::string());
+                delete request;
+                Close(connection, now, false);
+                return;
+            }
+            connection->input.erase(0, consumed);
+            connection->completed++;
+            connection->last_active = now;
+            connection->verified = parsed.keep_alive;
+            connection->closing = !parsed.keep_alive;
+            if (parsed.keep_alive_timeout > 0) {
+                server->idle_ms = std::max(kMinIdleMs, std::min(server->idle_cap_ms, parsed.keep_alive_timeout * 1000 - kIdleMarginMs));
+            }
+            if (parsed.keep_alive_max > 0) {
+                uint32_t queued = (uint32_t)connection->inflight.size();
+                connection->remaining = (uint32_t)parsed.keep_alive_max > queued ? (uint32_t)parsed.keep_alive_max - queued : 0;
+            }
+            connection->expire = now + server->idle_ms;
+            Finish(request, MSDKDNS_EHttpResult_Ok, parsed.status, parsed.body);
+            delete request;
+            if (connection->closing) {
+                // 服务端不再处理后续的管线请求，关闭后重新排队
+                Close(connection, now, true);
+                return;
+            }
+        }
+        if (eof) {
+            if (connection->inflight.empty() && connection->completed > 0) {
+                // 服务端先于预期关闭了空闲连接，按实际空闲时间缩短后续连接的保持时间
+                server->idle_cap_ms = std::max(kMinIdleMs, std::min(server->idle_cap_ms, now - connection->last_active - kIdleMarginMs));
+                server->idle_ms = std::min(server->idle_ms, server->idle_cap_ms);
+            }
+            Close(connection, now, connection->inflight.empty());
+        } else if (connection->inflight.empty() && !connection->input.empty()) {
+            Close(connection, now, false);
+        }
+    }
+
+    void HttpPool::Deliver(std::vector<Completion> *completions) {
+        for (size_t i = 0; i < completions->size(); i++) {
+            Completion &completion = (*completions)[i];
+            completion.response.body = completion.body.data();
+            completion.response.body_length = completion.body.size();
+            completion.callback(completion.context, &completion.response);
+        }
+        completions->clear();
+    }
+
+    void *HttpPool::ThreadMain(void *arg) {
+        static_cast<HttpPool *>(arg)->Run();
+        return NULL;
+    }
+
+    void HttpPool::Run() {
+        std::vector<struct pollfd> fds;
+        std::vector<Connection *> owners;
+        std::vector<Completion> completions;
+        pthread_mutex_lock(&mutex_);
+        while (running_) {
+            int64_t now = msdkdns_monotonic_ms();
+            if (reset_) {
+                reset_ = false;
+                for (std::map<std::string, Server *>::iterator it = servers_.begin(); it != servers_.end(); ++it) {
+                    while (!it->second->connections.empty()) {
+                        Close(it->second->connections.back(), now, false);
+                    }
+                }
+            }
+            int64_t next = now + kMaxPollMs;
+            fds.clear();
+            owners.clear();
+            struct pollfd wake = { wake_[0], POLLIN, 0 };
+            fds.push_back(wake);
+            owners.push_back(NULL);
+            for (std::map<std::string, Server *>::iterator it = servers_.begin(); it != servers_.end(); ++it) {
+                Server *server = it->second;
+                Maintain(server, now);
+                Assign(server, now);
+                for (size_t i = 0; i < server->queue.size(); i++) {
+                    next = std::min(next, server->queue[i]->deadline);
+                }
+                for (size_t i = 0; i < server->connections.size(); i++) {
+                    Connection *connection = server->connections[i];
+                    short events = POLLIN;
+                    if (!connection->connected || !connection->output.empty()) {
+                        events = connection->connected ? (short)(POLLIN | POLLOUT) : (short)POLLOUT;
+                    }
+                    struct pollfd pfd = { connection->fd, events, 0 };
+                    fds.push_back(pfd);
+                    owners.push_back(connection);
+                    if (connection->inflight.empty()) {
+                        next = std::min(next, connection->expire);
+                    }
+                    for (size_t j = 0; j < connection->inflight.size(); j++) {
+                        if (connection->inflight[j]->callback) {
+                            next = std::min(next, connection->inflight[j]->deadline);
+                        }
+                    }
+                }
+            }
+            completions.swap(completions_);
+            pthread_mutex_unlock(&mutex_);
+            Deliver(&completions);
+
+            int wait = (int)std::max((int64_t)0, next - msdkdns_monotonic_ms());
+            int ready = poll(&fds[0], (nfds_t)fds.size(), wait);
+
+            pthread_mutex_lock(&mutex_);
+            if (ready <= 0) {
+                continue;
+            }
+            now = msdkdns_monotonic_ms();
+            if (fds[0].revents) {
+                char drain[64];
+                while (read(wake_[0], drain, sizeof(drain)) > 0) {
+                }
+            }
+            for (size_t i = 1; i < fds.size() && !reset_; i++) {
+                Connection *connection = owners[i];
+                short revents = fds[i].revents;
+                if (revents == 0) {
+                    continue;
+                }
+                // 处理失败时 connection 已释放
+                if (!connection->connected && !HandleConnect(connection, now)) {
+                    continue;
+                }
+                if (!connection->output.empty() && !HandleWrite(connection, now)) {
+                    continue;
+                }
+                if (revents & (POLLIN | POLLERR | POLLHUP)) {
+                    HandleRead(connection, now);
+                }
+            }
+        }
+        pthread_mutex_unlock(&mutex_);
+    }
+}  // namespace msdkdns
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_HTTP_POOL_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_HTTP_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    enum MSDKDNS_THttpResult {
+        MSDKDNS_EHttpResult_Ok = 0,           // 收到完整响应，status 为 HTTP 状态码
+        MSDKDNS_EHttpResult_Timeout = 1,
+        MSDKDNS_EHttpResult_ConnectFail = 2,
+        MSDKDNS_EHttpResult_Broken = 3,       // 连接中断且重试后仍失败
+        MSDKDNS_EHttpResult_Cancelled = 4,
+        MSDKDNS_EHttpResult_NetworkDown = 5,  // 本机没有可用的网络或路由，与服务器无关
+        MSDKDNS_EHttpResult_BadResponse = 6,  // 响应格式错误
+    };
+
+    typedef struct msdkdns_http_response {
+        MSDKDNS_THttpResult result;
+        int status;
+        const char *body;  // 仅在回调期间有效
+        size_t body_length;
+        uint32_t connection;  // 0 表示未分配到连接
+        bool reused;          // 发出时连接已建立，省去了建连
+    } msdkdns_http_response;
+
+    // 回调在连接池线程上执行，不能阻塞，也不能在回调中调用 Stop
+    typedef void (*msdkdns_http_callback)(void *context, const msdkdns_http_response *response);
+
+    typedef struct msdkdns_http_connection_stats {
+        uint32_t id;
+        std::string server;  // ip:port
+        uint32_t requests;   // 已完成的请求数
+        uint32_t reused;
+        uint32_t pipelined;  // 发出时连接上仍有未完成请求的请求数
+        uint32_t inflight;
+        int64_t age_ms;
+        int64_t idle_ms;
+        int64_t expire_ms;   // 距离主动关闭的时间
+    } msdkdns_http_connection_stats;
+
+    typedef struct msdkdns_http_pool_stats {
+        uint32_t requests;
+        uint32_t connects;
+        uint32_t connect_failures;
+        uint32_t reused;
+        uint32_t pipelined;
+        uint32_t retried;     // 连接被服务端关闭等原因重新发出的请求数
+        uint32_t timeouts;
+        uint32_t idle_closes;
+        uint32_t proactive_reconnects;
+    } msdkdns_http_pool_stats;
+
+    /*
+     * HTTP/1.1 长连接池，用于 HTTPDNS 的 /d 查询
+     * 每个服务器最多 max_connections 个连接，连接完成一次 keep-alive 响应后最多同时管线化 max_pipeline 个请求
+     * 按服务端 Keep-Alive: timeout 在空闲到期前主动关闭连接，近期仍有请求的服务器立即重建一个连接保持预热
+     * 服务端先于声明的超时关闭空闲连接时，按实际空闲时间缩短之后的保持时间
+     * 连接在响应前被关闭时请求重新排队发出一次（GET 请求可安全重发）
+     * 内部使用一个后台线程，接口可多线程调用
+     */
+    class HttpPool {
+    public:
+        HttpPool(size_t max_connections, size_t max_pipeline);
+        ~HttpPool();
+
+        bool Start();
+        // 结束后台线程，未完成的请求以 Cancelled 回调
+        void Stop();
+
+        // target 为 path 及 query，返回请求ID；返回0表示未启动或地址不合法，此时不会回调
+        uint32_t Get(const char *ip, uint16_t port, const std::string &target, int timeout_ms,
+                     msdkdns_http_callback callback, void *context);
+        // 请求尚未回调时以 Cancelled 回调，已发出的请求其响应到达后丢弃
+        void Cancel(uint32_t request_id);
+        // 关闭所有连接，在途请求重新排队，用于网络切换
+        void Reset();
+
+        void Stats(msdkdns_http_pool_stats *stats, std::vector<msdkdns_http_connection_stats> *connections) const;
+
+    private:
+        struct Request;
+        struct Connection;
+        struct Server;
+        struct Completion {
+            msdkdns_http_callback callback;
+            void *context;
+            msdkdns_http_response response;
+            std::string body;
+        };
+
+        static void *ThreadMain(void *arg);
+        void Run();
+        void Wake();
+        void Finish(Request *request, MSDKDNS_THttpResult result, int status, const std::string &body);
+        void FailServer(Server *server, MSDKDNS_THttpResult result);
+        Connection *Open(Server *server, int64_t now);
+        void Close(Connection *connection, int64_t now, bool keep_warm);
+        void Maintain(Server *server, int64_t now);
+        void Assign(Server *server, int64_t now);
+        bool HandleConnect(Connection *connection, int64_t now);
+        bool HandleWrite(Connection *connection, int64_t now);
+        void HandleRead(Connection *connection, int64_t now);
+        void Deliver(std::vector<Completion> *completions);
+
+        size_t max_connections_;
+        size_t max_pipeline_;
+        mutable pthread_mutex_t mutex_;
+        pthread_t thread_;
+        bool running_;
+        bool reset_;
+        int wake_[2];
+        uint32_t next_request_id_;
+        uint32_t next_connection_id_;
+        std::map<std::string, Server *> servers_;
+        std::map<uint32_t, Request *> requests_;
+        std::vector<Completion> completions_;
+        msdkdns_http_pool_stats stats_;
+
+        HttpPool(const HttpPool &);
+        HttpPool &operator=(const HttpPool &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_HTTP_POOL_H_
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_latency_tracker.h"
+#include <algorithm>
+
+namespace msdkdns {
+
+    // 样本数达到该值后才使用分位数
+    static const size_t kMinSamples = 8;
+    // 对冲延迟取 p95，限制在 [kMinHedgeDelayMs, 总超时 * kMaxHedgeRatio]
+    static const double kHedgeQuantile = 0.95;
+    static const double kMinHedgeDelayMs = 30;
+    static const double kMaxHedgeRatio = 0.5;
+    // 无历史时对冲延迟取总超时的该比例
+    static const double kDefaultHedgeRatio = 0.25;
+    // 单次超时取 p95 的倍数，且不低于 kMinAttemptTimeoutMs
+    static const double kAttemptTimeoutFactor = 4;
+    static const double kMinAttemptTimeoutMs = 500;
+
+    LatencyTracker::LatencyTracker(size_t window)
+        : window_(window > 0 ? window : 1) {
+    }
+
+    void LatencyTracker::Record(const std::string &server, double latency_ms) {
+        if (latency_ms < 0) {
+            latency_ms = 0;
+        }
+        Window &w = windows_[server];
+        if (w.samples.size() < window_) {
+            w.samples.push_back(latency_ms);
+            w.next = w.samples.size() % window_;
+            return;
+        }
+        w.samples[w.next] = latency_ms;
+        w.next = (w.next + 1) % window_;
+    }
+
+    void LatencyTracker::RecordTimeout(const std::string &server, double timeout_ms) {
+        Record(server, timeout_ms);
+    }
+
+    bool LatencyTracker::Quantile(const std::string &server, double q, double *latency_ms) const {
+        std::map<std::string, Window>::const_iterator it = windows_.find(server);
+        if (it == windows_.end() || it->second.samples.size() < kMinSamples) {
+            return false;
+        }
+        std::vector<double> sorted(it->second.samples);
+        size_t rank = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+        if (rank >= sorted.size()) {
+            rank = sorted.size() - 1;
+        }
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        *latency_ms = sorted[rank];
+        return true;
+    }
+
+    size_t LatencyTracker::Samples(const std::string &server) const {
+        std::map<std::string, Window>::const_iterator it = windows_.find(server);
+        return it == windows_.end() ? 0 : it->second.samples.size();
+    }
+
+    void LatencyTracker::Clear() {
+        windows_.clear();
+    }
+
+    double LatencyTracker::HedgeDelayMs(const std::string &server, double timeout_ms) const {
+        double delay = timeout_ms * kDefaultHedgeRatio;
+        double p95 = 0;
+        if (Quantile(server, kHedgeQuantile, &p95)) {
+            delay = p95;
+        }
+        delay = std::min(delay, timeout_ms * kMaxHedgeRatio);
+        return std::max(delay, kMinHedgeDelayMs);
+    }
+
+    double LatencyTracker::AttemptTimeoutMs(const std::string &server, double timeout_ms) const {
+        double p95 = 0;
+        if (!Quantile(server, kHedgeQuantile, &p95)) {
+            return timeout_ms;
+        }
+        double timeout = std::max(p95 * kAttemptTimeoutFactor, kMinAttemptTimeoutMs);
+        return std::min(timeout, timeout_ms);
+    }
+}  // namespace msdkdns
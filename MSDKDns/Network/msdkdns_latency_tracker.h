@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_LATENCY_TRACKER_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_LATENCY_TRACKER_H_
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    /*
+     * 按解析服务IP记录最近 window 次请求耗时，用于计算对冲请求的延迟和单次请求的超时
+     * 超时按超时时间计入样本，分位数偏保守；样本不足时使用按总超时推算的默认值
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class LatencyTracker {
+    public:
+        explicit LatencyTracker(size_t window);
+
+        void Record(const std::string &server, double latency_ms);
+        void RecordTimeout(const std::string &server, double timeout_ms);
+        // 样本数不足时返回 false
+        bool Quantile(const std::string &server, double q, double *latency_ms) const;
+        size_t Samples(const std::string &server) const;
+        void Clear();
+
+        // 首个请求发出后等待该时间仍无结果时，向下一个服务IP发出对冲请求
+        double HedgeDelayMs(const std::string &server, double timeout_ms) const;
+        // 单次请求的超时，不超过总超时
+        double AttemptTimeoutMs(const std::string &server, double timeout_ms) const;
+
+    private:
+        struct Window {
+            Window() : next(0) {}
+
+            std::vector<double> samples;
+            size_t next;
+        };
+
+        size_t window_;
+        std::map<std::string, Window> windows_;
+
+        LatencyTracker(const LatencyTracker &);
+        LatencyTracker &operator=(const LatencyTracker &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_LATENCY_TRACKER_H_
@@ -16,7 +16,15 @@
 #include <errno.h>
 #include <endian.h>
 #include <unistd.h>
+#include <time.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#if defined(__OBJC__)
 #include "../MSDKDnsLog.h"
+#else
+// 在 Linux 上构建测试时不输出日志
+#define MSDKDNSLOG(...) ((void)0)
+#endif
 
 /*
  * Connect a UDP socket to a given unicast address. This will cause no network
@@ -59,7 +67,7 @@ static int msdkdns_test_connect(int pf, struct sockaddr * addr, size_t addrlen)
  * so checking for connectivity is the next best thing.
  */
 static int msdkdns_have_ipv6() {
-    static struct sockaddr_in6 sin6_test = {0};
+    static struct sockaddr_in6 sin6_test;
     sin6_test.sin6_family = AF_INET6;
     sin6_test.sin6_port = 80;
     sin6_test.sin6_flowinfo = 0;
@@ -72,7 +80,7 @@ static int msdkdns_have_ipv6() {
 }
 
 static int msdkdns_have_ipv4() {
-    static struct sockaddr_in sin_test = {0};
+    static struct sockaddr_in sin_test;
     sin_test.sin_family = AF_INET;
     sin_test.sin_port = 80;
     sin_test.sin_addr.s_addr = htonl(0x08080808L);  // 8.8.8.8
@@ -95,3 +103,85 @@ msdkdns::MSDKDNS_TLocalIPStack msdkdns::msdkdns_detect_local_ip_stack() {
     MSDKDNSLOG(@"have_ipv4:%d have_ipv6:%d", have_ipv4, have_ipv6);
     return (msdkdns::MSDKDNS_TLocalIPStack) local_stack;
 }
+
+static bool msdkdns_is_global_ipv4(const struct sockaddr_in *sin) {
+    uint32_t addr = ntohl(sin->sin_addr.s_addr);
+    // 排除 0.0.0.0/8、127.0.0.0/8 和 169.254.0.0/16
+    return (addr >> 24) != 0 && (addr >> 24) != 127 && (addr >> 16) != 0xA9FE;
+}
+
+static bool msdkdns_is_global_ipv6(const struct sockaddr_in6 *sin6) {
+    const struct in6_addr *addr = &sin6->sin6_addr;
+    // 仅 2000::/3 的全局单播地址才能访问公网，链路本地、ULA、回环等均不计入
+    return (addr->s6_addr[0] & 0xE0) == 0x20;
+}
+
+msdkdns::MSDKDNS_TLocalIPStack msdkdns::msdkdns_detect_local_ip_stack_ifaddrs() {
+    struct ifaddrs *ifaddr = NULL;
+    if (getifaddrs(&ifaddr) != 0) {
+        MSDKDNSLOG(@"getifaddrs error. errno = %d", errno);
+        return msdkdns::MSDKDNS_ELocalIPStack_None;
+    }
+    int local_stack = 0;
+    for (struct ifaddrs *ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || (ifa->ifa_flags & IFF_LOOPBACK) ||
+            !(ifa->ifa_flags & IFF_UP) || !(ifa->ifa_flags & IFF_RUNNING)) {
+            continue;
+        }
+        if (ifa->ifa_addr->sa_family == AF_INET &&
+            msdkdns_is_global_ipv4(reinterpret_cast<struct sockaddr_in *>(ifa->ifa_addr))) {
+            local_stack |= msdkdns::MSDKDNS_ELocalIPStack_IPv4;
+        } else if (ifa->ifa_addr->sa_family == AF_INET6 &&
+                   msdkdns_is_global_ipv6(reinterpret_cast<struct sockaddr_in6 *>(ifa->ifa_addr))) {
+            local_stack |= msdkdns::MSDKDNS_ELocalIPStack_IPv6;
+        }
+    }
+    freeifaddrs(ifaddr);
+    MSDKDNSLOG(@"ifaddrs local stack:%d", local_stack);
+    return (msdkdns::MSDKDNS_TLocalIPStack) local_stack;
+}
+
+// 兜底过期时间，单位ms
+static const int64_t kLocalIPStackMaxAgeMs = 60 * 1000;
+// 高位为探测时间（单调时钟ms），低8位为 stack + 1，0 表示无缓存
+static int64_t g_local_ip_stack_state = 0;
+static int64_t g_local_ip_stack_generation = 0;
+static int g_local_ip_stack_detector = msdkdns::MSDKDNS_ELocalIPStackDetector_Connect;
+
+static int64_t msdkdns_local_ip_stack_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+msdkdns::MSDKDNS_TLocalIPStack msdkdns::msdkdns_cached_local_ip_stack() {
+    int64_t now_ms = msdkdns_local_ip_stack_now_ms();
+    int64_t state = __atomic_load_n(&g_local_ip_stack_state, __ATOMIC_ACQUIRE);
+    if (state != 0 && now_ms - (state >> 8) < kLocalIPStackMaxAgeMs) {
+        return (msdkdns::MSDKDNS_TLocalIPStack) ((state & 0xFF) - 1);
+    }
+    int64_t generation = __atomic_load_n(&g_local_ip_stack_generation, __ATOMIC_ACQUIRE);
+    msdkdns::MSDKDNS_TLocalIPStack stack;
+    if (__atomic_load_n(&g_local_ip_stack_detector, __ATOMIC_RELAXED) == msdkdns::MSDKDNS_ELocalIPStackDetector_Ifaddrs) {
+        stack = msdkdns::msdkdns_detect_local_ip_stack_ifaddrs();
+    } else {
+        stack = msdkdns::msdkdns_detect_local_ip_stack();
+    }
+    // 已被其他线程更新时不覆盖；探测期间发生过失效时清除，下次调用重新探测
+    int64_t detected = (now_ms << 8) | (static_cast<int64_t>(stack) + 1);
+    __atomic_compare_exchange_n(&g_local_ip_stack_state, &state, detected, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&g_local_ip_stack_generation, __ATOMIC_ACQUIRE) != generation) {
+        __atomic_store_n(&g_local_ip_stack_state, 0, __ATOMIC_RELEASE);
+    }
+    return stack;
+}
+
+void msdkdns::msdkdns_invalidate_local_ip_stack() {
+    __atomic_add_fetch(&g_local_ip_stack_generation, 1, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&g_local_ip_stack_state, 0, __ATOMIC_RELEASE);
+}
+
+void msdkdns::msdkdns_set_local_ip_stack_detector(msdkdns::MSDKDNS_TLocalIPStackDetector detector) {
+    __atomic_store_n(&g_local_ip_stack_detector, static_cast<int>(detector), __ATOMIC_RELAXED);
+    msdkdns::msdkdns_invalidate_local_ip_stack();
+}
@@ -43,7 +43,26 @@ namespace msdkdns {
             "MSDKDNS_ELocalIPStack_Dual",
     };
 
+    // 探测方式：UDP connect 判断是否有对应协议栈的路由，或 getifaddrs 判断网卡上是否配置了对应协议栈的地址
+    enum MSDKDNS_TLocalIPStackDetector {
+        MSDKDNS_ELocalIPStackDetector_Connect = 0,
+        MSDKDNS_ELocalIPStackDetector_Ifaddrs = 1,
+    };
+
     MSDKDNS_TLocalIPStack msdkdns_detect_local_ip_stack();
+    // 不创建socket，只检查处于 UP/RUNNING 状态的非回环网卡上的全局单播地址
+    MSDKDNS_TLocalIPStack msdkdns_detect_local_ip_stack_ifaddrs();
+
+    /*
+     * 带缓存的探测，解析热路径使用
+     * 结果缓存到网络变化时调用 msdkdns_invalidate_local_ip_stack 为止，
+     * 另有较长的兜底过期时间，防止遗漏的网络变化（如后台期间）一直沿用旧结果
+     * 可在任意线程调用
+     */
+    MSDKDNS_TLocalIPStack msdkdns_cached_local_ip_stack();
+    // 网络或路由变化时调用，由平台的网络监听（如 Reachability）驱动
+    void msdkdns_invalidate_local_ip_stack();
+    void msdkdns_set_local_ip_stack_detector(MSDKDNS_TLocalIPStackDetector detector);
 }  // namespace msdkdns
 
 #ifdef __cplusplus
@@ -0,0 +1,229 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_rtt_store.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+namespace msdkdns {
+
+    // 失败按该RTT计入代价，与一次建连超时的量级相当
+    static const double kFailurePenaltyMs = 3000;
+    // 失败率超过该值视为不健康，排在无历史的IP之后
+    static const double kUnhealthyFailRate = 0.5;
+    // 偏差超过 srtt 的该比例时认为抖动较大，需要重新测速
+    static const double kHighVarianceRatio = 0.5;
+    // 同一IP两次发起测速的最小间隔，单位ms
+    static const int64_t kMinProbeIntervalMs = 60 * 1000;
+
+    namespace {
+        struct RankItem {
+            int tier;  // 0 健康，1 无历史，2 不健康
+            double cost;
+            size_t index;
+
+            bool operator<(const RankItem &other) const {
+                if (tier != other.tier) {
+                    return tier < other.tier;
+                }
+                if (cost != other.cost) {
+                    return cost < other.cost;
+                }
+                return index < other.index;
+            }
+        };
+    }
+
+    RttStore::RttStore(size_t capacity, int64_t stale_ms)
+        : capacity_(capacity > 0 ? capacity : 1), stale_ms_(stale_ms) {
+    }
+
+    std::string RttStore::Key(const std::string &ip, uint16_t port) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "|%u", static_cast<unsigned>(port));
+        return ip + buf;
+    }
+
+    void RttStore::EvictOldest() {
+        // 淘汰最久未更新的记录，容量较小，线性查找即可
+        std::map<std::string, msdkdns_rtt_stats>::iterator oldest = entries_.begin();
+        for (std::map<std::string, msdkdns_rtt_stats>::iterator cur = entries_.begin(); cur != entries_.end(); ++cur) {
+            if (cur->second.updated_ms < oldest->second.updated_ms) {
+                oldest = cur;
+            }
+        }
+        dirty_.erase(oldest->first);
+        evicted_.insert(oldest->first);
+        entries_.erase(oldest);
+    }
+
+    std::map<std::string, msdkdns_rtt_stats>::iterator RttStore::Insert(const std::string &key,
+                                                                       const msdkdns_rtt_stats &stats) {
+        if (entries_.size() >= capacity_) {
+            EvictOldest();
+        }
+        evicted_.erase(key);
+        return entries_.insert(std::make_pair(key, stats)).first;
+    }
+
+    msdkdns_rtt_stats *RttStore::Touch(const std::string &key, int64_t now_ms) {
+        std::map<std::string, msdkdns_rtt_stats>::iterator it = entries_.find(key);
+        if (it == entries_.end()) {
+            msdkdns_rtt_stats stats = {0, 0, 0, 0, now_ms, 0};
+            it = Insert(key, stats);
+        }
+        it->second.updated_ms = now_ms;
+        dirty_.insert(key);
+        return &it->second;
+    }
+
+    void RttStore::RecordSuccess(const std::string &key, double rtt_ms, int64_t now_ms) {
+        if (rtt_ms < 0) {
+            return;
+        }
+        msdkdns_rtt_stats *stats = Touch(key, now_ms);
+        if (stats->srtt_ms <= 0) {
+            stats->srtt_ms = rtt_ms;
+            stats->rttvar_ms = rtt_ms / 2;
+        } else {
+            stats->rttvar_ms = 0.75 * stats->rttvar_ms + 0.25 * fabs(stats->srtt_ms - rtt_ms);
+            stats->srtt_ms = 0.875 * stats->srtt_ms + 0.125 * rtt_ms;
+        }
+        stats->fail_rate = 0.75 * stats->fail_rate;
+        stats->samples++;
+    }
+
+    void RttStore::RecordFailure(const std::string &key, int64_t now_ms) {
+        msdkdns_rtt_stats *stats = Touch(key, now_ms);
+        stats->fail_rate = 0.75 * stats->fail_rate + 0.25;
+        stats->samples++;
+    }
+
+    void RttStore::MarkProbed(const std::vector<std::string> &keys, int64_t now_ms) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            std::map<std::string, msdkdns_rtt_stats>::iterator it = entries_.find(keys[i]);
+            if (it == entries_.end()) {
+                msdkdns_rtt_stats stats = {0, 0, 0, 0, now_ms, 0};
+                it = Insert(keys[i], stats);
+            }
+            it->second.probed_ms = now_ms;
+        }
+    }
+
+    bool RttStore::Restore(const std::string &key, const msdkdns_rtt_stats &stats) {
+        std::map<std::string, msdkdns_rtt_stats>::iterator it = entries_.find(key);
+        if (it != entries_.end()) {
+            // 加载完成前已有测速结果的记录更新，只记录了测速时间的记录以持久化数据为准
+            if (it->second.samples == 0 || it->second.updated_ms < stats.updated_ms) {
+                int64_t probed_ms = it->second.probed_ms;
+                it->second = stats;
+                it->second.probed_ms = probed_ms;
+            }
+            return true;
+        }
+        if (entries_.size() >= capacity_) {
+            std::map<std::string, msdkdns_rtt_stats>::const_iterator oldest = entries_.begin();
+            for (std::map<std::string, msdkdns_rtt_stats>::const_iterator cur = entries_.begin(); cur != entries_.end();
+                 ++cur) {
+                if (cur->second.updated_ms < oldest->second.updated_ms) {
+                    oldest = cur;
+                }
+            }
+            if (stats.updated_ms <= oldest->second.updated_ms) {
+                evicted_.insert(key);
+                return false;
+            }
+        }
+        msdkdns_rtt_stats restored = stats;
+        restored.probed_ms = 0;
+        Insert(key, restored);
+        return true;
+    }
+
+    bool RttStore::Lookup(const std::string &key, msdkdns_rtt_stats *stats) const {
+        std::map<std::string, msdkdns_rtt_stats>::const_iterator it = entries_.find(key);
+        if (it == entries_.end()) {
+            return false;
+        }
+        if (stats) {
+            *stats = it->second;
+        }
+        return true;
+    }
+
+    double RttStore::Cost(const msdkdns_rtt_stats &stats) const {
+        double rtt = stats.srtt_ms > 0 ? stats.srtt_ms + 4 * stats.rttvar_ms : kFailurePenaltyMs;
+        return rtt + stats.fail_rate * kFailurePenaltyMs;
+    }
+
+    bool RttStore::NeedsProbe(const msdkdns_rtt_stats &stats, int64_t now_ms) const {
+        if (stats.probed_ms > 0 && now_ms >= stats.probed_ms && now_ms - stats.probed_ms < kMinProbeIntervalMs) {
+            return false;
+        }
+        // 测速被取消、没有结果的IP
+        if (stats.samples == 0) {
+            return true;
+        }
+        if (now_ms - stats.updated_ms > stale_ms_ || now_ms < stats.updated_ms) {
+            return true;
+        }
+        // 只有失败记录时按失败率排序即可，不必反复测速
+        if (stats.srtt_ms <= 0) {
+            return false;
+        }
+        return stats.rttvar_ms > kHighVarianceRatio * stats.srtt_ms;
+    }
+
+    bool RttStore::Rank(const std::vector<std::string> &keys, int64_t now_ms, std::vector<size_t> *order) const {
+        bool needs_probe = false;
+        std::vector<RankItem> items;
+        items.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            RankItem item = {1, 0, i};
+            std::map<std::string, msdkdns_rtt_stats>::const_iterator it = entries_.find(keys[i]);
+            if (it == entries_.end()) {
+                needs_probe = true;
+            } else {
+                // 没有样本的IP与无记录相同；从未连通过的IP视为不健康
+                if (it->second.samples > 0) {
+                    bool unhealthy = it->second.srtt_ms <= 0 || it->second.fail_rate > kUnhealthyFailRate;
+                    item.tier = unhealthy ? 2 : 0;
+                    item.cost = Cost(it->second);
+                }
+                needs_probe = needs_probe || NeedsProbe(it->second, now_ms);
+            }
+            items.push_back(item);
+        }
+        std::sort(items.begin(), items.end());
+        if (order) {
+            order->clear();
+            order->reserve(items.size());
+            for (size_t i = 0; i < items.size(); i++) {
+                order->push_back(items[i].index);
+            }
+        }
+        return needs_probe;
+    }
+
+    void RttStore::TakeDirty(std::vector<std::pair<std::string, msdkdns_rtt_stats> > *dirty) {
+        dirty->clear();
+        for (std::set<std::string>::const_iterator it = dirty_.begin(); it != dirty_.end(); ++it) {
+            std::map<std::string, msdkdns_rtt_stats>::const_iterator entry = entries_.find(*it);
+            if (entry != entries_.end()) {
+                dirty->push_back(*entry);
+            }
+        }
+        dirty_.clear();
+    }
+
+    void RttStore::TakeEvicted(std::vector<std::string> *evicted) {
+        evicted->assign(evicted_.begin(), evicted_.end());
+        evicted_.clear();
+    }
+
+    size_t RttStore::Size() const {
+        return entries_.size();
+    }
+}  // namespace msdkdns
@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_RTT_STORE_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_RTT_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    typedef struct msdkdns_rtt_stats {
+        double srtt_ms;     // 平滑RTT
+        double rttvar_ms;   // RTT平均偏差
+        double fail_rate;   // 平滑失败率，0~1
+        uint32_t samples;   // 累计样本数（含失败）
+        int64_t updated_ms; // 最后更新时间，墙上时钟，用于持久化后判断是否过期
+        int64_t probed_ms;  // 最后一次发起测速的时间，不持久化，0 表示本次运行未测速
+    } msdkdns_rtt_stats;
+
+    /*
+     * 按 "ip|port" 记录的RTT历史
+     * RTT按 TCP RTO 的方式做 EWMA（srtt 1/8，rttvar 1/4），失败率按 1/4 做 EWMA
+     * 排序时以 srtt + 4 * rttvar + 失败率惩罚 作为代价，无历史的IP排在健康IP之后、
+     * 不健康（失败率高或从未连通）的IP之前
+     * 发起测速时记录测速时间，因连通数已够被取消、没有结果的IP在1分钟内不再触发测速
+     * 超出容量时淘汰最久未更新的记录，被淘汰的 key 由 TakeEvicted 取出，用于删除持久化数据
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class RttStore {
+    public:
+        RttStore(size_t capacity, int64_t stale_ms);
+
+        void RecordSuccess(const std::string &key, double rtt_ms, int64_t now_ms);
+        void RecordFailure(const std::string &key, int64_t now_ms);
+        // 对 keys 发起了测速，没有记录的 key 以未知RTT加入，不标记为待写回
+        void MarkProbed(const std::vector<std::string> &keys, int64_t now_ms);
+        // 从持久化数据恢复，不标记为待写回；已有更新的记录时保留已有记录
+        // 已满时淘汰最久未更新的记录，记录本身最旧时不恢复并计入淘汰，返回 false
+        bool Restore(const std::string &key, const msdkdns_rtt_stats &stats);
+        bool Lookup(const std::string &key, msdkdns_rtt_stats *stats) const;
+
+        // 按历史排序，order 输出 keys 的下标；返回 true 表示存在无历史、过期或抖动较大的IP，需要重新测速
+        bool Rank(const std::vector<std::string> &keys, int64_t now_ms, std::vector<size_t> *order) const;
+
+        // 取出自上次调用以来有变化的记录，用于写回持久化
+        void TakeDirty(std::vector<std::pair<std::string, msdkdns_rtt_stats> > *dirty);
+        // 取出自上次调用以来被淘汰、且之后未重新加入的 key
+        void TakeEvicted(std::vector<std::string> *evicted);
+        size_t Size() const;
+
+        static std::string Key(const std::string &ip, uint16_t port);
+
+    private:
+        double Cost(const msdkdns_rtt_stats &stats) const;
+        bool NeedsProbe(const msdkdns_rtt_stats &stats, int64_t now_ms) const;
+        msdkdns_rtt_stats *Touch(const std::string &key, int64_t now_ms);
+        std::map<std::string, msdkdns_rtt_stats>::iterator Insert(const std::string &key,
+                                                                  const msdkdns_rtt_stats &stats);
+        void EvictOldest();
+
+        size_t capacity_;
+        int64_t stale_ms_;
+        std::map<std::string, msdkdns_rtt_stats> entries_;
+        std::set<std::string> dirty_;
+        std::set<std::string> evicted_;
+
+        RttStore(const RttStore &);
+        RttStore &operator=(const RttStore &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_RTT_STORE_H_
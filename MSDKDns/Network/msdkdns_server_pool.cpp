@@ -0,0 +1,254 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_server_pool.h"
+
+namespace msdkdns {
+
+    // EWMA 系数
+    static const double kLatencyAlpha = 0.3;
+    static const double kErrorAlpha = 0.2;
+    // 无样本或样本过期时按该耗时计算代价
+    static const double kUnknownLatencyMs = 300;
+    static const int64_t kStaleMs = 60 * 1000;
+    // 失败率对代价的放大系数
+    static const double kErrorPenalty = 4;
+    // 最优服务IP代价低于当前服务IP的该比例时才切换，避免抖动
+    static const double kSwitchRatio = 0.8;
+    // 熔断条件：连续失败次数，或样本足够时的失败率
+    static const uint32_t kOpenFailures = 3;
+    static const uint32_t kOpenMinSamples = 5;
+    static const double kOpenErrorRate = 0.5;
+    // 熔断冷却时间，探测失败时加倍
+    static const int64_t kBaseCooldownMs = 10 * 1000;
+    static const int64_t kMaxCooldownMs = 5 * 60 * 1000;
+    // 探测请求超过该时间无结果时允许再次探测
+    static const int64_t kProbeTimeoutMs = 10 * 1000;
+
+    ServerPool::ServerPool() {
+    }
+
+    void ServerPool::SetServers(const std::vector<std::string> &servers) {
+        std::vector<Entry> entries;
+        for (size_t i = 0; i < servers.size(); i++) {
+            bool duplicated = false;
+            for (size_t j = 0; j < entries.size() && !duplicated; j++) {
+                duplicated = entries[j].stats.server == servers[i];
+            }
+            if (duplicated || servers[i].empty()) {
+                continue;
+            }
+            Entry *old = Find(servers[i]);
+            if (old) {
+                entries.push_back(*old);
+                continue;
+            }
+            Entry entry;
+            entry.stats.server = servers[i];
+            entry.stats.state = MSDKDNS_EBreakerState_Closed;
+            entry.stats.latency_ms = 0;
+            entry.stats.error_rate = 0;
+            entry.stats.successes = 0;
+            entry.stats.failures = 0;
+            entry.stats.selected = 0;
+            entry.stats.retry_at_ms = 0;
+            entry.consecutive_failures = 0;
+            entry.cooldown_ms = kBaseCooldownMs;
+            entry.updated_ms = 0;
+            entry.probing = false;
+            entry.probe_started_ms = 0;
+            entries.push_back(entry);
+        }
+        entries_.swap(entries);
+        if (!Find(current_)) {
+            current_.clear();
+        }
+    }
+
+    ServerPool::Entry *ServerPool::Find(const std::string &server) {
+        for (size_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].stats.server == server) {
+                return &entries_[i];
+            }
+        }
+        return NULL;
+    }
+
+    double ServerPool::Cost(const Entry &entry, int64_t now_ms) const {
+        if (entry.stats.successes == 0 || now_ms - entry.updated_ms > kStaleMs) {
+            return kUnknownLatencyMs;
+        }
+        return entry.stats.latency_ms * (1 + kErrorPenalty * entry.stats.error_rate);
+    }
+
+    int ServerPool::Best(int64_t now_ms, const std::string *exclude) const {
+        int best = -1;
+        double best_cost = 0;
+        for (size_t i = 0; i < entries_.size(); i++) {
+            const Entry &entry = entries_[i];
+            if (entry.stats.state != MSDKDNS_EBreakerState_Closed || (exclude && entry.stats.server == *exclude)) {
+                continue;
+            }
+            double cost = Cost(entry, now_ms);
+            if (best < 0 || cost < best_cost) {
+                best = static_cast<int>(i);
+                best_cost = cost;
+            }
+        }
+        if (best < 0 || exclude) {
+            return best;
+        }
+        // 当前服务IP可用且代价相差不大时继续使用
+        for (size_t i = 0; i < entries_.size(); i++) {
+            const Entry &entry = entries_[i];
+            if (entry.stats.server == current_ && entry.stats.state == MSDKDNS_EBreakerState_Closed &&
+                best_cost >= Cost(entry, now_ms) * kSwitchRatio) {
+                return static_cast<int>(i);
+            }
+        }
+        return best;
+    }
+
+    bool ServerPool::Select(int64_t now_ms, std::string *server) {
+        if (entries_.empty()) {
+            return false;
+        }
+        // 冷却结束的服务IP优先放行一个探测请求，使恢复的服务IP能尽快重新使用
+        Entry *probe = NULL;
+        for (size_t i = 0; i < entries_.size() && !probe; i++) {
+            Entry &entry = entries_[i];
+            if (entry.stats.state == MSDKDNS_EBreakerState_Open && now_ms >= entry.stats.retry_at_ms) {
+                entry.stats.state = MSDKDNS_EBreakerState_HalfOpen;
+                entry.probing = false;
+            }
+            if (entry.stats.state == MSDKDNS_EBreakerState_HalfOpen &&
+                (!entry.probing || now_ms - entry.probe_started_ms > kProbeTimeoutMs)) {
+                probe = &entry;
+            }
+        }
+        if (!probe) {
+            int best = Best(now_ms, NULL);
+            if (best >= 0) {
+                Entry &entry = entries_[best];
+                entry.stats.selected++;
+                current_ = entry.stats.server;
+                *server = current_;
+                return true;
+            }
+            // 全部熔断时仍需发出请求，选最早可以重试的服务IP作为探测
+            for (size_t i = 0; i < entries_.size(); i++) {
+                if (!probe || entries_[i].stats.retry_at_ms < probe->stats.retry_at_ms) {
+                    probe = &entries_[i];
+                }
+            }
+        }
+        probe->probing = true;
+        probe->probe_started_ms = now_ms;
+        probe->stats.selected++;
+        *server = probe->stats.server;
+        return true;
+    }
+
+    bool ServerPool::Preferred(int64_t now_ms, std::string *server) const {
+        if (entries_.empty()) {
+            return false;
+        }
+        int best = Best(now_ms, NULL);
+        *server = entries_[best >= 0 ? best : 0].stats.server;
+        return true;
+    }
+
+    bool ServerPool::Alternate(const std::string &exclude, int64_t now_ms, std::string *server) const {
+        int best = Best(now_ms, &exclude);
+        if (best < 0) {
+            return false;
+        }
+        *server = entries_[best].stats.server;
+        return true;
+    }
+
+    void ServerPool::Open(Entry *entry, int64_t now_ms) {
+        entry->stats.state = MSDKDNS_EBreakerState_Open;
+        entry->stats.retry_at_ms = now_ms + entry->cooldown_ms;
+        entry->probing = false;
+    }
+
+    void ServerPool::RecordSuccess(const std::string &server, double latency_ms, int64_t now_ms) {
+        Entry *entry = Find(server);
+        if (!entry) {
+            return;
+        }
+        if (latency_ms < 0) {
+            latency_ms = 0;
+        }
+        bool known = entry->stats.successes > 0 && now_ms - entry->updated_ms <= kStaleMs;
+        entry->stats.latency_ms = known ? entry->stats.latency_ms + kLatencyAlpha * (latency_ms - entry->stats.latency_ms)
+                                        : latency_ms;
+        entry->stats.error_rate *= (1 - kErrorAlpha);
+        entry->stats.successes++;
+        entry->updated_ms = now_ms;
+        entry->consecutive_failures = 0;
+        if (entry->stats.state != MSDKDNS_EBreakerState_Closed) {
+            // 探测成功，熔断前的失败率不再参与计算
+            entry->stats.error_rate = 0;
+            entry->stats.state = MSDKDNS_EBreakerState_Closed;
+            entry->stats.retry_at_ms = 0;
+            entry->cooldown_ms = kBaseCooldownMs;
+            entry->probing = false;
+        }
+    }
+
+    void ServerPool::RecordFailure(const std::string &server, int64_t now_ms) {
+        Entry *entry = Find(server);
+        if (!entry) {
+            return;
+        }
+        entry->stats.error_rate += kErrorAlpha * (1 - entry->stats.error_rate);
+        entry->stats.failures++;
+        entry->updated_ms = now_ms;
+        entry->consecutive_failures++;
+        switch (entry->stats.state) {
+            case MSDKDNS_EBreakerState_HalfOpen:
+                // 探测失败，加倍冷却时间
+                entry->cooldown_ms = entry->cooldown_ms * 2 > kMaxCooldownMs ? kMaxCooldownMs : entry->cooldown_ms * 2;
+                Open(entry, now_ms);
+                break;
+            case MSDKDNS_EBreakerState_Closed:
+                if (entry->consecutive_failures >= kOpenFailures ||
+                    (entry->stats.successes + entry->stats.failures >= kOpenMinSamples &&
+                     entry->stats.error_rate >= kOpenErrorRate)) {
+                    Open(entry, now_ms);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void ServerPool::RecordClientError(const std::string &server, int64_t now_ms) {
+        Entry *entry = Find(server);
+        if (!entry) {
+            return;
+        }
+        (void)now_ms;
+        // 探测没有得到结论，允许下一个请求重新探测
+        entry->probing = false;
+    }
+
+    bool ServerPool::AllOpen() const {
+        for (size_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].stats.state == MSDKDNS_EBreakerState_Closed) {
+                return false;
+            }
+        }
+        return !entries_.empty();
+    }
+
+    void ServerPool::Stats(std::vector<msdkdns_server_stats> *stats) const {
+        stats->clear();
+        for (size_t i = 0; i < entries_.size(); i++) {
+            stats->push_back(entries_[i].stats);
+        }
+    }
+}  // namespace msdkdns
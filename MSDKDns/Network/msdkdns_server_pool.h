@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_SERVER_POOL_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_SERVER_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    enum MSDKDNS_TBreakerState {
+        MSDKDNS_EBreakerState_Closed = 0,  // 正常使用
+        MSDKDNS_EBreakerState_Open,        // 熔断中，冷却结束前不再使用
+        MSDKDNS_EBreakerState_HalfOpen,    // 冷却结束，放行一个探测请求
+    };
+
+    typedef struct msdkdns_server_stats {
+        std::string server;
+        MSDKDNS_TBreakerState state;
+        double latency_ms;         // EWMA 耗时，无样本时为 0
+        double error_rate;         // EWMA 失败率，0~1
+        uint32_t successes;
+        uint32_t failures;
+        uint32_t selected;         // 被选为请求服务IP的次数
+        int64_t retry_at_ms;       // 熔断时下次允许探测的时间
+    } msdkdns_server_stats;
+
+    /*
+     * 解析服务IP池
+     * 每个服务IP记录 EWMA 耗时和失败率，并维护熔断器：
+     *   closed    连续失败 kOpenFailures 次或失败率过高时熔断
+     *   open      冷却结束后转为 half-open
+     *   half-open 放行一个探测请求，成功恢复 closed，失败重新熔断并加倍冷却时间
+     * 请求优先选择代价（耗时按失败率加权）最低的可用服务IP，无样本或样本过期的按默认耗时计算且不计失败率，
+     * 代价相差不大时保持当前服务IP，相同时按列表顺序
+     * 非线程安全，需由调用方保证串行访问
+     */
+    class ServerPool {
+    public:
+        ServerPool();
+
+        // 更新服务IP列表，保留仍在列表中的服务IP的统计
+        void SetServers(const std::vector<std::string> &servers);
+        // 为请求选择服务IP，可能返回一个冷却结束的服务IP作为探测；列表为空时返回 false
+        bool Select(int64_t now_ms, std::string *server);
+        // 当前最优的可用服务IP，不改变状态，用于展示和上报
+        bool Preferred(int64_t now_ms, std::string *server) const;
+        // 除 exclude 外最优的可用服务IP，用于对冲请求
+        bool Alternate(const std::string &exclude, int64_t now_ms, std::string *server) const;
+
+        void RecordSuccess(const std::string &server, double latency_ms, int64_t now_ms);
+        void RecordFailure(const std::string &server, int64_t now_ms);
+        // 本地无网络、连接被本机网络切换中断等客户端原因导致的失败，不计入服务IP的统计，只结束进行中的探测
+        void RecordClientError(const std::string &server, int64_t now_ms);
+
+        // 是否所有服务IP都已熔断
+        bool AllOpen() const;
+        void Stats(std::vector<msdkdns_server_stats> *stats) const;
+
+    private:
+        struct Entry {
+            msdkdns_server_stats stats;
+            uint32_t consecutive_failures;
+            int64_t cooldown_ms;
+            int64_t updated_ms;
+            bool probing;
+            int64_t probe_started_ms;
+        };
+
+        Entry *Find(const std::string &server);
+        double Cost(const Entry &entry, int64_t now_ms) const;
+        // 返回最优的 closed 服务IP下标，无可用时返回 -1
+        int Best(int64_t now_ms, const std::string *exclude) const;
+        void Open(Entry *entry, int64_t now_ms);
+
+        std::vector<Entry> entries_;
+        std::string current_;
+
+        ServerPool(const ServerPool &);
+        ServerPool &operator=(const ServerPool &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_SERVER_POOL_H_
@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_tcp_prober.h"
+#include "msdkdns_local_ip_stack.h"
+#include "msdkdns_ip.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace msdkdns {
+
+    static const unsigned int kMaxLoopCount = 10;
+
+    static int64_t msdkdns_probe_now_us() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    // 支持 "1.2.3.4"、"::1" 及带方括号的 "[::1]"
+    static bool msdkdns_probe_sockaddr(const std::string &ip, uint16_t port,
+                                       msdkdns_sockaddr_union *addr, socklen_t *addr_len) {
+        std::string host = ip;
+        if (host.size() > 2 && host[0] == '[' && host[host.size() - 1] == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        memset(addr, 0, sizeof(*addr));
+        if (msdkdns_parse_ipv4(host.data(), host.size(), (uint8_t *)&addr->msdkdns_in.sin_addr)) {
+            addr->msdkdns_in.sin_family = AF_INET;
+            addr->msdkdns_in.sin_port = htons(port);
+            *addr_len = sizeof(struct sockaddr_in);
+            return true;
+        }
+        if (msdkdns_parse_ipv6(host.data(), host.size(), (uint8_t *)&addr->msdkdns_in6.sin6_addr)) {
+            addr->msdkdns_in6.sin6_family = AF_INET6;
+            addr->msdkdns_in6.sin6_port = htons(port);
+            *addr_len = sizeof(struct sockaddr_in6);
+            return true;
+        }
+        return false;
+    }
+
+    static void msdkdns_probe_close(int fd) {
+        unsigned int loop_count = 0;
+        while (close(fd) < 0 && errno == EINTR && loop_count++ < kMaxLoopCount) {
+        }
+    }
+
+    // 发起非阻塞connect，返回 0 表示已立即连通，1 表示进行中（fd 有效），-1 表示失败
+    static int msdkdns_probe_start(const std::string &ip, uint16_t port, int *fd) {
+        msdkdns_sockaddr_union addr;
+        socklen_t addr_len = 0;
+        if (!msdkdns_probe_sockaddr(ip, port, &addr, &addr_len)) {
+            return -1;
+        }
+        int s = socket(addr.msdkdns_generic.sa_family, SOCK_STREAM, IPPROTO_TCP);
+        if (s < 0) {
+            return -1;
+        }
+        int flags = fcntl(s, F_GETFL, 0);
+        if (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0) {
+            msdkdns_probe_close(s);
+            return -1;
+        }
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        int ret = connect(s, &addr.msdkdns_generic, addr_len);
+        if (ret == 0) {
+            msdkdns_probe_close(s);
+            return 0;
+        }
+        // 非阻塞connect被信号打断时连接仍在后台进行，与 EINPROGRESS 同样处理
+        if (errno != EINPROGRESS && errno != EINTR) {
+            msdkdns_probe_close(s);
+            return -1;
+        }
+        *fd = s;
+        return 1;
+    }
+
+    size_t msdkdns_tcp_probe(const std::vector<std::string> &ips,
+                             uint16_t port,
+                             int timeout_ms,
+                             size_t quorum,
+                             std::vector<msdkdns_probe_result> *results) {
+        if (results) {
+            results->clear();
+        }
+        size_t count = ips.size();
+        if (count == 0) {
+            return 0;
+        }
+        if (quorum == 0 || quorum > count) {
+            quorum = count;
+        }
+
+        std::vector<struct pollfd> fds(count);
+        std::vector<MSDKDNS_TProbeState> states(count, MSDKDNS_EProbeState_Failed);
+        std::vector<int64_t> start_us(count, 0);
+        std::vector<double> rtts(count, 0);
+        std::vector<size_t> connected;
+        connected.reserve(count);
+        size_t pending = 0;
+
+        int64_t deadline_us = msdkdns_probe_now_us() + static_cast<int64_t>(timeout_ms) * 1000;
+        for (size_t i = 0; i < count; i++) {
+            fds[i].fd = -1;
+            fds[i].events = POLLOUT;
+            fds[i].revents = 0;
+            start_us[i] = msdkdns_probe_now_us();
+            int fd = -1;
+            int ret = msdkdns_probe_start(ips[i], port, &fd);
+            if (ret == 0) {
+                states[i] = MSDKDNS_EProbeState_Connected;
+                rtts[i] = (msdkdns_probe_now_us() - start_us[i]) / 1000.0;
+                connected.push_back(i);
+            } else if (ret > 0) {
+                fds[i].fd = fd;
+                states[i] = MSDKDNS_EProbeState_Timeout;
+                pending++;
+            }
+        }
+
+        // 所有连接在同一个poll中等待，poll 会忽略 fd 为负数的项
+        while (pending > 0 && connected.size() < quorum) {
+            int64_t now_us = msdkdns_probe_now_us();
+            if (now_us >= deadline_us) {
+                break;
+            }
+            int wait_ms = static_cast<int>((deadline_us - now_us + 999) / 1000);
+            int n = poll(&fds[0], static_cast<nfds_t>(count), wait_ms);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            if (n == 0) {
+                continue;
+            }
+            int64_t done_us = msdkdns_probe_now_us();
+            for (size_t i = 0; i < count; i++) {
+                if (fds[i].fd < 0 || fds[i].revents == 0) {
+                    continue;
+                }
+                // 连接成功时可写；失败时同时可读可写，需通过 SO_ERROR 区分
+                int err = 0;
+                socklen_t len = sizeof(err);
+                bool ok = !(fds[i].revents & POLLNVAL) &&
+                          getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+                if (ok) {
+                    states[i] = MSDKDNS_EProbeState_Connected;
+                    rtts[i] = (done_us - start_us[i]) / 1000.0;
+                    connected.push_back(i);
+                } else {
+                    states[i] = MSDKDNS_EProbeState_Failed;
+                }
+                msdkdns_probe_close(fds[i].fd);
+                fds[i].fd = -1;
+                fds[i].revents = 0;
+                pending--;
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (fds[i].fd >= 0) {
+                msdkdns_probe_close(fds[i].fd);
+                fds[i].fd = -1;
+                if (connected.size() >= quorum) {
+                    states[i] = MSDKDNS_EProbeState_Cancelled;
+                }
+            }
+        }
+
+        if (results) {
+            results->reserve(count);
+            for (size_t k = 0; k < connected.size(); k++) {
+                msdkdns_probe_result result = {connected[k], MSDKDNS_EProbeState_Connected, rtts[connected[k]]};
+                results->push_back(result);
+            }
+            const MSDKDNS_TProbeState rest[] = {
+                MSDKDNS_EProbeState_Cancelled,
+                MSDKDNS_EProbeState_Timeout,
+                MSDKDNS_EProbeState_Failed,
+            };
+            for (size_t r = 0; r < sizeof(rest) / sizeof(rest[0]); r++) {
+                for (size_t i = 0; i < count; i++) {
+                    if (states[i] == rest[r]) {
+                        msdkdns_probe_result result = {i, rest[r], 0};
+                        results->push_back(result);
+                    }
+                }
+            }
+        }
+        return connected.size();
+    }
+}  // namespace msdkdns
@@ -0,0 +1,42 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_TCP_PROBER_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_TCP_PROBER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    enum MSDKDNS_TProbeState {
+        MSDKDNS_EProbeState_Connected = 0,  // 连接成功，rtt_ms 有效
+        MSDKDNS_EProbeState_Failed = 1,     // 地址非法、创建socket失败或连接被拒绝
+        MSDKDNS_EProbeState_Timeout = 2,    // 超时仍未完成
+        MSDKDNS_EProbeState_Cancelled = 3,  // 已达到 quorum，未等待其完成
+    };
+
+    typedef struct msdkdns_probe_result {
+        size_t index;  // 在输入列表中的下标
+        MSDKDNS_TProbeState state;
+        double rtt_ms;
+    } msdkdns_probe_result;
+
+    /*
+     * 并发TCP建连测速，IPv4、IPv6及混合列表均可
+     * 同时对所有地址发起非阻塞connect，在同一个poll循环中等待，按完成先后排名，
+     * 成功数达到 quorum（0 表示全部）后取消其余连接，整体耗时不超过 timeout_ms
+     * results 按排名输出：成功的按完成顺序在前，其余按 取消、超时、失败 分组并保持输入顺序
+     * 返回成功连接的个数
+     */
+    size_t msdkdns_tcp_probe(const std::vector<std::string> &ips,
+                             uint16_t port,
+                             int timeout_ms,
+                             size_t quorum,
+                             std::vector<msdkdns_probe_result> *results);
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_NETWORK_MSDKDNS_TCP_PROBER_H_
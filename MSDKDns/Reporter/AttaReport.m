@@ -11,8 +11,6 @@
 #import "MSDKDnsNetworkManager.h"
 #import "MSDKDnsParamsManager.h"
 #import "MSDKDnsInfoTool.h"
-#import <CoreTelephony/CTCarrier.h>
-#import <CoreTelephony/CTTelephonyNetworkInfo.h>
 #import <UIKit/UIKit.h>
 #import "MSDKDns.h"
 #if defined(__has_include)
@@ -149,16 +147,7 @@ static AttaReport * gSharedInstance = nil;
 
 // 获取运营商类型
 + (NSString*)getOperatorsType{
-    CTTelephonyNetworkInfo *telephonyInfo = [[CTTelephonyNetworkInfo alloc] init];
-    CTCarrier *carrier = [telephonyInfo subscriberCellularProvider];
-
-    NSString *currentCountryCode = [carrier mobileCountryCode];
-    NSString *mobileNetWorkCode = [carrier mobileNetworkCode];
-
-    if (currentCountryCode || mobileNetWorkCode) {
-        return [NSString stringWithFormat:@"%@%@", currentCountryCode, mobileNetWorkCode];
-    }
-    return @"-1";
+    return [[MSDKDnsNetworkManager shareInstance] cellularOperatorCode] ?: @"-1";
 }
 
 - (BOOL)shoulReportDnsSpend {
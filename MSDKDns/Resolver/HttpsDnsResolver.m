@@ -6,15 +6,28 @@
 #import "HttpsDnsResolver.h"
 #import "MSDKDnsService.h"
 #import "MSDKDnsManager.h"
+#import "MSDKDnsParamsManager.h"
+#import "MSDKDnsServerMonitor.h"
 #import "MSDKDnsLog.h"
 #import "MSDKDnsInfoTool.h"
+#import "MSDKDnsHttpClient.h"
 #import "MSDKDns.h"
+#import "msdkdns_response_parser.h"
 
 @interface HttpsDnsResolver() <NSURLSessionTaskDelegate, NSURLSessionDataDelegate>
 
 @property (copy, nonatomic) NSString * dnsKey;
 @property (nonatomic, assign) HttpDnsIPType ipType;
 @property (nonatomic, assign) NSInteger encryptType;  // 0 des  1 aes
+// 对冲请求，以下状态在 @synchronized(self) 中访问
+// NSURLSessionTask 或长连接池的请求标识
+@property (strong, nonatomic) NSMutableArray * tasks;
+@property (assign, nonatomic) NSUInteger pendingAttempts;
+@property (assign, nonatomic) BOOL answered;
+@property (strong, nonatomic) NSString * hedgeServer;
+@property (strong, nonatomic) NSURL * hedgeUrl;
+@property (assign, nonatomic) BOOL hedgeSent;
+@property (assign, nonatomic) float requestTimeOut;
 
 @end
 
@@ -58,10 +71,15 @@ static NSURLSession *_resolveHOSTSession = nil;
     NSString *domainAndTime = [NSString stringWithFormat:@"%@;%@", domainStr, expiredTimestamp];
     
     // NSLog(@"domainAndTime ===== %@ === domain ==== %@", domainAndTime, domainStr);
-    NSURL *httpDnsUrl = [MSDKDnsInfoTool httpsUrlWithDomain:domainAndTime dnsId:dnsId dnsKey:self.dnsKey ipType:self.ipType encryptType:_encryptType];
+    NSURL *httpDnsUrl = [MSDKDnsInfoTool httpsUrlWithDomain:domainAndTime dnsId:dnsId dnsKey:self.dnsKey ipType:self.ipType encryptType:_encryptType serviceIp:self.serviceIp];
     
     if (httpDnsUrl) {
-        [self startDataTaskWithHttpDnsUrl:httpDnsUrl domains:domains timeOut:timeOut delegate:delegate];
+        NSString *hedgeServer = [[MSDKDnsParamsManager shareInstance] msdkDnsGetHedgedRequestEnabled] ? [[MSDKDnsManager shareInstance] hedgeDnsServerExcluding:self.serviceIp] : nil;
+        if (hedgeServer) {
+            self.hedgeServer = hedgeServer;
+            self.hedgeUrl = [MSDKDnsInfoTool httpsUrlWithDomain:domainAndTime dnsId:dnsId dnsKey:self.dnsKey ipType:self.ipType encryptType:_encryptType serviceIp:hedgeServer];
+        }
+        [self startAttemptsWithHttpDnsUrl:httpDnsUrl domains:domains timeOut:timeOut delegate:delegate];
     } else {
         MSDKDNSLOG("HttpDns Request URL is null");
         self.errorInfo = @"httpUrl is null";
@@ -84,10 +102,16 @@ static NSURLSession *_resolveHOSTSession = nil;
     self.errorInfo = nil;
     self.isFinished = NO;
     self.isSucceed = NO;
+    self.tasks = [NSMutableArray array];
+    self.pendingAttempts = 0;
+    self.answered = NO;
+    self.hedgeServer = nil;
+    self.hedgeUrl = nil;
+    self.hedgeSent = NO;
     self.encryptType = encryptType;
     MSDKDNSLOG(@"HttpDns startWithDomain: %@!", domains);
     self.ipType = HttpDnsTypeIPv4;
-    self.serviceIp = [[MSDKDnsManager shareInstance] currentDnsServer];
+    self.serviceIp = [[MSDKDnsManager shareInstance] selectDnsServer];
     if (netStack == msdkdns::MSDKDNS_ELocalIPStack_IPv6) {
         self.ipType = HttpDnsTypeIPv6;
     } else if (netStack == msdkdns::MSDKDNS_ELocalIPStack_Dual) {
@@ -95,19 +119,164 @@ static NSURLSession *_resolveHOSTSession = nil;
     }
 }
 
-- (void)startDataTaskWithHttpDnsUrl:(NSURL *)httpDnsUrl domains:(NSArray *)domains timeOut:(float)timeOut delegate:(id<MSDKDnsResolverDelegate>)delegate {
+#pragma mark - hedged request
+
+// 先向当前服务IP发出请求，超过对冲延迟仍无结果或提前失败时，再向下一个服务IP发出相同请求
+- (void)startAttemptsWithHttpDnsUrl:(NSURL *)httpDnsUrl domains:(NSArray *)domains timeOut:(float)timeOut delegate:(id<MSDKDnsResolverDelegate>)delegate {
+    NSString *server = self.serviceIp;
+    self.requestTimeOut = timeOut;
+    [self startAttemptWithHttpDnsUrl:httpDnsUrl server:server domains:domains timeOut:timeOut delegate:delegate];
+    if (!self.hedgeUrl) {
+        return;
+    }
+    double hedgeDelayMs = [[MSDKDnsServerMonitor shareInstance] hedgeDelayOfServer:server timeOut:timeOut * 1000];
+    __weak __typeof__(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(hedgeDelayMs * NSEC_PER_MSEC)), [MSDKDnsInfoTool msdkdns_resolver_queue], ^{
+        [weakSelf startHedgeWithDomains:domains delegate:delegate];
+    });
+}
+
+- (void)startHedgeWithDomains:(NSArray *)domains delegate:(id<MSDKDnsResolverDelegate>)delegate {
+    @synchronized(self) {
+        if (self.answered || self.hedgeSent || !self.hedgeUrl) {
+            return;
+        }
+        self.hedgeSent = YES;
+    }
+    MSDKDNSLOG(@"HttpDns no response from %@, send hedged request to %@", self.serviceIp, self.hedgeServer);
+    [self startAttemptWithHttpDnsUrl:self.hedgeUrl server:self.hedgeServer domains:domains timeOut:self.requestTimeOut delegate:delegate];
+}
+
+- (void)startAttemptWithHttpDnsUrl:(NSURL *)httpDnsUrl server:(NSString *)server domains:(NSArray *)domains timeOut:(float)timeOut delegate:(id<MSDKDnsResolverDelegate>)delegate {
     MSDKDNSLOG("HttpDns Request URL: %@", httpDnsUrl);
-    NSURLRequest *request = [NSURLRequest requestWithURL:httpDnsUrl
-                                               cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
-                                           timeoutInterval:timeOut];
-    NSURLSessionTask *task = [_resolveHOSTSession dataTaskWithRequest:request completionHandler:^(NSData * _Nullable data, NSURLResponse * _Nullable response, NSError * _Nullable error) {
-        if (error) {
-            [self handleDataTaskError:error delegate:delegate];
+    double attemptTimeOutMs = [[MSDKDnsServerMonitor shareInstance] attemptTimeoutOfServer:server timeOut:timeOut * 1000];
+    NSDate *attemptStart = [NSDate date];
+    void (^completionHandler)(NSData *, NSURLResponse *, NSError *) = ^(NSData * _Nullable data, NSURLResponse * _Nullable response, NSError * _Nullable error) {
+        double latencyMs = [[NSDate date] timeIntervalSinceDate:attemptStart] * 1000;
+        [self attemptOfServer:server latency:latencyMs timeOut:attemptTimeOutMs didFinishWithData:data response:response error:error domains:domains delegate:delegate];
+    };
+    // 先登记在途请求再发出：连接池的请求可能在 getWithURL: 返回前就已失败并回调，回调会减少 pendingAttempts
+    @synchronized(self) {
+        if (self.answered) {
+            return;
+        }
+        self.pendingAttempts += 1;
+    }
+    // http 请求走长连接池，复用到服务IP的连接；https 及连接池不支持的 URL 仍使用 NSURLSession
+    id task = nil;
+    if (self.encryptType != HttpDnsEncryptTypeHTTPS) {
+        task = [[MSDKDnsHttpClient shareInstance] getWithURL:httpDnsUrl timeout:attemptTimeOutMs / 1000 completionHandler:completionHandler];
+    }
+    if (!task) {
+        NSURLRequest *request = [NSURLRequest requestWithURL:httpDnsUrl
+                                                   cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                                               timeoutInterval:attemptTimeOutMs / 1000];
+        task = [_resolveHOSTSession dataTaskWithRequest:request completionHandler:completionHandler];
+    }
+    @synchronized(self) {
+        if (self.answered) {
+            // 发出期间另一个请求已返回结果，取消刚发出的请求
+            [self cancelTask:task];
+            return;
+        }
+        [self.tasks addObject:task];
+    }
+    if ([task isKindOfClass:[NSURLSessionTask class]]) {
+        [(NSURLSessionTask *)task resume];
+    }
+}
+
+- (void)cancelTask:(id)task {
+    if ([task isKindOfClass:[NSURLSessionTask class]]) {
+        if ([(NSURLSessionTask *)task state] == NSURLSessionTaskStateRunning) {
+            [(NSURLSessionTask *)task cancel];
+        }
+    } else if ([task isKindOfClass:[NSNumber class]]) {
+        [[MSDKDnsHttpClient shareInstance] cancelTask:task];
+    }
+}
+
+- (BOOL)isClientNetworkError:(NSError *)error {
+    if (![error.domain isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    switch (error.code) {
+        case NSURLErrorNotConnectedToInternet:
+        case NSURLErrorNetworkConnectionLost:
+        case NSURLErrorInternationalRoamingOff:
+        case NSURLErrorCallIsActive:
+        case NSURLErrorDataNotAllowed:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+- (void)attemptOfServer:(NSString *)server
+                latency:(double)latencyMs
+                timeOut:(double)timeOutMs
+      didFinishWithData:(NSData *)data
+               response:(NSURLResponse *)response
+                  error:(NSError *)error
+                domains:(NSArray *)domains
+               delegate:(id<MSDKDnsResolverDelegate>)delegate {
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+        return;
+    }
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorTimedOut) {
+        [[MSDKDnsServerMonitor shareInstance] recordTimeout:timeOutMs ofServer:server];
+    } else if ([self isClientNetworkError:error]) {
+        // 本地网络不可用，换哪个服务IP都一样，不影响服务IP的选择
+        [[MSDKDnsServerMonitor shareInstance] recordClientErrorOfServer:server];
+    } else if (error || ([response isKindOfClass:[NSHTTPURLResponse class]] && [(NSHTTPURLResponse *)response statusCode] >= 500)) {
+        // 连接失败或服务端错误计入失败率，401 等由请求参数导致的错误不影响服务IP的选择
+        [[MSDKDnsServerMonitor shareInstance] recordFailureOfServer:server];
+    } else {
+        [[MSDKDnsServerMonitor shareInstance] recordLatency:latencyMs ofServer:server];
+    }
+    NSDictionary *domainInfo = error ? nil : [self domainInfoWithData:data];
+    BOOL startHedge = NO;
+    NSArray *losers = nil;
+    @synchronized(self) {
+        if (self.answered) {
+            return;
+        }
+        self.pendingAttempts -= 1;
+        if (domainInfo.count == 0 && self.pendingAttempts > 0) {
+            // 另一个请求仍在进行，等待其结果
+            return;
+        }
+        if (domainInfo.count == 0 && !self.hedgeSent && self.hedgeUrl) {
+            startHedge = YES;
         } else {
-            [self handleDataTaskSuccessWithData:data domains:domains response:response delegate:delegate];
+            self.answered = YES;
+            losers = [self.tasks copy];
         }
-    }];
-    [task resume];
+    }
+    if (startHedge) {
+        // 未到对冲延迟就已失败，立即向下一个服务IP发出请求
+        [self startHedgeWithDomains:domains delegate:delegate];
+        return;
+    }
+    for (id task in losers) {
+        [self cancelTask:task];
+    }
+    self.serviceIp = server;
+    if (error) {
+        [self handleDataTaskError:error delegate:delegate];
+    } else {
+        [self handleDataTaskSuccessWithData:data domainInfo:domainInfo domains:domains response:response delegate:delegate];
+    }
+}
+
+- (NSDictionary *)domainInfoWithData:(NSData *)data {
+    if (!data || data.length == 0) {
+        return nil;
+    }
+    NSString * responseStr = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+    NSString * decryptStr = [self getDecryptStrWithResponseStr:responseStr];
+    MSDKDNSLOG(@"The httpdns responseStr:%@", decryptStr);
+    return [self parseResultString:decryptStr];
 }
 
 - (void)handleDataTaskError:(NSError *)error delegate:(id<MSDKDnsResolverDelegate>)delegate {
@@ -123,18 +292,14 @@ static NSURLSession *_resolveHOSTSession = nil;
     }
 }
 
-- (void)handleDataTaskSuccessWithData:(NSData *)data domains:(NSArray *)domains response:(NSURLResponse *)response delegate:(id<MSDKDnsResolverDelegate>)delegate {
+- (void)handleDataTaskSuccessWithData:(NSData *)data domainInfo:(NSDictionary *)domainInfo domains:(NSArray *)domains response:(NSURLResponse *)response delegate:(id<MSDKDnsResolverDelegate>)delegate {
     BOOL openOptimismCache = [[MSDKDnsManager shareInstance] isOpenOptimismCache];
     MSDKDNSLOG(@"HttpDns didReceiveData!");
     NSString * errorInfo = @"";
     NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse*)response;
     self.statusCode = [httpResponse statusCode];
     if (data && data.length > 0) {
-        NSString * decryptStr = nil;
-        NSString * responseStr = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-        decryptStr = [self getDecryptStrWithResponseStr:responseStr];
-        MSDKDNSLOG(@"The httpdns responseStr:%@", decryptStr);
-        self.domainInfo = [self parseResultString:decryptStr];
+        self.domainInfo = domainInfo;
         
         if (self.domainInfo && [self.domainInfo count] > 0) {
             self.isFinished = YES;
@@ -257,112 +422,75 @@ static NSURLSession *_resolveHOSTSession = nil;
 }
 
 #pragma mark - util
-- (NSString *)getQueryDomain:(NSString *)str {
-    // 删除域名后面添加的.
-    if ([[str substringFromIndex:str.length - 1]  isEqual: @"."]) {
-        return [str substringToIndex:str.length - 1];
-    }
-    return str;
-}
 
-- (void)parseSingleDomain:(NSString *)string intoDic:(NSDictionary *)resultDic {
-    // 找到第一个冒号，进行拆分
-    NSRange range = [string rangeOfString:@":"];
-    if (range.location != NSNotFound) {
-        NSString* queryDomain = [self getQueryDomain:[string substringToIndex:range.location]];
-        NSString* ipString = [string substringFromIndex:range.location + 1];
-        NSDictionary *domainInfo = [self parseAllIPString:ipString];
-        if (queryDomain && domainInfo) {
-            [resultDic setValue:domainInfo forKey:queryDomain];
-        }
-    }
+static NSString * MSDKDnsStringFromRange(const char *base, msdkdns::msdkdns_text_range range) {
+    return [[NSString alloc] initWithBytes:base + range.offset length:range.length encoding:NSUTF8StringEncoding];
 }
 
 - (NSDictionary *)parseResultString:(NSString *)string {
-    NSDictionary *resultDic = [NSMutableDictionary dictionary];
-    if ([MSDKDnsInfoTool isExist:string]){
-        if ([string containsString:@"\n"]) {
-            NSArray *lineArray = [string componentsSeparatedByString:@"\n"];
-            for (int i = 0; i < [lineArray count]; i++) {
-                NSString *lineString = [lineArray objectAtIndex:i];
-                [self parseSingleDomain:lineString intoDic:resultDic];
+    NSMutableDictionary *resultDic = [NSMutableDictionary dictionary];
+    if (![MSDKDnsInfoTool isExist:string]) {
+        return resultDic;
+    }
+    const char *data = [string UTF8String];
+    if (!data) {
+        return resultDic;
+    }
+    msdkdns::MSDKDNS_TResponseMode mode = msdkdns::MSDKDNS_EResponseMode_IPv4;
+    if (self.ipType == HttpDnsTypeDual) {
+        mode = msdkdns::MSDKDNS_EResponseMode_Dual;
+    } else if (self.ipType == HttpDnsTypeIPv6) {
+        mode = msdkdns::MSDKDNS_EResponseMode_IPv6;
+    }
+    std::vector<msdkdns::msdkdns_response_record> records;
+    std::vector<msdkdns::msdkdns_response_address> addresses;
+    msdkdns::msdkdns_parse_response(data, strlen(data), mode, &records, &addresses);
+
+    double timeInterval = [[NSDate date] timeIntervalSince1970];
+    NSString * timeConsuming = [NSString stringWithFormat:@"%d", [self dnsTimeConsuming]];
+    for (size_t i = 0; i < records.size(); i++) {
+        const msdkdns::msdkdns_response_record &record = records[i];
+        NSString *queryDomain = MSDKDnsStringFromRange(data, record.domain);
+        NSString *clientIP = MSDKDnsStringFromRange(data, record.client_ip) ?: @"";
+        const msdkdns::msdkdns_response_answer &answer_A = record.answers[msdkdns::MSDKDNS_EResponseFamily_IPv4];
+        const msdkdns::msdkdns_response_answer &answer_4A = record.answers[msdkdns::MSDKDNS_EResponseFamily_IPv6];
+        NSDictionary *domainInfo = nil;
+        if (mode == msdkdns::MSDKDNS_EResponseMode_Dual) {
+            NSMutableDictionary *bothIPDict = [NSMutableDictionary dictionary];
+            if (answer_A.present) {
+                bothIPDict[@"ipv4"] = [self domainInfoFromAnswer:answer_A data:data addresses:addresses clientIP:clientIP timeInterval:timeInterval timeConsuming:timeConsuming];
             }
+            if (answer_4A.present) {
+                bothIPDict[@"ipv6"] = [self domainInfoFromAnswer:answer_4A data:data addresses:addresses clientIP:clientIP timeInterval:timeInterval timeConsuming:timeConsuming];
+            }
+            domainInfo = bothIPDict;
         } else {
-            [self parseSingleDomain:string intoDic:resultDic];
+            domainInfo = [self domainInfoFromAnswer:(answer_A.present ? answer_A : answer_4A) data:data addresses:addresses clientIP:clientIP timeInterval:timeInterval timeConsuming:timeConsuming];
+        }
+        if (queryDomain && domainInfo) {
+            [resultDic setValue:domainInfo forKey:queryDomain];
         }
     }
     return resultDic;
 }
 
-- (NSDictionary *)parseAllIPString:(NSString *)ipString {
-    NSArray *array = [ipString componentsSeparatedByString:@"|"];
-    if (array && array.count == 2) {
-        NSString * clientIP = array[1];
-        NSString * tmp = array[0];
-        if(tmp){
-            if (self.ipType == HttpDnsTypeDual) {
-                NSString *ipv4 = nil;
-                NSString *ipv6 = nil;
-                NSMutableDictionary *bothIPDict = [NSMutableDictionary dictionary];
-                NSArray * tmpArr = [tmp componentsSeparatedByString:@"-"];
-                if (tmpArr && [tmpArr count] == 2) {
-                    ipv4 = tmpArr[0];
-                    ipv6 = tmpArr[1];
-                }
-                if (ipv4) {
-                    NSDictionary *result = [self parseIPString:ipv4 ClientIP:clientIP use4A:false];
-                    if (result) {
-                        [bothIPDict setObject:result forKey:@"ipv4"];
-                    }
-                }
-                if (ipv6) {
-                    NSDictionary *result = [self parseIPString:ipv6 ClientIP:clientIP use4A:true];
-                    if (result) {
-                        [bothIPDict setObject:result forKey:@"ipv6"];
-                    }
-                   
-                }
-                // 当双栈解析请求中ipv4和ipv6的结果都不符合预期，就返回ni走getDomainError逻辑
-                if (bothIPDict.count == 0){
-                    return nil;
-                }
-                return bothIPDict;
-            } else {
-                BOOL use4A = false;
-                if (self.ipType == HttpDnsTypeIPv6) {
-                    use4A = true;
-                }
-                return [self parseIPString:tmp ClientIP:clientIP use4A:use4A];
-            }
+- (NSDictionary *)domainInfoFromAnswer:(const msdkdns::msdkdns_response_answer &)answer
+                                  data:(const char *)data
+                             addresses:(const std::vector<msdkdns::msdkdns_response_address> &)addresses
+                              clientIP:(NSString *)clientIP
+                          timeInterval:(double)timeInterval
+                         timeConsuming:(NSString *)timeConsuming {
+    NSMutableArray *ipsArray = [NSMutableArray arrayWithCapacity:answer.count];
+    for (uint32_t i = 0; i < answer.count; i++) {
+        NSString *ip = MSDKDnsStringFromRange(data, addresses[answer.first + i].text);
+        if (ip) {
+            [ipsArray addObject:ip];
         }
     }
-    return nil;
-}
-
--(NSDictionary *)parseIPString:(NSString *)ipString ClientIP:(NSString *)clientIP use4A:(BOOL)use4A {
-    NSString *ipsStr = nil;
-    NSString *ttl = nil;
-    NSArray * tmpArr = [ipString componentsSeparatedByString:@","];
-    if (tmpArr && [tmpArr count] == 2) {
-        ipsStr = tmpArr[0];
-        ttl = tmpArr[1];
-    }
-    NSString * tempStr = ipsStr.length > 1 ? [ipsStr substringFromIndex:ipsStr.length - 1] : @"";
-    if ([tempStr isEqualToString:@";"]) {
-        ipsStr = [ipsStr substringToIndex:ipsStr.length - 1];
-    }
-    NSArray *ipsArray = [ipsStr componentsSeparatedByString:@";"];
-    //校验ip合法性
-    BOOL isIPLegal = [self isIPLegal:ipsArray use4A:use4A];
-    
-    if (isIPLegal) {
-        double timeInterval = [[NSDate date] timeIntervalSince1970];
-        NSString * ttlExpried = [NSString stringWithFormat:@"%0.0f", (timeInterval + ttl.doubleValue * 0.75)];
-        NSString * timeConsuming = [NSString stringWithFormat:@"%d", [self dnsTimeConsuming]];
-        NSString * channel = @"http";
-        return @{kIP:ipsArray, kClientIP:clientIP, kTTL:ttl, kTTLExpired:ttlExpried, kDnsTimeConsuming:timeConsuming, kChannel:channel};
-    }
-    return nil;
+    NSString * ttl = MSDKDnsStringFromRange(data, answer.ttl_text) ?: @"";
+    NSString * ttlExpried = [NSString stringWithFormat:@"%0.0f", (timeInterval + answer.ttl * 0.75)];
+    NSString * channel = @"http";
+    return @{kIP:ipsArray, kClientIP:clientIP, kTTL:ttl, kTTLExpired:ttlExpried, kDnsTimeConsuming:timeConsuming, kChannel:channel};
 }
 
 @end
@@ -4,11 +4,16 @@
 
 #import "LocalDnsResolver.h"
 #import "MSDKDnsLog.h"
-#import <arpa/inet.h>
 #import "MSDKDnsInfoTool.h"
 #import "MSDKDnsLog.h"
 #include <netdb.h>
+#include <resolv.h>
 #include <sys/socket.h>
+#include "msdkdns_dns_stub.h"
+#include "msdkdns_ip.h"
+
+// 存根解析最多使用总超时的该比例，超时的域名还有时间回退到 getaddrinfo
+static const float kMSDKDnsStubTimeoutRatio = 0.5;
 
 @interface LocalDnsResolver ()
 
@@ -28,14 +33,16 @@
     self.isFinished = NO;
     self.isSucceed = NO;
     self.hasDelegated = NO;
-    [self getLocalDnsWithDomains:domains netStack:netStack];
+    [self getLocalDnsWithDomains:domains timeOut:timeOut netStack:netStack];
 }
 
-- (void)getLocalDnsWithDomains:(NSArray *)domains netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack {
+- (void)getLocalDnsWithDomains:(NSArray *)domains timeOut:(float)timeOut netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack {
     MSDKDNSLOG(@"getLocalDnsWithDomains: %@", domains);
     NSMutableDictionary *domainInfo = [NSMutableDictionary dictionary];
-    for(int i = 0; i < [domains count]; i++) {
-        NSString *domain = [domains objectAtIndex:i];
+    // 先向系统配置的DNS服务器并行查询整批域名，服务器不可用或查询失败的域名再逐个调用 getaddrinfo
+    NSArray *fallbackDomains = [self resolveDomains:domains timeOut:timeOut netStack:netStack domainInfo:domainInfo];
+    for(int i = 0; i < [fallbackDomains count]; i++) {
+        NSString *domain = [fallbackDomains objectAtIndex:i];
         NSArray * ipsArray = [self addressesForHostname:domain netStack:netStack];
         NSString *timeConsuming = [NSString stringWithFormat:@"%d", [self dnsTimeConsuming]];
         [domainInfo setObject:@{kIP:ipsArray, kDnsTimeConsuming:timeConsuming} forKey:domain];
@@ -56,6 +63,72 @@
     });
 }
 
+// 返回需要回退到 getaddrinfo 的域名
+- (NSArray *)resolveDomains:(NSArray *)domains timeOut:(float)timeOut netStack:(msdkdns::MSDKDNS_TLocalIPStack)netStack domainInfo:(NSMutableDictionary *)domainInfo {
+    msdkdns::DnsStub stub(arc4random());
+    struct __res_state state;
+    memset(&state, 0, sizeof(state));
+    if (res_ninit(&state) == 0) {
+        union res_sockaddr_union servers[MAXNS];
+        int count = res_getservers(&state, servers, MAXNS);
+        for (int i = 0; i < count; i++) {
+            stub.AddServer((const struct sockaddr *)&servers[i]);
+        }
+        res_ndestroy(&state);
+    }
+    if (stub.ServerCount() == 0) {
+        MSDKDNSLOG(@"LocalDns no system dns server, use getaddrinfo");
+        return domains;
+    }
+
+    std::vector<std::string> names;
+    for (NSString *domain in domains) {
+        const char *name = [domain UTF8String];
+        names.push_back(name ? name : "");
+    }
+    bool ipv4 = netStack != msdkdns::MSDKDNS_ELocalIPStack_IPv6;
+    bool ipv6 = netStack != msdkdns::MSDKDNS_ELocalIPStack_IPv4;
+    std::vector<msdkdns::msdkdns_stub_result> results;
+    std::vector<msdkdns::msdkdns_response_address> addresses;
+    if (!stub.Resolve(names, ipv4, ipv6, (int)(timeOut * 1000 * kMSDKDnsStubTimeoutRatio), &results, &addresses)) {
+        MSDKDNSLOG(@"LocalDns stub resolve failed, use getaddrinfo");
+        return domains;
+    }
+
+    NSMutableArray *fallbackDomains = [NSMutableArray array];
+    NSString *timeConsuming = [NSString stringWithFormat:@"%d", [self dnsTimeConsuming]];
+    for (size_t i = 0; i < results.size(); i++) {
+        NSString *domain = [domains objectAtIndex:i];
+        NSMutableArray *result = [NSMutableArray array];
+        NSMutableArray *result4 = [NSMutableArray array];
+        BOOL failed = NO;
+        for (int family = 0; family < msdkdns::MSDKDNS_EResponseFamily_Count; family++) {
+            uint8_t status = results[i].status[family];
+            failed = failed || status == msdkdns::MSDKDNS_EStubStatus_ServerFail || status == msdkdns::MSDKDNS_EStubStatus_Invalid ||
+                     status == msdkdns::MSDKDNS_EStubStatus_Timeout;
+            const msdkdns::msdkdns_response_answer &answer = results[i].answers[family];
+            for (uint32_t k = 0; k < answer.count; k++) {
+                const msdkdns::msdkdns_response_address &address = addresses[answer.first + k];
+                char buf[msdkdns::kMSDKDnsIPTextSize];
+                if (msdkdns::msdkdns_format_ip(address.family, address.bytes, buf)) {
+                    [(address.family == AF_INET ? result4 : result) addObject:[NSString stringWithUTF8String:buf]];
+                }
+            }
+        }
+        // NXDOMAIN、无记录与 getaddrinfo 的结果一致，直接返回；服务器拒绝、出错或超时时回退，
+        // 超时可能是服务器丢弃了 0x20 查询等存根特有的问题，交给系统解析器再试一次
+        if (failed && [result count] == 0 && [result4 count] == 0) {
+            [fallbackDomains addObject:domain];
+            continue;
+        }
+        [domainInfo setObject:@{kIP:[self getIpResult:result result4:result4], kDnsTimeConsuming:timeConsuming} forKey:domain];
+    }
+    const msdkdns::msdkdns_stub_stats &stats = stub.Stats();
+    MSDKDNSLOG(@"LocalDns stub sent:%u, retransmits:%u, mismatched:%u, truncated:%u, caseFallbacks:%u, fallback:%@",
+               stats.sent, stats.retransmits, stats.mismatched, stats.truncated, stats.case_fallbacks, fallbackDomains);
+    return fallbackDomains;
+}
+
 - (void)localDnsTimeout {
     if (!self.hasDelegated) {
         self.hasDelegated = YES;
@@ -77,10 +150,11 @@
     struct sockaddr_in * s4;
     struct sockaddr_in6 * s6;
     int retval;
-    char buf[64];
+    char buf[msdkdns::kMSDKDnsIPTextSize];
     NSMutableArray *result; //the array which will be return
     NSMutableArray *result4; //the array of IPv4, to order them at the end
-    NSString *previousIP = nil;
+    // getaddrinfo 对每种 socktype 各返回一次同一地址，按二进制地址去重
+    msdkdns::AddressSet seen;
     
     memset (&hints, 0, sizeof (struct addrinfo));
     hints.ai_flags = AI_CANONNAME;
@@ -107,32 +181,22 @@
             switch (res->ai_family){
                 case AF_INET6:
                     s6 = (struct sockaddr_in6 *)res->ai_addr;
-                    if (inet_ntop(res->ai_family, (void *)&(s6->sin6_addr), buf, sizeof(buf)) == NULL) {
-                        MSDKDNSLOG(@"inet_ntop failed for v6!\n");
-                    } else {
-                        //surprisingly every address is in double, let's add this test
-                        if ((![previousIP isEqualToString:[NSString stringWithUTF8String:buf]]) && ![result containsObject:[NSString stringWithUTF8String:buf]]) {
-                            [result addObject:[NSString stringWithUTF8String:buf]];
-                        }
+                    if (seen.Insert(AF_INET6, (const uint8_t *)&(s6->sin6_addr))) {
+                        msdkdns::msdkdns_format_ipv6((const uint8_t *)&(s6->sin6_addr), buf);
+                        [result addObject:[NSString stringWithUTF8String:buf]];
                     }
                     break;
                     
                 case AF_INET:
                     s4 = (struct sockaddr_in *)res->ai_addr;
-                    if (inet_ntop(res->ai_family, (void *)&(s4->sin_addr), buf, sizeof(buf)) == NULL) {
-                        MSDKDNSLOG(@"inet_ntop failed for v4!\n");
-                    } else {
-                        //surprisingly every address is in double, let's add this test
-                        if ((![previousIP isEqualToString:[NSString stringWithUTF8String:buf]]) && ![result4 containsObject:[NSString stringWithUTF8String:buf]]) {
-                            [result4 addObject:[NSString stringWithUTF8String:buf]];
-                        }
+                    if (seen.Insert(AF_INET, (const uint8_t *)&(s4->sin_addr))) {
+                        msdkdns::msdkdns_format_ipv4((const uint8_t *)&(s4->sin_addr), buf);
+                        [result4 addObject:[NSString stringWithUTF8String:buf]];
                     }
                     break;
                 default:
                     MSDKDNSLOG(@"Neither IPv4 nor IPv6!");
             }
-            //surprisingly every address is in double, let's add this test
-            previousIP = [NSString stringWithUTF8String:buf];
         }
         freeaddrinfo(res0);
     }
@@ -144,14 +208,9 @@
     if (result && [result count] > 0) {
         NSString* ipv6 = @"0";
         for (int i = 0; i < [result count]; i++) {
-            if (result[i] && [self isIPValid:result[i]]) {
-                NSString *regex = @"([0-9a-fA-F]{1,4}:){7,7}[0-9a-fA-F]{1,4}|([0-9a-fA-F]{1,4}:){1,7}:|([0-9a-fA-F]{1,4}:){1,6}:[0-9a-fA-F]{1,4}|([0-9a-fA-F]{1,4}:){1,5}(:[0-9a-fA-F]{1,4}){1,2}|([0-9a-fA-F]{1,4}:){1,4}(:[0-9a-fA-F]{1,4}){1,3}|([0-9a-fA-F]{1,4}:){1,3}(:[0-9a-fA-F]{1,4}){1,4}|([0-9a-fA-F]{1,4}:){1,2}(:[0-9a-fA-F]{1,4}){1,5}|[0-9a-fA-F]{1,4}:((:[0-9a-fA-F]{1,4}){1,6})|:((:[0-9a-fA-F]{1,4}){1,7}|:)|fe80:(:[0-9a-fA-F]{0,4}){0,4}%[0-9a-zA-Z]{1,}|::ffff(:0{1,4}){0,1}:((25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9])\\.){3,3}(25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9])|([0-9a-fA-F]{1,4}:){1,4}:((25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9])\\.){3,3}(25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9])";
-                NSPredicate *predicate = [NSPredicate predicateWithFormat:@"SELF MATCHES %@", regex];
-                BOOL isValid = [predicate evaluateWithObject:result[i]];
-                if (isValid) {
-                    ipv6 = result[i];
-                    break;
-                }
+            if (result[i] && [self isIPv6Valid:result[i]]) {
+                ipv6 = result[i];
+                break;
             }
         }
         if (result4 && [result4 count] > 0 && [self isIPValid:result4[0]]) {
@@ -170,14 +229,14 @@
 
 - (BOOL)isIPValid:(NSString *)ip {
     const char *utf8 = [ip UTF8String];
-    int success;
-    struct in_addr dst;
-    success = inet_pton(AF_INET, utf8, &dst);
-    if (success != 1) {
-        struct in6_addr dst6;
-        success = inet_pton(AF_INET6, utf8, &dst6);
-    }
-    return success == 1;
+    uint8_t address[16];
+    return utf8 && msdkdns::msdkdns_parse_ip(utf8, strlen(utf8), address) != 0;
+}
+
+- (BOOL)isIPv6Valid:(NSString *)ip {
+    const char *utf8 = [ip UTF8String];
+    uint8_t address[16];
+    return utf8 && msdkdns::msdkdns_parse_ipv6(utf8, strlen(utf8), address);
 }
 
 @end
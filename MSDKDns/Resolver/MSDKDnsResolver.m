@@ -4,7 +4,7 @@
 
 #import "MSDKDnsResolver.h"
 #import "MSDKDnsLog.h"
-#import <arpa/inet.h>
+#import "msdkdns_ip.h"
 #import <netdb.h>
 
 @implementation MSDKDnsResolver
@@ -26,16 +26,14 @@
     if (ipsArray && ipsArray.count > 0) {
         for (int i = 0; i < [ipsArray count]; i++) {
             NSString * ip = [ipsArray objectAtIndex:i];
-            const char *utf8 = [ip UTF8String];
-            int success = 0;
-            if (use4A) {
-                struct in6_addr dst6;
-                success = inet_pton(AF_INET6, utf8, &dst6);
-            } else {
-                struct in_addr dst;
-                success = inet_pton(AF_INET, utf8, &dst);
+            const char *utf8 = [ip isKindOfClass:[NSString class]] ? [ip UTF8String] : NULL;
+            uint8_t address[16];
+            bool success = false;
+            if (utf8) {
+                success = use4A ? msdkdns::msdkdns_parse_ipv6(utf8, strlen(utf8), address)
+                                : msdkdns::msdkdns_parse_ipv4(utf8, strlen(utf8), address);
             }
-            if (success != 1) {
+            if (!success) {
                 isIPLegal = NO;
                 break;
             }
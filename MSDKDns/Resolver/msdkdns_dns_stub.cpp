@@ -0,0 +1,760 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_dns_stub.h"
+#include "msdkdns_timer_wheel.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+namespace msdkdns {
+
+    static const size_t kHeaderSize = 12;
+    static const size_t kMaxName = 255;
+    static const size_t kMaxQueryPacket = 288;
+    // 查询不带 OPT 记录，服务端 UDP 应答不超过512字节，多余部分留给不规范的实现
+    static const size_t kMaxUdpPacket = 1232;
+    static const uint16_t kTypeA = 1;
+    static const uint16_t kTypeCNAME = 5;
+    static const uint16_t kTypeAAAA = 28;
+    static const uint16_t kClassIN = 1;
+    static const uint8_t kRcodeNXDomain = 3;
+    // CNAME 链最多跟随的层数
+    static const int kMaxCnameHops = 8;
+    // 单个名字内压缩指针的最大跳转次数，防止指针成环
+    static const int kMaxPointerJumps = 32;
+    // 单个服务器首次等待时间，每次重发翻倍，三次后放弃
+    static const int64_t kFirstAttemptMs = 600;
+    static const int kMaxAttempts = 3;
+    static const int64_t kTcpTimeoutMs = 1500;
+
+    enum {
+        kTcpNone = 0,
+        kTcpWrite = 1,
+        kTcpReadLength = 2,
+        kTcpReadBody = 3,
+    };
+
+    struct DnsStub::Query {
+        size_t index;
+        int family;
+        uint16_t id;
+        uint8_t packet[kMaxQueryPacket];
+        size_t length;
+        size_t server;
+        int attempts;
+        int64_t deadline;
+        bool done;
+        bool lower_case;  // 已因服务器不支持 0x20 改为全小写
+        int tcp_fd;
+        int tcp_stage;
+        size_t tcp_done;
+        std::vector<uint8_t> tcp_buffer;
+    };
+
+    static inline uint16_t ReadU16(const uint8_t *p) {
+        return (uint16_t)((p[0] << 8) | p[1]);
+    }
+
+    static inline uint32_t ReadU32(const uint8_t *p) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    static inline void WriteU16(uint8_t *p, uint16_t value) {
+        p[0] = (uint8_t)(value >> 8);
+        p[1] = (uint8_t)value;
+    }
+
+    static inline uint32_t XorShift(uint32_t x) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    static inline uint8_t ToLower(uint8_t c) {
+        return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+    }
+
+    // 按 RFC 4343 比较域名，不区分 ASCII 大小写
+    static bool NameEquals(const char *a, size_t a_length, const char *b, size_t b_length) {
+        if (a_length != b_length) {
+            return false;
+        }
+        for (size_t i = 0; i < a_length; i++) {
+            if (ToLower((uint8_t)a[i]) != ToLower((uint8_t)b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void SetNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, (flags < 0 ? 0 : flags) | O_NONBLOCK);
+    }
+
+    static socklen_t AddressLength(int family) {
+        return family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+    }
+
+    /*
+     * 读取（可能被压缩的）域名，转为小写的点分格式，不含末尾的.
+     * next 为名字在原位置之后的偏移
+     */
+    static bool ReadName(const uint8_t *data, size_t length, size_t offset,
+                         char *out, size_t *out_length, size_t *next) {
+        size_t pos = offset;
+        size_t used = 0;
+        bool jumped = false;
+        int jumps = 0;
+        while (true) {
+            if (pos >= length) {
+                return false;
+            }
+            uint8_t c = data[pos];
+            if (c == 0) {
+                if (!jumped) {
+                    *next = pos + 1;
+                }
+                break;
+            }
+            if ((c & 0xC0) == 0xC0) {
+                if (pos + 1 >= length || ++jumps > kMaxPointerJumps) {
+                    return false;
+                }
+                if (!jumped) {
+                    *next = pos + 2;
+                    jumped = true;
+                }
+                pos = ((size_t)(c & 0x3F) << 8) | data[pos + 1];
+                continue;
+            }
+            if ((c & 0xC0) != 0 || pos + 1 + c > length || used + c + 1 > kMaxName) {
+                return false;
+            }
+            if (used > 0) {
+                out[used++] = '.';
+            }
+            for (size_t i = 0; i < c; i++) {
+                out[used++] = (char)ToLower(data[pos + 1 + i]);
+            }
+            pos += 1 + c;
+        }
+        out[used] = '\0';
+        *out_length = used;
+        return true;
+    }
+
+    typedef struct msdkdns_dns_rr {
+        char owner[kMaxName + 1];
+        size_t owner_length;
+        uint16_t type;
+        uint16_t klass;
+        uint32_t ttl;
+        size_t rdata;
+        uint16_t rdlength;
+    } msdkdns_dns_rr;
+
+    static bool ReadRecord(const uint8_t *data, size_t length, size_t *offset, msdkdns_dns_rr *rr) {
+        size_t pos = 0;
+        if (!ReadName(data, length, *offset, rr->owner, &rr->owner_length, &pos) || pos + 10 > length) {
+            return false;
+        }
+        rr->type = ReadU16(data + pos);
+        rr->klass = ReadU16(data + pos + 2);
+        rr->ttl = ReadU32(data + pos + 4);
+        rr->rdlength = ReadU16(data + pos + 8);
+        rr->rdata = pos + 10;
+        if (rr->rdata + rr->rdlength > length) {
+            return false;
+        }
+        *offset = rr->rdata + rr->rdlength;
+        return true;
+    }
+
+    size_t msdkdns_dns_build_query(const char *domain, size_t length, uint16_t id, uint16_t qtype,
+                                   uint32_t case_seed, uint8_t *out, size_t capacity) {
+        if (length > 0 && domain[length - 1] == '.') {
+            length--;
+        }
+        // 名字编码后为 length + 2 字节，不能超过255
+        if (length == 0 || length > 253 || capacity < kHeaderSize + length + 2 + 4) {
+            return 0;
+        }
+        memset(out, 0, kHeaderSize);
+        WriteU16(out, id);
+        out[2] = 0x01;  // RD
+        WriteU16(out + 4, 1);
+        size_t label = kHeaderSize;
+        size_t pos = label + 1;
+        uint32_t bits = case_seed;
+        int used = 0;
+        for (size_t i = 0; i < length; i++) {
+            uint8_t c = (uint8_t)domain[i];
+            if (c == '.') {
+                size_t count = pos - label - 1;
+                if (count == 0 || count > 63) {
+                    return 0;
+                }
+                out[label] = (uint8_t)count;
+                label = pos++;
+                continue;
+            }
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                if (used == 32) {
+                    bits = XorShift(bits);
+                    used = 0;
+                }
+                c = ToLower(c);
+                if ((bits >> used++) & 1) {
+                    c = (uint8_t)(c - ('a' - 'A'));
+                }
+            }
+            out[pos++] = c;
+        }
+        size_t count = pos - label - 1;
+        if (count == 0 || count > 63) {
+            return 0;
+        }
+        out[label] = (uint8_t)count;
+        out[pos++] = 0;
+        WriteU16(out + pos, qtype);
+        WriteU16(out + pos + 2, kClassIN);
+        return pos + 4;
+    }
+
+    MSDKDNS_TStubParse msdkdns_dns_parse_answer(const uint8_t *data, size_t length,
+                                                const uint8_t *query, size_t query_length,
+                                                bool allow_truncated, uint8_t *rcode,
+                                                msdkdns_response_answer *answer,
+                                                std::vector<msdkdns_response_address> *addresses) {
+        if (length < kHeaderSize || query_length <= kHeaderSize + 4) {
+            return MSDKDNS_EStubParse_Malformed;
+        }
+        uint8_t flags = data[2];
+        if (data[0] != query[0] || data[1] != query[1] || !(flags & 0x80) || ((flags >> 3) & 0x0F) != 0) {
+            return MSDKDNS_EStubParse_Mismatch;
+        }
+        // 问题段按字节比较，0x20 随机化的大小写必须原样返回
+        size_t question_length = query_length - kHeaderSize;
+        if (ReadU16(data + 4) != 1 || length < kHeaderSize + question_length) {
+            return MSDKDNS_EStubParse_Mismatch;
+        }
+        if (memcmp(data + kHeaderSize, query + kHeaderSize, question_length) != 0) {
+            for (size_t i = kHeaderSize; i < query_length; i++) {
+                if (ToLower(data[i]) != ToLower(query[i])) {
+                    return MSDKDNS_EStubParse_Mismatch;
+                }
+            }
+            return MSDKDNS_EStubParse_CaseMismatch;
+        }
+        if ((flags & 0x02) && !allow_truncated) {
+            return MSDKDNS_EStubParse_Truncated;
+        }
+        *rcode = data[3] & 0x0F;
+        answer->present = false;
+        answer->ttl = 0;
+        answer->ttl_text.offset = 0;
+        answer->ttl_text.length = 0;
+        answer->first = (uint32_t)addresses->size();
+        answer->count = 0;
+        if (*rcode != 0) {
+            return MSDKDNS_EStubParse_Ok;
+        }
+
+        uint16_t qtype = ReadU16(query + query_length - 4);
+        uint16_t answer_count = ReadU16(data + 6);
+        size_t answers = kHeaderSize + question_length;
+        char target[kMaxName + 1];
+        size_t target_length = 0;
+        size_t unused = 0;
+        if (!ReadName(query, query_length, kHeaderSize, target, &target_length, &unused)) {
+            return MSDKDNS_EStubParse_Malformed;
+        }
+        msdkdns_dns_rr rr;
+        // 先沿 CNAME 链找到最终的名字，应答中记录的顺序不作要求
+        for (int hop = 0; hop <= kMaxCnameHops; hop++) {
+            bool followed = false;
+            size_t offset = answers;
+            for (uint16_t i = 0; i < answer_count; i++) {
+                if (!ReadRecord(data, length, &offset, &rr)) {
+                    return MSDKDNS_EStubParse_Malformed;
+                }
+                if (rr.type == kTypeCNAME && rr.klass == kClassIN &&
+                    NameEquals(rr.owner, rr.owner_length, target, target_length)) {
+                    if (!ReadName(data, rr.rdata + rr.rdlength, rr.rdata, target, &target_length, &unused)) {
+                        return MSDKDNS_EStubParse_Malformed;
+                    }
+                    followed = true;
+                    break;
+                }
+            }
+            if (!followed) {
+                break;
+            }
+        }
+        size_t offset = answers;
+        for (uint16_t i = 0; i < answer_count; i++) {
+            if (!ReadRecord(data, length, &offset, &rr)) {
+                addresses->resize(answer->first);
+                return MSDKDNS_EStubParse_Malformed;
+            }
+            if (rr.type != qtype || rr.klass != kClassIN || !NameEquals(rr.owner, rr.owner_length, target, target_length)) {
+                continue;
+            }
+            size_t size = qtype == kTypeA ? 4 : 16;
+            if (rr.rdlength != size) {
+                continue;
+            }
+            msdkdns_response_address address;
+            memset(&address, 0, sizeof(address));
+            address.family = qtype == kTypeA ? AF_INET : AF_INET6;
+            memcpy(address.bytes, data + rr.rdata, size);
+            addresses->push_back(address);
+            answer->ttl = (answer->count == 0 || rr.ttl < answer->ttl) ? rr.ttl : answer->ttl;
+            answer->count++;
+        }
+        answer->present = answer->count > 0;
+        return MSDKDNS_EStubParse_Ok;
+    }
+
+    DnsStub::DnsStub(uint32_t seed)
+        : server_count_(0), random_(seed ? seed : 0x9E3779B9u), results_(NULL), addresses_(NULL), pending_(0) {
+        memset(servers_, 0, sizeof(servers_));
+        memset(&stats_, 0, sizeof(stats_));
+        sockets_[0] = -1;
+        sockets_[1] = -1;
+    }
+
+    DnsStub::~DnsStub() {
+        for (int i = 0; i < 2; i++) {
+            if (sockets_[i] >= 0) {
+                close(sockets_[i]);
+            }
+        }
+    }
+
+    bool DnsStub::AddServer(const struct sockaddr *addr) {
+        if (!addr || server_count_ >= kMaxServers || (addr->sa_family != AF_INET && addr->sa_family != AF_INET6)) {
+            return false;
+        }
+        struct sockaddr_storage &server = servers_[server_count_++];
+        memset(&server, 0, sizeof(server));
+        memcpy(&server, addr, AddressLength(addr->sa_family));
+        if (addr->sa_family == AF_INET) {
+            struct sockaddr_in *sin = (struct sockaddr_in *)&server;
+            if (sin->sin_port == 0) {
+                sin->sin_port = htons(53);
+            }
+        } else {
+            struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&server;
+            if (sin6->sin6_port == 0) {
+                sin6->sin6_port = htons(53);
+            }
+        }
+        return true;
+    }
+
+    size_t DnsStub::ServerCount() const {
+        return server_count_;
+    }
+
+    const msdkdns_stub_stats &DnsStub::Stats() const {
+        return stats_;
+    }
+
+    uint32_t DnsStub::NextRandom() {
+        random_ = XorShift(random_);
+        return random_;
+    }
+
+    uint16_t DnsStub::UniqueId() {
+        while (true) {
+            uint16_t id = (uint16_t)NextRandom();
+            bool unique = true;
+            for (size_t i = 0; i < queries_.size() && unique; i++) {
+                unique = queries_[i].id != id;
+            }
+            if (unique) {
+                return id;
+            }
+        }
+    }
+
+    int DnsStub::Socket(int family) {
+        int slot = family == AF_INET6 ? 1 : 0;
+        if (sockets_[slot] < 0) {
+            // 源端口由系统随机分配
+            int fd = socket(family, SOCK_DGRAM, 0);
+            if (fd < 0) {
+                return -1;
+            }
+            SetNonBlocking(fd);
+            sockets_[slot] = fd;
+        }
+        return sockets_[slot];
+    }
+
+    int DnsStub::MatchServer(const struct sockaddr_storage *from) const {
+        for (size_t i = 0; i < server_count_; i++) {
+            const struct sockaddr_storage &server = servers_[i];
+            if (server.ss_family != from->ss_family) {
+                continue;
+            }
+            if (from->ss_family == AF_INET) {
+                const struct sockaddr_in *a = (const struct sockaddr_in *)&server;
+                const struct sockaddr_in *b = (const struct sockaddr_in *)from;
+                if (a->sin_port == b->sin_port && a->sin_addr.s_addr == b->sin_addr.s_addr) {
+                    return (int)i;
+                }
+            } else {
+                const struct sockaddr_in6 *a = (const struct sockaddr_in6 *)&server;
+                const struct sockaddr_in6 *b = (const struct sockaddr_in6 *)from;
+                if (a->sin6_port == b->sin6_port && memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0) {
+                    return (int)i;
+                }
+            }
+        }
+        return -1;
+    }
+
+    bool DnsStub::Send(Query *query, int64_t now, int64_t deadline) {
+        const struct sockaddr_storage &server = servers_[query->server];
+        int fd = Socket(server.ss_family);
+        if (query->attempts > 0) {
+            stats_.retransmits++;
+        }
+        query->attempts++;
+        if (fd < 0) {
+            return false;
+        }
+        stats_.sent++;
+        ssize_t n = sendto(fd, query->packet, query->length, 0, (const struct sockaddr *)&server,
+                           AddressLength(server.ss_family));
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+            // 如 IPv6 服务器不可达，立即换下一个服务器
+            return false;
+        }
+        int64_t wait = kFirstAttemptMs << (query->attempts - 1);
+        query->deadline = now + wait < deadline ? now + wait : deadline;
+        return true;
+    }
+
+    void DnsStub::Finish(Query *query, uint8_t status) {
+        if (query->done) {
+            return;
+        }
+        query->done = true;
+        pending_--;
+        (*results_)[query->index].status[query->family] = status;
+        if (query->tcp_fd >= 0) {
+            close(query->tcp_fd);
+            query->tcp_fd = -1;
+        }
+    }
+
+    bool DnsStub::StartTcp(Query *query, int64_t now, int64_t deadline) {
+        const struct sockaddr_storage &server = servers_[query->server];
+        int fd = socket(server.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        SetNonBlocking(fd);
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        if (connect(fd, (const struct sockaddr *)&server, AddressLength(server.ss_family)) < 0 && errno != EINPROGRESS) {
+            close(fd);
+            return false;
+        }
+        query->tcp_fd = fd;
+        query->tcp_stage = kTcpWrite;
+        query->tcp_done = 0;
+        query->tcp_buffer.resize(query->length + 2);
+        WriteU16(&query->tcp_buffer[0], (uint16_t)query->length);
+        memcpy(&query->tcp_buffer[2], query->packet, query->length);
+        query->deadline = now + kTcpTimeoutMs < deadline ? now + kTcpTimeoutMs : deadline;
+        return true;
+    }
+
+    void DnsStub::PollTcp(Query *query, short revents, int64_t now) {
+#ifdef MSG_NOSIGNAL
+        const int send_flags = MSG_NOSIGNAL;
+#else
+        const int send_flags = 0;
+#endif
+        if (query->tcp_stage == kTcpWrite && (revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            Finish(query, MSDKDNS_EStubStatus_ServerFail);
+            return;
+        }
+        while (!query->done) {
+            size_t remain = query->tcp_buffer.size() - query->tcp_done;
+            ssize_t n;
+            if (query->tcp_stage == kTcpWrite) {
+                n = send(query->tcp_fd, &query->tcp_buffer[query->tcp_done], remain, send_flags);
+            } else {
+                n = recv(query->tcp_fd, &query->tcp_buffer[query->tcp_done], remain, 0);
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == EINPROGRESS)) {
+                return;
+            }
+            if (n <= 0) {
+                Finish(query, MSDKDNS_EStubStatus_ServerFail);
+                return;
+            }
+            query->tcp_done += (size_t)n;
+            if (query->tcp_done < query->tcp_buffer.size()) {
+                continue;
+            }
+            query->tcp_done = 0;
+            if (query->tcp_stage == kTcpWrite) {
+                query->tcp_stage = kTcpReadLength;
+                query->tcp_buffer.resize(2);
+            } else if (query->tcp_stage == kTcpReadLength) {
+                uint16_t size = ReadU16(&query->tcp_buffer[0]);
+                if (size < kHeaderSize) {
+                    Finish(query, MSDKDNS_EStubStatus_ServerFail);
+                    return;
+                }
+                query->tcp_stage = kTcpReadBody;
+                query->tcp_buffer.resize(size);
+            } else {
+                Complete(query, &query->tcp_buffer[0], query->tcp_buffer.size(), true, query->server, now, query->deadline);
+                return;
+            }
+        }
+    }
+
+    void DnsStub::Complete(Query *query, const uint8_t *data, size_t length, bool tcp, size_t server,
+                           int64_t now, int64_t deadline) {
+        uint8_t rcode = 0;
+        msdkdns_response_answer answer;
+        MSDKDNS_TStubParse parsed = msdkdns_dns_parse_answer(data, length, query->packet, query->length, tcp,
+                                                             &rcode, &answer, addresses_);
+        if (parsed == MSDKDNS_EStubParse_Mismatch || parsed == MSDKDNS_EStubParse_Malformed) {
+            // UDP 上可能是伪造或过期的应答，忽略后继续等待；TCP 连接上则直接失败
+            stats_.mismatched++;
+            if (tcp) {
+                Finish(query, MSDKDNS_EStubStatus_ServerFail);
+            }
+            return;
+        }
+        if (parsed == MSDKDNS_EStubParse_CaseMismatch) {
+            // ID 和来源都正确，只是大小写被改写，说明服务器不支持 0x20，不用等到超时
+            // 换新 ID 以全小写立即重发，之后只接受与全小写问题段一致的应答
+            if (tcp || query->lower_case) {
+                Finish(query, MSDKDNS_EStubStatus_ServerFail);
+                return;
+            }
+            stats_.case_fallbacks++;
+            query->lower_case = true;
+            query->id = UniqueId();
+            WriteU16(query->packet, query->id);
+            for (size_t i = kHeaderSize; i < query->length - 4; i++) {
+                query->packet[i] = ToLower(query->packet[i]);
+            }
+            query->server = server;
+            query->attempts = 0;
+            if (!Send(query, now, deadline)) {
+                Finish(query, MSDKDNS_EStubStatus_ServerFail);
+            }
+            return;
+        }
+        if (parsed == MSDKDNS_EStubParse_Truncated) {
+            stats_.truncated++;
+            query->server = server;
+            if (!StartTcp(query, now, deadline)) {
+                Finish(query, MSDKDNS_EStubStatus_ServerFail);
+            }
+            return;
+        }
+        if (rcode == 0) {
+            (*results_)[query->index].answers[query->family] = answer;
+            Finish(query, MSDKDNS_EStubStatus_Answered);
+        } else if (rcode == kRcodeNXDomain) {
+            Finish(query, MSDKDNS_EStubStatus_NXDomain);
+        } else if (tcp || server_count_ == 1 || query->attempts >= kMaxAttempts) {
+            Finish(query, MSDKDNS_EStubStatus_ServerFail);
+        } else {
+            // SERVFAIL/REFUSED 立即换下一个服务器重发
+            query->server = (server + 1) % server_count_;
+            if (!Send(query, now, deadline)) {
+                Finish(query, MSDKDNS_EStubStatus_ServerFail);
+            }
+        }
+    }
+
+    void DnsStub::Receive(int fd, int64_t now, int64_t deadline) {
+        uint8_t buffer[kMaxUdpPacket];
+        while (pending_ > 0) {
+            struct sockaddr_storage from;
+            socklen_t from_length = sizeof(from);
+            ssize_t n = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &from_length);
+            if (n < 0) {
+                return;
+            }
+            stats_.received++;
+            int server = MatchServer(&from);
+            if (server < 0 || n < 2) {
+                stats_.mismatched++;
+                continue;
+            }
+            uint16_t id = ReadU16(buffer);
+            Query *query = NULL;
+            for (size_t i = 0; i < queries_.size(); i++) {
+                if (queries_[i].id == id && !queries_[i].done && queries_[i].tcp_fd < 0) {
+                    query = &queries_[i];
+                    break;
+                }
+            }
+            if (!query) {
+                stats_.mismatched++;
+                continue;
+            }
+            Complete(query, buffer, (size_t)n, false, (size_t)server, now, deadline);
+        }
+    }
+
+    bool DnsStub::Resolve(const std::vector<std::string> &domains, bool ipv4, bool ipv6, int timeout_ms,
+                          std::vector<msdkdns_stub_result> *results,
+                          std::vector<msdkdns_response_address> *addresses) {
+        msdkdns_stub_result empty;
+        memset(&empty, 0, sizeof(empty));
+        results->assign(domains.size(), empty);
+        if (server_count_ == 0) {
+            return false;
+        }
+        results_ = results;
+        addresses_ = addresses;
+        pending_ = 0;
+        queries_.clear();
+        queries_.reserve(domains.size() * 2);
+
+        for (size_t i = 0; i < domains.size(); i++) {
+            for (int family = 0; family < MSDKDNS_EResponseFamily_Count; family++) {
+                if ((family == MSDKDNS_EResponseFamily_IPv4 && !ipv4) || (family == MSDKDNS_EResponseFamily_IPv6 && !ipv6)) {
+                    continue;
+                }
+                Query query;
+                query.index = i;
+                query.family = family;
+                query.server = 0;
+                query.attempts = 0;
+                query.deadline = 0;
+                query.done = false;
+                query.lower_case = false;
+                query.tcp_fd = -1;
+                query.tcp_stage = kTcpNone;
+                query.tcp_done = 0;
+                // 批内 ID 不重复，应答按 ID 找到对应的查询
+                query.id = UniqueId();
+                uint16_t qtype = family == MSDKDNS_EResponseFamily_IPv4 ? kTypeA : kTypeAAAA;
+                query.length = msdkdns_dns_build_query(domains[i].c_str(), domains[i].size(), query.id, qtype,
+                                                       NextRandom(), query.packet, sizeof(query.packet));
+                if (query.length == 0) {
+                    (*results)[i].status[family] = MSDKDNS_EStubStatus_Invalid;
+                    continue;
+                }
+                queries_.push_back(query);
+                pending_++;
+            }
+        }
+
+        int64_t now = msdkdns_monotonic_ms();
+        int64_t deadline = now + (timeout_ms > 0 ? timeout_ms : 0);
+        for (size_t i = 0; i < queries_.size(); i++) {
+            Query *query = &queries_[i];
+            while (!Send(query, now, deadline)) {
+                if (query->attempts >= kMaxAttempts) {
+                    Finish(query, MSDKDNS_EStubStatus_ServerFail);
+                    break;
+                }
+                query->server = (query->server + 1) % server_count_;
+            }
+        }
+        if (!queries_.empty() && sockets_[0] < 0 && sockets_[1] < 0) {
+            results_ = NULL;
+            addresses_ = NULL;
+            return false;
+        }
+
+        std::vector<struct pollfd> fds;
+        std::vector<Query *> owners;
+        while (pending_ > 0) {
+            now = msdkdns_monotonic_ms();
+            int64_t next = deadline;
+            for (size_t i = 0; i < queries_.size(); i++) {
+                Query *query = &queries_[i];
+                if (query->done) {
+                    continue;
+                }
+                if (query->deadline <= now) {
+                    // 超时后轮换下一个服务器重发，TCP 查询不再重试
+                    bool resent = false;
+                    while (query->tcp_fd < 0 && now < deadline && query->attempts < kMaxAttempts && !resent) {
+                        query->server = (query->server + 1) % server_count_;
+                        resent = Send(query, now, deadline);
+                    }
+                    if (!resent) {
+                        Finish(query, MSDKDNS_EStubStatus_Timeout);
+                        continue;
+                    }
+                }
+                next = query->deadline < next ? query->deadline : next;
+            }
+            if (pending_ == 0) {
+                break;
+            }
+
+            fds.clear();
+            owners.clear();
+            for (int i = 0; i < 2; i++) {
+                if (sockets_[i] >= 0) {
+                    struct pollfd pfd = { sockets_[i], POLLIN, 0 };
+                    fds.push_back(pfd);
+                    owners.push_back(NULL);
+                }
+            }
+            for (size_t i = 0; i < queries_.size(); i++) {
+                Query *query = &queries_[i];
+                if (!query->done && query->tcp_fd >= 0) {
+                    struct pollfd pfd = { query->tcp_fd, (short)(query->tcp_stage == kTcpWrite ? POLLOUT : POLLIN), 0 };
+                    fds.push_back(pfd);
+                    owners.push_back(query);
+                }
+            }
+            int wait = (int)(next > now ? next - now : 0);
+            int ready = poll(&fds[0], (nfds_t)fds.size(), wait);
+            if (ready < 0 && errno != EINTR) {
+                break;
+            }
+            if (ready <= 0) {
+                continue;
+            }
+            now = msdkdns_monotonic_ms();
+            for (size_t i = 0; i < fds.size(); i++) {
+                if (fds[i].revents == 0) {
+                    continue;
+                }
+                if (!owners[i]) {
+                    Receive(fds[i].fd, now, deadline);
+                } else if (!owners[i]->done) {
+                    PollTcp(owners[i], fds[i].revents, now);
+                }
+            }
+        }
+        for (size_t i = 0; i < queries_.size(); i++) {
+            Finish(&queries_[i], MSDKDNS_EStubStatus_Timeout);
+        }
+        queries_.clear();
+        results_ = NULL;
+        addresses_ = NULL;
+        return true;
+    }
+}  // namespace msdkdns
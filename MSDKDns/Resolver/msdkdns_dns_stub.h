@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_RESOLVER_MSDKDNS_DNS_STUB_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_RESOLVER_MSDKDNS_DNS_STUB_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include "msdkdns_response_parser.h"
+
+namespace msdkdns {
+
+    /*
+     * 本地 DNS 存根解析器（RFC 1035），用于替代逐个域名串行调用 getaddrinfo
+     * 一批域名的 A/AAAA 查询全部在同一个 UDP socket 上发出，一次 poll 等待所有应答
+     * 每个查询使用随机 ID 及 0x20 大小写随机化，应答的 ID、来源地址及问题段需完全一致才接受
+     * 服务器不保留问题段大小写时（只有大小写不同），该查询换新 ID 以全小写重发，不再使用 0x20
+     * 应答被截断(TC)时改用 TCP 重新查询；每个查询有独立的超时，超时后轮换下一个服务器重发
+     */
+    enum MSDKDNS_TStubStatus {
+        MSDKDNS_EStubStatus_Pending = 0,
+        MSDKDNS_EStubStatus_Answered = 1,    // NOERROR，可能没有该类型的地址
+        MSDKDNS_EStubStatus_NXDomain = 2,
+        MSDKDNS_EStubStatus_ServerFail = 3,  // SERVFAIL/REFUSED 等，或 TCP 重试失败
+        MSDKDNS_EStubStatus_Timeout = 4,
+        MSDKDNS_EStubStatus_Invalid = 5,     // 域名不合法，未发出查询
+    };
+
+    enum MSDKDNS_TStubParse {
+        MSDKDNS_EStubParse_Ok = 0,
+        MSDKDNS_EStubParse_Mismatch = 1,   // ID、问题段不一致或不是应答，丢弃后继续等待
+        MSDKDNS_EStubParse_Truncated = 2,
+        MSDKDNS_EStubParse_Malformed = 3,
+        MSDKDNS_EStubParse_CaseMismatch = 4,  // 问题段只有大小写不同，服务器不支持 0x20
+    };
+
+    typedef struct msdkdns_stub_result {
+        uint8_t status[MSDKDNS_EResponseFamily_Count];
+        // 与 HTTPDNS 解析结果相同的结构，ttl 取所有地址记录的最小值，地址的 text 字段不使用
+        msdkdns_response_answer answers[MSDKDNS_EResponseFamily_Count];
+    } msdkdns_stub_result;
+
+    typedef struct msdkdns_stub_stats {
+        uint32_t sent;
+        uint32_t retransmits;
+        uint32_t received;
+        uint32_t mismatched;
+        uint32_t truncated;
+        uint32_t case_fallbacks;  // 因服务器不保留大小写而以全小写重发的查询数
+    } msdkdns_stub_stats;
+
+    /*
+     * 构造查询报文，字母的大小写按 case_seed 随机化，开启 RD
+     * 域名可带末尾的.，标签为空、超过63字节或总长超过253字节时返回0
+     */
+    size_t msdkdns_dns_build_query(const char *domain, size_t length, uint16_t id, uint16_t qtype,
+                                   uint32_t case_seed, uint8_t *out, size_t capacity);
+
+    /*
+     * 解析 query 对应的应答，问题段按字节比较（含大小写），跟随 CNAME 链收集 qtype 的地址记录
+     * 记录的所有者名按 RFC 4343 不区分 ASCII 大小写比较
+     * allow_truncated 为 false 时 TC 置位的应答返回 Truncated，不解析其中的记录
+     * 返回 Ok 时 rcode 有效，rcode 为0时地址追加到 addresses 并填写 answer
+     */
+    MSDKDNS_TStubParse msdkdns_dns_parse_answer(const uint8_t *data, size_t length,
+                                                const uint8_t *query, size_t query_length,
+                                                bool allow_truncated, uint8_t *rcode,
+                                                msdkdns_response_answer *answer,
+                                                std::vector<msdkdns_response_address> *addresses);
+
+    class DnsStub {
+    public:
+        explicit DnsStub(uint32_t seed);
+        ~DnsStub();
+
+        // 端口为0时使用53，最多 kMaxServers 个，超出或地址族不支持时返回 false
+        bool AddServer(const struct sockaddr *addr);
+        size_t ServerCount() const;
+
+        /*
+         * 阻塞直到所有查询完成或 timeout_ms 耗尽，results 与 domains 一一对应
+         * 未请求的地址族状态为 Pending；没有可用服务器或创建 socket 失败时返回 false
+         */
+        bool Resolve(const std::vector<std::string> &domains, bool ipv4, bool ipv6, int timeout_ms,
+                     std::vector<msdkdns_stub_result> *results,
+                     std::vector<msdkdns_response_address> *addresses);
+
+        const msdkdns_stub_stats &Stats() const;
+
+        static const size_t kMaxServers = 3;
+
+    private:
+        struct Query;
+
+        uint32_t NextRandom();
+        // 批内未使用的查询 ID
+        uint16_t UniqueId();
+        int Socket(int family);
+        bool Send(Query *query, int64_t now, int64_t deadline);
+        bool StartTcp(Query *query, int64_t now, int64_t deadline);
+        void PollTcp(Query *query, short revents, int64_t now);
+        void Complete(Query *query, const uint8_t *data, size_t length, bool tcp, size_t server, int64_t now, int64_t deadline);
+        void Finish(Query *query, uint8_t status);
+        int MatchServer(const struct sockaddr_storage *from) const;
+        void Receive(int fd, int64_t now, int64_t deadline);
+
+        struct sockaddr_storage servers_[kMaxServers];
+        size_t server_count_;
+        int sockets_[2];  // AF_INET / AF_INET6
+        uint32_t random_;
+        std::vector<Query> queries_;
+        std::vector<msdkdns_stub_result> *results_;
+        std::vector<msdkdns_response_address> *addresses_;
+        size_t pending_;
+        msdkdns_stub_stats stats_;
+
+        DnsStub(const DnsStub &);
+        DnsStub &operator=(const DnsStub &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_RESOLVER_MSDKDNS_DNS_STUB_H_
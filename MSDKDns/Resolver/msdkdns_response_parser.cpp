@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_response_parser.h"
+#include "msdkdns_ip.h"
+#include <math.h>
+#include <string.h>
+#include <sys/socket.h>
+
+namespace msdkdns {
+
+    static const char *msdkdns_find(const char *begin, const char *end, char c) {
+        const void *found = memchr(begin, c, end - begin);
+        return found ? static_cast<const char *>(found) : end;
+    }
+
+    static size_t msdkdns_count(const char *begin, const char *end, char c) {
+        size_t count = 0;
+        for (const char *p = begin; p < end; p++) {
+            if (*p == c) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    static msdkdns_text_range msdkdns_make_range(const char *base, const char *begin, const char *end) {
+        msdkdns_text_range range;
+        range.offset = (uint32_t)(begin - base);
+        range.length = (uint32_t)(end - begin);
+        return range;
+    }
+
+    static bool msdkdns_is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // 与 NSString doubleValue 行为一致：跳过开头的空白，取最长的 [+-]digits[.digits][e[+-]digits] 前缀，无数字时为0
+    static double msdkdns_parse_ttl(const char *begin, const char *end) {
+        const char *p = begin;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f')) {
+            p++;
+        }
+        bool negative = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negative = (*p == '-');
+            p++;
+        }
+        double value = 0;
+        int scale = 0;
+        bool digits = false;
+        for (; p < end && msdkdns_is_digit(*p); p++) {
+            value = value * 10 + (*p - '0');
+            digits = true;
+        }
+        if (p < end && *p == '.') {
+            for (p++; p < end && msdkdns_is_digit(*p); p++) {
+                value = value * 10 + (*p - '0');
+                scale--;
+                digits = true;
+            }
+        }
+        if (!digits) {
+            return 0;
+        }
+        // 指数部分不完整时不计入，与 strtod 相同
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            const char *q = p + 1;
+            bool exponent_negative = false;
+            if (q < end && (*q == '+' || *q == '-')) {
+                exponent_negative = (*q == '-');
+                q++;
+            }
+            if (q < end && msdkdns_is_digit(*q)) {
+                int exponent = 0;
+                for (; q < end && msdkdns_is_digit(*q); q++) {
+                    if (exponent < 10000) {
+                        exponent = exponent * 10 + (*q - '0');
+                    }
+                }
+                scale += exponent_negative ? -exponent : exponent;
+            }
+        }
+        if (scale != 0 && value != 0) {
+            value = scale > 0 ? value * pow(10.0, scale) : value / pow(10.0, -scale);
+        }
+        return negative ? -value : value;
+    }
+
+    static bool msdkdns_parse_address(const char *begin, const char *end, bool use_ipv6, msdkdns_response_address *address) {
+        memset(address->bytes, 0, sizeof(address->bytes));
+        if (use_ipv6) {
+            address->family = AF_INET6;
+            return msdkdns_parse_ipv6(begin, end - begin, address->bytes);
+        }
+        address->family = AF_INET;
+        return msdkdns_parse_ipv4(begin, end - begin, address->bytes);
+    }
+
+    // 解析 ip;ip,ttl，任意一个ip不合法则整段无效
+    static bool msdkdns_parse_answer(const char *base, const char *begin, const char *end, bool use_ipv6,
+                                     msdkdns_response_answer *answer,
+                                     std::vector<msdkdns_response_address> *addresses) {
+        answer->present = false;
+        if (msdkdns_count(begin, end, ',') != 1) {
+            return false;
+        }
+        const char *comma = msdkdns_find(begin, end, ',');
+        const char *ips_end = comma;
+        if (ips_end - begin > 1 && *(ips_end - 1) == ';') {
+            ips_end--;
+        }
+        size_t rollback = addresses->size();
+        const char *p = begin;
+        while (true) {
+            const char *ip_end = msdkdns_find(p, ips_end, ';');
+            msdkdns_response_address address;
+            if (!msdkdns_parse_address(p, ip_end, use_ipv6, &address)) {
+                addresses->resize(rollback);
+                return false;
+            }
+            address.text = msdkdns_make_range(base, p, ip_end);
+            addresses->push_back(address);
+            if (ip_end == ips_end) {
+                break;
+            }
+            p = ip_end + 1;
+        }
+        answer->present = true;
+        answer->ttl = msdkdns_parse_ttl(comma + 1, end);
+        answer->ttl_text = msdkdns_make_range(base, comma + 1, end);
+        answer->first = (uint32_t)rollback;
+        answer->count = (uint32_t)(addresses->size() - rollback);
+        return true;
+    }
+
+    static bool msdkdns_parse_line(const char *base, const char *begin, const char *end, MSDKDNS_TResponseMode mode,
+                                   msdkdns_response_record *record,
+                                   std::vector<msdkdns_response_address> *addresses) {
+        const char *colon = msdkdns_find(begin, end, ':');
+        if (colon == end) {
+            return false;
+        }
+        const char *domain_end = colon;
+        if (domain_end > begin && *(domain_end - 1) == '.') {
+            domain_end--;
+        }
+        if (domain_end == begin) {
+            return false;
+        }
+        const char *content = colon + 1;
+        if (msdkdns_count(content, end, '|') != 1) {
+            return false;
+        }
+        const char *bar = msdkdns_find(content, end, '|');
+        record->domain = msdkdns_make_range(base, begin, domain_end);
+        record->client_ip = msdkdns_make_range(base, bar + 1, end);
+        record->answers[MSDKDNS_EResponseFamily_IPv4].present = false;
+        record->answers[MSDKDNS_EResponseFamily_IPv6].present = false;
+
+        if (mode == MSDKDNS_EResponseMode_Dual) {
+            if (msdkdns_count(content, bar, '-') != 1) {
+                return false;
+            }
+            const char *dash = msdkdns_find(content, bar, '-');
+            bool has_ipv4 = msdkdns_parse_answer(base, content, dash, false,
+                                                 &record->answers[MSDKDNS_EResponseFamily_IPv4], addresses);
+            bool has_ipv6 = msdkdns_parse_answer(base, dash + 1, bar, true,
+                                                 &record->answers[MSDKDNS_EResponseFamily_IPv6], addresses);
+            // ipv4和ipv6的结果都不符合预期时丢弃该记录
+            return has_ipv4 || has_ipv6;
+        }
+        bool use_ipv6 = (mode == MSDKDNS_EResponseMode_IPv6);
+        int family = use_ipv6 ? MSDKDNS_EResponseFamily_IPv6 : MSDKDNS_EResponseFamily_IPv4;
+        return msdkdns_parse_answer(base, content, bar, use_ipv6, &record->answers[family], addresses);
+    }
+
+    size_t msdkdns_parse_response(const char *data, size_t length, MSDKDNS_TResponseMode mode,
+                                  std::vector<msdkdns_response_record> *records,
+                                  std::vector<msdkdns_response_address> *addresses) {
+        if (!data || !records || !addresses) {
+            return 0;
+        }
+        size_t parsed = 0;
+        const char *end = data + length;
+        const char *line = data;
+        while (line < end) {
+            const char *line_end = msdkdns_find(line, end, '\n');
+            msdkdns_response_record record;
+            size_t rollback = addresses->size();
+            if (msdkdns_parse_line(data, line, line_end, mode, &record, addresses)) {
+                records->push_back(record);
+                parsed++;
+            } else {
+                addresses->resize(rollback);
+            }
+            line = line_end + 1;
+        }
+        return parsed;
+    }
+}  // namespace msdkdns
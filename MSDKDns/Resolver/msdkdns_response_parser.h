@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_RESOLVER_MSDKDNS_RESPONSE_PARSER_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_RESOLVER_MSDKDNS_RESPONSE_PARSER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace msdkdns {
+
+    /*
+     * HTTPDNS 解析结果格式（解密后，每行一个域名）：
+     *   单栈: domain.:ip;ip,ttl|clientip
+     *   双栈: domain.:ip;ip,ttl-ip6;ip6,ttl|clientip
+     * 单次扫描完成解析，不拷贝输入，结果中的文本字段以偏移和长度引用原始输入
+     */
+    enum MSDKDNS_TResponseMode {
+        MSDKDNS_EResponseMode_IPv4 = 0,
+        MSDKDNS_EResponseMode_IPv6 = 1,
+        MSDKDNS_EResponseMode_Dual = 2,
+    };
+
+    enum MSDKDNS_TResponseFamily {
+        MSDKDNS_EResponseFamily_IPv4 = 0,
+        MSDKDNS_EResponseFamily_IPv6 = 1,
+        MSDKDNS_EResponseFamily_Count = 2,
+    };
+
+    typedef struct msdkdns_text_range {
+        uint32_t offset;
+        uint32_t length;
+    } msdkdns_text_range;
+
+    typedef struct msdkdns_response_address {
+        uint8_t family;  // AF_INET / AF_INET6
+        uint8_t bytes[16];
+        msdkdns_text_range text;
+    } msdkdns_response_address;
+
+    typedef struct msdkdns_response_answer {
+        bool present;
+        double ttl;  // 按 NSString doubleValue 的规则解析 ttl_text
+        msdkdns_text_range ttl_text;
+        uint32_t first;  // 在地址数组中的起始下标
+        uint32_t count;
+    } msdkdns_response_answer;
+
+    typedef struct msdkdns_response_record {
+        msdkdns_text_range domain;  // 已去除末尾的.
+        msdkdns_text_range client_ip;
+        msdkdns_response_answer answers[MSDKDNS_EResponseFamily_Count];
+    } msdkdns_response_record;
+
+    /*
+     * 解析整段响应，格式不合法的行直接跳过，与原有逐行解析逻辑保持一致
+     * 返回解析成功的记录数
+     */
+    size_t msdkdns_parse_response(const char *data, size_t length, MSDKDNS_TResponseMode mode,
+                                  std::vector<msdkdns_response_record> *records,
+                                  std::vector<msdkdns_response_address> *addresses);
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_RESOLVER_MSDKDNS_RESPONSE_PARSER_H_
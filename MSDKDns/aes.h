@@ -12,6 +12,7 @@
 /*************************** HEADER FILES ***************************/
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string>
 
 namespace self_dns {
@@ -24,6 +25,17 @@ namespace self_dns {
 #define AES_ENCRYPT 0
 #define AES_DECRYPT 1
 #define AES_KEY_SIZE 128
+#define AES_MAX_KEY_SCHEDULE_WORDS 60  // 4 * (14 + 1) words for AES-256
+
+// AesEncrypt/AesDecrypt pick a backend at run time: ARMv8 Crypto Extensions
+// (AESE/AESD) or AES-NI when the CPU has them, 32-bit T-tables otherwise.
+// Define AES_USE_REFERENCE_IMPL to build only the byte-oriented reference
+// implementation.
+#define AES_BACKEND_REFERENCE 0
+#define AES_BACKEND_TTABLE 1
+#define AES_BACKEND_AESNI 2
+#define AES_BACKEND_ARMV8 3
+#define AES_BACKEND_COUNT 4
 
 /**************************** DATA TYPES ****************************/
 typedef unsigned char BYTE;  // 8-bit byte
@@ -48,6 +60,28 @@ void AesDecrypt(const BYTE *in,   // 16 bytes of ciphertext
                 const WORD *key,  // From the key setup
                 int keysize);     // Bit length of the key, 128, 192, or 256
 
+// Derives the decryption key schedule from the one produced by AesKeySetup().
+void AesKeySetupDecrypt(const WORD *key,  // From the key setup
+                        WORD *dec_key,    // Output, AES_MAX_KEY_SCHEDULE_WORDS
+                        int keysize);     // Bit length of the key
+
+void AesDecryptWithDecKey(const BYTE *in,       // 16 bytes of ciphertext
+                          BYTE *out,            // 16 bytes of plaintext
+                          const WORD *dec_key,  // From AesKeySetupDecrypt
+                          int keysize);         // Bit length of the key
+
+// The backend in use.
+int AesBackend();
+
+// Returns TRUE if this build and CPU can run "backend".
+int AesBackendSupported(int backend);
+
+// Switches all callers to "backend", for tests and benchmarks. Returns FALSE
+// and keeps the current one if it is not supported.
+int AesSetBackend(int backend);
+
+const char *AesBackendName(int backend);
+
 ///////////////////
 // AES - CBC
 ///////////////////
@@ -71,6 +105,75 @@ int AesEncryptCbcMac(const BYTE *in,   // plaintext
                      int keysize,      // Bit length of key, 128, 192, or 256
                      const BYTE *iv);  // IV, must be AES_BLOCK_SIZE bytes long
 
+///////////////////
+// AES - CBC context (PKCS#7)
+///////////////////
+// Holds the encryption and decryption key schedules of one key so that they
+// are expanded once and reused. Read-only after AesCbcInit(), so a context can
+// be shared between threads.
+typedef struct {
+  WORD enc_key[AES_MAX_KEY_SCHEDULE_WORDS];
+  WORD dec_key[AES_MAX_KEY_SCHEDULE_WORDS];
+  // The same schedules as round keys in byte order, for the AES-NI and ARMv8
+  // backends.
+  BYTE enc_bytes[AES_MAX_KEY_SCHEDULE_WORDS * 4];
+  BYTE dec_bytes[AES_MAX_KEY_SCHEDULE_WORDS * 4];
+  int keysize;
+} AesCbcContext;
+
+// Streaming decryption state. The last complete block is held back until
+// AesCbcDecryptFinal() so that the padding can be checked and removed.
+typedef struct {
+  const AesCbcContext *ctx;
+  BYTE iv[AES_BLOCK_SIZE];
+  BYTE buf[AES_BLOCK_SIZE];
+  size_t buf_len;
+} AesCbcDecryptStream;
+
+int AesCbcInit(AesCbcContext *ctx,  // Output
+               const BYTE *key,     // The key, must be keysize bits long
+               int keysize);        // Bit length of the key, 128, 192, or 256
+
+// Encrypts and appends PKCS#7 padding. "out" must hold
+// AesGetOutLen(in_len, AES_ENCRYPT) bytes; "out" may be equal to "in".
+int AesCbcEncryptPkcs7(const AesCbcContext *ctx, const BYTE *in,
+                       size_t in_len, BYTE *out, const BYTE *iv,
+                       size_t *out_len);
+
+// Decrypts "buf" in place and validates the PKCS#7 padding. No memory is
+// allocated. Returns FALSE if the length or the padding is invalid.
+int AesCbcDecryptInPlace(const AesCbcContext *ctx,
+                         BYTE *buf,        // Ciphertext in, plaintext out
+                         size_t len,       // Must be a multiple of 16
+                         const BYTE *iv,   // IV, must be AES_BLOCK_SIZE bytes
+                         size_t *out_len);  // Plaintext length without padding
+
+void AesCbcDecryptStart(AesCbcDecryptStream *stream, const AesCbcContext *ctx,
+                        const BYTE *iv);
+
+// "out" must hold in_len + AES_BLOCK_SIZE bytes and must not overlap "in".
+void AesCbcDecryptUpdate(AesCbcDecryptStream *stream, const BYTE *in,
+                         size_t in_len, BYTE *out, size_t *out_len);
+
+// "out" must hold AES_BLOCK_SIZE bytes. Returns FALSE if the total input
+// length was not a multiple of 16 or the padding is invalid.
+int AesCbcDecryptFinal(AesCbcDecryptStream *stream, BYTE *out,
+                       size_t *out_len);
+
+// Hex variants for the HTTPDNS request and response bodies. The hex text is
+// produced or decoded block by block, with no intermediate binary buffer.
+// "out_hex" must hold 2 * AesGetOutLen(in_len, AES_ENCRYPT) chars; no '\0'
+// is appended.
+int AesCbcEncryptPkcs7Hex(const AesCbcContext *ctx, const BYTE *in,
+                          size_t in_len, const BYTE *iv, char *out_hex,
+                          size_t *out_hex_len);
+
+// "hex_len" must be a multiple of 32 and "out" must hold hex_len / 2 bytes.
+// Returns FALSE if the hex text, the length, or the padding is invalid.
+int AesCbcDecryptHex(const AesCbcContext *ctx, const char *hex,
+                     size_t hex_len, const BYTE *iv, BYTE *out,
+                     size_t *out_len);
+
 ///////////////////
 // AES - CTR
 ///////////////////
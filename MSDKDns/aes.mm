@@ -16,12 +16,37 @@ of operation is specified by NIST SP80-38 C, available at: *
 http://csrc.nist.gov/publications/nistpubs/800-38C/SP800-38C_updated-July20_2007.pdf
 *********************************************************************/
 #include "aes.h"
+#include "msdkdns_hex.h"
+
+#include <pthread.h>
+#include <string.h>
 
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <string>
 
+// Hardware backends. AES-NI is compiled with a per-function target attribute
+// and enabled by CPUID (x86 simulator); the ARMv8 backend needs the compiler
+// to target the Crypto Extensions and is then enabled by the OS feature flag.
+#if !defined(AES_USE_REFERENCE_IMPL) && (defined(__x86_64__) || defined(__i386__))
+#define AES_HAVE_AESNI 1
+#include <cpuid.h>
+#include <wmmintrin.h>
+#endif
+
+#if !defined(AES_USE_REFERENCE_IMPL) && defined(__aarch64__) && \
+    (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define AES_HAVE_ARMV8 1
+#include <arm_neon.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
 namespace self_dns {
 
 /****************************** MACROS ******************************/
@@ -50,6 +75,20 @@ static void CcmFormatAssocData(BYTE *buf, int *end_of_buf, const BYTE *assoc,
 static void CcmFormatPayloadData(BYTE *buf, int *end_of_buf,
                                  const BYTE *payload, int payload_len);
 
+static int AesActiveBackend();
+
+static int AesIsHardware(int backend);
+
+static void AesScheduleBytes(const WORD *key, BYTE *out, int keysize);
+
+static void AesEncryptBlock(int backend, const BYTE *in, BYTE *out,
+                            const WORD *key, const BYTE *key_bytes,
+                            int keysize);
+
+static void AesDecryptBlock(int backend, const BYTE *in, BYTE *out,
+                            const WORD *dec_key, const BYTE *dec_key_bytes,
+                            int keysize);
+
 /**************************** VARIABLES *****************************/
 // This is the specified AES SBox. To look up a substitution value, put the
 // first nibble in the first index (row) and the second nibble in the second
@@ -276,6 +315,8 @@ int AesEncryptCbc(const unsigned char *in, size_t in_len, unsigned char *out,
   BYTE buf_in[AES_BLOCK_SIZE];
   BYTE buf_out[AES_BLOCK_SIZE];
   BYTE iv_buf[AES_BLOCK_SIZE];
+  BYTE key_bytes[AES_MAX_KEY_SCHEDULE_WORDS * 4];
+  int backend = AesActiveBackend();
   int blocks;
   int idx;
 
@@ -284,11 +325,13 @@ int AesEncryptCbc(const unsigned char *in, size_t in_len, unsigned char *out,
   blocks = in_len / AES_BLOCK_SIZE;
 
   memcpy(iv_buf, iv, AES_BLOCK_SIZE);
+  // 硬件实现使用字节序的轮密钥，整段数据只转换一次
+  if (AesIsHardware(backend)) AesScheduleBytes(key, key_bytes, keysize);
 
   for (idx = 0; idx < blocks; idx++) {
     memcpy(buf_in, &in[idx * AES_BLOCK_SIZE], AES_BLOCK_SIZE);
     XorBuf(iv_buf, buf_in, AES_BLOCK_SIZE);
-    AesEncrypt(buf_in, buf_out, key, keysize);
+    AesEncryptBlock(backend, buf_in, buf_out, key, key_bytes, keysize);
     memcpy(&out[idx * AES_BLOCK_SIZE], buf_out, AES_BLOCK_SIZE);
     memcpy(iv_buf, buf_out, AES_BLOCK_SIZE);
   }
@@ -318,7 +361,8 @@ int AesEncryptCbcMac(const BYTE *in, size_t in_len, unsigned char *out,
     // Do not output all encrypted blocks.
   }
 
-  memcpy(out, buf_out, AES_BLOCK_SIZE);  // Only output the last block.
+  // Only output the last block, which is also the last chaining value.
+  memcpy(out, iv_buf, AES_BLOCK_SIZE);
 
   return (TRUE);
 }
@@ -332,15 +376,21 @@ int AesDecryptCbc(const unsigned char *in, size_t in_len, unsigned char *out,
   int blocks;
   int idx;
 
+  WORD dec_key[AES_MAX_KEY_SCHEDULE_WORDS];
+  BYTE dec_key_bytes[AES_MAX_KEY_SCHEDULE_WORDS * 4];
+  int backend = AesActiveBackend();
+
   if (in_len % AES_BLOCK_SIZE != 0) return (FALSE);
 
   blocks = in_len / AES_BLOCK_SIZE;
 
   memcpy(iv_buf, iv, AES_BLOCK_SIZE);
+  AesKeySetupDecrypt(key, dec_key, keysize);
+  if (AesIsHardware(backend)) AesScheduleBytes(dec_key, dec_key_bytes, keysize);
 
   for (idx = 0; idx < blocks; idx++) {
     memcpy(buf_in, &in[idx * AES_BLOCK_SIZE], AES_BLOCK_SIZE);
-    AesDecrypt(buf_in, buf_out, key, keysize);
+    AesDecryptBlock(backend, buf_in, buf_out, dec_key, dec_key_bytes, keysize);
     XorBuf(iv_buf, buf_out, AES_BLOCK_SIZE);
     memcpy(&out[idx * AES_BLOCK_SIZE], buf_out, AES_BLOCK_SIZE);
     memcpy(iv_buf, buf_in, AES_BLOCK_SIZE);
@@ -684,6 +734,8 @@ void AesKeySetup(const BYTE *key, WORD *w, int keysize) {
   }
 }
 
+// The byte-oriented round steps are only used by the reference backend.
+#if defined(AES_USE_REFERENCE_IMPL)
 /////////////////
 // ADD ROUND KEY
 /////////////////
@@ -1019,10 +1071,11 @@ void InvMixColumns(BYTE state[][4]) {
 }
 
 /////////////////
-// (En/De)Crypt
+// (En/De)Crypt - reference implementation
 /////////////////
 
-void AesEncrypt(const BYTE *in, BYTE *out, const WORD *key, int keysize) {
+static void AesEncryptReference(const BYTE *in, BYTE *out, const WORD *key,
+                                int keysize) {
   BYTE state[4][4];
 
   // Copy input array (should be 16 bytes long) to a matrix (sequential bytes
@@ -1140,7 +1193,8 @@ void AesEncrypt(const BYTE *in, BYTE *out, const WORD *key, int keysize) {
   out[15] = state[3][3];
 }
 
-void AesDecrypt(const BYTE *in, BYTE *out, const WORD *key, int keysize) {
+static void AesDecryptReference(const BYTE *in, BYTE *out, const WORD *key,
+                                int keysize) {
   BYTE state[4][4];
 
   // Copy the input to the state.
@@ -1248,6 +1302,650 @@ void AesDecrypt(const BYTE *in, BYTE *out, const WORD *key, int keysize) {
   out[14] = state[2][3];
   out[15] = state[3][3];
 }
+#endif  // AES_USE_REFERENCE_IMPL
+
+/////////////////
+// T-TABLE BACKEND
+/////////////////
+
+// 32-bit T-table implementation (one table lookup per byte per round instead
+// of separate SubBytes/ShiftRows/MixColumns passes). The tables are derived
+// from aesSbox_/aesInvsbox_/gfMul_ on first use. Words use the same big-endian
+// layout as the key schedule produced by AesKeySetup().
+#define AES_GETU32(p)                                                   \
+  (((WORD)(p)[0] << 24) ^ ((WORD)(p)[1] << 16) ^ ((WORD)(p)[2] << 8) ^ \
+   ((WORD)(p)[3]))
+#define AES_PUTU32(p, v)        \
+  {                             \
+    (p)[0] = (BYTE)((v) >> 24); \
+    (p)[1] = (BYTE)((v) >> 16); \
+    (p)[2] = (BYTE)((v) >> 8);  \
+    (p)[3] = (BYTE)(v);         \
+  }
+#define AES_SBOX(x) aesSbox_[(x) >> 4][(x)&0x0F]
+#define AES_INV_SBOX(x) aesInvsbox_[(x) >> 4][(x)&0x0F]
+
+#if !defined(AES_USE_REFERENCE_IMPL)
+static WORD aesTe_[4][256];
+static WORD aesTd_[4][256];
+static pthread_once_t aesTablesOnce_ = PTHREAD_ONCE_INIT;
+
+static WORD RotateRight8(WORD x) { return (x >> 8) | (x << 24); }
+
+static void AesInitTables() {
+  for (int x = 0; x < 256; ++x) {
+    BYTE s = AES_SBOX(x);
+    WORD te = ((WORD)gfMul_[s][0] << 24) | ((WORD)s << 16) | ((WORD)s << 8) |
+              (WORD)gfMul_[s][1];
+    BYTE is = AES_INV_SBOX(x);
+    WORD td = ((WORD)gfMul_[is][5] << 24) | ((WORD)gfMul_[is][2] << 16) |
+              ((WORD)gfMul_[is][4] << 8) | (WORD)gfMul_[is][3];
+    for (int t = 0; t < 4; ++t) {
+      aesTe_[t][x] = te;
+      aesTd_[t][x] = td;
+      te = RotateRight8(te);
+      td = RotateRight8(td);
+    }
+  }
+}
+
+static void AesEnsureTables() { pthread_once(&aesTablesOnce_, AesInitTables); }
+#endif  // !AES_USE_REFERENCE_IMPL
+
+static int AesRounds(int keysize) {
+  switch (keysize) {
+    case 128:
+      return AES_128_ROUNDS;
+    case 192:
+      return AES_192_ROUNDS;
+    case 256:
+      return AES_256_ROUNDS;
+    default:
+      return 0;
+  }
+}
+
+#if !defined(AES_USE_REFERENCE_IMPL)
+static void AesEncryptTTable(const BYTE *in, BYTE *out, const WORD *rk,
+                             int rounds) {
+  WORD s0 = AES_GETU32(in) ^ rk[0];
+  WORD s1 = AES_GETU32(in + 4) ^ rk[1];
+  WORD s2 = AES_GETU32(in + 8) ^ rk[2];
+  WORD s3 = AES_GETU32(in + 12) ^ rk[3];
+  WORD t0, t1, t2, t3;
+
+  for (int r = 1; r < rounds; ++r) {
+    rk += 4;
+    t0 = aesTe_[0][s0 >> 24] ^ aesTe_[1][(s1 >> 16) & 0xFF] ^
+         aesTe_[2][(s2 >> 8) & 0xFF] ^ aesTe_[3][s3 & 0xFF] ^ rk[0];
+    t1 = aesTe_[0][s1 >> 24] ^ aesTe_[1][(s2 >> 16) & 0xFF] ^
+         aesTe_[2][(s3 >> 8) & 0xFF] ^ aesTe_[3][s0 & 0xFF] ^ rk[1];
+    t2 = aesTe_[0][s2 >> 24] ^ aesTe_[1][(s3 >> 16) & 0xFF] ^
+         aesTe_[2][(s0 >> 8) & 0xFF] ^ aesTe_[3][s1 & 0xFF] ^ rk[2];
+    t3 = aesTe_[0][s3 >> 24] ^ aesTe_[1][(s0 >> 16) & 0xFF] ^
+         aesTe_[2][(s1 >> 8) & 0xFF] ^ aesTe_[3][s2 & 0xFF] ^ rk[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // The last round does not perform the MixColumns step.
+  rk += 4;
+  t0 = ((WORD)AES_SBOX(s0 >> 24) << 24) ^
+       ((WORD)AES_SBOX((s1 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_SBOX((s2 >> 8) & 0xFF) << 8) ^ (WORD)AES_SBOX(s3 & 0xFF) ^
+       rk[0];
+  t1 = ((WORD)AES_SBOX(s1 >> 24) << 24) ^
+       ((WORD)AES_SBOX((s2 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_SBOX((s3 >> 8) & 0xFF) << 8) ^ (WORD)AES_SBOX(s0 & 0xFF) ^
+       rk[1];
+  t2 = ((WORD)AES_SBOX(s2 >> 24) << 24) ^
+       ((WORD)AES_SBOX((s3 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_SBOX((s0 >> 8) & 0xFF) << 8) ^ (WORD)AES_SBOX(s1 & 0xFF) ^
+       rk[2];
+  t3 = ((WORD)AES_SBOX(s3 >> 24) << 24) ^
+       ((WORD)AES_SBOX((s0 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_SBOX((s1 >> 8) & 0xFF) << 8) ^ (WORD)AES_SBOX(s2 & 0xFF) ^
+       rk[3];
+  AES_PUTU32(out, t0);
+  AES_PUTU32(out + 4, t1);
+  AES_PUTU32(out + 8, t2);
+  AES_PUTU32(out + 12, t3);
+}
+
+// "rk" is a decryption key schedule produced by AesKeySetupDecrypt().
+static void AesDecryptTTable(const BYTE *in, BYTE *out, const WORD *rk,
+                             int rounds) {
+  WORD s0 = AES_GETU32(in) ^ rk[0];
+  WORD s1 = AES_GETU32(in + 4) ^ rk[1];
+  WORD s2 = AES_GETU32(in + 8) ^ rk[2];
+  WORD s3 = AES_GETU32(in + 12) ^ rk[3];
+  WORD t0, t1, t2, t3;
+
+  for (int r = 1; r < rounds; ++r) {
+    rk += 4;
+    t0 = aesTd_[0][s0 >> 24] ^ aesTd_[1][(s3 >> 16) & 0xFF] ^
+         aesTd_[2][(s2 >> 8) & 0xFF] ^ aesTd_[3][s1 & 0xFF] ^ rk[0];
+    t1 = aesTd_[0][s1 >> 24] ^ aesTd_[1][(s0 >> 16) & 0xFF] ^
+         aesTd_[2][(s3 >> 8) & 0xFF] ^ aesTd_[3][s2 & 0xFF] ^ rk[1];
+    t2 = aesTd_[0][s2 >> 24] ^ aesTd_[1][(s1 >> 16) & 0xFF] ^
+         aesTd_[2][(s0 >> 8) & 0xFF] ^ aesTd_[3][s3 & 0xFF] ^ rk[2];
+    t3 = aesTd_[0][s3 >> 24] ^ aesTd_[1][(s2 >> 16) & 0xFF] ^
+         aesTd_[2][(s1 >> 8) & 0xFF] ^ aesTd_[3][s0 & 0xFF] ^ rk[3];
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  rk += 4;
+  t0 = ((WORD)AES_INV_SBOX(s0 >> 24) << 24) ^
+       ((WORD)AES_INV_SBOX((s3 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_INV_SBOX((s2 >> 8) & 0xFF) << 8) ^
+       (WORD)AES_INV_SBOX(s1 & 0xFF) ^ rk[0];
+  t1 = ((WORD)AES_INV_SBOX(s1 >> 24) << 24) ^
+       ((WORD)AES_INV_SBOX((s0 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_INV_SBOX((s3 >> 8) & 0xFF) << 8) ^
+       (WORD)AES_INV_SBOX(s2 & 0xFF) ^ rk[1];
+  t2 = ((WORD)AES_INV_SBOX(s2 >> 24) << 24) ^
+       ((WORD)AES_INV_SBOX((s1 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_INV_SBOX((s0 >> 8) & 0xFF) << 8) ^
+       (WORD)AES_INV_SBOX(s3 & 0xFF) ^ rk[2];
+  t3 = ((WORD)AES_INV_SBOX(s3 >> 24) << 24) ^
+       ((WORD)AES_INV_SBOX((s2 >> 16) & 0xFF) << 16) ^
+       ((WORD)AES_INV_SBOX((s1 >> 8) & 0xFF) << 8) ^
+       (WORD)AES_INV_SBOX(s0 & 0xFF) ^ rk[3];
+  AES_PUTU32(out, t0);
+  AES_PUTU32(out + 4, t1);
+  AES_PUTU32(out + 8, t2);
+  AES_PUTU32(out + 12, t3);
+}
+#endif  // !AES_USE_REFERENCE_IMPL
+
+/////////////////
+// HARDWARE BACKENDS
+/////////////////
+
+// Both take the round keys in byte order (AesScheduleBytes). Decryption uses
+// the equivalent inverse cipher schedule from AesKeySetupDecrypt(), which is
+// the form AESDEC/AESD+AESIMC expect.
+#if defined(AES_HAVE_AESNI)
+__attribute__((target("aes,sse2"))) static void AesEncryptAesni(
+    const BYTE *in, BYTE *out, const BYTE *rk, int rounds) {
+  __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in),
+                            _mm_loadu_si128((const __m128i *)rk));
+  for (int r = 1; r < rounds; ++r) {
+    b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i *)(rk + 16 * r)));
+  }
+  b = _mm_aesenclast_si128(
+      b, _mm_loadu_si128((const __m128i *)(rk + 16 * rounds)));
+  _mm_storeu_si128((__m128i *)out, b);
+}
+
+__attribute__((target("aes,sse2"))) static void AesDecryptAesni(
+    const BYTE *in, BYTE *out, const BYTE *rk, int rounds) {
+  __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in),
+                            _mm_loadu_si128((const __m128i *)rk));
+  for (int r = 1; r < rounds; ++r) {
+    b = _mm_aesdec_si128(b, _mm_loadu_si128((const __m128i *)(rk + 16 * r)));
+  }
+  b = _mm_aesdeclast_si128(
+      b, _mm_loadu_si128((const __m128i *)(rk + 16 * rounds)));
+  _mm_storeu_si128((__m128i *)out, b);
+}
+
+static int AesCpuHasAesni() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return (FALSE);
+  return (ecx & bit_AES) != 0 && (edx & bit_SSE2) != 0;
+}
+#endif  // AES_HAVE_AESNI
+
+#if defined(AES_HAVE_ARMV8)
+// AESE/AESD add the round key before SubBytes, so the last key is XORed
+// separately.
+static void AesEncryptArmv8(const BYTE *in, BYTE *out, const BYTE *rk,
+                            int rounds) {
+  uint8x16_t b = vld1q_u8(in);
+  for (int r = 0; r < rounds - 1; ++r) {
+    b = vaesmcq_u8(vaeseq_u8(b, vld1q_u8(rk + 16 * r)));
+  }
+  b = vaeseq_u8(b, vld1q_u8(rk + 16 * (rounds - 1)));
+  vst1q_u8(out, veorq_u8(b, vld1q_u8(rk + 16 * rounds)));
+}
+
+static void AesDecryptArmv8(const BYTE *in, BYTE *out, const BYTE *rk,
+                            int rounds) {
+  uint8x16_t b = vld1q_u8(in);
+  for (int r = 0; r < rounds - 1; ++r) {
+    b = vaesimcq_u8(vaesdq_u8(b, vld1q_u8(rk + 16 * r)));
+  }
+  b = vaesdq_u8(b, vld1q_u8(rk + 16 * (rounds - 1)));
+  vst1q_u8(out, veorq_u8(b, vld1q_u8(rk + 16 * rounds)));
+}
+
+// 编译器已按带 Crypto 扩展的目标生成代码；系统不提供该查询时（iOS 15 之前
+// 没有 FEAT_AES），按编译目标认为支持
+static int AesCpuHasArmv8() {
+#if defined(__APPLE__)
+  int value = 0;
+  size_t length = sizeof(value);
+  if (sysctlbyname("hw.optional.arm.FEAT_AES", &value, &length, NULL, 0) != 0)
+    return (TRUE);
+  return value != 0;
+#elif defined(__linux__) && defined(HWCAP_AES)
+  return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#else
+  return (TRUE);
+#endif
+}
+#endif  // AES_HAVE_ARMV8
+
+/////////////////
+// BACKEND DISPATCH
+/////////////////
+
+#if defined(AES_USE_REFERENCE_IMPL)
+static int aesBackend_ = AES_BACKEND_REFERENCE;
+#else
+static int aesBackend_ = AES_BACKEND_TTABLE;
+#endif
+static pthread_once_t aesBackendOnce_ = PTHREAD_ONCE_INIT;
+
+static void AesDetectBackend() {
+  for (int backend = AES_BACKEND_COUNT - 1; backend > aesBackend_; --backend) {
+    if (AesBackendSupported(backend)) {
+      aesBackend_ = backend;
+      return;
+    }
+  }
+}
+
+static int AesActiveBackend() {
+  pthread_once(&aesBackendOnce_, AesDetectBackend);
+  return __atomic_load_n(&aesBackend_, __ATOMIC_RELAXED);
+}
+
+static int AesIsHardware(int backend) {
+  return backend == AES_BACKEND_AESNI || backend == AES_BACKEND_ARMV8;
+}
+
+int AesBackend() { return AesActiveBackend(); }
+
+int AesBackendSupported(int backend) {
+  switch (backend) {
+#if defined(AES_USE_REFERENCE_IMPL)
+    case AES_BACKEND_REFERENCE:
+      return (TRUE);
+#else
+    case AES_BACKEND_TTABLE:
+      return (TRUE);
+#endif
+#if defined(AES_HAVE_AESNI)
+    case AES_BACKEND_AESNI:
+      return AesCpuHasAesni();
+#endif
+#if defined(AES_HAVE_ARMV8)
+    case AES_BACKEND_ARMV8:
+      return AesCpuHasArmv8();
+#endif
+    default:
+      return (FALSE);
+  }
+}
+
+int AesSetBackend(int backend) {
+  if (!AesBackendSupported(backend)) return (FALSE);
+  pthread_once(&aesBackendOnce_, AesDetectBackend);
+  __atomic_store_n(&aesBackend_, backend, __ATOMIC_RELAXED);
+  return (TRUE);
+}
+
+const char *AesBackendName(int backend) {
+  switch (backend) {
+    case AES_BACKEND_REFERENCE:
+      return "reference";
+    case AES_BACKEND_TTABLE:
+      return "t-table";
+    case AES_BACKEND_AESNI:
+      return "aes-ni";
+    case AES_BACKEND_ARMV8:
+      return "armv8-ce";
+    default:
+      return "unknown";
+  }
+}
+
+static void AesScheduleBytes(const WORD *key, BYTE *out, int keysize) {
+  int words = 4 * (AesRounds(keysize) + 1);
+  for (int idx = 0; idx < words; ++idx) AES_PUTU32(out + 4 * idx, key[idx]);
+}
+
+// "key_bytes" is only read by the hardware backends.
+static void AesEncryptBlock(int backend, const BYTE *in, BYTE *out,
+                            const WORD *key, const BYTE *key_bytes,
+                            int keysize) {
+  (void)backend;
+  (void)key_bytes;
+#if defined(AES_USE_REFERENCE_IMPL)
+  AesEncryptReference(in, out, key, keysize);
+#else
+  int rounds = AesRounds(keysize);
+  if (rounds == 0) return;
+#if defined(AES_HAVE_AESNI)
+  if (backend == AES_BACKEND_AESNI) {
+    AesEncryptAesni(in, out, key_bytes, rounds);
+    return;
+  }
+#endif
+#if defined(AES_HAVE_ARMV8)
+  if (backend == AES_BACKEND_ARMV8) {
+    AesEncryptArmv8(in, out, key_bytes, rounds);
+    return;
+  }
+#endif
+  AesEnsureTables();
+  AesEncryptTTable(in, out, key, rounds);
+#endif
+}
+
+static void AesDecryptBlock(int backend, const BYTE *in, BYTE *out,
+                            const WORD *dec_key, const BYTE *dec_key_bytes,
+                            int keysize) {
+  (void)backend;
+  (void)dec_key_bytes;
+#if defined(AES_USE_REFERENCE_IMPL)
+  AesDecryptReference(in, out, dec_key, keysize);
+#else
+  int rounds = AesRounds(keysize);
+  if (rounds == 0) return;
+#if defined(AES_HAVE_AESNI)
+  if (backend == AES_BACKEND_AESNI) {
+    AesDecryptAesni(in, out, dec_key_bytes, rounds);
+    return;
+  }
+#endif
+#if defined(AES_HAVE_ARMV8)
+  if (backend == AES_BACKEND_ARMV8) {
+    AesDecryptArmv8(in, out, dec_key_bytes, rounds);
+    return;
+  }
+#endif
+  AesEnsureTables();
+  AesDecryptTTable(in, out, dec_key, rounds);
+#endif
+}
+
+// Builds the equivalent inverse cipher key schedule: round keys in reverse
+// order, with InvMixColumns applied to all but the first and last round.
+void AesKeySetupDecrypt(const WORD *key, WORD *dec_key, int keysize) {
+  int rounds = AesRounds(keysize);
+  if (rounds == 0) return;
+#if defined(AES_USE_REFERENCE_IMPL)
+  memcpy(dec_key, key, sizeof(WORD) * 4 * (rounds + 1));
+#else
+  AesEnsureTables();
+  for (int r = 0; r <= rounds; ++r) {
+    for (int j = 0; j < 4; ++j) {
+      WORD w = key[4 * (rounds - r) + j];
+      if (r > 0 && r < rounds) {
+        w = aesTd_[0][AES_SBOX(w >> 24)] ^ aesTd_[1][AES_SBOX((w >> 16) & 0xFF)] ^
+            aesTd_[2][AES_SBOX((w >> 8) & 0xFF)] ^ aesTd_[3][AES_SBOX(w & 0xFF)];
+      }
+      dec_key[4 * r + j] = w;
+    }
+  }
+#endif
+}
+
+// Single-block calls convert the schedule on every call; callers with more
+// than one block should use the CBC context, which keeps it converted.
+void AesDecryptWithDecKey(const BYTE *in, BYTE *out, const WORD *dec_key,
+                          int keysize) {
+  BYTE dec_key_bytes[AES_MAX_KEY_SCHEDULE_WORDS * 4];
+  int backend = AesActiveBackend();
+
+  if (AesIsHardware(backend)) AesScheduleBytes(dec_key, dec_key_bytes, keysize);
+  AesDecryptBlock(backend, in, out, dec_key, dec_key_bytes, keysize);
+}
+
+void AesEncrypt(const BYTE *in, BYTE *out, const WORD *key, int keysize) {
+  BYTE key_bytes[AES_MAX_KEY_SCHEDULE_WORDS * 4];
+  int backend = AesActiveBackend();
+
+  if (AesIsHardware(backend)) AesScheduleBytes(key, key_bytes, keysize);
+  AesEncryptBlock(backend, in, out, key, key_bytes, keysize);
+}
+
+void AesDecrypt(const BYTE *in, BYTE *out, const WORD *key, int keysize) {
+#if defined(AES_USE_REFERENCE_IMPL)
+  AesDecryptReference(in, out, key, keysize);
+#else
+  // Callers decrypting more than one block should derive the decryption key
+  // schedule once with AesKeySetupDecrypt() and use AesDecryptWithDecKey().
+  WORD dec_key[AES_MAX_KEY_SCHEDULE_WORDS];
+  AesKeySetupDecrypt(key, dec_key, keysize);
+  AesDecryptWithDecKey(in, out, dec_key, keysize);
+#endif
+}
+
+/////////////////
+// CBC CONTEXT
+/////////////////
+
+int AesCbcInit(AesCbcContext *ctx, const BYTE *key, int keysize) {
+  if (!ctx || !key || AesRounds(keysize) == 0) return (FALSE);
+
+  AesKeySetup(key, ctx->enc_key, keysize);
+  AesKeySetupDecrypt(ctx->enc_key, ctx->dec_key, keysize);
+  AesScheduleBytes(ctx->enc_key, ctx->enc_bytes, keysize);
+  AesScheduleBytes(ctx->dec_key, ctx->dec_bytes, keysize);
+  ctx->keysize = keysize;
+  return (TRUE);
+}
+
+static void AesCbcEncryptBlock(const AesCbcContext *ctx, const BYTE *in,
+                               BYTE *out) {
+  AesEncryptBlock(AesActiveBackend(), in, out, ctx->enc_key, ctx->enc_bytes,
+                  ctx->keysize);
+}
+
+// Decrypts one block with "iv" as the chaining value; "in" may equal "out".
+static void AesCbcDecryptBlock(const AesCbcContext *ctx, BYTE *iv,
+                               const BYTE *in, BYTE *out) {
+  BYTE cipher[AES_BLOCK_SIZE];
+
+  memcpy(cipher, in, AES_BLOCK_SIZE);
+  AesDecryptBlock(AesActiveBackend(), cipher, out, ctx->dec_key,
+                  ctx->dec_bytes, ctx->keysize);
+  XorBuf(iv, out, AES_BLOCK_SIZE);
+  memcpy(iv, cipher, AES_BLOCK_SIZE);
+}
+
+// Returns the padding length of the last plaintext block, or 0 if it is not
+// valid PKCS#7 padding. All padding bytes are always inspected.
+static size_t AesPkcs7PaddingLen(const BYTE *block) {
+  size_t padding_len = block[AES_BLOCK_SIZE - 1];
+  BYTE diff = 0;
+
+  if (padding_len == 0 || padding_len > AES_BLOCK_SIZE) return 0;
+  for (size_t idx = 0; idx < AES_BLOCK_SIZE; idx++) {
+    BYTE mask = (BYTE)(0 - (BYTE)(idx >= AES_BLOCK_SIZE - padding_len));
+    diff |= (BYTE)((block[idx] ^ (BYTE)padding_len) & mask);
+  }
+  return diff == 0 ? padding_len : 0;
+}
+
+int AesCbcEncryptPkcs7(const AesCbcContext *ctx, const BYTE *in,
+                       size_t in_len, BYTE *out, const BYTE *iv,
+                       size_t *out_len) {
+  BYTE iv_buf[AES_BLOCK_SIZE];
+  BYTE last[AES_BLOCK_SIZE];
+  size_t blocks, rest_len, idx;
+
+  if (!ctx || (!in && in_len > 0) || !out || !iv || !out_len) return (FALSE);
+
+  blocks = in_len / AES_BLOCK_SIZE;
+  rest_len = in_len % AES_BLOCK_SIZE;
+  memcpy(iv_buf, iv, AES_BLOCK_SIZE);
+
+  // 填充块先拷出，"out" 与 "in" 相同时不会被覆盖
+  memcpy(last, in + blocks * AES_BLOCK_SIZE, rest_len);
+  memset(last + rest_len, (BYTE)(AES_BLOCK_SIZE - rest_len),
+         AES_BLOCK_SIZE - rest_len);
+
+  for (idx = 0; idx <= blocks; idx++) {
+    const BYTE *src = idx < blocks ? &in[idx * AES_BLOCK_SIZE] : last;
+    BYTE *dst = &out[idx * AES_BLOCK_SIZE];
+    BYTE block[AES_BLOCK_SIZE];
+
+    memcpy(block, src, AES_BLOCK_SIZE);
+    XorBuf(iv_buf, block, AES_BLOCK_SIZE);
+    AesCbcEncryptBlock(ctx, block, dst);
+    memcpy(iv_buf, dst, AES_BLOCK_SIZE);
+  }
+
+  *out_len = (blocks + 1) * AES_BLOCK_SIZE;
+  return (TRUE);
+}
+
+int AesCbcDecryptInPlace(const AesCbcContext *ctx, BYTE *buf, size_t len,
+                         const BYTE *iv, size_t *out_len) {
+  BYTE iv_buf[AES_BLOCK_SIZE];
+  size_t padding_len, idx;
+
+  if (!ctx || !buf || !iv || !out_len) return (FALSE);
+  if (len == 0 || len % AES_BLOCK_SIZE != 0) return (FALSE);
+
+  memcpy(iv_buf, iv, AES_BLOCK_SIZE);
+  for (idx = 0; idx < len; idx += AES_BLOCK_SIZE) {
+    AesCbcDecryptBlock(ctx, iv_buf, &buf[idx], &buf[idx]);
+  }
+
+  padding_len = AesPkcs7PaddingLen(&buf[len - AES_BLOCK_SIZE]);
+  if (padding_len == 0) return (FALSE);
+
+  *out_len = len - padding_len;
+  return (TRUE);
+}
+
+void AesCbcDecryptStart(AesCbcDecryptStream *stream, const AesCbcContext *ctx,
+                        const BYTE *iv) {
+  stream->ctx = ctx;
+  memcpy(stream->iv, iv, AES_BLOCK_SIZE);
+  stream->buf_len = 0;
+}
+
+void AesCbcDecryptUpdate(AesCbcDecryptStream *stream, const BYTE *in,
+                         size_t in_len, BYTE *out, size_t *out_len) {
+  size_t produced = 0;
+
+  while (in_len > 0) {
+    size_t copy_len;
+
+    // 缓存的完整块后面还有数据，说明不是最后一块，可以直接输出
+    if (stream->buf_len == AES_BLOCK_SIZE) {
+      AesCbcDecryptBlock(stream->ctx, stream->iv, stream->buf, &out[produced]);
+      produced += AES_BLOCK_SIZE;
+      stream->buf_len = 0;
+    }
+
+    // 整块直接从输入解密，始终保留最后一个块
+    while (stream->buf_len == 0 && in_len > AES_BLOCK_SIZE) {
+      AesCbcDecryptBlock(stream->ctx, stream->iv, in, &out[produced]);
+      produced += AES_BLOCK_SIZE;
+      in += AES_BLOCK_SIZE;
+      in_len -= AES_BLOCK_SIZE;
+    }
+
+    copy_len = AES_BLOCK_SIZE - stream->buf_len;
+    if (copy_len > in_len) copy_len = in_len;
+    memcpy(&stream->buf[stream->buf_len], in, copy_len);
+    stream->buf_len += copy_len;
+    in += copy_len;
+    in_len -= copy_len;
+  }
+
+  *out_len = produced;
+}
+
+int AesCbcDecryptFinal(AesCbcDecryptStream *stream, BYTE *out,
+                       size_t *out_len) {
+  size_t padding_len;
+
+  *out_len = 0;
+  if (stream->buf_len != AES_BLOCK_SIZE) return (FALSE);
+
+  AesCbcDecryptBlock(stream->ctx, stream->iv, stream->buf, stream->buf);
+  stream->buf_len = 0;
+  padding_len = AesPkcs7PaddingLen(stream->buf);
+  if (padding_len == 0) return (FALSE);
+
+  memcpy(out, stream->buf, AES_BLOCK_SIZE - padding_len);
+  *out_len = AES_BLOCK_SIZE - padding_len;
+  return (TRUE);
+}
+
+int AesCbcEncryptPkcs7Hex(const AesCbcContext *ctx, const BYTE *in,
+                          size_t in_len, const BYTE *iv, char *out_hex,
+                          size_t *out_hex_len) {
+  BYTE iv_buf[AES_BLOCK_SIZE];
+  BYTE last[AES_BLOCK_SIZE];
+  size_t blocks, rest_len, idx;
+
+  if (!ctx || (!in && in_len > 0) || !out_hex || !iv || !out_hex_len)
+    return (FALSE);
+
+  blocks = in_len / AES_BLOCK_SIZE;
+  rest_len = in_len % AES_BLOCK_SIZE;
+  memcpy(iv_buf, iv, AES_BLOCK_SIZE);
+
+  memcpy(last, in + blocks * AES_BLOCK_SIZE, rest_len);
+  memset(last + rest_len, (BYTE)(AES_BLOCK_SIZE - rest_len),
+         AES_BLOCK_SIZE - rest_len);
+
+  for (idx = 0; idx <= blocks; idx++) {
+    const BYTE *src = idx < blocks ? &in[idx * AES_BLOCK_SIZE] : last;
+    BYTE block[AES_BLOCK_SIZE];
+
+    memcpy(block, src, AES_BLOCK_SIZE);
+    XorBuf(iv_buf, block, AES_BLOCK_SIZE);
+    // 密文块即下一块的IV，直接编码输出
+    AesCbcEncryptBlock(ctx, block, iv_buf);
+    msdkdns::msdkdns_hex_encode(iv_buf, AES_BLOCK_SIZE,
+                                &out_hex[idx * AES_BLOCK_SIZE * 2]);
+  }
+
+  *out_hex_len = (blocks + 1) * AES_BLOCK_SIZE * 2;
+  return (TRUE);
+}
+
+int AesCbcDecryptHex(const AesCbcContext *ctx, const char *hex,
+                     size_t hex_len, const BYTE *iv, BYTE *out,
+                     size_t *out_len) {
+  BYTE iv_buf[AES_BLOCK_SIZE];
+  size_t len, padding_len, idx;
+
+  if (!ctx || !hex || !iv || !out || !out_len) return (FALSE);
+  if (hex_len == 0 || hex_len % (AES_BLOCK_SIZE * 2) != 0) return (FALSE);
+
+  len = hex_len / 2;
+  memcpy(iv_buf, iv, AES_BLOCK_SIZE);
+  // 逐块解码后立即原地解密，数据只经过一次缓存
+  for (idx = 0; idx < len; idx += AES_BLOCK_SIZE) {
+    if (!msdkdns::msdkdns_hex_decode(&hex[idx * 2], AES_BLOCK_SIZE * 2,
+                                     &out[idx]))
+      return (FALSE);
+    AesCbcDecryptBlock(ctx, iv_buf, &out[idx], &out[idx]);
+  }
+
+  padding_len = AesPkcs7PaddingLen(&out[len - AES_BLOCK_SIZE]);
+  if (padding_len == 0) return (FALSE);
+
+  *out_len = len - padding_len;
+  return (TRUE);
+}
 
 int AesGetOutLen(int len, int mode) {
   auto rest_len = (unsigned int)(len % AES_BLOCK_SIZE);
@@ -1256,6 +1954,30 @@ int AesGetOutLen(int len, int mode) {
   return len + padding_len;
 }
 
+// AesCryptWithKey() callers pass the same key on every call, so the key
+// schedules of the last key are kept and copied out instead of re-expanded.
+static pthread_mutex_t aesKeyCacheLock_ = PTHREAD_MUTEX_INITIALIZER;
+static BYTE aesCachedKey_[AES_KEY_SIZE / 8];
+static AesCbcContext aesCachedContext_;
+static int aesKeyCached_ = FALSE;
+
+static void AesContextForKey(const BYTE *key, AesCbcContext *ctx) {
+  pthread_mutex_lock(&aesKeyCacheLock_);
+  if (aesKeyCached_ && memcmp(aesCachedKey_, key, sizeof(aesCachedKey_)) == 0) {
+    *ctx = aesCachedContext_;
+    pthread_mutex_unlock(&aesKeyCacheLock_);
+    return;
+  }
+  pthread_mutex_unlock(&aesKeyCacheLock_);
+
+  AesCbcInit(ctx, key, AES_KEY_SIZE);
+  pthread_mutex_lock(&aesKeyCacheLock_);
+  memcpy(aesCachedKey_, key, sizeof(aesCachedKey_));
+  aesCachedContext_ = *ctx;
+  aesKeyCached_ = TRUE;
+  pthread_mutex_unlock(&aesKeyCacheLock_);
+}
+
 int AesCryptWithKey(const unsigned char *src, unsigned int srclen,
                     unsigned char *buff, unsigned int mode,
                     const unsigned char *AES_KEY, const unsigned char *AES_IV) {
@@ -1269,67 +1991,40 @@ int AesCryptWithKey(const unsigned char *src, unsigned int srclen,
     return 0;
   }
 
-  auto *data = (signed char *)src;
-
-  if (!data) {
-    return 0;
-  }
-
-  // 计算填充长度，当为加密方式且长度不为16的整数倍时，则填充，与3DES填充类似(DESede/CBC/PKCS5Padding)
-  unsigned int rest_len = len % AES_BLOCK_SIZE;
-  unsigned int padding_len =
-      ((AES_ENCRYPT == mode) ? (AES_BLOCK_SIZE - rest_len) : 0);
-  unsigned int src_len = len + padding_len;
-
-  // 设置输入
-  auto *input = (unsigned char *)malloc(src_len);
-  if (!input) {
-    return 0;
-  }
-  memset(input, 0, src_len);
-  memcpy(input, data, len);
-
-  if (padding_len > 0) {
-    memset(input + len, (unsigned char)padding_len, padding_len);
-  }
-
   // 设置输出Buffer
   if (!buff) {
-    free(input);
     return 0;
   }
 
-  memset(buff, 0, src_len);
-
   // set key & iv
-  unsigned int key_schedule[AES_BLOCK_SIZE * 4] = {0};  // >=53(这里取64)
-  AesKeySetup(AES_KEY, key_schedule, AES_KEY_SIZE);
+  AesCbcContext ctx;
+  AesContextForKey(AES_KEY, &ctx);
 
-  // 执行加解密计算(CBC mode)
+  // 执行加解密计算(CBC mode)，直接在输出Buffer上进行，不再拷贝输入
+  size_t out_len = 0;
   if (mode == AES_ENCRYPT) {
-    AesEncryptCbc(input, src_len, buff, key_schedule, AES_KEY_SIZE, AES_IV);
-  } else {
-    AesDecryptCbc(input, src_len, buff, key_schedule, AES_KEY_SIZE, AES_IV);
+    // 填充方式与3DES填充类似(DESede/CBC/PKCS5Padding)
+    AesCbcEncryptPkcs7(&ctx, src, len, buff, AES_IV, &out_len);
+    return (int)out_len;
   }
 
-  // 解密时计算填充长度
-  if (AES_ENCRYPT != mode) {
-    unsigned char *ptr = buff;
-    ptr += (src_len - 1);
-    padding_len = (unsigned int)*ptr;
-
+  if (len % AES_BLOCK_SIZE != 0) {
+    return 0;
+  }
+  memmove(buff, src, len);
+  if (!AesCbcDecryptInPlace(&ctx, buff, len, AES_IV, &out_len)) {
+    // 兼容原有逻辑，填充不合法时按填充值宽松去除
+    unsigned int padding_len = buff[len - 1];
+    out_len = len;
     if (padding_len > 0 && padding_len <= AES_BLOCK_SIZE) {
-      src_len -= padding_len;
+      out_len -= padding_len;
     }
-
-    ptr = nullptr;
-    *(buff + src_len) = '\0';
+  }
+  if (out_len < len) {
+    *(buff + out_len) = '\0';
   }
 
-  // 内存释放
-  free(input);
-
-  return src_len;
+  return (int)out_len;
 }
 
 }  // namespace self_dns
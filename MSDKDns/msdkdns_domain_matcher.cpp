@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_domain_matcher.h"
+#include "msdkdns_domain_interner.h"
+#include <string.h>
+#include <algorithm>
+
+namespace msdkdns {
+
+    static const size_t kMinEdgeCapacity = 16;
+
+    DomainMatcher::DomainMatcher(const std::vector<std::string> &rules) : rule_count_(0) {
+        // 标签总数是边数的上限，按不超过1/2的负载一次分配，编译过程中不再扩容
+        size_t labels = 0;
+        for (size_t i = 0; i < rules.size(); i++) {
+            labels += 1 + std::count(rules[i].begin(), rules[i].end(), '.');
+        }
+        size_t capacity = kMinEdgeCapacity;
+        while (capacity < labels * 2) {
+            capacity *= 2;
+        }
+        Edge empty;
+        memset(&empty, 0, sizeof(empty));
+        edges_.assign(capacity, empty);
+        nodes_.push_back(0);
+        for (size_t i = 0; i < rules.size(); i++) {
+            if (AddRule(rules[i].data(), rules[i].size())) {
+                rule_count_++;
+            }
+        }
+    }
+
+    uint32_t DomainMatcher::Hash(uint32_t parent, const char *label, size_t length) {
+        uint32_t hash = 2166136261u ^ (parent * 0x9E3779B1u);
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<uint8_t>(label[i]);
+            hash *= 16777619u;
+        }
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        return hash;
+    }
+
+    uint32_t DomainMatcher::Child(uint32_t parent, const char *label, size_t length) const {
+        uint32_t hash = Hash(parent, label, length);
+        size_t mask = edges_.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Edge &edge = edges_[i];
+            if (edge.child == 0) {
+                return 0;
+            }
+            if (edge.hash == hash && edge.parent == parent && edge.label_length == length &&
+                memcmp(labels_.data() + edge.label_offset, label, length) == 0) {
+                return edge.child;
+            }
+        }
+    }
+
+    bool DomainMatcher::AddRule(const char *rule, size_t length) {
+        bool wildcard = length > 2 && rule[0] == '*' && rule[1] == '.';
+        if (wildcard) {
+            rule += 2;
+            length -= 2;
+        }
+        char text[kMSDKDnsMaxDomainLength];
+        size_t text_length = 0;
+        // 只支持开头的 *.，其余位置的 * 不合法
+        if (!msdkdns_canonicalize_domain(rule, length, text, &text_length) || memchr(text, '*', text_length)) {
+            return false;
+        }
+        uint32_t node = 0;
+        size_t end = text_length;
+        for (;;) {
+            size_t begin = end;
+            while (begin > 0 && text[begin - 1] != '.') {
+                begin--;
+            }
+            uint32_t child = Child(node, text + begin, end - begin);
+            if (child == 0) {
+                child = static_cast<uint32_t>(nodes_.size());
+                nodes_.push_back(0);
+                uint32_t hash = Hash(node, text + begin, end - begin);
+                size_t mask = edges_.size() - 1;
+                size_t i = hash & mask;
+                while (edges_[i].child) {
+                    i = (i + 1) & mask;
+                }
+                Edge &edge = edges_[i];
+                edge.hash = hash;
+                edge.parent = node;
+                edge.child = child;
+                edge.label_offset = static_cast<uint32_t>(labels_.size());
+                edge.label_length = static_cast<uint32_t>(end - begin);
+                labels_.append(text + begin, end - begin);
+            }
+            node = child;
+            if (begin == 0) {
+                break;
+            }
+            end = begin - 1;
+        }
+        nodes_[node] |= wildcard ? kNodeWildcard : kNodeExact;
+        return true;
+    }
+
+    bool DomainMatcher::Match(const char *domain, size_t length) const {
+        char text[kMSDKDnsMaxDomainLength];
+        size_t text_length = 0;
+        if (rule_count_ == 0 || !msdkdns_canonicalize_domain(domain, length, text, &text_length)) {
+            return false;
+        }
+        // 从顶级域开始逐个标签向下查找，途经的节点有通配规则且还有剩余标签时即为命中
+        uint32_t node = 0;
+        size_t end = text_length;
+        for (;;) {
+            size_t begin = end;
+            while (begin > 0 && text[begin - 1] != '.') {
+                begin--;
+            }
+            node = Child(node, text + begin, end - begin);
+            if (node == 0) {
+                return false;
+            }
+            if (begin == 0) {
+                return (nodes_[node] & kNodeExact) != 0;
+            }
+            if (nodes_[node] & kNodeWildcard) {
+                return true;
+            }
+            end = begin - 1;
+        }
+    }
+}  // namespace msdkdns
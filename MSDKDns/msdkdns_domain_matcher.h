@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_DOMAIN_MATCHER_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_DOMAIN_MATCHER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace msdkdns {
+
+    /*
+     * 域名规则匹配，用于拦截 / 不拦截域名列表
+     * 规则 "example.com" 精确匹配；"*.example.com" 匹配任意层级的子域名，不含 example.com 本身
+     * 规则与查询的域名均按 msdkdns_canonicalize_domain 规范化，大小写及结尾的点不影响匹配
+     * 构造时编译为按标签倒序的后缀树，边存放在以 (父节点, 标签) 为键的开放寻址表中，匹配只需每个标签查一次表
+     * 构造后只读，Match 可在多个线程中无锁并发调用
+     */
+    class DomainMatcher {
+    public:
+        // 不合法的规则跳过，不计入 RuleCount
+        explicit DomainMatcher(const std::vector<std::string> &rules);
+
+        bool Match(const char *domain, size_t length) const;
+        size_t RuleCount() const { return rule_count_; }
+
+    private:
+        enum {
+            kNodeExact = 1,     // 有以该节点结束的精确规则
+            kNodeWildcard = 2,  // 有以该节点结束的通配规则
+        };
+
+        struct Edge {
+            uint32_t hash;
+            uint32_t parent;
+            uint32_t child;  // 0 表示空槽，根节点不会是子节点
+            uint32_t label_offset;
+            uint32_t label_length;
+        };
+
+        static uint32_t Hash(uint32_t parent, const char *label, size_t length);
+        uint32_t Child(uint32_t parent, const char *label, size_t length) const;
+        bool AddRule(const char *rule, size_t length);
+
+        std::vector<Edge> edges_;
+        std::vector<uint8_t> nodes_;  // 各节点的 kNode* 标记，0 为根节点
+        std::string labels_;
+        size_t rule_count_;
+
+        DomainMatcher(const DomainMatcher &);
+        DomainMatcher &operator=(const DomainMatcher &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_DOMAIN_MATCHER_H_
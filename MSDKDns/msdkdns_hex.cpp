@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_hex.h"
+
+// 定义 MSDKDNS_HEX_NO_SIMD 时只使用逐字节实现，用于测试
+#if defined(MSDKDNS_HEX_NO_SIMD)
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define MSDKDNS_HEX_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MSDKDNS_HEX_SSE2 1
+#endif
+
+namespace msdkdns {
+
+    static const char kMSDKDnsHexDigits[] = "0123456789abcdef";
+
+    static inline int msdkdns_hex_value(uint8_t c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        // 置位0x20后只有 A-F/a-f 会落在该区间内
+        c |= 0x20;
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+
+#if defined(MSDKDNS_HEX_NEON)
+    static inline uint8x16_t msdkdns_hex_nibble_to_char(uint8x16_t nibble) {
+        // 0-9 -> '0'-'9'，10-15 -> 'a'-'f'（'a' - '0' - 10 = 39）
+        uint8x16_t letter = vandq_u8(vcgtq_u8(nibble, vdupq_n_u8(9)), vdupq_n_u8(39));
+        return vaddq_u8(vaddq_u8(nibble, vdupq_n_u8('0')), letter);
+    }
+
+    // 32个字符 -> 16字节，valid 记录每个字符是否合法
+    static inline uint8x16_t msdkdns_hex_char_to_nibble(uint8x16_t c, uint8x16_t *valid) {
+        uint8x16_t is_digit = vandq_u8(vcgeq_u8(c, vdupq_n_u8('0')), vcleq_u8(c, vdupq_n_u8('9')));
+        uint8x16_t lower = vorrq_u8(c, vdupq_n_u8(0x20));
+        uint8x16_t is_alpha = vandq_u8(vcgeq_u8(lower, vdupq_n_u8('a')), vcleq_u8(lower, vdupq_n_u8('f')));
+        *valid = vandq_u8(*valid, vorrq_u8(is_digit, is_alpha));
+        return vbslq_u8(is_digit, vsubq_u8(c, vdupq_n_u8('0')), vsubq_u8(lower, vdupq_n_u8('a' - 10)));
+    }
+
+    static inline void msdkdns_hex_encode_block(const uint8_t *in, char *out) {
+        uint8x16_t v = vld1q_u8(in);
+        uint8x16x2_t chars;
+        chars.val[0] = msdkdns_hex_nibble_to_char(vshrq_n_u8(v, 4));
+        chars.val[1] = msdkdns_hex_nibble_to_char(vandq_u8(v, vdupq_n_u8(0x0F)));
+        vst2q_u8(reinterpret_cast<uint8_t *>(out), chars);
+    }
+
+    static inline bool msdkdns_hex_decode_block(const char *in, uint8_t *out) {
+        // vld2q 按奇偶位置拆分，val[0] 为高4位字符，val[1] 为低4位字符
+        uint8x16x2_t chars = vld2q_u8(reinterpret_cast<const uint8_t *>(in));
+        uint8x16_t valid = vdupq_n_u8(0xFF);
+        uint8x16_t high = msdkdns_hex_char_to_nibble(chars.val[0], &valid);
+        uint8x16_t low = msdkdns_hex_char_to_nibble(chars.val[1], &valid);
+        if (vminvq_u8(valid) != 0xFF) {
+            return false;
+        }
+        vst1q_u8(out, vorrq_u8(vshlq_n_u8(high, 4), low));
+        return true;
+    }
+#elif defined(MSDKDNS_HEX_SSE2)
+    static inline __m128i msdkdns_hex_nibble_to_char(__m128i nibble) {
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(nibble, _mm_set1_epi8(9)), _mm_set1_epi8(39));
+        return _mm_add_epi8(_mm_add_epi8(nibble, _mm_set1_epi8('0')), letter);
+    }
+
+    // SSE2 只有有符号比较，>=0x80 的字符视为负数，不会通过任何区间判断
+    static inline __m128i msdkdns_hex_char_to_nibble(__m128i c, __m128i *valid) {
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                         _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                         _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        *valid = _mm_and_si128(*valid, _mm_or_si128(is_digit, is_alpha));
+        return _mm_or_si128(_mm_and_si128(is_digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+                            _mm_and_si128(is_alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+    }
+
+    // 16位通道内低字节为高4位，高字节为低4位，合并为一个字节
+    static inline __m128i msdkdns_hex_pack_pairs(__m128i nibbles) {
+        __m128i high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4);
+        return _mm_or_si128(high, _mm_srli_epi16(nibbles, 8));
+    }
+
+    static inline void msdkdns_hex_encode_block(const uint8_t *in, char *out) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+        __m128i mask = _mm_set1_epi8(0x0F);
+        __m128i high = msdkdns_hex_nibble_to_char(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i low = msdkdns_hex_nibble_to_char(_mm_and_si128(v, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), _mm_unpackhi_epi8(high, low));
+    }
+
+    static inline bool msdkdns_hex_decode_block(const char *in, uint8_t *out) {
+        __m128i valid = _mm_set1_epi8(-1);
+        __m128i first = msdkdns_hex_char_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)), &valid);
+        __m128i second = msdkdns_hex_char_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 16)), &valid);
+        if (_mm_movemask_epi8(valid) != 0xFFFF) {
+            return false;
+        }
+        __m128i bytes = _mm_packus_epi16(msdkdns_hex_pack_pairs(first), msdkdns_hex_pack_pairs(second));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), bytes);
+        return true;
+    }
+#endif
+
+    void msdkdns_hex_encode(const uint8_t *in, size_t length, char *out) {
+        size_t i = 0;
+#if defined(MSDKDNS_HEX_NEON) || defined(MSDKDNS_HEX_SSE2)
+        for (; i + 16 <= length; i += 16) {
+            msdkdns_hex_encode_block(in + i, out + i * 2);
+        }
+#endif
+        for (; i < length; i++) {
+            out[i * 2] = kMSDKDnsHexDigits[in[i] >> 4];
+            out[i * 2 + 1] = kMSDKDnsHexDigits[in[i] & 0x0F];
+        }
+    }
+
+    bool msdkdns_hex_decode(const char *in, size_t length, uint8_t *out) {
+        if (length % 2 != 0) {
+            return false;
+        }
+        size_t i = 0;
+#if defined(MSDKDNS_HEX_NEON) || defined(MSDKDNS_HEX_SSE2)
+        for (; i + 32 <= length; i += 32) {
+            if (!msdkdns_hex_decode_block(in + i, out + i / 2)) {
+                return false;
+            }
+        }
+#endif
+        for (; i < length; i += 2) {
+            int high = msdkdns_hex_value(static_cast<uint8_t>(in[i]));
+            int low = msdkdns_hex_value(static_cast<uint8_t>(in[i + 1]));
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            out[i / 2] = static_cast<uint8_t>((high << 4) | low);
+        }
+        return true;
+    }
+}  // namespace msdkdns
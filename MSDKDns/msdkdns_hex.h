@@ -0,0 +1,26 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_HEX_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_HEX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace msdkdns {
+
+    /*
+     * 十六进制编解码，arm64 下使用 NEON，x86 模拟器下使用 SSE2，其余平台逐字节处理
+     * 编码输出小写字符，不追加\0，out 需预留 2 * length 字节
+     */
+    void msdkdns_hex_encode(const uint8_t *in, size_t length, char *out);
+
+    /*
+     * 严格解码：length 必须为偶数且只能包含 [0-9a-fA-F]，否则返回 false
+     * out 需预留 length / 2 字节，返回 false 时 out 中的内容无意义
+     */
+    bool msdkdns_hex_decode(const char *in, size_t length, uint8_t *out);
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_HEX_H_
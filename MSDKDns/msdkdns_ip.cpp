@@ -0,0 +1,267 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_ip.h"
+
+#include <string.h>
+#include <sys/socket.h>
+
+namespace msdkdns {
+
+    static const char kMSDKDnsIPHexDigits[] = "0123456789abcdef";
+
+    // 十六进制字符的值，其余字符为 0xFF，查表避免逐字符的区间判断
+    static const uint8_t kMSDKDnsIPHexValues[256] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    };
+
+    // 解析 [begin, end) 中的点分 IPv4，必须恰好用完
+    static bool msdkdns_parse_ipv4_range(const char *p, const char *end, uint8_t *out) {
+        for (int octet = 0; octet < 4; octet++) {
+            if (octet > 0) {
+                if (p == end || *p != '.') {
+                    return false;
+                }
+                p++;
+            }
+            unsigned digit = p < end ? (unsigned)(uint8_t)*p - '0' : 10;
+            if (digit > 9) {
+                return false;
+            }
+            unsigned value = digit;
+            p++;
+            // 每段最多3位，首位为0时不能再有数字
+            for (int i = 0; i < 2 && p < end; i++) {
+                digit = (unsigned)(uint8_t)*p - '0';
+                if (digit > 9) {
+                    break;
+                }
+                if (value == 0) {
+                    return false;
+                }
+                value = value * 10 + digit;
+                p++;
+            }
+            if (value > 255) {
+                return false;
+            }
+            out[octet] = (uint8_t)value;
+        }
+        return p == end;
+    }
+
+    bool msdkdns_parse_ipv4(const char *text, size_t length, uint8_t out[4]) {
+        // 最短 "0.0.0.0"，最长 "255.255.255.255"
+        if (!text || length < 7 || length > 15) {
+            return false;
+        }
+        return msdkdns_parse_ipv4_range(text, text + length, out);
+    }
+
+    bool msdkdns_parse_ipv6(const char *text, size_t length, uint8_t out[16]) {
+        if (!text || length < 2 || length >= kMSDKDnsIPTextSize) {
+            return false;
+        }
+        const char *p = text;
+        const char *end = text + length;
+        // 开头的 : 必须是 ::，第二个 : 在循环中记为压缩位置
+        if (*p == ':' && *++p != ':') {
+            return false;
+        }
+        const char *token = p;
+        int written = 0;
+        int compressed = -1;
+        unsigned value = 0;
+        int digits = 0;
+        while (p < end) {
+            uint8_t c = (uint8_t)*p++;
+            unsigned hex = kMSDKDnsIPHexValues[c];
+            if (hex != 0xFF) {
+                if (++digits > 4) {
+                    return false;
+                }
+                value = (value << 4) | hex;
+                continue;
+            }
+            if (c == ':') {
+                token = p;
+                if (digits == 0) {
+                    if (compressed >= 0) {
+                        return false;
+                    }
+                    compressed = written;
+                    continue;
+                }
+                // 不能以单个 : 结尾
+                if (p == end || written + 2 > 16) {
+                    return false;
+                }
+                out[written++] = (uint8_t)(value >> 8);
+                out[written++] = (uint8_t)value;
+                value = 0;
+                digits = 0;
+                continue;
+            }
+            // 末尾的点分 IPv4 占两组
+            if (c == '.' && written + 4 <= 16 && msdkdns_parse_ipv4_range(token, end, out + written)) {
+                written += 4;
+                digits = 0;
+                break;
+            }
+            return false;
+        }
+        if (digits > 0) {
+            if (written + 2 > 16) {
+                return false;
+            }
+            out[written++] = (uint8_t)(value >> 8);
+            out[written++] = (uint8_t)value;
+        }
+        if (compressed >= 0) {
+            // :: 至少代表一组
+            if (written == 16) {
+                return false;
+            }
+            int tail = written - compressed;
+            memmove(out + 16 - tail, out + compressed, tail);
+            memset(out + compressed, 0, 16 - written);
+            written = 16;
+        }
+        return written == 16;
+    }
+
+    int msdkdns_parse_ip(const char *text, size_t length, uint8_t out[16]) {
+        if (msdkdns_parse_ipv4(text, length, out)) {
+            return AF_INET;
+        }
+        if (msdkdns_parse_ipv6(text, length, out)) {
+            return AF_INET6;
+        }
+        return 0;
+    }
+
+    static inline char *msdkdns_format_octet(uint8_t value, char *out) {
+        if (value >= 100) {
+            *out++ = (char)('0' + value / 100);
+            value %= 100;
+            *out++ = (char)('0' + value / 10);
+        } else if (value >= 10) {
+            *out++ = (char)('0' + value / 10);
+        }
+        *out++ = (char)('0' + value % 10);
+        return out;
+    }
+
+    size_t msdkdns_format_ipv4(const uint8_t in[4], char *out) {
+        char *p = msdkdns_format_octet(in[0], out);
+        for (int i = 1; i < 4; i++) {
+            *p++ = '.';
+            p = msdkdns_format_octet(in[i], p);
+        }
+        *p = '\0';
+        return p - out;
+    }
+
+    size_t msdkdns_format_ipv6(const uint8_t in[16], char *out) {
+        uint16_t words[8];
+        for (int i = 0; i < 8; i++) {
+            words[i] = (uint16_t)((in[2 * i] << 8) | in[2 * i + 1]);
+        }
+        // 找出最长的连续全0组，长度相同时取靠前的
+        int best_base = -1;
+        int best_length = 0;
+        int base = -1;
+        for (int i = 0; i <= 8; i++) {
+            if (i < 8 && words[i] == 0) {
+                if (base < 0) {
+                    base = i;
+                }
+                continue;
+            }
+            if (base >= 0 && i - base > best_length) {
+                best_base = base;
+                best_length = i - base;
+            }
+            base = -1;
+        }
+        if (best_length < 2) {
+            best_base = -1;
+        }
+        char *p = out;
+        for (int i = 0; i < 8; i++) {
+            if (best_base >= 0 && i >= best_base && i < best_base + best_length) {
+                if (i == best_base) {
+                    *p++ = ':';
+                }
+                continue;
+            }
+            if (i > 0) {
+                *p++ = ':';
+            }
+            // 与 inet_ntop 一致，兼容地址 ::a.b.c.d 及映射地址 ::ffff:a.b.c.d 末尾输出 IPv4
+            if (i == 6 && best_base == 0 && (best_length == 6 || (best_length == 5 && words[5] == 0xFFFF))) {
+                p += msdkdns_format_ipv4(in + 12, p);
+                return p - out;
+            }
+            uint16_t word = words[i];
+            int shift = word >= 0x1000 ? 12 : word >= 0x100 ? 8 : word >= 0x10 ? 4 : 0;
+            for (; shift >= 0; shift -= 4) {
+                *p++ = kMSDKDnsIPHexDigits[(word >> shift) & 0x0F];
+            }
+        }
+        if (best_base >= 0 && best_base + best_length == 8) {
+            *p++ = ':';
+        }
+        *p = '\0';
+        return p - out;
+    }
+
+    size_t msdkdns_format_ip(int family, const uint8_t *in, char *out) {
+        if (family == AF_INET) {
+            return msdkdns_format_ipv4(in, out);
+        }
+        if (family == AF_INET6) {
+            return msdkdns_format_ipv6(in, out);
+        }
+        out[0] = '\0';
+        return 0;
+    }
+
+    bool AddressSet::Insert(int family, const uint8_t *bytes) {
+        size_t size = family == AF_INET6 ? 16 : 4;
+        for (size_t i = 0; i < addresses_.size(); i++) {
+            const Address &address = addresses_[i];
+            if (address.family == family && memcmp(address.bytes, bytes, size) == 0) {
+                return false;
+            }
+        }
+        Address address;
+        memset(&address, 0, sizeof(address));
+        address.family = (uint8_t)family;
+        memcpy(address.bytes, bytes, size);
+        addresses_.push_back(address);
+        return true;
+    }
+
+    bool AddressSet::InsertText(const char *text, size_t length) {
+        uint8_t bytes[16];
+        int family = msdkdns_parse_ip(text, length, bytes);
+        return family != 0 && Insert(family, bytes);
+    }
+}  // namespace msdkdns
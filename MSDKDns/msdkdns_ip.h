@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_IP_H_
+#define HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_IP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace msdkdns {
+
+    // 格式化输出需预留的字节数，与 INET6_ADDRSTRLEN 相同，含结尾的\0
+    static const size_t kMSDKDnsIPTextSize = 46;
+
+    /*
+     * 解析IP文本为网络字节序的二进制地址，接受的格式与 inet_pton 一致：
+     * IPv4 为四段十进制，每段不超过255且不能有前导0；IPv6 每组最多4位十六进制，最多一处 ::，末尾可为点分 IPv4
+     * text 不要求以\0结尾，length 之内出现其他字符（含空白、\0、scope id）均视为不合法
+     * 失败时 out 中的内容无意义
+     */
+    bool msdkdns_parse_ipv4(const char *text, size_t length, uint8_t out[4]);
+    bool msdkdns_parse_ipv6(const char *text, size_t length, uint8_t out[16]);
+    // 先按 IPv4 再按 IPv6 解析，返回 AF_INET / AF_INET6，不合法时返回0
+    int msdkdns_parse_ip(const char *text, size_t length, uint8_t out[16]);
+
+    /*
+     * 格式化为与 iOS inet_ntop 相同的文本：IPv6 小写、省略前导0、最长的连续全0组（至少两组）压缩为 ::，
+     * ::a.b.c.d 及 ::ffff:a.b.c.d 形式的地址末尾输出点分 IPv4
+     * 追加\0，返回不含\0的长度，out 需预留 kMSDKDnsIPTextSize 字节
+     */
+    size_t msdkdns_format_ipv4(const uint8_t in[4], char *out);
+    size_t msdkdns_format_ipv6(const uint8_t in[16], char *out);
+    // family 不是 AF_INET / AF_INET6 时返回0，out 为空字符串
+    size_t msdkdns_format_ip(int family, const uint8_t *in, char *out);
+
+    /*
+     * 按二进制地址去重，同一地址的不同写法（如 IPv6 大小写、是否压缩）视为相同
+     * 单个域名的地址通常只有几个，线性比较比哈希更快
+     */
+    class AddressSet {
+    public:
+        AddressSet() {}
+
+        // 地址未出现过时加入并返回 true
+        bool Insert(int family, const uint8_t *bytes);
+        // 解析后加入，不合法或已出现过时返回 false
+        bool InsertText(const char *text, size_t length);
+        size_t Size() const { return addresses_.size(); }
+        void Clear() { addresses_.clear(); }
+
+    private:
+        struct Address {
+            uint8_t family;
+            uint8_t bytes[16];
+        };
+
+        std::vector<Address> addresses_;
+
+        AddressSet(const AddressSet &);
+        AddressSet &operator=(const AddressSet &);
+    };
+}  // namespace msdkdns
+
+#endif  // HTTPDNS_SDK_IOS_MSDKDNS_MSDKDNS_IP_H_
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// AES 吞吐：同一份代码分别链接 T-table 实现（aes_bench）和参考实现（aes_reference_bench）
+// aes_bench 依次切换到本机支持的每个后端（T-table、AES-NI、ARMv8）测一遍
+// enc/dec 为单块接口（每次调用转换轮密钥，dec 还要重新扩展解密密钥），cbc 为旧的 CBC 接口，
+// ctx 为 SDK 实际使用的 AesCbcContext 接口（轮密钥预先展开）
+// 另测 AesCryptWithKey 每次调用的耗时，以及每次重新做密钥扩展时的对照
+
+#include "aes.h"
+#include "msdkdns_bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace self_dns;
+
+static double BlockMBps(int keysize, bool decrypt, int blocks) {
+    BYTE key[32], block[16];
+    WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+    memset(key, 0x5A, sizeof(key));
+    memset(block, 0x33, sizeof(block));
+    AesKeySetup(key, schedule, keysize);
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int i = 0; i < blocks; i++) {
+        if (decrypt) {
+            AesDecrypt(block, block, schedule, keysize);
+        } else {
+            AesEncrypt(block, block, schedule, keysize);
+        }
+    }
+    msdkdns_bench_keep(block);
+    return blocks * 16.0 / 1e6 / ((msdkdns_bench_now_ns() - begin) / 1e9);
+}
+
+static double CbcMBps(int keysize, bool decrypt, size_t length, int rounds) {
+    BYTE key[32], iv[16];
+    WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+    memset(key, 0x5A, sizeof(key));
+    memset(iv, 0x11, sizeof(iv));
+    AesKeySetup(key, schedule, keysize);
+    std::vector<BYTE> in(length, 0x42), out(length);
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        if (decrypt) {
+            AesDecryptCbc(&in[0], length, &out[0], schedule, keysize, iv);
+        } else {
+            AesEncryptCbc(&in[0], length, &out[0], schedule, keysize, iv);
+        }
+    }
+    msdkdns_bench_keep(out[0]);
+    return rounds * static_cast<double>(length) / 1e6 / ((msdkdns_bench_now_ns() - begin) / 1e9);
+}
+
+static double ContextMBps(int keysize, bool decrypt, size_t length, int rounds) {
+    BYTE key[32], iv[16];
+    memset(key, 0x5A, sizeof(key));
+    memset(iv, 0x11, sizeof(iv));
+    AesCbcContext context;
+    AesCbcInit(&context, key, keysize);
+    std::vector<BYTE> buffer(length + AES_BLOCK_SIZE, 0x42);
+    size_t out_length = 0;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        if (decrypt) {
+            // 填充不合法时也已解密完整个 Buffer，不影响计时
+            AesCbcDecryptInPlace(&context, &buffer[0], length, iv, &out_length);
+        } else {
+            AesCbcEncryptPkcs7(&context, &buffer[0], length - AES_BLOCK_SIZE, &buffer[0], iv, &out_length);
+        }
+    }
+    msdkdns_bench_keep(buffer[0]);
+    return rounds * static_cast<double>(length) / 1e6 / ((msdkdns_bench_now_ns() - begin) / 1e9);
+}
+
+// 返回每次调用的纳秒数；rekey 为 true 时模拟每次调用都重新扩展密钥
+static double CryptNs(size_t length, bool rekey, int rounds) {
+    BYTE key[16], iv[16];
+    memset(key, 0x5A, sizeof(key));
+    memset(iv, 0x11, sizeof(iv));
+    std::vector<BYTE> plain(length, 0x42);
+    std::vector<BYTE> cipher(AesGetOutLen(static_cast<int>(length), AES_ENCRYPT));
+    std::vector<BYTE> out(cipher.size() + 1);
+    AesCryptWithKey(&plain[0], length, &cipher[0], AES_ENCRYPT, key, iv);
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        if (rekey) {
+            AesCbcContext context;
+            AesCbcInit(&context, key, AES_KEY_SIZE);
+            memcpy(&out[0], &cipher[0], cipher.size());
+            size_t out_length = 0;
+            AesCbcDecryptInPlace(&context, &out[0], cipher.size(), iv, &out_length);
+        } else {
+            AesCryptWithKey(&cipher[0], cipher.size(), &out[0], AES_DECRYPT, key, iv);
+        }
+    }
+    msdkdns_bench_keep(out[0]);
+    return static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    int blocks = quick ? 10000 : 2000000;
+    int rounds = quick ? 20 : 2000;
+    int detected = AesBackend();
+    printf("detected backend: %s, MB/s\n", AesBackendName(detected));
+    printf("%-10s %-8s %9s %9s %9s %9s %9s %9s\n", "backend", "keysize", "enc", "dec", "cbc enc", "cbc dec",
+           "ctx enc", "ctx dec");
+    static const int kKeySizes[] = {128, 192, 256};
+    for (int backend = 0; backend < AES_BACKEND_COUNT; backend++) {
+        if (!AesSetBackend(backend)) {
+            continue;
+        }
+        for (int i = 0; i < 3; i++) {
+            int keysize = kKeySizes[i];
+            printf("%-10s %-8d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", AesBackendName(backend), keysize,
+                   BlockMBps(keysize, false, blocks), BlockMBps(keysize, true, blocks),
+                   CbcMBps(keysize, false, 8192, rounds), CbcMBps(keysize, true, 8192, rounds),
+                   ContextMBps(keysize, false, 8192, rounds), ContextMBps(keysize, true, 8192, rounds));
+        }
+    }
+    AesSetBackend(detected);
+    int calls = quick ? 200 : 200000;
+    printf("%-8s %20s %20s\n", "bytes", "AesCryptWithKey ns", "rekey each call ns");
+    static const size_t kLengths[] = {64, 1024, 8192};
+    for (int i = 0; i < 3; i++) {
+        int n = kLengths[i] > 1024 ? calls / 10 : calls;
+        printf("%-8zu %20.0f %20.0f\n", kLengths[i], CryptNs(kLengths[i], false, n), CryptNs(kLengths[i], true, n));
+    }
+    return 0;
+}
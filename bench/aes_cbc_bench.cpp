@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 单域名（小包）和批量（大包）响应的每次解密耗时
+// 对照组模拟原 AesCryptWithKey + aesCryptWithKey: 的做法：每次扩展密钥，拷贝一份输入，另分配输出后再拷贝
+
+#include "aes.h"
+#include "msdkdns_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace self_dns;
+
+static const BYTE kKey[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                              0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const BYTE kIv[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+static size_t CopyDecrypt(const std::vector<BYTE> &cipher) {
+    WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+    AesKeySetup(kKey, schedule, 128);
+    BYTE *input = static_cast<BYTE *>(malloc(cipher.size()));
+    memset(input, 0, cipher.size());
+    memcpy(input, &cipher[0], cipher.size());
+    BYTE *plain = static_cast<BYTE *>(malloc(cipher.size()));
+    AesDecryptCbc(input, cipher.size(), plain, schedule, 128, kIv);
+    size_t length = cipher.size() - plain[cipher.size() - 1];
+    BYTE *out = static_cast<BYTE *>(calloc(length + 1, 1));
+    memcpy(out, plain, length);
+    size_t result = out[0] + length;
+    free(out);
+    free(plain);
+    free(input);
+    return result;
+}
+
+static size_t InPlaceDecrypt(const AesCbcContext *context, const std::vector<BYTE> &cipher, std::vector<BYTE> *buffer) {
+    // 调用方通常直接在收到的响应 Buffer 上解密，这里先恢复密文
+    memcpy(&(*buffer)[0], &cipher[0], cipher.size());
+    size_t length = 0;
+    AesCbcDecryptInPlace(context, &(*buffer)[0], cipher.size(), kIv, &length);
+    return length;
+}
+
+static size_t StreamDecrypt(const AesCbcContext *context, const std::vector<BYTE> &cipher, std::vector<BYTE> *buffer) {
+    AesCbcDecryptStream stream;
+    AesCbcDecryptStart(&stream, context, kIv);
+    size_t produced = 0;
+    // 按 1KB 分片模拟网络分段到达
+    for (size_t offset = 0; offset < cipher.size(); offset += 1024) {
+        size_t chunk = cipher.size() - offset < 1024 ? cipher.size() - offset : 1024;
+        size_t written = 0;
+        AesCbcDecryptUpdate(&stream, &cipher[offset], chunk, &(*buffer)[produced], &written);
+        produced += written;
+    }
+    size_t written = 0;
+    AesCbcDecryptFinal(&stream, &(*buffer)[produced], &written);
+    return produced + written;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    AesCbcContext context;
+    AesCbcInit(&context, kKey, 128);
+    printf("%-8s %16s %16s %16s\n", "bytes", "copy+rekey ns", "in-place ns", "stream ns");
+    static const size_t kLengths[] = {48, 256, 8192, 65536};
+    for (size_t i = 0; i < sizeof(kLengths) / sizeof(kLengths[0]); i++) {
+        size_t length = kLengths[i];
+        int rounds = quick ? 10 : static_cast<int>(20000000 / (length + 256));
+        std::vector<BYTE> plain(length, 'a');
+        std::vector<BYTE> cipher(AesGetOutLen(static_cast<int>(length), AES_ENCRYPT));
+        size_t cipher_length = 0;
+        AesCbcEncryptPkcs7(&context, &plain[0], length, &cipher[0], kIv, &cipher_length);
+        std::vector<BYTE> buffer(cipher.size() + AES_BLOCK_SIZE);
+        size_t sum = 0;
+
+        int64_t begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            sum += CopyDecrypt(cipher);
+        }
+        double copy = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            sum += InPlaceDecrypt(&context, cipher, &buffer);
+        }
+        double in_place = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            sum += StreamDecrypt(&context, cipher, &buffer);
+        }
+        double stream = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+        msdkdns_bench_keep(sum);
+        printf("%-8zu %16.0f %16.0f %16.0f\n", length, copy, in_place, stream);
+    }
+    return 0;
+}
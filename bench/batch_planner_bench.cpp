@@ -0,0 +1,211 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 解析请求合批：多个线程持续产生未命中，经 BatchPlanner 合批后通过 HttpPool 向本地模拟服务端发出 /d 请求
+// 对比不同合批窗口、批次域名数上限下服务端收到的请求数与调用方的平均、p99 等待时间
+
+#include "msdkdns_batch_planner.h"
+#include "msdkdns_http_pool.h"
+#include "msdkdns_timer_wheel.h"
+#include "msdkdns_bench.h"
+#include "msdkdns_mock_server.h"
+#include <stdio.h>
+#include <algorithm>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msdkdns;
+
+static const int kServerDelayMs = 20;
+static const int kTimeoutMs = 2000;
+static const int kDomainCount = 256;
+
+// 与 MSDKDnsBatchPlanner 相同的用法：串行访问 BatchPlanner，定时器线程负责窗口到期
+class BenchPlanner {
+public:
+    BenchPlanner(HttpPool *pool, uint16_t port, int64_t window_ms, size_t max_domains)
+        : pool_(pool), port_(port), stop_(false) {
+        planner_.SetLimits(window_ms, max_domains, 0);
+        timer_ = std::thread(&BenchPlanner::TimerLoop, this);
+    }
+
+    ~BenchPlanner() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        timer_.join();
+    }
+
+    void Resolve(const std::string &domain) {
+        std::promise<void> done;
+        std::vector<msdkdns_batch> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            int64_t now = msdkdns_monotonic_ms();
+            int64_t flush_ms = -1;
+            uint64_t call = planner_.Add("4||normal", std::vector<std::string>(1, domain), now, now + kTimeoutMs,
+                                         &ready, &flush_ms);
+            waiters_[call] = &done;
+            if (flush_ms >= 0) {
+                cond_.notify_all();
+            }
+            Take(&ready);
+        }
+        Send(&ready);
+        done.get_future().wait();
+    }
+
+private:
+    typedef std::vector<std::promise<void> *> Flight;
+
+    // 取出批次内调用方的等待对象，需持有 mutex_
+    void Take(std::vector<msdkdns_batch> *ready) {
+        for (size_t i = 0; i < ready->size(); i++) {
+            Flight *flight = new Flight();
+            for (size_t k = 0; k < (*ready)[i].calls.size(); k++) {
+                flight->push_back(waiters_[(*ready)[i].calls[k]]);
+                waiters_.erase((*ready)[i].calls[k]);
+            }
+            (*ready)[i].calls.assign(1, reinterpret_cast<uintptr_t>(flight));
+        }
+    }
+
+    void Send(std::vector<msdkdns_batch> *ready) {
+        for (size_t i = 0; i < ready->size(); i++) {
+            std::string target = "/d?dn=";
+            for (size_t k = 0; k < (*ready)[i].domains.size(); k++) {
+                target += (k > 0 ? "," : "") + (*ready)[i].domains[k];
+            }
+            Flight *flight = reinterpret_cast<Flight *>(static_cast<uintptr_t>((*ready)[i].calls[0]));
+            if (pool_->Get("127.0.0.1", port_, target, kTimeoutMs, &BenchPlanner::OnResponse, flight) == 0) {
+                OnResponse(flight, NULL);
+            }
+        }
+    }
+
+    static void OnResponse(void *context, const msdkdns_http_response *) {
+        Flight *flight = static_cast<Flight *>(context);
+        for (size_t i = 0; i < flight->size(); i++) {
+            (*flight)[i]->set_value();
+        }
+        delete flight;
+    }
+
+    void TimerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            int64_t next = planner_.NextFlush();
+            if (next < 0) {
+                cond_.wait(lock);
+                continue;
+            }
+            int64_t now = msdkdns_monotonic_ms();
+            if (next > now) {
+                cond_.wait_for(lock, std::chrono::milliseconds(next - now));
+                continue;
+            }
+            std::vector<msdkdns_batch> ready;
+            planner_.Expire(now, &ready);
+            Take(&ready);
+            lock.unlock();
+            Send(&ready);
+            lock.lock();
+        }
+    }
+
+    HttpPool *pool_;
+    uint16_t port_;
+    BatchPlanner planner_;
+    std::map<uint64_t, std::promise<void> *> waiters_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_;
+    std::thread timer_;
+};
+
+static std::string Answer(const std::string &target) {
+    std::string body;
+    size_t begin = target.find("dn=");
+    if (begin == std::string::npos) {
+        return body;
+    }
+    std::string names = target.substr(begin + 3);
+    size_t count = std::count(names.begin(), names.end(), ',') + 1;
+    for (size_t i = 0; i < count; i++) {
+        body += "1.1.1.1;2.2.2.2,60\n";
+    }
+    return body;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    MockHttpServer server(Answer);
+    if (!server.Start()) {
+        printf("mock server failed to start\n");
+        return 1;
+    }
+    server.set_delay_ms(kServerDelayMs);
+    // 与 MSDKDnsHttpClient 相同的连接池配置
+    HttpPool pool(2, 4);
+    pool.Start();
+
+    int threads = 8;
+    int calls_per_thread = quick ? 4 : 200;
+    printf("server delay %dms, %d threads x %d misses, think time 0-4ms\n", kServerDelayMs, threads,
+           calls_per_thread);
+    printf("%-10s %-12s %10s %10s %10s %10s\n", "window ms", "max domains", "requests", "calls/req", "mean ms",
+           "p99 ms");
+    static const int64_t kWindows[] = {0, 2, 5, 10};
+    static const size_t kMaxDomains[] = {0, 4, 16};
+    for (size_t w = 0; w < sizeof(kWindows) / sizeof(kWindows[0]); w++) {
+        for (size_t m = 0; m < sizeof(kMaxDomains) / sizeof(kMaxDomains[0]); m++) {
+            if (kWindows[w] == 0 && m > 0) {
+                continue;
+            }
+            BenchPlanner planner(&pool, server.port(), kWindows[w], kMaxDomains[m]);
+            uint32_t requests = server.requests();
+            std::vector<std::vector<double> > latencies(threads);
+            std::vector<std::thread> clients;
+            for (int t = 0; t < threads; t++) {
+                clients.push_back(std::thread([&, t]() {
+                    std::mt19937 random(t * 7919 + 1);
+                    for (int i = 0; i < calls_per_thread; i++) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(random() % 4000));
+                        char domain[32];
+                        snprintf(domain, sizeof(domain), "d%u.example.com", (unsigned)(random() % kDomainCount));
+                        int64_t begin = msdkdns_bench_now_ns();
+                        planner.Resolve(domain);
+                        latencies[t].push_back((msdkdns_bench_now_ns() - begin) / 1e6);
+                    }
+                }));
+            }
+            for (int t = 0; t < threads; t++) {
+                clients[t].join();
+            }
+            std::vector<double> all;
+            double sum = 0;
+            for (int t = 0; t < threads; t++) {
+                all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+            }
+            for (size_t i = 0; i < all.size(); i++) {
+                sum += all[i];
+            }
+            std::sort(all.begin(), all.end());
+            uint32_t sent = server.requests() - requests;
+            printf("%-10lld %-12zu %10u %10.2f %10.1f %10.1f\n", (long long)kWindows[w], kMaxDomains[m], sent,
+                   sent ? (double)all.size() / sent : 0.0, sum / all.size(), all[all.size() * 99 / 100]);
+        }
+    }
+    pool.Stop();
+    server.Stop();
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 切换缓存分区时持久化缓存的写入开销：前台期间在两个网络之间切换 switches 次后进入后台
+// full：修改前的做法，每次切换清空整张表后重写目标分区的全部域名，待写入数超过阈值立即落盘
+// diff：每次切换只在 DBWriter 中 RemoveAll 后写入目标分区，进入后台时落盘一次，
+//       与表中已有的行比较，内容相同的不重写，相同的行少于要删除的行时退回整表删除
+// 两个网络各 kDomains 个域名，共有 80%；两个网络各自解析的结果过期时间不同，共有域名的行内容也都不同
+// 表内容有变化时进入后台需要整体重新生成一次快照，snapshot 为是否需要重新生成，rewrite ms 为其耗时
+
+#include "msdkdns_db_writer.h"
+#include "msdkdns_snapshot.h"
+#include "msdkdns_bench.h"
+#include "msdkdns_temp_db.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static const double kShared = 0.8;
+
+static std::vector<msdkdns_db_row> Partition(int network, int count) {
+    std::vector<msdkdns_db_row> rows;
+    int shared_count = static_cast<int>(count * kShared);
+    char buf[64];
+    for (int i = 0; i < count; i++) {
+        msdkdns_db_row row;
+        snprintf(buf, sizeof(buf), i < shared_count ? "s%d.example.com" : "n%d-%d.example.com", i, network);
+        row.domain = buf;
+        snprintf(buf, sizeof(buf), "10.%d.%d.%d,10.%d.%d.1", i % 200, network, i % 7, i % 3, i % 5);
+        row.columns[MSDKDNS_EDBColumn_IPV4IPs] = buf;
+        row.columns[MSDKDNS_EDBColumn_IPV4Channel] = "http";
+        row.columns[MSDKDNS_EDBColumn_IPV4ClientIP] = "1.2.3.4";
+        row.columns[MSDKDNS_EDBColumn_IPV4TimeConsuming] = "23";
+        row.columns[MSDKDNS_EDBColumn_IPV4TTL] = "600";
+        snprintf(buf, sizeof(buf), "%d", 1700000600 + network * 37);
+        row.columns[MSDKDNS_EDBColumn_IPV4TTLExpried] = buf;
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+// 修改前 DBWriter 在 RemoveAll 后的落盘：一个事务内整表删除后逐行写入
+static void Full(sqlite3 *db, sqlite3_stmt *upsert, const std::vector<msdkdns_db_row> &rows) {
+    sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION", NULL, NULL, NULL);
+    sqlite3_exec(db, "DELETE FROM HttpDNSTable", NULL, NULL, NULL);
+    for (size_t r = 0; r < rows.size(); r++) {
+        sqlite3_bind_text(upsert, 1, rows[r].domain.c_str(), -1, SQLITE_STATIC);
+        for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+            sqlite3_bind_text(upsert, i + 2, rows[r].columns[i].c_str(), -1, SQLITE_STATIC);
+        }
+        sqlite3_step(upsert);
+        sqlite3_reset(upsert);
+    }
+    sqlite3_exec(db, "COMMIT TRANSACTION", NULL, NULL, NULL);
+}
+
+static double Ms(int64_t begin) {
+    return (msdkdns_bench_now_ns() - begin) / 1e6;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    int count = quick ? 100 : 500;
+    int sessions = quick ? 2 : 20;
+    static const int kSwitches[] = {1, 2, 5, 6};
+    std::vector<msdkdns_db_row> partitions[2] = {Partition(0, count), Partition(1, count)};
+    printf("%d domains per network, %.0f%% shared, %d sessions\n", count, kShared * 100, sessions);
+    printf("%-6s %9s %14s %14s %10s %12s\n", "mode", "switches", "rows/session", "ms/session", "snapshot",
+           "rewrite ms");
+    for (size_t c = 0; c < sizeof(kSwitches) / sizeof(kSwitches[0]); c++) {
+        int switches = kSwitches[c];
+        for (int mode = 0; mode < 2; mode++) {
+            TempDB temp;
+            DBWriter writer(temp.db(), count * 4);
+            sqlite3_stmt *upsert = NULL;
+            sqlite3_prepare_v2(temp.db(),
+                               "INSERT OR REPLACE into HttpDNSTable (domain, httpDnsIPV4Channel, httpDnsIPV4ClientIP, "
+                               "httpDnsIPV4IPs, httpDnsIPV4TimeConsuming, httpDnsIPV4TTL, httpDnsIPV4TTLExpried, "
+                               "httpDnsIPV6Channel, httpDnsIPV6ClientIP, httpDnsIPV6IPs, httpDnsIPV6TimeConsuming, "
+                               "httpDnsIPV6TTL, httpDnsIPV6TTLExpried) values(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                               -1, &upsert, NULL);
+            size_t rows = 0;
+            double ms = 0;
+            bool changed = false;
+            for (int s = 0; s < sessions; s++) {
+                // 每次进入前台时表中为网络0的分区
+                Full(temp.db(), upsert, partitions[0]);
+                int changes = sqlite3_total_changes(temp.db());
+                int64_t begin = msdkdns_bench_now_ns();
+                for (int i = 1; i <= switches; i++) {
+                    const std::vector<msdkdns_db_row> &target = partitions[i % 2];
+                    if (mode == 0) {
+                        Full(temp.db(), upsert, target);
+                    } else {
+                        writer.RemoveAll();
+                        for (size_t r = 0; r < target.size(); r++) {
+                            writer.Put(target[r]);
+                        }
+                    }
+                }
+                if (mode == 1) {
+                    writer.Flush();
+                }
+                ms += Ms(begin);
+                rows += static_cast<size_t>(sqlite3_total_changes(temp.db()) - changes);
+                // 修改前每次清空重写都会使快照失效
+                changed = mode == 0 || writer.LastChanges() > 0;
+            }
+            sqlite3_finalize(upsert);
+            int64_t begin = msdkdns_bench_now_ns();
+            msdkdns_snapshot_write_from_db(temp.db(), temp.File("httpdns.snapshot"));
+            double rewrite_ms = Ms(begin);
+            printf("%-6s %9d %14.1f %14.3f %10s %12.3f\n", mode ? "diff" : "full", switches,
+                   static_cast<double>(rows) / sessions, ms / sessions, changed ? "yes" : "no", rewrite_ms);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 域名缓存查询吞吐随读线程数的变化，spread 为各线程查不同的域名，hot 为所有线程只查同一个域名
+// striped：DomainCache::Find，读者只锁本线程对应的一条读锁，命中统计记在该条中
+// rwlock：对照，同样的 16 个分片各用一把读写锁，命中统计为分片共用的原子计数（此前的实现），
+//         hot 时所有读者都写同一把锁和同一个计数器所在的缓存行
+// unlocked：同样数据的 EntryStore::Peek，不加锁不计数（只读时安全），为无锁读者能达到的上限
+// 三者命中时都读一次单调时钟判断过期
+// copy：模拟最初的实现，串行队列（全局锁）中拷贝整个域名字典后查找
+
+#include "msdkdns_domain_cache.h"
+#include "msdkdns_bench.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msdkdns;
+
+static const size_t kShards = 16;
+
+static std::string Domain(size_t i) {
+    return "host" + std::to_string(i) + ".example.com";
+}
+
+static void Touch(const EntryStore *, const msdkdns_entry_view &view, void *context) {
+    *static_cast<size_t *>(context) += view.payload_length;
+}
+
+class RwlockCache {
+public:
+    explicit RwlockCache(size_t budget) {
+        for (size_t i = 0; i < kShards; i++) {
+            pthread_rwlock_init(&locks_[i], NULL);
+            stores_[i] = new EntryStore(budget / kShards);
+        }
+    }
+
+    ~RwlockCache() {
+        for (size_t i = 0; i < kShards; i++) {
+            delete stores_[i];
+            pthread_rwlock_destroy(&locks_[i]);
+        }
+    }
+
+    void Put(uint32_t partition, const msdkdns_domain_key &key, const std::string &payload) {
+        size_t shard = key.hash & (kShards - 1);
+        pthread_rwlock_wrlock(&locks_[shard]);
+        stores_[shard]->Put(partition, key, 1, 2, 0, std::vector<std::string>(),
+                            reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+        pthread_rwlock_unlock(&locks_[shard]);
+    }
+
+    bool Find(uint32_t partition, const msdkdns_domain_key &key, size_t *sum) {
+        size_t shard = key.hash & (kShards - 1);
+        msdkdns_entry_view view;
+        pthread_rwlock_rdlock(&locks_[shard]);
+        bool found = stores_[shard]->Find(partition, key, &view);
+        if (found) {
+            // 与 DomainCache::Find 一样每次命中读一次时钟判断过期
+            view.flags |= view.expired_ms <= msdkdns_monotonic_ms() ? MSDKDNS_EEntryFlag_Expired : 0;
+            Touch(stores_[shard], view, sum);
+        }
+        pthread_rwlock_unlock(&locks_[shard]);
+        return found;
+    }
+
+    bool Peek(uint32_t partition, const msdkdns_domain_key &key, size_t *sum) const {
+        const EntryStore *store = stores_[key.hash & (kShards - 1)];
+        msdkdns_entry_view view;
+        bool found = store->Peek(partition, key, &view);
+        if (found) {
+            view.flags |= view.expired_ms <= msdkdns_monotonic_ms() ? MSDKDNS_EEntryFlag_Expired : 0;
+            Touch(store, view, sum);
+        }
+        return found;
+    }
+
+private:
+    pthread_rwlock_t locks_[kShards];
+    EntryStore *stores_[kShards];
+};
+
+enum Mode {
+    kStriped,
+    kRwlock,
+    kUnlocked,
+};
+
+// 返回每秒查询数（百万）
+static double Run(Mode mode, DomainCache *cache, RwlockCache *reference, uint32_t partition,
+                  const std::vector<msdkdns_domain_key> &keys, int threads, size_t ops, bool hot) {
+    std::vector<std::thread> workers;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([=]() {
+            size_t sum = 0;
+            for (size_t i = 0; i < ops; i++) {
+                const msdkdns_domain_key &key = keys[hot ? 0 : (i * 7919 + t * 104729) % keys.size()];
+                if (mode == kStriped) {
+                    cache->Find(partition, key, Touch, &sum);
+                } else if (mode == kRwlock) {
+                    reference->Find(partition, key, &sum);
+                } else {
+                    reference->Peek(partition, key, &sum);
+                }
+            }
+            msdkdns_bench_keep(sum);
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    return threads * ops / ((msdkdns_bench_now_ns() - begin) / 1e9) / 1e6;
+}
+
+static double RunCopy(std::mutex *lock, const std::map<std::string, std::string> *dict,
+                      const std::vector<std::string> &domains, int threads, size_t ops) {
+    std::vector<std::thread> workers;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([=]() {
+            size_t sum = 0;
+            for (size_t i = 0; i < ops; i++) {
+                std::map<std::string, std::string> copy;
+                {
+                    std::lock_guard<std::mutex> guard(*lock);
+                    copy = *dict;
+                }
+                std::map<std::string, std::string>::const_iterator it =
+                    copy.find(domains[(i * 7919 + t * 104729) % domains.size()]);
+                sum += it == copy.end() ? 0 : it->second.size();
+            }
+            msdkdns_bench_keep(sum);
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    return threads * ops / ((msdkdns_bench_now_ns() - begin) / 1e9);
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    size_t domains = quick ? 1000 : 10000;
+    size_t ops = quick ? 20000 : 1000000;
+    size_t copy_ops = quick ? 20 : 200;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = quick ? 2 : static_cast<int>(cpus > 2 ? cpus * 2 : 4);
+
+    DomainCache cache(kShards, 64 << 20);
+    RwlockCache reference(64 << 20);
+    uint32_t partition = cache.NewPartition();
+    std::vector<msdkdns_domain_key> keys;
+    std::vector<std::string> names;
+    std::map<std::string, std::string> dict;
+    std::string payload(96, 'p');
+    for (size_t i = 0; i < domains; i++) {
+        std::string name = Domain(i);
+        msdkdns_domain_key key;
+        msdkdns_domain_interner()->Intern(name.data(), name.size(), &key);
+        cache.Put(partition, key, 1, 2, 0, std::vector<std::string>(),
+                  reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+        reference.Put(partition, key, payload);
+        keys.push_back(key);
+        names.push_back(name);
+        dict[name] = payload;
+    }
+    std::mutex lock;
+    printf("%zu domains, %ld cpus, M lookups/s except copy\n", domains, cpus);
+    printf("%-8s %9s %9s %9s %9s %9s %9s %9s\n", "threads", "striped", "rwlock", "unlocked", "hot strp",
+           "hot rwlk", "hot unlk", "copy K/s");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double striped = Run(kStriped, &cache, &reference, partition, keys, threads, ops, false);
+        double rwlock = Run(kRwlock, &cache, &reference, partition, keys, threads, ops, false);
+        double unlocked = Run(kUnlocked, &cache, &reference, partition, keys, threads, ops, false);
+        double hot_striped = Run(kStriped, &cache, &reference, partition, keys, threads, ops, true);
+        double hot_rwlock = Run(kRwlock, &cache, &reference, partition, keys, threads, ops, true);
+        double hot_unlocked = Run(kUnlocked, &cache, &reference, partition, keys, threads, ops, true);
+        double copy = RunCopy(&lock, &dict, names, threads, copy_ops);
+        printf("%-8d %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.3f\n", threads, striped, rwlock, unlocked, hot_striped,
+               hot_rwlock, hot_unlocked, copy / 1e3);
+    }
+    msdkdns_entry_stats stats;
+    cache.Stats(&stats);
+    // 每次查询都命中，统计需与查询次数一致
+    uint64_t expected = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        expected += 2ull * threads * ops;
+    }
+    if (stats.hits != expected || stats.misses != 0) {
+        printf("hit count mismatch: %llu vs %llu\n", (unsigned long long)stats.hits, (unsigned long long)expected);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 字符串键与驻留编号键的查询开销
+// 每次查询与解析流程一样查三张表（缓存、负缓存、延迟刷新标记），输入为大小写混合的域名
+// string：每次转小写得到新的 std::string，再以字符串为键查三张 unordered_map
+// id：Find 规范化并查驻留表（无锁），再以编号为键查三张 unordered_map
+// 另测 Find 本身的开销及多线程查找的吞吐
+
+#include "msdkdns_domain_interner.h"
+#include "msdkdns_bench.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace msdkdns;
+
+static std::string MixedCase(size_t i) {
+    std::string name = "Host" + std::to_string(i) + ".Example.COM";
+    return name;
+}
+
+static std::string Lowercase(const std::string &text) {
+    std::string result(text);
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = static_cast<char>(tolower(static_cast<unsigned char>(result[i])));
+    }
+    return result;
+}
+
+static double RunString(const std::vector<std::string> &inputs, const std::vector<size_t> &order) {
+    std::unordered_map<std::string, int> tables[3];
+    for (size_t i = 0; i < inputs.size(); i++) {
+        for (int t = 0; t < 3; t++) {
+            tables[t][Lowercase(inputs[i])] = static_cast<int>(i);
+        }
+    }
+    int64_t begin = msdkdns_bench_now_ns();
+    long sum = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        std::string key = Lowercase(inputs[order[i]]);
+        for (int t = 0; t < 3; t++) {
+            sum += tables[t].find(key)->second;
+        }
+    }
+    msdkdns_bench_keep(sum);
+    return static_cast<double>(msdkdns_bench_now_ns() - begin) / order.size();
+}
+
+static double RunId(DomainInterner *interner, const std::vector<std::string> &inputs, const std::vector<size_t> &order) {
+    std::unordered_map<uint32_t, int> tables[3];
+    for (size_t i = 0; i < inputs.size(); i++) {
+        msdkdns_domain_key key;
+        interner->Intern(inputs[i].data(), inputs[i].size(), &key);
+        for (int t = 0; t < 3; t++) {
+            tables[t][key.id] = static_cast<int>(i);
+        }
+    }
+    int64_t begin = msdkdns_bench_now_ns();
+    long sum = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        const std::string &input = inputs[order[i]];
+        msdkdns_domain_key key;
+        interner->Find(input.data(), input.size(), &key);
+        for (int t = 0; t < 3; t++) {
+            sum += tables[t].find(key.id)->second;
+        }
+    }
+    msdkdns_bench_keep(sum);
+    return static_cast<double>(msdkdns_bench_now_ns() - begin) / order.size();
+}
+
+// 返回每秒查找次数（百万）
+static double RunFind(DomainInterner *interner, const std::vector<std::string> &inputs,
+                      const std::vector<size_t> &order, int threads) {
+    std::vector<std::thread> workers;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t]() {
+            uint32_t found = 0;
+            for (size_t i = 0; i < order.size(); i++) {
+                const std::string &input = inputs[order[(i + t * 7919) % order.size()]];
+                msdkdns_domain_key key;
+                found += interner->Find(input.data(), input.size(), &key) ? 1 : 0;
+            }
+            msdkdns_bench_keep(found);
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    double seconds = static_cast<double>(msdkdns_bench_now_ns() - begin) / 1e9;
+    return threads * order.size() / seconds / 1e6;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    size_t lookups = quick ? 20000 : 2000000;
+    size_t sizes[] = {1000, 10000, 50000};
+    printf("%zu random lookups, 3 tables per lookup\n", lookups);
+    printf("%-8s %12s %12s %12s\n", "domains", "string ns", "id ns", "find ns");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t count = sizes[s];
+        std::vector<std::string> inputs(count);
+        for (size_t i = 0; i < count; i++) {
+            inputs[i] = MixedCase(i);
+        }
+        std::vector<size_t> order(lookups);
+        uint32_t random = 2463534242u;
+        for (size_t i = 0; i < lookups; i++) {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            order[i] = random % count;
+        }
+        DomainInterner interner(count);
+        double string_ns = RunString(inputs, order);
+        double id_ns = RunId(&interner, inputs, order);
+        double find_ns = 1e3 / RunFind(&interner, inputs, order, 1);
+        printf("%-8zu %12.1f %12.1f %12.1f\n", count, string_ns, id_ns, find_ns);
+
+        if (s == sizeof(sizes) / sizeof(sizes[0]) - 1) {
+            printf("\nFind throughput, %zu domains, %u hardware threads\n", count, std::thread::hardware_concurrency());
+            printf("%-8s %12s\n", "threads", "M lookups/s");
+            for (int threads = 1; threads <= 8; threads *= 2) {
+                printf("%-8d %12.2f\n", threads, RunFind(&interner, inputs, order, threads));
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// canInitWithRequest: 的拦截判断：数千条规则（80% 精确、20% *. 通配）下每次匹配的开销
+// trie 为 DomainMatcher；linear 为原实现逐条比较的 std::string 对照，规则已预先规范化，查询时规范化一次
+// 查询一半命中（规则本身或通配规则的子域名），一半未命中
+
+#include "msdkdns_domain_matcher.h"
+#include "msdkdns_domain_interner.h"
+#include "msdkdns_bench.h"
+#include <stdio.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+class LinearMatcher {
+public:
+    explicit LinearMatcher(const std::vector<std::string> &rules) {
+        for (size_t i = 0; i < rules.size(); i++) {
+            bool wildcard = rules[i].compare(0, 2, "*.") == 0;
+            std::string text = wildcard ? rules[i].substr(2) : rules[i];
+            (wildcard ? suffixes_ : exact_).push_back(wildcard ? "." + text : text);
+        }
+    }
+
+    bool Match(const char *domain, size_t length) const {
+        char buffer[kMSDKDnsMaxDomainLength];
+        size_t text_length = 0;
+        if (!msdkdns_canonicalize_domain(domain, length, buffer, &text_length)) {
+            return false;
+        }
+        std::string text(buffer, text_length);
+        for (size_t i = 0; i < exact_.size(); i++) {
+            if (exact_[i] == text) {
+                return true;
+            }
+        }
+        for (size_t i = 0; i < suffixes_.size(); i++) {
+            const std::string &suffix = suffixes_[i];
+            if (text.size() > suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::vector<std::string> exact_;
+    std::vector<std::string> suffixes_;
+};
+
+template <typename Matcher>
+static double Run(const Matcher &matcher, const std::vector<std::string> &hosts, size_t rounds, size_t *hits) {
+    size_t found = 0;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < hosts.size(); i++) {
+            found += matcher.Match(hosts[i].data(), hosts[i].size()) ? 1 : 0;
+        }
+    }
+    double ns = static_cast<double>(msdkdns_bench_now_ns() - begin) / (rounds * hosts.size());
+    msdkdns_bench_keep(found);
+    *hits = found / rounds;
+    return ns;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    size_t sizes[] = {1000, 5000, 10000};
+    size_t queries = 1000;
+    printf("%zu queries per round, 50%% hits\n", queries);
+    printf("%-8s %12s %12s %12s %8s\n", "rules", "compile ms", "trie ns", "linear ns", "hits");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        std::mt19937 random(static_cast<uint32_t>(sizes[s]));
+        std::vector<std::string> rules;
+        for (size_t i = 0; i < sizes[s]; i++) {
+            std::string name = "svc" + std::to_string(i) + ".app" + std::to_string(random() % 50) + ".example.com";
+            rules.push_back(i % 5 == 0 ? "*." + name : name);
+        }
+        std::vector<std::string> hosts;
+        for (size_t i = 0; i < queries; i++) {
+            const std::string &rule = rules[random() % rules.size()];
+            if (i % 2 == 1) {
+                hosts.push_back("miss" + std::to_string(i) + ".app" + std::to_string(random() % 50) + ".example.com");
+            } else if (rule[0] == '*') {
+                hosts.push_back("img.SUB" + rule.substr(1));
+            } else {
+                hosts.push_back(rule);
+            }
+        }
+        int64_t begin = msdkdns_bench_now_ns();
+        DomainMatcher trie(rules);
+        double compile_ms = (msdkdns_bench_now_ns() - begin) / 1e6;
+        LinearMatcher linear(rules);
+        size_t trie_hits = 0;
+        size_t linear_hits = 0;
+        size_t rounds = quick ? 1 : (200000 / sizes[s] + 1);
+        double trie_ns = Run(trie, hosts, rounds * 20, &trie_hits);
+        double linear_ns = Run(linear, hosts, rounds, &linear_hits);
+        if (trie_hits != linear_hits) {
+            printf("hit count mismatch: %zu vs %zu\n", trie_hits, linear_hits);
+            return 1;
+        }
+        printf("%-8zu %12.2f %12.1f %12.1f %8zu\n", sizes[s], compile_ms, trie_ns, linear_ns, trie_hits);
+    }
+    return 0;
+}
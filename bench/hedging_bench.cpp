@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 对冲请求：两个本地模拟服务端，固定比例的响应延迟 kSlowMs，通过 HttpPool 串行发出 /d 请求
+// baseline 只向第一个服务端请求并等待整个超时，hedged 按 HttpsDnsResolver 的流程：
+// 超过 LatencyTracker 给出的对冲延迟仍无结果或提前失败时向第二个服务端发出相同请求，先到的结果生效，取消另一个
+
+#include "msdkdns_http_pool.h"
+#include "msdkdns_latency_tracker.h"
+#include "msdkdns_bench.h"
+#include "msdkdns_mock_server.h"
+#include <stdio.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msdkdns;
+
+static const int kTimeoutMs = 2000;
+static const int kFastMs = 5;
+static const int kSlowMs = 800;
+// 每100个响应中延迟的个数
+static const uint32_t kSlowPercent = 8;
+
+// 每个服务端使用固定种子的随机数决定是否延迟，结果可复现
+class SlowServer {
+public:
+    explicit SlowServer(uint32_t seed) : random_(seed), server_([this](const std::string &) { return Answer(); }) {}
+
+    bool Start() { return server_.Start(); }
+    void Stop() { server_.Stop(); }
+    uint16_t port() const { return server_.port(); }
+
+private:
+    std::string Answer() {
+        bool slow = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slow = random_() % 100 < kSlowPercent;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(slow ? kSlowMs : kFastMs));
+        return "1.1.1.1;2.2.2.2,60\n";
+    }
+
+    std::mutex mutex_;
+    std::mt19937 random_;
+    MockHttpServer server_;
+};
+
+// 一次查询内各请求的结果，回调在连接池线程上写入，主线程读取
+struct Query {
+    struct Attempt {
+        Query *query;
+        int server;
+        int64_t start_ns;
+        int64_t end_ns;
+        bool done;
+        bool ok;
+        bool timeout;
+        uint32_t id;
+    };
+
+    Query() : outstanding(0) {}
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    Attempt attempts[2];
+    int outstanding;
+};
+
+static void OnResponse(void *context, const msdkdns_http_response *response) {
+    Query::Attempt *attempt = static_cast<Query::Attempt *>(context);
+    Query *query = attempt->query;
+    std::lock_guard<std::mutex> lock(query->mutex);
+    attempt->end_ns = msdkdns_bench_now_ns();
+    attempt->done = true;
+    attempt->ok = response->result == MSDKDNS_EHttpResult_Ok && response->status == 200;
+    attempt->timeout = response->result == MSDKDNS_EHttpResult_Timeout;
+    query->outstanding--;
+    query->cond.notify_all();
+}
+
+class Client {
+public:
+    Client(HttpPool *pool, const uint16_t ports[2]) : pool_(pool), tracker_(64) {
+        for (int i = 0; i < 2; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "127.0.0.1:%u", ports[i]);
+            names_[i] = name;
+            ports_[i] = ports[i];
+        }
+    }
+
+    // 返回取得结果的耗时，失败时为调用方等待的总时间
+    double Resolve(bool hedge, uint32_t *hedges) {
+        Query query;
+        int64_t begin = msdkdns_bench_now_ns();
+        double hedge_delay_ms = tracker_.HedgeDelayMs(names_[0], kTimeoutMs);
+        Send(&query, 0, hedge ? tracker_.AttemptTimeoutMs(names_[0], kTimeoutMs) : kTimeoutMs);
+        std::unique_lock<std::mutex> lock(query.mutex);
+        int sent = 1;
+        int winner = -1;
+        bool handled[2] = {false, false};
+        for (;;) {
+            bool event = false;
+            for (int i = 0; i < sent; i++) {
+                event = event || (query.attempts[i].done && !handled[i]);
+            }
+            if (!event) {
+                if (hedge && sent == 1) {
+                    int64_t deadline = begin + static_cast<int64_t>(hedge_delay_ms * 1e6);
+                    if (msdkdns_bench_now_ns() >= deadline) {
+                        lock.unlock();
+                        Send(&query, 1, tracker_.AttemptTimeoutMs(names_[1], kTimeoutMs));
+                        lock.lock();
+                        sent = 2;
+                        (*hedges)++;
+                        continue;
+                    }
+                    query.cond.wait_for(lock, std::chrono::nanoseconds(deadline - msdkdns_bench_now_ns()));
+                } else {
+                    query.cond.wait(lock);
+                }
+                continue;
+            }
+            for (int i = 0; i < sent; i++) {
+                Query::Attempt &attempt = query.attempts[i];
+                if (!attempt.done || handled[i]) {
+                    continue;
+                }
+                handled[i] = true;
+                double latency_ms = (attempt.end_ns - attempt.start_ns) / 1e6;
+                if (attempt.ok) {
+                    tracker_.Record(names_[attempt.server], latency_ms);
+                    winner = winner < 0 ? i : winner;
+                } else if (attempt.timeout) {
+                    tracker_.RecordTimeout(names_[attempt.server], latency_ms);
+                }
+            }
+            if (winner >= 0 || query.outstanding == 0) {
+                if (winner < 0 && hedge && sent == 1) {
+                    // 未到对冲延迟就已失败，立即发出对冲请求
+                    lock.unlock();
+                    Send(&query, 1, tracker_.AttemptTimeoutMs(names_[1], kTimeoutMs));
+                    lock.lock();
+                    sent = 2;
+                    (*hedges)++;
+                    continue;
+                }
+                break;
+            }
+        }
+        int64_t end = winner >= 0 ? query.attempts[winner].end_ns : msdkdns_bench_now_ns();
+        // 取消未完成的请求，等待其回调后才能释放 query
+        for (int i = 0; i < sent; i++) {
+            if (!query.attempts[i].done) {
+                uint32_t id = query.attempts[i].id;
+                lock.unlock();
+                pool_->Cancel(id);
+                lock.lock();
+            }
+        }
+        query.cond.wait(lock, [&query]() { return query.outstanding == 0; });
+        return (end - begin) / 1e6;
+    }
+
+    void Reset() { tracker_.Clear(); }
+
+    double HedgeDelayMs() const { return tracker_.HedgeDelayMs(names_[0], kTimeoutMs); }
+
+    double AttemptTimeoutMs() const { return tracker_.AttemptTimeoutMs(names_[0], kTimeoutMs); }
+
+private:
+    void Send(Query *query, int index, double timeout_ms) {
+        Query::Attempt &attempt = query->attempts[index];
+        attempt.query = query;
+        attempt.server = index;
+        attempt.start_ns = msdkdns_bench_now_ns();
+        attempt.done = false;
+        attempt.ok = false;
+        attempt.timeout = false;
+        {
+            std::lock_guard<std::mutex> lock(query->mutex);
+            query->outstanding++;
+        }
+        attempt.id = pool_->Get("127.0.0.1", ports_[index], "/d?dn=hedge.example.com",
+                                static_cast<int>(timeout_ms), OnResponse, &attempt);
+        if (attempt.id == 0) {
+            std::lock_guard<std::mutex> lock(query->mutex);
+            attempt.end_ns = msdkdns_bench_now_ns();
+            attempt.done = true;
+            query->outstanding--;
+        }
+    }
+
+    HttpPool *pool_;
+    LatencyTracker tracker_;
+    std::string names_[2];
+    uint16_t ports_[2];
+};
+
+static double Percentile(const std::vector<double> &sorted, double q) {
+    return sorted[static_cast<size_t>(q * (sorted.size() - 1))];
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    SlowServer a(1);
+    SlowServer b(2);
+    if (!a.Start() || !b.Start()) {
+        printf("mock server failed to start\n");
+        return 1;
+    }
+    // 与 MSDKDnsHttpClient 相同的连接池配置
+    HttpPool pool(2, 4);
+    pool.Start();
+    uint16_t ports[2] = {a.port(), b.port()};
+    Client client(&pool, ports);
+
+    int queries = quick ? 16 : 400;
+    printf("2 servers, %u%% of responses delayed %dms, others %dms, timeout %dms, %d sequential queries\n",
+           kSlowPercent, kSlowMs, kFastMs, kTimeoutMs, queries);
+    printf("%-9s %8s %8s %8s %8s %8s %10s %12s\n", "mode", "p50 ms", "p90 ms", "p99 ms", "max ms", "hedges",
+           "hedge ms", "attempt ms");
+    for (int mode = 0; mode < 2; mode++) {
+        client.Reset();
+        uint32_t hedges = 0;
+        std::vector<double> latencies;
+        for (int i = 0; i < queries; i++) {
+            latencies.push_back(client.Resolve(mode == 1, &hedges));
+        }
+        std::sort(latencies.begin(), latencies.end());
+        printf("%-9s %8.1f %8.1f %8.1f %8.1f %8u %10.0f %12.0f\n", mode ? "hedged" : "baseline",
+               Percentile(latencies, 0.5), Percentile(latencies, 0.9), Percentile(latencies, 0.99), latencies.back(),
+               hedges, client.HedgeDelayMs(), client.AttemptTimeoutMs());
+    }
+    pool.Stop();
+    a.Stop();
+    b.Stop();
+    return 0;
+}
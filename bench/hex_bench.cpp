@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 十六进制编解码吞吐，对照组为逐字节查表的实现
+// 另测响应解密：AesCbcDecryptHex 逐块解码并解密 vs 先整体解码到临时 Buffer 再解密
+
+#include "aes.h"
+#include "msdkdns_hex.h"
+#include "msdkdns_bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace msdkdns;
+
+static void ScalarEncode(const uint8_t *in, size_t length, char *out) {
+    static const char kDigits[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        out[i * 2] = kDigits[in[i] >> 4];
+        out[i * 2 + 1] = kDigits[in[i] & 0x0F];
+    }
+}
+
+static bool ScalarDecode(const char *in, size_t length, uint8_t *out) {
+    for (size_t i = 0; i < length; i += 2) {
+        int value[2];
+        for (int k = 0; k < 2; k++) {
+            char c = in[i + k];
+            if (c >= '0' && c <= '9') {
+                value[k] = c - '0';
+            } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                value[k] = (c | 0x20) - 'a' + 10;
+            } else {
+                return false;
+            }
+        }
+        out[i / 2] = static_cast<uint8_t>((value[0] << 4) | value[1]);
+    }
+    return true;
+}
+
+static double MBps(size_t bytes, int rounds, int64_t begin) {
+    return bytes * static_cast<double>(rounds) / 1e6 / ((msdkdns_bench_now_ns() - begin) / 1e9);
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    printf("%-8s %14s %14s %14s %14s\n", "bytes", "encode MB/s", "scalar enc", "decode MB/s", "scalar dec");
+    static const size_t kLengths[] = {32, 1024, 8192};
+    for (size_t n = 0; n < sizeof(kLengths) / sizeof(kLengths[0]); n++) {
+        size_t length = kLengths[n];
+        int rounds = quick ? 10 : static_cast<int>(400000000 / (length + 64));
+        std::vector<uint8_t> bytes(length);
+        for (size_t i = 0; i < length; i++) {
+            bytes[i] = static_cast<uint8_t>(i * 131);
+        }
+        std::vector<char> hex(length * 2);
+        std::vector<uint8_t> out(length);
+        bool ok = true;
+
+        int64_t begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            msdkdns_hex_encode(bytes.data(), length, hex.data());
+            msdkdns_bench_keep(hex[0]);
+        }
+        double encode = MBps(length, rounds, begin);
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            ScalarEncode(bytes.data(), length, hex.data());
+            msdkdns_bench_keep(hex[0]);
+        }
+        double scalar_encode = MBps(length, rounds, begin);
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            ok &= msdkdns_hex_decode(hex.data(), hex.size(), out.data());
+            msdkdns_bench_keep(out[0]);
+        }
+        double decode = MBps(length, rounds, begin);
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            ok &= ScalarDecode(hex.data(), hex.size(), out.data());
+            msdkdns_bench_keep(out[0]);
+        }
+        double scalar_decode = MBps(length, rounds, begin);
+        printf("%-8zu %14.0f %14.0f %14.0f %14.0f%s\n", length, encode, scalar_encode, decode, scalar_decode,
+               ok ? "" : " (decode failed)");
+    }
+
+    // 加密后的响应解密
+    uint8_t key[16], iv[16];
+    memset(key, 0x5A, sizeof(key));
+    memset(iv, 0x11, sizeof(iv));
+    self_dns::AesCbcContext context;
+    self_dns::AesCbcInit(&context, key, 128);
+    printf("%-8s %14s %14s\n", "bytes", "fused ns", "separate ns");
+    for (size_t n = 0; n < sizeof(kLengths) / sizeof(kLengths[0]); n++) {
+        size_t length = kLengths[n];
+        int rounds = quick ? 10 : static_cast<int>(40000000 / (length + 64));
+        std::vector<uint8_t> plain(length, 'a');
+        std::vector<char> hex(2 * self_dns::AesGetOutLen(static_cast<int>(length), AES_ENCRYPT));
+        size_t hex_length = 0;
+        self_dns::AesCbcEncryptPkcs7Hex(&context, plain.data(), length, iv, hex.data(), &hex_length);
+        std::vector<uint8_t> out(hex_length / 2);
+        size_t sum = 0;
+
+        int64_t begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            size_t out_length = 0;
+            self_dns::AesCbcDecryptHex(&context, hex.data(), hex_length, iv, out.data(), &out_length);
+            sum += out_length;
+        }
+        double fused = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            std::vector<uint8_t> cipher(hex_length / 2);
+            msdkdns_hex_decode(hex.data(), hex_length, cipher.data());
+            size_t out_length = 0;
+            self_dns::AesCbcDecryptInPlace(&context, cipher.data(), cipher.size(), iv, &out_length);
+            memcpy(out.data(), cipher.data(), out_length);
+            sum += out_length;
+        }
+        double separate = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+        msdkdns_bench_keep(sum);
+        printf("%-8zu %14.0f %14.0f\n", length, fused, separate);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// IP 文本解析和格式化，对照组为系统 inet_pton / inet_ntop
+// 1024 个随机地址循环使用，IPv6 地址随机包含连续的0组以覆盖 :: 压缩
+
+#include "msdkdns_ip.h"
+#include "msdkdns_bench.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static const int kAddresses = 1024;
+
+struct Sample {
+    uint8_t bytes[16];
+    std::string text;
+};
+
+static std::vector<Sample> Samples(int family, std::mt19937 *random) {
+    std::vector<Sample> samples(kAddresses);
+    for (int i = 0; i < kAddresses; i++) {
+        Sample &sample = samples[i];
+        for (int k = 0; k < 16; k++) {
+            sample.bytes[k] = static_cast<uint8_t>((*random)());
+        }
+        if (family == AF_INET6) {
+            int zeros = (*random)() % 4;
+            memset(sample.bytes + 4, 0, zeros * 2);
+        }
+        char text[INET6_ADDRSTRLEN];
+        inet_ntop(family, sample.bytes, text, sizeof(text));
+        sample.text = text;
+    }
+    return samples;
+}
+
+static double Ns(int64_t begin, int rounds) {
+    return static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds / kAddresses;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    int rounds = quick ? 10 : 2000;
+    std::mt19937 random(1);
+    printf("%-4s %12s %12s %12s %12s\n", "", "parse ns", "inet_pton", "format ns", "inet_ntop");
+    static const int kFamilies[] = {AF_INET, AF_INET6};
+    for (int f = 0; f < 2; f++) {
+        int family = kFamilies[f];
+        std::vector<Sample> samples = Samples(family, &random);
+        uint8_t out[16];
+        char text[kMSDKDnsIPTextSize];
+        size_t sum = 0;
+
+        int64_t begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < kAddresses; i++) {
+                const std::string &s = samples[i].text;
+                sum += family == AF_INET ? msdkdns_parse_ipv4(s.data(), s.size(), out)
+                                         : msdkdns_parse_ipv6(s.data(), s.size(), out);
+                msdkdns_bench_keep(out[0]);
+            }
+        }
+        double parse = Ns(begin, rounds);
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < kAddresses; i++) {
+                sum += inet_pton(family, samples[i].text.c_str(), out);
+                msdkdns_bench_keep(out[0]);
+            }
+        }
+        double pton = Ns(begin, rounds);
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < kAddresses; i++) {
+                sum += msdkdns_format_ip(family, samples[i].bytes, text);
+                msdkdns_bench_keep(text[0]);
+            }
+        }
+        double format = Ns(begin, rounds);
+        begin = msdkdns_bench_now_ns();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < kAddresses; i++) {
+                sum += inet_ntop(family, samples[i].bytes, text, sizeof(text)) != NULL;
+                msdkdns_bench_keep(text[0]);
+            }
+        }
+        double ntop = Ns(begin, rounds);
+        msdkdns_bench_keep(sum);
+        printf("%-4s %12.1f %12.1f %12.1f %12.1f\n", family == AF_INET ? "v4" : "v6", parse, pton, format, ntop);
+    }
+    return 0;
+}
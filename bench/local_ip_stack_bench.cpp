@@ -0,0 +1,36 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 本地协议栈探测：缓存命中 vs 每次 UDP connect 探测 vs 每次 getifaddrs 探测
+
+#include "msdkdns_local_ip_stack.h"
+#include "msdkdns_bench.h"
+#include <stdio.h>
+
+using namespace msdkdns;
+
+typedef MSDKDNS_TLocalIPStack (*Detect)();
+
+static double NsPerCall(Detect detect, int rounds) {
+    int sum = 0;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        sum += detect();
+    }
+    double ns = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+    msdkdns_bench_keep(sum);
+    return ns;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    int rounds = quick ? 100 : 200000;
+    msdkdns_set_local_ip_stack_detector(MSDKDNS_ELocalIPStackDetector_Connect);
+    printf("local stack %d\n", msdkdns_cached_local_ip_stack());
+    printf("%-10s %12s\n", "detector", "ns/call");
+    printf("%-10s %12.1f\n", "cached", NsPerCall(msdkdns_cached_local_ip_stack, rounds * 10));
+    printf("%-10s %12.1f\n", "connect", NsPerCall(msdkdns_detect_local_ip_stack, rounds));
+    printf("%-10s %12.1f\n", "ifaddrs", NsPerCall(msdkdns_detect_local_ip_stack_ifaddrs, rounds));
+    return 0;
+}
@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_BENCH_MSDKDNS_BENCH_H_
+#define HTTPDNS_SDK_IOS_BENCH_MSDKDNS_BENCH_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+static inline int64_t msdkdns_bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// --quick 时缩小规模，供 ctest 检查能正常运行
+static inline bool msdkdns_bench_quick(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 防止被测结果被优化掉
+template <typename T>
+static inline void msdkdns_bench_keep(const T &value) {
+    __asm__ __volatile__("" : : "g"(&value) : "memory");
+}
+
+#endif  // HTTPDNS_SDK_IOS_BENCH_MSDKDNS_BENCH_H_
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 多域名批量解析结果的解析耗时
+// 对照组模拟原实现：按 \n | - , ; 逐级拆分为字符串数组，逐个校验 ip，ttl 按 strtod 转换
+
+#include "msdkdns_response_parser.h"
+#include "msdkdns_bench.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static std::vector<std::string> Split(const std::string &text, char separator) {
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    for (;;) {
+        size_t end = text.find(separator, begin);
+        parts.push_back(text.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        if (end == std::string::npos) {
+            return parts;
+        }
+        begin = end + 1;
+    }
+}
+
+static size_t SplitAnswer(const std::string &text, int family, double *ttl) {
+    std::vector<std::string> parts = Split(text, ',');
+    if (parts.size() != 2) {
+        return 0;
+    }
+    std::vector<std::string> ips = Split(parts[0], ';');
+    for (size_t i = 0; i < ips.size(); i++) {
+        uint8_t bytes[16];
+        if (inet_pton(family, ips[i].c_str(), bytes) != 1) {
+            return 0;
+        }
+    }
+    *ttl += strtod(parts[1].c_str(), NULL);
+    return ips.size();
+}
+
+static size_t SplitParse(const std::string &body, double *ttl) {
+    size_t count = 0;
+    std::vector<std::string> lines = Split(body, '\n');
+    for (size_t i = 0; i < lines.size(); i++) {
+        size_t colon = lines[i].find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::vector<std::string> parts = Split(lines[i].substr(colon + 1), '|');
+        if (parts.size() != 2) {
+            continue;
+        }
+        std::vector<std::string> stacks = Split(parts[0], '-');
+        if (stacks.size() == 2) {
+            count += SplitAnswer(stacks[0], AF_INET, ttl) + SplitAnswer(stacks[1], AF_INET6, ttl);
+        }
+    }
+    return count;
+}
+
+static std::string Corpus(int domains) {
+    std::string body;
+    for (int i = 0; i < domains; i++) {
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "host%d.example.com.:10.%d.0.1;10.%d.0.2;10.%d.0.3;10.%d.0.4,%d.5-2400:cb00:%x::1;2400:cb00:%x::2,%d|"
+                 "183.3.226.35\n",
+                 i, i & 0xFF, i & 0xFF, i & 0xFF, i & 0xFF, 60 + i % 600, i, i, 60 + i % 600);
+        body += line;
+    }
+    return body;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    int rounds = quick ? 200 : 20000;
+    printf("%-8s %16s %16s %8s\n", "domains", "parser ns/resp", "split ns/resp", "speedup");
+    for (int domains = 1; domains <= 64; domains *= 4) {
+        std::string body = Corpus(domains);
+        std::vector<msdkdns_response_record> records;
+        std::vector<msdkdns_response_address> addresses;
+        double ttl = 0;
+        int64_t begin = msdkdns_bench_now_ns();
+        for (int i = 0; i < rounds; i++) {
+            records.clear();
+            addresses.clear();
+            msdkdns_parse_response(body.data(), body.size(), MSDKDNS_EResponseMode_Dual, &records, &addresses);
+            ttl += records[0].answers[MSDKDNS_EResponseFamily_IPv4].ttl;
+        }
+        double parser = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+        size_t count = 0;
+        begin = msdkdns_bench_now_ns();
+        for (int i = 0; i < rounds; i++) {
+            count += SplitParse(body, &ttl);
+        }
+        double split = static_cast<double>(msdkdns_bench_now_ns() - begin) / rounds;
+        msdkdns_bench_keep(ttl);
+        msdkdns_bench_keep(count);
+        printf("%-8d %16.0f %16.0f %7.1fx\n", domains, parser, split, split / parser);
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 持久化缓存冷启动与落盘开销
+// 冷启动：逐行读出 HttpDNSTable（快照之前的启动方式） vs 打开快照并查询一个域名 vs 从数据库重新生成快照后打开（异常退出后的启动）
+// 落盘：写入一个域名并提交 vs 之后再整体重写快照（修改前每次落盘的做法）
+// 文件均在页缓存中，不含冷盘读取的耗时
+
+#include "msdkdns_db_writer.h"
+#include "msdkdns_snapshot.h"
+#include "msdkdns_bench.h"
+#include "msdkdns_temp_db.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static msdkdns_db_row Row(int i, int generation) {
+    char buf[64];
+    msdkdns_db_row row;
+    snprintf(buf, sizeof(buf), "d%d.example.com", i);
+    row.domain = buf;
+    snprintf(buf, sizeof(buf), "10.%d.%d.%d,10.%d.%d.%d", i % 200, generation % 200, i % 7, i % 3, i % 5, 1);
+    row.columns[MSDKDNS_EDBColumn_IPV4IPs] = buf;
+    row.columns[MSDKDNS_EDBColumn_IPV4Channel] = "http";
+    row.columns[MSDKDNS_EDBColumn_IPV4ClientIP] = "1.2.3.4";
+    row.columns[MSDKDNS_EDBColumn_IPV4TimeConsuming] = "23";
+    row.columns[MSDKDNS_EDBColumn_IPV4TTL] = "600";
+    row.columns[MSDKDNS_EDBColumn_IPV4TTLExpried] = "1700000600";
+    return row;
+}
+
+static size_t SelectAll(sqlite3 *db) {
+    sqlite3_stmt *stmt = NULL;
+    sqlite3_prepare_v2(db,
+                       "select domain, httpDnsIPV4Channel, httpDnsIPV4ClientIP, httpDnsIPV4IPs, "
+                       "httpDnsIPV4TimeConsuming, httpDnsIPV4TTL, httpDnsIPV4TTLExpried, httpDnsIPV6Channel, "
+                       "httpDnsIPV6ClientIP, httpDnsIPV6IPs, httpDnsIPV6TimeConsuming, httpDnsIPV6TTL, "
+                       "httpDnsIPV6TTLExpried from HttpDNSTable",
+                       -1, &stmt, NULL);
+    std::vector<msdkdns_db_row> rows;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        rows.push_back(msdkdns_db_row());
+        rows.back().domain = (const char *)sqlite3_column_text(stmt, 0);
+        for (int i = 0; i < MSDKDNS_EDBColumn_Count; i++) {
+            const unsigned char *value = sqlite3_column_text(stmt, i + 1);
+            rows.back().columns[i] = value ? (const char *)value : "";
+        }
+    }
+    sqlite3_finalize(stmt);
+    return rows.size();
+}
+
+static double Ms(int64_t begin) {
+    return (msdkdns_bench_now_ns() - begin) / 1e6;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    static const int kCounts[] = {1000, 10000, 50000};
+    int counts = quick ? 1 : static_cast<int>(sizeof(kCounts) / sizeof(kCounts[0]));
+    int flushes = quick ? 2 : 20;
+    printf("%-8s %12s %12s %12s %14s %14s\n", "domains", "select ms", "open ms", "rebuild ms", "flush ms",
+           "+rewrite ms");
+    for (int c = 0; c < counts; c++) {
+        int count = quick ? 200 : kCounts[c];
+        TempDB temp;
+        DBWriter writer(temp.db(), count + 1);
+        for (int i = 0; i < count; i++) {
+            writer.Put(Row(i, 0));
+        }
+        writer.Flush();
+        std::string path = temp.File("httpdns.snapshot");
+        msdkdns_snapshot_write_from_db(temp.db(), path);
+
+        int64_t begin = msdkdns_bench_now_ns();
+        size_t selected = SelectAll(temp.db());
+        double select_ms = Ms(begin);
+
+        begin = msdkdns_bench_now_ns();
+        SnapshotReader reader;
+        bool found = reader.Open(path) && reader.Lookup("d1.example.com", 14, NULL);
+        double open_ms = Ms(begin);
+        reader.Close();
+
+        begin = msdkdns_bench_now_ns();
+        bool rebuilt = msdkdns_snapshot_write_from_db(temp.db(), path) && reader.Open(path);
+        double rebuild_ms = Ms(begin);
+        reader.Close();
+
+        double flush_ms = 0;
+        double rewrite_ms = 0;
+        for (int f = 0; f < flushes; f++) {
+            writer.Put(Row(f, f + 1));
+            begin = msdkdns_bench_now_ns();
+            writer.Flush();
+            flush_ms += Ms(begin);
+            begin = msdkdns_bench_now_ns();
+            msdkdns_snapshot_write_from_db(temp.db(), path);
+            rewrite_ms += Ms(begin);
+        }
+        msdkdns_bench_keep(selected);
+        printf("%-8d %12.2f %12.3f %12.2f %14.3f %14.3f%s\n", count, select_ms, open_ms, rebuild_ms,
+               flush_ms / flushes, (flush_ms + rewrite_ms) / flushes, found && rebuilt ? "" : " (failed)");
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 时间轮的调度与取消开销随任务数的变化：每个 key 已有任务时覆盖调度，再取消一半后重新调度
+// wheel：TimerWheel，按 key 下标存放节点
+// map：std::map<std::string, int64_t> 对照，与原先按 "r" + 域名键字符串索引节点的做法一致，只计索引的开销
+
+#include "msdkdns_timer_wheel.h"
+#include "msdkdns_bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static std::string MapKey(uint32_t key) {
+    char text[1 + sizeof(key) * 2];
+    text[0] = 'r';
+    memcpy(text + 1, &key, sizeof(key));
+    memcpy(text + 1 + sizeof(key), &key, sizeof(key));
+    return std::string(text, sizeof(text));
+}
+
+static uint32_t Next(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// 返回每次操作的纳秒数
+static double RunWheel(size_t keys, size_t operations, size_t *size) {
+    TimerWheel wheel(1000, 0);
+    for (uint32_t key = 1; key <= keys; key++) {
+        wheel.Schedule(key, 1000 + key % 600000);
+    }
+    uint32_t state = 2463534242u;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (size_t i = 0; i < operations; i++) {
+        uint32_t key = 1 + Next(&state) % keys;
+        if (i % 2) {
+            wheel.Cancel(key);
+        } else {
+            wheel.Schedule(key, 1000 + Next(&state) % 600000);
+        }
+    }
+    double ns = static_cast<double>(msdkdns_bench_now_ns() - begin) / operations;
+    *size = wheel.Size();
+    return ns;
+}
+
+static double RunMap(size_t keys, size_t operations, size_t *size) {
+    std::map<std::string, int64_t> nodes;
+    for (uint32_t key = 1; key <= keys; key++) {
+        nodes[MapKey(key)] = 1000 + key % 600000;
+    }
+    uint32_t state = 2463534242u;
+    int64_t begin = msdkdns_bench_now_ns();
+    for (size_t i = 0; i < operations; i++) {
+        uint32_t key = 1 + Next(&state) % keys;
+        if (i % 2) {
+            nodes.erase(MapKey(key));
+        } else {
+            nodes[MapKey(key)] = 1000 + Next(&state) % 600000;
+        }
+    }
+    double ns = static_cast<double>(msdkdns_bench_now_ns() - begin) / operations;
+    *size = nodes.size();
+    return ns;
+}
+
+int main(int argc, char **argv) {
+    bool quick = msdkdns_bench_quick(argc, argv);
+    size_t sizes[] = {1000, 10000, 100000, 1000000};
+    size_t operations = quick ? 20000 : 2000000;
+    printf("%zu random schedule/cancel operations\n", operations);
+    printf("%-8s %12s %12s\n", "keys", "wheel ns", "map ns");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (quick && sizes[s] > 10000) {
+            break;
+        }
+        size_t wheel_size = 0;
+        size_t map_size = 0;
+        double wheel_ns = RunWheel(sizes[s], operations, &wheel_size);
+        double map_ns = RunMap(sizes[s], operations, &map_size);
+        // 两者执行相同的操作序列，剩余任务数应一致
+        if (wheel_size != map_size) {
+            printf("size mismatch: %zu vs %zu\n", wheel_size, map_size);
+            return 1;
+        }
+        printf("%-8zu %12.1f %12.1f\n", sizes[s], wheel_ns, map_ns);
+    }
+    return 0;
+}
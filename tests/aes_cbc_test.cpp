@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "aes.h"
+#include "msdkdns_test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace self_dns;
+
+static const BYTE kKey[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                              0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const BYTE kIv[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+static std::vector<BYTE> RandomBytes(size_t length) {
+    std::vector<BYTE> bytes(length);
+    for (size_t i = 0; i < length; i++) {
+        bytes[i] = static_cast<BYTE>(rand());
+    }
+    return bytes;
+}
+
+// 用原始 CBC 接口加密任意已填充好的明文，用于构造填充不合法的密文
+static std::vector<BYTE> EncryptRaw(const std::vector<BYTE> &padded) {
+    WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+    AesKeySetup(kKey, schedule, 128);
+    std::vector<BYTE> cipher(padded.size());
+    AesEncryptCbc(&padded[0], padded.size(), &cipher[0], schedule, 128, kIv);
+    return cipher;
+}
+
+// 各种长度的往返，包括空明文和原地加密
+static void TestRoundTrip() {
+    AesCbcContext context;
+    MSDKDNS_CHECK(AesCbcInit(&context, kKey, 128));
+    MSDKDNS_CHECK(!AesCbcInit(&context, kKey, 100));
+    for (size_t length = 0; length <= 64; length++) {
+        std::vector<BYTE> plain = RandomBytes(length);
+        size_t padded_length = AesGetOutLen(static_cast<int>(length), AES_ENCRYPT);
+        MSDKDNS_CHECK_EQ((length / 16 + 1) * 16, padded_length);
+        std::vector<BYTE> buffer(plain);
+        buffer.resize(padded_length);
+        size_t out_length = 0;
+        MSDKDNS_CHECK(AesCbcEncryptPkcs7(&context, &buffer[0], length, &buffer[0], kIv, &out_length));
+        MSDKDNS_CHECK_EQ(padded_length, out_length);
+        MSDKDNS_CHECK(AesCbcDecryptInPlace(&context, &buffer[0], out_length, kIv, &out_length));
+        MSDKDNS_CHECK_EQ(length, out_length);
+        MSDKDNS_CHECK(length == 0 || memcmp(&buffer[0], &plain[0], length) == 0);
+    }
+}
+
+// 填充必须是完整的 PKCS#7：值为 1..16 且每个填充字节都等于该值
+static void TestStrictPadding() {
+    AesCbcContext context;
+    AesCbcInit(&context, kKey, 128);
+    std::vector<BYTE> block(32, 'a');
+    size_t out_length = 0;
+
+    // 合法填充
+    for (int padding = 1; padding <= 16; padding++) {
+        memset(&block[32 - padding], padding, padding);
+        std::vector<BYTE> cipher = EncryptRaw(block);
+        MSDKDNS_CHECK(AesCbcDecryptInPlace(&context, &cipher[0], cipher.size(), kIv, &out_length));
+        MSDKDNS_CHECK_EQ(static_cast<size_t>(32 - padding), out_length);
+        memset(&block[16], 'a', 16);
+    }
+
+    // 填充值为0、大于16、或前面的填充字节不一致
+    BYTE last_values[] = {0, 17, 0xFF};
+    for (size_t i = 0; i < sizeof(last_values); i++) {
+        block[31] = last_values[i];
+        std::vector<BYTE> cipher = EncryptRaw(block);
+        MSDKDNS_CHECK(!AesCbcDecryptInPlace(&context, &cipher[0], cipher.size(), kIv, &out_length));
+    }
+    memset(&block[16], 4, 16);
+    block[28] = 3;
+    std::vector<BYTE> cipher = EncryptRaw(block);
+    MSDKDNS_CHECK(!AesCbcDecryptInPlace(&context, &cipher[0], cipher.size(), kIv, &out_length));
+
+    // 长度不是16的倍数或为0
+    std::vector<BYTE> short_cipher(31, 0);
+    MSDKDNS_CHECK(!AesCbcDecryptInPlace(&context, &short_cipher[0], 31, kIv, &out_length));
+    MSDKDNS_CHECK(!AesCbcDecryptInPlace(&context, &short_cipher[0], 0, kIv, &out_length));
+
+    // AesCryptWithKey 保留原有的宽松处理：填充不一致时仍按最后一个字节的值去除
+    memset(&block[16], 4, 16);
+    block[28] = 3;
+    cipher = EncryptRaw(block);
+    BYTE out[33];
+    MSDKDNS_CHECK_EQ(28, AesCryptWithKey(&cipher[0], 32, out, AES_DECRYPT, kKey, kIv));
+    MSDKDNS_CHECK_EQ(0, out[28]);
+}
+
+// 流式解密按任意分片输入，结果与一次性解密相同
+static void TestStream() {
+    AesCbcContext context;
+    AesCbcInit(&context, kKey, 128);
+    for (int round = 0; round < 500; round++) {
+        size_t length = rand() % 200;
+        std::vector<BYTE> plain = RandomBytes(length);
+        std::vector<BYTE> cipher(AesGetOutLen(static_cast<int>(length), AES_ENCRYPT));
+        size_t cipher_length = 0;
+        AesCbcEncryptPkcs7(&context, length ? &plain[0] : NULL, length, &cipher[0], kIv, &cipher_length);
+
+        AesCbcDecryptStream stream;
+        AesCbcDecryptStart(&stream, &context, kIv);
+        std::vector<BYTE> out(cipher_length + AES_BLOCK_SIZE);
+        size_t produced = 0;
+        size_t offset = 0;
+        while (offset < cipher_length) {
+            size_t chunk = 1 + rand() % 40;
+            if (chunk > cipher_length - offset) {
+                chunk = cipher_length - offset;
+            }
+            size_t written = 0;
+            AesCbcDecryptUpdate(&stream, &cipher[offset], chunk, &out[produced], &written);
+            produced += written;
+            offset += chunk;
+        }
+        size_t written = 0;
+        MSDKDNS_CHECK(AesCbcDecryptFinal(&stream, &out[produced], &written));
+        produced += written;
+        MSDKDNS_CHECK_EQ(length, produced);
+        MSDKDNS_CHECK(length == 0 || memcmp(&out[0], &plain[0], length) == 0);
+    }
+
+    // 总长度不是16的倍数时 Final 失败
+    AesCbcDecryptStream stream;
+    AesCbcDecryptStart(&stream, &context, kIv);
+    BYTE partial[20] = {0};
+    BYTE out[48];
+    size_t written = 0;
+    AesCbcDecryptUpdate(&stream, partial, sizeof(partial), out, &written);
+    MSDKDNS_CHECK(!AesCbcDecryptFinal(&stream, out + written, &written));
+}
+
+int main() {
+    srand(5);
+    TestRoundTrip();
+    TestStrictPadding();
+    TestStream();
+    return MSDKDNS_TEST_RESULT();
+}
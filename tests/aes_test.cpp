@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 同一份用例分别链接 T-table 实现（aes_test）和参考实现（aes_reference_test）
+// aes_test 对本机支持的每个后端（T-table、AES-NI、ARMv8）各跑一遍，并交叉比对各后端的结果
+
+#include "aes.h"
+#include "msdkdns_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace self_dns;
+
+static size_t FromHex(const char *hex, BYTE *out) {
+    size_t length = strlen(hex) / 2;
+    for (size_t i = 0; i < length; i++) {
+        unsigned value = 0;
+        sscanf(hex + 2 * i, "%2x", &value);
+        out[i] = static_cast<BYTE>(value);
+    }
+    return length;
+}
+
+// FIPS-197 附录 C
+static void TestBlockKat() {
+    static const char *const kKeys[] = {
+        "000102030405060708090a0b0c0d0e0f",
+        "000102030405060708090a0b0c0d0e0f1011121314151617",
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+    };
+    static const char *const kCiphers[] = {
+        "69c4e0d86a7b0430d8cdb78070b4c55a",
+        "dda97ca4864cdfe06eaf70a0ec0d7191",
+        "8ea2b7ca516745bfeafc49904b496089",
+    };
+    static const int kKeySizes[] = {128, 192, 256};
+    for (int i = 0; i < 3; i++) {
+        BYTE key[32], plain[16], cipher[16], out[16];
+        WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS], dec_schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+        FromHex(kKeys[i], key);
+        FromHex("00112233445566778899aabbccddeeff", plain);
+        FromHex(kCiphers[i], cipher);
+        AesKeySetup(key, schedule, kKeySizes[i]);
+        AesEncrypt(plain, out, schedule, kKeySizes[i]);
+        MSDKDNS_CHECK(memcmp(out, cipher, 16) == 0);
+        AesDecrypt(cipher, out, schedule, kKeySizes[i]);
+        MSDKDNS_CHECK(memcmp(out, plain, 16) == 0);
+        AesKeySetupDecrypt(schedule, dec_schedule, kKeySizes[i]);
+        AesDecryptWithDecKey(cipher, out, dec_schedule, kKeySizes[i]);
+        MSDKDNS_CHECK(memcmp(out, plain, 16) == 0);
+    }
+}
+
+// NIST SP 800-38A F.2.1 / F.2.2 CBC-AES128
+static void TestCbcKat() {
+    BYTE key[16], iv[16], plain[64], cipher[64], out[64];
+    WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+    FromHex("2b7e151628aed2a6abf7158809cf4f3c", key);
+    FromHex("000102030405060708090a0b0c0d0e0f", iv);
+    FromHex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+            "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710", plain);
+    FromHex("7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+            "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7", cipher);
+    AesKeySetup(key, schedule, 128);
+    MSDKDNS_CHECK(AesEncryptCbc(plain, 64, out, schedule, 128, iv));
+    MSDKDNS_CHECK(memcmp(out, cipher, 64) == 0);
+    MSDKDNS_CHECK(AesDecryptCbc(cipher, 64, out, schedule, 128, iv));
+    MSDKDNS_CHECK(memcmp(out, plain, 64) == 0);
+
+    // 上下文接口加 PKCS#7 填充后，前4块与上面的密文相同，多出一个完整的填充块
+    AesCbcContext context;
+    MSDKDNS_CHECK(AesCbcInit(&context, key, 128));
+    BYTE padded[80];
+    size_t length = 0;
+    MSDKDNS_CHECK(AesCbcEncryptPkcs7(&context, plain, 64, padded, iv, &length));
+    MSDKDNS_CHECK_EQ(80u, length);
+    MSDKDNS_CHECK(memcmp(padded, cipher, 64) == 0);
+    MSDKDNS_CHECK(AesCbcDecryptInPlace(&context, padded, 80, iv, &length));
+    MSDKDNS_CHECK_EQ(64u, length);
+    MSDKDNS_CHECK(memcmp(padded, plain, 64) == 0);
+}
+
+// AesCryptWithKey 缓存最近一次的密钥扩展结果，换 key 后不能沿用旧结果
+static void TestCryptWithKey() {
+    BYTE key_a[16], key_b[16], iv[16];
+    FromHex("2b7e151628aed2a6abf7158809cf4f3c", key_a);
+    FromHex("000102030405060708090a0b0c0d0e0f", key_b);
+    FromHex("d3ddee42c7e6f08a1077abc4f7a59d6c", iv);
+    const char *text = "www.qq.com,www.tencent.com";
+    size_t text_length = strlen(text);
+    const BYTE *plain = reinterpret_cast<const BYTE *>(text);
+    int out_length = AesGetOutLen(static_cast<int>(text_length), AES_ENCRYPT);
+    MSDKDNS_CHECK_EQ(32, out_length);
+    const BYTE *keys[] = {key_a, key_b, key_a, key_a, key_b};
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        AesCbcContext context;
+        AesCbcInit(&context, keys[i], 128);
+        BYTE expected[32];
+        size_t expected_length = 0;
+        AesCbcEncryptPkcs7(&context, plain, text_length, expected, iv, &expected_length);
+
+        BYTE cipher[32];
+        MSDKDNS_CHECK_EQ(out_length, AesCryptWithKey(plain, text_length, cipher, AES_ENCRYPT, keys[i], iv));
+        MSDKDNS_CHECK(memcmp(cipher, expected, sizeof(cipher)) == 0);
+        BYTE decrypted[33];
+        MSDKDNS_CHECK_EQ(static_cast<int>(text_length),
+                         AesCryptWithKey(cipher, sizeof(cipher), decrypted, AES_DECRYPT, keys[i], iv));
+        MSDKDNS_CHECK(memcmp(decrypted, plain, text_length) == 0 && decrypted[text_length] == '\0');
+    }
+}
+
+// 随机数据的 CBC 往返，以及与逐块 AesDecrypt 的结果一致
+static void TestRandomCbc() {
+    srand(1);
+    static const int kKeySizes[] = {128, 192, 256};
+    for (int round = 0; round < 2000; round++) {
+        int keysize = kKeySizes[round % 3];
+        BYTE key[32], iv[16], plain[64], cipher[64], out[64];
+        WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+        for (int i = 0; i < 32; i++) key[i] = static_cast<BYTE>(rand());
+        for (int i = 0; i < 16; i++) iv[i] = static_cast<BYTE>(rand());
+        for (int i = 0; i < 64; i++) plain[i] = static_cast<BYTE>(rand());
+        AesKeySetup(key, schedule, keysize);
+        AesEncryptCbc(plain, 64, cipher, schedule, keysize, iv);
+        AesDecryptCbc(cipher, 64, out, schedule, keysize, iv);
+        MSDKDNS_CHECK(memcmp(out, plain, 64) == 0);
+        BYTE block[16];
+        AesDecrypt(cipher + 48, block, schedule, keysize);
+        for (int i = 0; i < 16; i++) {
+            block[i] ^= cipher[32 + i];
+        }
+        MSDKDNS_CHECK(memcmp(block, plain + 48, 16) == 0);
+    }
+}
+
+// 随机密钥和数据，各后端的单块、CBC 上下文结果与当前后端一致
+static void TestBackendsAgree(int baseline) {
+    srand(2);
+    static const int kKeySizes[] = {128, 192, 256};
+    for (int round = 0; round < 300; round++) {
+        int keysize = kKeySizes[round % 3];
+        BYTE key[32], iv[16], plain[80];
+        for (int i = 0; i < 32; i++) key[i] = static_cast<BYTE>(rand());
+        for (int i = 0; i < 16; i++) iv[i] = static_cast<BYTE>(rand());
+        for (int i = 0; i < 80; i++) plain[i] = static_cast<BYTE>(rand());
+        WORD schedule[AES_MAX_KEY_SCHEDULE_WORDS];
+        AesKeySetup(key, schedule, keysize);
+        AesCbcContext context;
+        AesCbcInit(&context, key, keysize);
+
+        BYTE expected_block[16], expected_cbc[96];
+        size_t expected_length = 0;
+        AesSetBackend(baseline);
+        AesEncrypt(plain, expected_block, schedule, keysize);
+        AesCbcEncryptPkcs7(&context, plain, sizeof(plain), expected_cbc, iv, &expected_length);
+        for (int backend = 0; backend < AES_BACKEND_COUNT; backend++) {
+            if (!AesSetBackend(backend)) {
+                continue;
+            }
+            BYTE block[16], cbc[96];
+            size_t length = 0;
+            AesEncrypt(plain, block, schedule, keysize);
+            MSDKDNS_CHECK(memcmp(block, expected_block, 16) == 0);
+            AesDecrypt(block, block, schedule, keysize);
+            MSDKDNS_CHECK(memcmp(block, plain, 16) == 0);
+            MSDKDNS_CHECK(AesCbcEncryptPkcs7(&context, plain, sizeof(plain), cbc, iv, &length));
+            MSDKDNS_CHECK_EQ(expected_length, length);
+            MSDKDNS_CHECK(memcmp(cbc, expected_cbc, length) == 0);
+            MSDKDNS_CHECK(AesCbcDecryptInPlace(&context, cbc, length, iv, &length));
+            MSDKDNS_CHECK_EQ(sizeof(plain), length);
+            MSDKDNS_CHECK(memcmp(cbc, plain, sizeof(plain)) == 0);
+        }
+    }
+    AesSetBackend(baseline);
+}
+
+int main() {
+    int detected = AesBackend();
+    MSDKDNS_CHECK(AesBackendSupported(detected));
+    // 自动选择的是本机支持的最快后端
+    for (int backend = detected + 1; backend < AES_BACKEND_COUNT; backend++) {
+        MSDKDNS_CHECK(!AesBackendSupported(backend));
+    }
+    MSDKDNS_CHECK(!AesSetBackend(AES_BACKEND_COUNT));
+    MSDKDNS_CHECK_EQ(detected, AesBackend());
+    for (int backend = 0; backend < AES_BACKEND_COUNT; backend++) {
+        if (!AesSetBackend(backend)) {
+            continue;
+        }
+        printf("backend: %s\n", AesBackendName(backend));
+        TestBlockKat();
+        TestCbcKat();
+        TestCryptWithKey();
+        TestRandomCbc();
+    }
+    TestBackendsAgree(detected);
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_batch_planner.h"
+#include "msdkdns_test.h"
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static std::vector<std::string> Domains(const char *a, const char *b = NULL) {
+    std::vector<std::string> domains(1, a);
+    if (b) {
+        domains.push_back(b);
+    }
+    return domains;
+}
+
+// 窗口内同一键的调用合并为一个批次，窗口到期后发出
+static void TestWindow() {
+    BatchPlanner planner;
+    planner.SetLimits(10, 0, 0);
+    std::vector<msdkdns_batch> ready;
+    int64_t flush_ms = 0;
+    uint64_t first = planner.Add("4||normal", Domains("a.com"), 1000, 3000, &ready, &flush_ms);
+    MSDKDNS_CHECK(ready.empty());
+    MSDKDNS_CHECK_EQ(1010, flush_ms);
+    uint64_t second = planner.Add("4||normal", Domains("b.com", "c.com"), 1004, 5000, &ready, &flush_ms);
+    MSDKDNS_CHECK_EQ(-1, flush_ms);
+    // 不同键（来源不同）不合并
+    planner.Add("4||refresh", Domains("d.com"), 1005, 5000, &ready, &flush_ms);
+    MSDKDNS_CHECK_EQ(1015, flush_ms);
+    MSDKDNS_CHECK_EQ(2u, planner.PendingCount());
+    MSDKDNS_CHECK_EQ(1010, planner.NextFlush());
+
+    planner.Expire(1009, &ready);
+    MSDKDNS_CHECK(ready.empty());
+    planner.Expire(1010, &ready);
+    MSDKDNS_CHECK_EQ(1u, ready.size());
+    MSDKDNS_CHECK_EQ(std::string("4||normal"), ready[0].key);
+    MSDKDNS_CHECK_EQ(3u, ready[0].domains.size());
+    MSDKDNS_CHECK_EQ(std::string("a.com,b.com,c.com").size(), ready[0].query_length);
+    MSDKDNS_CHECK(ready[0].calls.size() == 2 && ready[0].calls[0] == first && ready[0].calls[1] == second);
+    MSDKDNS_CHECK_EQ(3000, ready[0].deadline_ms);
+    MSDKDNS_CHECK_EQ(1015, planner.NextFlush());
+    planner.Expire(2000, &ready);
+    MSDKDNS_CHECK_EQ(2u, ready.size());
+    MSDKDNS_CHECK_EQ(-1, planner.NextFlush());
+
+    msdkdns_batch_stats stats;
+    planner.Stats(&stats);
+    MSDKDNS_CHECK_EQ(2u, stats.flushed);
+    MSDKDNS_CHECK_EQ(1u, stats.merged);
+}
+
+// 截止时间取最小值，窗口到期时间不晚于最早的截止时间
+static void TestDeadline() {
+    BatchPlanner planner;
+    planner.SetLimits(50, 0, 0);
+    std::vector<msdkdns_batch> ready;
+    int64_t flush_ms = 0;
+    planner.Add("k", Domains("a.com"), 0, 2000, &ready, &flush_ms);
+    MSDKDNS_CHECK_EQ(50, flush_ms);
+    planner.Add("k", Domains("b.com"), 10, 1000, &ready, &flush_ms);
+    MSDKDNS_CHECK_EQ(-1, flush_ms);
+    planner.Add("k", Domains("c.com"), 20, 30, &ready, &flush_ms);
+    MSDKDNS_CHECK_EQ(30, flush_ms);
+    planner.Expire(30, &ready);
+    MSDKDNS_CHECK(ready.size() == 1 && ready[0].deadline_ms == 30);
+
+    // 加入时已过截止时间的调用使批次在当前时间到期
+    ready.clear();
+    planner.Add("k", Domains("d.com"), 100, 90, &ready, &flush_ms);
+    MSDKDNS_CHECK_EQ(100, flush_ms);
+}
+
+// 达到域名数或长度上限时发出，单次调用的域名不拆分
+static void TestLimits() {
+    BatchPlanner planner;
+    planner.SetLimits(10, 3, 0);
+    std::vector<msdkdns_batch> ready;
+    int64_t flush_ms = 0;
+    planner.Add("k", Domains("a.com", "b.com"), 0, 1000, &ready, &flush_ms);
+    // 加入后超过上限：先发出已有批次，当前调用另起一批
+    planner.Add("k", Domains("c.com", "d.com"), 1, 1000, &ready, &flush_ms);
+    MSDKDNS_CHECK(ready.size() == 1 && ready[0].domains.size() == 2);
+    MSDKDNS_CHECK_EQ(11, flush_ms);
+    // 正好达到上限：立即发出
+    planner.Add("k", Domains("e.com"), 2, 1000, &ready, &flush_ms);
+    MSDKDNS_CHECK(ready.size() == 2 && ready[1].domains.size() == 3);
+    MSDKDNS_CHECK_EQ(0u, planner.PendingCount());
+
+    planner.SetLimits(10, 0, 11);
+    ready.clear();
+    planner.Add("k", Domains("a.com"), 0, 1000, &ready, &flush_ms);
+    planner.Add("k", Domains("b.com"), 1, 1000, &ready, &flush_ms);
+    MSDKDNS_CHECK(ready.empty());
+    planner.Add("k", Domains("c.com"), 2, 1000, &ready, &flush_ms);
+    MSDKDNS_CHECK(ready.size() == 1 && ready[0].query_length == 11);
+
+    // 窗口为0时不合批
+    planner.SetLimits(0, 0, 0);
+    ready.clear();
+    planner.Expire(100, &ready);
+    ready.clear();
+    planner.Add("k", Domains("x.com"), 200, 1000, &ready, &flush_ms);
+    MSDKDNS_CHECK(ready.size() == 1 && flush_ms == -1);
+}
+
+int main() {
+    TestWindow();
+    TestDeadline();
+    TestLimits();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_cache_partitions.h"
+#include "msdkdns_db_writer.h"
+#include "msdkdns_temp_db.h"
+#include "msdkdns_test.h"
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+// 保留最近使用的 capacity 个分区，取出的分区不再计入
+static void TestIndex() {
+    PartitionIndex index(2);
+    std::vector<std::string> evicted;
+    MSDKDNS_CHECK(!index.Take("wifi/a"));
+    index.Store("wifi/a", &evicted);
+    index.Store("wwan/1", &evicted);
+    MSDKDNS_CHECK_EQ(2u, index.Count());
+    MSDKDNS_CHECK(evicted.empty());
+
+    // 再次保存移到最近使用，超出容量淘汰最久未使用的
+    index.Store("wifi/a", &evicted);
+    index.Store("wifi/b", &evicted);
+    MSDKDNS_CHECK(evicted.size() == 1 && evicted[0] == "wwan/1");
+    MSDKDNS_CHECK(!index.Take("wwan/1"));
+
+    MSDKDNS_CHECK(index.Take("wifi/a"));
+    MSDKDNS_CHECK(!index.Take("wifi/a"));
+    MSDKDNS_CHECK_EQ(1u, index.Count());
+    MSDKDNS_CHECK_EQ(1u, index.restored());
+    MSDKDNS_CHECK_EQ(3u, index.missed());
+    MSDKDNS_CHECK_EQ(1u, index.evicted());
+
+    index.Clear();
+    MSDKDNS_CHECK_EQ(0u, index.Count());
+    MSDKDNS_CHECK(!index.Take("wifi/b"));
+}
+
+// 容量为0时不保留，要保存的网络直接作为淘汰返回
+static void TestZeroCapacity() {
+    PartitionIndex index(0);
+    std::vector<std::string> evicted;
+    index.Store("wifi/a", &evicted);
+    MSDKDNS_CHECK(evicted.size() == 1 && evicted[0] == "wifi/a");
+    MSDKDNS_CHECK_EQ(0u, index.Count());
+    MSDKDNS_CHECK(!index.Take("wifi/a"));
+}
+
+static msdkdns_db_row Row(const std::string &domain, const std::string &ips, const std::string &expired) {
+    msdkdns_db_row row;
+    row.domain = domain;
+    row.columns[MSDKDNS_EDBColumn_IPV4IPs] = ips;
+    row.columns[MSDKDNS_EDBColumn_IPV4TTL] = "60";
+    row.columns[MSDKDNS_EDBColumn_IPV4TTLExpried] = expired;
+    return row;
+}
+
+// domain -> 自增 id，INSERT OR REPLACE 会分配新的 id，id 不变说明该行没有被重写
+static std::map<std::string, int64_t> Ids(const TempDB &temp) {
+    std::map<std::string, int64_t> ids;
+    sqlite3_stmt *stmt = NULL;
+    sqlite3_prepare_v2(temp.db(), "select domain, id from HttpDNSTable", -1, &stmt, NULL);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ids[(const char *)sqlite3_column_text(stmt, 0)] = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+    return ids;
+}
+
+static void Replace(DBWriter *writer, const std::vector<msdkdns_db_row> &rows) {
+    writer->RemoveAll();
+    for (size_t i = 0; i < rows.size(); i++) {
+        writer->Put(rows[i]);
+    }
+}
+
+// 切换分区整体替换表内容：相同的行不重写，只删除目标分区中没有的域名，表内容与目标分区一致
+static void TestReplaceKeepsUnchangedRows() {
+    TempDB temp;
+    DBWriter writer(temp.db(), 64);
+    std::vector<msdkdns_db_row> current;
+    current.push_back(Row("same1.com", "1.1.1.1", "100"));
+    current.push_back(Row("same2.com", "1.1.1.2", "100"));
+    current.push_back(Row("ips.com", "2.2.2.2", "100"));
+    current.push_back(Row("ttl.com", "3.3.3.3", "100"));
+    current.push_back(Row("gone.com", "4.4.4.4", "100"));
+    Replace(&writer, current);
+    MSDKDNS_CHECK(writer.Flush());
+    std::map<std::string, int64_t> before = Ids(temp);
+
+    std::vector<msdkdns_db_row> target;
+    target.push_back(Row("same1.com", "1.1.1.1", "100"));
+    target.push_back(Row("same2.com", "1.1.1.2", "100"));
+    target.push_back(Row("ips.com", "5.5.5.5", "100"));
+    target.push_back(Row("ttl.com", "3.3.3.3", "200"));
+    target.push_back(Row("new.com", "6.6.6.6", "200"));
+    Replace(&writer, target);
+    MSDKDNS_CHECK(writer.Flush());
+    // 删除 gone.com，写入 ips.com、ttl.com、new.com
+    MSDKDNS_CHECK_EQ(4u, writer.LastChanges());
+
+    std::map<std::string, std::string> rows = temp.Rows();
+    MSDKDNS_CHECK_EQ(5u, rows.size());
+    MSDKDNS_CHECK_EQ(std::string("5.5.5.5"), rows["ips.com"]);
+    MSDKDNS_CHECK_EQ(std::string("6.6.6.6"), rows["new.com"]);
+    MSDKDNS_CHECK(!rows.count("gone.com"));
+    std::map<std::string, int64_t> after = Ids(temp);
+    MSDKDNS_CHECK_EQ(before["same1.com"], after["same1.com"]);
+    MSDKDNS_CHECK_EQ(before["same2.com"], after["same2.com"]);
+    MSDKDNS_CHECK(before["ttl.com"] != after["ttl.com"]);
+
+    // 内容完全相同时不产生任何写入
+    Replace(&writer, target);
+    MSDKDNS_CHECK(writer.Flush());
+    MSDKDNS_CHECK_EQ(0u, writer.LastChanges());
+    MSDKDNS_CHECK(Ids(temp) == after);
+}
+
+// 相同的行少于要删除的行时整表删除后重写，结果相同
+static void TestReplaceMostlyDifferent() {
+    TempDB temp;
+    DBWriter writer(temp.db(), 64);
+    std::vector<msdkdns_db_row> current;
+    current.push_back(Row("same.com", "1.1.1.1", "100"));
+    current.push_back(Row("a1.com", "2.2.2.2", "100"));
+    current.push_back(Row("a2.com", "2.2.2.3", "100"));
+    Replace(&writer, current);
+    MSDKDNS_CHECK(writer.Flush());
+
+    std::vector<msdkdns_db_row> target;
+    target.push_back(Row("same.com", "1.1.1.1", "100"));
+    target.push_back(Row("b.com", "3.3.3.3", "200"));
+    Replace(&writer, target);
+    MSDKDNS_CHECK(writer.Flush());
+    std::map<std::string, std::string> rows = temp.Rows();
+    MSDKDNS_CHECK(rows.size() == 2 && rows["same.com"] == "1.1.1.1" && rows["b.com"] == "3.3.3.3");
+
+    // 目标为空时清空
+    Replace(&writer, std::vector<msdkdns_db_row>());
+    MSDKDNS_CHECK(writer.Flush());
+    MSDKDNS_CHECK_EQ(2u, writer.LastChanges());
+    MSDKDNS_CHECK(temp.Rows().empty());
+}
+
+// 来回切换在落盘前合并：A -> B -> A 后表中的行都没有被重写
+static void TestBounceBeforeFlush() {
+    TempDB temp;
+    DBWriter writer(temp.db(), 64);
+    std::vector<msdkdns_db_row> a;
+    std::vector<msdkdns_db_row> b;
+    a.push_back(Row("shared.com", "1.1.1.1", "100"));
+    a.push_back(Row("a.com", "2.2.2.2", "100"));
+    b.push_back(Row("shared.com", "9.9.9.9", "300"));
+    b.push_back(Row("b.com", "8.8.8.8", "300"));
+    Replace(&writer, a);
+    MSDKDNS_CHECK(writer.Flush());
+    std::map<std::string, int64_t> before = Ids(temp);
+    Replace(&writer, b);
+    Replace(&writer, a);
+    MSDKDNS_CHECK(writer.Flush());
+    MSDKDNS_CHECK_EQ(0u, writer.LastChanges());
+    MSDKDNS_CHECK(Ids(temp) == before);
+}
+
+int main() {
+    TestIndex();
+    TestZeroCapacity();
+    TestReplaceKeepsUnchangedRows();
+    TestReplaceMostlyDifferent();
+    TestBounceBeforeFlush();
+    return MSDKDNS_TEST_RESULT();
+}
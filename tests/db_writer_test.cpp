@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_db_writer.h"
+#include "msdkdns_temp_db.h"
+#include "msdkdns_test.h"
+#include <map>
+#include <string>
+
+using namespace msdkdns;
+
+static msdkdns_db_row Row(const std::string &domain, const std::string &ips) {
+    msdkdns_db_row row;
+    row.domain = domain;
+    row.columns[MSDKDNS_EDBColumn_IPV4IPs] = ips;
+    row.columns[MSDKDNS_EDBColumn_IPV4TTL] = "60";
+    return row;
+}
+
+// 同一域名的多次写入和删除合并为一次，值原样写入
+static void TestMerge() {
+    TempDB temp;
+    DBWriter writer(temp.db(), 64);
+    writer.Put(Row("a.com", "1.1.1.1"));
+    writer.Put(Row("a.com", "2.2.2.2"));
+    writer.Put(Row("b.com", "3.3.3.3"));
+    writer.Put(Row("q.com", "it's \"quoted\""));
+    MSDKDNS_CHECK_EQ(3u, writer.Pending());
+    MSDKDNS_CHECK(writer.Flush());
+    MSDKDNS_CHECK_EQ(0u, writer.Pending());
+    std::map<std::string, std::string> rows = temp.Rows();
+    MSDKDNS_CHECK_EQ(3u, rows.size());
+    MSDKDNS_CHECK_EQ(std::string("2.2.2.2"), rows["a.com"]);
+    MSDKDNS_CHECK_EQ(std::string("it's \"quoted\""), rows["q.com"]);
+
+    writer.Put(Row("c.com", "4.4.4.4"));
+    writer.Remove("b.com");
+    writer.Remove("c.com");
+    MSDKDNS_CHECK(writer.Flush());
+    rows = temp.Rows();
+    MSDKDNS_CHECK(rows.size() == 2 && rows.count("a.com") && rows.count("q.com"));
+
+    // 清空后的写入保留
+    writer.RemoveAll();
+    writer.Put(Row("d.com", "5.5.5.5"));
+    MSDKDNS_CHECK_EQ(2u, writer.Pending());
+    MSDKDNS_CHECK(writer.Flush());
+    rows = temp.Rows();
+    MSDKDNS_CHECK(rows.size() == 1 && rows["d.com"] == "5.5.5.5");
+}
+
+// 数据库被其他连接锁住时落盘失败并回滚，未写入的数据保留到下次
+static void TestFailureKeepsPending() {
+    TempDB temp;
+    DBWriter writer(temp.db(), 64);
+    writer.Put(Row("a.com", "1.1.1.1"));
+    MSDKDNS_CHECK(writer.Flush());
+
+    sqlite3 *other = NULL;
+    sqlite3_open(temp.path().c_str(), &other);
+    MSDKDNS_CHECK_EQ(SQLITE_OK, sqlite3_exec(other, "BEGIN EXCLUSIVE TRANSACTION", NULL, NULL, NULL));
+    writer.Put(Row("a.com", "9.9.9.9"));
+    writer.Put(Row("b.com", "2.2.2.2"));
+    MSDKDNS_CHECK(!writer.Flush());
+    MSDKDNS_CHECK_EQ(2u, writer.Pending());
+    sqlite3_exec(other, "COMMIT TRANSACTION", NULL, NULL, NULL);
+    sqlite3_close(other);
+
+    MSDKDNS_CHECK(writer.Flush());
+    std::map<std::string, std::string> rows = temp.Rows();
+    MSDKDNS_CHECK(rows.size() == 2 && rows["a.com"] == "9.9.9.9" && rows["b.com"] == "2.2.2.2");
+}
+
+// 积压超过上限时丢弃未写入的数据，下次落盘时清空整张表
+static void TestBoundedPending() {
+    TempDB temp;
+    DBWriter writer(temp.db(), 4);
+    writer.Put(Row("old.com", "1.1.1.1"));
+    MSDKDNS_CHECK(writer.Flush());
+
+    char domain[32];
+    for (int i = 0; i < 4; i++) {
+        snprintf(domain, sizeof(domain), "d%d.com", i);
+        writer.Put(Row(domain, "2.2.2.2"));
+    }
+    MSDKDNS_CHECK_EQ(4u, writer.Pending());
+    // 已在积压中的域名不计入新增
+    writer.Put(Row("d0.com", "3.3.3.3"));
+    MSDKDNS_CHECK_EQ(0u, writer.Dropped());
+    writer.Put(Row("d4.com", "4.4.4.4"));
+    MSDKDNS_CHECK_EQ(4u, writer.Dropped());
+    MSDKDNS_CHECK_EQ(2u, writer.Pending());
+    MSDKDNS_CHECK(writer.Flush());
+    std::map<std::string, std::string> rows = temp.Rows();
+    MSDKDNS_CHECK(rows.size() == 1 && rows["d4.com"] == "4.4.4.4");
+}
+
+int main() {
+    TestMerge();
+    TestFailureKeepsPending();
+    TestBoundedPending();
+    return MSDKDNS_TEST_RESULT();
+}
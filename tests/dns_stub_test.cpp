@@ -0,0 +1,311 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_dns_stub.h"
+#include "msdkdns_timer_wheel.h"
+#include "msdkdns_test.h"
+#include <ctype.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msdkdns;
+
+static void AppendU16(std::vector<uint8_t> *out, uint16_t value) {
+    out->push_back((uint8_t)(value >> 8));
+    out->push_back((uint8_t)value);
+}
+
+static void AppendName(std::vector<uint8_t> *out, const std::string &name) {
+    size_t begin = 0;
+    while (begin < name.size()) {
+        size_t end = name.find('.', begin);
+        end = end == std::string::npos ? name.size() : end;
+        out->push_back((uint8_t)(end - begin));
+        out->insert(out->end(), name.begin() + begin, name.begin() + end);
+        begin = end + 1;
+    }
+    out->push_back(0);
+}
+
+static void AppendRecord(std::vector<uint8_t> *out, const std::string &owner, uint16_t type,
+                         const std::vector<uint8_t> &rdata) {
+    AppendName(out, owner);
+    AppendU16(out, type);
+    AppendU16(out, 1);
+    AppendU16(out, 0);
+    AppendU16(out, 300);
+    AppendU16(out, (uint16_t)rdata.size());
+    out->insert(out->end(), rdata.begin(), rdata.end());
+}
+
+/*
+ * 本地回环上的 DNS 服务器，同一端口同时监听 UDP 和 TCP
+ * A 查询返回 CNAME 到 Target.Example.COM 及其 A 记录 1.2.3.4，所有者名的大小写与查询不同；AAAA 查询返回无记录
+ */
+class MockDnsServer {
+public:
+    MockDnsServer() : udp_(-1), tcp_(-1), port_(0), lower_question_(false), drop_(false), truncate_(false), stop_(false) {}
+
+    ~MockDnsServer() { Stop(); }
+
+    bool Start() {
+        udp_ = socket(AF_INET, SOCK_DGRAM, 0);
+        tcp_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = sockaddr_in();
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (udp_ < 0 || tcp_ < 0 || bind(udp_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            getsockname(udp_, reinterpret_cast<sockaddr *>(&addr), &length) != 0 ||
+            bind(tcp_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(tcp_, 16) != 0) {
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        address_ = addr;
+        thread_ = std::thread(&MockDnsServer::Loop, this);
+        return true;
+    }
+
+    void Stop() {
+        if (thread_.joinable()) {
+            stop_ = true;
+            thread_.join();
+        }
+        if (udp_ >= 0) {
+            close(udp_);
+            udp_ = -1;
+        }
+        if (tcp_ >= 0) {
+            close(tcp_);
+            tcp_ = -1;
+        }
+    }
+
+    const sockaddr *address() const { return reinterpret_cast<const sockaddr *>(&address_); }
+    // 应答的问题段改为全小写，模拟不支持 0x20 的服务器
+    void set_lower_question(bool value) { lower_question_ = value; }
+    void set_drop(bool value) { drop_ = value; }
+    // UDP 应答只设置 TC，记录通过 TCP 返回
+    void set_truncate(bool value) { truncate_ = value; }
+
+private:
+    std::vector<uint8_t> Answer(const uint8_t *query, size_t length, bool tcp) {
+        std::vector<uint8_t> out;
+        size_t name_end = 12;
+        while (name_end < length && query[name_end] != 0) {
+            name_end += query[name_end] + 1;
+        }
+        if (name_end + 5 > length) {
+            return out;
+        }
+        uint16_t qtype = (uint16_t)((query[name_end + 1] << 8) | query[name_end + 2]);
+        bool truncated = truncate_ && !tcp;
+        out.push_back(query[0]);
+        out.push_back(query[1]);
+        out.push_back(truncated ? 0x83 : 0x81);
+        out.push_back(0x80);
+        AppendU16(&out, 1);
+        AppendU16(&out, (uint16_t)(qtype == 1 && !truncated ? 2 : 0));
+        AppendU16(&out, 0);
+        AppendU16(&out, 0);
+        for (size_t i = 12; i < name_end + 5; i++) {
+            uint8_t c = query[i];
+            out.push_back(lower_question_ && c >= 'A' && c <= 'Z' ? (uint8_t)(c + 32) : c);
+        }
+        if (qtype == 1 && !truncated) {
+            // 所有者名使用与查询不同的大小写
+            std::string owner;
+            for (size_t pos = 12; pos < name_end; pos += query[pos] + 1) {
+                owner += (owner.empty() ? "" : ".") + std::string((const char *)query + pos + 1, query[pos]);
+            }
+            for (size_t i = 0; i < owner.size(); i++) {
+                owner[i] = (char)(islower((unsigned char)owner[i]) ? toupper((unsigned char)owner[i]) : tolower((unsigned char)owner[i]));
+            }
+            std::vector<uint8_t> target;
+            AppendName(&target, "Target.Example.COM");
+            AppendRecord(&out, owner, 5, target);
+            uint8_t ip[4] = {1, 2, 3, 4};
+            AppendRecord(&out, "tARGET.eXAMPLE.com", 1, std::vector<uint8_t>(ip, ip + 4));
+        }
+        return out;
+    }
+
+    void ServeTcp(int client) {
+        uint8_t buffer[1024];
+        size_t used = 0;
+        pollfd pfd = {client, POLLIN, 0};
+        while (poll(&pfd, 1, 1000) > 0) {
+            ssize_t n = recv(client, buffer + used, sizeof(buffer) - used, 0);
+            if (n <= 0) {
+                break;
+            }
+            used += (size_t)n;
+            if (used >= 2 && used >= 2u + ((buffer[0] << 8) | buffer[1])) {
+                std::vector<uint8_t> answer = Answer(buffer + 2, used - 2, true);
+                std::vector<uint8_t> framed;
+                AppendU16(&framed, (uint16_t)answer.size());
+                framed.insert(framed.end(), answer.begin(), answer.end());
+                send(client, framed.data(), framed.size(), MSG_NOSIGNAL);
+                break;
+            }
+        }
+        close(client);
+    }
+
+    void Loop() {
+        while (!stop_) {
+            pollfd fds[2] = {{udp_, POLLIN, 0}, {tcp_, POLLIN, 0}};
+            if (poll(fds, 2, 20) <= 0) {
+                continue;
+            }
+            if (fds[1].revents) {
+                int client = accept(tcp_, NULL, NULL);
+                if (client >= 0) {
+                    ServeTcp(client);
+                }
+            }
+            if (fds[0].revents) {
+                uint8_t buffer[512];
+                sockaddr_storage from;
+                socklen_t from_length = sizeof(from);
+                ssize_t n = recvfrom(udp_, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr *>(&from), &from_length);
+                if (n <= 0 || drop_) {
+                    continue;
+                }
+                std::vector<uint8_t> answer = Answer(buffer, (size_t)n, false);
+                sendto(udp_, answer.data(), answer.size(), 0, reinterpret_cast<sockaddr *>(&from), from_length);
+            }
+        }
+    }
+
+    int udp_;
+    int tcp_;
+    uint16_t port_;
+    sockaddr_in address_;
+    std::atomic<bool> lower_question_;
+    std::atomic<bool> drop_;
+    std::atomic<bool> truncate_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+
+static std::vector<std::string> Domains(size_t count) {
+    std::vector<std::string> domains;
+    for (size_t i = 0; i < count; i++) {
+        domains.push_back("www" + std::to_string(i) + ".Example.com");
+    }
+    return domains;
+}
+
+static bool AnsweredWith1234(const msdkdns_stub_result &result, const std::vector<msdkdns_response_address> &addresses) {
+    const msdkdns_response_answer &answer = result.answers[MSDKDNS_EResponseFamily_IPv4];
+    static const uint8_t kExpected[4] = {1, 2, 3, 4};
+    return result.status[MSDKDNS_EResponseFamily_IPv4] == MSDKDNS_EStubStatus_Answered && answer.count == 1 &&
+           answer.ttl == 300 && memcmp(addresses[answer.first].bytes, kExpected, 4) == 0;
+}
+
+// CNAME 链及地址记录的所有者名与查询大小写不同，按 RFC 4343 仍然匹配
+static void TestOwnerCase() {
+    MockDnsServer server;
+    MSDKDNS_CHECK(server.Start());
+    DnsStub stub(1);
+    MSDKDNS_CHECK(stub.AddServer(server.address()));
+    std::vector<std::string> domains = Domains(8);
+    std::vector<msdkdns_stub_result> results;
+    std::vector<msdkdns_response_address> addresses;
+    MSDKDNS_CHECK(stub.Resolve(domains, true, true, 2000, &results, &addresses));
+    for (size_t i = 0; i < domains.size(); i++) {
+        MSDKDNS_CHECK(AnsweredWith1234(results[i], addresses));
+        MSDKDNS_CHECK_EQ(MSDKDNS_EStubStatus_Answered, results[i].status[MSDKDNS_EResponseFamily_IPv6]);
+        MSDKDNS_CHECK_EQ(0u, results[i].answers[MSDKDNS_EResponseFamily_IPv6].count);
+    }
+    MSDKDNS_CHECK_EQ(0u, stub.Stats().case_fallbacks);
+    MSDKDNS_CHECK_EQ(16u, stub.Stats().sent);
+}
+
+// 不保留问题段大小写的服务器：首个应答后立即以全小写重发，不等待超时
+static void TestNo0x20Server() {
+    MockDnsServer server;
+    MSDKDNS_CHECK(server.Start());
+    server.set_lower_question(true);
+    DnsStub stub(2);
+    MSDKDNS_CHECK(stub.AddServer(server.address()));
+    std::vector<std::string> domains = Domains(8);
+    std::vector<msdkdns_stub_result> results;
+    std::vector<msdkdns_response_address> addresses;
+    int64_t begin = msdkdns_monotonic_ms();
+    MSDKDNS_CHECK(stub.Resolve(domains, true, false, 2000, &results, &addresses));
+    MSDKDNS_CHECK(msdkdns_monotonic_ms() - begin < 500);
+    for (size_t i = 0; i < domains.size(); i++) {
+        MSDKDNS_CHECK(AnsweredWith1234(results[i], addresses));
+    }
+    MSDKDNS_CHECK_EQ(8u, stub.Stats().case_fallbacks);
+    MSDKDNS_CHECK_EQ(16u, stub.Stats().sent);
+}
+
+// 无应答时超时，由调用方回退到系统解析
+static void TestTimeout() {
+    MockDnsServer server;
+    MSDKDNS_CHECK(server.Start());
+    server.set_drop(true);
+    DnsStub stub(3);
+    MSDKDNS_CHECK(stub.AddServer(server.address()));
+    std::vector<msdkdns_stub_result> results;
+    std::vector<msdkdns_response_address> addresses;
+    MSDKDNS_CHECK(stub.Resolve(Domains(2), true, false, 200, &results, &addresses));
+    MSDKDNS_CHECK_EQ(MSDKDNS_EStubStatus_Timeout, results[0].status[MSDKDNS_EResponseFamily_IPv4]);
+    MSDKDNS_CHECK_EQ(MSDKDNS_EStubStatus_Timeout, results[1].status[MSDKDNS_EResponseFamily_IPv4]);
+}
+
+// UDP 应答被截断时改用 TCP
+static void TestTruncated() {
+    MockDnsServer server;
+    MSDKDNS_CHECK(server.Start());
+    server.set_truncate(true);
+    DnsStub stub(4);
+    MSDKDNS_CHECK(stub.AddServer(server.address()));
+    std::vector<msdkdns_stub_result> results;
+    std::vector<msdkdns_response_address> addresses;
+    MSDKDNS_CHECK(stub.Resolve(Domains(2), true, false, 2000, &results, &addresses));
+    MSDKDNS_CHECK(AnsweredWith1234(results[0], addresses) && AnsweredWith1234(results[1], addresses));
+    MSDKDNS_CHECK_EQ(2u, stub.Stats().truncated);
+}
+
+// 问题段只有大小写不同时单独报告，其他字节不同仍为不匹配
+static void TestParseQuestion() {
+    uint8_t query[300];
+    size_t length = msdkdns_dns_build_query("www.example.com", 15, 0x1234, 1, 0xFFFFFFFFu, query, sizeof(query));
+    MSDKDNS_CHECK(length > 0 && query[13] == 'W');
+    std::vector<uint8_t> response(query, query + length);
+    response[2] = 0x81;
+    response[3] = 0x80;
+    uint8_t rcode = 0;
+    msdkdns_response_answer answer;
+    std::vector<msdkdns_response_address> addresses;
+    MSDKDNS_CHECK_EQ(MSDKDNS_EStubParse_Ok, msdkdns_dns_parse_answer(response.data(), response.size(), query, length,
+                                                                     false, &rcode, &answer, &addresses));
+    response[13] = 'w';
+    MSDKDNS_CHECK_EQ(MSDKDNS_EStubParse_CaseMismatch, msdkdns_dns_parse_answer(response.data(), response.size(), query,
+                                                                               length, false, &rcode, &answer, &addresses));
+    response[13] = 'x';
+    MSDKDNS_CHECK_EQ(MSDKDNS_EStubParse_Mismatch, msdkdns_dns_parse_answer(response.data(), response.size(), query,
+                                                                           length, false, &rcode, &answer, &addresses));
+}
+
+int main() {
+    TestOwnerCase();
+    TestNo0x20Server();
+    TestTimeout();
+    TestTruncated();
+    TestParseQuestion();
+    return MSDKDNS_TEST_RESULT();
+}
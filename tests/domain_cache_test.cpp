@@ -0,0 +1,229 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_domain_cache.h"
+#include "msdkdns_test.h"
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msdkdns;
+
+static msdkdns_domain_key Key(const std::string &domain) {
+    msdkdns_domain_key key;
+    MSDKDNS_CHECK(msdkdns_domain_interner()->Intern(domain.data(), domain.size(), &key));
+    return key;
+}
+
+static void CopyPayload(const EntryStore *, const msdkdns_entry_view &view, void *context) {
+    static_cast<std::string *>(context)->assign(reinterpret_cast<const char *>(view.payload), view.payload_length);
+}
+
+static void CountEntry(const EntryStore *, const msdkdns_entry_view &, void *context) {
+    (*static_cast<size_t *>(context))++;
+}
+
+static bool Reject(void *) {
+    return false;
+}
+
+static bool Put(DomainCache *cache, uint32_t partition, const std::string &domain, const std::string &payload) {
+    return cache->Put(partition, Key(domain), 1, 2, MSDKDNS_EEntryFlag_HttpDns, std::vector<std::string>(),
+                      reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+}
+
+static void TestBasic() {
+    DomainCache cache(16, 1 << 20);
+    uint32_t a = cache.NewPartition();
+    uint32_t b = cache.NewPartition();
+    MSDKDNS_CHECK(a != b);
+    MSDKDNS_CHECK(Put(&cache, a, "a.example.com", "one"));
+    MSDKDNS_CHECK(Put(&cache, b, "a.example.com", "two"));
+    std::string payload;
+    MSDKDNS_CHECK(cache.Find(a, Key("a.example.com"), CopyPayload, &payload));
+    MSDKDNS_CHECK(payload == "one");
+    MSDKDNS_CHECK(cache.Find(b, Key("a.example.com"), CopyPayload, &payload));
+    MSDKDNS_CHECK(payload == "two");
+    MSDKDNS_CHECK(!cache.Find(a, Key("b.example.com"), CopyPayload, &payload));
+
+    // 已有条目时不覆盖；没有时由 admit 决定
+    std::string other = "three";
+    MSDKDNS_CHECK(cache.PutIfAbsent(a, Key("a.example.com"), 1, 2, 0, std::vector<std::string>(),
+                                    reinterpret_cast<const uint8_t *>(other.data()), other.size(), NULL, NULL));
+    MSDKDNS_CHECK(cache.Find(a, Key("a.example.com"), CopyPayload, &payload));
+    MSDKDNS_CHECK(payload == "one");
+    MSDKDNS_CHECK(!cache.PutIfAbsent(a, Key("c.example.com"), 1, 2, 0, std::vector<std::string>(),
+                                     reinterpret_cast<const uint8_t *>(other.data()), other.size(), Reject, NULL));
+    MSDKDNS_CHECK(!cache.Find(a, Key("c.example.com"), NULL, NULL));
+    MSDKDNS_CHECK(!cache.PutIfAbsent(a, Key("c.example.com"), 1, 2, 0, std::vector<std::string>(),
+                                     reinterpret_cast<const uint8_t *>(other.data()), other.size(), NULL, NULL));
+    MSDKDNS_CHECK(cache.Find(a, Key("c.example.com"), CopyPayload, &payload));
+    MSDKDNS_CHECK(payload == "three");
+
+    MSDKDNS_CHECK_EQ(2u, cache.Count(a));
+    size_t visited = 0;
+    cache.Entries(a, CountEntry, &visited);
+    MSDKDNS_CHECK_EQ(2u, visited);
+
+    MSDKDNS_CHECK(cache.Remove(a, Key("a.example.com")));
+    MSDKDNS_CHECK(!cache.Find(a, Key("a.example.com"), NULL, NULL));
+    MSDKDNS_CHECK(cache.Find(b, Key("a.example.com"), NULL, NULL));
+    cache.RemovePartition(b);
+    MSDKDNS_CHECK_EQ(0u, cache.Count(b));
+    MSDKDNS_CHECK_EQ(1u, cache.Count(a));
+}
+
+static void TestBudget() {
+    DomainCache cache(4, 64 * 1024);
+    uint32_t partition = cache.NewPartition();
+    std::string payload(200, 'x');
+    for (int i = 0; i < 5000; i++) {
+        Put(&cache, partition, "budget" + std::to_string(i) + ".example.com", payload);
+    }
+    msdkdns_entry_stats stats;
+    cache.Stats(&stats);
+    MSDKDNS_CHECK(stats.bytes_reserved <= stats.budget);
+    MSDKDNS_CHECK(stats.evictions > 0);
+    MSDKDNS_CHECK(stats.entries < 5000);
+    cache.SetBudget(16 * 1024);
+    cache.Stats(&stats);
+    MSDKDNS_CHECK(stats.bytes_reserved <= 16 * 1024);
+}
+
+// 读写并发，读到的 payload 必须是某次完整写入的内容
+static void TestConcurrent() {
+    DomainCache cache(16, 1 << 20);
+    uint32_t partition = cache.NewPartition();
+    const int kDomains = 256;
+    std::vector<msdkdns_domain_key> keys;
+    for (int i = 0; i < kDomains; i++) {
+        keys.push_back(Key("concurrent" + std::to_string(i) + ".example.com"));
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<int> torn(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.push_back(std::thread([&, t]() {
+            std::string payload;
+            for (unsigned i = t; !stop.load(); i++) {
+                if (cache.Find(partition, keys[i % kDomains], CopyPayload, &payload) &&
+                    payload.find_first_not_of(payload[0]) != std::string::npos) {
+                    torn++;
+                }
+            }
+        }));
+    }
+    for (int round = 0; round < 200; round++) {
+        std::string payload(32 + round % 64, static_cast<char>('a' + round % 26));
+        for (int i = 0; i < kDomains; i++) {
+            cache.Put(partition, keys[i], 1, 2, 0, std::vector<std::string>(),
+                      reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+        }
+    }
+    stop = true;
+    for (size_t i = 0; i < readers.size(); i++) {
+        readers[i].join();
+    }
+    MSDKDNS_CHECK_EQ(0, torn.load());
+    MSDKDNS_CHECK_EQ(static_cast<size_t>(kDomains), cache.Count(partition));
+}
+
+static int64_t gVirtualNow = 0;
+
+static int64_t VirtualClock() {
+    return gVirtualNow;
+}
+
+static void RecordWakeup(int64_t deadline_ms, void *context) {
+    static_cast<std::vector<int64_t> *>(context)->push_back(deadline_ms);
+}
+
+static uint8_t Flags(DomainCache *cache, uint32_t partition, const std::string &domain) {
+    struct Reader {
+        static void Visit(const EntryStore *, const msdkdns_entry_view &view, void *context) {
+            *static_cast<int *>(context) = view.flags;
+        }
+    };
+    int flags = -1;
+    cache->Find(partition, Key(domain), Reader::Visit, &flags);
+    return static_cast<uint8_t>(flags);
+}
+
+// 过期在查询时按时钟判断，不需要推进时间轮；刷新由时间轮驱动。使用虚拟时钟
+static void TestExpiry() {
+    gVirtualNow = 1000000;
+    DomainCache cache(4, 1 << 20, VirtualClock);
+    std::vector<int64_t> wakeups;
+    cache.SetWakeup(RecordWakeup, &wakeups);
+    uint32_t partition = cache.NewPartition();
+    std::string payload = "x";
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(payload.data());
+    cache.Put(partition, Key("ttl30.example.com"), 0, gVirtualNow + 30000, MSDKDNS_EEntryFlag_HttpDns,
+              std::vector<std::string>(), bytes, 1);
+    cache.Put(partition, Key("ttl10.example.com"), 0, gVirtualNow + 10500, MSDKDNS_EEntryFlag_HttpDns,
+              std::vector<std::string>(), bytes, 1);
+    // 过期不进时间轮，写入不唤醒调用方
+    MSDKDNS_CHECK(wakeups.empty());
+    cache.Put(partition, Key("stale.example.com"), 0, gVirtualNow - 1, MSDKDNS_EEntryFlag_HttpDns,
+              std::vector<std::string>(), bytes, 1);
+    MSDKDNS_CHECK(Flags(&cache, partition, "stale.example.com") & MSDKDNS_EEntryFlag_Expired);
+    // 没有 HTTPDNS 结果的条目不参与过期
+    cache.Put(partition, Key("local.example.com"), 0, 0, 0, std::vector<std::string>(), bytes, 1);
+
+    // 时钟跳过 TTL（设备休眠、应用挂起期间不调用 Advance），查询时即为过期
+    gVirtualNow += 10499;
+    MSDKDNS_CHECK(!(Flags(&cache, partition, "ttl10.example.com") & MSDKDNS_EEntryFlag_Expired));
+    gVirtualNow += 1;
+    MSDKDNS_CHECK(Flags(&cache, partition, "ttl10.example.com") & MSDKDNS_EEntryFlag_Expired);
+    MSDKDNS_CHECK(!(Flags(&cache, partition, "ttl30.example.com") & MSDKDNS_EEntryFlag_Expired));
+    gVirtualNow = 1000000 + 10 * 3600 * 1000;
+    MSDKDNS_CHECK(Flags(&cache, partition, "ttl30.example.com") & MSDKDNS_EEntryFlag_Expired);
+    MSDKDNS_CHECK(!(Flags(&cache, partition, "local.example.com") & MSDKDNS_EEntryFlag_Expired));
+    struct Counter {
+        static void Visit(const EntryStore *, const msdkdns_entry_view &view, void *context) {
+            *static_cast<size_t *>(context) += (view.flags & MSDKDNS_EEntryFlag_Expired) ? 1 : 0;
+        }
+    };
+    size_t expired = 0;
+    cache.Entries(partition, Counter::Visit, &expired);
+    MSDKDNS_CHECK_EQ(3u, expired);
+
+    // 重新写入后按新的 expired_ms 判断
+    gVirtualNow = 1000000;
+    cache.Put(partition, Key("ttl30.example.com"), 0, gVirtualNow + 30000, MSDKDNS_EEntryFlag_HttpDns,
+              std::vector<std::string>(), bytes, 1);
+    MSDKDNS_CHECK(!(Flags(&cache, partition, "ttl30.example.com") & MSDKDNS_EEntryFlag_Expired));
+
+    // 刷新按格向上取整后唤醒调用方，到期的域名从 Advance 返回
+    cache.ScheduleRefresh(Key("ttl30.example.com"), gVirtualNow + 22500);
+    MSDKDNS_CHECK(wakeups.size() == 1 && wakeups[0] == gVirtualNow + 23000);
+    cache.ScheduleRefresh(Key("ttl10.example.com"), gVirtualNow + 40000);
+    MSDKDNS_CHECK_EQ(1u, wakeups.size());
+    std::vector<uint32_t> refresh;
+    gVirtualNow += 22999;
+    int64_t next = cache.Advance(&refresh);
+    MSDKDNS_CHECK(refresh.empty());
+    MSDKDNS_CHECK(next > gVirtualNow && next <= 1000000 + 23000);
+    gVirtualNow = 1000000 + 23000;
+    cache.Advance(&refresh);
+    MSDKDNS_CHECK(refresh.size() == 1 && refresh[0] == Key("ttl30.example.com").id);
+
+    // 取消的刷新不再返回，时间轮为空时返回 -1
+    refresh.clear();
+    cache.CancelRefresh(Key("ttl10.example.com"));
+    gVirtualNow += 60000;
+    next = cache.Advance(&refresh);
+    MSDKDNS_CHECK(refresh.empty());
+    MSDKDNS_CHECK_EQ(-1, next);
+}
+
+int main() {
+    TestBasic();
+    TestBudget();
+    TestConcurrent();
+    TestExpiry();
+    return MSDKDNS_TEST_RESULT();
+}
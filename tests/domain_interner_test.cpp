@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_domain_interner.h"
+#include "msdkdns_test.h"
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msdkdns;
+
+static bool Canonical(const std::string &domain, std::string *out) {
+    char buffer[kMSDKDnsMaxDomainLength];
+    size_t length = 0;
+    if (!msdkdns_canonicalize_domain(domain.data(), domain.size(), buffer, &length)) {
+        return false;
+    }
+    out->assign(buffer, length);
+    return true;
+}
+
+// 转小写、去掉一个结尾的点；空标签、超长、控制字符及非 ASCII 不合法，由调用方退回字符串键
+static void TestCanonicalize() {
+    std::string out;
+    MSDKDNS_CHECK(Canonical("WWW.Example.COM.", &out) && out == "www.example.com");
+    MSDKDNS_CHECK(Canonical("a-b_c.example.com", &out) && out == "a-b_c.example.com");
+    MSDKDNS_CHECK(!Canonical("", &out));
+    MSDKDNS_CHECK(!Canonical(".", &out));
+    MSDKDNS_CHECK(!Canonical("a..b", &out));
+    MSDKDNS_CHECK(!Canonical("a.b..", &out));
+    MSDKDNS_CHECK(!Canonical(".a.b", &out));
+    MSDKDNS_CHECK(!Canonical("a b.com", &out));
+    MSDKDNS_CHECK(!Canonical("\xe4\xbe\x8b\xe5\xad\x90.com", &out));
+    MSDKDNS_CHECK(Canonical(std::string(63, 'a') + ".com", &out));
+    MSDKDNS_CHECK(!Canonical(std::string(64, 'a') + ".com", &out));
+    std::string longest;
+    while (longest.size() + 64 <= kMSDKDnsMaxDomainLength) {
+        longest += std::string(63, 'a') + ".";
+    }
+    longest += std::string(kMSDKDnsMaxDomainLength - longest.size(), 'b');
+    MSDKDNS_CHECK(Canonical(longest, &out) && out.size() == kMSDKDnsMaxDomainLength);
+    MSDKDNS_CHECK(Canonical(longest + ".", &out));
+    MSDKDNS_CHECK(!Canonical(longest + "b", &out));
+}
+
+// 同一规范化文本的编号相同；已满后已有的仍可查找，新的加入失败
+static void TestInternAndCap() {
+    DomainInterner interner(100);
+    msdkdns_domain_key a;
+    msdkdns_domain_key b;
+    MSDKDNS_CHECK(interner.Intern("A.example.com", 13, &a) && interner.Intern("a.example.com.", 14, &b));
+    MSDKDNS_CHECK(a.id == b.id && a.hash == b.hash && a.id != 0);
+    size_t length = 0;
+    const char *text = interner.Text(a.id, &length);
+    MSDKDNS_CHECK(text && std::string(text, length) == "a.example.com");
+    MSDKDNS_CHECK(!interner.Text(0, &length) && !interner.Text(1000, &length));
+    MSDKDNS_CHECK(!interner.Find("b.example.com", 13, &b));
+
+    for (int i = 0; interner.Count() < 100; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "host%d.example.com", i);
+        MSDKDNS_CHECK(interner.Intern(name, strlen(name), &b));
+    }
+    MSDKDNS_CHECK(!interner.Intern("full.example.com", 16, &b));
+    MSDKDNS_CHECK(interner.Intern("a.example.com", 13, &b) && b.id == a.id);
+    MSDKDNS_CHECK(interner.Find("HOST42.example.com", 18, &b));
+    MSDKDNS_CHECK_EQ(100u, interner.Count());
+}
+
+// 不驻留的哈希与驻留后的 hash 一致，大小写和结尾的点不影响结果，且不会加入驻留表
+static void TestHashWithoutIntern() {
+    DomainInterner interner(100);
+    msdkdns_domain_key key;
+    MSDKDNS_CHECK(interner.Intern("www.qq.com", 10, &key));
+    MSDKDNS_CHECK_EQ(key.hash, msdkdns_domain_hash("www.qq.com", 10));
+    MSDKDNS_CHECK_EQ(key.hash, msdkdns_domain_hash("WWW.QQ.com.", 11));
+    MSDKDNS_CHECK(msdkdns_domain_hash("www.qq.com", 10) != msdkdns_domain_hash("www.qq.cn", 9));
+    size_t count = msdkdns_domain_interner()->Count();
+    for (int i = 0; i < 100; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "lane%d.example.com", i);
+        msdkdns_domain_hash(name, strlen(name));
+    }
+    MSDKDNS_CHECK_EQ(count, msdkdns_domain_interner()->Count());
+    // 不合法的域名按原文计算，结果固定
+    MSDKDNS_CHECK_EQ(msdkdns_domain_hash("bad..name", 9), msdkdns_domain_hash("bad..name", 9));
+    MSDKDNS_CHECK_EQ(0u, msdkdns_domain_hash(NULL, 0));
+}
+
+// 2个线程写入、4个线程无锁查找：查到的编号对应的文本须与查找的域名一致，最终每个域名都有唯一编号
+static void TestConcurrent() {
+    static const int kNames = 40000;
+    DomainInterner interner(kNames);
+    std::vector<std::string> names(kNames);
+    for (int i = 0; i < kNames; i++) {
+        char name[48];
+        snprintf(name, sizeof(name), "n%d.stress.example.com", i);
+        names[i] = name;
+    }
+    std::atomic<int> mismatches(0);
+    std::atomic<bool> writing(true);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < 2; w++) {
+        threads.push_back(std::thread([&, w]() {
+            // 两个写入线程有一半域名重叠
+            for (int i = w * kNames / 4; i < w * kNames / 4 + kNames * 3 / 4 && i < kNames; i++) {
+                msdkdns_domain_key key;
+                if (!interner.Intern(names[i].data(), names[i].size(), &key)) {
+                    mismatches++;
+                }
+            }
+        }));
+    }
+    for (int r = 0; r < 4; r++) {
+        threads.push_back(std::thread([&, r]() {
+            uint32_t i = static_cast<uint32_t>(r) * 7919;
+            while (writing.load()) {
+                i = (i * 1103515245u + 12345u) % kNames;
+                msdkdns_domain_key key;
+                if (!interner.Find(names[i].data(), names[i].size(), &key)) {
+                    continue;
+                }
+                size_t length = 0;
+                const char *text = interner.Text(key.id, &length);
+                if (!text || std::string(text, length) != names[i]) {
+                    mismatches++;
+                }
+            }
+        }));
+    }
+    threads[0].join();
+    threads[1].join();
+    writing = false;
+    for (size_t i = 2; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    MSDKDNS_CHECK_EQ(0, mismatches.load());
+    MSDKDNS_CHECK_EQ(static_cast<size_t>(kNames), interner.Count());
+    std::vector<bool> seen(kNames + 1, false);
+    for (int i = 0; i < kNames; i++) {
+        msdkdns_domain_key key;
+        MSDKDNS_CHECK(interner.Find(names[i].data(), names[i].size(), &key) && key.id <= kNames && !seen[key.id]);
+        if (key.id <= kNames) {
+            seen[key.id] = true;
+        }
+    }
+}
+
+int main() {
+    TestCanonicalize();
+    TestInternAndCap();
+    TestHashWithoutIntern();
+    TestConcurrent();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// DomainMatcher 与逐条后缀比较的参考实现对比：固定用例及随机规则集上的随机查询
+
+#include "msdkdns_domain_matcher.h"
+#include "msdkdns_domain_interner.h"
+#include "msdkdns_test.h"
+#include <ctype.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+// 参考实现：规则逐条规范化，精确规则比较全文，通配规则比较 "." + 后缀
+class LinearMatcher {
+public:
+    explicit LinearMatcher(const std::vector<std::string> &rules) {
+        for (size_t i = 0; i < rules.size(); i++) {
+            std::string rule = rules[i];
+            bool wildcard = rule.size() > 2 && rule[0] == '*' && rule[1] == '.';
+            if (wildcard) {
+                rule = rule.substr(2);
+            }
+            std::string text;
+            if (!Canonical(rule, &text) || text.find('*') != std::string::npos) {
+                continue;
+            }
+            (wildcard ? suffixes_ : exact_).push_back(wildcard ? "." + text : text);
+        }
+    }
+
+    bool Match(const std::string &domain) const {
+        std::string text;
+        if (!Canonical(domain, &text)) {
+            return false;
+        }
+        for (size_t i = 0; i < exact_.size(); i++) {
+            if (exact_[i] == text) {
+                return true;
+            }
+        }
+        for (size_t i = 0; i < suffixes_.size(); i++) {
+            const std::string &suffix = suffixes_[i];
+            if (text.size() > suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t RuleCount() const { return exact_.size() + suffixes_.size(); }
+
+private:
+    static bool Canonical(const std::string &domain, std::string *out) {
+        char buffer[kMSDKDnsMaxDomainLength];
+        size_t length = 0;
+        if (!msdkdns_canonicalize_domain(domain.data(), domain.size(), buffer, &length)) {
+            return false;
+        }
+        out->assign(buffer, length);
+        return true;
+    }
+
+    std::vector<std::string> exact_;
+    std::vector<std::string> suffixes_;
+};
+
+static bool Match(const DomainMatcher &matcher, const std::string &domain) {
+    return matcher.Match(domain.data(), domain.size());
+}
+
+static void TestCases() {
+    std::vector<std::string> rules;
+    rules.push_back("Example.com");
+    rules.push_back("*.cdn.example.com");
+    rules.push_back("*.net.");
+    rules.push_back("a..b");
+    rules.push_back("*");
+    rules.push_back("*.");
+    rules.push_back("a.*.com");
+    rules.push_back("**.org");
+    rules.push_back("\xe4\xbe\x8b.com");
+    DomainMatcher matcher(rules);
+    MSDKDNS_CHECK_EQ(3u, matcher.RuleCount());
+    MSDKDNS_CHECK(Match(matcher, "example.com"));
+    MSDKDNS_CHECK(Match(matcher, "EXAMPLE.COM."));
+    MSDKDNS_CHECK(!Match(matcher, "www.example.com"));
+    MSDKDNS_CHECK(!Match(matcher, "cdn.example.com"));
+    MSDKDNS_CHECK(Match(matcher, "a.cdn.example.com"));
+    MSDKDNS_CHECK(Match(matcher, "a.b.c.CDN.example.com"));
+    MSDKDNS_CHECK(Match(matcher, "x.net"));
+    MSDKDNS_CHECK(!Match(matcher, "net"));
+    MSDKDNS_CHECK(!Match(matcher, "a.b.com"));
+    MSDKDNS_CHECK(!Match(matcher, ""));
+    MSDKDNS_CHECK(!matcher.Match(NULL, 0));
+
+    DomainMatcher empty((std::vector<std::string>()));
+    MSDKDNS_CHECK(!Match(empty, "example.com"));
+}
+
+static std::string RandomName(std::mt19937 *random, int max_labels) {
+    static const char *const kLabels[] = {"a", "b", "ab", "x1", "cdn", "example", "com", "net", "A", "Com"};
+    int labels = 1 + static_cast<int>((*random)() % max_labels);
+    std::string name;
+    for (int i = 0; i < labels; i++) {
+        if (i > 0) {
+            name += ".";
+        }
+        name += kLabels[(*random)() % (sizeof(kLabels) / sizeof(kLabels[0]))];
+    }
+    return name;
+}
+
+// 随机规则集：以少量标签组合，使精确、通配及大小写、结尾点的情况频繁重叠；约5%的规则不合法
+static void TestRandom() {
+    std::mt19937 random(20221016);
+    size_t queries = 0;
+    size_t matches = 0;
+    for (int set = 0; set < 200; set++) {
+        std::vector<std::string> rules;
+        size_t count = 1 + random() % 64;
+        for (size_t i = 0; i < count; i++) {
+            std::string rule = RandomName(&random, 3);
+            uint32_t kind = random() % 20;
+            if (kind < 6) {
+                rule = "*." + rule;
+            } else if (kind == 6) {
+                rule += ".";
+            } else if (kind == 7) {
+                rule = "a.." + rule;
+            } else if (kind == 8) {
+                rule = "x.*." + rule;
+            }
+            rules.push_back(rule);
+        }
+        DomainMatcher matcher(rules);
+        LinearMatcher reference(rules);
+        MSDKDNS_CHECK_EQ(reference.RuleCount(), matcher.RuleCount());
+        for (int i = 0; i < 2000; i++) {
+            std::string host = RandomName(&random, 5);
+            if (random() % 4 == 0) {
+                // 已有规则的子域名
+                const std::string &rule = rules[random() % rules.size()];
+                host = RandomName(&random, 2) + "." + (rule.compare(0, 2, "*.") == 0 ? rule.substr(2) : rule);
+            }
+            if (random() % 8 == 0) {
+                host += ".";
+            }
+            bool expected = reference.Match(host);
+            if (Match(matcher, host) != expected) {
+                fprintf(stderr, "mismatch: %s\n", host.c_str());
+                MSDKDNS_CHECK(false);
+            }
+            matches += expected ? 1 : 0;
+            queries++;
+        }
+    }
+    // 随机数据须同时覆盖命中和未命中
+    MSDKDNS_CHECK(matches > queries / 10 && matches < queries * 9 / 10);
+}
+
+int main() {
+    TestCases();
+    TestRandom();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// EntryStore 与 std::map 模型对比：随机写入、替换、删除、标记过期和删除分区，
+// 预算充足时内容须与模型完全一致；预算很小时条目可被淘汰，但留下的必须与模型一致，占位条目不被淘汰
+
+#include "msdkdns_entry_store.h"
+#include "msdkdns_test.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace msdkdns;
+
+static const uint32_t kPartitions = 3;
+static const size_t kDomains = 300;
+
+struct ModelEntry {
+    int64_t begin_ms;
+    int64_t expired_ms;
+    uint8_t flags;
+    std::vector<std::string> atoms;
+    std::string payload;
+};
+
+typedef std::map<std::pair<uint32_t, uint32_t>, ModelEntry> Model;
+
+static std::vector<msdkdns_domain_key> MakeKeys() {
+    std::vector<msdkdns_domain_key> keys(kDomains);
+    for (size_t i = 0; i < kDomains; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "host%zu.entry-store.example.com", i);
+        MSDKDNS_CHECK(msdkdns_domain_interner()->Intern(name, strlen(name), &keys[i]));
+    }
+    return keys;
+}
+
+static bool SameEntry(const EntryStore &store, const msdkdns_entry_view &view, const ModelEntry &entry) {
+    if (view.begin_ms != entry.begin_ms || view.expired_ms != entry.expired_ms || view.flags != entry.flags ||
+        view.atom_count != entry.atoms.size() || view.payload_length != entry.payload.size() ||
+        memcmp(view.payload, entry.payload.data(), entry.payload.size()) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < view.atom_count; i++) {
+        size_t length = 0;
+        const char *text = store.AtomText(view.atoms[i], &length);
+        if (!text || std::string(text, length) != entry.atoms[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 预算很小时先去掉模型中已被淘汰的条目，返回去掉的个数
+static size_t DropEvicted(const EntryStore &store, const std::vector<msdkdns_domain_key> &keys, Model *model) {
+    std::map<uint32_t, size_t> index;
+    for (size_t i = 0; i < keys.size(); i++) {
+        index[keys[i].id] = i;
+    }
+    size_t dropped = 0;
+    for (Model::iterator it = model->begin(); it != model->end();) {
+        if (store.Contains(it->first.first, keys[index[it->first.second]])) {
+            ++it;
+            continue;
+        }
+        MSDKDNS_CHECK(!(it->second.flags & MSDKDNS_EEntryFlag_Removed));
+        model->erase(it++);
+        dropped++;
+    }
+    return dropped;
+}
+
+static void Verify(const EntryStore &store, const std::vector<msdkdns_domain_key> &keys, const Model &model) {
+    std::map<uint32_t, size_t> index;
+    for (size_t i = 0; i < keys.size(); i++) {
+        index[keys[i].id] = i;
+    }
+    size_t live[kPartitions + 1] = {0};
+    for (Model::const_iterator it = model.begin(); it != model.end(); ++it) {
+        msdkdns_entry_view view;
+        MSDKDNS_CHECK(store.Find(it->first.first, keys[index[it->first.second]], &view));
+        MSDKDNS_CHECK(view.domain == it->first.second);
+        MSDKDNS_CHECK(SameEntry(store, view, it->second));
+        if (!(it->second.flags & MSDKDNS_EEntryFlag_Removed)) {
+            live[it->first.first]++;
+        }
+    }
+    msdkdns_entry_stats stats;
+    store.Stats(&stats);
+    MSDKDNS_CHECK_EQ(model.size(), stats.entries);
+    MSDKDNS_CHECK(stats.bytes_reserved <= stats.budget);
+    for (uint32_t partition = 1; partition <= kPartitions; partition++) {
+        MSDKDNS_CHECK_EQ(live[partition], store.Count(partition));
+        std::vector<msdkdns_entry_view> views;
+        store.Entries(partition, &views);
+        size_t expected = 0;
+        for (Model::const_iterator it = model.begin(); it != model.end(); ++it) {
+            expected += it->first.first == partition ? 1 : 0;
+        }
+        MSDKDNS_CHECK_EQ(expected, views.size());
+        for (size_t i = 0; i < views.size(); i++) {
+            Model::const_iterator it = model.find(std::make_pair(partition, views[i].domain));
+            MSDKDNS_CHECK(it != model.end() && SameEntry(store, views[i], it->second));
+        }
+    }
+}
+
+static void Run(size_t budget, uint32_t seed, int rounds, bool bounded) {
+    static const char *const kAtoms[] = {"ctcc", "cmcc", "cucc", "10.0.0.1", "192.168.1.1", "0", "http"};
+    std::vector<msdkdns_domain_key> keys = MakeKeys();
+    EntryStore store(budget);
+    Model model;
+    std::mt19937 random(seed);
+    uint64_t evictions = 0;
+    size_t dropped = 0;
+    for (int round = 0; round < rounds; round++) {
+        uint32_t partition = 1 + random() % kPartitions;
+        const msdkdns_domain_key &key = keys[random() % keys.size()];
+        std::pair<uint32_t, uint32_t> model_key(partition, key.id);
+        int64_t now = round;
+        uint32_t op = random() % 100;
+        if (op < 60) {
+            ModelEntry entry;
+            entry.begin_ms = now;
+            entry.expired_ms = now + static_cast<int64_t>(random() % 200);
+            entry.flags = random() % 8 == 0 ? MSDKDNS_EEntryFlag_Removed : MSDKDNS_EEntryFlag_HttpDns;
+            size_t atom_count = random() % 4;
+            for (size_t i = 0; i < atom_count; i++) {
+                entry.atoms.push_back(kAtoms[random() % (sizeof(kAtoms) / sizeof(kAtoms[0]))]);
+            }
+            size_t length = random() % (random() % 16 == 0 ? 2048 : 160);
+            for (size_t i = 0; i < length; i++) {
+                entry.payload.push_back(static_cast<char>(random()));
+            }
+            bool stored = store.Put(partition, key, entry.begin_ms, entry.expired_ms, entry.flags, entry.atoms,
+                                    reinterpret_cast<const uint8_t *>(entry.payload.data()), entry.payload.size());
+            MSDKDNS_CHECK(stored || bounded);
+            if (stored) {
+                model[model_key] = entry;
+            } else {
+                model.erase(model_key);
+            }
+        } else if (op < 80) {
+            MSDKDNS_CHECK_EQ(model.erase(model_key) > 0, store.Remove(partition, key));
+        } else if (op < 98) {
+            MSDKDNS_CHECK_EQ(model.count(model_key) > 0, store.Contains(partition, key));
+        } else {
+            size_t expected = 0;
+            for (Model::iterator it = model.begin(); it != model.end();) {
+                if (it->first.first == partition) {
+                    model.erase(it++);
+                    expected++;
+                } else {
+                    ++it;
+                }
+            }
+            MSDKDNS_CHECK_EQ(expected, store.RemovePartition(partition));
+        }
+        if (bounded) {
+            dropped += DropEvicted(store, keys, &model);
+        }
+        if (round % 97 == 0 || round == rounds - 1) {
+            Verify(store, keys, model);
+        }
+    }
+    msdkdns_entry_stats stats;
+    store.Stats(&stats);
+    evictions = stats.evictions;
+    // 模型中消失的条目都由淘汰造成
+    MSDKDNS_CHECK_EQ(static_cast<uint64_t>(dropped), evictions);
+    MSDKDNS_CHECK(bounded ? evictions > 0 : evictions == 0);
+}
+
+// 预算缩小时立即淘汰到预算以内，留下的与模型一致
+static void TestShrink() {
+    std::vector<msdkdns_domain_key> keys = MakeKeys();
+    EntryStore store(1 << 20);
+    Model model;
+    std::string payload(100, 'x');
+    for (size_t i = 0; i < keys.size(); i++) {
+        ModelEntry entry = {1, 2, MSDKDNS_EEntryFlag_HttpDns, std::vector<std::string>(), payload};
+        MSDKDNS_CHECK(store.Put(1, keys[i], 1, 2, entry.flags, entry.atoms,
+                                reinterpret_cast<const uint8_t *>(payload.data()), payload.size()));
+        model[std::make_pair(1u, keys[i].id)] = entry;
+    }
+    store.SetBudget(8 * 1024);
+    size_t dropped = DropEvicted(store, keys, &model);
+    MSDKDNS_CHECK(dropped > 0 && !model.empty());
+    Verify(store, keys, model);
+}
+
+int main() {
+    Run(4 << 20, 1, 20000, false);
+    Run(16 * 1024, 2, 20000, true);
+    TestShrink();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// hex_test 使用当前平台的 SIMD 实现，hex_scalar_test 以 MSDKDNS_HEX_NO_SIMD 编译，只测逐字节实现
+
+#include "msdkdns_hex.h"
+#include "msdkdns_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static std::string ReferenceEncode(const std::vector<uint8_t> &bytes) {
+    std::string hex;
+    for (size_t i = 0; i < bytes.size(); i++) {
+        char pair[3];
+        snprintf(pair, sizeof(pair), "%02x", bytes[i]);
+        hex += pair;
+    }
+    return hex;
+}
+
+static int ReferenceValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 覆盖 SIMD 整块和尾部逐字节两部分的各种长度
+static void TestRoundTrip() {
+    for (size_t length = 0; length <= 100; length++) {
+        std::vector<uint8_t> bytes(length);
+        for (size_t i = 0; i < length; i++) {
+            bytes[i] = static_cast<uint8_t>(rand());
+        }
+        std::string hex(length * 2, '\0');
+        msdkdns_hex_encode(bytes.data(), length, &hex[0]);
+        MSDKDNS_CHECK(hex == ReferenceEncode(bytes));
+
+        std::vector<uint8_t> decoded(length);
+        MSDKDNS_CHECK(msdkdns_hex_decode(hex.data(), hex.size(), decoded.data()));
+        MSDKDNS_CHECK(decoded == bytes);
+
+        // 大写字符同样接受
+        for (size_t i = 0; i < hex.size(); i++) {
+            if (rand() % 2 && hex[i] >= 'a') {
+                hex[i] = static_cast<char>(hex[i] - 'a' + 'A');
+            }
+        }
+        std::vector<uint8_t> upper(length);
+        MSDKDNS_CHECK(msdkdns_hex_decode(hex.data(), hex.size(), upper.data()));
+        MSDKDNS_CHECK(upper == bytes);
+    }
+}
+
+// 任意位置出现的任意字节值都按参考实现判断是否合法
+static void TestStrict() {
+    std::string hex(96, '0');
+    for (size_t position = 0; position < hex.size(); position += 7) {
+        for (int value = 0; value < 256; value++) {
+            std::string input = hex;
+            input[position] = static_cast<char>(value);
+            uint8_t out[48];
+            bool expected = ReferenceValue(static_cast<char>(value)) >= 0;
+            bool decoded = msdkdns_hex_decode(input.data(), input.size(), out);
+            MSDKDNS_CHECK_EQ(expected, decoded);
+            if (expected && decoded) {
+                MSDKDNS_CHECK_EQ(position % 2 ? ReferenceValue(input[position]) : ReferenceValue(input[position]) << 4,
+                                 out[position / 2]);
+            }
+        }
+    }
+    uint8_t out[8];
+    MSDKDNS_CHECK(!msdkdns_hex_decode("abc", 3, out));
+    MSDKDNS_CHECK(msdkdns_hex_decode("", 0, out));
+    MSDKDNS_CHECK(!msdkdns_hex_decode("0g", 2, out));
+    MSDKDNS_CHECK(!msdkdns_hex_decode("0x12", 4, out));
+}
+
+int main() {
+    srand(3);
+    TestRoundTrip();
+    TestStrict();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_http_pool.h"
+#include "msdkdns_mock_server.h"
+#include "msdkdns_test.h"
+#include <string.h>
+#include <future>
+#include <string>
+
+using namespace msdkdns;
+
+static void OnResponse(void *context, const msdkdns_http_response *response) {
+    static_cast<std::promise<int> *>(context)->set_value(response->result == MSDKDNS_EHttpResult_Ok ? response->status : -1);
+}
+
+static int Get(HttpPool *pool, uint16_t port) {
+    std::promise<int> promise;
+    if (pool->Get("127.0.0.1", port, "/d?dn=a.com", 1000, OnResponse, &promise) == 0) {
+        return -1;
+    }
+    return promise.get_future().get();
+}
+
+static std::string Answer(const std::string &) {
+    return "1.1.1.1,60";
+}
+
+// 串行请求复用同一个长连接
+static void TestReuse() {
+    MockHttpServer server(Answer);
+    MSDKDNS_CHECK(server.Start());
+    HttpPool pool(2, 4);
+    MSDKDNS_CHECK(pool.Start());
+    for (int i = 0; i < 20; i++) {
+        MSDKDNS_CHECK_EQ(200, Get(&pool, server.port()));
+    }
+    msdkdns_http_pool_stats stats;
+    pool.Stats(&stats, NULL);
+    MSDKDNS_CHECK_EQ(1u, stats.connects);
+    MSDKDNS_CHECK_EQ(19u, stats.reused);
+    pool.Stop();
+    server.Stop();
+}
+
+/*
+ * 首个连接以 Connection: close 结束后连接池预热一个新连接，之后的连接一建立就被服务端关闭
+ * 没有完成过请求的连接被关闭时不再预热，否则会在 kWarmMs 内不停地建连
+ */
+static void TestNoRewarmLoop() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    MSDKDNS_CHECK(bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 && listen(listener, 128) == 0 &&
+                  getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &length) == 0);
+    std::atomic<int> accepted(0);
+    std::thread thread([&]() {
+        for (;;) {
+            int client = accept(listener, NULL, NULL);
+            if (client < 0) {
+                return;
+            }
+            if (accepted++ == 0) {
+                char buffer[1024];
+                std::string request;
+                while (request.find("\r\n\r\n") == std::string::npos) {
+                    ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+                    if (n <= 0) {
+                        break;
+                    }
+                    request.append(buffer, static_cast<size_t>(n));
+                }
+                const char *response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+                send(client, response, strlen(response), MSG_NOSIGNAL);
+            }
+            close(client);
+        }
+    });
+
+    HttpPool pool(2, 4);
+    MSDKDNS_CHECK(pool.Start());
+    MSDKDNS_CHECK_EQ(200, Get(&pool, ntohs(addr.sin_port)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    msdkdns_http_pool_stats stats;
+    pool.Stats(&stats, NULL);
+    MSDKDNS_CHECK_EQ(1u, stats.proactive_reconnects);
+    MSDKDNS_CHECK_EQ(2u, stats.connects);
+    MSDKDNS_CHECK_EQ(2, accepted.load());
+    pool.Stop();
+    shutdown(listener, SHUT_RDWR);
+    close(listener);
+    thread.join();
+}
+
+int main() {
+    TestReuse();
+    TestNoRewarmLoop();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// 与系统 inet_pton / inet_ntop 对照：固定用例、全部单字节输入，以及固定种子的随机和变异输入
+
+#include "msdkdns_ip.h"
+#include "msdkdns_test.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <string>
+
+using namespace msdkdns;
+
+static const int kFuzzRounds = 200000;
+
+// 解析结果与 inet_pton 一致：同为合法时地址相同
+static bool SameAsSystem(int family, const std::string &text) {
+    uint8_t expected[16];
+    uint8_t actual[16];
+    bool system_ok = inet_pton(family, text.c_str(), expected) == 1;
+    bool ok = family == AF_INET ? msdkdns_parse_ipv4(text.data(), text.size(), actual)
+                                : msdkdns_parse_ipv6(text.data(), text.size(), actual);
+    if (ok != system_ok || (ok && memcmp(expected, actual, family == AF_INET ? 4 : 16) != 0)) {
+        fprintf(stderr, "parse mismatch for %s \"%s\": system %d, msdkdns %d\n", family == AF_INET ? "v4" : "v6",
+                text.c_str(), system_ok, ok);
+        return false;
+    }
+    return true;
+}
+
+static bool FormatSameAsSystem(int family, const uint8_t *bytes) {
+    char expected[INET6_ADDRSTRLEN];
+    char actual[kMSDKDnsIPTextSize];
+    inet_ntop(family, bytes, expected, sizeof(expected));
+    size_t length = msdkdns_format_ip(family, bytes, actual);
+    if (strcmp(expected, actual) != 0 || length != strlen(expected)) {
+        fprintf(stderr, "format mismatch: system \"%s\", msdkdns \"%s\"\n", expected, actual);
+        return false;
+    }
+    return true;
+}
+
+static void TestKnown() {
+    static const char *kV4[] = {
+        "0.0.0.0", "1.2.3.4", "255.255.255.255", "256.1.1.1", "01.2.3.4", "1.2.3", "1.2.3.4.", "1..2.3",
+        "1.2.3.4 ", " 1.2.3.4", "1.2.3.4a", "1.2.3.04", "999.1.1.1", "1.2.3.-4", "",
+    };
+    static const char *kV6[] = {
+        "::", "::1", "1::", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7::", "::2:3:4:5:6:7:8", "1::8", "fe80::1%en0",
+        "::ffff:1.2.3.4", "::1.2.3.4", "1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:1.2.3.4", "1:2:3:4:5:6:7:8:9",
+        ":::", "1:::2", "1::2::3", ":1::", "1:", ":1", "12345::", "ABCD:EF01::", "::ffff:01.2.3.4",
+        "::ffff:1.2.3", "1:2:3:4:5:6:7:8::", "::1:2:3:4:5:6:7", "::1:2:3:4:5:6:7:8", "g::", "0000:0000::0000",
+    };
+    for (size_t i = 0; i < sizeof(kV4) / sizeof(kV4[0]); i++) {
+        MSDKDNS_CHECK(SameAsSystem(AF_INET, kV4[i]));
+        MSDKDNS_CHECK(SameAsSystem(AF_INET6, kV4[i]));
+    }
+    for (size_t i = 0; i < sizeof(kV6) / sizeof(kV6[0]); i++) {
+        MSDKDNS_CHECK(SameAsSystem(AF_INET6, kV6[i]));
+        MSDKDNS_CHECK(SameAsSystem(AF_INET, kV6[i]));
+    }
+    // 长度之内的 \0 不合法，之后的内容不读取
+    uint8_t out[16];
+    MSDKDNS_CHECK(!msdkdns_parse_ipv4("1.2.3.4\0", 8, out));
+    MSDKDNS_CHECK(msdkdns_parse_ipv4("1.2.3.45", 7, out) && out[3] == 4);
+    MSDKDNS_CHECK_EQ(AF_INET6, msdkdns_parse_ip("::1", 3, out));
+    MSDKDNS_CHECK_EQ(0, msdkdns_parse_ip("x", 1, out));
+}
+
+// 每个字节值分别作为一组的唯一字符，覆盖十六进制查表的每一项
+static void TestEveryByte() {
+    for (int c = 1; c < 256; c++) {
+        std::string text = "1::";
+        text += static_cast<char>(c);
+        MSDKDNS_CHECK(SameAsSystem(AF_INET6, text));
+        text = std::string(1, static_cast<char>(c)) + "::1";
+        MSDKDNS_CHECK(SameAsSystem(AF_INET6, text));
+    }
+}
+
+static std::string RandomText(std::mt19937 *random) {
+    static const char kAlphabet[] = "0123456789abcdefABCDEF:::...xg %";
+    std::string text;
+    size_t length = (*random)() % 48;
+    for (size_t i = 0; i < length; i++) {
+        // 偶尔混入任意字节（不含\0）
+        if ((*random)() % 16 == 0) {
+            text += static_cast<char>(1 + (*random)() % 255);
+        } else {
+            text += kAlphabet[(*random)() % (sizeof(kAlphabet) - 1)];
+        }
+    }
+    return text;
+}
+
+// 随机地址，偏向连续的0组和映射地址等格式化的边界情况
+static void RandomAddress(std::mt19937 *random, uint8_t bytes[16]) {
+    for (int i = 0; i < 16; i++) {
+        bytes[i] = static_cast<uint8_t>((*random)());
+    }
+    for (int i = 0; i < 8; i++) {
+        if ((*random)() % 3 == 0) {
+            bytes[2 * i] = 0;
+            bytes[2 * i + 1] = (*random)() % 4 == 0 ? static_cast<uint8_t>((*random)() % 16) : 0;
+        }
+    }
+    if ((*random)() % 8 == 0) {
+        memset(bytes, 0, 10);
+        bytes[10] = bytes[11] = (*random)() % 2 ? 0xFF : 0;
+    }
+}
+
+// 合法地址的文本经增删改一个字符后再解析
+static std::string Mutate(std::mt19937 *random, std::string text) {
+    static const char kAlphabet[] = "0123456789aAfF:.g";
+    size_t at = text.empty() ? 0 : (*random)() % text.size();
+    char c = kAlphabet[(*random)() % (sizeof(kAlphabet) - 1)];
+    switch ((*random)() % 4) {
+        case 0:
+            text.insert(at, 1, c);
+            break;
+        case 1:
+            if (!text.empty()) {
+                text.erase(at, 1);
+            }
+            break;
+        case 2:
+            if (!text.empty()) {
+                text[at] = c;
+            }
+            break;
+        default:
+            break;
+    }
+    return text;
+}
+
+static void TestFuzz() {
+    std::mt19937 random(20221016);
+    int mismatches = 0;
+    for (int round = 0; round < kFuzzRounds && mismatches < 10; round++) {
+        uint8_t bytes[16];
+        RandomAddress(&random, bytes);
+        mismatches += FormatSameAsSystem(AF_INET6, bytes) ? 0 : 1;
+        mismatches += FormatSameAsSystem(AF_INET, bytes) ? 0 : 1;
+
+        char text[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, bytes, text, sizeof(text));
+        std::string mutated = Mutate(&random, text);
+        mismatches += SameAsSystem(AF_INET6, mutated) ? 0 : 1;
+        inet_ntop(AF_INET, bytes, text, sizeof(text));
+        mutated = Mutate(&random, text);
+        mismatches += SameAsSystem(AF_INET, mutated) ? 0 : 1;
+
+        std::string noise = RandomText(&random);
+        mismatches += SameAsSystem(AF_INET6, noise) ? 0 : 1;
+        mismatches += SameAsSystem(AF_INET, noise) ? 0 : 1;
+    }
+    MSDKDNS_CHECK_EQ(0, mismatches);
+}
+
+// 同一地址的不同写法去重
+static void TestAddressSet() {
+    AddressSet set;
+    MSDKDNS_CHECK(set.InsertText("2001:DB8::1", 11));
+    MSDKDNS_CHECK(!set.InsertText("2001:0db8:0:0:0:0:0:1", 21));
+    MSDKDNS_CHECK(set.InsertText("1.2.3.4", 7));
+    MSDKDNS_CHECK(!set.InsertText("1.2.3.4", 7));
+    MSDKDNS_CHECK(!set.InsertText("1.2.3.256", 9));
+    MSDKDNS_CHECK_EQ(2u, set.Size());
+}
+
+int main() {
+    TestKnown();
+    TestEveryByte();
+    TestFuzz();
+    TestAddressSet();
+    return MSDKDNS_TEST_RESULT();
+}
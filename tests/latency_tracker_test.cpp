@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_latency_tracker.h"
+#include "msdkdns_test.h"
+
+using namespace msdkdns;
+
+static const double kTimeoutMs = 2000;
+
+// 窗口写满后覆盖最旧的样本；样本不足时不给出分位数
+static void TestWindow() {
+    LatencyTracker tracker(10);
+    double ms = 0;
+    for (int i = 0; i < 7; i++) {
+        tracker.Record("a", 100);
+    }
+    MSDKDNS_CHECK_EQ(7u, tracker.Samples("a"));
+    MSDKDNS_CHECK(!tracker.Quantile("a", 0.5, &ms));
+    tracker.Record("a", 100);
+    MSDKDNS_CHECK(tracker.Quantile("a", 0.5, &ms) && ms == 100);
+
+    // 再写入10个样本后原有的全部被覆盖
+    for (int i = 0; i < 10; i++) {
+        tracker.Record("a", 10 * (i + 1));
+    }
+    MSDKDNS_CHECK_EQ(10u, tracker.Samples("a"));
+    MSDKDNS_CHECK(tracker.Quantile("a", 0, &ms) && ms == 10);
+    MSDKDNS_CHECK(tracker.Quantile("a", 1, &ms) && ms == 100);
+    MSDKDNS_CHECK(tracker.Quantile("a", 0.5, &ms) && ms == 60);
+
+    // 负值按0计，各服务IP互不影响
+    tracker.Record("b", -5);
+    MSDKDNS_CHECK_EQ(1u, tracker.Samples("b"));
+    MSDKDNS_CHECK_EQ(0u, tracker.Samples("c"));
+    tracker.Clear();
+    MSDKDNS_CHECK_EQ(0u, tracker.Samples("a"));
+    MSDKDNS_CHECK(!tracker.Quantile("a", 0.5, &ms));
+}
+
+// 对冲延迟：无历史时为总超时的1/4，否则为 p95，限制在 [30ms, 总超时/2]
+static void TestHedgeDelay() {
+    LatencyTracker tracker(64);
+    MSDKDNS_CHECK_EQ(500.0, tracker.HedgeDelayMs("a", kTimeoutMs));
+    // 总超时很短时不低于下限
+    MSDKDNS_CHECK_EQ(30.0, tracker.HedgeDelayMs("a", 100));
+
+    for (int i = 0; i < 20; i++) {
+        tracker.Record("a", 5);
+    }
+    MSDKDNS_CHECK_EQ(30.0, tracker.HedgeDelayMs("a", kTimeoutMs));
+
+    for (int i = 0; i < 20; i++) {
+        tracker.Record("b", i < 19 ? 40 : 900);
+    }
+    MSDKDNS_CHECK_EQ(40.0, tracker.HedgeDelayMs("b", kTimeoutMs));
+
+    // 超时计入样本，p95 超过总超时一半时取上限
+    for (int i = 0; i < 20; i++) {
+        tracker.RecordTimeout("c", kTimeoutMs);
+    }
+    MSDKDNS_CHECK_EQ(1000.0, tracker.HedgeDelayMs("c", kTimeoutMs));
+}
+
+// 单次超时：无历史时为总超时，否则为 4 * p95，不低于500ms，不超过总超时
+static void TestAttemptTimeout() {
+    LatencyTracker tracker(64);
+    MSDKDNS_CHECK_EQ(kTimeoutMs, tracker.AttemptTimeoutMs("a", kTimeoutMs));
+    for (int i = 0; i < 20; i++) {
+        tracker.Record("a", 20);
+        tracker.Record("b", 300);
+        tracker.Record("c", 800);
+    }
+    MSDKDNS_CHECK_EQ(500.0, tracker.AttemptTimeoutMs("a", kTimeoutMs));
+    MSDKDNS_CHECK_EQ(1200.0, tracker.AttemptTimeoutMs("b", kTimeoutMs));
+    MSDKDNS_CHECK_EQ(kTimeoutMs, tracker.AttemptTimeoutMs("c", kTimeoutMs));
+    MSDKDNS_CHECK_EQ(300.0, tracker.AttemptTimeoutMs("a", 300));
+}
+
+int main() {
+    TestWindow();
+    TestHedgeDelay();
+    TestAttemptTimeout();
+    return MSDKDNS_TEST_RESULT();
+}
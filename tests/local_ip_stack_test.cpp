@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_local_ip_stack.h"
+#include "msdkdns_test.h"
+#include <pthread.h>
+
+using namespace msdkdns;
+
+static bool IsValid(MSDKDNS_TLocalIPStack stack) {
+    return stack >= MSDKDNS_ELocalIPStack_None && stack <= MSDKDNS_ELocalIPStack_Dual;
+}
+
+// 缓存结果与所选探测方式的实时结果一致，失效或切换探测方式后重新探测
+static void TestCached() {
+    msdkdns_set_local_ip_stack_detector(MSDKDNS_ELocalIPStackDetector_Connect);
+    MSDKDNS_TLocalIPStack connect = msdkdns_detect_local_ip_stack();
+    MSDKDNS_CHECK(IsValid(connect));
+    MSDKDNS_CHECK_EQ(connect, msdkdns_cached_local_ip_stack());
+    MSDKDNS_CHECK_EQ(connect, msdkdns_cached_local_ip_stack());
+    msdkdns_invalidate_local_ip_stack();
+    MSDKDNS_CHECK_EQ(connect, msdkdns_cached_local_ip_stack());
+
+    msdkdns_set_local_ip_stack_detector(MSDKDNS_ELocalIPStackDetector_Ifaddrs);
+    MSDKDNS_TLocalIPStack ifaddrs = msdkdns_detect_local_ip_stack_ifaddrs();
+    MSDKDNS_CHECK(IsValid(ifaddrs));
+    MSDKDNS_CHECK_EQ(ifaddrs, msdkdns_cached_local_ip_stack());
+    msdkdns_set_local_ip_stack_detector(MSDKDNS_ELocalIPStackDetector_Connect);
+    MSDKDNS_CHECK_EQ(connect, msdkdns_cached_local_ip_stack());
+}
+
+static volatile bool gStop = false;
+static int gInvalid = 0;
+
+static void *Lookup(void *) {
+    while (!__atomic_load_n(&gStop, __ATOMIC_ACQUIRE)) {
+        if (!IsValid(msdkdns_cached_local_ip_stack())) {
+            __atomic_add_fetch(&gInvalid, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+// 多线程读取时并发失效，读到的始终是合法结果
+static void TestConcurrentInvalidate() {
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, Lookup, NULL);
+    }
+    for (int i = 0; i < 2000; i++) {
+        msdkdns_invalidate_local_ip_stack();
+    }
+    __atomic_store_n(&gStop, true, __ATOMIC_RELEASE);
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    MSDKDNS_CHECK_EQ(0, gInvalid);
+    MSDKDNS_CHECK_EQ(msdkdns_detect_local_ip_stack(), msdkdns_cached_local_ip_stack());
+}
+
+int main() {
+    TestCached();
+    TestConcurrentInvalidate();
+    return MSDKDNS_TEST_RESULT();
+}
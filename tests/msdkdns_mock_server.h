@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_TESTS_MSDKDNS_MOCK_SERVER_H_
+#define HTTPDNS_SDK_IOS_TESTS_MSDKDNS_MOCK_SERVER_H_
+
+// 本地回环 HTTP/1.1 服务器，供测试和性能测试代替 HTTPDNS 服务端
+// 每个连接一个线程，支持 keep-alive 和管线化；响应前按 delay_ms 等待，模拟服务端耗时
+
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MockHttpServer {
+public:
+    // 返回响应体；target 为请求行中的 path 及 query
+    typedef std::function<std::string(const std::string &target)> Handler;
+
+    explicit MockHttpServer(Handler handler) : handler_(handler), fd_(-1), port_(0), delay_ms_(0), requests_(0) {}
+    ~MockHttpServer() { Stop(); }
+
+    bool Start() {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd_ < 0) {
+            return false;
+        }
+        int on = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr = sockaddr_in();
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd_, 128) != 0 ||
+            getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &length) != 0) {
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        accept_thread_ = std::thread(&MockHttpServer::AcceptLoop, this);
+        return true;
+    }
+
+    void Stop() {
+        if (fd_ < 0) {
+            return;
+        }
+        shutdown(fd_, SHUT_RDWR);
+        close(fd_);
+        fd_ = -1;
+        accept_thread_.join();
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < clients_.size(); i++) {
+                shutdown(clients_[i], SHUT_RDWR);
+            }
+            threads.swap(threads_);
+        }
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+    uint16_t port() const { return port_; }
+    void set_delay_ms(int delay_ms) { delay_ms_ = delay_ms; }
+    uint32_t requests() const { return requests_; }
+
+private:
+    void AcceptLoop() {
+        for (;;) {
+            int client = accept(fd_, NULL, NULL);
+            if (client < 0) {
+                return;
+            }
+            int on = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            std::lock_guard<std::mutex> lock(mutex_);
+            clients_.push_back(client);
+            threads_.push_back(std::thread(&MockHttpServer::Serve, this, client));
+        }
+    }
+
+    void Serve(int client) {
+        std::string buffer;
+        char chunk[4096];
+        for (;;) {
+            size_t end = buffer.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                ssize_t n = recv(client, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    break;
+                }
+                buffer.append(chunk, static_cast<size_t>(n));
+                continue;
+            }
+            // 只处理无请求体的 GET
+            std::string line = buffer.substr(0, buffer.find("\r\n"));
+            buffer.erase(0, end + 4);
+            size_t first = line.find(' ');
+            size_t last = line.rfind(' ');
+            std::string target = (first != std::string::npos && last > first) ? line.substr(first + 1, last - first - 1)
+                                                                               : std::string();
+            requests_++;
+            if (delay_ms_ > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_.load()));
+            }
+            std::string body = handler_(target);
+            std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: " +
+                                   std::to_string(body.size()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+            if (send(client, response.data(), response.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(response.size())) {
+                break;
+            }
+        }
+        // 先移出列表再关闭，避免 Stop 对被复用的描述符调用 shutdown
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < clients_.size(); i++) {
+            if (clients_[i] == client) {
+                clients_.erase(clients_.begin() + i);
+                break;
+            }
+        }
+        close(client);
+    }
+
+    Handler handler_;
+    int fd_;
+    uint16_t port_;
+    std::atomic<int> delay_ms_;
+    std::atomic<uint32_t> requests_;
+    std::thread accept_thread_;
+    std::mutex mutex_;
+    std::vector<int> clients_;
+    std::vector<std::thread> threads_;
+};
+
+#endif  // HTTPDNS_SDK_IOS_TESTS_MSDKDNS_MOCK_SERVER_H_
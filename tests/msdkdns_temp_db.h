@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_TESTS_MSDKDNS_TEMP_DB_H_
+#define HTTPDNS_SDK_IOS_TESTS_MSDKDNS_TEMP_DB_H_
+
+// 在临时目录中创建与 MSDKDnsDB 相同表结构的数据库，析构时删除整个目录
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sqlite3.h>
+#include <map>
+#include <string>
+
+// 与 MSDKDnsDB 的建表语句一致
+static const char kMSDKDnsTestCreateSql[] =
+    "create table if not exists HttpDNSTable(id integer primary key autoincrement, domain text UNIQUE, "
+    "httpDnsIPV4Channel text, httpDnsIPV4ClientIP text, httpDnsIPV4IPs text, httpDnsIPV4TimeConsuming text, "
+    "httpDnsIPV4TTL text, httpDnsIPV4TTLExpried text, httpDnsIPV6Channel text, httpDnsIPV6ClientIP text, "
+    "httpDnsIPV6IPs text, httpDnsIPV6TimeConsuming text, httpDnsIPV6TTL text, httpDnsIPV6TTLExpried text)";
+
+class TempDB {
+public:
+    TempDB() : db_(NULL) {
+        char dir[] = "/tmp/msdkdns_test_XXXXXX";
+        dir_ = mkdtemp(dir) ? dir : "/tmp";
+        path_ = dir_ + "/httpdns.sqlite";
+        sqlite3_open(path_.c_str(), &db_);
+        // 与 MSDKDnsDB 相同的日志模式
+        sqlite3_exec(db_, "PRAGMA journal_mode=WAL", NULL, NULL, NULL);
+        sqlite3_exec(db_, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+        sqlite3_exec(db_, kMSDKDnsTestCreateSql, NULL, NULL, NULL);
+    }
+
+    ~TempDB() {
+        sqlite3_close(db_);
+        DIR *dir = opendir(dir_.c_str());
+        if (dir) {
+            for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..") {
+                    unlink((dir_ + "/" + name).c_str());
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(dir_.c_str());
+    }
+
+    sqlite3 *db() const { return db_; }
+    const std::string &path() const { return path_; }
+    // 目录中的其他文件，如快照
+    std::string File(const char *name) const { return dir_ + "/" + name; }
+
+    // domain -> httpDnsIPV4IPs
+    std::map<std::string, std::string> Rows() const {
+        std::map<std::string, std::string> rows;
+        sqlite3_stmt *stmt = NULL;
+        sqlite3_prepare_v2(db_, "select domain, httpDnsIPV4IPs from HttpDNSTable", -1, &stmt, NULL);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const unsigned char *ips = sqlite3_column_text(stmt, 1);
+            rows[(const char *)sqlite3_column_text(stmt, 0)] = ips ? (const char *)ips : "";
+        }
+        sqlite3_finalize(stmt);
+        return rows;
+    }
+
+private:
+    sqlite3 *db_;
+    std::string dir_;
+    std::string path_;
+
+    TempDB(const TempDB &);
+    TempDB &operator=(const TempDB &);
+};
+
+#endif  // HTTPDNS_SDK_IOS_TESTS_MSDKDNS_TEMP_DB_H_
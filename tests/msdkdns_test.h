@@ -0,0 +1,27 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#ifndef HTTPDNS_SDK_IOS_TESTS_MSDKDNS_TEST_H_
+#define HTTPDNS_SDK_IOS_TESTS_MSDKDNS_TEST_H_
+
+#include <stdio.h>
+
+// 失败时输出位置并计数，不中断，main 以 MSDKDNS_TEST_RESULT() 返回
+static int gMSDKDnsTestFailures = 0;
+
+#define MSDKDNS_CHECK(condition)                                                         \
+    do {                                                                                 \
+        if (!(condition)) {                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            gMSDKDnsTestFailures++;                                                      \
+        }                                                                                \
+    } while (0)
+
+#define MSDKDNS_CHECK_EQ(expected, actual) MSDKDNS_CHECK((expected) == (actual))
+
+#define MSDKDNS_TEST_RESULT()                                               \
+    (gMSDKDnsTestFailures == 0 ? (printf("ok\n"), 0)                        \
+                               : (fprintf(stderr, "%d failed\n", gMSDKDnsTestFailures), 1))
+
+#endif  // HTTPDNS_SDK_IOS_TESTS_MSDKDNS_TEST_H_
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_negative_cache.h"
+#include "msdkdns_test.h"
+#include <string>
+
+using namespace msdkdns;
+
+// 退避时间随机缩短至多20%
+static bool InBackoff(int64_t remaining, int64_t backoff) {
+    return remaining > backoff * 8 / 10 && remaining <= backoff;
+}
+
+// 连续失败按 base * 2^(n-1) 退避，不超过上限；退避结束后放行
+static void TestBackoff() {
+    NegativeCache cache(16, 1);
+    int64_t now = 0;
+    int64_t remaining = 0;
+    int64_t expected[] = {1000, 2000, 4000, 8000, 16000, 30000, 30000};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        cache.RecordFailure(1, 0, MSDKDNS_ENegativeKind_Unresolved, now);
+        MSDKDNS_CHECK(cache.Blocked(1, 0, now, &remaining) && InBackoff(remaining, expected[i]));
+        now += remaining;
+        MSDKDNS_CHECK(!cache.Blocked(1, 0, now, NULL));
+    }
+
+    int64_t nodata[] = {5000, 10000, 20000, 40000, 80000, 160000, 300000, 300000};
+    for (size_t i = 0; i < sizeof(nodata) / sizeof(nodata[0]); i++) {
+        cache.RecordFailure(2, 0, MSDKDNS_ENegativeKind_NoData, now);
+        MSDKDNS_CHECK(cache.Blocked(2, 0, now, &remaining) && InBackoff(remaining, nodata[i]));
+        now += remaining;
+    }
+
+    // 超过10分钟没有再失败，重新从 base 开始
+    now += 10 * 60 * 1000 + 1;
+    cache.RecordFailure(2, 0, MSDKDNS_ENegativeKind_NoData, now);
+    MSDKDNS_CHECK(cache.Blocked(2, 0, now, &remaining) && InBackoff(remaining, 5000));
+}
+
+// 各查询类型分别记录；成功清除该类型，Remove 清除所有类型
+static void TestTypes() {
+    NegativeCache cache(16, 2);
+    cache.RecordFailure(1, 1, MSDKDNS_ENegativeKind_NoData, 0);
+    cache.RecordFailure(1, 2, MSDKDNS_ENegativeKind_NoData, 0);
+    cache.RecordFailure(2, 1, MSDKDNS_ENegativeKind_NoData, 0);
+    MSDKDNS_CHECK(cache.Blocked(1, 1, 0, NULL) && cache.Blocked(1, 2, 0, NULL) && !cache.Blocked(1, 3, 0, NULL));
+
+    cache.RecordSuccess(1, 1);
+    MSDKDNS_CHECK(!cache.Blocked(1, 1, 0, NULL) && cache.Blocked(1, 2, 0, NULL));
+    cache.RecordFailure(1, 3, MSDKDNS_ENegativeKind_NoData, 0);
+    cache.Remove(1);
+    MSDKDNS_CHECK(!cache.Blocked(1, 2, 0, NULL) && !cache.Blocked(1, 3, 0, NULL));
+    MSDKDNS_CHECK(cache.Blocked(2, 1, 0, NULL));
+
+    msdkdns_negative_stats stats;
+    cache.Stats(&stats);
+    MSDKDNS_CHECK_EQ(4u, stats.failures);
+    MSDKDNS_CHECK_EQ(1u, stats.recovered);
+    MSDKDNS_CHECK_EQ(1u, stats.entries);
+    // 编号0不记录
+    cache.RecordFailure(0, 1, MSDKDNS_ENegativeKind_NoData, 0);
+    MSDKDNS_CHECK(!cache.Blocked(0, 1, 0, NULL));
+}
+
+// 无法驻留的域名以字符串为键，与编号互不影响，共用上限
+static void TestNames() {
+    NegativeCache cache(16, 3);
+    std::string name = "\xe4\xbe\x8b\xe5\xad\x90.example.com";
+    cache.RecordFailure(name, 1, MSDKDNS_ENegativeKind_Unresolved, 0);
+    cache.RecordFailure(name, 2, MSDKDNS_ENegativeKind_Unresolved, 0);
+    cache.RecordFailure(1, 1, MSDKDNS_ENegativeKind_Unresolved, 0);
+    MSDKDNS_CHECK(cache.Blocked(name, 1, 0, NULL) && cache.Blocked(name, 2, 0, NULL));
+    MSDKDNS_CHECK(!cache.Blocked("other.example.com", 1, 0, NULL));
+
+    cache.RecordSuccess(name, 1);
+    MSDKDNS_CHECK(!cache.Blocked(name, 1, 0, NULL) && cache.Blocked(name, 2, 0, NULL));
+    cache.Remove(name);
+    MSDKDNS_CHECK(!cache.Blocked(name, 2, 0, NULL) && cache.Blocked(1, 1, 0, NULL));
+    cache.RecordFailure(std::string(), 1, MSDKDNS_ENegativeKind_Unresolved, 0);
+    MSDKDNS_CHECK(!cache.Blocked(std::string(), 1, 0, NULL));
+
+    msdkdns_negative_stats stats;
+    cache.Stats(&stats);
+    MSDKDNS_CHECK_EQ(1u, stats.entries);
+}
+
+// 达到上限时先清除长时间没有失败且已可重试的记录，否则淘汰最早可以重试的
+static void TestEvict() {
+    NegativeCache cache(3, 4);
+    cache.RecordFailure(1, 0, MSDKDNS_ENegativeKind_Unresolved, 0);
+    cache.RecordFailure(2, 0, MSDKDNS_ENegativeKind_NoData, 0);
+    cache.RecordFailure("a.example.com", 0, MSDKDNS_ENegativeKind_NoData, 0);
+    cache.RecordFailure(3, 0, MSDKDNS_ENegativeKind_NoData, 0);
+    MSDKDNS_CHECK(!cache.Blocked(1, 0, 0, NULL));
+    MSDKDNS_CHECK(cache.Blocked(2, 0, 0, NULL) && cache.Blocked("a.example.com", 0, 0, NULL) &&
+                  cache.Blocked(3, 0, 0, NULL));
+
+    int64_t later = 11 * 60 * 1000;
+    cache.RecordFailure(4, 0, MSDKDNS_ENegativeKind_NoData, later);
+    msdkdns_negative_stats stats;
+    cache.Stats(&stats);
+    MSDKDNS_CHECK_EQ(1u, stats.entries);
+    cache.Clear();
+    cache.Stats(&stats);
+    MSDKDNS_CHECK_EQ(0u, stats.entries);
+}
+
+// 退避期内的查询计入 blocked，到期后不计
+static void TestBlockedStats() {
+    NegativeCache cache(16, 5);
+    cache.RecordFailure(1, 0, MSDKDNS_ENegativeKind_Unresolved, 0);
+    for (int i = 0; i < 5; i++) {
+        cache.Blocked(1, 0, 100, NULL);
+    }
+    cache.Blocked(1, 0, 1000, NULL);
+    msdkdns_negative_stats stats;
+    cache.Stats(&stats);
+    MSDKDNS_CHECK_EQ(5u, stats.blocked);
+}
+
+int main() {
+    TestBackoff();
+    TestTypes();
+    TestNames();
+    TestEvict();
+    TestBlockedStats();
+    return MSDKDNS_TEST_RESULT();
+}
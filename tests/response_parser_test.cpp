@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_response_parser.h"
+#include "msdkdns_test.h"
+#include <arpa/inet.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+// 对照模型：按原 HttpsDnsResolver 中逐级 componentsSeparatedByString 的逻辑解析
+static std::vector<std::string> Split(const std::string &text, char separator) {
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    for (;;) {
+        size_t end = text.find(separator, begin);
+        parts.push_back(text.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        if (end == std::string::npos) {
+            return parts;
+        }
+        begin = end + 1;
+    }
+}
+
+// 与 doubleValue 一致：只取十进制数字前缀，不识别 0x、inf、nan
+static double ReferenceTtl(const std::string &text) {
+    std::string prefix = text;
+    size_t start = prefix.find_first_not_of(" \t\r\v\f");
+    if (start == std::string::npos) {
+        return 0;
+    }
+    size_t end = prefix.find_first_not_of("0123456789.eE+-", start);
+    prefix = prefix.substr(0, end);
+    return strtod(prefix.c_str(), NULL);
+}
+
+static std::string ReferenceAnswer(const std::string &text, bool use_ipv6) {
+    std::vector<std::string> parts = Split(text, ',');
+    if (parts.size() != 2) {
+        return "";
+    }
+    std::string ips = parts[0];
+    if (ips.size() > 1 && ips[ips.size() - 1] == ';') {
+        ips.erase(ips.size() - 1);
+    }
+    std::vector<std::string> list = Split(ips, ';');
+    std::string result = parts[1] + ":";
+    for (size_t i = 0; i < list.size(); i++) {
+        uint8_t bytes[16];
+        if (inet_pton(use_ipv6 ? AF_INET6 : AF_INET, list[i].c_str(), bytes) != 1) {
+            return "";
+        }
+        result += list[i] + ";";
+    }
+    return result;
+}
+
+static std::string Reference(const std::string &input, MSDKDNS_TResponseMode mode) {
+    std::string output;
+    std::vector<std::string> lines = Split(input, '\n');
+    for (size_t i = 0; i < lines.size(); i++) {
+        size_t colon = lines[i].find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string domain = lines[i].substr(0, colon);
+        if (!domain.empty() && domain[domain.size() - 1] == '.') {
+            domain.erase(domain.size() - 1);
+        }
+        std::vector<std::string> parts = Split(lines[i].substr(colon + 1), '|');
+        if (domain.empty() || parts.size() != 2) {
+            continue;
+        }
+        std::string ipv4;
+        std::string ipv6;
+        if (mode == MSDKDNS_EResponseMode_Dual) {
+            std::vector<std::string> stacks = Split(parts[0], '-');
+            if (stacks.size() != 2) {
+                continue;
+            }
+            ipv4 = ReferenceAnswer(stacks[0], false);
+            ipv6 = ReferenceAnswer(stacks[1], true);
+        } else if (mode == MSDKDNS_EResponseMode_IPv6) {
+            ipv6 = ReferenceAnswer(parts[0], true);
+        } else {
+            ipv4 = ReferenceAnswer(parts[0], false);
+        }
+        if (ipv4.empty() && ipv6.empty()) {
+            continue;
+        }
+        output += domain + "|" + parts[1] + "|" + (ipv4.empty() ? "-" : ipv4) + "|" + (ipv6.empty() ? "-" : ipv6) + "\n";
+    }
+    return output;
+}
+
+static std::string Text(const std::string &input, const msdkdns_text_range &range) {
+    return input.substr(range.offset, range.length);
+}
+
+static bool SameTtl(double expected, double actual) {
+    return expected == actual || fabs(expected - actual) <= 1e-9 * fabs(expected);
+}
+
+// 按模型相同的格式输出解析结果，并检查数值字段与文本一致
+static std::string Render(const std::string &input, MSDKDNS_TResponseMode mode) {
+    std::vector<msdkdns_response_record> records;
+    std::vector<msdkdns_response_address> addresses;
+    size_t parsed = msdkdns_parse_response(input.data(), input.size(), mode, &records, &addresses);
+    MSDKDNS_CHECK_EQ(records.size(), parsed);
+    std::string output;
+    for (size_t i = 0; i < records.size(); i++) {
+        output += Text(input, records[i].domain) + "|" + Text(input, records[i].client_ip);
+        for (int family = 0; family < MSDKDNS_EResponseFamily_Count; family++) {
+            const msdkdns_response_answer &answer = records[i].answers[family];
+            if (!answer.present) {
+                output += "|-";
+                continue;
+            }
+            std::string ttl = Text(input, answer.ttl_text);
+            MSDKDNS_CHECK(SameTtl(ReferenceTtl(ttl), answer.ttl));
+            output += "|" + ttl + ":";
+            for (uint32_t k = 0; k < answer.count; k++) {
+                const msdkdns_response_address &address = addresses[answer.first + k];
+                std::string ip = Text(input, address.text);
+                uint8_t bytes[16];
+                memset(bytes, 0, sizeof(bytes));
+                inet_pton(address.family, ip.c_str(), bytes);
+                MSDKDNS_CHECK(memcmp(bytes, address.bytes, sizeof(bytes)) == 0);
+                output += ip + ";";
+            }
+        }
+        output += "\n";
+    }
+    return output;
+}
+
+static double ParseTtl(const char *ttl) {
+    std::string input = std::string("a.com.:1.2.3.4,") + ttl + "|9.9.9.9";
+    std::vector<msdkdns_response_record> records;
+    std::vector<msdkdns_response_address> addresses;
+    if (msdkdns_parse_response(input.data(), input.size(), MSDKDNS_EResponseMode_IPv4, &records, &addresses) != 1) {
+        return -1;
+    }
+    return records[0].answers[MSDKDNS_EResponseFamily_IPv4].ttl;
+}
+
+static void TestTtl() {
+    MSDKDNS_CHECK_EQ(300.0, ParseTtl("300"));
+    MSDKDNS_CHECK_EQ(300.0, ParseTtl(" 300"));
+    MSDKDNS_CHECK_EQ(300.0, ParseTtl("\t300\r"));
+    MSDKDNS_CHECK_EQ(120.5, ParseTtl("120.5"));
+    MSDKDNS_CHECK_EQ(0.5, ParseTtl(".5"));
+    MSDKDNS_CHECK_EQ(60.0, ParseTtl("+60s"));
+    MSDKDNS_CHECK_EQ(-5.0, ParseTtl("-5"));
+    MSDKDNS_CHECK_EQ(600.0, ParseTtl("6e2"));
+    MSDKDNS_CHECK_EQ(6.0, ParseTtl("6e"));
+    MSDKDNS_CHECK_EQ(0.0, ParseTtl("0x1A"));
+    MSDKDNS_CHECK_EQ(0.0, ParseTtl("abc"));
+    MSDKDNS_CHECK_EQ(0.0, ParseTtl(""));
+    MSDKDNS_CHECK_EQ(0.0, ParseTtl("."));
+    MSDKDNS_CHECK_EQ(5000000000.0, ParseTtl("5000000000"));
+}
+
+static void TestDual() {
+    std::string input = "a.com.:1.1.1.1;2.2.2.2;,300-::1,60|9.9.9.9\nb.com.:1.1.1.x,300-fe80::1,60.5|8.8.8.8\nc.com.:-|1.1.1.1\n";
+    std::vector<msdkdns_response_record> records;
+    std::vector<msdkdns_response_address> addresses;
+    MSDKDNS_CHECK_EQ(2u, msdkdns_parse_response(input.data(), input.size(), MSDKDNS_EResponseMode_Dual,
+                                                &records, &addresses));
+    MSDKDNS_CHECK_EQ(std::string("a.com|9.9.9.9|300:1.1.1.1;2.2.2.2;|60:::1;\nb.com|8.8.8.8|-|60.5:fe80::1;\n"),
+                     Render(input, MSDKDNS_EResponseMode_Dual));
+    MSDKDNS_CHECK(!records[1].answers[MSDKDNS_EResponseFamily_IPv4].present);
+    MSDKDNS_CHECK_EQ(60.5, records[1].answers[MSDKDNS_EResponseFamily_IPv6].ttl);
+}
+
+static std::string RandomInput() {
+    static const char *const kTokens[] = {
+        "a.com.", "b.cn", ":", "|", "-", ",", ";", "1.2.3.4", "10.0.0.1", "::1", "fe80::1", "2400:cb00::1",
+        "300", "60", "\n", ".", "x", "256.1.1.1", "1.2.3", " ", "\t", "12.5", "e3", "+", "0x1f", "1.2.3.4.5",
+    };
+    static const size_t kTokenCount = sizeof(kTokens) / sizeof(kTokens[0]);
+    std::string input;
+    if (rand() % 2) {
+        // 接近真实响应的多行结果，ttl 带随机空白和小数
+        int lines = 1 + rand() % 5;
+        for (int k = 0; k < lines; k++) {
+            input += "d" + std::to_string(k) + ".com.:";
+            int v4 = rand() % 4;
+            for (int j = 0; j < v4; j++) {
+                input += (j ? ";1.1.1." : "1.1.1.") + std::to_string(j);
+            }
+            input += std::string(rand() % 3 == 0 ? " " : "") + "," + std::to_string(rand() % 1000);
+            if (rand() % 3 == 0) {
+                input += "." + std::to_string(rand() % 100);
+            }
+            input += "-";
+            int v6 = rand() % 4;
+            for (int j = 0; j < v6; j++) {
+                input += (j ? ";::" : "::") + std::to_string(j + 1);
+            }
+            input += std::string(",") + (rand() % 3 == 0 ? " " : "") + "5|9.9.9.9";
+            if (k + 1 < lines) {
+                input += "\n";
+            }
+        }
+    } else {
+        int tokens = rand() % 40;
+        for (int i = 0; i < tokens; i++) {
+            input += kTokens[rand() % kTokenCount];
+        }
+    }
+    return input;
+}
+
+// 随机输入在三种模式下与对照模型的结果逐字节一致
+static void TestFuzz() {
+    srand(7);
+    int mismatches = 0;
+    for (int i = 0; i < 20000; i++) {
+        std::string input = RandomInput();
+        for (int mode = MSDKDNS_EResponseMode_IPv4; mode <= MSDKDNS_EResponseMode_Dual; mode++) {
+            MSDKDNS_TResponseMode response_mode = static_cast<MSDKDNS_TResponseMode>(mode);
+            if (Render(input, response_mode) != Reference(input, response_mode)) {
+                if (mismatches++ < 3) {
+                    fprintf(stderr, "mismatch mode %d: \"%s\"\n", mode, input.c_str());
+                }
+            }
+        }
+    }
+    MSDKDNS_CHECK_EQ(0, mismatches);
+}
+
+int main() {
+    TestTtl();
+    TestDual();
+    TestFuzz();
+    return MSDKDNS_TEST_RESULT();
+}
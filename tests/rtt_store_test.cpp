@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_rtt_store.h"
+#include "msdkdns_test.h"
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static const int64_t kStaleMs = 600000;
+
+static std::vector<std::string> Keys(size_t count) {
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < count; i++) {
+        char ip[32];
+        snprintf(ip, sizeof(ip), "10.0.0.%zu", i + 1);
+        keys.push_back(RttStore::Key(ip, 80));
+    }
+    return keys;
+}
+
+static msdkdns_rtt_stats Stats(double srtt_ms, int64_t updated_ms) {
+    msdkdns_rtt_stats stats = {srtt_ms, srtt_ms / 8, 0, 4, updated_ms, 0};
+    return stats;
+}
+
+// 排序：健康IP按代价排序，无历史的其次，不健康的最后；过期或抖动大时需要测速
+static void TestRank() {
+    RttStore store(16, kStaleMs);
+    std::vector<std::string> keys = Keys(4);
+    std::vector<size_t> order;
+    MSDKDNS_CHECK(store.Rank(keys, 1000, &order));
+    for (int i = 0; i < 5; i++) {
+        store.RecordSuccess(keys[0], 50, 1000);
+        store.RecordSuccess(keys[1], 20, 1000);
+        store.RecordFailure(keys[2], 1000);
+    }
+    MSDKDNS_CHECK(store.Rank(keys, 2000, &order));
+    MSDKDNS_CHECK(order.size() == 4 && order[0] == 1 && order[1] == 0 && order[2] == 3 && order[3] == 2);
+
+    std::vector<std::string> known(keys.begin(), keys.begin() + 3);
+    MSDKDNS_CHECK(!store.Rank(known, 2000, &order));
+    MSDKDNS_CHECK(store.Rank(known, 1000 + kStaleMs + 1, &order));
+    // 一次偏差很大的样本使抖动超过阈值
+    store.RecordSuccess(keys[1], 400, 3000);
+    MSDKDNS_CHECK(store.Rank(known, 3000, &order));
+}
+
+// 测速被取消、没有结果的IP在最小间隔内不再触发测速，排序上与无历史相同
+static void TestCancelledProbe() {
+    RttStore store(16, kStaleMs);
+    std::vector<std::string> keys = Keys(5);
+    std::vector<size_t> order;
+    MSDKDNS_CHECK(store.Rank(keys, 0, &order));
+    store.MarkProbed(keys, 1000);
+    // 前3个连通后其余被取消
+    for (size_t i = 0; i < 3; i++) {
+        store.RecordSuccess(keys[i], 10.0 * (i + 1), 1010);
+    }
+    MSDKDNS_CHECK(!store.Rank(keys, 2000, &order));
+    MSDKDNS_CHECK(order[0] == 0 && order[1] == 1 && order[2] == 2 && order[3] == 3 && order[4] == 4);
+    MSDKDNS_CHECK(store.Rank(keys, 1000 + 60 * 1000, &order));
+
+    // 只记录了测速时间的IP不写回持久化
+    std::vector<std::pair<std::string, msdkdns_rtt_stats> > dirty;
+    store.TakeDirty(&dirty);
+    MSDKDNS_CHECK_EQ(3u, dirty.size());
+
+    // 过期记录在测速后的最小间隔内同样不再触发测速
+    store.MarkProbed(keys, kStaleMs + 5000);
+    MSDKDNS_CHECK(!store.Rank(keys, kStaleMs + 6000, &order));
+}
+
+// 恢复：已满时淘汰最旧的记录，记录本身最旧时不恢复，两者都通过 TakeEvicted 取出
+static void TestRestore() {
+    RttStore store(3, kStaleMs);
+    std::vector<std::string> keys = Keys(5);
+    MSDKDNS_CHECK(store.Restore(keys[0], Stats(10, 300)));
+    MSDKDNS_CHECK(store.Restore(keys[1], Stats(10, 100)));
+    MSDKDNS_CHECK(store.Restore(keys[2], Stats(10, 200)));
+    MSDKDNS_CHECK(!store.Restore(keys[3], Stats(10, 50)));
+    MSDKDNS_CHECK(store.Restore(keys[4], Stats(10, 400)));
+    MSDKDNS_CHECK_EQ(3u, store.Size());
+    MSDKDNS_CHECK(!store.Lookup(keys[1], NULL));
+    MSDKDNS_CHECK(!store.Lookup(keys[3], NULL));
+    std::vector<std::string> evicted;
+    store.TakeEvicted(&evicted);
+    MSDKDNS_CHECK(evicted.size() == 2 && evicted[0] == keys[1] && evicted[1] == keys[3]);
+    store.TakeEvicted(&evicted);
+    MSDKDNS_CHECK(evicted.empty());
+
+    // 恢复不标记为待写回
+    std::vector<std::pair<std::string, msdkdns_rtt_stats> > dirty;
+    store.TakeDirty(&dirty);
+    MSDKDNS_CHECK(dirty.empty());
+
+    // 加载完成前已有更新的记录时保留已有记录
+    RttStore loading(4, kStaleMs);
+    loading.RecordSuccess(keys[0], 99, 1000);
+    MSDKDNS_CHECK(loading.Restore(keys[0], Stats(10, 500)));
+    msdkdns_rtt_stats stats;
+    MSDKDNS_CHECK(loading.Lookup(keys[0], &stats) && stats.srtt_ms == 99 && stats.updated_ms == 1000);
+    // 只记录了测速时间的记录以持久化数据为准，保留测速时间
+    loading.MarkProbed(std::vector<std::string>(1, keys[1]), 2000);
+    MSDKDNS_CHECK(loading.Restore(keys[1], Stats(30, 200)));
+    MSDKDNS_CHECK(loading.Lookup(keys[1], &stats) && stats.srtt_ms == 30 && stats.probed_ms == 2000);
+}
+
+// 运行中淘汰的 key 同样取出，重新加入后不再列出
+static void TestEvictedPrune() {
+    RttStore store(2, kStaleMs);
+    std::vector<std::string> keys = Keys(3);
+    store.RecordSuccess(keys[0], 10, 100);
+    store.RecordSuccess(keys[1], 10, 200);
+    store.RecordSuccess(keys[2], 10, 300);
+    std::vector<std::string> evicted;
+    store.TakeEvicted(&evicted);
+    MSDKDNS_CHECK(evicted.size() == 1 && evicted[0] == keys[0]);
+
+    store.RecordSuccess(keys[0], 10, 400);
+    store.RecordSuccess(keys[1], 10, 500);
+    store.TakeEvicted(&evicted);
+    MSDKDNS_CHECK(evicted.size() == 1 && evicted[0] == keys[2]);
+    std::vector<std::pair<std::string, msdkdns_rtt_stats> > dirty;
+    store.TakeDirty(&dirty);
+    MSDKDNS_CHECK_EQ(2u, dirty.size());
+}
+
+int main() {
+    TestRank();
+    TestCancelledProbe();
+    TestRestore();
+    TestEvictedPrune();
+    return MSDKDNS_TEST_RESULT();
+}
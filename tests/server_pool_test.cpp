@@ -0,0 +1,217 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_http_pool.h"
+#include "msdkdns_server_pool.h"
+#include "msdkdns_timer_wheel.h"
+#include "msdkdns_mock_server.h"
+#include "msdkdns_test.h"
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static const int kTimeoutMs = 800;
+
+static msdkdns_server_stats StatsOf(const ServerPool &pool, const std::string &server) {
+    std::vector<msdkdns_server_stats> stats;
+    pool.Stats(&stats);
+    for (size_t i = 0; i < stats.size(); i++) {
+        if (stats[i].server == server) {
+            return stats[i];
+        }
+    }
+    return msdkdns_server_stats();
+}
+
+// 熔断：连续失败3次熔断，冷却后放行一个探测，探测失败加倍冷却，成功恢复
+static void TestBreaker() {
+    ServerPool pool;
+    pool.SetServers(std::vector<std::string>(1, "a"));
+    std::string server;
+    for (int i = 0; i < 3; i++) {
+        pool.RecordFailure("a", 1000);
+    }
+    MSDKDNS_CHECK(pool.AllOpen());
+    MSDKDNS_CHECK_EQ(11000, StatsOf(pool, "a").retry_at_ms);
+
+    MSDKDNS_CHECK(pool.Select(11000, &server) && server == "a");
+    MSDKDNS_CHECK_EQ(MSDKDNS_EBreakerState_HalfOpen, StatsOf(pool, "a").state);
+    pool.RecordFailure("a", 11000);
+    MSDKDNS_CHECK_EQ(31000, StatsOf(pool, "a").retry_at_ms);
+
+    MSDKDNS_CHECK(pool.Select(31000, &server) && server == "a");
+    pool.RecordSuccess("a", 10, 31000);
+    MSDKDNS_CHECK_EQ(MSDKDNS_EBreakerState_Closed, StatsOf(pool, "a").state);
+    MSDKDNS_CHECK_EQ(0.0, StatsOf(pool, "a").error_rate);
+}
+
+// 客户端网络错误不计入统计，不熔断；进行中的探测结束，下一个请求可以再次探测
+static void TestClientError() {
+    std::vector<std::string> servers;
+    servers.push_back("a");
+    servers.push_back("b");
+    ServerPool pool;
+    pool.SetServers(servers);
+    for (int i = 0; i < 10; i++) {
+        pool.RecordClientError("a", 1000);
+    }
+    msdkdns_server_stats stats = StatsOf(pool, "a");
+    MSDKDNS_CHECK(stats.state == MSDKDNS_EBreakerState_Closed && stats.failures == 0 && stats.error_rate == 0);
+
+    for (int i = 0; i < 3; i++) {
+        pool.RecordFailure("a", 1000);
+    }
+    std::string server;
+    MSDKDNS_CHECK(pool.Select(11000, &server) && server == "a");
+    // 探测进行中，其他请求使用 b
+    MSDKDNS_CHECK(pool.Select(11001, &server) && server == "b");
+    pool.RecordClientError("a", 11002);
+    MSDKDNS_CHECK_EQ(MSDKDNS_EBreakerState_HalfOpen, StatsOf(pool, "a").state);
+    MSDKDNS_CHECK(pool.Select(11003, &server) && server == "a");
+}
+
+// 本地模拟服务端：按 HttpPool 的结果记录到 ServerPool，与 HttpsDnsResolver 的分类一致
+class StandIn {
+public:
+    StandIn() : pool_(2, 4), offset_ms_(0) {
+        pool_.Start();
+    }
+
+    ~StandIn() { pool_.Stop(); }
+
+    void Add(MockHttpServer *server) {
+        char key[32];
+        snprintf(key, sizeof(key), "127.0.0.1:%u", server->port());
+        ports_[key] = server->port();
+        keys_.push_back(key);
+        servers_.SetServers(keys_);
+    }
+
+    // 发出一个请求，返回被选中的服务IP
+    std::string Request(int timeout_ms) {
+        std::string server;
+        servers_.Select(Now(), &server);
+        std::promise<msdkdns_http_response> promise;
+        int64_t begin = msdkdns_monotonic_ms();
+        if (pool_.Get("127.0.0.1", ports_[server], "/d?dn=a.com", timeout_ms, &StandIn::OnResponse, &promise) == 0) {
+            return server;
+        }
+        msdkdns_http_response response = promise.get_future().get();
+        if (response.result == MSDKDNS_EHttpResult_Ok && response.status < 500) {
+            servers_.RecordSuccess(server, static_cast<double>(msdkdns_monotonic_ms() - begin), Now());
+        } else if (response.result == MSDKDNS_EHttpResult_NetworkDown) {
+            servers_.RecordClientError(server, Now());
+        } else {
+            servers_.RecordFailure(server, Now());
+        }
+        return server;
+    }
+
+    std::string Key(const MockHttpServer &server) const {
+        char key[32];
+        snprintf(key, sizeof(key), "127.0.0.1:%u", server.port());
+        return key;
+    }
+
+    // 跳过熔断冷却
+    void Advance(int64_t ms) { offset_ms_ += ms; }
+
+    const ServerPool &servers() const { return servers_; }
+
+private:
+    static void OnResponse(void *context, const msdkdns_http_response *response) {
+        static_cast<std::promise<msdkdns_http_response> *>(context)->set_value(*response);
+    }
+
+    int64_t Now() const { return msdkdns_monotonic_ms() + offset_ms_; }
+
+    HttpPool pool_;
+    ServerPool servers_;
+    std::vector<std::string> keys_;
+    std::map<std::string, uint16_t> ports_;
+    int64_t offset_ms_;
+};
+
+static std::string Answer(const std::string &) {
+    return "1.1.1.1;2.2.2.2,60\n";
+}
+
+// 快、慢两个服务端：慢的耗时超过无样本时默认代价的1.25倍，被快的取代；快的不可用后熔断并转到慢的，
+// 冷却期间只探测一次，恢复后切回
+static void TestStandInServers() {
+    MockHttpServer slow(Answer);
+    MockHttpServer fast(Answer);
+    MSDKDNS_CHECK(slow.Start() && fast.Start());
+    slow.set_delay_ms(450);
+    fast.set_delay_ms(2);
+    StandIn standin;
+    standin.Add(&slow);
+    standin.Add(&fast);
+    std::string slow_key = standin.Key(slow);
+    std::string fast_key = standin.Key(fast);
+
+    std::map<std::string, int> picks;
+    for (int i = 0; i < 20; i++) {
+        picks[standin.Request(kTimeoutMs)]++;
+    }
+    MSDKDNS_CHECK(picks[fast_key] >= 18);
+    MSDKDNS_CHECK(standin.Request(kTimeoutMs) == fast_key);
+
+    // 快的服务端响应超过请求超时，3次后熔断
+    fast.set_delay_ms(1500);
+    for (int i = 0; i < 3; i++) {
+        MSDKDNS_CHECK(standin.Request(kTimeoutMs) == fast_key);
+    }
+    MSDKDNS_CHECK_EQ(MSDKDNS_EBreakerState_Open, StatsOf(standin.servers(), fast_key).state);
+    picks.clear();
+    for (int i = 0; i < 3; i++) {
+        picks[standin.Request(kTimeoutMs)]++;
+    }
+    MSDKDNS_CHECK_EQ(3, picks[slow_key]);
+
+    // 冷却结束放行一个探测，仍失败则继续使用慢的
+    standin.Advance(10 * 1000);
+    MSDKDNS_CHECK(standin.Request(kTimeoutMs) == fast_key);
+    MSDKDNS_CHECK_EQ(MSDKDNS_EBreakerState_Open, StatsOf(standin.servers(), fast_key).state);
+    MSDKDNS_CHECK(standin.Request(kTimeoutMs) == slow_key);
+
+    // 恢复后探测成功，流量回到快的
+    fast.set_delay_ms(2);
+    standin.Advance(20 * 1000);
+    MSDKDNS_CHECK(standin.Request(kTimeoutMs) == fast_key);
+    MSDKDNS_CHECK_EQ(MSDKDNS_EBreakerState_Closed, StatsOf(standin.servers(), fast_key).state);
+    picks.clear();
+    for (int i = 0; i < 10; i++) {
+        picks[standin.Request(kTimeoutMs)]++;
+    }
+    MSDKDNS_CHECK(picks[fast_key] >= 9);
+    slow.Stop();
+    fast.Stop();
+}
+
+// 服务端已关闭时连接失败计入服务IP失败
+static void TestRefused() {
+    MockHttpServer server(Answer);
+    MSDKDNS_CHECK(server.Start());
+    StandIn standin;
+    standin.Add(&server);
+    std::string key = standin.Key(server);
+    server.Stop();
+    for (int i = 0; i < 3; i++) {
+        standin.Request(500);
+    }
+    msdkdns_server_stats stats = StatsOf(standin.servers(), key);
+    MSDKDNS_CHECK(stats.state == MSDKDNS_EBreakerState_Open && stats.failures == 3);
+}
+
+int main() {
+    TestBreaker();
+    TestClientError();
+    TestStandInServers();
+    TestRefused();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_single_flight.h"
+#include "msdkdns_test.h"
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static std::vector<std::string> Keys(const char *a, const char *b = NULL, const char *c = NULL,
+                                     const char *d = NULL) {
+    std::vector<std::string> keys;
+    const char *all[] = {a, b, c, d};
+    for (size_t i = 0; i < 4 && all[i]; i++) {
+        keys.push_back(all[i]);
+    }
+    return keys;
+}
+
+// 第一个登记的成为发起方，之后的调用挂到在途请求上，未在途的键照常发起
+static void TestLeaderFollower() {
+    SingleFlight flight;
+    int first = 0, second = 0;
+    std::vector<size_t> starts, coalesced;
+    flight.Join(Keys("a.com|1|", "b.com|1|"), &first, &starts, &coalesced);
+    MSDKDNS_CHECK_EQ(2u, starts.size());
+    MSDKDNS_CHECK(coalesced.empty());
+    MSDKDNS_CHECK(flight.InFlight("a.com|1|") && flight.InFlight("b.com|1|"));
+
+    starts.clear();
+    flight.Join(Keys("b.com|1|", "c.com|1|"), &second, &starts, &coalesced);
+    MSDKDNS_CHECK_EQ(1u, starts.size());
+    MSDKDNS_CHECK_EQ(1u, starts.empty() ? 0 : starts[0]);
+    MSDKDNS_CHECK_EQ(1u, coalesced.size());
+    MSDKDNS_CHECK_EQ(0u, coalesced.empty() ? 1 : coalesced[0]);
+    MSDKDNS_CHECK_EQ(3u, flight.Size());
+
+    // 网络栈或 routeIp 不同即为不同的键
+    starts.clear();
+    coalesced.clear();
+    flight.Join(Keys("a.com|2|", "a.com|1|10.0.0.1"), &second, &starts, &coalesced);
+    MSDKDNS_CHECK_EQ(2u, starts.size());
+    MSDKDNS_CHECK(coalesced.empty());
+
+    // 发起方结束后只唤醒挂在自己键上的调用
+    std::vector<void *> waiters;
+    flight.Complete(Keys("a.com|1|"), &waiters);
+    MSDKDNS_CHECK(waiters.empty());
+    flight.Complete(Keys("b.com|1|"), &waiters);
+    MSDKDNS_CHECK_EQ(1u, waiters.size());
+    MSDKDNS_CHECK(!waiters.empty() && waiters[0] == &second);
+    MSDKDNS_CHECK(!flight.InFlight("b.com|1|"));
+    MSDKDNS_CHECK(flight.InFlight("c.com|1|"));
+}
+
+// 同一次调用中重复的键只处理一次，不会作为发起方又挂到自己的请求上
+static void TestDuplicatesWithinCall() {
+    SingleFlight flight;
+    int waiter = 0;
+    std::vector<size_t> starts, coalesced;
+    flight.Join(Keys("d.com|1|", "d.com|1|", "e.com|1|", "d.com|1|"), &waiter, &starts, &coalesced);
+    MSDKDNS_CHECK_EQ(2u, starts.size());
+    if (starts.size() == 2) {
+        MSDKDNS_CHECK_EQ(0u, starts[0]);
+        MSDKDNS_CHECK_EQ(2u, starts[1]);
+    }
+    MSDKDNS_CHECK(coalesced.empty());
+    std::vector<void *> waiters;
+    flight.Complete(Keys("d.com|1|", "e.com|1|"), &waiters);
+    MSDKDNS_CHECK(waiters.empty());
+    MSDKDNS_CHECK_EQ(0u, flight.Size());
+
+    // 已在途的键在一次调用中重复出现，只挂一次
+    starts.clear();
+    flight.Join(Keys("f.com|1|"), NULL, &starts, &coalesced);
+    starts.clear();
+    flight.Join(Keys("f.com|1|", "f.com|1|"), &waiter, &starts, &coalesced);
+    MSDKDNS_CHECK(starts.empty());
+    MSDKDNS_CHECK_EQ(1u, coalesced.size());
+    flight.Complete(Keys("f.com|1|"), &waiters);
+    MSDKDNS_CHECK_EQ(1u, waiters.size());
+}
+
+// 请求结束时挂在同一个键上的所有调用按挂上的顺序全部返回，且只返回一次
+static void TestFanOut() {
+    SingleFlight flight;
+    int waiters_storage[5];
+    std::vector<size_t> starts, coalesced;
+    flight.Join(Keys("g.com|1|"), &waiters_storage[0], &starts, &coalesced);
+    for (int i = 1; i < 5; i++) {
+        flight.Join(Keys("g.com|1|", "h.com|1|"), &waiters_storage[i], &starts, &coalesced);
+    }
+    // 第一次循环中 h.com 成为发起方，之后3次都挂在其上
+    MSDKDNS_CHECK_EQ(2u, starts.size());
+    MSDKDNS_CHECK_EQ(7u, coalesced.size());
+
+    std::vector<void *> waiters;
+    flight.Complete(Keys("g.com|1|"), &waiters);
+    MSDKDNS_CHECK_EQ(4u, waiters.size());
+    for (size_t i = 0; i < waiters.size(); i++) {
+        MSDKDNS_CHECK(waiters[i] == &waiters_storage[i + 1]);
+    }
+    waiters.clear();
+    flight.Complete(Keys("g.com|1|"), &waiters);
+    MSDKDNS_CHECK(waiters.empty());
+    flight.Complete(Keys("h.com|1|"), &waiters);
+    MSDKDNS_CHECK_EQ(3u, waiters.size());
+    MSDKDNS_CHECK_EQ(0u, flight.Size());
+
+    // waiter 为 NULL 时计入合并但不挂
+    starts.clear();
+    coalesced.clear();
+    flight.Join(Keys("i.com|1|"), NULL, &starts, &coalesced);
+    flight.Join(Keys("i.com|1|"), NULL, &starts, &coalesced);
+    MSDKDNS_CHECK_EQ(1u, coalesced.size());
+    waiters.clear();
+    flight.Complete(Keys("i.com|1|"), &waiters);
+    MSDKDNS_CHECK(waiters.empty());
+}
+
+// 发起方请求失败同样调用 Complete：等待方全部被唤醒，键不再在途，下一次登记重新发起
+static void TestErrorPath() {
+    SingleFlight flight;
+    int follower = 0, retry = 0;
+    std::vector<size_t> starts, coalesced;
+    flight.Join(Keys("j.com|1|"), NULL, &starts, &coalesced);
+    flight.Join(Keys("j.com|1|"), &follower, &starts, &coalesced);
+    std::vector<void *> waiters;
+    flight.Complete(Keys("j.com|1|"), &waiters);
+    MSDKDNS_CHECK_EQ(1u, waiters.size());
+    MSDKDNS_CHECK(!flight.InFlight("j.com|1|"));
+
+    starts.clear();
+    coalesced.clear();
+    flight.Join(Keys("j.com|1|"), &retry, &starts, &coalesced);
+    MSDKDNS_CHECK_EQ(1u, starts.size());
+    MSDKDNS_CHECK(coalesced.empty());
+    waiters.clear();
+    flight.Complete(Keys("j.com|1|", "unknown|1|"), &waiters);
+    MSDKDNS_CHECK(waiters.empty());
+    MSDKDNS_CHECK_EQ(0u, flight.Size());
+}
+
+int main() {
+    TestLeaderFollower();
+    TestDuplicatesWithinCall();
+    TestFanOut();
+    TestErrorPath();
+    return MSDKDNS_TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_db_writer.h"
+#include "msdkdns_snapshot.h"
+#include "msdkdns_temp_db.h"
+#include "msdkdns_test.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace msdkdns;
+
+static msdkdns_db_row Row(const std::string &domain, const std::string &ips) {
+    msdkdns_db_row row;
+    row.domain = domain;
+    row.columns[MSDKDNS_EDBColumn_IPV4IPs] = ips;
+    row.columns[MSDKDNS_EDBColumn_IPV4TTLExpried] = "1700000000";
+    row.columns[MSDKDNS_EDBColumn_IPV6IPs] = "";
+    return row;
+}
+
+static bool Lookup(const SnapshotReader &reader, const std::string &domain, msdkdns_db_row *row) {
+    return reader.Lookup(domain.data(), domain.size(), row);
+}
+
+// 按 offset 修改文件中的一个字节
+static void Corrupt(const std::string &path, off_t offset) {
+    int fd = open(path.c_str(), O_RDWR);
+    unsigned char byte = 0;
+    pread(fd, &byte, 1, offset);
+    byte ^= 0x5A;
+    pwrite(fd, &byte, 1, offset);
+    close(fd);
+}
+
+// 从数据库生成快照后，查询结果与数据库一致
+static void TestRoundTrip() {
+    TempDB temp;
+    DBWriter writer(temp.db(), 4096);
+    char domain[32];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(domain, sizeof(domain), "d%d.example.com", i);
+        writer.Put(Row(domain, std::string("10.0.0.") + std::to_string(i % 250)));
+    }
+    MSDKDNS_CHECK(writer.Flush());
+    std::string path = temp.File("httpdns.snapshot");
+    MSDKDNS_CHECK(msdkdns_snapshot_write_from_db(temp.db(), path));
+
+    SnapshotReader reader;
+    MSDKDNS_CHECK(reader.Open(path));
+    MSDKDNS_CHECK_EQ(1000u, reader.Count());
+    msdkdns_db_row row;
+    MSDKDNS_CHECK(Lookup(reader, "d7.example.com", &row));
+    MSDKDNS_CHECK_EQ(std::string("10.0.0.7"), row.columns[MSDKDNS_EDBColumn_IPV4IPs]);
+    MSDKDNS_CHECK_EQ(std::string("1700000000"), row.columns[MSDKDNS_EDBColumn_IPV4TTLExpried]);
+    MSDKDNS_CHECK(row.columns[MSDKDNS_EDBColumn_IPV6IPs].empty());
+    MSDKDNS_CHECK(!Lookup(reader, "missing.example.com", &row));
+    MSDKDNS_CHECK(!Lookup(reader, "D7.example.com", &row));
+
+    std::vector<std::string> domains;
+    reader.Domains(&domains);
+    MSDKDNS_CHECK_EQ(1000u, domains.size());
+    std::sort(domains.begin(), domains.end());
+    MSDKDNS_CHECK(std::unique(domains.begin(), domains.end()) == domains.end());
+}
+
+// 同名域名后写入的覆盖先写入的，空域名跳过
+static void TestDuplicates() {
+    TempDB temp;
+    std::vector<msdkdns_db_row> rows;
+    rows.push_back(Row("a.com", "1.1.1.1"));
+    rows.push_back(Row("b.com", "2.2.2.2"));
+    rows.push_back(Row("a.com", "3.3.3.3"));
+    rows.push_back(Row("", "4.4.4.4"));
+    std::string path = temp.File("httpdns.snapshot");
+    MSDKDNS_CHECK(msdkdns_snapshot_write(path, rows));
+    SnapshotReader reader;
+    MSDKDNS_CHECK(reader.Open(path));
+    MSDKDNS_CHECK_EQ(2u, reader.Count());
+    msdkdns_db_row row;
+    MSDKDNS_CHECK(Lookup(reader, "a.com", &row) && row.columns[MSDKDNS_EDBColumn_IPV4IPs] == "3.3.3.3");
+
+    // 重写时整体替换，已打开的映射不受影响
+    rows.clear();
+    rows.push_back(Row("c.com", "5.5.5.5"));
+    MSDKDNS_CHECK(msdkdns_snapshot_write(path, rows));
+    MSDKDNS_CHECK(Lookup(reader, "b.com", &row));
+    SnapshotReader reopened;
+    MSDKDNS_CHECK(reopened.Open(path));
+    MSDKDNS_CHECK(!Lookup(reopened, "b.com", &row) && Lookup(reopened, "c.com", &row));
+}
+
+// header 损坏时打开失败，记录损坏时该记录视为不存在
+static void TestCorruption() {
+    TempDB temp;
+    std::vector<msdkdns_db_row> rows;
+    rows.push_back(Row("a.com", "1.1.1.1"));
+    rows.push_back(Row("b.com", "2.2.2.2"));
+    std::string path = temp.File("httpdns.snapshot");
+    SnapshotReader reader;
+    MSDKDNS_CHECK(!reader.Open(path));
+
+    MSDKDNS_CHECK(msdkdns_snapshot_write(path, rows));
+    Corrupt(path, 12);
+    MSDKDNS_CHECK(!reader.Open(path));
+
+    MSDKDNS_CHECK(msdkdns_snapshot_write(path, rows));
+    MSDKDNS_CHECK(reader.Open(path));
+    // 最后一条记录的最后一个字节
+    struct stat st;
+    stat(path.c_str(), &st);
+    reader.Close();
+    Corrupt(path, st.st_size - 1);
+    MSDKDNS_CHECK(reader.Open(path));
+    msdkdns_db_row row;
+    int found = Lookup(reader, "a.com", &row) + Lookup(reader, "b.com", &row);
+    MSDKDNS_CHECK_EQ(1, found);
+}
+
+int main() {
+    TestRoundTrip();
+    TestDuplicates();
+    TestCorruption();
+    return MSDKDNS_TEST_RESULT();
+}
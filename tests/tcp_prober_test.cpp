@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+// msdkdns_tcp_probe 对本地回环监听的测速：同一端口上
+// 127.0.0.1 正常接受连接，127.0.0.3 的接受队列已满（SYN 被丢弃，connect 一直挂起），127.0.0.2 无监听（连接被拒绝）
+
+#include "msdkdns_tcp_prober.h"
+#include "msdkdns_test.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace msdkdns;
+
+static int Listen(int family, const char *ip, uint16_t port, int backlog, uint16_t *bound) {
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_storage storage = sockaddr_storage();
+    socklen_t length = 0;
+    if (family == AF_INET) {
+        sockaddr_in *addr = reinterpret_cast<sockaddr_in *>(&storage);
+        addr->sin_family = AF_INET;
+        addr->sin_port = htons(port);
+        inet_pton(AF_INET, ip, &addr->sin_addr);
+        length = sizeof(*addr);
+    } else {
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on));
+        sockaddr_in6 *addr = reinterpret_cast<sockaddr_in6 *>(&storage);
+        addr->sin6_family = AF_INET6;
+        addr->sin6_port = htons(port);
+        inet_pton(AF_INET6, ip, &addr->sin6_addr);
+        length = sizeof(*addr);
+    }
+    if (bind(fd, reinterpret_cast<sockaddr *>(&storage), length) != 0 || listen(fd, backlog) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr *>(&storage), &length) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (bound) {
+        *bound = ntohs(family == AF_INET ? reinterpret_cast<sockaddr_in *>(&storage)->sin_port
+                                         : reinterpret_cast<sockaddr_in6 *>(&storage)->sin6_port);
+    }
+    return fd;
+}
+
+// 不调用 accept，先建立连接占满接受队列，之后到达的 SYN 被丢弃
+static std::vector<int> FillBacklog(const char *ip, uint16_t port) {
+    std::vector<int> fillers;
+    for (int i = 0; i < 4; i++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        sockaddr_in addr = sockaddr_in();
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        inet_pton(AF_INET, ip, &addr.sin_addr);
+        connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        fillers.push_back(fd);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    return fillers;
+}
+
+static const msdkdns_probe_result *Find(const std::vector<msdkdns_probe_result> &results, size_t index) {
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].index == index) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+static int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main() {
+    uint16_t port = 0;
+    int ok_fd = Listen(AF_INET, "127.0.0.1", 0, 128, &port);
+    MSDKDNS_CHECK(ok_fd >= 0);
+    int full_fd = Listen(AF_INET, "127.0.0.3", port, 0, NULL);
+    MSDKDNS_CHECK(full_fd >= 0);
+    int v6_fd = Listen(AF_INET6, "::1", port, 128, NULL);
+    std::vector<int> fillers = FillBacklog("127.0.0.3", port);
+
+    // 混合列表：成功的在前，其余按 超时、失败 分组并保持输入顺序
+    {
+        std::vector<std::string> ips;
+        ips.push_back("127.0.0.2");   // 0 拒绝
+        ips.push_back("127.0.0.1");   // 1 成功
+        ips.push_back("not-an-ip");   // 2 非法
+        ips.push_back("::1");         // 3 有 IPv6 时成功
+        ips.push_back("[::1]");       // 4 同上，带方括号
+        ips.push_back("127.0.0.3");   // 5 挂起
+        ips.push_back("127.0.0.3");   // 6 挂起
+        std::vector<msdkdns_probe_result> results;
+        int64_t begin = NowMs();
+        size_t connected = msdkdns_tcp_probe(ips, port, 300, 0, &results);
+        int64_t elapsed = NowMs() - begin;
+        size_t expected = v6_fd >= 0 ? 3 : 1;
+        MSDKDNS_CHECK_EQ(expected, connected);
+        MSDKDNS_CHECK_EQ(ips.size(), results.size());
+        for (size_t i = 0; i < results.size() && i < connected; i++) {
+            MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Connected, results[i].state);
+            MSDKDNS_CHECK(results[i].rtt_ms >= 0 && results[i].rtt_ms < 300);
+        }
+        MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Connected, Find(results, 1)->state);
+        MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Failed, Find(results, 0)->state);
+        MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Failed, Find(results, 2)->state);
+        MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Timeout, Find(results, 5)->state);
+        MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Timeout, Find(results, 6)->state);
+        if (results.size() == ips.size()) {
+            MSDKDNS_CHECK_EQ(5u, results[connected].index);
+            MSDKDNS_CHECK_EQ(6u, results[connected + 1].index);
+            MSDKDNS_CHECK_EQ(0u, results[connected + 2].index);
+        }
+        // 挂起的连接一起等到超时，总耗时约为一次超时而不是每个地址一次
+        MSDKDNS_CHECK(elapsed >= 250 && elapsed < 550);
+    }
+
+    // 达到 quorum 后不再等待挂起的连接
+    {
+        std::vector<std::string> ips;
+        ips.push_back("127.0.0.3");
+        ips.push_back("127.0.0.1");
+        ips.push_back("127.0.0.3");
+        std::vector<msdkdns_probe_result> results;
+        int64_t begin = NowMs();
+        MSDKDNS_CHECK_EQ(1u, msdkdns_tcp_probe(ips, port, 2000, 1, &results));
+        MSDKDNS_CHECK(NowMs() - begin < 1000);
+        MSDKDNS_CHECK_EQ(3u, results.size());
+        if (results.size() == 3) {
+            MSDKDNS_CHECK_EQ(1u, results[0].index);
+            MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Cancelled, results[1].state);
+            MSDKDNS_CHECK_EQ(0u, results[1].index);
+            MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Cancelled, results[2].state);
+            MSDKDNS_CHECK_EQ(2u, results[2].index);
+        }
+    }
+
+    // 空列表及全部非法
+    {
+        std::vector<msdkdns_probe_result> results;
+        MSDKDNS_CHECK_EQ(0u, msdkdns_tcp_probe(std::vector<std::string>(), port, 100, 0, &results));
+        MSDKDNS_CHECK(results.empty());
+        std::vector<std::string> ips(2, "256.1.1.1");
+        MSDKDNS_CHECK_EQ(0u, msdkdns_tcp_probe(ips, port, 100, 0, &results));
+        MSDKDNS_CHECK_EQ(2u, results.size());
+        MSDKDNS_CHECK_EQ(MSDKDNS_EProbeState_Failed, results[0].state);
+    }
+
+    for (size_t i = 0; i < fillers.size(); i++) {
+        close(fillers[i]);
+    }
+    close(ok_fd);
+    close(full_fd);
+    if (v6_fd >= 0) {
+        close(v6_fd);
+    }
+    return MSDKDNS_TEST_RESULT();
+}
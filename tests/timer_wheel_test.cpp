@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) Tencent. All rights reserved.
+ */
+
+#include "msdkdns_timer_wheel.h"
+#include "msdkdns_test.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace msdkdns;
+
+static void TestOrder() {
+    TimerWheel wheel(1000, 0);
+    MSDKDNS_CHECK(wheel.Schedule(2, 5000));
+    MSDKDNS_CHECK(wheel.Schedule(1, 2500));
+    MSDKDNS_CHECK(wheel.Schedule(3, 70 * 1000));
+    MSDKDNS_CHECK(!wheel.Schedule(0, 1000));
+    MSDKDNS_CHECK(!wheel.Schedule(4, -1));
+    MSDKDNS_CHECK(!wheel.Contains(4));
+    MSDKDNS_CHECK_EQ(3u, wheel.Size());
+    std::vector<uint32_t> fired;
+    wheel.Advance(2000, &fired);
+    MSDKDNS_CHECK(fired.empty());
+    // 向上取整到格，不会早于 deadline 触发
+    wheel.Advance(3000, &fired);
+    MSDKDNS_CHECK(fired.size() == 1 && fired[0] == 1u);
+    // 覆盖原有任务
+    MSDKDNS_CHECK(wheel.Schedule(2, 9000));
+    wheel.Advance(8000, &fired);
+    MSDKDNS_CHECK_EQ(1u, fired.size());
+    MSDKDNS_CHECK(wheel.Cancel(3));
+    MSDKDNS_CHECK(!wheel.Cancel(3));
+    MSDKDNS_CHECK(!wheel.Contains(3));
+    MSDKDNS_CHECK(!wheel.Cancel(1000));
+    wheel.Advance(100 * 1000, &fired);
+    MSDKDNS_CHECK(fired.size() == 2 && fired[1] == 2u);
+    MSDKDNS_CHECK(wheel.Empty());
+    int64_t deadline = 0;
+    MSDKDNS_CHECK(!wheel.NextDeadline(&deadline));
+}
+
+// 虚拟时钟随机推进：任务不早于 deadline、不晚于 deadline 所在格的下一格触发，
+// NextDeadline 不晚于最早的任务
+static void TestRandom() {
+    srand(1);
+    TimerWheel wheel(1000, 5000);
+    std::map<uint32_t, int64_t> pending;
+    for (int i = 0; i < 3000; i++) {
+        uint32_t key = static_cast<uint32_t>(i + 1);
+        int64_t deadline = 5000 + static_cast<int64_t>(rand() % 5000000) * (i % 7 == 0 ? 1000 : 1);
+        wheel.Schedule(key, deadline);
+        pending[key] = deadline;
+    }
+    for (int i = 0; i < 300; i++) {
+        uint32_t key = static_cast<uint32_t>(i * 3 + 1);
+        MSDKDNS_CHECK(wheel.Cancel(key));
+        pending.erase(key);
+    }
+    // 覆盖已有任务，包括刚取消又重新调度的 key
+    for (int i = 0; i < 300; i++) {
+        uint32_t key = static_cast<uint32_t>(i * 5 + 1);
+        int64_t deadline = 5000 + static_cast<int64_t>(rand() % 500000);
+        wheel.Schedule(key, deadline);
+        pending[key] = deadline;
+    }
+    MSDKDNS_CHECK_EQ(pending.size(), wheel.Size());
+    int64_t now = 5000;
+    int early = 0;
+    int late = 0;
+    int bad_next = 0;
+    while (!wheel.Empty()) {
+        int64_t next = 0;
+        MSDKDNS_CHECK(wheel.NextDeadline(&next));
+        int64_t earliest = pending.begin()->second;
+        for (std::map<uint32_t, int64_t>::iterator it = pending.begin(); it != pending.end(); ++it) {
+            earliest = std::min(earliest, it->second);
+        }
+        if (next > (earliest + 999) / 1000 * 1000) {
+            bad_next++;
+        }
+        now += (rand() % 2) ? next - now : 1000 + rand() % 300000;
+        if (now < next) {
+            now = next;
+        }
+        std::vector<uint32_t> fired;
+        wheel.Advance(now, &fired);
+        for (size_t i = 0; i < fired.size(); i++) {
+            if (pending[fired[i]] > now) {
+                early++;
+            }
+            pending.erase(fired[i]);
+        }
+        MSDKDNS_CHECK_EQ(pending.size(), wheel.Size());
+        for (std::map<uint32_t, int64_t>::iterator it = pending.begin(); it != pending.end(); ++it) {
+            if (it->second + 1000 <= now) {
+                late++;
+            }
+        }
+    }
+    MSDKDNS_CHECK_EQ(0, early);
+    MSDKDNS_CHECK_EQ(0, late);
+    MSDKDNS_CHECK_EQ(0, bad_next);
+    MSDKDNS_CHECK(pending.empty());
+}
+
+int main() {
+    TestOrder();
+    TestRandom();
+    return MSDKDNS_TEST_RESULT();
+}